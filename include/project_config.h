@@ -24,6 +24,7 @@
 // External Power Control
 #define VEXT_PIN            36
 #define VEXT_ON_STATE       LOW
+#define VEXT_SETTLE_TIME    100      // Wait after switching Vext on (ms)
 
 // GPS Module
 #define GPS_RX_PIN          3
@@ -57,6 +58,10 @@
 // Regional Parameters
 #define LORAWAN_REGION      AS923_3  // AS923-3 (915-921 MHz) for Chile
 #define LORAWAN_SUBBAND     1        // Sub-band 1
+#ifndef LORAWAN_MULTI_REGION
+#define LORAWAN_MULTI_REGION false   // Tables for every band, chosen at boot (NVS "region"), see src/lorawan_region.h
+#endif
+#define LORAWAN_DWELL_TIME  false    // Uplinks under the 400 ms dwell limit (AS923 where the regulator asks)
 #define LORAWAN_CLASS       CLASS_A  // Class A device
 
 // OTAA Credentials (CHANGE THESE!)
@@ -74,6 +79,33 @@
 #define TX_INTERVAL_MS      60000    // 60 seconds between transmissions
 #define JOIN_RETRY_DELAY    30000    // 30 seconds between join attempts
 #define MAX_JOIN_ATTEMPTS   10       // Maximum join attempts before restart
+#define STATUS_REPORT_INTERVAL 21600000 // 6 hours between status uplinks (fence root)
+#define ALERT_MAX_ATTEMPTS  3        // Confirmed alert uplinks without an ACK before giving up
+
+// Firmware updates over LoRaWAN (fragmented delta patches, see tools/fuota.py)
+#define FUOTA_FRAG_PORT     201      // Fragmented data block transport port
+#define FUOTA_MAX_FRAGMENTS 8192     // Fragments per session (received bitmap, 1 bit each)
+#define FUOTA_MAX_FRAG_SIZE 239      // Largest fragment (DR5 downlink less the 3-byte header)
+#define FUOTA_MAX_MISSING   512      // Lost fragments parity can rebuild (fragment size + 64 bytes each, PSRAM)
+#define FUOTA_MAX_MISSING_NO_PSRAM 96 // Fallback when PSRAM is missing (heap)
+#define FUOTA_CONFIRM_TIMEOUT 1800000 // A new image must reach the network within this or roll back (ms)
+// Release signing key, public half (uncompressed P-256 point, hex; CHANGE THIS: tools/ecdsa_p256.py keygen)
+#define FUOTA_SIGNING_KEY   "043BC7176B4DAC5D5CD7F6802FA45F4E9D5D064CAFAB5F1ABD83882DB21CF511DDC4D364185429D9D47C4C4F81945EBEAAF755939EAF5E744BE753BA695D9A003B"
+
+// Multicast groups (remote multicast setup, Class C sessions, see tools/multicast.py)
+#define MULTICAST_SETUP_PORT 200     // Remote multicast setup package port
+#define MULTICAST_MAX_GROUPS 4       // Group ids 0-3
+#define MULTICAST_FCNT_SAVE_INTERVAL 16 // Frame counters reserved in NVS ahead of use (skipped after a reset)
+#define LORAWAN_GENAPPKEY   LORAWAN_APPKEY // Multicast root key (LoRaWAN 1.0.x: its own key, or the AppKey)
+#define LORAWAN_AES_HARDWARE true    // AES peripheral for our LoRaWAN crypto (false: mbedtls)
+
+// Class A receive window timing (calibrated from downlinks, see tools/rx_timing.py)
+#define RX_GUARD_DEFAULT    10       // Window padding before calibration (ms each side, RadioLib's scanGuard)
+#define RX_GUARD_MIN        3        // Never below this (ms)
+#define RX_GUARD_MARGIN     1000     // Added to the measured timing error (us)
+#define RX_GUARD_SIGMAS     4.0      // Timing scatter covered, in standard deviations
+#define RX_CALIBRATION_SAMPLES 8     // Downlinks measured before the padding shrinks
+#define RX_CRYSTAL_PPM      20.0     // Clock error assumed until RX1 and RX2 downlinks measure it
 
 // ===============================================================
 // GPS CONFIGURATION
@@ -82,13 +114,114 @@
 #define GPS_TIMEOUT         5000     // GPS timeout (ms)
 #define GPS_MIN_SATELLITES  4        // Minimum satellites for valid fix
 #define GPS_ACCURACY_THRESHOLD 10.0  // Minimum accuracy in meters
+#define GPS_UERE_METERS     5.0      // Range error per unit of HDOP (m)
+#define GPS_SPEED_FILTER_TAU 3000    // Speed low-pass time constant (ms)
+#define GPS_ADAPTIVE_QUANTIZATION false // Position uplinks quantized to the fix accuracy (MSG_TYPE_GPS_COMPACT)
+#define GPS_QUANT_ERROR_FRACTION 0.5 // Quantization error allowed, as a fraction of HDOP * UERE
+#define GPS_COMPACT_ALTITUDE true    // Carry altitude in compact position uplinks
 
 // ===============================================================
 // GEOFENCING CONFIGURATION
 // ===============================================================
-#define MAX_GEOFENCES       5        // Maximum number of geofences
+#ifndef MAX_GEOFENCES
+#define MAX_GEOFENCES       5        // Maximum number of geofences (up to 32)
+#endif
 #define GEOFENCE_CHECK_INTERVAL 5000 // Check geofences every 5 seconds
 #define GEOFENCE_HYSTERESIS 2.0      // Hysteresis in meters to prevent bouncing
+#define MAX_GEOFENCE_VERTICES 512    // Shared polygon vertex pool (all fences)
+#define MAX_GEOFENCE_RINGS  32       // Shared polygon ring table: outer rings, holes, parts
+#define GEOFENCE_UTC_OFFSET_MIN -240 // Local time for arming schedules (Chile, UTC-4)
+#define GEOFENCE_CLOCK_SYNC_INTERVAL 60000 // Resync schedule clock from GPS (ms)
+#define GEOFENCE_MAX_SPEED  45.0      // Worst-case asset speed for check scheduling (m/s)
+#define GEOFENCE_MAX_ACCEL  4.0       // Worst-case acceleration for check scheduling (m/s^2)
+#define GEOFENCE_MIN_CHECK_INTERVAL GPS_UPDATE_RATE // Predicted check spacing floor (ms)
+#define GEOFENCE_MAX_CHECK_INTERVAL 60000 // Predicted check spacing ceiling (ms)
+#define GEOFENCE_SCHEDULE_SLACK 500   // Loop latency allowance when pacing the GPS (ms)
+#define GEOFENCE_MAX_SEGMENT_TIME 300000 // Longest fix gap treated as straight-line motion (ms)
+#define GEOFENCE_CELL_TABLE_BITS 10   // Cell cover hash table, 2^n entries (5 bytes each)
+#define GEOFENCE_CELL_MAX_LEVEL 6     // Subdivisions below the 4x4 root grid (max 7)
+#define GEOFENCE_GRID_BITS  3         // Candidate grid over the fence set, 2^n x 2^n cells (4 bytes each)
+#define GEOFENCE_SPEED_HYSTERESIS 5   // Overspeed clears this far below the limit (km/h)
+#define GEOFENCE_SPEED_MIN_DURATION 5000 // Time over / back under the limit before alerting (ms)
+#define GEOFENCE_STATE_FLUSH_INTERVAL 600000 // Min spacing of membership writes to NVS (ms)
+
+// Reporting profiles (per fence; the most demanding active profile wins,
+// these values apply when no profiled fence is active)
+#define PROFILE_DEFAULT_UPLINK_S    (TX_INTERVAL_MS / 1000)  // Uplink interval (s)
+#define PROFILE_DEFAULT_GNSS_S      (GEOFENCE_MAX_CHECK_INTERVAL / 1000) // Slowest GNSS rate (s)
+#define PROFILE_DEFAULT_AGGREGATION 1        // Fixes averaged into each position report
+#define PROFILE_MAX_AGGREGATION     16
+#define LORAWAN_DR_ADR              0xFF     // Data-rate preference: leave it to ADR
+
+// Occupancy statistics (per fence, per local day)
+#define OCCUPANCY_REPORT_INTERVAL 3600000 // Day-to-date report spacing (ms)
+#define OCCUPANCY_FINAL_REPEATS 2        // Reports of each closed day, an interval apart
+
+// Trip segmentation (stop/move detection on the filtered GNSS speed)
+#define TRIP_START_SPEED        2.5      // Speed that starts a trip candidate (m/s, 9 km/h)
+#define TRIP_STOP_SPEED         1.0      // Speed under which the asset may be at rest (m/s)
+#define TRIP_STOP_RADIUS        50.0     // Drift allowed at rest; leaving it also starts a trip (m)
+#define TRIP_START_CONFIRM      20000    // Motion needed before a trip is reported (ms)
+#define TRIP_STOP_DURATION      180000   // Rest that ends a trip (ms)
+#define TRIP_LOST_FIX_TIMEOUT   600000   // No fixes for this long closes an open trip (ms)
+#define TRIP_ODOMETER_MIN_STEP  10.0     // Shorter steps (or under HDOP * UERE) are jitter (m)
+#define TRIP_MAX_WAYPOINTS      8        // Waypoints in the trip summary, 0 = none
+#define TRIP_WAYPOINT_SPACING   250.0    // Initial waypoint spacing, doubled as the buffer fills (m)
+#define TRIP_WAYPOINT_UNIT      100      // Waypoint delta resolution (microdegrees, ~11 m)
+#define TRIP_POSITIONS_ALWAYS   0        // Position uplinks as before
+#define TRIP_POSITIONS_MOVING   1        // Position uplinks only during trips
+#define TRIP_POSITIONS_NONE     2        // Trip messages only
+#define TRIP_POSITION_REPORTS   TRIP_POSITIONS_MOVING
+
+// Track buffer (simplified positions for batch upload)
+#define TRACK_BATCH_UPLINKS     false    // Send buffered track batches in place of single positions
+#define TRACK_MAX_ERROR         10.0     // Simplified path stays this close to every fix (m)
+#define TRACK_MAX_POINT_INTERVAL 300000  // Keep a point at least this often (ms)
+#define TRACK_BUFFER_POINTS     128      // Simplified points held for upload
+#define TRACK_BATCH_POINTS      12       // Points per batch uplink
+#define TRACK_DELTA_UNIT        10       // Batch coordinate resolution (microdegrees, ~1.1 m)
+
+// Bulk uploads (track batches)
+#define BULK_PLAIN              0        // One unconfirmed uplink per frame
+#define BULK_FEC                1        // Parity frames per group, no downlinks (src/erasure_coder.h)
+#define BULK_ARQ                2        // Sequence numbers, bitmap acknowledgements (src/selective_repeat.h)
+#define BULK_TRANSFER_MODE      BULK_FEC
+#define BULK_MAX_PAYLOAD        199      // Longest bulk payload (bytes)
+
+// Erasure coding of bulk uploads (BULK_FEC)
+#define FEC_GROUP_SIZE          8        // Source frames per group (max 127)
+#define FEC_GROUP_TIMEOUT       1800000  // A partial group closes this long after its first frame (ms)
+#define FEC_MIN_PARITY          1        // Parity frames per group, at least
+#define FEC_MAX_PARITY          8        //   and at most
+#define FEC_MAX_SYMBOL          (BULK_MAX_PAYLOAD + 1)
+#define FEC_DEFAULT_LOSS        0.10     // Frame loss assumed until the backend reports one
+#define FEC_TARGET_FAILURE      0.01     // Acceptable chance a group cannot be rebuilt
+
+// Selective-repeat ARQ for bulk uploads (BULK_ARQ)
+#define ARQ_MIN_WINDOW          4        // Frames in flight, at least
+#define ARQ_MAX_WINDOW          16       //   and at most (max 32)
+#define ARQ_WINDOW_HEADROOM     3.0      // Window, in uplinks between acknowledgements
+#define ARQ_RETRY_TIMEOUT       600000   // Resend an unacknowledged frame after this long at most (ms)
+
+// Rule engine (bytecode rules over fence membership, speed and time of day)
+#define MAX_RULES           8        // Maximum number of rules
+#define MAX_RULE_CODE       256      // Shared bytecode pool (all rules)
+#define MAX_RULE_SIGNALS    16       // Distinct speed thresholds / time windows
+
+// Tiled fence store on LittleFS (country-scale fence sets, see tools/tile_packer.py)
+#define TILE_DIR            "/tiles" // One file per grid cell: /tiles/<row>_<col>.bin
+#define TILE_SIZE_MICRODEG  100000   // Grid cell size (0.1 deg, ~11 km)
+#define TILE_MAX_BYTES      32768    // Largest tile file accepted
+#define TILE_CACHE_SLOTS    16       // Decoded tiles kept in PSRAM
+#define TILE_CACHE_SLOTS_NO_PSRAM 3  // Fallback when PSRAM is missing (heap)
+#define TILE_PREFETCH_HORIZON 120    // Travel time ahead to prefetch (s)
+#define TILE_PREFETCH_MARGIN 1000    // Fetch the neighbour when this close to a tile edge (m)
+#define TILE_LOADER_STACK   4096     // Loader task stack (bytes)
+#define MAX_TILE_INSIDE     8        // Tiled fences tracked inside at once
+#define TILE_INDEX_CAPACITY 4096     // Tiles the sync tree can track (12 bytes each, PSRAM)
+#define TILE_INDEX_CAPACITY_NO_PSRAM 512 // Fallback when PSRAM is missing (heap)
+#define TILE_SYNC_MAX_REPLIES 8      // Tree nodes queued for uplink per query downlink
+#define TILE_SYNC_MAX_PAYLOAD 51     // Longest tree node uplink (bytes)
 
 // Default geofence example (Santiago, Chile)
 #define DEFAULT_GEOFENCE_LAT    -33.4489
@@ -100,8 +233,14 @@
 // ===============================================================
 #define DISPLAY_UPDATE_RATE     500    // Display update interval (ms)
 #define SCREEN_TIMEOUT          30000  // Screen timeout (ms)
-#define NUM_SCREENS             4      // Number of display screens
+#define DISPLAY_VEXT_OFF        true   // Cut Vext while the panel sleeps (false if anything else runs from it)
+#define DISPLAY_WAKE_STACK      3072   // Wake task stack (bytes)
+#define DISPLAY_WAKE_PRIORITY   2      // Above loop(), so a press wakes the panel mid-exchange
+#define NUM_SCREENS             5      // Number of display screens
 #define BUTTON_DEBOUNCE_TIME    100    // Button debounce (ms)
+#define BUTTON_LONG_PRESS_TIME  1000   // Hold time for a long press (ms)
+#define BUTTON_DOUBLE_CLICK_TIME 350   // Max gap between clicks of a double click (ms)
+#define BUTTON_EVENT_QUEUE_SIZE 8      // Pending gestures before presses are dropped
 
 // ===============================================================
 // POWER MANAGEMENT
@@ -165,5 +304,49 @@
 #define MSG_TYPE_STATUS_UPDATE  0x03
 #define MSG_TYPE_ALERT          0x04
 #define MSG_TYPE_HEARTBEAT      0x05
+#define MSG_TYPE_RULE_EVENT     0x06
+#define MSG_TYPE_TILE_EVENT     0x07
+#define MSG_TYPE_TRIP           0x08
+#define MSG_TYPE_TRACK          0x09
+#define MSG_TYPE_OCCUPANCY      0x0A
+#define MSG_TYPE_GPS_COMPACT    0x0B
+#define MSG_TYPE_BULK           0x0C
+#define MSG_TYPE_BULK_ARQ       0x0D
+#define MSG_TYPE_TILE_SYNC      0x0E
+
+// Alert subtypes (second byte of MSG_TYPE_ALERT)
+#define ALERT_OVERSPEED_START   0x01
+#define ALERT_OVERSPEED_END     0x02
+
+// Trip subtypes (second byte of MSG_TYPE_TRIP)
+#define TRIP_START              0x01
+#define TRIP_END                0x02
+#define TRIP_SUMMARY            0x03
+
+// Tile sync subtypes (second byte of MSG_TYPE_TILE_SYNC)
+#define TILE_SYNC_NODE          0x01
+#define TILE_SYNC_STATUS        0x02
+
+// ===============================================================
+// DOWNLINK COMMANDS (first byte on LORAWAN_CONFIG_PORT)
+// ===============================================================
+#define LORAWAN_CONFIG_PORT     10
+#define CMD_SET_FENCE_SCHEDULE  0x10    // [id][n][n x (dayMask, startSlot, endSlot)]
+#define CMD_SET_UTC_OFFSET      0x11    // [int16 minutes, big-endian]
+#define CMD_SET_RULE            0x12    // [id][length][bytecode]
+#define CMD_DELETE_RULE         0x13    // [id]
+#define CMD_CLEAR_RULES         0x14
+#define CMD_SET_SPEED_LIMIT     0x15    // [id][km/h, 0 = none]
+#define CMD_SET_PROFILE         0x16    // [id][uplink s, u16][gnss s, u16][aggregation][DR, 0xFF = ADR]; [id] alone or uplink 0 clears
+#define CMD_SET_FEC_LOSS        0x17    // [bulk frame loss, 1/256 units]
+#define CMD_BULK_ACK            0x18    // [next seq, u16][bitmap of next + 1..., MSB first]
+#define CMD_TILE_QUERY          0x19    // [n x (depth << 4 | first child, prefix u24)]
+#define CMD_TILE_WRITE          0x1A    // [tile key u32][offset u16][total u16][data]
+#define CMD_TILE_DELETE         0x1B    // [depth][prefix u24]
+
+// What a manager's handleDownlink() made of a config command
+#define CONFIG_UNKNOWN          0       // Not one of its commands, try the next manager
+#define CONFIG_APPLIED          1
+#define CONFIG_REJECTED         2       // Its command, but malformed or refused
 
 #endif // PROJECT_CONFIG_H
\ No newline at end of file
@@ -0,0 +1,183 @@
+#include "button_manager.h"
+
+ButtonManager* ButtonManager::instance = nullptr;
+
+// ===============================================================
+// CONSTRUCTOR & DESTRUCTOR
+// ===============================================================
+
+ButtonManager::ButtonManager() :
+    eventQueue(nullptr),
+    debounceTimer(nullptr),
+    gestureTimer(nullptr),
+    pressHook(nullptr),
+    lastPressEdge(0),
+    pressed(false),
+    longPressFired(false),
+    clickCount(0),
+    gestureStart(0),
+    eventsPosted(0),
+    eventsDropped(0) {
+}
+
+ButtonManager::~ButtonManager() {
+    detachInterrupt(digitalPinToInterrupt(BUTTON_PIN));
+    if (debounceTimer) xTimerDelete(debounceTimer, 0);
+    if (gestureTimer) xTimerDelete(gestureTimer, 0);
+    if (eventQueue) vQueueDelete(eventQueue);
+    if (instance == this) instance = nullptr;
+}
+
+// ===============================================================
+// INITIALIZATION
+// ===============================================================
+
+bool ButtonManager::begin(void (*onPressISR)()) {
+    Serial.println("Button Manager: Initializing...");
+
+    eventQueue = xQueueCreate(BUTTON_EVENT_QUEUE_SIZE, sizeof(ButtonEvent));
+    debounceTimer = xTimerCreate("btn_db", pdMS_TO_TICKS(BUTTON_DEBOUNCE_TIME), pdFALSE,
+                                 this, debounceCallback);
+    gestureTimer = xTimerCreate("btn_gs", pdMS_TO_TICKS(BUTTON_LONG_PRESS_TIME), pdFALSE,
+                                this, gestureCallback);
+
+    if (!eventQueue || !debounceTimer || !gestureTimer) {
+        Serial.println("Button Manager: Failed to create queue/timers!");
+        return false;
+    }
+
+    pressHook = onPressISR;
+    instance = this;
+
+    pinMode(BUTTON_PIN, INPUT_PULLUP);
+    attachInterrupt(digitalPinToInterrupt(BUTTON_PIN), isrHandler, CHANGE);
+
+    Serial.println("Button Manager: Initialization successful!");
+    return true;
+}
+
+// ===============================================================
+// INTERRUPT & TIMER CALLBACKS
+// ===============================================================
+
+void IRAM_ATTR ButtonManager::isrHandler() {
+    if (!instance) {
+        return;
+    }
+
+    if (digitalRead(BUTTON_PIN) == LOW) {
+        instance->lastPressEdge = millis();
+        if (instance->pressHook) {
+            instance->pressHook();
+        }
+    }
+
+    // Every edge restarts the settle period; the level is sampled once
+    // the contact has been quiet for BUTTON_DEBOUNCE_TIME.
+    BaseType_t higherPriorityWoken = pdFALSE;
+    xTimerResetFromISR(instance->debounceTimer, &higherPriorityWoken);
+    if (higherPriorityWoken) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+void ButtonManager::debounceCallback(TimerHandle_t timer) {
+    static_cast<ButtonManager*>(pvTimerGetTimerID(timer))->onDebounced();
+}
+
+void ButtonManager::gestureCallback(TimerHandle_t timer) {
+    static_cast<ButtonManager*>(pvTimerGetTimerID(timer))->onGestureTimeout();
+}
+
+// ===============================================================
+// GESTURE RECOGNITION
+// ===============================================================
+
+void ButtonManager::onDebounced() {
+    bool down = digitalRead(BUTTON_PIN) == LOW;
+    if (down == pressed) {
+        return; // Bounce that settled back to the previous level
+    }
+    pressed = down;
+
+    if (pressed) {
+        if (clickCount == 0) {
+            gestureStart = lastPressEdge;
+        }
+        longPressFired = false;
+        xTimerChangePeriod(gestureTimer, pdMS_TO_TICKS(BUTTON_LONG_PRESS_TIME), 0);
+        return;
+    }
+
+    // Released
+    if (longPressFired) {
+        return; // Already reported while held
+    }
+
+    clickCount++;
+    if (clickCount >= 2) {
+        xTimerStop(gestureTimer, 0);
+        clickCount = 0;
+        postEvent(BUTTON_DOUBLE_CLICK);
+    } else {
+        // Wait to see whether a second click follows
+        xTimerChangePeriod(gestureTimer, pdMS_TO_TICKS(BUTTON_DOUBLE_CLICK_TIME), 0);
+    }
+}
+
+void ButtonManager::onGestureTimeout() {
+    if (pressed) {
+        // Held past the long-press threshold
+        longPressFired = true;
+        clickCount = 0;
+        postEvent(BUTTON_LONG_PRESS);
+    } else if (clickCount == 1) {
+        // Double-click window closed with a single click
+        clickCount = 0;
+        postEvent(BUTTON_SHORT_PRESS);
+    }
+}
+
+void ButtonManager::postEvent(ButtonGesture gesture) {
+    ButtonEvent event;
+    event.gesture = gesture;
+    event.pressedAt = gestureStart;
+
+    if (xQueueSend(eventQueue, &event, 0) == pdPASS) {
+        eventsPosted++;
+    } else {
+        eventsDropped++;
+    }
+}
+
+// ===============================================================
+// EVENT ACCESS
+// ===============================================================
+
+bool ButtonManager::getEvent(ButtonEvent& event) {
+    if (!eventQueue) {
+        return false;
+    }
+
+    return xQueueReceive(eventQueue, &event, 0) == pdTRUE;
+}
+
+uint8_t ButtonManager::pendingEvents() const {
+    if (!eventQueue) {
+        return 0;
+    }
+
+    return uxQueueMessagesWaiting(eventQueue);
+}
+
+// ===============================================================
+// DEBUG & LOGGING
+// ===============================================================
+
+void ButtonManager::printStatistics() {
+    Serial.println("=== BUTTON STATISTICS ===");
+    Serial.print("Gestures posted: ");
+    Serial.println(eventsPosted);
+    Serial.print("Gestures dropped (queue full): ");
+    Serial.println(eventsDropped);
+}
@@ -0,0 +1,77 @@
+#ifndef BUTTON_MANAGER_H
+#define BUTTON_MANAGER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/timers.h>
+#include "../include/project_config.h"
+
+// ===============================================================
+// BUTTON EVENT STRUCTURES
+// ===============================================================
+
+enum ButtonGesture : uint8_t {
+    BUTTON_SHORT_PRESS = 0,
+    BUTTON_LONG_PRESS  = 1,
+    BUTTON_DOUBLE_CLICK = 2
+};
+
+struct ButtonEvent {
+    ButtonGesture gesture;
+    uint32_t pressedAt;    // millis() of the first press of the gesture
+};
+
+// ===============================================================
+// BUTTON MANAGER CLASS
+// ===============================================================
+
+// Edges are taken by a GPIO interrupt that only restarts a debounce
+// timer. Gesture recognition runs in the FreeRTOS timer task and posts
+// finished gestures to a queue, so nothing polls the pin and presses made
+// while loop() is blocked (e.g. in sendReceive) are not lost.
+class ButtonManager {
+private:
+    QueueHandle_t eventQueue;
+    TimerHandle_t debounceTimer;
+    TimerHandle_t gestureTimer;
+    void (*pressHook)();   // Called from the ISR on every falling edge
+    volatile uint32_t lastPressEdge;
+
+    // Gesture state (timer task only)
+    bool pressed;
+    bool longPressFired;
+    uint8_t clickCount;
+    uint32_t gestureStart;
+
+    // Statistics
+    uint32_t eventsPosted;
+    uint32_t eventsDropped;
+
+    // Private methods
+    void onDebounced();
+    void onGestureTimeout();
+    void postEvent(ButtonGesture gesture);
+
+    static ButtonManager* instance;
+    static void IRAM_ATTR isrHandler();
+    static void debounceCallback(TimerHandle_t timer);
+    static void gestureCallback(TimerHandle_t timer);
+
+public:
+    // Constructor & Destructor
+    ButtonManager();
+    ~ButtonManager();
+
+    // Initialization
+    bool begin(void (*onPressISR)() = nullptr);
+
+    // Event access
+    bool getEvent(ButtonEvent& event);
+    uint8_t pendingEvents() const;
+
+    // Debug & Logging
+    void printStatistics();
+};
+
+#endif // BUTTON_MANAGER_H
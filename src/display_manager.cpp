@@ -0,0 +1,385 @@
+#include "display_manager.h"
+
+// ===============================================================
+// CONSTRUCTOR & DESTRUCTOR
+// ===============================================================
+
+DisplayManager::DisplayManager() :
+    display(nullptr),
+    isInitialized(false),
+    panelOn(false),
+    lastActivityTime(0),
+    lastWakeTime(0),
+    screenTimeout(SCREEN_TIMEOUT),
+    wakeTask(nullptr),
+    panelMutex(nullptr),
+    framesFlushed(0),
+    sleepCount(0),
+    sleepStartTime(0),
+    totalSleepTime(0) {
+}
+
+DisplayManager::~DisplayManager() {
+    if (display) delete display;
+}
+
+// ===============================================================
+// INITIALIZATION
+// ===============================================================
+
+bool DisplayManager::begin() {
+    Serial.println("Display Manager: Initializing...");
+
+    display = new SSD1306Wire(OLED_ADDRESS, OLED_SDA_PIN, OLED_SCL_PIN, OLED_GEOMETRY);
+    if (!display || !setupPanel()) {
+        Serial.println("Display Manager: OLED init failed!");
+        return false;
+    }
+    display->clear();
+    display->display();
+
+    // Presses wake the panel from a task of its own: loop() can sit in a
+    // LoRaWAN exchange for seconds
+    panelMutex = xSemaphoreCreateMutex();
+    if (!panelMutex ||
+        xTaskCreate(wakeEntry, "display_wake", DISPLAY_WAKE_STACK, this, DISPLAY_WAKE_PRIORITY, &wakeTask) != pdPASS) {
+        Serial.println("Display Manager: Failed to start the wake task");
+        return false;
+    }
+
+    panelOn = true;
+    lastActivityTime = millis();
+    isInitialized = true;
+
+    Serial.println("Display Manager: Initialization successful!");
+    return true;
+}
+
+bool DisplayManager::setupPanel() {
+    // Hardware reset of the SSD1306
+    pinMode(OLED_RST_PIN, OUTPUT);
+    digitalWrite(OLED_RST_PIN, LOW);
+    delay(20);
+    digitalWrite(OLED_RST_PIN, HIGH);
+    delay(20);
+
+    if (!display->init()) {
+        return false;
+    }
+    display->flipScreenVertically();
+    display->setFont(ArialMT_Plain_10);
+    display->setTextAlignment(TEXT_ALIGN_LEFT);
+    return true;
+}
+
+// ===============================================================
+// FRAME HANDLING
+// ===============================================================
+
+bool DisplayManager::beginFrame() {
+    if (!isInitialized) {
+        return false;
+    }
+
+    // Panel is powered down: skip all render and flush work
+    xSemaphoreTake(panelMutex, portMAX_DELAY);
+    if (!panelOn) {
+        xSemaphoreGive(panelMutex);
+        return false;
+    }
+
+    display->clear();
+    return true;
+}
+
+void DisplayManager::endFrame() {
+    display->display();
+    framesFlushed++;
+    xSemaphoreGive(panelMutex);
+}
+
+void DisplayManager::drawHeader(const char* title) {
+    display->setFont(ArialMT_Plain_10);
+    display->setTextAlignment(TEXT_ALIGN_LEFT);
+    display->drawString(0, 0, title);
+    display->drawHorizontalLine(0, 12, 128);
+}
+
+// ===============================================================
+// SCREENS
+// ===============================================================
+
+void DisplayManager::showInitScreen(const char* projectName, const char* version) {
+    if (!beginFrame()) {
+        return;
+    }
+
+    display->setTextAlignment(TEXT_ALIGN_CENTER);
+    display->drawStringMaxWidth(64, 10, 128, projectName);
+    display->drawString(64, 40, String("v") + version);
+    display->setTextAlignment(TEXT_ALIGN_LEFT);
+
+    endFrame();
+}
+
+void DisplayManager::showStatus(const char* message) {
+    // Status messages are events worth seeing: bring the panel back
+    registerActivity();
+    if (!beginFrame()) {
+        return;
+    }
+
+    drawHeader("Status");
+    display->drawStringMaxWidth(0, 20, 128, message);
+
+    endFrame();
+}
+
+void DisplayManager::showError(const char* message) {
+    registerActivity();
+    if (!beginFrame()) {
+        return;
+    }
+
+    drawHeader("ERROR");
+    display->drawStringMaxWidth(0, 20, 128, message);
+
+    endFrame();
+}
+
+void DisplayManager::showMainScreen(bool joined, bool gpsFix, const GPSData& gps, uint32_t txCounter) {
+    if (!beginFrame()) {
+        return;
+    }
+
+    drawHeader("Geofence Tracker");
+
+    display->drawString(0, 16, String("LoRaWAN: ") + (joined ? "Joined" : "Joining..."));
+    display->drawString(0, 28, String("GPS: ") + (gpsFix ? "Fix" : "No fix"));
+
+    if (gpsFix) {
+        display->drawString(0, 40, String(gps.latitude / 1e6, 5) + ", " + String(gps.longitude / 1e6, 5));
+    }
+
+    display->drawString(0, 52, String("TX: ") + String(txCounter));
+
+    endFrame();
+}
+
+void DisplayManager::showLoRaWANScreen(bool joined, uint32_t txCounter, float successRate, uint32_t nextTxMs) {
+    if (!beginFrame()) {
+        return;
+    }
+
+    drawHeader("LoRaWAN");
+
+    display->drawString(0, 16, String("Status: ") + (joined ? "Joined" : "Not joined"));
+    display->drawString(0, 28, String("TX count: ") + String(txCounter));
+    display->drawString(0, 40, String("Success: ") + String(successRate, 1) + "%");
+    display->drawString(0, 52, String("Next TX: ") + String(nextTxMs / 1000) + "s");
+
+    endFrame();
+}
+
+void DisplayManager::showGPSScreen(const GPSData& gps, uint8_t satellites, float hdop) {
+    if (!beginFrame()) {
+        return;
+    }
+
+    drawHeader("GPS");
+
+    display->drawString(0, 16, String("Lat: ") + String(gps.latitude / 1e6, 6));
+    display->drawString(0, 28, String("Lon: ") + String(gps.longitude / 1e6, 6));
+    display->drawString(0, 40, String("Alt: ") + String(gps.altitude) + "m");
+    display->drawString(0, 52, String("Sats: ") + String(satellites) + "  HDOP: " + String(hdop, 1));
+
+    endFrame();
+}
+
+void DisplayManager::showGeofenceScreen(bool gpsFix, const FenceDistance* nearest, uint8_t nearestCount,
+                                        uint8_t fenceCount, uint8_t armedCount) {
+    if (!beginFrame()) {
+        return;
+    }
+
+    drawHeader("Geofences");
+
+    display->drawString(0, 16, String("Fences: ") + String(fenceCount) + "  Armed: " + String(armedCount));
+
+    if (!gpsFix) {
+        display->drawString(0, 28, "No GPS fix");
+    } else if (nearestCount == 0) {
+        display->drawString(0, 28, "No armed fence");
+    }
+
+    // Nearest boundaries, "in" when the fix is inside the fence
+    for (uint8_t i = 0; gpsFix && i < nearestCount && i < 3; i++) {
+        float d = nearest[i].distance;
+        String line = String("#") + String(nearest[i].id) + (d < 0 ? " in  " : " out ");
+        line += (fabs(d) >= 1000) ? String(fabs(d) / 1000.0, 1) + " km" : String((int)fabs(d)) + " m";
+        display->drawString(0, 28 + i * 12, line);
+    }
+
+    endFrame();
+}
+
+void DisplayManager::showSystemScreen(const char* version, uint32_t uptimeMs, uint32_t freeHeap, uint32_t loopCount) {
+    if (!beginFrame()) {
+        return;
+    }
+
+    drawHeader("System");
+
+    display->drawString(0, 16, String("Version: ") + version);
+    display->drawString(0, 28, String("Uptime: ") + String(uptimeMs / 60000) + " min");
+    display->drawString(0, 40, String("Heap: ") + String(freeHeap / 1024) + " KB");
+    display->drawString(0, 52, String("Loops: ") + String(loopCount));
+
+    endFrame();
+}
+
+// ===============================================================
+// POWER MANAGEMENT
+// ===============================================================
+
+void DisplayManager::update() {
+    if (!isInitialized) {
+        return;
+    }
+
+    xSemaphoreTake(panelMutex, portMAX_DELAY);
+    if (panelOn && screenTimeout > 0 && millis() - lastActivityTime >= screenTimeout) {
+        panelOff();
+    }
+    xSemaphoreGive(panelMutex);
+}
+
+void DisplayManager::registerActivity() {
+    if (!isInitialized) {
+        return;
+    }
+
+    xSemaphoreTake(panelMutex, portMAX_DELAY);
+    lastActivityTime = millis();
+    if (!panelOn) {
+        panelOnAgain();
+    }
+    xSemaphoreGive(panelMutex);
+}
+
+void DisplayManager::sleep() {
+    if (!isInitialized) {
+        return;
+    }
+
+    xSemaphoreTake(panelMutex, portMAX_DELAY);
+    if (panelOn) {
+        panelOff();
+    }
+    xSemaphoreGive(panelMutex);
+}
+
+void DisplayManager::wake() {
+    if (!isInitialized) {
+        return;
+    }
+
+    xSemaphoreTake(panelMutex, portMAX_DELAY);
+    if (!panelOn) {
+        panelOnAgain();
+    }
+    xSemaphoreGive(panelMutex);
+}
+
+void DisplayManager::panelOff() {
+    // DISPLAYOFF puts the SSD1306 in sleep mode; with DISPLAY_VEXT_OFF its
+    // supply is cut as well, GDDRAM and settings included
+    display->displayOff();
+    if (DISPLAY_VEXT_OFF) {
+        digitalWrite(VEXT_PIN, !VEXT_ON_STATE);
+    }
+    panelOn = false;
+    sleepCount++;
+    sleepStartTime = millis();
+
+    Serial.println("Display Manager: Panel off (screen timeout)");
+}
+
+void DisplayManager::panelOnAgain() {
+    if (DISPLAY_VEXT_OFF) {
+        // Set up from scratch; the local buffer still holds the last frame
+        // but init() clears it, so it goes back in before the flush
+        digitalWrite(VEXT_PIN, VEXT_ON_STATE);
+        delay(VEXT_SETTLE_TIME);
+        memcpy(savedFrame, display->buffer, DISPLAY_BUFFER_BYTES);
+        if (!setupPanel()) {
+            Serial.println("Display Manager: OLED init failed on wake!");
+        }
+        memcpy(display->buffer, savedFrame, DISPLAY_BUFFER_BYTES);
+        display->display();
+    } else {
+        // GDDRAM kept the last flushed frame and our buffer matches it
+        display->displayOn();
+    }
+    panelOn = true;
+    lastActivityTime = millis();
+    lastWakeTime = lastActivityTime;
+    totalSleepTime += millis() - sleepStartTime;
+
+    Serial.println("Display Manager: Panel on");
+}
+
+// ===============================================================
+// WAKE TASK
+// ===============================================================
+
+void IRAM_ATTR DisplayManager::requestWake() {
+    if (!wakeTask) {
+        return;
+    }
+
+    BaseType_t higherPriorityWoken = pdFALSE;
+    vTaskNotifyGiveFromISR(wakeTask, &higherPriorityWoken);
+    if (higherPriorityWoken) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+void DisplayManager::wakeEntry(void* arg) {
+    static_cast<DisplayManager*>(arg)->wakeLoop();
+}
+
+void DisplayManager::wakeLoop() {
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        registerActivity();
+    }
+}
+
+// ===============================================================
+// DEBUG & LOGGING
+// ===============================================================
+
+void DisplayManager::printStatistics() {
+    uint32_t asleepMs = totalSleepTime;
+    if (!panelOn) {
+        asleepMs += millis() - sleepStartTime;
+    }
+
+    Serial.println("=== DISPLAY STATISTICS ===");
+    Serial.print("Panel: ");
+    Serial.println(panelOn ? "ON" : "OFF");
+    Serial.print("Frames flushed: ");
+    Serial.println(framesFlushed);
+    // Refreshes that did not happen while the panel was off
+    uint32_t framesAvoided = asleepMs / DISPLAY_UPDATE_RATE;
+    Serial.print("Frames avoided: ");
+    Serial.println(framesAvoided);
+    Serial.print("I2C bytes avoided (max): ");
+    Serial.println(framesAvoided * DISPLAY_FRAME_BYTES);
+    Serial.print("Sleep cycles: ");
+    Serial.println(sleepCount);
+    Serial.print("Time asleep: ");
+    Serial.print(asleepMs / 1000);
+    Serial.println(" s");
+}
@@ -0,0 +1,93 @@
+#ifndef DISPLAY_MANAGER_H
+#define DISPLAY_MANAGER_H
+
+#include <Arduino.h>
+#include <SSD1306Wire.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include "../include/project_config.h"
+#include "lorawan_manager.h"
+#include "geofence_manager.h"
+
+// ===============================================================
+// DISPLAY CONSTANTS
+// ===============================================================
+
+// Bytes pushed over I2C for one full 128x64 frame (GDDRAM + framing)
+#define DISPLAY_FRAME_BYTES     1030
+
+// Local frame buffer, one bit per pixel
+#define DISPLAY_BUFFER_BYTES    (128 * 64 / 8)
+
+// ===============================================================
+// DISPLAY MANAGER CLASS
+// ===============================================================
+
+class DisplayManager {
+private:
+    SSD1306Wire* display;
+
+    // Status tracking
+    bool isInitialized;
+    bool panelOn;
+    uint32_t lastActivityTime;
+    uint32_t lastWakeTime;
+    uint32_t screenTimeout;
+
+    // Wake task, notified from the button ISR; the mutex keeps frames,
+    // sleep and wake apart between it and loop()
+    TaskHandle_t wakeTask;
+    SemaphoreHandle_t panelMutex;
+    uint8_t savedFrame[DISPLAY_BUFFER_BYTES];  // Across init() after Vext was off
+
+    // Statistics
+    uint32_t framesFlushed;
+    uint32_t sleepCount;
+    uint32_t sleepStartTime;
+    uint32_t totalSleepTime;
+
+    // Private methods
+    bool setupPanel();
+    void panelOff();
+    void panelOnAgain();
+    bool beginFrame();
+    void endFrame();
+    void drawHeader(const char* title);
+    static void wakeEntry(void* arg);
+    void wakeLoop();
+
+public:
+    // Constructor & Destructor
+    DisplayManager();
+    ~DisplayManager();
+
+    // Initialization
+    bool begin();
+
+    // Screens
+    void showInitScreen(const char* projectName, const char* version);
+    void showStatus(const char* message);
+    void showError(const char* message);
+    void showMainScreen(bool joined, bool gpsFix, const GPSData& gps, uint32_t txCounter);
+    void showLoRaWANScreen(bool joined, uint32_t txCounter, float successRate, uint32_t nextTxMs);
+    void showGPSScreen(const GPSData& gps, uint8_t satellites, float hdop);
+    void showGeofenceScreen(bool gpsFix, const FenceDistance* nearest, uint8_t nearestCount,
+                            uint8_t fenceCount, uint8_t armedCount);
+    void showSystemScreen(const char* version, uint32_t uptimeMs, uint32_t freeHeap, uint32_t loopCount);
+
+    // Power management
+    void update();
+    void registerActivity();
+    void IRAM_ATTR requestWake();    // From the button ISR
+    void sleep();
+    void wake();
+    bool isOn() const { return panelOn; }
+    uint32_t getLastWakeTime() const { return lastWakeTime; }
+    void setScreenTimeout(uint32_t timeoutMs) { screenTimeout = timeoutMs; }
+
+    // Debug & Logging
+    void printStatistics();
+};
+
+#endif // DISPLAY_MANAGER_H
@@ -0,0 +1,212 @@
+#include "erasure_coder.h"
+
+// GF(2^8) over x^8 + x^4 + x^3 + x^2 + 1, generator 2
+static uint8_t gfExp[510];
+static uint8_t gfLog[256];
+static bool gfReady = false;
+
+static void gfInit() {
+    uint16_t x = 1;
+    for (uint16_t i = 0; i < 255; i++) {
+        gfExp[i] = x;
+        gfExp[i + 255] = x;
+        gfLog[x] = i;
+        x <<= 1;
+        if (x & 0x100) {
+            x ^= 0x11D;
+        }
+    }
+    gfReady = true;
+}
+
+// Cauchy coefficient of source i in parity j
+static uint8_t cauchy(uint8_t j, uint8_t i) {
+    return gfExp[255 - gfLog[(FEC_PARITY_FLAG + j) ^ i]];
+}
+
+// ===============================================================
+// CONSTRUCTOR & DESTRUCTOR
+// ===============================================================
+
+ErasureEncoder::ErasureEncoder() :
+    symbolLength(0),
+    group(0),
+    sources(0),
+    parityCount(0),
+    paritySent(0),
+    closed(false),
+    groupStart(0),
+    lossRate(FEC_DEFAULT_LOSS),
+    totalSources(0),
+    totalParity(0),
+    totalGroups(0) {
+    if (!gfReady) {
+        gfInit();
+    }
+    memset(parity, 0, sizeof(parity));
+}
+
+ErasureEncoder::~ErasureEncoder() {
+}
+
+// ===============================================================
+// SOURCE FRAMES
+// ===============================================================
+
+size_t ErasureEncoder::encodeSource(const uint8_t* payload, size_t length, uint8_t* frame) const {
+    if (closed || length + 1 > FEC_MAX_SYMBOL) {
+        return 0;
+    }
+
+    frame[0] = MSG_TYPE_BULK;
+    frame[1] = group;
+    frame[2] = sources;
+    memcpy(&frame[FEC_SOURCE_HEADER], payload, length);
+    return FEC_SOURCE_HEADER + length;
+}
+
+void ErasureEncoder::addSource(const uint8_t* payload, size_t length, uint32_t now) {
+    if (sources == 0) {
+        groupStart = now;
+    }
+
+    // Fold [length][payload] into every parity row; the zero padding
+    // up to the group's symbol length adds nothing
+    for (uint8_t j = 0; j < FEC_MAX_PARITY; j++) {
+        uint8_t logC = gfLog[cauchy(j, sources)];
+        uint8_t* row = parity[j];
+        if (length) {
+            row[0] ^= gfExp[logC + gfLog[length]];
+        }
+        for (size_t b = 0; b < length; b++) {
+            if (payload[b]) {
+                row[b + 1] ^= gfExp[logC + gfLog[payload[b]]];
+            }
+        }
+    }
+
+    symbolLength = max(symbolLength, (uint16_t)(length + 1));
+    sources++;
+    totalSources++;
+
+    if (sources >= FEC_GROUP_SIZE) {
+        close();
+    }
+}
+
+// ===============================================================
+// PARITY FRAMES
+// ===============================================================
+
+void ErasureEncoder::update(uint32_t now) {
+    if (!closed && sources > 0 && now - groupStart >= FEC_GROUP_TIMEOUT) {
+        close();
+    }
+}
+
+void ErasureEncoder::close() {
+    closed = true;
+    parityCount = parityFor(sources);
+    paritySent = 0;
+    totalGroups++;
+
+    if (parityCount == 0) {
+        startGroup();
+    }
+}
+
+void ErasureEncoder::startGroup() {
+    memset(parity, 0, sizeof(parity));
+    symbolLength = 0;
+    group++;
+    sources = 0;
+    parityCount = 0;
+    paritySent = 0;
+    closed = false;
+}
+
+size_t ErasureEncoder::nextParity(uint8_t* frame) const {
+    if (!isParityPending()) {
+        return 0;
+    }
+
+    frame[0] = MSG_TYPE_BULK;
+    frame[1] = group;
+    frame[2] = FEC_PARITY_FLAG | paritySent;
+    frame[3] = sources;
+    frame[4] = parityCount;
+    memcpy(&frame[FEC_PARITY_HEADER], parity[paritySent], symbolLength);
+    return FEC_PARITY_HEADER + symbolLength;
+}
+
+void ErasureEncoder::parityDone() {
+    if (!isParityPending()) {
+        return;
+    }
+
+    paritySent++;
+    totalParity++;
+    if (paritySent >= parityCount) {
+        startGroup();
+    }
+}
+
+void ErasureEncoder::abandonParity() {
+    if (isParityPending()) {
+        startGroup();
+    }
+}
+
+// ===============================================================
+// OVERHEAD
+// ===============================================================
+
+void ErasureEncoder::setLossRate(float rate) {
+    lossRate = constrain(rate, 0.0f, 0.9f);
+}
+
+uint8_t ErasureEncoder::parityFor(uint8_t k) const {
+    float p = lossRate;
+    if (p <= 0) {
+        return FEC_MIN_PARITY;
+    }
+
+    // Smallest r with P(more than r of k + r frames lost) under the target
+    for (uint8_t r = FEC_MIN_PARITY; r < FEC_MAX_PARITY; r++) {
+        uint8_t n = k + r;
+        float term = pow(1 - p, n);     // P(none lost)
+        float atMostR = term;
+        for (uint8_t lost = 1; lost <= r; lost++) {
+            term *= (float)(n - lost + 1) / lost * p / (1 - p);
+            atMostR += term;
+        }
+        if (1 - atMostR <= FEC_TARGET_FAILURE) {
+            return r;
+        }
+    }
+
+    return FEC_MAX_PARITY;
+}
+
+// ===============================================================
+// DEBUG & LOGGING
+// ===============================================================
+
+void ErasureEncoder::printStatistics() {
+    Serial.println("=== ERASURE CODING STATISTICS ===");
+    Serial.print("Groups / sources / parity: ");
+    Serial.print(totalGroups);
+    Serial.print(" / ");
+    Serial.print(totalSources);
+    Serial.print(" / ");
+    Serial.println(totalParity);
+    Serial.print("Overhead: ");
+    Serial.print(totalSources ? 100.0 * totalParity / totalSources : 0.0, 1);
+    Serial.println("%");
+    Serial.print("Loss rate: ");
+    Serial.print(lossRate * 100, 1);
+    Serial.print("% -> ");
+    Serial.print(parityFor(FEC_GROUP_SIZE));
+    Serial.print(" parity per ");
+    Serial.println(FEC_GROUP_SIZE);
+}
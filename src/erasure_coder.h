@@ -0,0 +1,85 @@
+#ifndef ERASURE_CODER_H
+#define ERASURE_CODER_H
+
+#include <Arduino.h>
+#include "../include/project_config.h"
+
+// ===============================================================
+// BULK FRAME FORMAT (MSG_TYPE_BULK)
+// ===============================================================
+//
+// Bulk uploads go out in coding groups of up to FEC_GROUP_SIZE source
+// frames followed by r parity frames:
+//
+//   source  [MSG_TYPE_BULK][group][index]             [payload]
+//   parity  [MSG_TYPE_BULK][group][0x80 | j][k][r]    [symbol]
+//
+// Each source is coded as the symbol [length][payload], zero-padded to
+// the longest one in the group. Parity j is sum_i C(j, i) * symbol_i over
+// GF(2^8) with the Cauchy matrix C(j, i) = 1 / ((0x80 + j) xor i), so any
+// k of the k + r frames rebuild the group (systematic Reed-Solomon).
+// Parity is accumulated as sources are sent; nothing is buffered.
+//
+// r is the smallest count that keeps the chance of losing more than r of
+// the k + r frames under FEC_TARGET_FAILURE at the loss rate the backend
+// measured (CMD_SET_FEC_LOSS). tools/fec_decoder.py rebuilds the groups.
+
+#define FEC_PARITY_FLAG             0x80
+#define FEC_SOURCE_HEADER           3
+#define FEC_PARITY_HEADER           5
+
+// ===============================================================
+// ERASURE ENCODER CLASS
+// ===============================================================
+
+class ErasureEncoder {
+private:
+    uint8_t parity[FEC_MAX_PARITY][FEC_MAX_SYMBOL];
+    uint16_t symbolLength;      // Longest symbol in the group so far
+    uint8_t group;
+    uint8_t sources;            // Sources sent in the group
+    uint8_t parityCount;        // Parity frames chosen when the group closed
+    uint8_t paritySent;
+    bool closed;
+    uint32_t groupStart;        // millis() of the first source
+    float lossRate;             // Frame loss the backend reports
+
+    // Statistics
+    uint32_t totalSources;
+    uint32_t totalParity;
+    uint32_t totalGroups;
+
+    // Private methods
+    void close();
+    void startGroup();
+
+public:
+    // Constructor & Destructor
+    ErasureEncoder();
+    ~ErasureEncoder();
+
+    // Source frames: build one for `payload`, then add it once it is on
+    // the air. Returns 0 when a group is waiting for its parity or the
+    // payload does not fit a symbol.
+    size_t encodeSource(const uint8_t* payload, size_t length, uint8_t* frame) const;
+    void addSource(const uint8_t* payload, size_t length, uint32_t now);
+
+    // Parity: a group closes when full or FEC_GROUP_TIMEOUT after its
+    // first source. nextParity builds the next frame (0 = none due);
+    // parityDone moves on once it is on the air.
+    void update(uint32_t now);
+    size_t nextParity(uint8_t* frame) const;
+    void parityDone();
+    void abandonParity();       // What is left no longer fits the data rate
+    bool isParityPending() const { return closed && paritySent < parityCount; }
+
+    // Overhead
+    void setLossRate(float rate);
+    float getLossRate() const { return lossRate; }
+    uint8_t parityFor(uint8_t k) const;
+
+    // Debug & Logging
+    void printStatistics();
+};
+
+#endif // ERASURE_CODER_H
@@ -0,0 +1,578 @@
+#include "firmware_update.h"
+#include "lorawan_manager.h"
+#include <LittleFS.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <mbedtls/sha256.h>
+#include <mbedtls/ecdsa.h>
+#include "rom/miniz.h"
+
+#define PATCH_CHUNK         1024     // Base / image bytes per flash access
+#define PATCH_INPUT_SIZE    512      // Compressed bytes per file read
+
+// Keep a new image on trial until confirm(); the Arduino core would
+// otherwise mark it good as soon as it boots
+extern "C" bool verifyRollbackLater() {
+    return true;
+}
+
+// ===============================================================
+// PATCH STREAM
+// ===============================================================
+
+// Inflates the patch body from the block file through the ROM inflater
+class PatchStream {
+private:
+    File& source;
+    tinfl_decompressor* inflator;
+    uint8_t* window;             // Output, and the back-reference window
+    size_t windowPos;
+    size_t outStart;             // Inflated bytes not yet read
+    size_t outEnd;
+    uint8_t input[PATCH_INPUT_SIZE];
+    size_t inputPos;
+    size_t inputLength;
+    bool inputDone;
+    bool finished;
+
+    bool refill() {
+        if (windowPos == TINFL_LZ_DICT_SIZE) {
+            windowPos = 0;
+        }
+        while (!finished) {
+            if (inputPos == inputLength && !inputDone) {
+                int count = source.read(input, sizeof(input));
+                inputLength = count > 0 ? count : 0;
+                inputPos = 0;
+                inputDone = inputLength == 0;
+            }
+
+            size_t inBytes = inputLength - inputPos;
+            size_t outBytes = TINFL_LZ_DICT_SIZE - windowPos;
+            tinfl_status status = tinfl_decompress(inflator, &input[inputPos], &inBytes, window, &window[windowPos],
+                                                   &outBytes, inputDone ? 0 : TINFL_FLAG_HAS_MORE_INPUT);
+            inputPos += inBytes;
+            finished = status <= TINFL_STATUS_DONE || (status == TINFL_STATUS_NEEDS_MORE_INPUT && inputDone);
+            if (outBytes > 0) {
+                outStart = windowPos;
+                outEnd = windowPos + outBytes;
+                windowPos += outBytes;
+                return true;
+            }
+        }
+        return false;
+    }
+
+public:
+    PatchStream(File& file) :
+        source(file),
+        inflator(nullptr),
+        window(nullptr),
+        windowPos(0),
+        outStart(0),
+        outEnd(0),
+        inputPos(0),
+        inputLength(0),
+        inputDone(false),
+        finished(false) {
+    }
+
+    ~PatchStream() {
+        free(inflator);
+        free(window);
+    }
+
+    bool begin() {
+        inflator = (tinfl_decompressor*)malloc(sizeof(tinfl_decompressor));
+        window = (uint8_t*)malloc(TINFL_LZ_DICT_SIZE);
+        if (!inflator || !window) {
+            return false;
+        }
+        tinfl_init(inflator);
+        return true;
+    }
+
+    size_t read(uint8_t* dest, size_t length) {
+        size_t done = 0;
+        while (done < length && (outStart < outEnd || refill())) {
+            size_t chunk = min(length - done, outEnd - outStart);
+            memcpy(&dest[done], &window[outStart], chunk);
+            outStart += chunk;
+            done += chunk;
+        }
+        return done;
+    }
+
+    bool readVarint(uint32_t& value) {
+        value = 0;
+        for (uint8_t shift = 0; shift < 35; shift += 7) {
+            uint8_t byte;
+            if (read(&byte, 1) != 1) {
+                return false;
+            }
+            value |= (uint32_t)(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool readSigned(int32_t& value) {
+        uint32_t zigzag;
+        if (!readVarint(zigzag)) {
+            return false;
+        }
+        value = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+        return true;
+    }
+};
+
+static bool hashPartition(const esp_partition_t* partition, uint32_t size, uint8_t* digest) {
+    uint8_t buffer[PATCH_CHUNK];
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, 0);
+    bool ok = true;
+    for (uint32_t pos = 0; ok && pos < size; pos += PATCH_CHUNK) {
+        size_t chunk = min((uint32_t)PATCH_CHUNK, size - pos);
+        ok = esp_partition_read(partition, pos, buffer, chunk) == ESP_OK;
+        mbedtls_sha256_update(&ctx, buffer, chunk);
+    }
+    mbedtls_sha256_finish(&ctx, digest);
+    mbedtls_sha256_free(&ctx);
+    return ok;
+}
+
+// ===============================================================
+// CONSTRUCTOR & DESTRUCTOR
+// ===============================================================
+
+FirmwareUpdate::FirmwareUpdate() :
+    groupMask(0),
+    applyPending(false),
+    answerLength(0),
+    firmwareId(0),
+    trial(false),
+    trialStart(0),
+    totalFragments(0),
+    totalSessions(0),
+    totalFailures(0),
+    lastError(nullptr) {
+    memset(answer, 0, sizeof(answer));
+}
+
+FirmwareUpdate::~FirmwareUpdate() {
+}
+
+// ===============================================================
+// INITIALIZATION
+// ===============================================================
+
+bool FirmwareUpdate::begin() {
+    Serial.println("Firmware Update: Initializing...");
+
+    const esp_app_desc_t* app = esp_ota_get_app_description();
+    firmwareId = ((uint32_t)app->app_elf_sha256[0] << 24) | ((uint32_t)app->app_elf_sha256[1] << 16) |
+                 ((uint32_t)app->app_elf_sha256[2] << 8) | app->app_elf_sha256[3];
+
+    const esp_partition_t* running = esp_ota_get_running_partition();
+    esp_ota_img_states_t state;
+    trial = running && esp_ota_get_state_partition(running, &state) == ESP_OK && state == ESP_OTA_IMG_PENDING_VERIFY;
+    trialStart = millis();
+
+    Serial.print("Firmware Update: Running ");
+    Serial.print(running ? running->label : "?");
+    Serial.print(", firmware id ");
+    Serial.print(firmwareId, HEX);
+    Serial.println(trial ? " (on trial)" : "");
+
+    if (!esp_ota_get_next_update_partition(nullptr)) {
+        Serial.println("Firmware Update: No OTA slot in the partition table, updates disabled");
+        return false;
+    }
+
+    // A session does not survive a reset; the backend sets it up again
+    if (LittleFS.begin(false)) {
+        LittleFS.remove(FUOTA_BLOCK_FILE);
+    }
+    return true;
+}
+
+void FirmwareUpdate::update(bool answerSent) {
+    if (trial && millis() - trialStart >= FUOTA_CONFIRM_TIMEOUT) {
+        Serial.println("Firmware Update: New image never reached the network, rolling back");
+        delay(100);
+        esp_ota_mark_app_invalid_rollback_and_reboot();
+    }
+
+    // Let the backend hear the block is complete before going quiet
+    if (applyPending && answerLength == 0 && answerSent) {
+        applyPending = false;
+        decoder.end();
+        if (applyPatch()) {
+            Serial.println("Firmware Update: Patch applied, rebooting into the new image");
+            delay(100);
+            ESP.restart();
+        }
+        LittleFS.remove(FUOTA_BLOCK_FILE);
+    }
+}
+
+void FirmwareUpdate::confirm() {
+    if (!trial) {
+        return;
+    }
+    if (esp_ota_mark_app_valid_cancel_rollback() == ESP_OK) {
+        trial = false;
+        Serial.println("Firmware Update: New image confirmed");
+    }
+}
+
+// ===============================================================
+// PACKAGE COMMANDS
+// ===============================================================
+
+bool FirmwareUpdate::handleDownlink(const uint8_t* payload, size_t length, int8_t group) {
+    if (group >= 0 && !(groupMask & (1 << group))) {
+        return false;   // Another session's multicast group
+    }
+    
+    size_t pos = 0;
+    while (pos < length) {
+        size_t used = handleCommand(&payload[pos], length - pos);
+        if (used == 0) {
+            Serial.print("Firmware Update: Bad or unknown command 0x");
+            Serial.println(payload[pos], HEX);
+            return pos > 0;
+        }
+        pos += used;
+    }
+    return length > 0;
+}
+
+size_t FirmwareUpdate::handleCommand(const uint8_t* payload, size_t length) {
+    switch (payload[0]) {
+        case FRAG_PACKAGE_VERSION: {
+            uint8_t version[3] = {FRAG_PACKAGE_VERSION, FRAG_PACKAGE_ID, FRAG_PACKAGE_VERSION_NUMBER};
+            queueAnswer(version, sizeof(version));
+            return 1;
+        }
+
+        case FRAG_SESSION_STATUS:
+            if (length < 2) {
+                return 0;
+            }
+            // Only devices still missing fragments answer, unless all are asked
+            if (((payload[1] >> 1) & 0x03) == 0 && decoder.isActive() &&
+                ((payload[1] & 0x01) || decoder.getMissing() > 0)) {
+                queueStatus();
+            }
+            return 2;
+
+        case FRAG_SESSION_SETUP:
+            if (length < 11) {
+                return 0;
+            }
+            handleSetup(&payload[1]);
+            return 11;
+
+        case FRAG_SESSION_DELETE: {
+            if (length < 2) {
+                return 0;
+            }
+            uint8_t index = payload[1] & 0x03;
+            uint8_t status = index;
+            if (index != 0 || !decoder.isActive()) {
+                status |= FRAG_DELETE_NO_SESSION;
+            } else {
+                decoder.end();
+                applyPending = false;
+                LittleFS.remove(FUOTA_BLOCK_FILE);
+                Serial.println("Firmware Update: Session deleted");
+            }
+            uint8_t reply[2] = {FRAG_SESSION_DELETE, status};
+            queueAnswer(reply, sizeof(reply));
+            return 2;
+        }
+
+        case FRAG_DATA_FRAGMENT:
+            if (length < 3) {
+                return 0;
+            }
+            handleFragment(&payload[1], length - 1);
+            return length;
+
+        default:
+            return 0;
+    }
+}
+
+void FirmwareUpdate::handleSetup(const uint8_t* payload) {
+    uint8_t index = (payload[0] >> 4) & 0x03;
+    uint16_t count = payload[1] | (payload[2] << 8);
+    uint8_t size = payload[3];
+    uint8_t matrix = (payload[4] >> 3) & 0x07;
+    uint32_t wanted = payload[6] | (payload[7] << 8) | ((uint32_t)payload[8] << 16) | ((uint32_t)payload[9] << 24);
+
+    uint8_t status = 0;
+    if (matrix != 0) {
+        status |= FRAG_SETUP_ENCODING_UNSUPPORTED;
+    }
+    if (index != 0) {
+        status |= FRAG_SETUP_INDEX_UNSUPPORTED;
+    }
+    if (wanted != 0 && wanted != firmwareId) {
+        status |= FRAG_SETUP_WRONG_DESCRIPTOR;
+    }
+    // Padding is what the last fragment carries past the block
+    if (status == 0 && (payload[5] >= size || !decoder.begin(FUOTA_BLOCK_FILE, count, size))) {
+        status |= FRAG_SETUP_NOT_ENOUGH_MEMORY;
+    }
+
+    if (status == 0) {
+        groupMask = payload[0] & 0x0F;
+        applyPending = false;
+        totalSessions++;
+        Serial.print("Firmware Update: Session of ");
+        Serial.print(count);
+        Serial.print(" x ");
+        Serial.print(size);
+        Serial.println(" bytes");
+    } else {
+        Serial.print("Firmware Update: Session refused, status 0x");
+        Serial.println(status, HEX);
+    }
+
+    uint8_t reply[2] = {FRAG_SESSION_SETUP, (uint8_t)((index << 6) | status)};
+    queueAnswer(reply, sizeof(reply));
+}
+
+void FirmwareUpdate::handleFragment(const uint8_t* payload, size_t length) {
+    uint16_t indexAndN = payload[0] | (payload[1] << 8);
+    if ((indexAndN >> 14) != 0 || !decoder.isActive() || applyPending || length - 2 != decoder.getFragSize()) {
+        return;
+    }
+
+    totalFragments++;
+    uint8_t result = decoder.addFragment(indexAndN & 0x3FFF, &payload[2]);
+    if (result == FRAG_COMPLETE) {
+        Serial.println("Firmware Update: Block complete");
+        applyPending = true;
+        queueStatus();
+    } else if (result == FRAG_ERROR) {
+        fail("cannot store fragments");
+        decoder.end();
+        LittleFS.remove(FUOTA_BLOCK_FILE);
+    }
+}
+
+// ===============================================================
+// ANSWERS
+// ===============================================================
+
+void FirmwareUpdate::queueAnswer(const uint8_t* data, size_t length) {
+    if (answerLength + length > sizeof(answer)) {
+        Serial.println("Firmware Update: Answer buffer full, dropping an answer");
+        return;
+    }
+    memcpy(&answer[answerLength], data, length);
+    answerLength += length;
+}
+
+void FirmwareUpdate::queueStatus() {
+    uint16_t received = min(decoder.getReceived(), (uint16_t)0x3FFF);
+    uint8_t status[5] = {
+        FRAG_SESSION_STATUS,
+        (uint8_t)(received & 0xFF),
+        (uint8_t)(received >> 8),                  // Index 0 in the top bits
+        (uint8_t)min(decoder.getMissing(), (uint16_t)0xFF),
+        (uint8_t)(decoder.isOverCapacity() ? FRAG_STATUS_NOT_ENOUGH_MEMORY : 0)
+    };
+    queueAnswer(status, sizeof(status));
+}
+
+bool FirmwareUpdate::getAnswer(uint8_t* buffer, size_t& length) {
+    if (answerLength == 0) {
+        return false;
+    }
+    memcpy(buffer, answer, answerLength);
+    length = answerLength;
+    answerLength = 0;
+    return true;
+}
+
+// ===============================================================
+// PATCH
+// ===============================================================
+
+bool FirmwareUpdate::fail(const char* reason) {
+    lastError = reason;
+    totalFailures++;
+    Serial.print("Firmware Update: Update failed, ");
+    Serial.println(reason);
+    return false;
+}
+
+// The release key's signature over the header fields (FUOTA_SIGNING_KEY)
+static bool verifyPatchHeader(const PatchHeader& header) {
+    uint8_t publicKey[65];
+    if (!hexStringToBytes(FUOTA_SIGNING_KEY, publicKey, sizeof(publicKey))) {
+        return false;
+    }
+
+    uint8_t digest[32];
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, 0);
+    mbedtls_sha256_update(&ctx, (const uint8_t*)&header, offsetof(PatchHeader, signature));
+    mbedtls_sha256_finish(&ctx, digest);
+    mbedtls_sha256_free(&ctx);
+
+    mbedtls_ecp_group group;
+    mbedtls_ecp_point key;
+    mbedtls_mpi r, s;
+    mbedtls_ecp_group_init(&group);
+    mbedtls_ecp_point_init(&key);
+    mbedtls_mpi_init(&r);
+    mbedtls_mpi_init(&s);
+    bool ok = mbedtls_ecp_group_load(&group, MBEDTLS_ECP_DP_SECP256R1) == 0 &&
+              mbedtls_ecp_point_read_binary(&group, &key, publicKey, sizeof(publicKey)) == 0 &&
+              mbedtls_mpi_read_binary(&r, header.signature, 32) == 0 &&
+              mbedtls_mpi_read_binary(&s, header.signature + 32, 32) == 0 &&
+              mbedtls_ecdsa_verify(&group, digest, sizeof(digest), &key, &r, &s) == 0;
+    mbedtls_mpi_free(&s);
+    mbedtls_mpi_free(&r);
+    mbedtls_ecp_point_free(&key);
+    mbedtls_ecp_group_free(&group);
+    return ok;
+}
+
+bool FirmwareUpdate::applyPatch() {
+    File file = LittleFS.open(FUOTA_BLOCK_FILE, "r");
+    PatchHeader header;
+    if (!file || file.read((uint8_t*)&header, sizeof(header)) != sizeof(header) || header.magic != FUOTA_PATCH_MAGIC) {
+        return fail("not a patch");
+    }
+    if (!verifyPatchHeader(header)) {
+        return fail("bad signature");
+    }
+
+    const esp_partition_t* running = esp_ota_get_running_partition();
+    const esp_partition_t* target = esp_ota_get_next_update_partition(nullptr);
+    if (!running || !target) {
+        return fail("no OTA slot");
+    }
+    if (header.base_size > running->size || header.image_size > target->size) {
+        return fail("image larger than its slot");
+    }
+
+    uint8_t digest[32];
+    if (header.base_size > 0 &&
+        (!hashPartition(running, header.base_size, digest) || memcmp(digest, header.base_hash, 32) != 0)) {
+        return fail("patch is for another image");
+    }
+
+    PatchStream stream(file);
+    if (!stream.begin()) {
+        return fail("not enough memory to inflate");
+    }
+
+    esp_ota_handle_t handle;
+    if (esp_ota_begin(target, header.image_size, &handle) != ESP_OK) {
+        return fail("cannot open the OTA slot");
+    }
+
+    Serial.print("Firmware Update: Writing ");
+    Serial.print(header.image_size);
+    Serial.print(" bytes to ");
+    Serial.println(target->label);
+
+    uint8_t base[PATCH_CHUNK];
+    uint8_t data[PATCH_CHUNK];
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, 0);
+
+    uint32_t written = 0;
+    int64_t basePos = 0;
+    bool ok = true;
+    while (ok && written < header.image_size) {
+        uint32_t addLength, extraLength;
+        int32_t seek;
+        ok = stream.readVarint(addLength) && stream.readVarint(extraLength) && stream.readSigned(seek) &&
+             (uint64_t)written + addLength + extraLength <= header.image_size &&
+             basePos >= 0 && basePos + addLength <= header.base_size;
+
+        // Base bytes plus the differences
+        while (ok && addLength > 0) {
+            size_t chunk = min(addLength, (uint32_t)PATCH_CHUNK);
+            ok = esp_partition_read(running, basePos, base, chunk) == ESP_OK && stream.read(data, chunk) == chunk;
+            for (size_t i = 0; ok && i < chunk; i++) {
+                data[i] += base[i];
+            }
+            ok = ok && esp_ota_write(handle, data, chunk) == ESP_OK;
+            mbedtls_sha256_update(&ctx, data, chunk);
+            basePos += chunk;
+            addLength -= chunk;
+            written += chunk;
+        }
+
+        // New bytes
+        while (ok && extraLength > 0) {
+            size_t chunk = min(extraLength, (uint32_t)PATCH_CHUNK);
+            ok = stream.read(data, chunk) == chunk && esp_ota_write(handle, data, chunk) == ESP_OK;
+            mbedtls_sha256_update(&ctx, data, chunk);
+            extraLength -= chunk;
+            written += chunk;
+        }
+
+        basePos += seek;
+        yield();
+    }
+    mbedtls_sha256_finish(&ctx, digest);
+    mbedtls_sha256_free(&ctx);
+    file.close();
+
+    if (!ok) {
+        esp_ota_abort(handle);
+        return fail("patch does not apply");
+    }
+    if (memcmp(digest, header.image_hash, 32) != 0) {
+        esp_ota_abort(handle);
+        return fail("image hash mismatch");
+    }
+    if (esp_ota_end(handle) != ESP_OK) {
+        return fail("image rejected by the bootloader checks");
+    }
+    if (esp_ota_set_boot_partition(target) != ESP_OK) {
+        return fail("cannot select the new image");
+    }
+    return true;
+}
+
+// ===============================================================
+// DEBUG & LOGGING
+// ===============================================================
+
+void FirmwareUpdate::printStatistics() {
+    Serial.println("=== FIRMWARE UPDATE STATISTICS ===");
+    Serial.print("Firmware id: ");
+    Serial.print(firmwareId, HEX);
+    Serial.println(trial ? " (on trial)" : "");
+    Serial.print("Sessions / fragments / failures: ");
+    Serial.print(totalSessions);
+    Serial.print(" / ");
+    Serial.print(totalFragments);
+    Serial.print(" / ");
+    Serial.println(totalFailures);
+    if (lastError) {
+        Serial.print("Last failure: ");
+        Serial.println(lastError);
+    }
+    if (decoder.isActive()) {
+        Serial.print("Session groups: 0x");
+        Serial.println(groupMask, HEX);
+        decoder.printStatistics();
+    }
+}
@@ -0,0 +1,149 @@
+#ifndef FIRMWARE_UPDATE_H
+#define FIRMWARE_UPDATE_H
+
+#include <Arduino.h>
+#include "../include/project_config.h"
+#include "frag_decoder.h"
+
+// ===============================================================
+// FRAGMENTATION PACKAGE (FUOTA_FRAG_PORT)
+// ===============================================================
+//
+// Commands and answers follow the LoRaWAN fragmented data block
+// transport (TS004 v1.0.0), little-endian as there. One downlink may
+// carry several commands; their answers go back together.
+//
+//   0x00 PackageVersionReq               -> [0x00][3][1]
+//   0x01 FragSessionStatusReq [param]    -> [0x01][received u14 | index << 14]
+//                                           [missing][status]
+//   0x02 FragSessionSetupReq [index << 4 | groups][fragments u16][size]
+//        [control][padding][descriptor u32]  -> [0x02][status]
+//   0x03 FragSessionDeleteReq [index]    -> [0x03][status]
+//   0x08 DataFragment [n u14 | index << 14][fragment]
+//
+// Fragments come from whichever session the backend uses (unicast
+// Class A downlinks, or a multicast group of the session's mask, see
+// multicast_groups.h). One session at a time
+// (index 0) and fragmentation matrix 0 only. A non-zero descriptor must
+// match the firmware id (leading bytes of the running image's ELF
+// SHA-256, also in status uplinks), so devices on another base turn the
+// session down before storing anything.
+//
+// The block is a delta patch against the running image (tools/fuota.py):
+//
+//   [magic][base size u32][base SHA-256][image size u32][image SHA-256]
+//   [signature 64]
+//   raw deflate of [add n][extra m][seek] ... (varints, seek zigzag):
+//   n bytes added to the base from its cursor, m literal bytes, then
+//   the base cursor moves by seek
+//
+// Base size 0 means a whole image. The signature is ECDSA P-256 (r | s)
+// over the SHA-256 of the header fields before it, by the release key
+// whose public half is FUOTA_SIGNING_KEY; the hashes it covers are only
+// as good as that, so nothing is written before it verifies. The patch
+// is then inflated straight into the inactive OTA slot, checked against
+// the image hash, and booted.
+// The new image runs on trial: it is kept once it has joined and sent
+// an uplink; a reset before that, or no uplink within
+// FUOTA_CONFIRM_TIMEOUT, boots the old one again.
+
+#define FUOTA_BLOCK_FILE            "/fuota.bin"
+#define FUOTA_PATCH_MAGIC           0x32504647UL    // "GFP2"
+#define FUOTA_MAX_ANSWER            16
+
+// Package commands
+#define FRAG_PACKAGE_VERSION        0x00
+#define FRAG_SESSION_STATUS         0x01
+#define FRAG_SESSION_SETUP          0x02
+#define FRAG_SESSION_DELETE         0x03
+#define FRAG_DATA_FRAGMENT          0x08
+
+#define FRAG_PACKAGE_ID             3
+#define FRAG_PACKAGE_VERSION_NUMBER 1
+
+// FragSessionSetupAns status bits
+#define FRAG_SETUP_ENCODING_UNSUPPORTED 0x01
+#define FRAG_SETUP_NOT_ENOUGH_MEMORY    0x02
+#define FRAG_SETUP_INDEX_UNSUPPORTED    0x04
+#define FRAG_SETUP_WRONG_DESCRIPTOR     0x08
+
+// FragSessionStatusAns / FragSessionDeleteAns status bits
+#define FRAG_STATUS_NOT_ENOUGH_MEMORY   0x01
+#define FRAG_DELETE_NO_SESSION          0x04
+
+struct PatchHeader {
+    uint32_t magic;
+    uint32_t base_size;      // 0 = whole image
+    uint8_t base_hash[32];
+    uint32_t image_size;
+    uint8_t image_hash[32];
+    uint8_t signature[64];   // Over the fields above
+};
+
+static_assert(sizeof(PatchHeader) == 140, "Patch header is read in place");
+
+// ===============================================================
+// FIRMWARE UPDATE CLASS
+// ===============================================================
+
+class FirmwareUpdate {
+private:
+    FragDecoder decoder;
+
+    // Session
+    uint8_t groupMask;           // Multicast groups the fragments come on
+    bool applyPending;           // Block complete, patch not applied yet
+
+    // Answers waiting for an uplink
+    uint8_t answer[FUOTA_MAX_ANSWER];
+    uint8_t answerLength;
+
+    // Running image
+    uint32_t firmwareId;
+    bool trial;                  // Booted from an update not yet confirmed
+    uint32_t trialStart;
+
+    // Statistics
+    uint32_t totalFragments;
+    uint32_t totalSessions;
+    uint32_t totalFailures;
+    const char* lastError;
+
+    // Private methods
+    size_t handleCommand(const uint8_t* payload, size_t length);
+    void handleSetup(const uint8_t* payload);
+    void handleFragment(const uint8_t* payload, size_t length);
+    void queueAnswer(const uint8_t* data, size_t length);
+    void queueStatus();
+    bool applyPatch();
+    bool fail(const char* reason);
+
+public:
+    // Constructor & Destructor
+    FirmwareUpdate();
+    ~FirmwareUpdate();
+
+    // Initialization (LittleFS mounted); picks up a trial boot
+    bool begin();
+
+    // Applies a completed patch once its answer is out (answerSent: the
+    // caller holds no answer of ours either; reboots into the new image),
+    // and rolls back a trial image that never got through
+    void update(bool answerSent);
+
+    // Package commands on FUOTA_FRAG_PORT; group is the multicast group
+    // the downlink came on (-1 = unicast). Fragments on a group outside
+    // the session's mask are not ours
+    bool handleDownlink(const uint8_t* payload, size_t length, int8_t group = -1);
+    bool getAnswer(uint8_t* buffer, size_t& length);
+
+    // The running image works (joined and sent an uplink)
+    void confirm();
+    bool isTrial() const { return trial; }
+    uint32_t getFirmwareId() const { return firmwareId; }
+
+    // Debug & Logging
+    void printStatistics();
+};
+
+#endif // FIRMWARE_UPDATE_H
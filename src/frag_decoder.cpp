@@ -0,0 +1,344 @@
+#include "frag_decoder.h"
+#include <LittleFS.h>
+
+static inline bool testBit(const uint8_t* bits, uint16_t i) {
+    return bits[i >> 3] & (0x80 >> (i & 7));
+}
+
+static inline void setBit(uint8_t* bits, uint16_t i) {
+    bits[i >> 3] |= 0x80 >> (i & 7);
+}
+
+static inline void xorBytes(uint8_t* dest, const uint8_t* src, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        dest[i] ^= src[i];
+    }
+}
+
+static uint32_t prbs23(uint32_t x) {
+    uint32_t b0 = x & 1;
+    uint32_t b1 = (x >> 5) & 1;
+    return (x >> 1) + ((b0 ^ b1) << 22);
+}
+
+void fragParityLine(uint16_t n, uint16_t m, uint8_t* line) {
+    memset(line, 0, (m + 7) / 8);
+    uint32_t modulus = (m & (m - 1)) == 0 ? m + 1 : m;
+    uint32_t x = 1 + 1001UL * n;
+    for (uint16_t i = 0; i < m / 2; i++) {
+        uint32_t r;
+        do {
+            x = prbs23(x);
+            r = x % modulus;
+        } while (r >= m);
+        setBit(line, r);
+    }
+}
+
+// ===============================================================
+// CONSTRUCTOR & DESTRUCTOR
+// ===============================================================
+
+FragDecoder::FragDecoder() :
+    fragCount(0),
+    fragSize(0),
+    received(nullptr),
+    line(nullptr),
+    receivedCount(0),
+    missing(nullptr),
+    rows(nullptr),
+    rowData(nullptr),
+    solved(nullptr),
+    maxMissing(0),
+    rowBytes(0),
+    missingCount(0),
+    rank(0),
+    locked(false),
+    state(FRAG_PENDING),
+    totalParity(0),
+    totalDuplicates(0) {
+}
+
+FragDecoder::~FragDecoder() {
+    end();
+}
+
+// ===============================================================
+// SESSION
+// ===============================================================
+
+bool FragDecoder::begin(const char* path, uint16_t count, uint8_t size) {
+    end();
+    if (count == 0 || count > FUOTA_MAX_FRAGMENTS || size == 0 || size > FUOTA_MAX_FRAG_SIZE) {
+        return false;
+    }
+
+    LittleFS.remove(path);
+    size_t bytes = (size_t)count * size;
+    if (LittleFS.totalBytes() - LittleFS.usedBytes() < bytes + FRAG_FS_HEADROOM) {
+        Serial.println("Frag Decoder: Not enough LittleFS space for the block");
+        return false;
+    }
+
+    bool inPsram = psramFound();
+    maxMissing = min((uint16_t)(inPsram ? FUOTA_MAX_MISSING : FUOTA_MAX_MISSING_NO_PSRAM), count);
+    rowBytes = (maxMissing + 7) / 8;
+    size_t mapBytes = (count + 7) / 8;
+    size_t rowsBytes = (size_t)maxMissing * rowBytes;
+    size_t dataBytes = (size_t)maxMissing * size;
+    received = (uint8_t*)calloc(mapBytes, 1);
+    line = (uint8_t*)malloc(mapBytes);
+    missing = (uint16_t*)malloc(maxMissing * sizeof(uint16_t));
+    rows = (uint8_t*)(inPsram ? ps_malloc(rowsBytes) : malloc(rowsBytes));
+    rowData = (uint8_t*)(inPsram ? ps_malloc(dataBytes) : malloc(dataBytes));
+    solved = (uint8_t*)calloc(rowBytes, 1);
+    if (!received || !line || !missing || !rows || !rowData || !solved) {
+        Serial.println("Frag Decoder: Not enough memory for the decoder");
+        release();
+        return false;
+    }
+
+    // Full size up front: a fragment is then one seek and write, and a
+    // full file system shows now rather than halfway through
+    uint8_t zeros[256];
+    memset(zeros, 0, sizeof(zeros));
+    File created = LittleFS.open(path, "w");
+    bool ok = (bool)created;
+    for (size_t left = bytes; ok && left > 0; ) {
+        size_t chunk = min(left, sizeof(zeros));
+        ok = created.write(zeros, chunk) == chunk;
+        left -= chunk;
+    }
+    if (created) {
+        created.close();
+    }
+    if (ok) {
+        file = LittleFS.open(path, "r+");
+    }
+    if (!ok || !file) {
+        Serial.println("Frag Decoder: Cannot create the block file");
+        LittleFS.remove(path);
+        release();
+        return false;
+    }
+
+    fragCount = count;
+    fragSize = size;
+    receivedCount = 0;
+    missingCount = 0;
+    rank = 0;
+    locked = false;
+    state = FRAG_PENDING;
+    totalParity = 0;
+    totalDuplicates = 0;
+    return true;
+}
+
+void FragDecoder::end() {
+    if (file) {
+        file.close();
+    }
+    release();
+    fragCount = 0;
+}
+
+void FragDecoder::release() {
+    free(received);
+    free(line);
+    free(missing);
+    free(rows);
+    free(rowData);
+    free(solved);
+    received = nullptr;
+    line = nullptr;
+    missing = nullptr;
+    rows = nullptr;
+    rowData = nullptr;
+    solved = nullptr;
+}
+
+bool FragDecoder::readFragment(uint16_t index, uint8_t* data) {
+    return file.seek((uint32_t)index * fragSize) && file.read(data, fragSize) == fragSize;
+}
+
+bool FragDecoder::writeFragment(uint16_t index, const uint8_t* data) {
+    return file.seek((uint32_t)index * fragSize) && file.write(data, fragSize) == fragSize;
+}
+
+// ===============================================================
+// FRAGMENTS
+// ===============================================================
+
+uint8_t FragDecoder::addFragment(uint16_t n, const uint8_t* data) {
+    if (fragCount == 0 || state != FRAG_PENDING || n == 0) {
+        return state;
+    }
+
+    uint8_t row[FRAG_ROW_BYTES];
+    uint8_t value[FUOTA_MAX_FRAG_SIZE];
+    memset(row, 0, sizeof(row));
+    memcpy(value, data, fragSize);
+
+    if (n <= fragCount) {
+        uint16_t index = n - 1;
+        if (testBit(received, index)) {
+            totalDuplicates++;
+            return state;
+        }
+        setBit(received, index);
+        receivedCount++;
+
+        if (!locked) {
+            if (!writeFragment(index, data)) {
+                state = FRAG_ERROR;
+            } else if (receivedCount == fragCount) {
+                file.flush();
+                state = FRAG_COMPLETE;
+            }
+            return state;
+        }
+
+        // One of the unknowns after all: an equation with a single term
+        uint16_t column = 0;
+        while (missing[column] != index) {
+            column++;
+        }
+        setBit(row, column);
+    } else {
+        totalParity++;
+        if (!locked && !lock()) {
+            return state;
+        }
+
+        // Known fragments move to the right-hand side, the rest are terms
+        uint8_t known[FUOTA_MAX_FRAG_SIZE];
+        fragParityLine(n - fragCount, fragCount, line);
+        uint16_t column = 0;
+        for (uint16_t i = 0; i < fragCount; i++) {
+            if (line[i >> 3] == 0) {
+                i |= 7;
+                continue;
+            }
+            if (!testBit(line, i)) {
+                continue;
+            }
+            while (column < missingCount && missing[column] < i) {
+                column++;
+            }
+            if (column < missingCount && missing[column] == i) {
+                setBit(row, column);
+            } else if (readFragment(i, known)) {
+                xorBytes(value, known, fragSize);
+            } else {
+                state = FRAG_ERROR;
+                return state;
+            }
+        }
+    }
+
+    if (reduce(row, value) && rank == missingCount) {
+        state = solve() ? FRAG_COMPLETE : FRAG_ERROR;
+    }
+    return state;
+}
+
+bool FragDecoder::lock() {
+    if (fragCount - receivedCount > maxMissing) {
+        return false;
+    }
+
+    missingCount = 0;
+    for (uint16_t i = 0; i < fragCount; i++) {
+        if (!testBit(received, i)) {
+            missing[missingCount++] = i;
+        }
+    }
+    memset(solved, 0, rowBytes);
+    rank = 0;
+    locked = true;
+    return true;
+}
+
+bool FragDecoder::reduce(uint8_t* row, uint8_t* data) {
+    for (uint16_t j = 0; j < missingCount; j++) {
+        if (!testBit(row, j)) {
+            continue;
+        }
+        if (testBit(solved, j)) {
+            // Equations only have terms from their leading column on
+            xorBytes(&row[j >> 3], &rows[j * rowBytes + (j >> 3)], rowBytes - (j >> 3));
+            xorBytes(data, &rowData[j * fragSize], fragSize);
+            continue;
+        }
+        memcpy(&rows[j * rowBytes], row, rowBytes);
+        memcpy(&rowData[j * fragSize], data, fragSize);
+        setBit(solved, j);
+        rank++;
+        return true;
+    }
+
+    // Nothing the earlier fragments did not already say
+    return false;
+}
+
+bool FragDecoder::solve() {
+    // Back substitution, last column first: each value is then final
+    // by the time the equations above it need it
+    for (int32_t j = missingCount - 1; j >= 0; j--) {
+        const uint8_t* row = &rows[j * rowBytes];
+        uint8_t* value = &rowData[j * fragSize];
+        for (uint16_t k = j + 1; k < missingCount; k++) {
+            if (testBit(row, k)) {
+                xorBytes(value, &rowData[k * fragSize], fragSize);
+            }
+        }
+        if (!writeFragment(missing[j], value)) {
+            return false;
+        }
+    }
+
+    file.flush();
+    receivedCount = fragCount;
+    return true;
+}
+
+// ===============================================================
+// PROGRESS
+// ===============================================================
+
+uint16_t FragDecoder::getMissing() const {
+    if (state == FRAG_COMPLETE) {
+        return 0;
+    }
+    return locked ? missingCount - rank : fragCount - receivedCount;
+}
+
+bool FragDecoder::isOverCapacity() const {
+    return !locked && totalParity > 0 && fragCount - receivedCount > maxMissing;
+}
+
+// ===============================================================
+// DEBUG & LOGGING
+// ===============================================================
+
+void FragDecoder::printStatistics() {
+    Serial.println("=== FRAGMENT DECODER STATISTICS ===");
+    if (fragCount == 0) {
+        Serial.println("No session");
+        return;
+    }
+    Serial.print("Fragments: ");
+    Serial.print(receivedCount);
+    Serial.print("/");
+    Serial.print(fragCount);
+    Serial.print(" x ");
+    Serial.print(fragSize);
+    Serial.println(" bytes");
+    Serial.print("Parity / duplicates: ");
+    Serial.print(totalParity);
+    Serial.print(" / ");
+    Serial.println(totalDuplicates);
+    Serial.print("Still missing: ");
+    Serial.print(getMissing());
+    Serial.println(isOverCapacity() ? " (more than parity can rebuild)" : "");
+}
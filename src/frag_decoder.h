@@ -0,0 +1,106 @@
+#ifndef FRAG_DECODER_H
+#define FRAG_DECODER_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include "../include/project_config.h"
+
+// ===============================================================
+// FRAGMENT CODING
+// ===============================================================
+//
+// A data block of M fragments is sent as fragments 1..M followed by
+// parity fragments M + 1, M + 2, ... (LoRaWAN fragmented data block
+// transport, fragmentation matrix 0). Parity fragment M + n is the XOR
+// of the fragments picked by row n of a pseudo-random binary matrix:
+//
+//   x = 1 + 1001 n, then M / 2 times: step x through the PRBS23 until
+//   x mod (M + 1 if M is a power of two, else M) < M; that fragment is in
+//
+// so any set of rows covering the lost fragments rebuilds them. The
+// fragments are written straight into the block file at their offset.
+// When the first parity fragment arrives, the fragments still missing
+// become the unknowns (at most FUOTA_MAX_MISSING, fewer without PSRAM),
+// each later fragment one equation over them, reduced on arrival
+// (Gaussian elimination over GF(2)); the block is complete once they are
+// all solved. Lose more than that and only the plain fragments help.
+
+#define FRAG_ROW_BYTES              ((FUOTA_MAX_MISSING + 7) / 8)   // Largest row
+#define FRAG_FS_HEADROOM            16384           // LittleFS space left to the rest
+
+#define FRAG_PENDING                0
+#define FRAG_COMPLETE               1
+#define FRAG_ERROR                  2
+
+// ===============================================================
+// FRAG DECODER CLASS
+// ===============================================================
+
+class FragDecoder {
+private:
+    File file;
+    uint16_t fragCount;          // M
+    uint8_t fragSize;
+    uint8_t* received;           // Bitmap of fragments in the file
+    uint8_t* line;               // Scratch matrix row, M bits
+    uint16_t receivedCount;
+
+    // Equations over the lost fragments, kept by leading column
+    uint16_t* missing;           // Fragment of each column
+    uint8_t* rows;               // rowBytes per equation
+    uint8_t* rowData;            // fragSize bytes per equation
+    uint8_t* solved;             // Bitmap of columns holding an equation
+    uint16_t maxMissing;         // Unknowns the buffers hold
+    uint16_t rowBytes;
+    uint16_t missingCount;
+    uint16_t rank;
+    bool locked;                 // Unknowns fixed by the first parity fragment
+    uint8_t state;
+
+    // Statistics
+    uint16_t totalParity;
+    uint16_t totalDuplicates;
+
+    // Private methods
+    bool readFragment(uint16_t index, uint8_t* data);
+    bool writeFragment(uint16_t index, const uint8_t* data);
+    bool lock();
+    bool reduce(uint8_t* row, uint8_t* data);
+    bool solve();
+    void release();
+
+public:
+    // Constructor & Destructor
+    FragDecoder();
+    ~FragDecoder();
+
+    // Session: the block file is created full size (zeros) up front.
+    // Returns false when the file or the decoding buffers do not fit.
+    bool begin(const char* path, uint16_t count, uint8_t size);
+    void end();
+
+    // Fragment n (1-based, > M for parity): FRAG_PENDING, FRAG_COMPLETE
+    // once the whole block is in the file, FRAG_ERROR on a storage failure
+    uint8_t addFragment(uint16_t n, const uint8_t* data);
+
+    // Progress
+    bool isActive() const { return fragCount > 0; }
+    uint8_t getState() const { return state; }
+    uint16_t getFragCount() const { return fragCount; }
+    uint8_t getFragSize() const { return fragSize; }
+    uint16_t getReceived() const { return receivedCount; }
+    uint16_t getMissing() const;
+    bool isOverCapacity() const;     // Lost too many for the parity to help
+
+    // Debug & Logging
+    void printStatistics();
+};
+
+// ===============================================================
+// HELPER FUNCTIONS
+// ===============================================================
+
+// Row n (1-based) of the parity matrix for M fragments, M bits MSB-first
+void fragParityLine(uint16_t n, uint16_t m, uint8_t* line);
+
+#endif // FRAG_DECODER_H
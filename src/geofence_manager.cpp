@@ -0,0 +1,2024 @@
+#include "geofence_manager.h"
+#include <Preferences.h>
+
+#define MEMBERSHIP_MAGIC 0x47464D31UL    // "GFM1"
+
+// Not cleared by the startup code, so it outlives software resets; the
+// magic and checksum reject the random content left by a power-on
+RTC_NOINIT_ATTR static MembershipSnapshot rtcSnapshot;
+
+static uint32_t snapshotChecksum(const MembershipSnapshot& snapshot) {
+    // FNV-1a over everything but the checksum itself
+    const uint8_t* bytes = (const uint8_t*)&snapshot;
+    uint32_t hash = 2166136261UL;
+    for (size_t i = 0; i < offsetof(MembershipSnapshot, checksum); i++) {
+        hash = (hash ^ bytes[i]) * 16777619UL;
+    }
+    return hash;
+}
+
+// A stored array must hold exactly `expected` bytes. putBytes() writes
+// nothing for an empty one, so that key may be missing or left over from
+// an earlier set; nothing is read from it then.
+static bool blobMatches(Preferences& prefs, const char* key, size_t expected) {
+    return expected == 0 || prefs.getBytesLength(key) == expected;
+}
+
+static inline uint32_t cellKey(uint8_t index, uint8_t level, uint32_t cellLat, uint32_t cellLon) {
+    return ((uint32_t)index << 27) | ((uint32_t)level << 24) | (cellLat << 12) | cellLon;
+}
+
+static inline uint16_t cellSlot(uint32_t key) {
+    // Fibonacci hashing: top bits of the 32-bit product
+    return (uint32_t)(key * 2654435761U) >> (32 - GEOFENCE_CELL_TABLE_BITS);
+}
+
+// ===============================================================
+// CONSTRUCTOR & DESTRUCTOR
+// ===============================================================
+
+GeofenceManager::GeofenceManager() :
+    fenceCount(0),
+    vertexCount(0),
+    ringCount(0),
+    insideMask(0),
+    knownMask(0),
+    armedMask(0),
+    currentSlot(-1),
+    overspeedMask(0),
+    lastSpeedFix(0),
+    profileMask(0),
+    profileInputs(0),
+    profileDirty(true),
+    profileChanged(false),
+    occupancyMask(0),
+    occupancyDay(-1),
+    finalRepeats(0),
+    alertHead(0),
+    alertCount(0),
+    cellCount(0),
+    coveredMask(0),
+    cellsDirty(true),
+    layoutVersion(0),
+    clockUnixTime(0),
+    clockSyncMillis(0),
+    utcOffsetMinutes(GEOFENCE_UTC_OFFSET_MIN),
+    nearestValid(false),
+    snapshotInside(0),
+    snapshotKnown(0),
+    snapshotLayout(0xFFFF),
+    snapshotDirty(false),
+    lastStateFlush(0),
+    prevFixLat(0),
+    prevFixLon(0),
+    prevFixTime(0),
+    prevFixValid(false),
+    pendingHead(0),
+    pendingCount(0),
+    tileSync(tiles),
+    motionFixTime(0),
+    motionFixInterval(GPS_UPDATE_RATE),
+    motionSpeed(-1),
+    motionCourse(-1),
+    motionHdop(0),
+    lastEvaluatedFix(0),
+    lastSeenFix(0),
+    checkDeadline(0),
+    nextCheckDelay(GEOFENCE_MIN_CHECK_INTERVAL),
+    forceCheck(true),
+    isInitialized(false),
+    lastCheckTime(0),
+    totalChecks(0),
+    totalEvaluations(0),
+    totalEvents(0),
+    totalNearestQueries(0),
+    totalNearestPruned(0),
+    totalFixesSeen(0),
+    totalSweptEvents(0),
+    totalCellHits(0),
+    totalCellFallthroughs(0),
+    totalSpeedAlerts(0),
+    totalProfileSwitches(0) {
+    memset(fences, 0, sizeof(fences));
+    memset(speedLimit, 0, sizeof(speedLimit));
+    memset(profiles, 0, sizeof(profiles));
+    memset(occupancy, 0, sizeof(occupancy));
+    memset(visitStart, 0, sizeof(visitStart));
+    memset(&finalReport, 0, sizeof(finalReport));
+    activeProfile.uplinkInterval = PROFILE_DEFAULT_UPLINK_S;
+    activeProfile.gnssInterval = PROFILE_DEFAULT_GNSS_S;
+    activeProfile.aggregation = PROFILE_DEFAULT_AGGREGATION;
+    activeProfile.dataRate = LORAWAN_DR_ADR;
+    memset(stateSince, 0, sizeof(stateSince));
+    memset(speedState, 0, sizeof(speedState));
+    memset(cellKeys, 0xFF, sizeof(cellKeys));
+    memset(gridCells, 0, sizeof(gridCells));
+    gridOriginLat = 0;
+    gridOriginLon = 0;
+    gridShiftLat = 0;
+    gridShiftLon = 0;
+    memset(scheduleBitmap, 0xFF, sizeof(scheduleBitmap));
+}
+
+GeofenceManager::~GeofenceManager() {
+}
+
+// ===============================================================
+// INITIALIZATION
+// ===============================================================
+
+bool GeofenceManager::begin() {
+    Serial.println("Geofence Manager: Initializing...");
+
+    if (!loadGeofences()) {
+        Serial.println("Geofence Manager: No stored fences, using default");
+        if (!addCircle(0, DEFAULT_GEOFENCE_LAT, DEFAULT_GEOFENCE_LON, DEFAULT_GEOFENCE_RADIUS)) {
+            return false;
+        }
+    }
+
+    updateArmedMask();
+    buildCellCover();
+
+    // Pick up where the last run left off so the first fix only reports
+    // real changes
+    restoreMembership();
+
+    // Optional: runs on the RAM fences alone when no tiles are installed,
+    // until the backend syncs some
+    tiles.begin();
+    tileSync.begin();
+
+    isInitialized = true;
+    Serial.print("Geofence Manager: ");
+    Serial.print(fenceCount);
+    Serial.print(" geofences loaded, ");
+    Serial.print(cellCount);
+    Serial.println(" cover cells");
+    return true;
+}
+
+// ===============================================================
+// FENCE MANAGEMENT
+// ===============================================================
+
+bool GeofenceManager::addCircle(uint8_t id, double lat, double lon, uint32_t radiusMeters) {
+    if (fenceCount >= MAX_GEOFENCES || findIndex(id) >= 0) {
+        return false;
+    }
+
+    Geofence& fence = fences[fenceCount];
+    memset(&fence, 0, sizeof(fence));
+    fence.id = id;
+    fence.type = GEOFENCE_CIRCLE;
+    fence.centerLat = (int32_t)(lat * 1e6);
+    fence.centerLon = (int32_t)(lon * 1e6);
+    fence.radius = radiusMeters;
+
+    updateBoundingBox(fenceCount);
+    fenceCount++;
+    cellsDirty = true;
+    layoutVersion++;
+    currentSlot = -1;
+    updateArmedMask();
+    saveGeofences();
+    return true;
+}
+
+bool GeofenceManager::addPolygon(uint8_t id, const int32_t* lats, const int32_t* lons, uint16_t count) {
+    return addMultiPolygon(id, lats, lons, &count, 1);
+}
+
+bool GeofenceManager::addMultiPolygon(uint8_t id, const int32_t* lats, const int32_t* lons,
+                                      const uint16_t* ringSizes, uint8_t count) {
+    if (fenceCount >= MAX_GEOFENCES || findIndex(id) >= 0 || count == 0) {
+        return false;
+    }
+
+    // Each ring checked against what is left before it is added, so the
+    // total cannot wrap
+    uint32_t total = 0;
+    for (uint8_t r = 0; r < count; r++) {
+        if (ringSizes[r] < 3 || ringSizes[r] > MAX_GEOFENCE_VERTICES - vertexCount - total) {
+            Serial.println("Geofence Manager: Polygon rejected (ring size)");
+            return false;
+        }
+        total += ringSizes[r];
+    }
+
+    if (ringCount + count > MAX_GEOFENCE_RINGS) {
+        Serial.println("Geofence Manager: Polygon rejected (ring pool)");
+        return false;
+    }
+
+    Geofence& fence = fences[fenceCount];
+    memset(&fence, 0, sizeof(fence));
+    fence.id = id;
+    fence.type = GEOFENCE_POLYGON;
+    fence.vertexStart = vertexCount;
+    fence.vertexCount = total;
+    fence.ringStart = ringCount;
+    fence.ringCount = count;
+
+    memcpy(&vertexLat[vertexCount], lats, total * sizeof(int32_t));
+    memcpy(&vertexLon[vertexCount], lons, total * sizeof(int32_t));
+
+    uint16_t start = 0;
+    for (uint8_t r = 0; r < count; r++) {
+        PolygonRing& ring = rings[ringCount + r];
+        ring.start = start;
+        ring.count = ringSizes[r];
+        updateRingBox(ring, &vertexLat[vertexCount], &vertexLon[vertexCount]);
+        start += ringSizes[r];
+    }
+    vertexCount += total;
+    ringCount += count;
+
+    updateBoundingBox(fenceCount);
+    fenceCount++;
+    cellsDirty = true;
+    layoutVersion++;
+    currentSlot = -1;
+    updateArmedMask();
+    saveGeofences();
+    return true;
+}
+
+bool GeofenceManager::removeGeofence(uint8_t id) {
+    int8_t index = findIndex(id);
+    if (index < 0) {
+        return false;
+    }
+
+    removeIndex(index);
+    forceCheck = true;
+    saveGeofences();
+    return true;
+}
+
+void GeofenceManager::clearGeofences() {
+    fenceCount = 0;
+    vertexCount = 0;
+    ringCount = 0;
+    insideMask = 0;
+    knownMask = 0;
+    armedMask = 0;
+    overspeedMask = 0;
+    pendingCount = 0;
+    alertCount = 0;
+    memset(stateSince, 0, sizeof(stateSince));
+    memset(speedLimit, 0, sizeof(speedLimit));
+    memset(speedState, 0, sizeof(speedState));
+    memset(profiles, 0, sizeof(profiles));
+    profileMask = 0;
+    profileDirty = true;
+    memset(occupancy, 0, sizeof(occupancy));
+    memset(visitStart, 0, sizeof(visitStart));
+    occupancyMask = 0;
+    cellsDirty = true;
+    layoutVersion++;
+    memset(scheduleBitmap, 0xFF, sizeof(scheduleBitmap));
+    saveGeofences();
+}
+
+int8_t GeofenceManager::findIndex(uint8_t id) const {
+    for (uint8_t i = 0; i < fenceCount; i++) {
+        if (fences[i].id == id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void GeofenceManager::removeIndex(uint8_t index) {
+    Geofence& fence = fences[index];
+
+    // Compact the shared vertex pool and ring table (ring starts are
+    // relative to the fence, so only the fences' offsets move)
+    if (fence.type == GEOFENCE_POLYGON && fence.vertexCount > 0) {
+        uint16_t start = fence.vertexStart;
+        uint16_t count = fence.vertexCount;
+        uint16_t tail = vertexCount - start - count;
+        memmove(&vertexLat[start], &vertexLat[start + count], tail * sizeof(int32_t));
+        memmove(&vertexLon[start], &vertexLon[start + count], tail * sizeof(int32_t));
+        vertexCount -= count;
+
+        uint8_t firstRing = fence.ringStart;
+        uint8_t removedRings = fence.ringCount;
+        memmove(&rings[firstRing], &rings[firstRing + removedRings],
+                (ringCount - firstRing - removedRings) * sizeof(PolygonRing));
+        ringCount -= removedRings;
+
+        for (uint8_t i = 0; i < fenceCount; i++) {
+            if (fences[i].type == GEOFENCE_POLYGON && fences[i].vertexStart > start) {
+                fences[i].vertexStart -= count;
+                fences[i].ringStart -= removedRings;
+            }
+        }
+    }
+
+    // Shift fences, schedules and state bits down by one
+    uint8_t tailFences = fenceCount - index - 1;
+    memmove(&fences[index], &fences[index + 1], tailFences * sizeof(Geofence));
+    memmove(scheduleBitmap[index], scheduleBitmap[index + 1], tailFences * SCHEDULE_BITMAP_BYTES);
+    memset(scheduleBitmap[fenceCount - 1], 0xFF, SCHEDULE_BITMAP_BYTES);
+    memmove(&speedLimit[index], &speedLimit[index + 1], tailFences);
+    memmove(&speedState[index], &speedState[index + 1], tailFences * sizeof(SpeedState));
+    memmove(&stateSince[index], &stateSince[index + 1], tailFences * sizeof(uint32_t));
+    memmove(&profiles[index], &profiles[index + 1], tailFences * sizeof(ReportProfile));
+    memmove(&occupancy[index], &occupancy[index + 1], tailFences * sizeof(FenceOccupancy));
+    memmove(&visitStart[index], &visitStart[index + 1], tailFences * sizeof(uint32_t));
+    speedLimit[fenceCount - 1] = 0;
+    memset(&profiles[fenceCount - 1], 0, sizeof(ReportProfile));
+    memset(&occupancy[fenceCount - 1], 0, sizeof(FenceOccupancy));
+
+    uint32_t lowBits = (1UL << index) - 1;
+    insideMask = (insideMask & lowBits) | ((insideMask >> 1) & ~lowBits);
+    knownMask = (knownMask & lowBits) | ((knownMask >> 1) & ~lowBits);
+    armedMask = (armedMask & lowBits) | ((armedMask >> 1) & ~lowBits);
+    overspeedMask = (overspeedMask & lowBits) | ((overspeedMask >> 1) & ~lowBits);
+    profileMask = (profileMask & lowBits) | ((profileMask >> 1) & ~lowBits);
+    occupancyMask = (occupancyMask & lowBits) | ((occupancyMask >> 1) & ~lowBits);
+    profileDirty = true;
+
+    fenceCount--;
+    cellsDirty = true;
+    layoutVersion++;
+}
+
+void GeofenceManager::updateBoundingBox(uint8_t index) {
+    Geofence& fence = fences[index];
+
+    if (fence.type == GEOFENCE_CIRCLE) {
+        int32_t dLat = (int32_t)(fence.radius / METERS_PER_MICRODEGREE);
+        float cosLat = cos(fence.centerLat / 1e6 * DEG_TO_RAD);
+        int32_t dLon = (int32_t)(fence.radius / (METERS_PER_MICRODEGREE * max(cosLat, 0.01f)));
+        fence.minLat = fence.centerLat - dLat;
+        fence.maxLat = fence.centerLat + dLat;
+        fence.minLon = fence.centerLon - dLon;
+        fence.maxLon = fence.centerLon + dLon;
+        return;
+    }
+
+    const PolygonRing* ring = &rings[fence.ringStart];
+    fence.minLat = ring[0].minLat;
+    fence.maxLat = ring[0].maxLat;
+    fence.minLon = ring[0].minLon;
+    fence.maxLon = ring[0].maxLon;
+    for (uint8_t r = 1; r < fence.ringCount; r++) {
+        fence.minLat = min(fence.minLat, ring[r].minLat);
+        fence.maxLat = max(fence.maxLat, ring[r].maxLat);
+        fence.minLon = min(fence.minLon, ring[r].minLon);
+        fence.maxLon = max(fence.maxLon, ring[r].maxLon);
+    }
+}
+
+// ===============================================================
+// TRANSITION DETECTION
+// ===============================================================
+
+bool GeofenceManager::checkGeofences(double lat, double lon, GeofenceEvent& event) {
+    if (!isInitialized) {
+        return false;
+    }
+
+    updateArmedMask();
+    updateOccupancy();
+
+    bool due;
+    if (motionFixTime != 0) {
+        // Evaluate the last fix that lands before the predicted deadline
+        if (motionFixTime != lastSeenFix) {
+            lastSeenFix = motionFixTime;
+            totalFixesSeen++;
+
+            // Every fix, due or not, so tiles are in RAM before a check needs them
+            tiles.prefetch((int32_t)(lat * 1e6), (int32_t)(lon * 1e6), motionSpeed, motionCourse);
+        }
+        due = motionFixTime != lastEvaluatedFix &&
+              (forceCheck || (int32_t)(motionFixTime + motionFixInterval - checkDeadline) >= 0);
+    } else {
+        due = forceCheck || millis() - lastCheckTime >= GEOFENCE_CHECK_INTERVAL;
+    }
+
+    if (due) {
+        lastCheckTime = millis();
+        lastEvaluatedFix = motionFixTime;
+        forceCheck = false;
+        totalChecks++;
+
+        if (cellsDirty) {
+            buildCellCover();
+        }
+
+        int32_t fixLat = (int32_t)(lat * 1e6);
+        int32_t fixLon = (int32_t)(lon * 1e6);
+        uint32_t fixTime = (motionFixTime != 0) ? motionFixTime : lastCheckTime;
+
+        // Sweep the straight segment from the previous fix unless the gap
+        // is too long for straight-line motion to mean anything
+        bool swept = prevFixValid && fixTime - prevFixTime <= GEOFENCE_MAX_SEGMENT_TIME;
+        int32_t lat0 = swept ? prevFixLat : fixLat;
+        int32_t lon0 = swept ? prevFixLon : fixLon;
+
+        // Fences whose box meets the segment's box, plus those we may be leaving
+        uint32_t candidates = queryCandidates(min(lat0, fixLat), max(lat0, fixLat),
+                                              min(lon0, fixLon), max(lon0, fixLon));
+        candidates |= insideMask & armedMask;
+
+        // Crossings of this fix, ordered by position along the segment
+        uint8_t crossingFence[MAX_PENDING_EVENTS];
+        bool crossingEnter[MAX_PENDING_EVENTS];
+        float crossingAt[MAX_PENDING_EVENTS];
+        uint8_t crossingCount = 0;
+
+        for (uint8_t i = 0; i < fenceCount; i++) {
+            uint32_t bit = 1UL << i;
+
+            if (!(armedMask & bit)) {
+                continue;
+            }
+
+            bool known = knownMask & bit;
+            bool wasInside = insideMask & bit;
+            bool inside = false;
+
+            if (candidates & bit) {
+                inside = evaluateFence(i, fixLat, fixLon, wasInside, known);
+                totalEvaluations++;
+            }
+
+            insideMask = inside ? (insideMask | bit) : (insideMask & ~bit);
+            knownMask |= bit;
+            if (known && inside != wasInside) {
+                stateSince[i] = isClockSynced() ? getUnixTime() - (millis() - fixTime) / 1000 : 0;
+            }
+
+            if (!known) {
+                continue;
+            }
+
+            float s[MAX_SEGMENT_CROSSINGS];
+            uint8_t n = 0;
+            if (swept && (candidates & bit)) {
+                n = segmentCrossings(i, lat0, lon0, fixLat, fixLon, s);
+            }
+
+            // Each boundary crossing toggles the state. Use them only when
+            // they agree with the endpoint result (hysteresis can disagree).
+            bool consistent = ((n & 1) != 0) == (inside != wasInside);
+            uint8_t firstNew = crossingCount;
+
+            if (n > 0 && consistent) {
+                bool state = wasInside;
+                float dLen = sqrt(sq((fixLat - lat0) * METERS_PER_MICRODEGREE) +
+                                  sq((fixLon - lon0) * METERS_PER_MICRODEGREE * cos(lat0 / 1e6 * DEG_TO_RAD)));
+                for (uint8_t k = 0; k < n && crossingCount < MAX_PENDING_EVENTS; k++) {
+                    // A pass-through shorter than the hysteresis band is noise
+                    bool excursion = (k + 1 < n) && (inside == wasInside || k + 1 < n - 1);
+                    if (excursion && (s[k + 1] - s[k]) * dLen < 2 * GEOFENCE_HYSTERESIS) {
+                        k++;
+                        continue;
+                    }
+                    state = !state;
+                    crossingFence[crossingCount] = i;
+                    crossingEnter[crossingCount] = state;
+                    crossingAt[crossingCount] = s[k];
+                    crossingCount++;
+                }
+                uint8_t emitted = crossingCount - firstNew;
+                if (inside == wasInside) {
+                    totalSweptEvents += emitted;
+                } else if (emitted > 1) {
+                    totalSweptEvents += emitted - 1;
+                }
+            } else if (inside != wasInside && crossingCount < MAX_PENDING_EVENTS) {
+                // A change with no crossing on a swept segment: hysteresis
+                // held the previous fix, already past the boundary
+                crossingFence[crossingCount] = i;
+                crossingEnter[crossingCount] = inside;
+                crossingAt[crossingCount] = (swept && n == 0) ? 0.0 : 1.0;
+                crossingCount++;
+            }
+        }
+
+        // Emit in time order with interpolated position and time
+        for (uint8_t a = 1; a < crossingCount; a++) {
+            for (uint8_t b = a; b > 0 && crossingAt[b - 1] > crossingAt[b]; b--) {
+                float ts = crossingAt[b]; crossingAt[b] = crossingAt[b - 1]; crossingAt[b - 1] = ts;
+                uint8_t tf = crossingFence[b]; crossingFence[b] = crossingFence[b - 1]; crossingFence[b - 1] = tf;
+                bool te = crossingEnter[b]; crossingEnter[b] = crossingEnter[b - 1]; crossingEnter[b - 1] = te;
+            }
+        }
+
+        for (uint8_t c = 0; c < crossingCount; c++) {
+            float f = crossingAt[c];
+            uint32_t t0 = swept ? prevFixTime : fixTime;
+            queueEvent(crossingFence[c], crossingEnter[c],
+                       lat0 + (int32_t)(f * (fixLat - lat0)),
+                       lon0 + (int32_t)(f * (fixLon - lon0)),
+                       t0 + (uint32_t)(f * (fixTime - t0)));
+        }
+
+        prevFixLat = fixLat;
+        prevFixLon = fixLon;
+        prevFixTime = fixTime;
+        prevFixValid = true;
+
+        updateSnapshot();
+
+        // Tiled fences: membership plus clearance to their boundaries and
+        // to the edge of the tile
+        float tileClearance = 1e9;
+        if (tiles.available()) {
+            uint32_t ageSeconds = (millis() - fixTime) / 1000;
+            tiles.evaluate(fixLat, fixLon, isClockSynced() ? getUnixTime() - ageSeconds : fixTime / 1000,
+                           tileClearance);
+        }
+
+        // Cache the nearest boundary for the display and sampling logic
+        nearestValid = nearestFences(fixLat, fixLon, &nearestFence, 1) > 0;
+
+        // Nothing can cross a boundary before the asset covers the clearance
+        float clearance = nearestValid
+            ? fabs(nearestFence.distance) - GEOFENCE_HYSTERESIS - motionHdop * GPS_UERE_METERS
+            : 1e9;
+        clearance = min(clearance, tileClearance - GEOFENCE_HYSTERESIS - motionHdop * GPS_UERE_METERS);
+        nextCheckDelay = predictSafeInterval(clearance, motionSpeed);
+        checkDeadline = (motionFixTime != 0 ? motionFixTime : lastCheckTime) + nextCheckDelay;
+    }
+
+    // Membership or the armed set may have moved; cheap when neither did
+    updateProfile();
+    updateOccupancy();
+
+    if (pendingCount == 0) {
+        return false;
+    }
+
+    event = pendingEvents[pendingHead];
+    pendingHead = (pendingHead + 1) % MAX_PENDING_EVENTS;
+    pendingCount--;
+    return true;
+}
+
+bool GeofenceManager::isInside(uint8_t id) const {
+    int8_t index = findIndex(id);
+    return index >= 0 && ((insideMask >> index) & 1);
+}
+
+uint32_t GeofenceManager::getDwellTime(uint8_t id) const {
+    int8_t index = findIndex(id);
+    if (index < 0 || stateSince[index] == 0 || !isClockSynced()) {
+        return 0;
+    }
+    return getUnixTime() - stateSince[index];
+}
+
+uint32_t GeofenceManager::queryCandidates(int32_t minLat, int32_t maxLat, int32_t minLon, int32_t maxLon) const {
+    // The grid cells the box meets list the fences worth a box test;
+    // disarmed fences never reach the exact geometry
+    uint8_t row0, row1, col0, col1;
+    if (!gridRange(minLat, maxLat, minLon, maxLon, row0, row1, col0, col1)) {
+        return 0;
+    }
+
+    uint32_t listed = 0;
+    for (uint8_t row = row0; row <= row1; row++) {
+        for (uint8_t col = col0; col <= col1; col++) {
+            listed |= gridCells[row * GRID_SIDE + col];
+        }
+    }
+    listed &= armedMask;
+
+    int32_t margin = (int32_t)(GEOFENCE_HYSTERESIS / METERS_PER_MICRODEGREE) + 1;
+    uint32_t result = 0;
+    while (listed) {
+        uint8_t i = __builtin_ctz(listed);
+        listed &= listed - 1;
+
+        const Geofence& fence = fences[i];
+        if (maxLat >= fence.minLat - margin && minLat <= fence.maxLat + margin &&
+            maxLon >= fence.minLon - margin && minLon <= fence.maxLon + margin) {
+            result |= 1UL << i;
+        }
+    }
+
+    return result;
+}
+
+bool GeofenceManager::evaluateFence(uint8_t index, int32_t lat, int32_t lon, bool wasInside, bool known) {
+    const Geofence& fence = fences[index];
+
+    // Interior and exterior cells lie beyond the hysteresis band, so they
+    // agree with the exact test whatever the previous state was
+    CellClass cell = cellsDirty ? CELL_BOUNDARY : lookupCell(index, lat, lon);
+    if (cell != CELL_BOUNDARY) {
+        totalCellHits++;
+        return cell == CELL_INTERIOR;
+    }
+    totalCellFallthroughs++;
+
+    if (fence.type == GEOFENCE_CIRCLE) {
+        float cosLat = cos(fence.centerLat / 1e6 * DEG_TO_RAD);
+        float dy = (lat - fence.centerLat) * METERS_PER_MICRODEGREE;
+        float dx = (lon - fence.centerLon) * METERS_PER_MICRODEGREE * cosLat;
+        float distance = sqrt(dx * dx + dy * dy);
+
+        if (!known) {
+            return distance <= fence.radius;
+        }
+
+        // Leave only past radius + hysteresis, enter only inside radius - hysteresis
+        return wasInside ? distance <= fence.radius + GEOFENCE_HYSTERESIS
+                         : distance < fence.radius - GEOFENCE_HYSTERESIS;
+    }
+
+    bool inside = pointInPolygon(fence, lat, lon);
+    if (known && inside != wasInside && distanceToEdges(fence, lat, lon) < GEOFENCE_HYSTERESIS) {
+        return wasInside;
+    }
+
+    return inside;
+}
+
+bool GeofenceManager::pointInPolygon(const Geofence& fence, int32_t lat, int32_t lon) const {
+    return pointInRings(&rings[fence.ringStart], fence.ringCount,
+                        &vertexLat[fence.vertexStart], &vertexLon[fence.vertexStart], lat, lon);
+}
+
+float GeofenceManager::distanceToEdges(const Geofence& fence, int32_t lat, int32_t lon) const {
+    return distanceToRings(&rings[fence.ringStart], fence.ringCount,
+                           &vertexLat[fence.vertexStart], &vertexLon[fence.vertexStart], lat, lon);
+}
+
+// ===============================================================
+// DISTANCE QUERIES
+// ===============================================================
+
+bool GeofenceManager::getDistanceToBoundary(uint8_t id, double lat, double lon, float& distance) const {
+    int8_t index = findIndex(id);
+    if (index < 0) {
+        return false;
+    }
+
+    distance = signedDistance(index, (int32_t)(lat * 1e6), (int32_t)(lon * 1e6));
+    return true;
+}
+
+uint8_t GeofenceManager::findNearest(double lat, double lon, FenceDistance* results, uint8_t k) {
+    return nearestFences((int32_t)(lat * 1e6), (int32_t)(lon * 1e6), results, k);
+}
+
+bool GeofenceManager::getNearestFence(FenceDistance& nearest) const {
+    if (!nearestValid) {
+        return false;
+    }
+
+    nearest = nearestFence;
+    return true;
+}
+
+uint8_t GeofenceManager::nearestFences(int32_t lat, int32_t lon, FenceDistance* results, uint8_t k) {
+    if (k == 0) {
+        return 0;
+    }
+    totalNearestQueries++;
+
+    // Order armed fences by their bounding-box lower bound
+    uint8_t order[MAX_GEOFENCES];
+    float bound[MAX_GEOFENCES];
+    uint8_t candidates = 0;
+
+    for (uint8_t i = 0; i < fenceCount; i++) {
+        if (!((armedMask >> i) & 1)) {
+            continue;
+        }
+
+        float b = boxLowerBound(fences[i], lat, lon);
+        uint8_t pos = candidates++;
+        while (pos > 0 && bound[pos - 1] > b) {
+            bound[pos] = bound[pos - 1];
+            order[pos] = order[pos - 1];
+            pos--;
+        }
+        bound[pos] = b;
+        order[pos] = i;
+    }
+
+    // Exact distances until the next box cannot beat the k-th result
+    uint8_t found = 0;
+    for (uint8_t c = 0; c < candidates; c++) {
+        if (found == k && bound[c] >= fabs(results[k - 1].distance)) {
+            totalNearestPruned += candidates - c;
+            break;
+        }
+
+        float d = signedDistance(order[c], lat, lon);
+        if (found == k && fabs(d) >= fabs(results[k - 1].distance)) {
+            continue;
+        }
+
+        uint8_t pos = (found < k) ? found++ : k - 1;
+        while (pos > 0 && fabs(results[pos - 1].distance) > fabs(d)) {
+            results[pos] = results[pos - 1];
+            pos--;
+        }
+        results[pos].id = fences[order[c]].id;
+        results[pos].distance = d;
+    }
+
+    return found;
+}
+
+float GeofenceManager::signedDistance(uint8_t index, int32_t lat, int32_t lon) const {
+    const Geofence& fence = fences[index];
+
+    if (fence.type == GEOFENCE_CIRCLE) {
+        float cosLat = cos(fence.centerLat / 1e6 * DEG_TO_RAD);
+        float dy = (lat - fence.centerLat) * METERS_PER_MICRODEGREE;
+        float dx = (lon - fence.centerLon) * METERS_PER_MICRODEGREE * cosLat;
+        return sqrt(dx * dx + dy * dy) - fence.radius;
+    }
+
+    float edge = distanceToEdges(fence, lat, lon);
+    return pointInPolygon(fence, lat, lon) ? -edge : edge;
+}
+
+float GeofenceManager::boxLowerBound(const Geofence& fence, int32_t lat, int32_t lon) const {
+    // Distance to the bounding box never exceeds distance to the boundary
+    // for points outside it; points inside get 0
+    int32_t dLat = max(max(fence.minLat - lat, lat - fence.maxLat), (int32_t)0);
+    int32_t dLon = max(max(fence.minLon - lon, lon - fence.maxLon), (int32_t)0);
+    float dy = dLat * METERS_PER_MICRODEGREE;
+    float dx = dLon * METERS_PER_MICRODEGREE * cos(lat / 1e6 * DEG_TO_RAD);
+    return sqrt(dx * dx + dy * dy);
+}
+
+// ===============================================================
+// REPORTING PROFILES
+// ===============================================================
+
+bool GeofenceManager::setProfile(uint8_t id, const ReportProfile& profile) {
+    int8_t index = findIndex(id);
+    if (index < 0 || profile.uplinkInterval == 0 || profile.gnssInterval == 0) {
+        return false;
+    }
+
+    profiles[index] = profile;
+    profiles[index].aggregation = constrain(profile.aggregation, 1, PROFILE_MAX_AGGREGATION);
+    profileMask |= 1UL << index;
+    profileDirty = true;
+    updateProfile();
+    saveGeofences();
+    return true;
+}
+
+bool GeofenceManager::clearProfile(uint8_t id) {
+    int8_t index = findIndex(id);
+    if (index < 0) {
+        return false;
+    }
+
+    memset(&profiles[index], 0, sizeof(ReportProfile));
+    profileMask &= ~(1UL << index);
+    profileDirty = true;
+    updateProfile();
+    saveGeofences();
+    return true;
+}
+
+bool GeofenceManager::getProfileChange(ReportProfile& profile) {
+    if (!profileChanged) {
+        return false;
+    }
+
+    profileChanged = false;
+    profile = activeProfile;
+    return true;
+}
+
+void GeofenceManager::updateProfile() {
+    // Only the membership bits matter; nothing is re-evaluated, and the
+    // merge runs only when the set of active profiled fences changes
+    uint32_t inputs = insideMask & armedMask & profileMask;
+    if (inputs == profileInputs && !profileDirty) {
+        return;
+    }
+    profileInputs = inputs;
+    profileDirty = false;
+
+    ReportProfile merged;
+    merged.uplinkInterval = PROFILE_DEFAULT_UPLINK_S;
+    merged.gnssInterval = PROFILE_DEFAULT_GNSS_S;
+    merged.aggregation = PROFILE_DEFAULT_AGGREGATION;
+    merged.dataRate = LORAWAN_DR_ADR;
+
+    bool first = true;
+    for (uint32_t bits = inputs; bits; bits &= bits - 1) {
+        const ReportProfile& p = profiles[__builtin_ctz(bits)];
+        if (first || p.uplinkInterval < merged.uplinkInterval) {
+            merged.uplinkInterval = p.uplinkInterval;
+            merged.dataRate = p.dataRate;
+        }
+        merged.gnssInterval = first ? p.gnssInterval : min(merged.gnssInterval, p.gnssInterval);
+        merged.aggregation = first ? p.aggregation : min(merged.aggregation, p.aggregation);
+        first = false;
+    }
+
+    if (memcmp(&merged, &activeProfile, sizeof(ReportProfile)) != 0) {
+        activeProfile = merged;
+        profileChanged = true;
+        totalProfileSwitches++;
+    }
+}
+
+// ===============================================================
+// OCCUPANCY STATISTICS
+// ===============================================================
+
+void GeofenceManager::updateOccupancy() {
+    if (!isClockSynced()) {
+        return;
+    }
+
+    uint32_t now = getUnixTime();
+    int32_t offset = utcOffsetMinutes * 60L;
+    int32_t day = (int32_t)((now + offset) / 86400);
+
+    if (day != occupancyDay) {
+        if (occupancyDay >= 0) {
+            // Close the day at local midnight; open visits carry over
+            // without counting as a new visit
+            uint32_t dayEnd = (occupancyDay + 1) * 86400UL - offset;
+            for (uint32_t bits = occupancyMask; bits; bits &= bits - 1) {
+                uint8_t i = __builtin_ctz(bits);
+                occupancy[i].insideSeconds += dayEnd > visitStart[i] ? dayEnd - visitStart[i] : 0;
+                visitStart[i] = dayEnd;
+            }
+            buildOccupancyReport(finalReport, dayEnd);
+            finalReport.flags = OCCUPANCY_FINAL;
+            finalReport.covered_minutes = 1440;
+            finalRepeats = OCCUPANCY_FINAL_REPEATS;
+        }
+
+        uint32_t dayStart = day * 86400UL - offset;
+        memset(occupancy, 0, sizeof(occupancy));
+        for (uint8_t i = 0; i < MAX_GEOFENCES; i++) {
+            visitStart[i] = dayStart;
+        }
+        occupancyDay = day;
+    }
+
+    // Membership that changed without an event: baseline after boot or
+    // clock sync, disarmed or re-armed fences
+    uint32_t inside = insideMask & armedMask;
+    for (uint32_t bits = inside ^ occupancyMask; bits; bits &= bits - 1) {
+        uint8_t i = __builtin_ctz(bits);
+        if ((inside >> i) & 1) {
+            openVisit(i, now, false);
+        } else {
+            closeVisit(i, now);
+        }
+    }
+}
+
+void GeofenceManager::openVisit(uint8_t index, uint32_t unixTime, bool counted) {
+    occupancyMask |= 1UL << index;
+    visitStart[index] = unixTime;
+    if (!counted || occupancyDay < 0) {
+        return;
+    }
+
+    FenceOccupancy& stats = occupancy[index];
+    uint16_t minute = ((unixTime + utcOffsetMinutes * 60L) % 86400) / 60;
+    if (stats.visits == 0) {
+        stats.firstEntry = minute;
+    }
+    stats.visits++;
+    stats.lastEntry = minute;
+}
+
+void GeofenceManager::closeVisit(uint8_t index, uint32_t unixTime) {
+    occupancyMask &= ~(1UL << index);
+    if (unixTime > visitStart[index]) {
+        occupancy[index].insideSeconds += unixTime - visitStart[index];
+    }
+}
+
+void GeofenceManager::buildOccupancyReport(OccupancyReport& report, uint32_t unixTime) const {
+    report.day = occupancyDay;
+    report.flags = 0;
+    report.covered_minutes = ((unixTime + utcOffsetMinutes * 60L) % 86400) / 60;
+    report.count = 0;
+
+    for (uint8_t i = 0; i < fenceCount; i++) {
+        const FenceOccupancy& stats = occupancy[i];
+        uint32_t seconds = stats.insideSeconds;
+        if (((occupancyMask >> i) & 1) && unixTime > visitStart[i]) {
+            seconds += unixTime - visitStart[i];
+        }
+        if (seconds == 0 && stats.visits == 0) {
+            continue;
+        }
+
+        OccupancyEntry& entry = report.entries[report.count++];
+        entry.fence_id = fences[i].id;
+        entry.visits = min(stats.visits, (uint16_t)255);
+        entry.inside_minutes = min((seconds + 30) / 60, (uint32_t)0xFFFF);
+        entry.first_entry = stats.visits ? stats.firstEntry : 0xFFFF;
+        entry.last_entry = stats.visits ? stats.lastEntry : 0xFFFF;
+    }
+}
+
+bool GeofenceManager::getOccupancyReport(OccupancyReport& report) {
+    // A closed day goes out OCCUPANCY_FINAL_REPEATS times; day-to-date
+    // reports are cumulative, so any one lost is covered by the next
+    if (finalRepeats > 0) {
+        report = finalReport;
+        finalRepeats--;
+        return true;
+    }
+
+    if (occupancyDay < 0) {
+        return false;
+    }
+
+    buildOccupancyReport(report, getUnixTime());
+    return true;
+}
+
+// ===============================================================
+// SPEED LIMITS
+// ===============================================================
+
+bool GeofenceManager::setSpeedLimit(uint8_t id, uint8_t kmh) {
+    int8_t index = findIndex(id);
+    if (index < 0) {
+        return false;
+    }
+
+    speedLimit[index] = kmh;
+    saveGeofences();
+    return true;
+}
+
+void GeofenceManager::updateSpeed(float speedMps, uint32_t fixTime, int32_t lat, int32_t lon) {
+    if (speedMps < 0 || fixTime == lastSpeedFix) {
+        return;
+    }
+    lastSpeedFix = fixTime;
+
+    float kmh = speedMps * 3.6;
+
+    for (uint8_t i = 0; i < fenceCount; i++) {
+        uint32_t bit = 1UL << i;
+        uint8_t limit = speedLimit[i];
+        SpeedState& state = speedState[i];
+        bool active = overspeedMask & bit;
+
+        // Membership comes from the last check; leaving the zone ends an
+        // overspeed straight away
+        if (limit == 0 || !(insideMask & armedMask & bit)) {
+            if (active) {
+                overspeedMask &= ~bit;
+                queueAlert(i, ALERT_OVERSPEED_END, lat, lon, fixTime);
+            }
+            state.overSince = 0;
+            state.underSince = 0;
+            continue;
+        }
+
+        if (!active) {
+            if (kmh <= limit) {
+                state.overSince = 0;
+                continue;
+            }
+            if (state.overSince == 0) {
+                state.overSince = fixTime;
+                state.peak = kmh;
+            }
+            state.peak = max(state.peak, kmh);
+
+            if (fixTime - state.overSince >= GEOFENCE_SPEED_MIN_DURATION) {
+                overspeedMask |= bit;
+                state.underSince = 0;
+                queueAlert(i, ALERT_OVERSPEED_START, lat, lon, fixTime);
+            }
+            continue;
+        }
+
+        state.peak = max(state.peak, kmh);
+
+        // Clear only once clearly and steadily back under the limit
+        if (kmh >= limit - GEOFENCE_SPEED_HYSTERESIS) {
+            state.underSince = 0;
+            continue;
+        }
+        if (state.underSince == 0) {
+            state.underSince = fixTime;
+        }
+        if (fixTime - state.underSince >= GEOFENCE_SPEED_MIN_DURATION) {
+            overspeedMask &= ~bit;
+            queueAlert(i, ALERT_OVERSPEED_END, lat, lon, state.underSince);
+            state.overSince = 0;
+        }
+    }
+}
+
+bool GeofenceManager::getSpeedAlert(SpeedAlert& alert) {
+    if (alertCount == 0) {
+        return false;
+    }
+
+    alert = pendingAlerts[alertHead];
+    alertHead = (alertHead + 1) % MAX_GEOFENCES;
+    alertCount--;
+    return true;
+}
+
+void GeofenceManager::queueAlert(uint8_t index, uint8_t type, int32_t lat, int32_t lon, uint32_t timeMs) {
+    if (alertCount >= MAX_GEOFENCES) {
+        return;
+    }
+
+    const SpeedState& state = speedState[index];
+    SpeedAlert& alert = pendingAlerts[(alertHead + alertCount) % MAX_GEOFENCES];
+    alert.alert_type = type;
+    alert.geofence_id = fences[index].id;
+    alert.speed_limit = speedLimit[index];
+    alert.peak_speed = (uint8_t)min(state.peak + 0.5f, 255.0f);
+    alert.duration = (uint16_t)min((timeMs - state.overSince) / 1000, (uint32_t)0xFFFF);
+    alert.latitude = lat;
+    alert.longitude = lon;
+
+    uint32_t ageSeconds = (millis() - timeMs) / 1000;
+    alert.timestamp = isClockSynced() ? getUnixTime() - ageSeconds : timeMs / 1000;
+    alertCount++;
+    totalSpeedAlerts++;
+}
+
+// ===============================================================
+// CELL COVER
+// ===============================================================
+
+void GeofenceManager::buildCellCover() {
+    memset(cellKeys, 0xFF, sizeof(cellKeys));
+    cellCount = 0;
+    coveredMask = 0;
+    cellsDirty = false;
+    buildGrid();
+
+    if (fenceCount == 0) {
+        return;
+    }
+
+    // Keep the table at most 3/4 full so probes stay short; fences share
+    // it evenly and refine their boundary cells breadth-first
+    uint16_t budget = (CELL_TABLE_SIZE * 3 / 4) / fenceCount;
+    int32_t margin = (int32_t)(GEOFENCE_HYSTERESIS / METERS_PER_MICRODEGREE) + 1;
+    const uint32_t rootCells = 1U << CELL_ROOT_BITS;
+
+    for (uint8_t i = 0; i < fenceCount; i++) {
+        const Geofence& fence = fences[i];
+        uint16_t limit = cellCount + budget;
+
+        cellOriginLat[i] = fence.minLat - margin;
+        cellOriginLon[i] = fence.minLon - margin;
+        uint32_t span = max(fence.maxLat - fence.minLat, fence.maxLon - fence.minLon) + 2 * margin;
+        uint8_t shift = 0;
+        while ((span >> shift) >= rootCells) {
+            shift++;
+        }
+        cellShift[i] = shift;
+
+        bool covered = true;
+        for (uint32_t y = 0; y < rootCells && covered; y++) {
+            for (uint32_t x = 0; x < rootCells && covered; x++) {
+                CellClass cls = classifyCell(i, 0, y, x);
+                if (cls != CELL_EXTERIOR) {
+                    covered = cellCount < limit && insertCell(cellKey(i, 0, y, x), cls);
+                }
+            }
+        }
+        if (!covered) {
+            continue; // Falls back to exact geometry everywhere
+        }
+        coveredMask |= 1UL << i;
+
+        for (uint8_t level = 0; level < GEOFENCE_CELL_MAX_LEVEL && level < shift; level++) {
+            for (uint16_t slot = 0; slot < CELL_TABLE_SIZE && cellCount + 4 <= limit; slot++) {
+                uint32_t key = cellKeys[slot];
+                if (key == CELL_KEY_EMPTY || cellClass[slot] != CELL_BOUNDARY ||
+                    (key >> 27) != i || ((key >> 24) & 0x07) != level) {
+                    continue;
+                }
+
+                uint32_t y = (key >> 12) & 0xFFF;
+                uint32_t x = key & 0xFFF;
+                for (uint8_t q = 0; q < 4; q++) {
+                    uint32_t cy = 2 * y + (q >> 1);
+                    uint32_t cx = 2 * x + (q & 1);
+                    CellClass cls = classifyCell(i, level + 1, cy, cx);
+                    if (cls != CELL_EXTERIOR) {
+                        insertCell(cellKey(i, level + 1, cy, cx), cls);
+                    }
+                }
+                cellClass[slot] = CELL_SPLIT;
+            }
+        }
+    }
+}
+
+void GeofenceManager::buildGrid() {
+    memset(gridCells, 0, sizeof(gridCells));
+    if (fenceCount == 0) {
+        return;
+    }
+
+    // Over the union of the fence boxes, hysteresis included
+    int32_t margin = (int32_t)(GEOFENCE_HYSTERESIS / METERS_PER_MICRODEGREE) + 1;
+    int32_t minLat = fences[0].minLat, maxLat = fences[0].maxLat;
+    int32_t minLon = fences[0].minLon, maxLon = fences[0].maxLon;
+    for (uint8_t i = 1; i < fenceCount; i++) {
+        minLat = min(minLat, fences[i].minLat);
+        maxLat = max(maxLat, fences[i].maxLat);
+        minLon = min(minLon, fences[i].minLon);
+        maxLon = max(maxLon, fences[i].maxLon);
+    }
+
+    gridOriginLat = minLat - margin;
+    gridOriginLon = minLon - margin;
+    uint32_t spanLat = (uint32_t)(maxLat - minLat) + 2 * margin;
+    uint32_t spanLon = (uint32_t)(maxLon - minLon) + 2 * margin;
+    gridShiftLat = 0;
+    while ((spanLat >> gridShiftLat) >= GRID_SIDE) {
+        gridShiftLat++;
+    }
+    gridShiftLon = 0;
+    while ((spanLon >> gridShiftLon) >= GRID_SIDE) {
+        gridShiftLon++;
+    }
+
+    for (uint8_t i = 0; i < fenceCount; i++) {
+        const Geofence& fence = fences[i];
+        uint8_t row0, row1, col0, col1;
+        gridRange(fence.minLat - margin, fence.maxLat + margin, fence.minLon - margin, fence.maxLon + margin,
+                  row0, row1, col0, col1);
+        for (uint8_t row = row0; row <= row1; row++) {
+            for (uint8_t col = col0; col <= col1; col++) {
+                gridCells[row * GRID_SIDE + col] |= 1UL << i;
+            }
+        }
+    }
+}
+
+bool GeofenceManager::gridRange(int32_t minLat, int32_t maxLat, int32_t minLon, int32_t maxLon,
+                                uint8_t& row0, uint8_t& row1, uint8_t& col0, uint8_t& col1) const {
+    // Clamped to the grid; false when the box misses it altogether
+    int64_t lat0 = (int64_t)minLat - gridOriginLat;
+    int64_t lat1 = (int64_t)maxLat - gridOriginLat;
+    int64_t lon0 = (int64_t)minLon - gridOriginLon;
+    int64_t lon1 = (int64_t)maxLon - gridOriginLon;
+    if (lat1 < 0 || lon1 < 0 ||
+        lat0 >= ((int64_t)GRID_SIDE << gridShiftLat) || lon0 >= ((int64_t)GRID_SIDE << gridShiftLon)) {
+        return false;
+    }
+
+    row0 = (lat0 < 0) ? 0 : lat0 >> gridShiftLat;
+    row1 = min(lat1 >> gridShiftLat, (int64_t)GRID_SIDE - 1);
+    col0 = (lon0 < 0) ? 0 : lon0 >> gridShiftLon;
+    col1 = min(lon1 >> gridShiftLon, (int64_t)GRID_SIDE - 1);
+    return true;
+}
+
+CellClass GeofenceManager::classifyCell(uint8_t index, uint8_t level, uint32_t cellLat, uint32_t cellLon) const {
+    uint8_t sizeShift = cellShift[index] - level;
+    int32_t size = 1L << sizeShift;
+    int32_t lat = cellOriginLat[index] + (int32_t)(cellLat << sizeShift) + size / 2;
+    int32_t lon = cellOriginLon[index] + (int32_t)(cellLon << sizeShift) + size / 2;
+
+    // Half-diagonal taken with cos(lat) = 1, plus 1% for the local metric
+    // drifting across large root cells
+    float reach = size * METERS_PER_MICRODEGREE * 0.7072 * 1.01 + GEOFENCE_HYSTERESIS;
+    float distance = signedDistance(index, lat, lon);
+
+    if (distance < -reach) {
+        return CELL_INTERIOR;
+    }
+    if (distance > reach) {
+        return CELL_EXTERIOR;
+    }
+    return CELL_BOUNDARY;
+}
+
+bool GeofenceManager::insertCell(uint32_t key, CellClass cls) {
+    if (cellCount >= CELL_TABLE_SIZE - 1) {
+        return false;
+    }
+
+    uint16_t slot = cellSlot(key);
+    while (cellKeys[slot] != CELL_KEY_EMPTY) {
+        slot = (slot + 1) & (CELL_TABLE_SIZE - 1);
+    }
+
+    cellKeys[slot] = key;
+    cellClass[slot] = cls;
+    cellCount++;
+    return true;
+}
+
+int16_t GeofenceManager::findCell(uint32_t key) const {
+    uint16_t slot = cellSlot(key);
+    while (cellKeys[slot] != CELL_KEY_EMPTY) {
+        if (cellKeys[slot] == key) {
+            return slot;
+        }
+        slot = (slot + 1) & (CELL_TABLE_SIZE - 1);
+    }
+    return -1;
+}
+
+CellClass GeofenceManager::lookupCell(uint8_t index, int32_t lat, int32_t lon) const {
+    if (!((coveredMask >> index) & 1)) {
+        return CELL_BOUNDARY;
+    }
+
+    int32_t dLat = lat - cellOriginLat[index];
+    int32_t dLon = lon - cellOriginLon[index];
+    uint8_t shift = cellShift[index];
+    const int32_t rootCells = 1L << CELL_ROOT_BITS;
+
+    if (dLat < 0 || dLon < 0 || (dLat >> shift) >= rootCells || (dLon >> shift) >= rootCells) {
+        return CELL_BOUNDARY; // Outside the cover, let the exact test decide
+    }
+
+    // Walk down from the root cell; a missing cell is exterior
+    for (uint8_t level = 0; level <= GEOFENCE_CELL_MAX_LEVEL && level <= shift; level++) {
+        int16_t slot = findCell(cellKey(index, level, dLat >> (shift - level), dLon >> (shift - level)));
+        if (slot < 0) {
+            return CELL_EXTERIOR;
+        }
+        if (cellClass[slot] != CELL_SPLIT) {
+            return (CellClass)cellClass[slot];
+        }
+    }
+
+    return CELL_BOUNDARY;
+}
+
+// ===============================================================
+// TIME-TO-BOUNDARY SCHEDULING
+// ===============================================================
+
+void GeofenceManager::updateMotion(uint32_t fixTime, uint32_t fixInterval, float speedMps, float courseDeg,
+                                   float hdop) {
+    motionFixTime = fixTime;
+    motionFixInterval = fixInterval;
+    motionSpeed = speedMps;
+    motionCourse = courseDeg;
+    motionHdop = hdop;
+}
+
+uint8_t GeofenceManager::segmentCrossings(uint8_t index, int32_t lat0, int32_t lon0, int32_t lat1, int32_t lon1,
+                                          float* crossings) const {
+    const Geofence& fence = fences[index];
+
+    // Local meter frame with the segment start at the origin
+    float kx = METERS_PER_MICRODEGREE * cos(lat0 / 1e6 * DEG_TO_RAD);
+    float ky = METERS_PER_MICRODEGREE;
+    float dx = (lon1 - lon0) * kx;
+    float dy = (lat1 - lat0) * ky;
+    float dd = dx * dx + dy * dy;
+    if (dd <= 0) {
+        return 0;
+    }
+
+    uint8_t n = 0;
+
+    if (fence.type == GEOFENCE_CIRCLE) {
+        // |P0 + s*D - C|^2 = r^2
+        float cx = (fence.centerLon - lon0) * kx;
+        float cy = (fence.centerLat - lat0) * ky;
+        float b = -2 * (cx * dx + cy * dy);
+        float c = cx * cx + cy * cy - (float)fence.radius * fence.radius;
+        float disc = b * b - 4 * dd * c;
+        if (disc <= 0) {
+            return 0;
+        }
+        float root = sqrt(disc);
+        float s1 = (-b - root) / (2 * dd);
+        float s2 = (-b + root) / (2 * dd);
+        if (s1 > 0 && s1 <= 1) crossings[n++] = s1;
+        if (s2 > 0 && s2 <= 1) crossings[n++] = s2;
+        return n;
+    }
+
+    int32_t segMinLat = min(lat0, lat1), segMaxLat = max(lat0, lat1);
+    int32_t segMinLon = min(lon0, lon1), segMaxLon = max(lon0, lon1);
+
+    for (uint8_t r = 0; r < fence.ringCount; r++) {
+        const PolygonRing& ring = rings[fence.ringStart + r];
+        if (ring.maxLat < segMinLat || ring.minLat > segMaxLat ||
+            ring.maxLon < segMinLon || ring.minLon > segMaxLon) {
+            continue;
+        }
+
+        const int32_t* ys = &vertexLat[fence.vertexStart + ring.start];
+        const int32_t* xs = &vertexLon[fence.vertexStart + ring.start];
+        uint16_t count = ring.count;
+
+        for (uint16_t i = 0, j = count - 1; i < count && n < MAX_SEGMENT_CROSSINGS; j = i++) {
+            float ex = (xs[j] - lon0) * kx, ey = (ys[j] - lat0) * ky;
+            float qx = (xs[i] - xs[j]) * kx, qy = (ys[i] - ys[j]) * ky;
+            float denom = dx * qy - dy * qx;
+            if (fabs(denom) < 1e-6) {
+                continue; // Parallel to the edge
+            }
+            float s = (ex * qy - ey * qx) / denom;
+            float u = (ex * dy - ey * dx) / denom;
+            if (s > 0 && s <= 1 && u >= 0 && u < 1) {
+                // Keep sorted along the segment
+                uint8_t pos = n++;
+                while (pos > 0 && crossings[pos - 1] > s) {
+                    crossings[pos] = crossings[pos - 1];
+                    pos--;
+                }
+                crossings[pos] = s;
+            }
+        }
+    }
+
+    return n;
+}
+
+void GeofenceManager::queueEvent(uint8_t index, bool entered, int32_t lat, int32_t lon, uint32_t timeMs) {
+    if (pendingCount >= MAX_PENDING_EVENTS) {
+        return;
+    }
+
+    GeofenceEvent& event = pendingEvents[(pendingHead + pendingCount) % MAX_PENDING_EVENTS];
+    event.geofence_id = fences[index].id;
+    event.event_type = entered ? 1 : 0;
+    event.latitude = lat;
+    event.longitude = lon;
+
+    // Interpolated crossing time, back-dated from now
+    uint32_t ageSeconds = (millis() - timeMs) / 1000;
+    event.timestamp = isClockSynced() ? getUnixTime() - ageSeconds : timeMs / 1000;
+
+    if (isClockSynced()) {
+        if (entered && !((occupancyMask >> index) & 1)) {
+            openVisit(index, event.timestamp, true);
+        } else if (!entered && ((occupancyMask >> index) & 1)) {
+            closeVisit(index, event.timestamp);
+        }
+    }
+
+    pendingCount++;
+    totalEvents++;
+}
+
+// ===============================================================
+// ARMING SCHEDULES
+// ===============================================================
+
+bool GeofenceManager::setSchedule(uint8_t id, const ScheduleWindow* windows, uint8_t count) {
+    int8_t index = findIndex(id);
+    if (index < 0 || count > MAX_SCHEDULE_WINDOWS) {
+        return false;
+    }
+
+    if (count == 0) {
+        return clearSchedule(id);
+    }
+
+    compileSchedule(windows, count, scheduleBitmap[index]);
+    fences[index].scheduled = true;
+    currentSlot = -1;
+    updateArmedMask();
+    saveGeofences();
+    return true;
+}
+
+bool GeofenceManager::clearSchedule(uint8_t id) {
+    int8_t index = findIndex(id);
+    if (index < 0) {
+        return false;
+    }
+
+    memset(scheduleBitmap[index], 0xFF, SCHEDULE_BITMAP_BYTES);
+    fences[index].scheduled = false;
+    currentSlot = -1;
+    updateArmedMask();
+    saveGeofences();
+    return true;
+}
+
+void GeofenceManager::updateArmedMask() {
+    int16_t slot = isClockSynced() ? scheduleSlotForTime(getUnixTime(), utcOffsetMinutes) : -1;
+    if (slot == currentSlot && slot >= 0) {
+        return; // Still inside the same 15-minute slot
+    }
+    currentSlot = slot;
+
+    uint32_t armed = 0;
+    for (uint8_t i = 0; i < fenceCount; i++) {
+        // Without a synchronized clock every fence stays armed
+        bool active = !fences[i].scheduled || slot < 0 ||
+                      (scheduleBitmap[i][slot >> 3] >> (slot & 7)) & 1;
+        if (active) {
+            armed |= 1UL << i;
+        }
+    }
+
+    // Any change in the armed set invalidates the predicted deadline
+    if (armed != armedMask) {
+        forceCheck = true;
+    }
+
+    // A disarmed fence forgets its state so re-arming sets a silent baseline
+    uint32_t disarmed = armedMask & ~armed;
+    knownMask &= ~disarmed;
+    insideMask &= ~disarmed;
+    armedMask = armed;
+}
+
+// ===============================================================
+// SYNCHRONIZED CLOCK
+// ===============================================================
+
+void GeofenceManager::syncClock(uint32_t unixTime) {
+    if (unixTime == 0) {
+        return;
+    }
+
+    clockUnixTime = unixTime;
+    clockSyncMillis = millis();
+    if (clockSyncMillis == 0) {
+        clockSyncMillis = 1;
+    }
+}
+
+uint32_t GeofenceManager::getUnixTime() const {
+    if (!isClockSynced()) {
+        return 0;
+    }
+
+    return clockUnixTime + (millis() - clockSyncMillis) / 1000;
+}
+
+bool GeofenceManager::setUtcOffset(int16_t minutes) {
+    if (minutes < UTC_OFFSET_WESTMOST || minutes > UTC_OFFSET_EASTMOST) {
+        return false;
+    }
+
+    utcOffsetMinutes = minutes;
+    currentSlot = -1;
+    updateArmedMask();
+    saveGeofences();
+    return true;
+}
+
+// ===============================================================
+// DOWNLINK HANDLING
+// ===============================================================
+
+uint8_t GeofenceManager::handleDownlink(const uint8_t* payload, size_t length) {
+    if (length < 1) {
+        return CONFIG_UNKNOWN;
+    }
+
+    switch (payload[0]) {
+        case CMD_SET_FENCE_SCHEDULE: {
+            if (length < 3) {
+                Serial.println("Geofence Manager: Malformed schedule downlink");
+                return CONFIG_REJECTED;
+            }
+
+            uint8_t id = payload[1];
+            uint8_t count = payload[2];
+            if (count > MAX_SCHEDULE_WINDOWS || length < 3 + count * 3U) {
+                Serial.println("Geofence Manager: Malformed schedule downlink");
+                return CONFIG_REJECTED;
+            }
+
+            ScheduleWindow windows[MAX_SCHEDULE_WINDOWS];
+            for (uint8_t w = 0; w < count; w++) {
+                windows[w].dayMask = payload[3 + w * 3];
+                windows[w].startSlot = payload[4 + w * 3];
+                windows[w].endSlot = payload[5 + w * 3];
+            }
+
+            bool ok = setSchedule(id, windows, count);
+            Serial.print("Geofence Manager: Schedule for fence ");
+            Serial.print(id);
+            Serial.println(ok ? " updated" : " rejected");
+            return ok ? CONFIG_APPLIED : CONFIG_REJECTED;
+        }
+
+        case CMD_SET_SPEED_LIMIT: {
+            if (length < 3) {
+                Serial.println("Geofence Manager: Malformed speed limit downlink");
+                return CONFIG_REJECTED;
+            }
+
+            bool ok = setSpeedLimit(payload[1], payload[2]);
+            Serial.print("Geofence Manager: Speed limit for fence ");
+            Serial.print(payload[1]);
+            Serial.println(ok ? " updated" : " rejected");
+            return ok ? CONFIG_APPLIED : CONFIG_REJECTED;
+        }
+
+        case CMD_SET_PROFILE: {
+            // The fence id alone clears; anything else needs every field
+            if (length < 2 || (length > 2 && length < 8)) {
+                Serial.println("Geofence Manager: Malformed profile downlink");
+                return CONFIG_REJECTED;
+            }
+
+            bool ok;
+            uint16_t uplink = (length >= 8) ? (payload[2] << 8) | payload[3] : 0;
+            if (uplink == 0) {
+                ok = clearProfile(payload[1]);
+            } else {
+                ReportProfile profile;
+                profile.uplinkInterval = uplink;
+                profile.gnssInterval = (payload[4] << 8) | payload[5];
+                profile.aggregation = payload[6];
+                profile.dataRate = payload[7];
+                ok = setProfile(payload[1], profile);
+            }
+            Serial.print("Geofence Manager: Profile for fence ");
+            Serial.print(payload[1]);
+            Serial.println(ok ? " updated" : " rejected");
+            return ok ? CONFIG_APPLIED : CONFIG_REJECTED;
+        }
+
+        case CMD_SET_UTC_OFFSET: {
+            if (length < 3) {
+                Serial.println("Geofence Manager: Malformed UTC offset downlink");
+                return CONFIG_REJECTED;
+            }
+
+            int16_t minutes = (int16_t)((payload[1] << 8) | payload[2]);
+            if (!setUtcOffset(minutes)) {
+                Serial.print("Geofence Manager: UTC offset out of range: ");
+                Serial.println(minutes);
+                return CONFIG_REJECTED;
+            }
+            return CONFIG_APPLIED;
+        }
+
+        case CMD_TILE_QUERY:
+            return tileSync.handleQuery(&payload[1], length - 1) ? CONFIG_APPLIED : CONFIG_REJECTED;
+
+        case CMD_TILE_WRITE: {
+            bool ok = tileSync.handleWrite(&payload[1], length - 1);
+
+            // First tile on a device that had none: start paging them in
+            if (ok && !tiles.available() && tileSync.getTileCount() > 0) {
+                tiles.begin();
+            }
+            return ok ? CONFIG_APPLIED : CONFIG_REJECTED;
+        }
+
+        case CMD_TILE_DELETE:
+            return tileSync.handleDelete(&payload[1], length - 1) ? CONFIG_APPLIED : CONFIG_REJECTED;
+
+        default:
+            return CONFIG_UNKNOWN;
+    }
+}
+
+// ===============================================================
+// PERSISTENCE
+// ===============================================================
+
+void GeofenceManager::saveGeofences() {
+    Preferences prefs;
+    if (prefs.begin(STORAGE_NAMESPACE, false)) {
+        prefs.putUChar("gf_count", fenceCount);
+        prefs.putBytes(KEY_GEOFENCES, fences, fenceCount * sizeof(Geofence));
+        prefs.putUShort("gf_vcount", vertexCount);
+        prefs.putBytes("gf_vlat", vertexLat, vertexCount * sizeof(int32_t));
+        prefs.putBytes("gf_vlon", vertexLon, vertexCount * sizeof(int32_t));
+        prefs.putUChar("gf_rcount", ringCount);
+        prefs.putBytes("gf_rings", rings, ringCount * sizeof(PolygonRing));
+        prefs.putBytes("gf_sched", scheduleBitmap, fenceCount * SCHEDULE_BITMAP_BYTES);
+        prefs.putBytes("gf_speed", speedLimit, fenceCount);
+        prefs.putBytes("gf_profile", profiles, fenceCount * sizeof(ReportProfile));
+        prefs.putShort("gf_utc", utcOffsetMinutes);
+        prefs.end();
+    }
+}
+
+bool GeofenceManager::loadGeofences() {
+    Preferences prefs;
+    if (!prefs.begin(STORAGE_NAMESPACE, true)) {
+        return false;
+    }
+
+    // Kept even when the fences are not
+    int16_t offset = prefs.getShort("gf_utc", utcOffsetMinutes);
+    if (offset >= UTC_OFFSET_WESTMOST && offset <= UTC_OFFSET_EASTMOST) {
+        utcOffsetMinutes = offset;
+    }
+
+    // Speed limits and profiles came later, and may be missing
+    uint8_t count = prefs.getUChar("gf_count", 0);
+    uint16_t vertices = prefs.getUShort("gf_vcount", 0);
+    uint8_t ringTotal = prefs.getUChar("gf_rcount", 0);
+    size_t speedLength = prefs.getBytesLength("gf_speed");
+    size_t profileLength = prefs.getBytesLength("gf_profile");
+    if (count == 0 || count > MAX_GEOFENCES || vertices > MAX_GEOFENCE_VERTICES ||
+        ringTotal > MAX_GEOFENCE_RINGS ||
+        !blobMatches(prefs, KEY_GEOFENCES, count * sizeof(Geofence)) ||
+        !blobMatches(prefs, "gf_vlat", vertices * sizeof(int32_t)) ||
+        !blobMatches(prefs, "gf_vlon", vertices * sizeof(int32_t)) ||
+        !blobMatches(prefs, "gf_rings", ringTotal * sizeof(PolygonRing)) ||
+        !blobMatches(prefs, "gf_sched", count * SCHEDULE_BITMAP_BYTES) ||
+        (speedLength != 0 && speedLength != count) ||
+        (profileLength != 0 && profileLength != count * sizeof(ReportProfile))) {
+        prefs.end();
+        return false;
+    }
+
+    prefs.getBytes(KEY_GEOFENCES, fences, count * sizeof(Geofence));
+    prefs.getBytes("gf_vlat", vertexLat, vertices * sizeof(int32_t));
+    prefs.getBytes("gf_vlon", vertexLon, vertices * sizeof(int32_t));
+    prefs.getBytes("gf_rings", rings, ringTotal * sizeof(PolygonRing));
+    prefs.getBytes("gf_sched", scheduleBitmap, count * SCHEDULE_BITMAP_BYTES);
+    if (speedLength != 0) {
+        prefs.getBytes("gf_speed", speedLimit, speedLength);
+    }
+    if (profileLength != 0) {
+        prefs.getBytes("gf_profile", profiles, profileLength);
+    }
+    prefs.end();
+
+    // Every range must lie within the arrays loaded with it
+    for (uint8_t i = 0; i < count; i++) {
+        if (!fenceFits(fences[i], vertices, ringTotal)) {
+            // Nothing loaded may carry over to the default fence
+            memset(speedLimit, 0, sizeof(speedLimit));
+            memset(profiles, 0, sizeof(profiles));
+            return false;
+        }
+    }
+
+    if (profileLength != 0) {
+        for (uint8_t i = 0; i < count; i++) {
+            if (profiles[i].uplinkInterval != 0) {
+                profileMask |= 1UL << i;
+            }
+        }
+    }
+
+    fenceCount = count;
+    vertexCount = vertices;
+    ringCount = ringTotal;
+    cellsDirty = true;
+    layoutVersion++;
+    return true;
+}
+
+bool GeofenceManager::fenceFits(const Geofence& fence, uint16_t vertices, uint8_t ringTotal) const {
+    if (fence.type == GEOFENCE_CIRCLE) {
+        return true;
+    }
+    if (fence.type != GEOFENCE_POLYGON || fence.ringCount == 0 ||
+        fence.vertexStart + fence.vertexCount > vertices ||
+        fence.ringStart + fence.ringCount > ringTotal) {
+        return false;
+    }
+
+    for (uint8_t r = fence.ringStart; r < fence.ringStart + fence.ringCount; r++) {
+        if (rings[r].count < 3 || rings[r].start + rings[r].count > fence.vertexCount) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// ===============================================================
+// MEMBERSHIP PERSISTENCE
+// ===============================================================
+
+void GeofenceManager::updateSnapshot() {
+    if (insideMask != snapshotInside || knownMask != snapshotKnown || layoutVersion != snapshotLayout) {
+        writeSnapshot();
+    }
+
+    // Flash is written at most once per GEOFENCE_STATE_FLUSH_INTERVAL
+    if (snapshotDirty && (lastStateFlush == 0 || millis() - lastStateFlush >= GEOFENCE_STATE_FLUSH_INTERVAL)) {
+        flushMembership();
+    }
+}
+
+void GeofenceManager::writeSnapshot() {
+    // RTC memory is cheap to write, so it always holds the latest state
+    MembershipSnapshot& snapshot = rtcSnapshot;
+    memset(&snapshot, 0, sizeof(snapshot));
+    snapshot.magic = MEMBERSHIP_MAGIC;
+    snapshot.count = fenceCount;
+    for (uint8_t i = 0; i < fenceCount; i++) {
+        snapshot.ids[i] = fences[i].id;
+        snapshot.since[i] = stateSince[i];
+    }
+    snapshot.insideMask = insideMask;
+    snapshot.knownMask = knownMask;
+    snapshot.checksum = snapshotChecksum(snapshot);
+
+    snapshotInside = insideMask;
+    snapshotKnown = knownMask;
+    snapshotLayout = layoutVersion;
+    snapshotDirty = true;
+}
+
+void GeofenceManager::flushMembership() {
+    if (!snapshotDirty) {
+        return;
+    }
+
+    Preferences prefs;
+    if (prefs.begin(STORAGE_NAMESPACE, false)) {
+        prefs.putBytes("gf_state", &rtcSnapshot, sizeof(MembershipSnapshot));
+        prefs.end();
+    }
+    snapshotDirty = false;
+    lastStateFlush = millis();
+}
+
+bool GeofenceManager::restoreMembership() {
+    MembershipSnapshot snapshot;
+    const char* source = "RTC";
+
+    if (rtcSnapshot.magic == MEMBERSHIP_MAGIC && rtcSnapshot.checksum == snapshotChecksum(rtcSnapshot)) {
+        snapshot = rtcSnapshot;
+    } else {
+        Preferences prefs;
+        bool loaded = false;
+        if (prefs.begin(STORAGE_NAMESPACE, true)) {
+            loaded = prefs.getBytes("gf_state", &snapshot, sizeof(snapshot)) == sizeof(snapshot);
+            prefs.end();
+        }
+        if (!loaded || snapshot.magic != MEMBERSHIP_MAGIC || snapshot.checksum != snapshotChecksum(snapshot)) {
+            return false;
+        }
+        source = "NVS";
+    }
+
+    // Matched by id, so fences added or removed since are simply unknown.
+    // Restored bits count as known: the first fix goes through hysteresis
+    // against them and only a real change produces an event.
+    uint8_t restored = 0;
+    for (uint8_t j = 0; j < snapshot.count && j < MAX_GEOFENCES; j++) {
+        int8_t index = findIndex(snapshot.ids[j]);
+        if (index < 0 || !((snapshot.knownMask >> j) & 1) || !((armedMask >> index) & 1)) {
+            continue;
+        }
+
+        uint32_t bit = 1UL << index;
+        knownMask |= bit;
+        insideMask = ((snapshot.insideMask >> j) & 1) ? (insideMask | bit) : (insideMask & ~bit);
+        stateSince[index] = snapshot.since[j];
+        restored++;
+    }
+
+    // The RTC copy already matches; NVS keeps whatever it had
+    snapshotInside = insideMask;
+    snapshotKnown = knownMask;
+    snapshotLayout = layoutVersion;
+
+    Serial.print("Geofence Manager: Membership of ");
+    Serial.print(restored);
+    Serial.print(" fences restored from ");
+    Serial.println(source);
+    return restored > 0;
+}
+
+// ===============================================================
+// DEBUG & LOGGING
+// ===============================================================
+
+void GeofenceManager::printStatus() {
+    Serial.println("=== GEOFENCE STATUS ===");
+    Serial.print("Fences: ");
+    Serial.print(fenceCount);
+    Serial.print(" (armed mask 0x");
+    Serial.print(armedMask, HEX);
+    Serial.println(")");
+    Serial.print("Inside mask: 0x");
+    Serial.println(insideMask, HEX);
+    Serial.print("Clock: ");
+    Serial.println(isClockSynced() ? getUnixTime() : 0);
+    Serial.print("Schedule slot: ");
+    Serial.println(currentSlot);
+    Serial.print("Checks / evaluations / events: ");
+    Serial.print(totalChecks);
+    Serial.print(" / ");
+    Serial.print(totalEvaluations);
+    Serial.print(" / ");
+    Serial.println(totalEvents);
+    Serial.print("Fixes seen / evaluated: ");
+    Serial.print(totalFixesSeen);
+    Serial.print(" / ");
+    Serial.println(totalChecks);
+    Serial.print("Next check in: ");
+    Serial.print(nextCheckDelay);
+    Serial.println(" ms");
+    Serial.print("Pass-through crossings (swept): ");
+    Serial.println(totalSweptEvents);
+    Serial.print("Cell cover: ");
+    Serial.print(cellCount);
+    Serial.print(" / ");
+    Serial.print(CELL_TABLE_SIZE);
+    Serial.print(" cells, hits / exact: ");
+    Serial.print(totalCellHits);
+    Serial.print(" / ");
+    Serial.println(totalCellFallthroughs);
+    Serial.print("Occupancy day / open visits: ");
+    Serial.print(occupancyDay);
+    Serial.print(" / 0x");
+    Serial.println(occupancyMask, HEX);
+    Serial.print("Profile: uplink ");
+    Serial.print(activeProfile.uplinkInterval);
+    Serial.print(" s, GNSS ");
+    Serial.print(activeProfile.gnssInterval);
+    Serial.print(" s, aggregation ");
+    Serial.print(activeProfile.aggregation);
+    Serial.print(", DR ");
+    Serial.print(activeProfile.dataRate);
+    Serial.print(" (switches ");
+    Serial.print(totalProfileSwitches);
+    Serial.println(")");
+    Serial.print("Overspeed mask / alerts: 0x");
+    Serial.print(overspeedMask, HEX);
+    Serial.print(" / ");
+    Serial.println(totalSpeedAlerts);
+    Serial.print("Nearest queries / fences pruned: ");
+    Serial.print(totalNearestQueries);
+    Serial.print(" / ");
+    Serial.println(totalNearestPruned);
+    tiles.printStatistics();
+    tileSync.printStatistics();
+}
+
+// ===============================================================
+// HELPER FUNCTIONS
+// ===============================================================
+
+void compileSchedule(const ScheduleWindow* windows, uint8_t count, uint8_t* bitmap) {
+    memset(bitmap, 0, SCHEDULE_BITMAP_BYTES);
+
+    for (uint8_t w = 0; w < count; w++) {
+        uint8_t start = windows[w].startSlot % SCHEDULE_SLOTS_PER_DAY;
+        uint8_t end = windows[w].endSlot % SCHEDULE_SLOTS_PER_DAY;
+        // end <= start wraps into the next day (start == end is 24 h)
+        uint16_t length = (end > start) ? end - start : SCHEDULE_SLOTS_PER_DAY - start + end;
+
+        for (uint8_t day = 0; day < 7; day++) {
+            if (!((windows[w].dayMask >> day) & 1)) {
+                continue;
+            }
+
+            uint16_t slot = day * SCHEDULE_SLOTS_PER_DAY + start;
+            for (uint16_t s = 0; s < length; s++) {
+                bitmap[slot >> 3] |= 1 << (slot & 7);
+                slot = (slot + 1) % SCHEDULE_SLOTS_PER_WEEK;
+            }
+        }
+    }
+}
+
+bool pointInRing(const int32_t* ys, const int32_t* xs, uint16_t n, int32_t lat, int32_t lon) {
+    bool inside = false;
+
+    // Even-odd crossing test in integer micro-degrees
+    for (uint16_t i = 0, j = n - 1; i < n; j = i++) {
+        if ((ys[i] > lat) != (ys[j] > lat)) {
+            int64_t lhs = (int64_t)(lon - xs[i]) * (ys[j] - ys[i]);
+            int64_t rhs = (int64_t)(xs[j] - xs[i]) * (lat - ys[i]);
+            if ((ys[j] > ys[i]) ? (lhs < rhs) : (lhs > rhs)) {
+                inside = !inside;
+            }
+        }
+    }
+
+    return inside;
+}
+
+float distanceToRing(const int32_t* ys, const int32_t* xs, uint16_t n, int32_t lat, int32_t lon) {
+
+    // Local equirectangular frame centred on the fix, meters
+    float kx = METERS_PER_MICRODEGREE * cos(lat / 1e6 * DEG_TO_RAD);
+    float ky = METERS_PER_MICRODEGREE;
+    float best = 1e12;
+
+    for (uint16_t i = 0, j = n - 1; i < n; j = i++) {
+        float ax = (xs[j] - lon) * kx, ay = (ys[j] - lat) * ky;
+        float bx = (xs[i] - lon) * kx, by = (ys[i] - lat) * ky;
+        float ex = bx - ax, ey = by - ay;
+        float len2 = ex * ex + ey * ey;
+        float t = len2 > 0 ? constrain(-(ax * ex + ay * ey) / len2, 0.0f, 1.0f) : 0.0f;
+        float px = ax + t * ex, py = ay + t * ey;
+        best = min(best, px * px + py * py);
+    }
+
+    return sqrt(best);
+}
+
+bool pointInRings(const PolygonRing* rings, uint8_t count, const int32_t* ys, const int32_t* xs,
+                  int32_t lat, int32_t lon) {
+    // One even-odd count over the edges of every ring. The ray runs
+    // towards +lon, so rings entirely west of the point or outside its
+    // latitude band contribute no crossings.
+    bool inside = false;
+    for (uint8_t r = 0; r < count; r++) {
+        const PolygonRing& ring = rings[r];
+        if (lat < ring.minLat || lat >= ring.maxLat || lon > ring.maxLon) {
+            continue;
+        }
+        inside ^= pointInRing(&ys[ring.start], &xs[ring.start], ring.count, lat, lon);
+    }
+    return inside;
+}
+
+float distanceToRings(const PolygonRing* rings, uint8_t count, const int32_t* ys, const int32_t* xs,
+                      int32_t lat, int32_t lon) {
+    float cosLat = cos(lat / 1e6 * DEG_TO_RAD);
+    float best = 1e12;
+
+    for (uint8_t r = 0; r < count; r++) {
+        const PolygonRing& ring = rings[r];
+
+        // A ring whose box is farther than the best edge so far cannot win
+        int32_t dLat = max(max(ring.minLat - lat, lat - ring.maxLat), (int32_t)0);
+        int32_t dLon = max(max(ring.minLon - lon, lon - ring.maxLon), (int32_t)0);
+        float lower = sqrt(sq(dLat * METERS_PER_MICRODEGREE) + sq(dLon * METERS_PER_MICRODEGREE * cosLat));
+        if (lower >= best) {
+            continue;
+        }
+
+        best = min(best, distanceToRing(&ys[ring.start], &xs[ring.start], ring.count, lat, lon));
+    }
+
+    return best;
+}
+
+void updateRingBox(PolygonRing& ring, const int32_t* ys, const int32_t* xs) {
+    ring.minLat = ring.maxLat = ys[ring.start];
+    ring.minLon = ring.maxLon = xs[ring.start];
+    for (uint16_t v = ring.start + 1; v < ring.start + ring.count; v++) {
+        ring.minLat = min(ring.minLat, ys[v]);
+        ring.maxLat = max(ring.maxLat, ys[v]);
+        ring.minLon = min(ring.minLon, xs[v]);
+        ring.maxLon = max(ring.maxLon, xs[v]);
+    }
+}
+
+uint32_t predictSafeInterval(float clearance, float speedMps) {
+    if (clearance <= 0) {
+        return GEOFENCE_MIN_CHECK_INTERVAL;
+    }
+
+    // Heading is not trusted: the asset may turn, so only |v| bounds the
+    // approach. Unknown speed is taken as the worst case.
+    const float vMax = GEOFENCE_MAX_SPEED;
+    const float a = GEOFENCE_MAX_ACCEL;
+    float v0 = (speedMps < 0) ? vMax : min(speedMps, vMax);
+
+    // Accelerate from v0 towards vMax, then cruise
+    float tRamp = (vMax - v0) / a;
+    float dRamp = v0 * tRamp + 0.5 * a * tRamp * tRamp;
+    float t;
+    if (clearance <= dRamp) {
+        t = (sqrt(v0 * v0 + 2 * a * clearance) - v0) / a;
+    } else {
+        t = tRamp + (clearance - dRamp) / vMax;
+    }
+
+    float ms = t * 1000.0;
+    if (ms < GEOFENCE_MIN_CHECK_INTERVAL) {
+        return GEOFENCE_MIN_CHECK_INTERVAL;
+    }
+    if (ms > GEOFENCE_MAX_CHECK_INTERVAL) {
+        return GEOFENCE_MAX_CHECK_INTERVAL;
+    }
+    return (uint32_t)ms;
+}
+
+int16_t scheduleSlotForTime(uint32_t unixTime, int16_t utcOffsetMinutes) {
+    if (unixTime == 0) {
+        return -1;
+    }
+
+    int64_t local = (int64_t)unixTime + utcOffsetMinutes * 60L;
+    uint32_t days = (uint32_t)(local / 86400);
+    uint32_t secondOfDay = (uint32_t)(local % 86400);
+
+    // 1970-01-01 was a Thursday; Monday = 0
+    uint8_t weekday = (days + 3) % 7;
+    return weekday * SCHEDULE_SLOTS_PER_DAY + secondOfDay / (SCHEDULE_SLOT_MINUTES * 60);
+}
@@ -0,0 +1,432 @@
+#ifndef GEOFENCE_MANAGER_H
+#define GEOFENCE_MANAGER_H
+
+#include <Arduino.h>
+#include "../include/project_config.h"
+#include "lorawan_manager.h"
+#include "tile_store.h"
+#include "tile_sync.h"
+
+// ===============================================================
+// GEOFENCE CONSTANTS
+// ===============================================================
+
+#define METERS_PER_MICRODEGREE      0.11131949   // At the equator
+
+// Weekly arming schedule: one bit per 15-minute slot, Monday 00:00 first
+#define SCHEDULE_SLOT_MINUTES       15
+#define SCHEDULE_SLOTS_PER_DAY      (24 * 60 / SCHEDULE_SLOT_MINUTES)
+#define SCHEDULE_SLOTS_PER_WEEK     (7 * SCHEDULE_SLOTS_PER_DAY)
+#define SCHEDULE_BITMAP_BYTES       (SCHEDULE_SLOTS_PER_WEEK / 8)
+#define MAX_SCHEDULE_WINDOWS        8
+#define UTC_OFFSET_WESTMOST         -720    // UTC-12:00, minutes
+#define UTC_OFFSET_EASTMOST         840     // UTC+14:00
+
+// Boundary crossings kept per fence / per fix for swept-segment detection
+#define MAX_SEGMENT_CROSSINGS       8
+#define MAX_PENDING_EVENTS          (2 * MAX_GEOFENCES)
+
+// Cell cover: each fence's box is split into a 4x4 root grid of
+// power-of-two cells, boundary cells subdivided quadtree-style
+#define CELL_ROOT_BITS              2
+#define CELL_TABLE_SIZE             (1U << GEOFENCE_CELL_TABLE_BITS)
+#define CELL_KEY_EMPTY              0xFFFFFFFFUL
+
+// Candidate grid: the fence set's box split into 2^n x 2^n power-of-two
+// cells, each listing the fences whose box (plus hysteresis) meets it
+#define GRID_SIDE                   (1 << GEOFENCE_GRID_BITS)
+
+static_assert(MAX_GEOFENCES <= 32, "Geofence state is kept in 32-bit masks");
+static_assert(GEOFENCE_CELL_MAX_LEVEL <= 7, "Cell level is kept in 3 key bits");
+
+// ===============================================================
+// GEOFENCE STRUCTURES
+// ===============================================================
+
+enum GeofenceType : uint8_t {
+    GEOFENCE_CIRCLE  = 0,
+    GEOFENCE_POLYGON = 1
+};
+
+struct Geofence {
+    uint8_t id;
+    GeofenceType type;
+    bool scheduled;          // false = always armed
+    uint8_t ringCount;       // Polygon: outer rings, holes and parts alike
+
+    // Circle
+    int32_t centerLat;       // * 1e6
+    int32_t centerLon;       // * 1e6
+    uint32_t radius;         // meters
+
+    // Polygon (range in the shared vertex pool and ring table)
+    uint16_t vertexStart;
+    uint16_t vertexCount;
+    uint8_t ringStart;
+
+    // Bounding box, * 1e6
+    int32_t minLat;
+    int32_t maxLat;
+    int32_t minLon;
+    int32_t maxLon;
+};
+
+// One closed ring of a polygon fence. Holes and disjoint parts are just
+// more rings: the even-odd rule over all of them gives the right answer
+// without knowing which is which.
+struct PolygonRing {
+    uint16_t start;          // First vertex, relative to the fence's vertices
+    uint16_t count;
+
+    // Bounding box, * 1e6
+    int32_t minLat;
+    int32_t maxLat;
+    int32_t minLon;
+    int32_t maxLon;
+};
+
+static_assert(sizeof(PolygonRing) == 20, "Tile files hold rings in this layout");
+
+// Weekly window; endSlot <= startSlot wraps past midnight into the next day
+struct ScheduleWindow {
+    uint8_t dayMask;         // bit 0 = Monday ... bit 6 = Sunday
+    uint8_t startSlot;       // 0..95
+    uint8_t endSlot;         // 0..95, exclusive
+};
+
+// Overspeed tracking for a fence with a speed limit
+struct SpeedState {
+    uint32_t overSince;      // Fix time the limit was first exceeded, 0 = not over
+    uint32_t underSince;     // Fix time speed fell below limit - hysteresis, 0 = not under
+    float peak;              // km/h
+};
+
+// Reporting profile carried by a fence. While several are active each
+// field takes its most demanding value; the data rate follows the
+// profile that sets the uplink interval.
+struct ReportProfile {
+    uint16_t uplinkInterval; // seconds
+    uint16_t gnssInterval;   // seconds, slowest GNSS rate allowed
+    uint8_t aggregation;     // Fixes averaged into each position report
+    uint8_t dataRate;        // Preferred uplink DR, LORAWAN_DR_ADR = network's choice
+};
+
+// Occupancy of one fence over the current local day. Visits are
+// accounted at their transitions, so fixes in between cost nothing.
+struct FenceOccupancy {
+    uint32_t insideSeconds;  // Closed visits
+    uint16_t visits;
+    uint16_t firstEntry;     // Minute of the local day, valid once visits > 0
+    uint16_t lastEntry;
+};
+
+// Membership kept across resets: RTC memory survives ESP.restart() and
+// watchdog resets, NVS (written lazily) survives power loss
+struct MembershipSnapshot {
+    uint32_t magic;
+    uint8_t count;
+    uint8_t ids[MAX_GEOFENCES];
+    uint32_t insideMask;     // Bit j refers to ids[j]
+    uint32_t knownMask;
+    uint32_t since[MAX_GEOFENCES];   // Unix time of the last transition, 0 = unknown
+    uint32_t checksum;
+};
+
+// Cell classes; cells absent from the table are exterior
+enum CellClass : uint8_t {
+    CELL_EXTERIOR = 0,
+    CELL_INTERIOR = 1,
+    CELL_BOUNDARY = 2,       // Leaf that needs exact geometry
+    CELL_SPLIT    = 3        // Look up the child cell one level down
+};
+
+// Distance from a point to a fence boundary, negative when inside
+struct FenceDistance {
+    uint8_t id;
+    float distance;          // meters
+};
+
+// ===============================================================
+// GEOFENCE MANAGER CLASS
+// ===============================================================
+
+class GeofenceManager {
+private:
+    Geofence fences[MAX_GEOFENCES];
+    uint8_t fenceCount;
+
+    // Shared SoA polygon vertex storage, * 1e6
+    int32_t vertexLat[MAX_GEOFENCE_VERTICES];
+    int32_t vertexLon[MAX_GEOFENCE_VERTICES];
+    uint16_t vertexCount;
+    PolygonRing rings[MAX_GEOFENCE_RINGS];
+    uint8_t ringCount;
+
+    // Per-fence state, one bit per fence index
+    uint32_t insideMask;
+    uint32_t knownMask;      // State established since (re)arming
+    uint32_t armedMask;      // Schedules say the fence is active now
+
+    // Arming schedules
+    uint8_t scheduleBitmap[MAX_GEOFENCES][SCHEDULE_BITMAP_BYTES];
+    int16_t currentSlot;     // -1 = needs recompute
+
+    // Per-fence speed limits (km/h, 0 = none) and overspeed state
+    uint8_t speedLimit[MAX_GEOFENCES];
+    SpeedState speedState[MAX_GEOFENCES];
+    uint32_t overspeedMask;
+    uint32_t lastSpeedFix;
+
+    // Per-fence reporting profiles and the merged active one
+    ReportProfile profiles[MAX_GEOFENCES];
+    uint32_t profileMask;                // Fences that carry a profile
+    uint32_t profileInputs;              // Inside & armed & profiled at the last merge
+    ReportProfile activeProfile;
+    bool profileDirty;                   // Profiles edited, merge again
+    bool profileChanged;                 // Not yet picked up by getProfileChange()
+
+    // Occupancy statistics for the current local day
+    FenceOccupancy occupancy[MAX_GEOFENCES];
+    uint32_t visitStart[MAX_GEOFENCES];  // Unix time the open visit (or the day) started
+    uint32_t occupancyMask;              // Fences with an open visit
+    int32_t occupancyDay;                // Local day number, -1 = clock not synced yet
+    OccupancyReport finalReport;         // Last closed day
+    uint8_t finalRepeats;                // Sends left for finalReport
+
+    // Pending overspeed alerts
+    SpeedAlert pendingAlerts[MAX_GEOFENCES];
+    uint8_t alertHead;
+    uint8_t alertCount;
+
+    // Cell cover (rebuilt whenever the fence set changes)
+    uint32_t cellKeys[CELL_TABLE_SIZE];
+    uint8_t cellClass[CELL_TABLE_SIZE];
+    uint16_t cellCount;
+    int32_t cellOriginLat[MAX_GEOFENCES];
+    int32_t cellOriginLon[MAX_GEOFENCES];
+    uint8_t cellShift[MAX_GEOFENCES];    // log2 of the root cell size (micro-degrees)
+    uint32_t coveredMask;                // Fences whose root grid fit in the table
+    bool cellsDirty;
+    uint16_t layoutVersion;              // Bumped whenever fence indices may change
+
+    // Candidate grid (rebuilt with the cell cover)
+    uint32_t gridCells[GRID_SIDE * GRID_SIDE];  // Fence masks, row by row
+    int32_t gridOriginLat;
+    int32_t gridOriginLon;
+    uint8_t gridShiftLat;                // log2 of the cell size (micro-degrees)
+    uint8_t gridShiftLon;
+
+    // Synchronized clock
+    uint32_t clockUnixTime;
+    uint32_t clockSyncMillis;
+    int16_t utcOffsetMinutes;
+
+    // Nearest armed fence to the last checked fix
+    FenceDistance nearestFence;
+    bool nearestValid;
+
+    // Dwell timers and persisted membership
+    uint32_t stateSince[MAX_GEOFENCES];  // Unix time of the last transition, 0 = unknown
+    uint32_t snapshotInside;
+    uint32_t snapshotKnown;
+    uint16_t snapshotLayout;
+    bool snapshotDirty;                  // RTC copy newer than NVS
+    uint32_t lastStateFlush;
+
+    // Previous evaluated fix, start of the swept segment
+    int32_t prevFixLat;
+    int32_t prevFixLon;
+    uint32_t prevFixTime;
+    bool prevFixValid;
+
+    // Pending transitions (several fences can change on one fix)
+    GeofenceEvent pendingEvents[MAX_PENDING_EVENTS];
+    uint8_t pendingHead;
+    uint8_t pendingCount;
+
+    // Country-scale fences paged in from LittleFS, kept in step with the
+    // backend's set through a hash tree
+    TileStore tiles;
+    TileSync tileSync;
+
+    // Motion of the latest fix, for time-to-boundary scheduling
+    uint32_t motionFixTime;      // millis() of the fix, 0 = unknown
+    uint32_t motionFixInterval;  // Expected spacing of fixes (ms)
+    float motionSpeed;           // m/s, negative = unknown
+    float motionCourse;          // degrees, negative = unknown
+    float motionHdop;
+    uint32_t lastEvaluatedFix;
+    uint32_t lastSeenFix;
+    uint32_t checkDeadline;      // Latest fix time that must be evaluated
+    uint32_t nextCheckDelay;
+    bool forceCheck;
+
+    // Status tracking
+    bool isInitialized;
+    uint32_t lastCheckTime;
+
+    // Statistics
+    uint32_t totalChecks;
+    uint32_t totalEvaluations;
+    uint32_t totalEvents;
+    uint32_t totalNearestQueries;
+    uint32_t totalNearestPruned;
+    uint32_t totalFixesSeen;
+    uint32_t totalSweptEvents;
+    uint32_t totalCellHits;
+    uint32_t totalCellFallthroughs;
+    uint32_t totalSpeedAlerts;
+    uint32_t totalProfileSwitches;
+
+    // Private methods
+    int8_t findIndex(uint8_t id) const;
+    void updateBoundingBox(uint8_t index);
+    void updateArmedMask();
+    uint32_t queryCandidates(int32_t minLat, int32_t maxLat, int32_t minLon, int32_t maxLon) const;
+    bool evaluateFence(uint8_t index, int32_t lat, int32_t lon, bool wasInside, bool known);
+    bool pointInPolygon(const Geofence& fence, int32_t lat, int32_t lon) const;
+    float distanceToEdges(const Geofence& fence, int32_t lat, int32_t lon) const;
+    float signedDistance(uint8_t index, int32_t lat, int32_t lon) const;
+    float boxLowerBound(const Geofence& fence, int32_t lat, int32_t lon) const;
+    uint8_t nearestFences(int32_t lat, int32_t lon, FenceDistance* results, uint8_t k);
+    uint8_t segmentCrossings(uint8_t index, int32_t lat0, int32_t lon0, int32_t lat1, int32_t lon1,
+                             float* crossings) const;
+    void buildCellCover();
+    void buildGrid();
+    bool gridRange(int32_t minLat, int32_t maxLat, int32_t minLon, int32_t maxLon,
+                   uint8_t& row0, uint8_t& row1, uint8_t& col0, uint8_t& col1) const;
+    CellClass classifyCell(uint8_t index, uint8_t level, uint32_t cellLat, uint32_t cellLon) const;
+    bool insertCell(uint32_t key, CellClass cls);
+    int16_t findCell(uint32_t key) const;
+    CellClass lookupCell(uint8_t index, int32_t lat, int32_t lon) const;
+    void queueEvent(uint8_t index, bool entered, int32_t lat, int32_t lon, uint32_t timeMs);
+    void queueAlert(uint8_t index, uint8_t type, int32_t lat, int32_t lon, uint32_t timeMs);
+    void updateProfile();
+    void updateOccupancy();
+    void openVisit(uint8_t index, uint32_t unixTime, bool counted);
+    void closeVisit(uint8_t index, uint32_t unixTime);
+    void buildOccupancyReport(OccupancyReport& report, uint32_t unixTime) const;
+    void removeIndex(uint8_t index);
+    void updateSnapshot();
+    void writeSnapshot();
+    bool restoreMembership();
+    void flushMembership();
+    void saveGeofences();
+    bool loadGeofences();
+    bool fenceFits(const Geofence& fence, uint16_t vertices, uint8_t ringTotal) const;
+
+public:
+    // Constructor & Destructor
+    GeofenceManager();
+    ~GeofenceManager();
+
+    // Initialization
+    bool begin();
+
+    // Fence management
+    bool addCircle(uint8_t id, double lat, double lon, uint32_t radiusMeters);
+    bool addPolygon(uint8_t id, const int32_t* lats, const int32_t* lons, uint16_t count);
+    bool addMultiPolygon(uint8_t id, const int32_t* lats, const int32_t* lons,
+                         const uint16_t* ringSizes, uint8_t ringCount);
+    bool removeGeofence(uint8_t id);
+    void clearGeofences();
+    uint8_t getGeofenceCount() const { return fenceCount; }
+    int8_t getIndex(uint8_t id) const { return findIndex(id); }
+    uint16_t getLayoutVersion() const { return layoutVersion; }
+
+    // Transition detection
+    bool checkGeofences(double lat, double lon, GeofenceEvent& event);
+    bool isInside(uint8_t id) const;
+    uint32_t getDwellTime(uint8_t id) const;
+    uint32_t getInsideMask() const { return insideMask; }
+
+    // Tiled fences (LittleFS store, 16-bit ids, always armed)
+    bool getTileEvent(TileEvent& event) { return tiles.getEvent(event); }
+    bool isInsideTiled(uint16_t id) const { return tiles.isInside(id); }
+    bool hasTiles() const { return tiles.available(); }
+
+    // Tile set sync (root hash for status uplinks, replies to the walk)
+    uint32_t getFenceRoot() { return tileSync.getRoot(); }
+    uint16_t getTileCount() const { return tileSync.getTileCount(); }
+    bool getTileSyncNode(TileSyncNode& node) { return tileSync.getNode(node); }
+    bool getTileSyncStatus(TileSyncStatus& status) { return tileSync.getStatus(status); }
+
+    // Distance queries (armed fences only)
+    bool getDistanceToBoundary(uint8_t id, double lat, double lon, float& distance) const;
+    uint8_t findNearest(double lat, double lon, FenceDistance* results, uint8_t k);
+    bool getNearestFence(FenceDistance& nearest) const;
+
+    // Speed limits (membership of the last check, no geometry)
+    bool setSpeedLimit(uint8_t id, uint8_t kmh);
+    void updateSpeed(float speedMps, uint32_t fixTime, int32_t lat, int32_t lon);
+    bool getSpeedAlert(SpeedAlert& alert);
+
+    // Reporting profiles (merged over inside, armed fences)
+    bool setProfile(uint8_t id, const ReportProfile& profile);
+    bool clearProfile(uint8_t id);
+    const ReportProfile& getActiveProfile() const { return activeProfile; }
+    bool getProfileChange(ReportProfile& profile);
+
+    // Occupancy statistics (needs a synchronized clock). Returns the
+    // day-to-date report, or a closed day while it still has repeats left.
+    bool getOccupancyReport(OccupancyReport& report);
+    bool hasClosedDay() const { return finalRepeats > 0 && finalRepeats == OCCUPANCY_FINAL_REPEATS; }
+
+    // Time-to-boundary scheduling
+    void updateMotion(uint32_t fixTime, uint32_t fixInterval, float speedMps, float courseDeg, float hdop);
+    uint32_t getNextCheckDelay() const { return nextCheckDelay; }
+    uint32_t getCheckCount() const { return totalChecks; }
+
+    // Arming schedules
+    bool setSchedule(uint8_t id, const ScheduleWindow* windows, uint8_t count);
+    bool clearSchedule(uint8_t id);
+    bool isArmed(uint8_t index) const { return (armedMask >> index) & 1; }
+    uint32_t getArmedMask() const { return armedMask; }
+
+    // Synchronized clock
+    void syncClock(uint32_t unixTime);
+    bool isClockSynced() const { return clockSyncMillis != 0; }
+    uint32_t getUnixTime() const;
+    bool setUtcOffset(int16_t minutes);     // Kept with the fences
+    int16_t getUtcOffset() const { return utcOffsetMinutes; }
+
+    // Downlink handling
+    uint8_t handleDownlink(const uint8_t* payload, size_t length);   // CONFIG_*
+
+    // Debug & Logging
+    uint32_t getCellHits() const { return totalCellHits; }              // Answered by the cell cover
+    uint32_t getCellFallthroughs() const { return totalCellFallthroughs; }
+    void printStatus();
+};
+
+// ===============================================================
+// HELPER FUNCTIONS
+// ===============================================================
+
+// Compile schedule windows into a weekly 15-minute bitmap
+void compileSchedule(const ScheduleWindow* windows, uint8_t count, uint8_t* bitmap);
+
+// Schedule slot for a local time, -1 if the clock is unknown
+int16_t scheduleSlotForTime(uint32_t unixTime, int16_t utcOffsetMinutes);
+
+// Even-odd test of a point against a closed ring, integer micro-degrees
+bool pointInRing(const int32_t* ys, const int32_t* xs, uint16_t n, int32_t lat, int32_t lon);
+
+// Distance (m) from a point to the nearest edge of a closed ring
+float distanceToRing(const int32_t* ys, const int32_t* xs, uint16_t n, int32_t lat, int32_t lon);
+
+// The same over a polygon's rings (vertex arrays indexed by ring.start);
+// rings whose box cannot matter are skipped
+bool pointInRings(const PolygonRing* rings, uint8_t count, const int32_t* ys, const int32_t* xs,
+                  int32_t lat, int32_t lon);
+float distanceToRings(const PolygonRing* rings, uint8_t count, const int32_t* ys, const int32_t* xs,
+                      int32_t lat, int32_t lon);
+
+// Fill in a ring's bounding box from its vertices
+void updateRingBox(PolygonRing& ring, const int32_t* ys, const int32_t* xs);
+
+// Longest time (ms) before an asset `clearance` meters from every boundary
+// could reach one, under GEOFENCE_MAX_SPEED / GEOFENCE_MAX_ACCEL
+uint32_t predictSafeInterval(float clearance, float speedMps);
+
+#endif // GEOFENCE_MANAGER_H
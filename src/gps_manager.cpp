@@ -0,0 +1,177 @@
+#include "gps_manager.h"
+
+// ===============================================================
+// CONSTRUCTOR & DESTRUCTOR
+// ===============================================================
+
+GPSManager::GPSManager() :
+    gpsSerial(nullptr),
+    isInitialized(false),
+    currentSpeed(-1),
+    filteredSpeed(-1),
+    currentCourse(-1),
+    lastUpdateTime(0),
+    lastFixTime(0),
+    updateRate(GPS_UPDATE_RATE),
+    gpsUnixTime(0),
+    lastTimeSync(0),
+    totalFixes(0) {
+    memset(&currentData, 0, sizeof(currentData));
+}
+
+GPSManager::~GPSManager() {
+    if (gpsSerial) gpsSerial->end();
+}
+
+// ===============================================================
+// INITIALIZATION
+// ===============================================================
+
+bool GPSManager::begin() {
+    Serial.println("GPS Manager: Initializing...");
+
+    gpsSerial = new HardwareSerial(GPS_SERIAL_NUM);
+    if (!gpsSerial) {
+        Serial.println("GPS Manager: Failed to create serial port!");
+        return false;
+    }
+
+    gpsSerial->begin(GPS_BAUD_RATE, SERIAL_8N1, GPS_RX_PIN, GPS_TX_PIN);
+
+    isInitialized = true;
+    Serial.println("GPS Manager: Initialization successful!");
+    return true;
+}
+
+// ===============================================================
+// UPDATE
+// ===============================================================
+
+void GPSManager::update() {
+    if (!isInitialized) {
+        return;
+    }
+
+    // Drain the UART every call so the NMEA buffer never overflows
+    readSerial();
+
+    if (millis() - lastUpdateTime < updateRate) {
+        return;
+    }
+    lastUpdateTime = millis();
+
+    updateTime();
+    updateFix();
+}
+
+void GPSManager::readSerial() {
+    while (gpsSerial->available() > 0) {
+        gps.encode(gpsSerial->read());
+    }
+}
+
+void GPSManager::updateFix() {
+    if (!gps.location.isValid() || !gps.location.isUpdated()) {
+        return;
+    }
+
+    currentData.latitude = (int32_t)(gps.location.lat() * 1e6);
+    currentData.longitude = (int32_t)(gps.location.lng() * 1e6);
+    currentData.altitude = gps.altitude.isValid() ? (int16_t)gps.altitude.meters() : 0;
+    currentData.satellites = gps.satellites.isValid() ? (uint8_t)gps.satellites.value() : 0;
+
+    // HDOP is carried in tenths so it fits in one byte
+    float hdop = gps.hdop.isValid() ? gps.hdop.hdop() : 25.5;
+    currentData.hdop = (uint8_t)constrain(hdop * 10.0, 0.0, 255.0);
+
+    currentSpeed = gps.speed.isValid() ? gps.speed.mps() : -1;
+    currentCourse = gps.course.isValid() ? gps.course.deg() : -1;
+
+    // First-order low-pass on the fix spacing, which changes with the
+    // sampling rate; restart after a long gap
+    uint32_t dt = millis() - lastFixTime;
+    if (currentSpeed < 0) {
+        filteredSpeed = -1;
+    } else if (filteredSpeed < 0 || lastFixTime == 0 || dt > 5 * GPS_SPEED_FILTER_TAU) {
+        filteredSpeed = currentSpeed;
+    } else {
+        float alpha = 1.0 - exp(-(float)dt / GPS_SPEED_FILTER_TAU);
+        filteredSpeed += alpha * (currentSpeed - filteredSpeed);
+    }
+
+    lastFixTime = millis();
+    totalFixes++;
+}
+
+void GPSManager::updateTime() {
+    if (!gps.date.isValid() || !gps.time.isValid() || gps.date.year() < 2020) {
+        return;
+    }
+
+    // Only resync when the NMEA time is fresh; age is in ms
+    if (gps.time.age() > GPS_UPDATE_RATE) {
+        return;
+    }
+
+    int32_t days = daysFromCivil(gps.date.year(), gps.date.month(), gps.date.day());
+    gpsUnixTime = (uint32_t)days * 86400UL
+                + gps.time.hour() * 3600UL
+                + gps.time.minute() * 60UL
+                + gps.time.second();
+    lastTimeSync = millis() - gps.time.age();
+}
+
+// ===============================================================
+// STATUS
+// ===============================================================
+
+bool GPSManager::hasValidFix() const {
+    if (lastFixTime == 0 || millis() - lastFixTime > max((uint32_t)GPS_TIMEOUT, 2 * updateRate)) {
+        return false;
+    }
+
+    return currentData.satellites >= GPS_MIN_SATELLITES;
+}
+
+uint32_t GPSManager::getUnixTime() const {
+    if (!hasValidTime()) {
+        return 0;
+    }
+
+    return gpsUnixTime + (millis() - lastTimeSync) / 1000;
+}
+
+// ===============================================================
+// DEBUG & LOGGING
+// ===============================================================
+
+void GPSManager::printStatistics() {
+    Serial.println("=== GPS STATISTICS ===");
+    Serial.print("Fix: ");
+    Serial.println(hasValidFix() ? "YES" : "NO");
+    Serial.print("Satellites: ");
+    Serial.println(currentData.satellites);
+    Serial.print("HDOP: ");
+    Serial.println(getHDOP());
+    Serial.print("Fixes: ");
+    Serial.println(totalFixes);
+    Serial.print("Chars processed: ");
+    Serial.println(gps.charsProcessed());
+    Serial.print("Failed checksums: ");
+    Serial.println(gps.failedChecksum());
+    Serial.print("UTC time: ");
+    Serial.println(getUnixTime());
+}
+
+// ===============================================================
+// HELPER FUNCTIONS
+// ===============================================================
+
+int32_t daysFromCivil(int32_t year, uint32_t month, uint32_t day) {
+    year -= month <= 2;
+    const int32_t era = (year >= 0 ? year : year - 399) / 400;
+    const uint32_t yoe = (uint32_t)(year - era * 400);
+    const uint32_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int32_t)doe - 719468;
+}
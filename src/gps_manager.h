@@ -0,0 +1,79 @@
+#ifndef GPS_MANAGER_H
+#define GPS_MANAGER_H
+
+#include <Arduino.h>
+#include <TinyGPSPlus.h>
+#include "../include/project_config.h"
+#include "lorawan_manager.h"
+
+// ===============================================================
+// GPS MANAGER CLASS
+// ===============================================================
+
+class GPSManager {
+private:
+    TinyGPSPlus gps;
+    HardwareSerial* gpsSerial;
+
+    // Status tracking
+    bool isInitialized;
+    GPSData currentData;
+    float currentSpeed;          // m/s, negative = unknown
+    float filteredSpeed;         // Low-passed currentSpeed, negative = unknown
+    float currentCourse;         // Degrees from true north, negative = unknown
+    uint32_t lastUpdateTime;
+    uint32_t lastFixTime;
+    uint32_t updateRate;
+
+    // Time synchronisation
+    uint32_t gpsUnixTime;        // UTC seconds at lastTimeSync
+    uint32_t lastTimeSync;       // millis() when gpsUnixTime was read
+
+    // Statistics
+    uint32_t totalFixes;
+
+    // Private methods
+    void readSerial();
+    void updateFix();
+    void updateTime();
+
+public:
+    // Constructor & Destructor
+    GPSManager();
+    ~GPSManager();
+
+    // Initialization
+    bool begin();
+
+    // Update (call from loop)
+    void update();
+    void setUpdateRate(uint32_t rateMs) { updateRate = rateMs; }
+    uint32_t getUpdateRate() const { return updateRate; }
+
+    // Position
+    bool hasValidFix() const;
+    GPSData getCurrentData() const { return currentData; }
+    uint8_t getSatelliteCount() const { return currentData.satellites; }
+    float getHDOP() const { return currentData.hdop / 10.0; }
+    uint32_t getFixAge() const { return millis() - lastFixTime; }
+    uint32_t getFixTime() const { return lastFixTime; }
+    float getSpeed() const { return currentSpeed; }
+    float getFilteredSpeed() const { return filteredSpeed; }
+    float getCourse() const { return currentCourse; }
+
+    // Time
+    bool hasValidTime() const { return lastTimeSync != 0; }
+    uint32_t getUnixTime() const;
+
+    // Debug & Logging
+    void printStatistics();
+};
+
+// ===============================================================
+// HELPER FUNCTIONS
+// ===============================================================
+
+// Days since 1970-01-01 for a proleptic Gregorian date
+int32_t daysFromCivil(int32_t year, uint32_t month, uint32_t day);
+
+#endif // GPS_MANAGER_H
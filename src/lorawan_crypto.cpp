@@ -0,0 +1,298 @@
+#include "lorawan_crypto.h"
+#include <mbedtls/aes.h>
+#ifdef ESP_PLATFORM
+#include "aes/esp_aes.h"
+#endif
+
+#define AES_DMA_CHUNK               256     // CBC-MAC output scratch, bytes
+
+// ===============================================================
+// MBEDTLS BACKEND
+// ===============================================================
+
+static void mbedtlsEncrypt(const uint8_t* key, const uint8_t* input, uint8_t* output) {
+    mbedtls_aes_context ctx;
+    mbedtls_aes_init(&ctx);
+    mbedtls_aes_setkey_enc(&ctx, key, 128);
+    mbedtls_aes_crypt_ecb(&ctx, MBEDTLS_AES_ENCRYPT, input, output);
+    mbedtls_aes_free(&ctx);
+}
+
+static void mbedtlsDecrypt(const uint8_t* key, const uint8_t* input, uint8_t* output) {
+    mbedtls_aes_context ctx;
+    mbedtls_aes_init(&ctx);
+    mbedtls_aes_setkey_dec(&ctx, key, 128);
+    mbedtls_aes_crypt_ecb(&ctx, MBEDTLS_AES_DECRYPT, input, output);
+    mbedtls_aes_free(&ctx);
+}
+
+static void mbedtlsCbcMac(const uint8_t* key, const uint8_t* data, size_t blocks, uint8_t* state) {
+    if (blocks == 0) {
+        return;
+    }
+    // The cipher text is thrown away; the IV comes back as the last block
+    uint8_t scratch[AES_DMA_CHUNK];
+    mbedtls_aes_context ctx;
+    mbedtls_aes_init(&ctx);
+    mbedtls_aes_setkey_enc(&ctx, key, 128);
+    while (blocks > 0) {
+        size_t chunk = min(blocks, sizeof(scratch) / 16);
+        mbedtls_aes_crypt_cbc(&ctx, MBEDTLS_AES_ENCRYPT, chunk * 16, state, data, scratch);
+        data += chunk * 16;
+        blocks -= chunk;
+    }
+    mbedtls_aes_free(&ctx);
+}
+
+static void mbedtlsCtr(const uint8_t* key, const uint8_t* counter, const uint8_t* input, uint8_t* output, size_t length) {
+    uint8_t block[16];
+    uint8_t stream[16];
+    size_t offset = 0;
+    memcpy(block, counter, 16);
+    mbedtls_aes_context ctx;
+    mbedtls_aes_init(&ctx);
+    mbedtls_aes_setkey_enc(&ctx, key, 128);
+    mbedtls_aes_crypt_ctr(&ctx, length, &offset, block, stream, input, output);
+    mbedtls_aes_free(&ctx);
+}
+
+const AesBackend aesMbedtls = {"mbedtls", mbedtlsEncrypt, mbedtlsDecrypt, mbedtlsCbcMac, mbedtlsCtr};
+
+// ===============================================================
+// HARDWARE BACKEND
+// ===============================================================
+
+#ifdef ESP_PLATFORM
+
+static void hardwareEncrypt(const uint8_t* key, const uint8_t* input, uint8_t* output) {
+    esp_aes_context ctx;
+    esp_aes_init(&ctx);
+    esp_aes_setkey(&ctx, key, 128);
+    esp_aes_crypt_ecb(&ctx, ESP_AES_ENCRYPT, input, output);
+    esp_aes_free(&ctx);
+}
+
+static void hardwareDecrypt(const uint8_t* key, const uint8_t* input, uint8_t* output) {
+    esp_aes_context ctx;
+    esp_aes_init(&ctx);
+    esp_aes_setkey(&ctx, key, 128);
+    esp_aes_crypt_ecb(&ctx, ESP_AES_DECRYPT, input, output);
+    esp_aes_free(&ctx);
+}
+
+static void hardwareCbcMac(const uint8_t* key, const uint8_t* data, size_t blocks, uint8_t* state) {
+    if (blocks == 0) {
+        return;
+    }
+    // The cipher text is thrown away; the IV comes back as the last block
+    uint8_t scratch[AES_DMA_CHUNK];
+    esp_aes_context ctx;
+    esp_aes_init(&ctx);
+    esp_aes_setkey(&ctx, key, 128);
+    while (blocks > 0) {
+        size_t chunk = min(blocks, sizeof(scratch) / 16);
+        esp_aes_crypt_cbc(&ctx, ESP_AES_ENCRYPT, chunk * 16, state, data, scratch);
+        data += chunk * 16;
+        blocks -= chunk;
+    }
+    esp_aes_free(&ctx);
+}
+
+static void hardwareCtr(const uint8_t* key, const uint8_t* counter, const uint8_t* input, uint8_t* output, size_t length) {
+    uint8_t block[16];
+    uint8_t stream[16];
+    size_t offset = 0;
+    memcpy(block, counter, 16);
+    esp_aes_context ctx;
+    esp_aes_init(&ctx);
+    esp_aes_setkey(&ctx, key, 128);
+    esp_aes_crypt_ctr(&ctx, length, &offset, block, stream, input, output);
+    esp_aes_free(&ctx);
+}
+
+const AesBackend aesHardware = {"hardware", hardwareEncrypt, hardwareDecrypt, hardwareCbcMac, hardwareCtr};
+
+#endif
+
+// ===============================================================
+// CMAC AND LORAWAN FRAMES
+// ===============================================================
+
+static const AesBackend* backend = &aesMbedtls;
+
+static void cmacSubkey(uint8_t* key) {
+    uint8_t carry = key[0] & 0x80;
+    for (uint8_t i = 0; i < 15; i++) {
+        key[i] = (key[i] << 1) | (key[i + 1] >> 7);
+    }
+    key[15] = (key[15] << 1) ^ (carry ? 0x87 : 0x00);
+}
+
+static void cmacWith(const AesBackend& aes, const uint8_t* key, const uint8_t* data, size_t length, uint8_t* mac) {
+    uint8_t subkey[16];
+    memset(subkey, 0, sizeof(subkey));
+    aes.encrypt(key, subkey, subkey);
+    cmacSubkey(subkey);                  // K1
+
+    size_t blocks = length == 0 ? 1 : (length + 15) / 16;
+    size_t tail = length - (blocks - 1) * 16;
+    uint8_t last[16];
+    memset(last, 0, sizeof(last));
+    memcpy(last, &data[(blocks - 1) * 16], tail);
+    if (tail < 16) {
+        last[tail] = 0x80;
+        cmacSubkey(subkey);              // K2
+    }
+
+    uint8_t state[16];
+    memset(state, 0, sizeof(state));
+    aes.cbcMac(key, data, blocks - 1, state);
+    for (uint8_t i = 0; i < 16; i++) {
+        state[i] ^= last[i] ^ subkey[i];
+    }
+    aes.encrypt(key, state, mac);
+}
+
+// B0 (tag 0x49, last = message length) and Ai (tag 0x01, last = i)
+static void frameBlock(uint8_t* block, uint8_t tag, uint8_t direction, uint32_t address, uint32_t fCnt, uint8_t last) {
+    memset(block, 0, 16);
+    block[0] = tag;
+    block[5] = direction;
+    for (uint8_t i = 0; i < 4; i++) {
+        block[6 + i] = (address >> (8 * i)) & 0xFF;
+        block[10 + i] = (fCnt >> (8 * i)) & 0xFF;
+    }
+    block[15] = last;
+}
+
+static void micWith(const AesBackend& aes, const uint8_t* key, uint8_t direction, uint32_t address, uint32_t fCnt,
+                    const uint8_t* message, size_t length, uint8_t* mic) {
+    uint8_t buffer[16 + LORAWAN_MAX_MESSAGE];
+    uint8_t full[16];
+    length = min(length, (size_t)LORAWAN_MAX_MESSAGE);
+    frameBlock(buffer, 0x49, direction, address, fCnt, length);
+    memcpy(&buffer[16], message, length);
+    cmacWith(aes, key, buffer, 16 + length, full);
+    memcpy(mic, full, 4);
+}
+
+static void cryptWith(const AesBackend& aes, const uint8_t* key, uint8_t direction, uint32_t address, uint32_t fCnt,
+                      const uint8_t* input, uint8_t* output, size_t length) {
+    uint8_t counter[16];
+    frameBlock(counter, 0x01, direction, address, fCnt, 1);
+    aes.ctr(key, counter, input, output, length);
+}
+
+void aesEncryptBlock(const uint8_t* key, const uint8_t* input, uint8_t* output) {
+    backend->encrypt(key, input, output);
+}
+
+void aesDecryptBlock(const uint8_t* key, const uint8_t* input, uint8_t* output) {
+    backend->decrypt(key, input, output);
+}
+
+void aesCmac(const uint8_t* key, const uint8_t* data, size_t length, uint8_t* mac) {
+    cmacWith(*backend, key, data, length, mac);
+}
+
+void lorawanFrameMic(const uint8_t* key, uint8_t direction, uint32_t address, uint32_t fCnt,
+                     const uint8_t* message, size_t length, uint8_t* mic) {
+    micWith(*backend, key, direction, address, fCnt, message, length, mic);
+}
+
+void lorawanCryptPayload(const uint8_t* key, uint8_t direction, uint32_t address, uint32_t fCnt,
+                         const uint8_t* input, uint8_t* output, size_t length) {
+    cryptWith(*backend, key, direction, address, fCnt, input, output, length);
+}
+
+// ===============================================================
+// TEST VECTORS
+// ===============================================================
+
+// FIPS-197 appendix C.1
+static const uint8_t fipsKey[16] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+static const uint8_t fipsPlain[16] = {
+    0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff};
+static const uint8_t fipsCipher[16] = {
+    0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30, 0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a};
+
+// RFC 4493 section 4: messages of 0, 16, 40 and 64 bytes
+static const uint8_t cmacKey[16] = {
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+static const uint8_t cmacMessage[64] = {
+    0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+    0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+    0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11, 0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+    0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17, 0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10};
+static const uint8_t cmacLengths[4] = {0, 16, 40, 64};
+static const uint8_t cmacResults[4][16] = {
+    {0xbb, 0x1d, 0x69, 0x29, 0xe9, 0x59, 0x37, 0x28, 0x7f, 0xa3, 0x7d, 0x12, 0x9b, 0x75, 0x67, 0x46},
+    {0x07, 0x0a, 0x16, 0xb4, 0x6b, 0x4d, 0x41, 0x44, 0xf7, 0x9b, 0xdd, 0x9d, 0xd0, 0x4a, 0x28, 0x7c},
+    {0xdf, 0xa6, 0x67, 0x47, 0xde, 0x9a, 0xe6, 0x30, 0x30, 0xca, 0x32, 0x61, 0x14, 0x97, 0xc8, 0x27},
+    {0x51, 0xf0, 0xbe, 0xbf, 0x7e, 0x3b, 0x9d, 0x92, 0xfc, 0x49, 0x74, 0x17, 0x79, 0x36, 0x3c, 0xfe}};
+
+// Downlink to 0x01ABCDEF, FCnt 12, port 201 (tools/lorawan_crypto.py)
+static const uint8_t frameAppSKey[16] = {
+    0x7d, 0xb0, 0xce, 0x14, 0x09, 0x39, 0xfa, 0x39, 0xfc, 0x02, 0x12, 0xb2, 0x67, 0x87, 0x60, 0x8e};
+static const uint8_t frameNwkSKey[16] = {
+    0xff, 0xe8, 0xf8, 0x53, 0x9e, 0x6f, 0x21, 0x10, 0xfa, 0xa5, 0x03, 0xd2, 0xc8, 0x92, 0x9f, 0xa1};
+static const char framePlain[] = "hello multicast world, 12345678";
+static const uint8_t frameVector[44] = {
+    0x60, 0xef, 0xcd, 0xab, 0x01, 0x00, 0x0c, 0x00, 0xc9, 0xb4, 0xd0, 0xc5, 0x17, 0xa7, 0xde, 0x61,
+    0xb1, 0x7b, 0xb5, 0x1b, 0x33, 0x9b, 0xb5, 0xec, 0x1d, 0x50, 0xc9, 0x3a, 0xb0, 0x79, 0x8c, 0x2f,
+    0x93, 0x10, 0x8c, 0x17, 0x47, 0xc3, 0x20, 0xe1, 0x1a, 0x3e, 0x5a, 0x35};
+
+bool aesSelfTest(const AesBackend& aes) {
+    uint8_t block[16];
+    aes.encrypt(fipsKey, fipsPlain, block);
+    if (memcmp(block, fipsCipher, 16) != 0) {
+        return false;
+    }
+    aes.decrypt(fipsKey, fipsCipher, block);
+    if (memcmp(block, fipsPlain, 16) != 0) {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < 4; i++) {
+        cmacWith(aes, cmacKey, cmacMessage, cmacLengths[i], block);
+        if (memcmp(block, cmacResults[i], 16) != 0) {
+            return false;
+        }
+    }
+
+    uint8_t frame[sizeof(frameVector)];
+    size_t payloadLength = sizeof(framePlain) - 1;
+    memcpy(frame, frameVector, 9);
+    cryptWith(aes, frameAppSKey, LORAWAN_DOWNLINK, 0x01ABCDEF, 12, (const uint8_t*)framePlain, &frame[9], payloadLength);
+    micWith(aes, frameNwkSKey, LORAWAN_DOWNLINK, 0x01ABCDEF, 12, frame, 9 + payloadLength, &frame[9 + payloadLength]);
+    return memcmp(frame, frameVector, sizeof(frameVector)) == 0;
+}
+
+// ===============================================================
+// BACKEND SELECTION
+// ===============================================================
+
+bool selectAesBackend(bool hardware) {
+#ifdef ESP_PLATFORM
+    if (hardware) {
+        if (aesSelfTest(aesHardware)) {
+            backend = &aesHardware;
+            Serial.println("LoRaWAN Crypto: Hardware AES");
+            return true;
+        }
+        Serial.println("LoRaWAN Crypto: Hardware AES failed its test vectors, using mbedtls");
+    }
+#endif
+    backend = &aesMbedtls;
+    if (!aesSelfTest(aesMbedtls)) {
+        Serial.println("LoRaWAN Crypto: mbedtls AES failed its test vectors!");
+        return false;
+    }
+    Serial.println("LoRaWAN Crypto: mbedtls AES");
+    return true;
+}
+
+const AesBackend& activeAesBackend() {
+    return *backend;
+}
@@ -0,0 +1,77 @@
+#ifndef LORAWAN_CRYPTO_H
+#define LORAWAN_CRYPTO_H
+
+#include <Arduino.h>
+#include "../include/project_config.h"
+
+// ===============================================================
+// LORAWAN CRYPTO
+// ===============================================================
+//
+// AES-128 for the LoRaWAN crypto the firmware does itself (multicast
+// frames and TS005 keys, multicast_groups.cpp), on a pluggable backend:
+//
+//   mbedtls   the AES the firmware already links (on Arduino-ESP32 it
+//             runs on the AES peripheral a block at a time); always
+//             built, the only one on a host build and the fallback
+//   hardware  the ESP32-S3 AES peripheral driven directly (ESP_PLATFORM
+//             builds): payload key streams as one CTR run and CMAC
+//             chains as one CBC run through its DMA engine
+//
+// FRMPayload encryption is AES-CTR: Ai = [0x01][0 x4][dir][addr][FCnt]
+// [0][i], i from 1, is a counter block whose last byte counts, so the
+// whole payload is one CTR run. The MIC is AES-CMAC over B0 | message,
+// B0 = [0x49][0 x4][dir][addr][FCnt][0][length].
+//
+// selectAesBackend() checks a backend against FIPS-197, RFC 4493 and a
+// LoRaWAN frame built by tools/lorawan_crypto.py before using it.
+// Only this code uses the backends. RadioLib's MAC (join, uplink MIC and
+// payload) keeps its own software AES, since it has no hook for another
+// one.
+
+#define LORAWAN_UPLINK              0
+#define LORAWAN_DOWNLINK            1
+#define LORAWAN_MAX_MESSAGE         255     // MHDR to FRMPayload, MIC excluded
+
+struct AesBackend {
+    const char* name;
+    // One block each way
+    void (*encrypt)(const uint8_t* key, const uint8_t* input, uint8_t* output);
+    void (*decrypt)(const uint8_t* key, const uint8_t* input, uint8_t* output);
+    // CBC encryption of whole blocks: state is the IV in, the last cipher block out
+    void (*cbcMac)(const uint8_t* key, const uint8_t* data, size_t blocks, uint8_t* state);
+    // XOR with the key stream from counter (big-endian increment per block)
+    void (*ctr)(const uint8_t* key, const uint8_t* counter, const uint8_t* input, uint8_t* output, size_t length);
+};
+
+extern const AesBackend aesMbedtls;
+#ifdef ESP_PLATFORM
+extern const AesBackend aesHardware;
+#endif
+
+// ===============================================================
+// BACKEND SELECTION
+// ===============================================================
+
+// The hardware backend when asked for, available and correct; otherwise
+// mbedtls. Returns false when the chosen backend fails too
+bool selectAesBackend(bool hardware);
+const AesBackend& activeAesBackend();
+bool aesSelfTest(const AesBackend& backend);
+
+// ===============================================================
+// PRIMITIVES (ACTIVE BACKEND)
+// ===============================================================
+
+void aesEncryptBlock(const uint8_t* key, const uint8_t* input, uint8_t* output);
+void aesDecryptBlock(const uint8_t* key, const uint8_t* input, uint8_t* output);
+void aesCmac(const uint8_t* key, const uint8_t* data, size_t length, uint8_t* mac);
+
+// LoRaWAN frame MIC (4 bytes) over message (MHDR to FRMPayload, up to
+// LORAWAN_MAX_MESSAGE bytes) and FRMPayload encryption, the same both ways
+void lorawanFrameMic(const uint8_t* key, uint8_t direction, uint32_t address, uint32_t fCnt,
+                     const uint8_t* message, size_t length, uint8_t* mic);
+void lorawanCryptPayload(const uint8_t* key, uint8_t direction, uint32_t address, uint32_t fCnt,
+                         const uint8_t* input, uint8_t* output, size_t length);
+
+#endif // LORAWAN_CRYPTO_H
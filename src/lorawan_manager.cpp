@@ -1,6 +1,62 @@
 #include "lorawan_manager.h"
+#include "geofence_manager.h"
+#include "lorawan_crypto.h"
+#include "lorawan_region.h"
 #include <Preferences.h>
 
+// Set from the radio interrupt while a Class C session listens
+static volatile bool multicastReceived = false;
+
+static void IRAM_ATTR onMulticastReceived() {
+    multicastReceived = true;
+}
+
+// Bytes a bulk frame adds to its payload
+#if BULK_TRANSFER_MODE == BULK_FEC
+#define BULK_FRAME_OVERHEAD         (FEC_PARITY_HEADER + 1)
+#elif BULK_TRANSFER_MODE == BULK_ARQ
+#define BULK_FRAME_OVERHEAD         ARQ_HEADER
+#else
+#define BULK_FRAME_OVERHEAD         0
+#endif
+
+#if LORAWAN_MULTI_REGION
+// The bands this build can join, by RadioLib name (NVS key "region")
+struct RegionChoice {
+    const RegionPlan* plan;
+    const LoRaWANBand_t* band;
+};
+
+static const RegionChoice REGION_CHOICES[] = {
+    {&REGION_EU868, &EU868}, {&REGION_US915, &US915}, {&REGION_AU915, &AU915},
+    {&REGION_AS923, &AS923}, {&REGION_AS923_2, &AS923_2}, {&REGION_AS923_3, &AS923_3},
+    {&REGION_AS923_4, &AS923_4}};
+
+const RegionPlan* activeRegion = &REGION_PLAN_OF(LORAWAN_REGION);
+
+static const LoRaWANBand_t* selectRegion() {
+    String name;
+    Preferences prefs;
+    if (prefs.begin(STORAGE_NAMESPACE, true)) {
+        name = prefs.getString("region", "");
+        prefs.end();
+    }
+    
+    for (const RegionChoice& choice : REGION_CHOICES) {
+        if (name == choice.plan->name) {
+            activeRegion = choice.plan;
+            return choice.band;
+        }
+    }
+    activeRegion = &REGION_PLAN_OF(LORAWAN_REGION);
+    return &LORAWAN_REGION;
+}
+#else
+// A bulk frame must fit the fastest uplink rate of the band
+static_assert(BULK_MAX_PAYLOAD + BULK_FRAME_OVERHEAD <= Region::maxPayload(Region::maxUplinkDataRate()),
+              "BULK_MAX_PAYLOAD too long for LORAWAN_REGION");
+#endif
+
 // ===============================================================
 // CONSTRUCTOR & DESTRUCTOR
 // ===============================================================
@@ -14,6 +70,18 @@ LoRaWANManager::LoRaWANManager() :
     lastJoinAttempt(0),
     joinAttempts(0),
     txCounter(0),
+    uplinkRequested(false),
+    uplinkAcked(false),
+    txInterval(TX_INTERVAL_MS),
+    dataRate(LORAWAN_DR_ADR),
+    uplinkDataRate(LORAWAN_DR_ADR),
+    classCGroup(-1),
+    classCListening(false),
+    totalMulticastDropped(0),
+    downlinkLength(0),
+    downlinkPort(0),
+    downlinkGroup(-1),
+    downlinkPending(false),
     totalTransmissions(0),
     successfulTransmissions(0),
     failedTransmissions(0),
@@ -46,6 +114,18 @@ bool LoRaWANManager::begin() {
     
     // Try to load previous session
     loadSession();
+    arq.begin();
+    rxTiming.begin();
+    
+    // Multicast groups set up before the last reboot (their crypto runs
+    // on the AES backend)
+    selectAesBackend(LORAWAN_AES_HARDWARE);
+    uint8_t genAppKey[16];
+    if (hexStringToBytes(LORAWAN_GENAPPKEY, genAppKey, 16)) {
+        multicast.begin(genAppKey);
+    } else {
+        Serial.println("LoRaWAN Manager: Invalid GenAppKey, multicast groups disabled!");
+    }
     
     isInitialized = true;
     Serial.println("LoRaWAN Manager: Initialization successful!");
@@ -77,14 +157,19 @@ bool LoRaWANManager::initializeRadio() {
     radio->setCurrentLimit(140.0);  // mA
     
     // Create LoRaWAN node
+#if LORAWAN_MULTI_REGION
+    node = new LoRaWANNode(radio, selectRegion(), LORAWAN_SUBBAND);
+#else
     node = new LoRaWANNode(radio, &LORAWAN_REGION, LORAWAN_SUBBAND);
+#endif
     
     if (!node) {
         Serial.println("LoRaWAN Manager: Failed to create LoRaWAN node!");
         return false;
     }
     
-    Serial.println("LoRaWAN Manager: Radio initialized successfully!");
+    Serial.print("LoRaWAN Manager: Radio initialized successfully! Region ");
+    Serial.println(Region::name());
     return true;
 }
 
@@ -193,9 +278,10 @@ bool LoRaWANManager::sendGPSData(const GPSData& gpsData) {
         return false;
     }
     
-    // Encode GPS data
+    // Encode GPS data, at the fix's own precision when enabled
     uint8_t buffer[32];
-    size_t length = encodeGPSData(gpsData, buffer);
+    size_t length = GPS_ADAPTIVE_QUANTIZATION ? encodeGPSDataCompact(gpsData, buffer)
+                                              : encodeGPSData(gpsData, buffer);
     
     return sendCustomPayload(buffer, length, LORAWAN_PORT);
 }
@@ -212,6 +298,118 @@ bool LoRaWANManager::sendGeofenceEvent(const GeofenceEvent& event) {
     return sendCustomPayload(buffer, length, LORAWAN_PORT);
 }
 
+bool LoRaWANManager::sendRuleEvent(const RuleEvent& event) {
+    if (!canTransmit()) {
+        return false;
+    }
+    
+    // Encode rule event
+    uint8_t buffer[32];
+    size_t length = encodeRuleEvent(event, buffer);
+    
+    return sendCustomPayload(buffer, length, LORAWAN_PORT);
+}
+
+bool LoRaWANManager::sendTileEvent(const TileEvent& event) {
+    if (!canTransmit()) {
+        return false;
+    }
+    
+    // Encode tile fence event
+    uint8_t buffer[32];
+    size_t length = encodeTileEvent(event, buffer);
+    
+    return sendCustomPayload(buffer, length, LORAWAN_PORT);
+}
+
+bool LoRaWANManager::sendAlert(const SpeedAlert& alert) {
+    // Encode alert
+    uint8_t buffer[32];
+    size_t length = encodeSpeedAlert(alert, buffer);
+    
+    // Alerts skip the application interval and go out confirmed; when
+    // this one does not go out, neither does the skip
+    bool wasRequested = uplinkRequested;
+    uplinkRequested = true;
+    if (!canTransmit() || length > getMaxPayload() ||
+        !sendCustomPayload(buffer, length, LORAWAN_PORT, true)) {
+        uplinkRequested = wasRequested;
+        return false;
+    }
+    
+    // Sent but not acknowledged is for the caller to retry
+    if (!uplinkAcked) {
+        Serial.println("LoRaWAN Manager: Alert not acknowledged");
+        return false;
+    }
+    return true;
+}
+
+bool LoRaWANManager::sendTripEvent(const TripEvent& event) {
+    if (!canTransmit()) {
+        return false;
+    }
+    
+    // Encode trip start / end
+    uint8_t buffer[32];
+    size_t length = encodeTripEvent(event, buffer);
+    
+    return sendCustomPayload(buffer, length, LORAWAN_PORT);
+}
+
+bool LoRaWANManager::sendTripSummary(const TripSummary& summary) {
+    if (!canTransmit()) {
+        return false;
+    }
+    
+    // Encode trip summary with its waypoints
+    uint8_t buffer[32 + 4 * TRIP_MAX_WAYPOINTS];
+    size_t length = encodeTripSummary(summary, buffer);
+    
+    return sendCustomPayload(buffer, length, LORAWAN_PORT);
+}
+
+uint8_t LoRaWANManager::sendTrackBatch(const TrackPoint* points, uint8_t count) {
+    if (!canTransmit() || count == 0) {
+        return 0;
+    }
+    
+    // Encode buffered track (first point absolute, then varint steps),
+    // dropping points from the end until it fits the data rate
+    uint8_t buffer[14 + 15 * TRACK_BATCH_POINTS];
+    size_t room = min((size_t)getMaxPayload() - BULK_FRAME_OVERHEAD, sizeof(buffer));
+    count = min(count, (uint8_t)TRACK_BATCH_POINTS);
+    size_t length = encodeTrackBatch(points, count, buffer);
+    while (length > room && count > 1) {
+        count--;
+        length = encodeTrackBatch(points, count, buffer);
+    }
+    
+    return sendBulkFrame(buffer, length) ? count : 0;
+}
+
+bool LoRaWANManager::sendOccupancyReport(const OccupancyReport& report, uint8_t& next) {
+    if (!canTransmit()) {
+        return false;
+    }
+    
+    // Encode per-fence day statistics from `next`, dropping entries from
+    // the end until the frame fits the data rate; the rest follow
+    uint8_t buffer[8 + 8 * MAX_GEOFENCES];
+    uint8_t count = report.count - min(next, report.count);
+    size_t length = encodeOccupancyReport(report, next, count, buffer);
+    while (length > getMaxPayload() && count > 1) {
+        count--;
+        length = encodeOccupancyReport(report, next, count, buffer);
+    }
+    
+    if (!sendCustomPayload(buffer, length, LORAWAN_PORT)) {
+        return false;
+    }
+    next += count;
+    return true;
+}
+
 bool LoRaWANManager::sendStatusUpdate(const StatusUpdate& status) {
     if (!canTransmit()) {
         return false;
@@ -224,25 +422,84 @@ bool LoRaWANManager::sendStatusUpdate(const StatusUpdate& status) {
     return sendCustomPayload(buffer, length, LORAWAN_PORT);
 }
 
-bool LoRaWANManager::sendCustomPayload(uint8_t* payload, size_t length, uint8_t port) {
+bool LoRaWANManager::sendTileSyncNode(const TileSyncNode& node) {
+    if (!canTransmit()) {
+        return false;
+    }
+    
+    // Encode tree node for the backend's sync walk
+    uint8_t buffer[8 + 4 * 16];
+    size_t length = encodeTileSyncNode(node, buffer);
+    
+    return sendCustomPayload(buffer, length, LORAWAN_PORT);
+}
+
+bool LoRaWANManager::sendTileSyncStatus(const TileSyncStatus& status) {
+    if (!canTransmit()) {
+        return false;
+    }
+    
+    // Encode tile write / delete outcome
+    uint8_t buffer[16];
+    size_t length = encodeTileSyncStatus(status, buffer);
+    
+    return sendCustomPayload(buffer, length, LORAWAN_PORT);
+}
+
+bool LoRaWANManager::sendCustomPayload(uint8_t* payload, size_t length, uint8_t port, bool confirmed) {
     if (!canTransmit()) {
         Serial.println("LoRaWAN Manager: Cannot transmit at this time!");
         return false;
     }
     
+    // RadioLib would fail it only after the duty-cycle wait
+    if (length > getMaxPayload()) {
+        Serial.print("LoRaWAN Manager: Payload too long for the data rate (");
+        Serial.print(length);
+        Serial.print(" > ");
+        Serial.print(getMaxPayload());
+        Serial.println(" bytes)!");
+        failedTransmissions++;
+        return false;
+    }
+    
     Serial.print("LoRaWAN Manager: Sending payload (");
     Serial.print(length);
     Serial.print(" bytes) on port ");
     Serial.println(port);
     
     totalTransmissions++;
+    uplinkRequested = false;
     
-    // Send uplink
-    int state = node->sendReceive(payload, length, port);
+    // Send uplink; a positive result is the RX window a downlink arrived in
+    uint8_t rxBuffer[LORAWAN_DOWNLINK_BUFFER_SIZE];
+    size_t rxLength = 0;
+    LoRaWANEvent_t uplinkEvent;
+    LoRaWANEvent_t downlinkEvent;
+    stopClassC();   // The node has the radio for the exchange
+    node->scanGuard = rxTiming.getGuard();
+    uint32_t started = micros();
+    int state = node->sendReceive(payload, length, port, rxBuffer, &rxLength, confirmed, &uplinkEvent, &downlinkEvent);
+    uint32_t elapsed = micros() - started;
     
-    if (state == RADIOLIB_ERR_NONE) {
+    if (state >= RADIOLIB_ERR_NONE) {
         Serial.println("LoRaWAN Manager: Transmission successful!");
+        uplinkDataRate = uplinkEvent.datarate;
+        updateRxTiming(state, elapsed, length, uplinkEvent, downlinkEvent, confirmed);
+        uplinkAcked = !confirmed || (state > 0 && downlinkEvent.confirming);
+        if (state > 0 && rxLength > 0) {
+            memcpy(downlinkBuffer, rxBuffer, rxLength);
+            downlinkLength = rxLength;
+            downlinkPort = downlinkEvent.fPort;
+            downlinkGroup = -1;
+            downlinkPending = true;
+            Serial.print("LoRaWAN Manager: Downlink received (");
+            Serial.print(rxLength);
+            Serial.print(" bytes) on port ");
+            Serial.println(downlinkPort);
+        }
         successfulTransmissions++;
+        arq.uplinkSent();
         lastTxTime = millis();
         txCounter++;
         saveSession(); // Update session after successful TX
@@ -255,6 +512,114 @@ bool LoRaWANManager::sendCustomPayload(uint8_t* payload, size_t length, uint8_t
     }
 }
 
+void LoRaWANManager::updateRxTiming(int window, uint32_t elapsed, size_t length,
+                                    const LoRaWANEvent_t& uplink, const LoRaWANEvent_t& downlink, bool confirmed) {
+    // Uplink airtime as sent without FOpts; when RadioLib's own figure
+    // disagrees, MAC answers rode along and the exchange is not measured
+    uint32_t uplinkAirtime = loraTimeOnAir(Region::spreadingFactor(uplink.datarate),
+                                           Region::bandwidth(uplink.datarate),
+                                           length + LORAWAN_FRAME_OVERHEAD, true);
+    if (abs((int32_t)(uplinkAirtime / 1000) - (int32_t)node->getLastToA()) > 1) {
+        uplinkAirtime = 0;
+    }
+    
+    // Downlinks carry no CRC; the radio still holds the frame's length
+    uint32_t downlinkAirtime = 0;
+    if (window > 0) {
+        downlinkAirtime = loraTimeOnAir(Region::spreadingFactor(downlink.datarate),
+                                        Region::bandwidth(downlink.datarate),
+                                        radio->getPacketLength(), false);
+    }
+    
+    rxTiming.exchange(window, elapsed, uplinkAirtime, downlinkAirtime);
+    if (confirmed && window == 0) {
+        rxTiming.downlinkMissed();
+    }
+}
+
+bool LoRaWANManager::canSendBulk() const {
+    switch (BULK_TRANSFER_MODE) {
+        case BULK_FEC:
+            return !fec.isParityPending();
+        case BULK_ARQ:
+            return arq.canAccept();
+        default:
+            return true;
+    }
+}
+
+bool LoRaWANManager::sendBulkFrame(const uint8_t* payload, size_t length) {
+    // Too long for the protected formats goes out unprotected
+    uint8_t frame[FEC_SOURCE_HEADER + FEC_MAX_SYMBOL];
+    size_t frameLength = 0;
+    if (!canSendBulk()) {
+        return false;
+    } else if (BULK_TRANSFER_MODE == BULK_FEC) {
+        frameLength = fec.encodeSource(payload, length, frame);
+    } else if (BULK_TRANSFER_MODE == BULK_ARQ) {
+        frameLength = arq.encode(payload, length, frame);
+    }
+    
+    if (frameLength == 0) {
+        return sendCustomPayload((uint8_t*)payload, length, LORAWAN_PORT);
+    }
+    
+    if (!sendCustomPayload(frame, frameLength, LORAWAN_PORT)) {
+        return false;
+    }
+    
+    if (BULK_TRANSFER_MODE == BULK_FEC) {
+        fec.addSource(payload, length, millis());
+    } else {
+        arq.add(payload, length, millis());
+    }
+    return true;
+}
+
+bool LoRaWANManager::sendBulkRepair() {
+    uint8_t frame[FEC_PARITY_HEADER + FEC_MAX_SYMBOL];
+    size_t length = 0;
+    if (BULK_TRANSFER_MODE == BULK_FEC) {
+        fec.update(millis());
+        length = fec.nextParity(frame);
+    } else if (BULK_TRANSFER_MODE == BULK_ARQ) {
+        length = arq.nextRepair(frame, millis());
+    }
+    
+    if (length == 0) {
+        return false;
+    }
+    
+    // Parity is as long as the group's longest source; when the data rate
+    // has dropped since, the group goes without the rest of it
+    if (BULK_TRANSFER_MODE == BULK_FEC && length > getMaxPayload()) {
+        Serial.println("LoRaWAN Manager: Parity too long for the data rate, group abandoned");
+        fec.abandonParity();
+        return false;
+    }
+    
+    // A repeat waits for a rate that carries it, unless none can
+    if (BULK_TRANSFER_MODE == BULK_ARQ && !canEverFit(length)) {
+        Serial.println("LoRaWAN Manager: Bulk frame too long for any data rate, abandoned");
+        arq.repairAbandoned();
+        return false;
+    }
+    if (length > getMaxPayload()) {
+        return false;
+    }
+    
+    if (!sendCustomPayload(frame, length, LORAWAN_PORT)) {
+        return false;
+    }
+    
+    if (BULK_TRANSFER_MODE == BULK_FEC) {
+        fec.parityDone();
+    } else {
+        arq.repairDone(millis());
+    }
+    return true;
+}
+
 // ===============================================================
 // STATUS & MONITORING
 // ===============================================================
@@ -264,26 +629,50 @@ bool LoRaWANManager::canTransmit() const {
         return false;
     }
     
+    // User-forced uplink skips the application interval; RadioLib still
+    // enforces the regional duty cycle
+    if (uplinkRequested) {
+        return true;
+    }
+    
     // Check duty cycle / rate limiting
     uint32_t now = millis();
-    if (now - lastTxTime < TX_INTERVAL_MS) {
+    if (now - lastTxTime < txInterval) {
         return false;
     }
     
     return true;
 }
 
+uint8_t LoRaWANManager::getMaxPayload() const {
+    // A fixed rate is known; under ADR the last uplink's rate is the best
+    // guess, and before any uplink only what every rate carries is safe
+    if (dataRate != LORAWAN_DR_ADR) {
+        return Region::maxPayload(dataRate);
+    }
+    if (uplinkDataRate != LORAWAN_DR_ADR) {
+        return Region::maxPayload(uplinkDataRate);
+    }
+    return Region::minUplinkPayload();
+}
+
+bool LoRaWANManager::canEverFit(size_t length) const {
+    // A fixed rate is all there is; under ADR the fastest one may come back
+    uint8_t dr = (dataRate != LORAWAN_DR_ADR) ? dataRate : Region::maxUplinkDataRate();
+    return length <= Region::maxPayload(dr);
+}
+
 uint32_t LoRaWANManager::getNextTxTime() const {
-    if (!isJoined) {
+    if (!isJoined || uplinkRequested) {
         return 0;
     }
     
     uint32_t elapsed = millis() - lastTxTime;
-    if (elapsed >= TX_INTERVAL_MS) {
+    if (elapsed >= txInterval) {
         return 0; // Can transmit now
     }
     
-    return TX_INTERVAL_MS - elapsed;
+    return txInterval - elapsed;
 }
 
 float LoRaWANManager::getSuccessRate() const {
@@ -300,6 +689,213 @@ void LoRaWANManager::getStatistics(uint32_t& total, uint32_t& success, uint32_t&
     failed = failedTransmissions;
 }
 
+// ===============================================================
+// CONFIGURATION
+// ===============================================================
+
+void LoRaWANManager::setTxInterval(uint32_t intervalMs) {
+    // RadioLib still enforces the regional duty cycle underneath
+    txInterval = intervalMs;
+}
+
+void LoRaWANManager::setDataRate(uint8_t dr) {
+    if (dr != LORAWAN_DR_ADR && (dr > Region::maxUplinkDataRate() || Region::maxPayload(dr) == 0)) {
+        Serial.print("LoRaWAN Manager: DR");
+        Serial.print(dr);
+        Serial.print(" not an uplink rate in ");
+        Serial.println(Region::name());
+        return;
+    }
+    dataRate = dr;
+    if (!node) {
+        return;
+    }
+
+    if (dr == LORAWAN_DR_ADR) {
+        node->setADR(true);
+        return;
+    }
+
+    node->setADR(false);
+    int16_t state = node->setDatarate(dr);
+    if (state != RADIOLIB_ERR_NONE) {
+        Serial.print("LoRaWAN Manager: DR");
+        Serial.print(dr);
+        Serial.print(" rejected, code ");
+        Serial.println(state);
+        node->setADR(true);
+    }
+}
+
+// ===============================================================
+// DOWNLINK HANDLING
+// ===============================================================
+
+bool LoRaWANManager::hasDownlink() {
+    return downlinkPending;
+}
+
+bool LoRaWANManager::getDownlink(uint8_t* buffer, size_t& length, uint8_t& port) {
+    if (!downlinkPending) {
+        return false;
+    }
+    
+    memcpy(buffer, downlinkBuffer, downlinkLength);
+    length = downlinkLength;
+    port = downlinkPort;
+    downlinkPending = false;
+    return true;
+}
+
+// ===============================================================
+// MULTICAST
+// ===============================================================
+
+bool LoRaWANManager::handleMulticastSetup(const uint8_t* payload, size_t length, uint32_t unixTime) {
+    return multicast.handleDownlink(payload, length, unixTime);
+}
+
+bool LoRaWANManager::getMulticastAnswer(uint8_t* buffer, size_t& length) {
+    return multicast.getAnswer(buffer, length);
+}
+
+void LoRaWANManager::updateMulticast(uint32_t unixTime) {
+    if (!isInitialized) {
+        return;
+    }
+    
+    int8_t active = isJoined ? multicast.getActiveSession(unixTime) : -1;
+    if (active != classCGroup) {
+        if (classCGroup >= 0) {
+            stopClassC();
+            multicast.endSession(classCGroup);
+            Serial.println("LoRaWAN Manager: Class C session over");
+        }
+        classCGroup = active;
+    }
+    
+    // Listen again after each Class A exchange
+    if (classCGroup >= 0 && !classCListening && !startClassC()) {
+        Serial.println("LoRaWAN Manager: Radio refused the Class C session, dropping it");
+        multicast.endSession(classCGroup);
+        classCGroup = -1;
+    }
+    
+    if (classCListening && multicastReceived) {
+        receiveMulticast();
+    }
+}
+
+bool LoRaWANManager::startClassC() {
+    const MulticastSession& session = multicast.getSession(classCGroup);
+    uint8_t spreadingFactor = Region::spreadingFactor(session.dataRate);
+    float bandwidth = Region::bandwidth(session.dataRate);
+    
+    // Downlink modulation: inverted IQ, LoRaWAN sync word and preamble
+    bool ok = radio->standby() == RADIOLIB_ERR_NONE &&
+              radio->setFrequency(session.frequency / 1000000.0) == RADIOLIB_ERR_NONE &&
+              radio->setBandwidth(bandwidth) == RADIOLIB_ERR_NONE &&
+              radio->setSpreadingFactor(spreadingFactor) == RADIOLIB_ERR_NONE &&
+              radio->setCodingRate(5) == RADIOLIB_ERR_NONE &&
+              radio->setSyncWord(RADIOLIB_LORAWAN_LORA_SYNC_WORD) == RADIOLIB_ERR_NONE &&
+              radio->setPreambleLength(RADIOLIB_LORAWAN_LORA_PREAMBLE_LEN) == RADIOLIB_ERR_NONE &&
+              radio->invertIQ(true) == RADIOLIB_ERR_NONE;
+    if (ok) {
+        multicastReceived = false;
+        radio->setPacketReceivedAction(onMulticastReceived);
+        ok = radio->startReceive() == RADIOLIB_ERR_NONE;
+    }
+    
+    classCListening = ok;
+    return ok;
+}
+
+void LoRaWANManager::stopClassC() {
+    if (!classCListening) {
+        return;
+    }
+    
+    radio->clearPacketReceivedAction();
+    radio->standby();
+    radio->invertIQ(false);
+    classCListening = false;
+}
+
+void LoRaWANManager::receiveMulticast() {
+    multicastReceived = false;
+    
+    uint8_t frame[LORAWAN_DOWNLINK_BUFFER_SIZE];
+    size_t length = radio->getPacketLength();
+    int state = length <= sizeof(frame) ? radio->readData(frame, length) : RADIOLIB_ERR_PACKET_TOO_LONG;
+    radio->startReceive();
+    if (state != RADIOLIB_ERR_NONE) {
+        return;
+    }
+    
+    uint8_t payload[LORAWAN_DOWNLINK_BUFFER_SIZE];
+    size_t payloadLength = 0;
+    uint8_t port = 0;
+    if (!multicast.decodeFrame(classCGroup, frame, length, payload, payloadLength, port)) {
+        return;
+    }
+    
+    // One downlink buffer: a frame arriving before the last is handled
+    // is lost, which the fragment parity or a repeat covers
+    if (downlinkPending) {
+        totalMulticastDropped++;
+        return;
+    }
+    memcpy(downlinkBuffer, payload, payloadLength);
+    downlinkLength = payloadLength;
+    downlinkPort = port;
+    downlinkGroup = classCGroup;
+    downlinkPending = true;
+}
+
+void LoRaWANManager::printMulticastStatistics() {
+    multicast.printStatistics();
+    Serial.print("Class C: ");
+    Serial.print(classCListening ? "listening, group " : "off");
+    if (classCListening) {
+        Serial.print(classCGroup);
+    }
+    Serial.print(", frames dropped behind a pending downlink: ");
+    Serial.println(totalMulticastDropped);
+}
+
+uint8_t LoRaWANManager::handleDownlink(const uint8_t* payload, size_t length) {
+    if (length < 1) {
+        return CONFIG_UNKNOWN;
+    }
+    
+    switch (payload[0]) {
+        case CMD_SET_FEC_LOSS:
+            // Loss the backend measured on bulk groups (lost / sent)
+            if (length < 2) {
+                Serial.println("LoRaWAN Manager: Malformed bulk loss downlink");
+                return CONFIG_REJECTED;
+            }
+            fec.setLossRate(payload[1] / 256.0);
+            Serial.print("LoRaWAN Manager: Bulk loss ");
+            Serial.print(fec.getLossRate() * 100, 1);
+            Serial.print("%, ");
+            Serial.print(fec.parityFor(FEC_GROUP_SIZE));
+            Serial.print(" parity per ");
+            Serial.println(FEC_GROUP_SIZE);
+            return CONFIG_APPLIED;
+        
+        case CMD_BULK_ACK:
+            if (!arq.handleAck(&payload[1], length - 1)) {
+                Serial.println("LoRaWAN Manager: Stale bulk acknowledgement");
+                return CONFIG_REJECTED;
+            }
+            return CONFIG_APPLIED;
+        
+        default:
+            return CONFIG_UNKNOWN;
+    }
+}
+
 // ===============================================================
 // SESSION MANAGEMENT
 // ===============================================================
@@ -403,6 +999,55 @@ size_t encodeGPSData(const GPSData& gps, uint8_t* buffer) {
     return 13;
 }
 
+uint8_t quantizationExponent(uint8_t hdop) {
+    // Largest power-of-two step (micro-degrees) whose worst-case rounding
+    // error, half a step on each axis, stays within the allowed fraction
+    // of the fix accuracy
+    float accuracy = hdop / 10.0 * GPS_UERE_METERS * GPS_QUANT_ERROR_FRACTION;
+    float maxStep = accuracy / (METERS_PER_MICRODEGREE * 0.70710678);
+    uint8_t exponent = 0;
+    while (exponent < 15 && (float)(2UL << exponent) <= maxStep) {
+        exponent++;
+    }
+    return exponent;
+}
+
+// Append `bits` bits of `value`, most significant first
+static void putBits(uint8_t* buffer, uint16_t& bitPos, uint32_t value, uint8_t bits) {
+    while (bits > 0) {
+        bits--;
+        if ((value >> bits) & 1) {
+            buffer[bitPos >> 3] |= 0x80 >> (bitPos & 7);
+        }
+        bitPos++;
+    }
+}
+
+size_t encodeGPSDataCompact(const GPSData& gps, uint8_t* buffer) {
+    // Header: precision exponent e (step = 2^e micro-degrees) in the low
+    // nibble, 0x80 = altitude follows. Then a bit stream of latitude and
+    // longitude cell indexes, each just wide enough for its range at
+    // that step, and the altitude as 16 bits.
+    uint8_t exponent = quantizationExponent(gps.hdop);
+    uint8_t latBits = 32 - __builtin_clz(180000000UL >> exponent);
+    uint8_t lonBits = 32 - __builtin_clz(360000000UL >> exponent);
+    uint8_t altBits = GPS_COMPACT_ALTITUDE ? 16 : 0;
+    size_t length = 2 + (latBits + lonBits + altBits + 7) / 8;
+    memset(buffer, 0, length);
+    
+    buffer[0] = MSG_TYPE_GPS_COMPACT;
+    buffer[1] = exponent | (GPS_COMPACT_ALTITUDE ? 0x80 : 0x00);
+    
+    uint16_t bitPos = 16;
+    putBits(buffer, bitPos, (uint32_t)(gps.latitude + 90000000L) >> exponent, latBits);
+    putBits(buffer, bitPos, (uint32_t)(gps.longitude + 180000000L) >> exponent, lonBits);
+    if (altBits) {
+        putBits(buffer, bitPos, (uint16_t)gps.altitude, altBits);
+    }
+    
+    return length;
+}
+
 size_t encodeGeofenceEvent(const GeofenceEvent& event, uint8_t* buffer) {
     buffer[0] = MSG_TYPE_GEOFENCE_EVENT;
     buffer[1] = event.geofence_id;
@@ -429,6 +1074,333 @@ size_t encodeGeofenceEvent(const GeofenceEvent& event, uint8_t* buffer) {
     return 15;
 }
 
+size_t encodeRuleEvent(const RuleEvent& event, uint8_t* buffer) {
+    buffer[0] = MSG_TYPE_RULE_EVENT;
+    buffer[1] = event.rule_id;
+    buffer[2] = event.event_type;
+    
+    // Latitude (4 bytes)
+    buffer[3] = (event.latitude >> 24) & 0xFF;
+    buffer[4] = (event.latitude >> 16) & 0xFF;
+    buffer[5] = (event.latitude >> 8) & 0xFF;
+    buffer[6] = event.latitude & 0xFF;
+    
+    // Longitude (4 bytes)
+    buffer[7] = (event.longitude >> 24) & 0xFF;
+    buffer[8] = (event.longitude >> 16) & 0xFF;
+    buffer[9] = (event.longitude >> 8) & 0xFF;
+    buffer[10] = event.longitude & 0xFF;
+    
+    // Timestamp (4 bytes)
+    buffer[11] = (event.timestamp >> 24) & 0xFF;
+    buffer[12] = (event.timestamp >> 16) & 0xFF;
+    buffer[13] = (event.timestamp >> 8) & 0xFF;
+    buffer[14] = event.timestamp & 0xFF;
+    
+    return 15;
+}
+
+size_t encodeTileEvent(const TileEvent& event, uint8_t* buffer) {
+    buffer[0] = MSG_TYPE_TILE_EVENT;
+    buffer[1] = (event.fence_id >> 8) & 0xFF;
+    buffer[2] = event.fence_id & 0xFF;
+    buffer[3] = event.event_type;
+    
+    // Latitude (4 bytes)
+    buffer[4] = (event.latitude >> 24) & 0xFF;
+    buffer[5] = (event.latitude >> 16) & 0xFF;
+    buffer[6] = (event.latitude >> 8) & 0xFF;
+    buffer[7] = event.latitude & 0xFF;
+    
+    // Longitude (4 bytes)
+    buffer[8] = (event.longitude >> 24) & 0xFF;
+    buffer[9] = (event.longitude >> 16) & 0xFF;
+    buffer[10] = (event.longitude >> 8) & 0xFF;
+    buffer[11] = event.longitude & 0xFF;
+    
+    // Timestamp (4 bytes)
+    buffer[12] = (event.timestamp >> 24) & 0xFF;
+    buffer[13] = (event.timestamp >> 16) & 0xFF;
+    buffer[14] = (event.timestamp >> 8) & 0xFF;
+    buffer[15] = event.timestamp & 0xFF;
+    
+    return 16;
+}
+
+size_t encodeSpeedAlert(const SpeedAlert& alert, uint8_t* buffer) {
+    buffer[0] = MSG_TYPE_ALERT;
+    buffer[1] = alert.alert_type;
+    buffer[2] = alert.geofence_id;
+    buffer[3] = alert.speed_limit;
+    buffer[4] = alert.peak_speed;
+    
+    // Duration (2 bytes)
+    buffer[5] = (alert.duration >> 8) & 0xFF;
+    buffer[6] = alert.duration & 0xFF;
+    
+    // Latitude (4 bytes)
+    buffer[7] = (alert.latitude >> 24) & 0xFF;
+    buffer[8] = (alert.latitude >> 16) & 0xFF;
+    buffer[9] = (alert.latitude >> 8) & 0xFF;
+    buffer[10] = alert.latitude & 0xFF;
+    
+    // Longitude (4 bytes)
+    buffer[11] = (alert.longitude >> 24) & 0xFF;
+    buffer[12] = (alert.longitude >> 16) & 0xFF;
+    buffer[13] = (alert.longitude >> 8) & 0xFF;
+    buffer[14] = alert.longitude & 0xFF;
+    
+    // Timestamp (4 bytes)
+    buffer[15] = (alert.timestamp >> 24) & 0xFF;
+    buffer[16] = (alert.timestamp >> 16) & 0xFF;
+    buffer[17] = (alert.timestamp >> 8) & 0xFF;
+    buffer[18] = alert.timestamp & 0xFF;
+    
+    return 19;
+}
+
+size_t encodeTripEvent(const TripEvent& event, uint8_t* buffer) {
+    buffer[0] = MSG_TYPE_TRIP;
+    buffer[1] = event.event_type;
+    buffer[2] = (event.trip_id >> 8) & 0xFF;
+    buffer[3] = event.trip_id & 0xFF;
+    
+    // Latitude (4 bytes)
+    buffer[4] = (event.latitude >> 24) & 0xFF;
+    buffer[5] = (event.latitude >> 16) & 0xFF;
+    buffer[6] = (event.latitude >> 8) & 0xFF;
+    buffer[7] = event.latitude & 0xFF;
+    
+    // Longitude (4 bytes)
+    buffer[8] = (event.longitude >> 24) & 0xFF;
+    buffer[9] = (event.longitude >> 16) & 0xFF;
+    buffer[10] = (event.longitude >> 8) & 0xFF;
+    buffer[11] = event.longitude & 0xFF;
+    
+    // Timestamp (4 bytes)
+    buffer[12] = (event.timestamp >> 24) & 0xFF;
+    buffer[13] = (event.timestamp >> 16) & 0xFF;
+    buffer[14] = (event.timestamp >> 8) & 0xFF;
+    buffer[15] = event.timestamp & 0xFF;
+    
+    // Odometer (4 bytes)
+    buffer[16] = (event.odometer >> 24) & 0xFF;
+    buffer[17] = (event.odometer >> 16) & 0xFF;
+    buffer[18] = (event.odometer >> 8) & 0xFF;
+    buffer[19] = event.odometer & 0xFF;
+    
+    return 20;
+}
+
+size_t encodeTripSummary(const TripSummary& summary, uint8_t* buffer) {
+    buffer[0] = MSG_TYPE_TRIP;
+    buffer[1] = TRIP_SUMMARY;
+    buffer[2] = (summary.trip_id >> 8) & 0xFF;
+    buffer[3] = summary.trip_id & 0xFF;
+    
+    // Start time (4 bytes)
+    buffer[4] = (summary.start_time >> 24) & 0xFF;
+    buffer[5] = (summary.start_time >> 16) & 0xFF;
+    buffer[6] = (summary.start_time >> 8) & 0xFF;
+    buffer[7] = summary.start_time & 0xFF;
+    
+    // Duration (2 bytes)
+    buffer[8] = (summary.duration >> 8) & 0xFF;
+    buffer[9] = summary.duration & 0xFF;
+    
+    // Distance (4 bytes)
+    buffer[10] = (summary.distance >> 24) & 0xFF;
+    buffer[11] = (summary.distance >> 16) & 0xFF;
+    buffer[12] = (summary.distance >> 8) & 0xFF;
+    buffer[13] = summary.distance & 0xFF;
+    
+    buffer[14] = summary.max_speed;
+    buffer[15] = summary.avg_speed;
+    
+    // Start latitude (4 bytes)
+    buffer[16] = (summary.start_latitude >> 24) & 0xFF;
+    buffer[17] = (summary.start_latitude >> 16) & 0xFF;
+    buffer[18] = (summary.start_latitude >> 8) & 0xFF;
+    buffer[19] = summary.start_latitude & 0xFF;
+    
+    // Start longitude (4 bytes)
+    buffer[20] = (summary.start_longitude >> 24) & 0xFF;
+    buffer[21] = (summary.start_longitude >> 16) & 0xFF;
+    buffer[22] = (summary.start_longitude >> 8) & 0xFF;
+    buffer[23] = summary.start_longitude & 0xFF;
+    
+    // Waypoints (2 + 2 bytes each, steps from the previous point)
+    uint8_t count = min(summary.waypoint_count, (uint8_t)TRIP_MAX_WAYPOINTS);
+    buffer[24] = count;
+    size_t length = 25;
+    for (uint8_t i = 0; i < count; i++) {
+        buffer[length++] = (summary.waypoints[i][0] >> 8) & 0xFF;
+        buffer[length++] = summary.waypoints[i][0] & 0xFF;
+        buffer[length++] = (summary.waypoints[i][1] >> 8) & 0xFF;
+        buffer[length++] = summary.waypoints[i][1] & 0xFF;
+    }
+    
+    return length;
+}
+
+// Zigzag varint, 1-5 bytes
+static size_t putVarint(int32_t value, uint8_t* buffer) {
+    uint32_t zigzag = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+    size_t length = 0;
+    while (zigzag >= 0x80) {
+        buffer[length++] = (zigzag & 0x7F) | 0x80;
+        zigzag >>= 7;
+    }
+    buffer[length++] = zigzag;
+    return length;
+}
+
+size_t encodeTrackBatch(const TrackPoint* points, uint8_t count, uint8_t* buffer) {
+    buffer[0] = MSG_TYPE_TRACK;
+    buffer[1] = count;
+    if (count == 0) {
+        return 2;
+    }
+    
+    // First point: latitude, longitude, timestamp (4 bytes each)
+    buffer[2] = (points[0].latitude >> 24) & 0xFF;
+    buffer[3] = (points[0].latitude >> 16) & 0xFF;
+    buffer[4] = (points[0].latitude >> 8) & 0xFF;
+    buffer[5] = points[0].latitude & 0xFF;
+    buffer[6] = (points[0].longitude >> 24) & 0xFF;
+    buffer[7] = (points[0].longitude >> 16) & 0xFF;
+    buffer[8] = (points[0].longitude >> 8) & 0xFF;
+    buffer[9] = points[0].longitude & 0xFF;
+    buffer[10] = (points[0].timestamp >> 24) & 0xFF;
+    buffer[11] = (points[0].timestamp >> 16) & 0xFF;
+    buffer[12] = (points[0].timestamp >> 8) & 0xFF;
+    buffer[13] = points[0].timestamp & 0xFF;
+    size_t length = 14;
+    
+    // Then steps in TRACK_DELTA_UNIT and seconds, taken from the previous
+    // reconstructed point so rounding does not accumulate
+    int32_t lat = points[0].latitude;
+    int32_t lon = points[0].longitude;
+    for (uint8_t i = 1; i < count; i++) {
+        int32_t dLat = points[i].latitude - lat;
+        int32_t dLon = points[i].longitude - lon;
+        if (dLon > 180000000L) dLon -= 360000000L;
+        if (dLon < -180000000L) dLon += 360000000L;
+        dLat = (dLat >= 0 ? dLat + TRACK_DELTA_UNIT / 2 : dLat - TRACK_DELTA_UNIT / 2) / TRACK_DELTA_UNIT;
+        dLon = (dLon >= 0 ? dLon + TRACK_DELTA_UNIT / 2 : dLon - TRACK_DELTA_UNIT / 2) / TRACK_DELTA_UNIT;
+        length += putVarint(dLat, &buffer[length]);
+        length += putVarint(dLon, &buffer[length]);
+        length += putVarint(points[i].timestamp - points[i - 1].timestamp, &buffer[length]);
+        lat += dLat * TRACK_DELTA_UNIT;
+        lon += dLon * TRACK_DELTA_UNIT;
+    }
+    
+    return length;
+}
+
+size_t encodeOccupancyReport(const OccupancyReport& report, uint8_t first, uint8_t count, uint8_t* buffer) {
+    // Entries [first, first + count) of the report
+    uint8_t total = min(report.count, (uint8_t)MAX_GEOFENCES);
+    first = min(first, total);
+    count = min(count, (uint8_t)(total - first));
+    
+    buffer[0] = MSG_TYPE_OCCUPANCY;
+    
+    // Day (2 bytes), flags, covered minutes (2 bytes), count in this frame
+    buffer[1] = (report.day >> 8) & 0xFF;
+    buffer[2] = report.day & 0xFF;
+    buffer[3] = report.flags | (first + count < total ? OCCUPANCY_MORE : 0);
+    buffer[4] = (report.covered_minutes >> 8) & 0xFF;
+    buffer[5] = report.covered_minutes & 0xFF;
+    buffer[6] = count;
+    size_t length = 7;
+    
+    // Entries (8 bytes each)
+    for (uint8_t i = first; i < first + count; i++) {
+        const OccupancyEntry& entry = report.entries[i];
+        buffer[length++] = entry.fence_id;
+        buffer[length++] = entry.visits;
+        buffer[length++] = (entry.inside_minutes >> 8) & 0xFF;
+        buffer[length++] = entry.inside_minutes & 0xFF;
+        buffer[length++] = (entry.first_entry >> 8) & 0xFF;
+        buffer[length++] = entry.first_entry & 0xFF;
+        buffer[length++] = (entry.last_entry >> 8) & 0xFF;
+        buffer[length++] = entry.last_entry & 0xFF;
+    }
+    
+    return length;
+}
+
+size_t encodeStatusUpdate(const StatusUpdate& status, uint8_t* buffer) {
+    buffer[0] = MSG_TYPE_STATUS_UPDATE;
+    buffer[1] = status.battery_level;
+    buffer[2] = (status.uptime_hours >> 8) & 0xFF;
+    buffer[3] = status.uptime_hours & 0xFF;
+    buffer[4] = status.gps_status;
+    buffer[5] = status.system_status;
+    
+    // Fence root (4 bytes), tile count (2 bytes)
+    buffer[6] = (status.fence_root >> 24) & 0xFF;
+    buffer[7] = (status.fence_root >> 16) & 0xFF;
+    buffer[8] = (status.fence_root >> 8) & 0xFF;
+    buffer[9] = status.fence_root & 0xFF;
+    buffer[10] = (status.tile_count >> 8) & 0xFF;
+    buffer[11] = status.tile_count & 0xFF;
+    
+    // Firmware id (4 bytes)
+    buffer[12] = (status.firmware_id >> 24) & 0xFF;
+    buffer[13] = (status.firmware_id >> 16) & 0xFF;
+    buffer[14] = (status.firmware_id >> 8) & 0xFF;
+    buffer[15] = status.firmware_id & 0xFF;
+    
+    return 16;
+}
+
+size_t encodeTileSyncNode(const TileSyncNode& node, uint8_t* buffer) {
+    buffer[0] = MSG_TYPE_TILE_SYNC;
+    buffer[1] = TILE_SYNC_NODE;
+    buffer[2] = (node.depth << 4) | (node.first & 0x0F);
+    
+    // Prefix (3 bytes), child mask (2 bytes)
+    buffer[3] = (node.prefix >> 16) & 0xFF;
+    buffer[4] = (node.prefix >> 8) & 0xFF;
+    buffer[5] = node.prefix & 0xFF;
+    buffer[6] = (node.child_mask >> 8) & 0xFF;
+    buffer[7] = node.child_mask & 0xFF;
+    size_t length = 8;
+    
+    // Listed children's hashes (4 bytes each); the count follows from the length
+    uint8_t count = min(node.count, (uint8_t)16);
+    for (uint8_t i = 0; i < count; i++) {
+        buffer[length++] = (node.child_hashes[i] >> 24) & 0xFF;
+        buffer[length++] = (node.child_hashes[i] >> 16) & 0xFF;
+        buffer[length++] = (node.child_hashes[i] >> 8) & 0xFF;
+        buffer[length++] = node.child_hashes[i] & 0xFF;
+    }
+    
+    return length;
+}
+
+size_t encodeTileSyncStatus(const TileSyncStatus& status, uint8_t* buffer) {
+    buffer[0] = MSG_TYPE_TILE_SYNC;
+    buffer[1] = TILE_SYNC_STATUS;
+    buffer[2] = status.result;
+    
+    // Target (4 bytes), value (2 bytes), root (4 bytes)
+    buffer[3] = (status.target >> 24) & 0xFF;
+    buffer[4] = (status.target >> 16) & 0xFF;
+    buffer[5] = (status.target >> 8) & 0xFF;
+    buffer[6] = status.target & 0xFF;
+    buffer[7] = (status.value >> 8) & 0xFF;
+    buffer[8] = status.value & 0xFF;
+    buffer[9] = (status.fence_root >> 24) & 0xFF;
+    buffer[10] = (status.fence_root >> 16) & 0xFF;
+    buffer[11] = (status.fence_root >> 8) & 0xFF;
+    buffer[12] = status.fence_root & 0xFF;
+    
+    return 13;
+}
+
 String loraErrorToString(int errorCode) {
     switch (errorCode) {
         case RADIOLIB_ERR_NONE: return "Success";
@@ -4,6 +4,12 @@
 #include <Arduino.h>
 #include <RadioLib.h>
 #include "../include/project_config.h"
+#include "erasure_coder.h"
+#include "selective_repeat.h"
+#include "multicast_groups.h"
+#include "rx_timing.h"
+
+#define LORAWAN_DOWNLINK_BUFFER_SIZE 256
 
 // ===============================================================
 // LORAWAN MESSAGE STRUCTURES
@@ -25,13 +31,117 @@ struct GeofenceEvent {
     uint32_t timestamp;
 };
 
+struct RuleEvent {
+    uint8_t rule_id;
+    uint8_t event_type;    // 0=cleared, 1=triggered
+    int32_t latitude;      // * 1e6
+    int32_t longitude;     // * 1e6
+    uint32_t timestamp;
+};
+
+struct TileEvent {
+    uint16_t fence_id;     // Fence in the LittleFS tile store
+    uint8_t event_type;    // 0=exit, 1=enter
+    int32_t latitude;      // * 1e6
+    int32_t longitude;     // * 1e6
+    uint32_t timestamp;
+};
+
+struct SpeedAlert {
+    uint8_t alert_type;    // ALERT_OVERSPEED_START / ALERT_OVERSPEED_END
+    uint8_t geofence_id;
+    uint8_t speed_limit;   // km/h
+    uint8_t peak_speed;    // km/h
+    uint16_t duration;     // seconds over the limit
+    int32_t latitude;      // * 1e6
+    int32_t longitude;     // * 1e6
+    uint32_t timestamp;
+};
+
+struct TripEvent {
+    uint8_t event_type;    // TRIP_START / TRIP_END
+    uint16_t trip_id;
+    int32_t latitude;      // * 1e6, where the asset left / came to rest
+    int32_t longitude;     // * 1e6
+    uint32_t timestamp;
+    uint32_t odometer;     // meters
+};
+
+struct TripSummary {
+    uint16_t trip_id;
+    uint32_t start_time;
+    uint16_t duration;     // seconds, saturates
+    uint32_t distance;     // meters
+    uint8_t max_speed;     // km/h
+    uint8_t avg_speed;     // km/h
+    int32_t start_latitude;  // * 1e6
+    int32_t start_longitude; // * 1e6
+    uint8_t waypoint_count;  // The last one is the end point
+    int16_t waypoints[TRIP_MAX_WAYPOINTS > 0 ? TRIP_MAX_WAYPOINTS : 1][2]; // Lat/lon steps from the previous point, TRIP_WAYPOINT_UNIT
+};
+
+struct TrackPoint {
+    int32_t latitude;      // * 1e6
+    int32_t longitude;     // * 1e6
+    uint32_t timestamp;
+};
+
+struct OccupancyEntry {
+    uint8_t fence_id;
+    uint8_t visits;          // Entries, saturates
+    uint16_t inside_minutes;
+    uint16_t first_entry;    // Minute of the local day, 0xFFFF = none
+    uint16_t last_entry;
+};
+
+struct OccupancyReport {
+    uint16_t day;            // Local days since 1970-01-01
+    uint8_t flags;           // OCCUPANCY_FINAL when the day is closed
+    uint16_t covered_minutes; // Minutes of the day included so far
+    uint8_t count;
+    OccupancyEntry entries[MAX_GEOFENCES];
+};
+
+#define OCCUPANCY_FINAL     0x01
+#define OCCUPANCY_MORE      0x02     // More of the report's entries follow in the next frame
+
 struct StatusUpdate {
-    uint8_t battery_level;
+    uint8_t battery_level;   // Percent, 0xFF = not measured
     uint16_t uptime_hours;
-    uint8_t gps_status;
-    uint8_t system_status;
+    uint8_t gps_status;      // Satellites in the fix, 0 = no fix
+    uint8_t system_status;   // STATUS_* flags
+    uint32_t fence_root;     // Tile tree root hash, 0 = no tiles
+    uint16_t tile_count;
+    uint32_t firmware_id;    // Leading bytes of the running image's ELF SHA-256
+};
+
+#define STATUS_TILES_ACTIVE     0x01
+#define STATUS_ALERTS_SILENCED  0x02
+#define STATUS_FIRMWARE_TRIAL   0x04    // New image not confirmed yet
+
+// Tile tree node, for the backend's walk (CMD_TILE_QUERY)
+struct TileSyncNode {
+    uint8_t depth;           // 0 = root, TILE_TREE_DEPTH - 1 = parent of tiles
+    uint8_t first;           // First child listed
+    uint32_t prefix;         // Path from the root, 4 bits per level
+    uint16_t child_mask;     // Every non-empty child
+    uint8_t count;           // Children listed, from `first` on
+    uint32_t child_hashes[16]; // Leading 4 bytes of each listed child's hash
+};
+
+// Outcome of CMD_TILE_WRITE / CMD_TILE_DELETE
+struct TileSyncStatus {
+    uint8_t result;          // TILE_WRITE_* / TILE_DELETED
+    uint32_t target;         // Tile key, or (depth << 24) | prefix for a delete
+    uint16_t value;          // Next offset wanted, or tiles deleted
+    uint32_t fence_root;     // Root after the change
 };
 
+#define TILE_WRITE_PROGRESS     0
+#define TILE_WRITE_INSTALLED    1
+#define TILE_WRITE_REJECTED     2
+#define TILE_DELETED            3
+
 // ===============================================================
 // LORAWAN MANAGER CLASS
 // ===============================================================
@@ -53,6 +163,27 @@ private:
     uint32_t lastJoinAttempt;
     uint8_t joinAttempts;
     uint32_t txCounter;
+    bool uplinkRequested;   // Bypass txInterval for the next uplink
+    bool uplinkAcked;       // The last uplink, if confirmed, got its ACK
+    uint32_t txInterval;    // ms between position uplinks, TX_INTERVAL_MS by default
+    uint8_t dataRate;       // LORAWAN_DR_ADR = network-controlled
+    uint8_t uplinkDataRate; // Of the last uplink, LORAWAN_DR_ADR = none yet
+    ErasureEncoder fec;     // Parity for bulk uploads (BULK_FEC)
+    SelectiveRepeat arq;    // Repeats for bulk uploads (BULK_ARQ)
+    RxTiming rxTiming;      // Class A window padding, calibrated from downlinks
+    
+    // Multicast groups, and the Class C session being listened to
+    MulticastGroups multicast;
+    int8_t classCGroup;     // -1 = none
+    bool classCListening;
+    uint32_t totalMulticastDropped;
+    
+    // Last received downlink
+    uint8_t downlinkBuffer[LORAWAN_DOWNLINK_BUFFER_SIZE];
+    size_t downlinkLength;
+    uint8_t downlinkPort;
+    int8_t downlinkGroup;   // Multicast group it came on, -1 = unicast
+    bool downlinkPending;
     
     // Statistics
     uint32_t totalTransmissions;
@@ -66,6 +197,11 @@ private:
     void saveSession();
     bool loadSession();
     void resetSession();
+    bool startClassC();
+    void stopClassC();
+    void receiveMulticast();
+    void updateRxTiming(int window, uint32_t elapsed, size_t length,
+                        const LoRaWANEvent_t& uplink, const LoRaWANEvent_t& downlink, bool confirmed);
     
 public:
     // Constructor & Destructor
@@ -85,14 +221,33 @@ public:
     // Data Transmission
     bool sendGPSData(const GPSData& gpsData);
     bool sendGeofenceEvent(const GeofenceEvent& event);
+    bool sendRuleEvent(const RuleEvent& event);
+    bool sendTileEvent(const TileEvent& event);
+    bool sendAlert(const SpeedAlert& alert);    // True once acknowledged
+    bool sendTripEvent(const TripEvent& event);
+    bool sendTripSummary(const TripSummary& summary);
+    uint8_t sendTrackBatch(const TrackPoint* points, uint8_t count);  // Points sent, 0 = failed
+    bool sendOccupancyReport(const OccupancyReport& report, uint8_t& next);  // Advances next past the entries sent
     bool sendStatusUpdate(const StatusUpdate& status);
-    bool sendCustomPayload(uint8_t* payload, size_t length, uint8_t port = LORAWAN_PORT);
+    bool sendTileSyncNode(const TileSyncNode& node);
+    bool sendTileSyncStatus(const TileSyncStatus& status);
+    bool sendCustomPayload(uint8_t* payload, size_t length, uint8_t port = LORAWAN_PORT, bool confirmed = false);
+    
+    // Bulk uploads, protected as BULK_TRANSFER_MODE says. Offer a new
+    // frame only when canSendBulk; give sendBulkRepair the slot first
+    // (it returns true when a parity frame or repeat went out in it).
+    bool canSendBulk() const;
+    bool sendBulkFrame(const uint8_t* payload, size_t length);
+    bool sendBulkRepair();
+    void requestUplink() { uplinkRequested = true; }
     
     // Status & Monitoring
     bool isConnected() const { return isJoined; }
     bool canTransmit() const;
     uint32_t getNextTxTime() const;
     uint32_t getTxCounter() const { return txCounter; }
+    uint8_t getMaxPayload() const;          // Longest uplink the next data rate carries
+    bool canEverFit(size_t length) const;   // Carried by some rate the node may use
     float getSuccessRate() const;
     
     // Statistics
@@ -102,12 +257,23 @@ public:
     // Downlink handling
     bool hasDownlink();
     bool getDownlink(uint8_t* buffer, size_t& length, uint8_t& port);
+    int8_t getDownlinkGroup() const { return downlinkGroup; }  // Of the last one taken
     void processDownlink(uint8_t* payload, size_t length, uint8_t port);
+    uint8_t handleDownlink(const uint8_t* payload, size_t length);  // Config port commands, CONFIG_*
+    
+    // Multicast: setup commands on MULTICAST_SETUP_PORT and their answers,
+    // and the Class C session windows (call every loop; unixTime 0 = no
+    // clock). Session frames arrive through getDownlink.
+    bool handleMulticastSetup(const uint8_t* payload, size_t length, uint32_t unixTime);
+    bool getMulticastAnswer(uint8_t* buffer, size_t& length);
+    void updateMulticast(uint32_t unixTime);
+    bool isListening() const { return classCListening; }
     
     // Configuration
     void setTxInterval(uint32_t intervalMs);
     void setTxPower(int8_t power);
-    void setDataRate(uint8_t dr);
+    void setDataRate(uint8_t dr);           // LORAWAN_DR_ADR hands it back to ADR
+    uint32_t getTxInterval() const { return txInterval; }
     
     // Sleep/Wake management
     void sleep();
@@ -116,6 +282,8 @@ public:
     // Debug & Logging
     void printStatus();
     void printStatistics();
+    void printMulticastStatistics();
+    void printRxTimingStatistics() { rxTiming.printStatistics(); }
     String getStatusString();
 };
 
@@ -131,8 +299,19 @@ String bytesToHexString(const uint8_t* bytes, size_t length);
 
 // Payload encoding helpers
 size_t encodeGPSData(const GPSData& gps, uint8_t* buffer);
+size_t encodeGPSDataCompact(const GPSData& gps, uint8_t* buffer);
+uint8_t quantizationExponent(uint8_t hdop);
 size_t encodeGeofenceEvent(const GeofenceEvent& event, uint8_t* buffer);
+size_t encodeRuleEvent(const RuleEvent& event, uint8_t* buffer);
+size_t encodeTileEvent(const TileEvent& event, uint8_t* buffer);
+size_t encodeSpeedAlert(const SpeedAlert& alert, uint8_t* buffer);
+size_t encodeTripEvent(const TripEvent& event, uint8_t* buffer);
+size_t encodeTripSummary(const TripSummary& summary, uint8_t* buffer);
+size_t encodeTrackBatch(const TrackPoint* points, uint8_t count, uint8_t* buffer);
+size_t encodeOccupancyReport(const OccupancyReport& report, uint8_t first, uint8_t count, uint8_t* buffer);
 size_t encodeStatusUpdate(const StatusUpdate& status, uint8_t* buffer);
+size_t encodeTileSyncNode(const TileSyncNode& node, uint8_t* buffer);
+size_t encodeTileSyncStatus(const TileSyncStatus& status, uint8_t* buffer);
 
 // Error code to string
 String loraErrorToString(int errorCode);
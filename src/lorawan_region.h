@@ -0,0 +1,160 @@
+#ifndef LORAWAN_REGION_H
+#define LORAWAN_REGION_H
+
+#include <Arduino.h>
+#include "../include/project_config.h"
+
+// ===============================================================
+// REGION PLANS
+// ===============================================================
+//
+// The regional parameters (RP002-1.0.3) the firmware's own decisions
+// need: modulation and largest FRMPayload per data rate (with and
+// without the 400 ms dwell limit), the band, and where a Class C session
+// may listen. RadioLib keeps its own tables for the MAC (uplink channel
+// choice, duty cycle, ADR).
+//
+// A plan is a constexpr RegionPlan and every lookup a constexpr
+// function over it. The usual build is fixed to LORAWAN_REGION: Region::
+// binds those functions to that one plan, so a known data rate folds to
+// a constant, an unknown one is a single table load, and the other
+// plans are never referenced (nothing of them reaches flash). With
+// LORAWAN_MULTI_REGION the same functions run over the plan chosen at
+// boot (LoRaWANManager, NVS key "region", a RadioLib band name).
+
+#define REGION_DYNAMIC              0       // Channels anywhere in the band (EU868, AS923)
+#define REGION_FIXED                1       // 64 + 8 uplink, 8 downlink channels (US915, AU915)
+
+struct RegionDataRate {
+    uint8_t spreadingFactor;     // 0 = not LoRa (FSK, LR-FHSS) or unused
+    uint16_t bandwidth;          // kHz
+    uint8_t maxPayload;          // FRMPayload bytes, no FOpts
+    uint8_t maxPayloadDwell;     // Under the 400 ms dwell limit, 0 = not allowed
+};
+
+struct RegionPlan {
+    const char* name;            // RadioLib's band
+    uint8_t channelPlan;
+    const RegionDataRate* rates;
+    uint8_t maxUplinkDataRate;
+    uint8_t maxDataRate;         // Downlink rates included
+    uint32_t minFrequency;       // Hz
+    uint32_t maxFrequency;
+    uint32_t downlinkBase;       // Fixed plans: the 8 downlink channels
+    uint32_t downlinkStep;
+    uint32_t rx2Frequency;
+    uint8_t rx2DataRate;
+    bool dwellAlways;            // Every uplink under the dwell limit (FCC)
+};
+
+// ===============================================================
+// DATA RATE TABLES
+// ===============================================================
+
+constexpr RegionDataRate EU868_RATES[8] = {
+    {12, 125, 51, 51}, {11, 125, 51, 51}, {10, 125, 51, 51}, {9, 125, 115, 115},
+    {8, 125, 242, 242}, {7, 125, 242, 242}, {7, 250, 242, 242}, {0, 0, 242, 242}};
+
+constexpr RegionDataRate AS923_RATES[8] = {
+    {12, 125, 51, 0}, {11, 125, 51, 0}, {10, 125, 51, 11}, {9, 125, 115, 53},
+    {8, 125, 242, 125}, {7, 125, 242, 242}, {7, 250, 242, 242}, {0, 0, 242, 242}};
+
+constexpr RegionDataRate US915_RATES[14] = {
+    {10, 125, 11, 11}, {9, 125, 53, 53}, {8, 125, 125, 125}, {7, 125, 242, 242},
+    {8, 500, 242, 242}, {0, 0, 0, 0}, {0, 0, 0, 0}, {0, 0, 0, 0},
+    {12, 500, 53, 53}, {11, 500, 129, 129}, {10, 500, 242, 242}, {9, 500, 242, 242},
+    {8, 500, 242, 242}, {7, 500, 242, 242}};
+
+constexpr RegionDataRate AU915_RATES[14] = {
+    {12, 125, 51, 0}, {11, 125, 51, 0}, {10, 125, 51, 11}, {9, 125, 115, 53},
+    {8, 125, 242, 125}, {7, 125, 242, 242}, {8, 500, 242, 242}, {0, 0, 0, 0},
+    {12, 500, 53, 53}, {11, 500, 129, 129}, {10, 500, 242, 242}, {9, 500, 242, 242},
+    {8, 500, 242, 242}, {7, 500, 242, 242}};
+
+// ===============================================================
+// PLANS
+// ===============================================================
+//
+// AS923 groups 2-4 are group 1 shifted down (-1.8, -6.6, -5.9 MHz).
+
+constexpr RegionPlan REGION_EU868 = {
+    "EU868", REGION_DYNAMIC, EU868_RATES, 7, 7, 863000000, 870000000, 0, 0, 869525000, 0, false};
+constexpr RegionPlan REGION_US915 = {
+    "US915", REGION_FIXED, US915_RATES, 4, 13, 902000000, 928000000, 923300000, 600000, 923300000, 8, true};
+constexpr RegionPlan REGION_AU915 = {
+    "AU915", REGION_FIXED, AU915_RATES, 6, 13, 915000000, 928000000, 923300000, 600000, 923300000, 8, false};
+constexpr RegionPlan REGION_AS923 = {
+    "AS923", REGION_DYNAMIC, AS923_RATES, 7, 7, 915000000, 928000000, 0, 0, 923200000, 2, false};
+constexpr RegionPlan REGION_AS923_2 = {
+    "AS923_2", REGION_DYNAMIC, AS923_RATES, 7, 7, 920000000, 923000000, 0, 0, 921400000, 2, false};
+constexpr RegionPlan REGION_AS923_3 = {
+    "AS923_3", REGION_DYNAMIC, AS923_RATES, 7, 7, 915000000, 921000000, 0, 0, 916600000, 2, false};
+constexpr RegionPlan REGION_AS923_4 = {
+    "AS923_4", REGION_DYNAMIC, AS923_RATES, 7, 7, 917000000, 920000000, 0, 0, 917300000, 2, false};
+
+// ===============================================================
+// LOOKUPS
+// ===============================================================
+
+constexpr uint8_t regionSpreadingFactor(const RegionPlan& plan, uint8_t dr) {
+    return dr <= plan.maxDataRate ? plan.rates[dr].spreadingFactor : 0;
+}
+
+constexpr uint16_t regionBandwidth(const RegionPlan& plan, uint8_t dr) {
+    return dr <= plan.maxDataRate ? plan.rates[dr].bandwidth : 0;
+}
+
+// Largest FRMPayload at dr, 0 when the rate is not usable
+constexpr uint8_t regionMaxPayload(const RegionPlan& plan, uint8_t dr, bool dwell) {
+    return dr > plan.maxDataRate ? 0 :
+           (dwell || plan.dwellAlways) ? plan.rates[dr].maxPayloadDwell : plan.rates[dr].maxPayload;
+}
+
+// Largest FRMPayload every usable uplink rate carries
+constexpr uint8_t regionMinUplinkPayload(const RegionPlan& plan, bool dwell) {
+    uint8_t smallest = 255;
+    for (uint8_t dr = 0; dr <= plan.maxUplinkDataRate; dr++) {
+        uint8_t payload = regionMaxPayload(plan, dr, dwell);
+        if (payload > 0 && payload < smallest) {
+            smallest = payload;
+        }
+    }
+    return smallest;
+}
+
+// Where a Class C session may listen: one of the 8 downlink channels in
+// fixed plans, anywhere in the band otherwise
+constexpr bool regionIsDownlinkFrequency(const RegionPlan& plan, uint32_t hz) {
+    return plan.channelPlan == REGION_FIXED ?
+           hz >= plan.downlinkBase && (hz - plan.downlinkBase) % plan.downlinkStep == 0 &&
+           (hz - plan.downlinkBase) / plan.downlinkStep < 8 :
+           hz >= plan.minFrequency && hz <= plan.maxFrequency;
+}
+
+// ===============================================================
+// ACTIVE REGION
+// ===============================================================
+
+#define REGION_PLAN_OF_(region)     REGION_##region
+#define REGION_PLAN_OF(region)      REGION_PLAN_OF_(region)
+
+#if LORAWAN_MULTI_REGION
+extern const RegionPlan* activeRegion;      // Set by LoRaWANManager before the node
+#define REGION_ACTIVE_PLAN          (*activeRegion)
+#define REGION_LOOKUP               inline
+#else
+#define REGION_ACTIVE_PLAN          REGION_PLAN_OF(LORAWAN_REGION)
+#define REGION_LOOKUP               constexpr
+#endif
+
+struct Region {
+    static REGION_LOOKUP const char* name() { return REGION_ACTIVE_PLAN.name; }
+    static REGION_LOOKUP uint8_t spreadingFactor(uint8_t dr) { return regionSpreadingFactor(REGION_ACTIVE_PLAN, dr); }
+    static REGION_LOOKUP uint16_t bandwidth(uint8_t dr) { return regionBandwidth(REGION_ACTIVE_PLAN, dr); }
+    static REGION_LOOKUP uint8_t maxUplinkDataRate() { return REGION_ACTIVE_PLAN.maxUplinkDataRate; }
+    static REGION_LOOKUP uint8_t maxPayload(uint8_t dr) { return regionMaxPayload(REGION_ACTIVE_PLAN, dr, LORAWAN_DWELL_TIME); }
+    static REGION_LOOKUP uint8_t minUplinkPayload() { return regionMinUplinkPayload(REGION_ACTIVE_PLAN, LORAWAN_DWELL_TIME); }
+    static REGION_LOOKUP bool isDownlinkFrequency(uint32_t hz) { return regionIsDownlinkFrequency(REGION_ACTIVE_PLAN, hz); }
+};
+
+#endif // LORAWAN_REGION_H
@@ -9,6 +9,12 @@
 #include "display_manager.h"
 #include "audio_manager.h"
 #include "geofence_manager.h"
+#include "button_manager.h"
+#include "rule_engine.h"
+#include "trip_detector.h"
+#include "track_buffer.h"
+#include "firmware_update.h"
+#include "lorawan_crypto.h"
 
 // ===============================================================
 // GLOBAL MANAGERS
@@ -18,6 +24,11 @@ GPSManager gpsManager;
 DisplayManager displayManager;
 AudioManager audioManager;
 GeofenceManager geofenceManager;
+ButtonManager buttonManager;
+RuleEngine ruleEngine;
+TripDetector tripDetector;
+TrackBuffer trackBuffer;
+FirmwareUpdate firmwareUpdate;
 
 // ===============================================================
 // SYSTEM STATE
@@ -26,9 +37,46 @@ struct SystemState {
     bool systemInitialized;
     bool lorawanJoined;
     bool gpsLocked;
+    bool alertsSilenced;
+    bool speedAlertPending;
+    SpeedAlert speedAlert;
+    uint8_t speedAlertAttempts;                     // Sent without an ACK so far
+    GeofenceEvent fenceEvents[MAX_PENDING_EVENTS];  // Held until an uplink carries them, oldest first
+    uint8_t fenceEventHead;
+    uint8_t fenceEventCount;
+    RuleEvent ruleEvents[MAX_RULES];                // The same for rule changes
+    uint8_t ruleEventHead;
+    uint8_t ruleEventCount;
+    bool tileEventPending;                          // Later ones stay queued in the tile store
+    TileEvent tileEvent;
+    bool tripEventPending;
+    TripEvent tripEvent;
+    bool tripSummaryPending;
+    TripSummary tripSummary;
+    bool occupancyPending;
+    OccupancyReport occupancyReport;
+    uint8_t occupancySent;                   // Entries already out, the report spans frames
+    unsigned long lastOccupancyReport;
+    bool statusPending;
+    StatusUpdate statusUpdate;
+    unsigned long lastStatusReport;          // 0 = none since boot
+    bool tileNodePending;
+    TileSyncNode tileNode;
+    bool tileStatusPending;
+    TileSyncStatus tileStatus;
+    bool firmwareAnswerPending;
+    uint8_t firmwareAnswer[FUOTA_MAX_ANSWER];
+    size_t firmwareAnswerLength;
+    bool multicastAnswerPending;
+    uint8_t multicastAnswer[MC_MAX_ANSWER];
+    size_t multicastAnswerLength;
+    GPSData recentFixes[PROFILE_MAX_AGGREGATION]; // Newest last, for report aggregation
+    uint8_t recentHead;
+    uint8_t recentCount;
+    uint32_t lastRecordedFix;
     uint8_t currentScreen;
     unsigned long lastScreenUpdate;
-    unsigned long lastButtonCheck;
+    unsigned long lastClockSync;
     unsigned long lastStatusCheck;
     unsigned long systemStartTime;
     uint32_t systemLoopCount;
@@ -41,12 +89,32 @@ void setupSystem();
 void setupManagers();
 void handleSystemLoop();
 void handleUserInput();
+void handleButtonEvent(const ButtonEvent& event);
 void handleLoRaWANEvents();
 void handleGPSEvents();
 void handleGeofenceEvents();
+void adaptSamplingRate();
+void queueFenceEvent(const GeofenceEvent& event);
+bool sendFenceEvents();
+void queueRuleEvent(const RuleEvent& event);
+bool sendRuleEvents();
+bool sendTiledFenceEvent();
+bool sendTripMessages();
+bool sendTileSyncReplies();
+bool sendMulticastAnswer();
+bool sendFirmwareAnswer();
+uint32_t clockTime();
+void buildStatusUpdate(StatusUpdate& status);
+void sendTrackBatch();
+void applyReportProfile();
+void recordFix(const GPSData& fix);
+GPSData aggregatedPosition();
+void handleDownlinks();
 void updateSystemStatus();
+void updateDisplayContent();
 void performSystemMaintenance();
 void printSystemInfo();
+void IRAM_ATTR onButtonInterrupt();
 
 // ===============================================================
 // ARDUINO SETUP
@@ -94,6 +162,9 @@ void loop() {
     // Handle geofencing logic
     handleGeofenceEvents();
     
+    // Apply configuration received from the network
+    handleDownlinks();
+    
     // Update system status periodically
     if (millis() - systemState.lastStatusCheck >= 5000) {
         updateSystemStatus();
@@ -128,7 +199,7 @@ void setupSystem() {
     // External power control for peripherals
     pinMode(VEXT_PIN, OUTPUT);
     digitalWrite(VEXT_PIN, VEXT_ON_STATE);
-    delay(100);
+    delay(VEXT_SETTLE_TIME);
     
     Serial.println("System hardware setup complete!");
 }
@@ -153,6 +224,12 @@ void setupManagers() {
     // Show initialization screen
     displayManager.showInitScreen(PROJECT_NAME, PROJECT_VERSION);
     
+    // Initialize Button Manager (its ISR wakes the display through the
+    // display's own task)
+    if (!buttonManager.begin(onButtonInterrupt)) {
+        Serial.println("WARNING: Button Manager initialization failed!");
+    }
+    
     // Initialize GPS Manager
     if (!gpsManager.begin()) {
         Serial.println("WARNING: GPS Manager initialization failed!");
@@ -175,6 +252,21 @@ void setupManagers() {
         Serial.println("WARNING: Geofence Manager initialization failed!");
     }
     
+    // Initialize Rule Engine
+    if (!ruleEngine.begin()) {
+        Serial.println("WARNING: Rule Engine initialization failed!");
+    }
+    
+    // Initialize Trip Detector
+    if (!tripDetector.begin()) {
+        Serial.println("WARNING: Trip Detector initialization failed!");
+    }
+    
+    // Initialize Firmware Update (after the tile store mounts LittleFS)
+    if (!firmwareUpdate.begin()) {
+        Serial.println("WARNING: Firmware Update initialization failed!");
+    }
+    
     // Start LoRaWAN join process
     displayManager.showStatus("Starting OTAA Join...");
     if (loraManager.startJoin()) {
@@ -195,6 +287,9 @@ void setupManagers() {
 // MAIN LOOP HANDLERS
 // ===============================================================
 void handleSystemLoop() {
+    // Screen timeout (presses wake the panel off the loop)
+    displayManager.update();
+    
     // Update display
     if (millis() - systemState.lastScreenUpdate >= DISPLAY_UPDATE_RATE) {
         updateDisplayContent();
@@ -203,20 +298,47 @@ void handleSystemLoop() {
 }
 
 void handleUserInput() {
-    if (millis() - systemState.lastButtonCheck >= BUTTON_DEBOUNCE_TIME) {
-        static bool lastButtonState = true; // Pulled up
-        bool currentButtonState = digitalRead(BUTTON_PIN);
-        
-        // Button pressed (falling edge)
-        if (!currentButtonState && lastButtonState) {
+    // Gestures are recognised off the loop; just drain what is queued
+    ButtonEvent event;
+    while (buttonManager.getEvent(event)) {
+        handleButtonEvent(event);
+    }
+}
+
+void handleButtonEvent(const ButtonEvent& event) {
+    switch (event.gesture) {
+        case BUTTON_SHORT_PRESS:
+            // A press that woke a dark panel does not also change screen
+            if ((int32_t)(displayManager.getLastWakeTime() - event.pressedAt) >= 0) {
+                break;
+            }
+            displayManager.registerActivity();
             systemState.currentScreen = (systemState.currentScreen + 1) % NUM_SCREENS;
             Serial.print("Screen changed to: ");
             Serial.println(systemState.currentScreen);
             audioManager.playClickTone();
-        }
-        
-        lastButtonState = currentButtonState;
-        systemState.lastButtonCheck = millis();
+            break;
+            
+        case BUTTON_DOUBLE_CLICK:
+            displayManager.registerActivity();
+            Serial.println("Button: uplink requested");
+            loraManager.requestUplink();
+            displayManager.showStatus("Uplink requested");
+            audioManager.playClickTone();
+            break;
+            
+        case BUTTON_LONG_PRESS:
+            displayManager.registerActivity();
+            systemState.alertsSilenced = !systemState.alertsSilenced;
+            Serial.print("Button: alerts ");
+            Serial.println(systemState.alertsSilenced ? "silenced" : "enabled");
+            displayManager.showStatus(systemState.alertsSilenced ? "Alerts silenced" : "Alerts enabled");
+            if (systemState.alertsSilenced) {
+                digitalWrite(LED_ALERT_PIN, LOW);
+            } else {
+                audioManager.playClickTone();
+            }
+            break;
     }
 }
 
@@ -238,11 +360,115 @@ void handleLoRaWANEvents() {
         delay(1000);
     }
     
+    // A new image is kept once it has joined and got an uplink out
+    if (firmwareUpdate.isTrial() && systemState.lorawanJoined) {
+        uint32_t total, success, failed;
+        loraManager.getStatistics(total, success, failed);
+        if (success > 0) {
+            firmwareUpdate.confirm();
+        }
+    }
+    firmwareUpdate.update(!systemState.firmwareAnswerPending);
+    
+    // Class C sessions of the multicast groups open and close on the clock
+    loraManager.updateMulticast(clockTime());
+    
+    // Occupancy: hourly day-to-date report, and right away when a day closes
+    if (!systemState.occupancyPending &&
+        (geofenceManager.hasClosedDay() ||
+         millis() - systemState.lastOccupancyReport >= OCCUPANCY_REPORT_INTERVAL)) {
+        systemState.occupancyPending = geofenceManager.getOccupancyReport(systemState.occupancyReport);
+        systemState.occupancySent = 0;
+        systemState.lastOccupancyReport = millis();
+    }
+    
+    // Status (with the fence root the backend checks its tile set
+    // against): first chance after boot, then every STATUS_REPORT_INTERVAL
+    if (!systemState.statusPending &&
+        (systemState.lastStatusReport == 0 || millis() - systemState.lastStatusReport >= STATUS_REPORT_INTERVAL)) {
+        buildStatusUpdate(systemState.statusUpdate);
+        systemState.statusPending = true;
+        systemState.lastStatusReport = millis();
+    }
+    
     // Handle data transmission
     if (loraManager.isConnected() && loraManager.canTransmit()) {
-        // Send GPS data if available
-        if (gpsManager.hasValidFix()) {
-            GPSData gpsData = gpsManager.getCurrentData();
+        // Fence transitions and rule changes first, held until they go out
+        if (sendFenceEvents() || sendRuleEvents() || sendTiledFenceEvent()) {
+            return;
+        }
+        
+        // Trip messages take the slot ahead of positions
+        if (sendTripMessages()) {
+            return;
+        }
+        
+        // Multicast group answers ahead of the fragment session they set up
+        if (sendMulticastAnswer()) {
+            return;
+        }
+        
+        // Firmware update answers (session setup, fragment status)
+        if (sendFirmwareAnswer()) {
+            return;
+        }
+        
+        // The backend's tile sync moves one step per uplink
+        if (sendTileSyncReplies()) {
+            return;
+        }
+        
+        // Reports too long for the current data rate let shorter uplinks
+        // go ahead until ADR picks a faster one
+        if (systemState.statusPending) {
+            uint8_t frame[32];
+            size_t length = encodeStatusUpdate(systemState.statusUpdate, frame);
+            if (!loraManager.canEverFit(length)) {
+                Serial.println("Status dropped: too long for any data rate");
+                systemState.statusPending = false;
+            } else if (length <= loraManager.getMaxPayload()) {
+                if (loraManager.sendStatusUpdate(systemState.statusUpdate)) {
+                    Serial.print("Status sent (fence root ");
+                    Serial.print(systemState.statusUpdate.fence_root, HEX);
+                    Serial.println(")");
+                    systemState.statusPending = false;
+                }
+                return;
+            }
+        }
+        
+        if (systemState.occupancyPending) {
+            // Split over frames as the data rate needs, one entry each at least
+            OccupancyReport& report = systemState.occupancyReport;
+            uint8_t frame[16];
+            size_t length = encodeOccupancyReport(report, systemState.occupancySent, 1, frame);
+            if (!loraManager.canEverFit(length)) {
+                Serial.println("Occupancy report dropped: too long for any data rate");
+                systemState.occupancyPending = false;
+            } else if (length <= loraManager.getMaxPayload()) {
+                if (loraManager.sendOccupancyReport(report, systemState.occupancySent) &&
+                    systemState.occupancySent >= report.count) {
+                    Serial.print("Occupancy report sent (");
+                    Serial.print(report.count);
+                    Serial.println(report.flags & OCCUPANCY_FINAL ? " fences, day closed)" : " fences)");
+                    systemState.occupancyPending = false;
+                }
+                return;
+            }
+        }
+        
+        // Bulk parity or repeats, before new bulk frames
+        if (loraManager.sendBulkRepair()) {
+            return;
+        }
+        
+        // Send GPS data if available (and wanted outside trips)
+        bool positionsWanted = TRIP_POSITION_REPORTS == TRIP_POSITIONS_ALWAYS ||
+                               (TRIP_POSITION_REPORTS == TRIP_POSITIONS_MOVING && tripDetector.isMoving());
+        if (positionsWanted && TRACK_BATCH_UPLINKS) {
+            sendTrackBatch();
+        } else if (gpsManager.hasValidFix() && positionsWanted) {
+            GPSData gpsData = aggregatedPosition();
             
             digitalWrite(LED_WHITE_PIN, HIGH);
             if (loraManager.sendGPSData(gpsData)) {
@@ -250,17 +476,262 @@ void handleLoRaWANEvents() {
                 audioManager.playTxSuccessTone();
             } else {
                 Serial.println("Failed to send GPS data!");
-                audioManager.playTxFailedTone();
+                if (!systemState.alertsSilenced) {
+                    audioManager.playTxFailedTone();
+                }
             }
             digitalWrite(LED_WHITE_PIN, LOW);
         }
     }
 }
 
+void sendTrackBatch() {
+    // The transfer window is full; the points wait in the buffer
+    if (!loraManager.canSendBulk()) {
+        return;
+    }
+    
+    // End the batch at the current position unless a full one is waiting
+    if (trackBuffer.getCount() < TRACK_BATCH_POINTS) {
+        trackBuffer.flush();
+    }
+    
+    TrackPoint batch[TRACK_BATCH_POINTS];
+    uint8_t count = trackBuffer.peek(batch, TRACK_BATCH_POINTS);
+    if (count == 0) {
+        return;
+    }
+    
+    digitalWrite(LED_WHITE_PIN, HIGH);
+    uint8_t sent = loraManager.sendTrackBatch(batch, count);
+    if (sent > 0) {
+        trackBuffer.consume(sent);
+        Serial.print("Track batch sent (");
+        Serial.print(sent);
+        Serial.println(" points)");
+        audioManager.playTxSuccessTone();
+    } else {
+        Serial.println("Failed to send track batch!");
+        if (!systemState.alertsSilenced) {
+            audioManager.playTxFailedTone();
+        }
+    }
+    digitalWrite(LED_WHITE_PIN, LOW);
+}
+
+void queueFenceEvent(const GeofenceEvent& event) {
+    // Full only after a long time without uplinks: the newest matter most
+    if (systemState.fenceEventCount == MAX_PENDING_EVENTS) {
+        Serial.println("Geofence event queue full, oldest dropped");
+        systemState.fenceEventHead = (systemState.fenceEventHead + 1) % MAX_PENDING_EVENTS;
+        systemState.fenceEventCount--;
+    }
+    
+    uint8_t tail = (systemState.fenceEventHead + systemState.fenceEventCount) % MAX_PENDING_EVENTS;
+    systemState.fenceEvents[tail] = event;
+    systemState.fenceEventCount++;
+}
+
+bool sendFenceEvents() {
+    if (systemState.fenceEventCount == 0) {
+        return false;
+    }
+    
+    const GeofenceEvent& event = systemState.fenceEvents[systemState.fenceEventHead];
+    uint8_t frame[32];
+    size_t length = encodeGeofenceEvent(event, frame);
+    bool sent = false;
+    if (!loraManager.canEverFit(length)) {
+        Serial.println("Geofence event dropped: too long for any data rate");
+    } else if (length > loraManager.getMaxPayload()) {
+        // Shorter uplinks go ahead until ADR picks a faster rate
+        return false;
+    } else if (loraManager.sendGeofenceEvent(event)) {
+        Serial.print("Geofence event sent for fence ");
+        Serial.println(event.geofence_id);
+        sent = true;
+    } else {
+        return true;
+    }
+    
+    systemState.fenceEventHead = (systemState.fenceEventHead + 1) % MAX_PENDING_EVENTS;
+    systemState.fenceEventCount--;
+    return sent;
+}
+
+void queueRuleEvent(const RuleEvent& event) {
+    if (systemState.ruleEventCount == MAX_RULES) {
+        Serial.println("Rule event queue full, oldest dropped");
+        systemState.ruleEventHead = (systemState.ruleEventHead + 1) % MAX_RULES;
+        systemState.ruleEventCount--;
+    }
+    
+    uint8_t tail = (systemState.ruleEventHead + systemState.ruleEventCount) % MAX_RULES;
+    systemState.ruleEvents[tail] = event;
+    systemState.ruleEventCount++;
+}
+
+bool sendRuleEvents() {
+    if (systemState.ruleEventCount == 0) {
+        return false;
+    }
+    
+    const RuleEvent& event = systemState.ruleEvents[systemState.ruleEventHead];
+    uint8_t frame[32];
+    size_t length = encodeRuleEvent(event, frame);
+    bool sent = false;
+    if (!loraManager.canEverFit(length)) {
+        Serial.println("Rule event dropped: too long for any data rate");
+    } else if (length > loraManager.getMaxPayload()) {
+        return false;
+    } else if (loraManager.sendRuleEvent(event)) {
+        Serial.print("Rule event sent for rule ");
+        Serial.println(event.rule_id);
+        sent = true;
+    } else {
+        return true;
+    }
+    
+    systemState.ruleEventHead = (systemState.ruleEventHead + 1) % MAX_RULES;
+    systemState.ruleEventCount--;
+    return sent;
+}
+
+bool sendTiledFenceEvent() {
+    if (!systemState.tileEventPending) {
+        return false;
+    }
+    
+    uint8_t frame[32];
+    size_t length = encodeTileEvent(systemState.tileEvent, frame);
+    if (!loraManager.canEverFit(length)) {
+        Serial.println("Tiled fence event dropped: too long for any data rate");
+        systemState.tileEventPending = false;
+        return false;
+    }
+    if (length > loraManager.getMaxPayload()) {
+        return false;
+    }
+    
+    if (loraManager.sendTileEvent(systemState.tileEvent)) {
+        Serial.print("Tiled fence event sent for fence ");
+        Serial.println(systemState.tileEvent.fence_id);
+        systemState.tileEventPending = false;
+    }
+    return true;
+}
+
+bool sendTripMessages() {
+    if (!systemState.tripEventPending) {
+        systemState.tripEventPending = tripDetector.getEvent(systemState.tripEvent);
+    }
+    if (systemState.tripEventPending) {
+        if (loraManager.sendTripEvent(systemState.tripEvent)) {
+            Serial.print("Trip ");
+            Serial.print(systemState.tripEvent.trip_id);
+            Serial.println(systemState.tripEvent.event_type == TRIP_START ? " start sent" : " end sent");
+            systemState.tripEventPending = false;
+        }
+        return true;
+    }
+    
+    if (!systemState.tripSummaryPending) {
+        systemState.tripSummaryPending = tripDetector.getSummary(systemState.tripSummary);
+    }
+    if (systemState.tripSummaryPending) {
+        if (loraManager.sendTripSummary(systemState.tripSummary)) {
+            Serial.print("Trip ");
+            Serial.print(systemState.tripSummary.trip_id);
+            Serial.println(" summary sent");
+            systemState.tripSummaryPending = false;
+        }
+        return true;
+    }
+    
+    return false;
+}
+
+bool sendTileSyncReplies() {
+    if (!systemState.tileStatusPending) {
+        systemState.tileStatusPending = geofenceManager.getTileSyncStatus(systemState.tileStatus);
+    }
+    if (systemState.tileStatusPending) {
+        if (loraManager.sendTileSyncStatus(systemState.tileStatus)) {
+            Serial.print("Tile sync status sent (root ");
+            Serial.print(systemState.tileStatus.fence_root, HEX);
+            Serial.println(")");
+            systemState.tileStatusPending = false;
+        }
+        return true;
+    }
+    
+    if (!systemState.tileNodePending) {
+        systemState.tileNodePending = geofenceManager.getTileSyncNode(systemState.tileNode);
+    }
+    if (systemState.tileNodePending) {
+        if (loraManager.sendTileSyncNode(systemState.tileNode)) {
+            Serial.print("Tile sync node sent (depth ");
+            Serial.print(systemState.tileNode.depth);
+            Serial.println(")");
+            systemState.tileNodePending = false;
+        }
+        return true;
+    }
+    
+    return false;
+}
+
+bool sendMulticastAnswer() {
+    if (!systemState.multicastAnswerPending) {
+        systemState.multicastAnswerPending = loraManager.getMulticastAnswer(systemState.multicastAnswer,
+                                                                            systemState.multicastAnswerLength);
+    }
+    if (!systemState.multicastAnswerPending) {
+        return false;
+    }
+    
+    if (loraManager.sendCustomPayload(systemState.multicastAnswer, systemState.multicastAnswerLength, MULTICAST_SETUP_PORT)) {
+        Serial.println("Multicast setup answer sent");
+        systemState.multicastAnswerPending = false;
+    }
+    return true;
+}
+
+bool sendFirmwareAnswer() {
+    if (!systemState.firmwareAnswerPending) {
+        systemState.firmwareAnswerPending = firmwareUpdate.getAnswer(systemState.firmwareAnswer,
+                                                                     systemState.firmwareAnswerLength);
+    }
+    if (!systemState.firmwareAnswerPending) {
+        return false;
+    }
+    
+    if (loraManager.sendCustomPayload(systemState.firmwareAnswer, systemState.firmwareAnswerLength, FUOTA_FRAG_PORT)) {
+        Serial.println("Firmware update answer sent");
+        systemState.firmwareAnswerPending = false;
+    }
+    return true;
+}
+
+void buildStatusUpdate(StatusUpdate& status) {
+    status.battery_level = 0xFF;
+    status.uptime_hours = min((millis() - systemState.systemStartTime) / 3600000UL, 0xFFFFUL);
+    status.gps_status = gpsManager.hasValidFix() ? gpsManager.getSatelliteCount() : 0;
+    status.system_status = (geofenceManager.hasTiles() ? STATUS_TILES_ACTIVE : 0) |
+                           (systemState.alertsSilenced ? STATUS_ALERTS_SILENCED : 0) |
+                           (firmwareUpdate.isTrial() ? STATUS_FIRMWARE_TRIAL : 0);
+    status.fence_root = geofenceManager.getFenceRoot();
+    status.tile_count = geofenceManager.getTileCount();
+    status.firmware_id = firmwareUpdate.getFirmwareId();
+}
+
 void handleGPSEvents() {
     // Update GPS data
     gpsManager.update();
     
+    // An open trip is closed if fixes stop arriving
+    tripDetector.checkTimeout(millis());
+    
     // Check for GPS lock status change
     bool currentGpsLock = gpsManager.hasValidFix();
     if (currentGpsLock != systemState.gpsLocked) {
@@ -273,12 +744,35 @@ void handleGPSEvents() {
             Serial.println("GPS lock lost!");
         }
     }
+    
+    // Keep the geofence schedule clock on GPS time
+    if (gpsManager.hasValidTime() &&
+        (systemState.lastClockSync == 0 || millis() - systemState.lastClockSync >= GEOFENCE_CLOCK_SYNC_INTERVAL)) {
+        geofenceManager.syncClock(gpsManager.getUnixTime());
+        systemState.lastClockSync = millis();
+    }
 }
 
 void handleGeofenceEvents() {
     // Update geofences if GPS is available
     if (gpsManager.hasValidFix()) {
         GPSData currentPos = gpsManager.getCurrentData();
+        if (gpsManager.getFixTime() != systemState.lastRecordedFix) {
+            systemState.lastRecordedFix = gpsManager.getFixTime();
+            recordFix(currentPos);
+            uint32_t timestamp = gpsManager.hasValidTime() ? gpsManager.getUnixTime() : millis() / 1000;
+            trackBuffer.addFix(gpsManager.getFixTime(), timestamp, currentPos.latitude, currentPos.longitude);
+            tripDetector.update(gpsManager.getFixTime(), timestamp,
+                                currentPos.latitude, currentPos.longitude,
+                                gpsManager.getFilteredSpeed(), gpsManager.getHDOP());
+        }
+        geofenceManager.updateMotion(
+            gpsManager.getFixTime(),
+            gpsManager.getUpdateRate(),
+            gpsManager.getSpeed(),
+            gpsManager.getCourse(),
+            gpsManager.getHDOP()
+        );
         
         // Check for geofence events
         GeofenceEvent event;
@@ -288,19 +782,209 @@ void handleGeofenceEvents() {
             Serial.print(" fence ");
             Serial.println(event.geofence_id);
             
-            // Send geofence event via LoRaWAN
-            if (loraManager.isConnected()) {
-                loraManager.sendGeofenceEvent(event);
-            }
+            // Sent from the uplink chain, retried until it goes out
+            queueFenceEvent(event);
             
             // Audio feedback
-            if (event.event_type == 1) {
+            if (systemState.alertsSilenced) {
+                // Long press muted alerts
+            } else if (event.event_type == 1) {
                 audioManager.playGeofenceEnterTone();
             } else {
                 audioManager.playGeofenceExitTone();
             }
         }
+        
+        // Tiled (country-scale) fences report with 16-bit ids; one is taken
+        // at a time and held until the uplink chain sends it
+        if (!systemState.tileEventPending && geofenceManager.getTileEvent(systemState.tileEvent)) {
+            systemState.tileEventPending = true;
+            Serial.print("Tiled fence event: ");
+            Serial.print(systemState.tileEvent.event_type == 1 ? "ENTER" : "EXIT");
+            Serial.print(" fence ");
+            Serial.println(systemState.tileEvent.fence_id);
+        }
+        
+        // Speed limits reuse the membership just computed
+        float speed = gpsManager.getFilteredSpeed();
+        geofenceManager.updateSpeed(speed, gpsManager.getFixTime(), currentPos.latitude, currentPos.longitude);
+        
+        // Overspeed alerts take the priority uplink and are held until sent
+        if (!systemState.speedAlertPending) {
+            systemState.speedAlertPending = geofenceManager.getSpeedAlert(systemState.speedAlert);
+            systemState.speedAlertAttempts = 0;
+        }
+        if (systemState.speedAlertPending && loraManager.isConnected()) {
+            uint8_t frame[32];
+            uint32_t sentBefore = loraManager.getTxCounter();
+            if (!loraManager.canEverFit(encodeSpeedAlert(systemState.speedAlert, frame))) {
+                Serial.println("Overspeed alert dropped: too long for any data rate");
+                systemState.speedAlertPending = false;
+            } else if (loraManager.sendAlert(systemState.speedAlert)) {
+                Serial.print("Overspeed alert sent for fence ");
+                Serial.println(systemState.speedAlert.geofence_id);
+                systemState.speedAlertPending = false;
+            } else if (loraManager.getTxCounter() != sentBefore &&
+                       ++systemState.speedAlertAttempts >= ALERT_MAX_ATTEMPTS) {
+                // Went out every time, the ACKs never came back
+                Serial.print("Overspeed alert not acknowledged, giving up for fence ");
+                Serial.println(systemState.speedAlert.geofence_id);
+                systemState.speedAlertPending = false;
+            }
+        }
+        
+        // Rules read the membership just computed; only those whose
+        // inputs changed are re-run
+        RuleEvent ruleEvent;
+        if (ruleEngine.evaluate(geofenceManager, speed,
+                                currentPos.latitude, currentPos.longitude, ruleEvent)) {
+            Serial.print("Rule ");
+            Serial.print(ruleEvent.rule_id);
+            Serial.println(ruleEvent.event_type == 1 ? " triggered" : " cleared");
+            
+            queueRuleEvent(ruleEvent);
+        }
+        
+        applyReportProfile();
+        adaptSamplingRate();
+    }
+}
+
+void applyReportProfile() {
+    // Fence profiles were merged during the check; only switches land here
+    ReportProfile profile;
+    if (!geofenceManager.getProfileChange(profile)) {
+        return;
+    }
+    
+    loraManager.setTxInterval((uint32_t)profile.uplinkInterval * 1000);
+    loraManager.setDataRate(profile.dataRate);
+    
+    Serial.print("Report profile: uplink ");
+    Serial.print(profile.uplinkInterval);
+    Serial.print(" s, GNSS ");
+    Serial.print(profile.gnssInterval);
+    Serial.print(" s, aggregation ");
+    Serial.print(profile.aggregation);
+    if (profile.dataRate == LORAWAN_DR_ADR) {
+        Serial.println(", ADR");
+    } else {
+        Serial.print(", DR");
+        Serial.println(profile.dataRate);
+    }
+}
+
+void recordFix(const GPSData& fix) {
+    uint8_t slot = (systemState.recentHead + systemState.recentCount) % PROFILE_MAX_AGGREGATION;
+    systemState.recentFixes[slot] = fix;
+    if (systemState.recentCount < PROFILE_MAX_AGGREGATION) {
+        systemState.recentCount++;
+    } else {
+        systemState.recentHead = (systemState.recentHead + 1) % PROFILE_MAX_AGGREGATION;
+    }
+}
+
+GPSData aggregatedPosition() {
+    // Mean of the last `aggregation` fixes, taken as offsets from the
+    // newest so the sum stays small and survives the antimeridian
+    GPSData result = gpsManager.getCurrentData();
+    uint8_t n = min(geofenceManager.getActiveProfile().aggregation, systemState.recentCount);
+    if (n <= 1) {
+        return result;
+    }
+    
+    uint8_t newest = (systemState.recentHead + systemState.recentCount - 1) % PROFILE_MAX_AGGREGATION;
+    const GPSData& base = systemState.recentFixes[newest];
+    int64_t sumLat = 0;
+    int64_t sumLon = 0;
+    int32_t sumAlt = 0;
+    uint16_t sumHdop = 0;
+    for (uint8_t k = 0; k < n; k++) {
+        const GPSData& fix = systemState.recentFixes[(newest + PROFILE_MAX_AGGREGATION - k) % PROFILE_MAX_AGGREGATION];
+        int32_t dLon = fix.longitude - base.longitude;
+        if (dLon > 180000000L) dLon -= 360000000L;
+        if (dLon < -180000000L) dLon += 360000000L;
+        sumLat += fix.latitude - base.latitude;
+        sumLon += dLon;
+        sumAlt += fix.altitude;
+        sumHdop += fix.hdop;
+    }
+    
+    result.latitude = base.latitude + (int32_t)(sumLat / n);
+    int32_t lon = base.longitude + (int32_t)(sumLon / n);
+    if (lon > 180000000L) lon -= 360000000L;
+    if (lon < -180000000L) lon += 360000000L;
+    result.longitude = lon;
+    result.altitude = sumAlt / n;
+    result.hdop = sumHdop / n;
+    return result;
+}
+
+void adaptSamplingRate() {
+    // Pace fixes so one lands just before the predicted check deadline,
+    // and never slower than the active fence profile allows
+    uint32_t checkDelay = geofenceManager.getNextCheckDelay();
+    uint32_t rate = (checkDelay > GPS_UPDATE_RATE + GEOFENCE_SCHEDULE_SLACK)
+                  ? checkDelay - GEOFENCE_SCHEDULE_SLACK
+                  : GPS_UPDATE_RATE;
+    uint32_t profileRate = (uint32_t)geofenceManager.getActiveProfile().gnssInterval * 1000;
+    rate = max((uint32_t)GPS_UPDATE_RATE, min(rate, profileRate));
+    
+    if (rate != gpsManager.getUpdateRate()) {
+        gpsManager.setUpdateRate(rate);
+        Serial.print("GPS update rate: ");
+        Serial.print(rate);
+        Serial.println(" ms");
+    }
+}
+
+void handleDownlinks() {
+    uint8_t payload[LORAWAN_DOWNLINK_BUFFER_SIZE];
+    size_t length = 0;
+    uint8_t port = 0;
+    
+    if (!loraManager.getDownlink(payload, length, port)) {
+        return;
     }
+    
+    if (port == FUOTA_FRAG_PORT) {
+        firmwareUpdate.handleDownlink(payload, length, loraManager.getDownlinkGroup());
+        return;
+    }
+    
+    if (port == MULTICAST_SETUP_PORT) {
+        loraManager.handleMulticastSetup(payload, length, clockTime());
+        return;
+    }
+    
+    if (port != LORAWAN_CONFIG_PORT || length == 0) {
+        Serial.print("Ignoring downlink on port ");
+        Serial.println(port);
+        return;
+    }
+    
+    // The first manager that knows the command answers for it
+    uint8_t result = geofenceManager.handleDownlink(payload, length);
+    if (result == CONFIG_UNKNOWN) {
+        result = ruleEngine.handleDownlink(payload, length);
+    }
+    if (result == CONFIG_UNKNOWN) {
+        result = loraManager.handleDownlink(payload, length);
+    }
+    
+    if (result == CONFIG_UNKNOWN) {
+        Serial.print("Unknown config command 0x");
+        Serial.println(payload[0], HEX);
+    } else if (result == CONFIG_REJECTED) {
+        Serial.print("Config command 0x");
+        Serial.print(payload[0], HEX);
+        Serial.println(" rejected");
+    }
+}
+
+// Unix time from the GPS-synced clock, 0 before the first fix
+uint32_t clockTime() {
+    return geofenceManager.isClockSynced() ? geofenceManager.getUnixTime() : 0;
 }
 
 void updateSystemStatus() {
@@ -317,6 +1001,11 @@ void updateSystemStatus() {
 }
 
 void updateDisplayContent() {
+    // Nothing to render while the panel is powered down
+    if (!displayManager.isOn()) {
+        return;
+    }
+    
     switch (systemState.currentScreen) {
         case 0:
             displayManager.showMainScreen(
@@ -344,7 +1033,25 @@ void updateDisplayContent() {
             );
             break;
             
-        case 3:
+        case 3: {
+            FenceDistance nearest[3];
+            uint8_t count = 0;
+            bool fix = gpsManager.hasValidFix();
+            if (fix) {
+                GPSData pos = gpsManager.getCurrentData();
+                count = geofenceManager.findNearest(pos.latitude / 1e6, pos.longitude / 1e6, nearest, 3);
+            }
+            displayManager.showGeofenceScreen(
+                fix,
+                nearest,
+                count,
+                geofenceManager.getGeofenceCount(),
+                __builtin_popcount(geofenceManager.getArmedMask())
+            );
+            break;
+        }
+            
+        case 4:
             displayManager.showSystemScreen(
                 PROJECT_VERSION,
                 millis() - systemState.systemStartTime,
@@ -367,12 +1074,28 @@ void performSystemMaintenance() {
             Serial.println("=== SYSTEM STATISTICS ===");
             loraManager.printStatistics();
             gpsManager.printStatistics();
+            displayManager.printStatistics();
+            geofenceManager.printStatus();
+            buttonManager.printStatistics();
+            ruleEngine.printStatistics();
+            tripDetector.printStatistics();
+            trackBuffer.printStatistics();
+            firmwareUpdate.printStatistics();
+            loraManager.printMulticastStatistics();
+            loraManager.printRxTimingStatistics();
         }
         
         lastMaintenance = millis();
     }
 }
 
+// ===============================================================
+// INTERRUPT HANDLERS
+// ===============================================================
+void IRAM_ATTR onButtonInterrupt() {
+    displayManager.requestWake();
+}
+
 // ===============================================================
 // UTILITY FUNCTIONS
 // ===============================================================
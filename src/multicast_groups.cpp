@@ -0,0 +1,414 @@
+#include "multicast_groups.h"
+#include "lorawan_crypto.h"
+#include "lorawan_region.h"
+#include <Preferences.h>
+
+#define MC_FRAME_OVERHEAD   12       // MHDR, DevAddr, FCtrl, FCnt, MIC
+#define MC_MHDR_UNCONFIRMED 0x60     // Unconfirmed data down, LoRaWAN R1
+#define MC_MAX_FRAME        255      // Largest LoRa payload
+
+static inline uint32_t readLE32(const uint8_t* data) {
+    return data[0] | (data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+static inline void writeLE32(uint8_t* data, uint32_t value) {
+    data[0] = value & 0xFF;
+    data[1] = (value >> 8) & 0xFF;
+    data[2] = (value >> 16) & 0xFF;
+    data[3] = (value >> 24) & 0xFF;
+}
+
+void deriveMulticastKeyEncryptionKey(const uint8_t* genAppKey, uint8_t* mcKEKey) {
+    uint8_t block[16];
+    uint8_t rootKey[16];
+    memset(block, 0, sizeof(block));
+    aesEncryptBlock(genAppKey, block, rootKey);
+    aesEncryptBlock(rootKey, block, mcKEKey);
+}
+
+void deriveMulticastSessionKeys(const uint8_t* mcKey, uint32_t address, uint8_t* appSKey, uint8_t* netSKey) {
+    uint8_t block[16];
+    memset(block, 0, sizeof(block));
+    writeLE32(&block[1], address);
+    block[0] = 0x01;
+    aesEncryptBlock(mcKey, block, appSKey);
+    block[0] = 0x02;
+    aesEncryptBlock(mcKey, block, netSKey);
+}
+
+// ===============================================================
+// CONSTRUCTOR & DESTRUCTOR
+// ===============================================================
+
+MulticastGroups::MulticastGroups() :
+    answerLength(0),
+    totalFrames(0),
+    totalRejected(0),
+    totalReplays(0),
+    totalSessions(0) {
+    memset(groups, 0, sizeof(groups));
+    memset(sessions, 0, sizeof(sessions));
+    memset(keyEncryptionKey, 0, sizeof(keyEncryptionKey));
+    memset(fCntReserved, 0, sizeof(fCntReserved));
+}
+
+MulticastGroups::~MulticastGroups() {
+}
+
+// ===============================================================
+// INITIALIZATION
+// ===============================================================
+
+bool MulticastGroups::begin(const uint8_t* genAppKey) {
+    deriveMulticastKeyEncryptionKey(genAppKey, keyEncryptionKey);
+    loadGroups();
+
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < MULTICAST_MAX_GROUPS; i++) {
+        count += groups[i].defined;
+    }
+    Serial.print("Multicast: ");
+    Serial.print(count);
+    Serial.println(" group(s) restored");
+    return true;
+}
+
+// ===============================================================
+// PACKAGE COMMANDS
+// ===============================================================
+
+bool MulticastGroups::handleDownlink(const uint8_t* payload, size_t length, uint32_t unixTime) {
+    size_t pos = 0;
+    while (pos < length) {
+        size_t used = handleCommand(&payload[pos], length - pos, unixTime);
+        if (used == 0) {
+            Serial.print("Multicast: Bad or unknown command 0x");
+            Serial.println(payload[pos], HEX);
+            return pos > 0;
+        }
+        pos += used;
+    }
+    return length > 0;
+}
+
+size_t MulticastGroups::handleCommand(const uint8_t* payload, size_t length, uint32_t unixTime) {
+    switch (payload[0]) {
+        case MC_PACKAGE_VERSION: {
+            uint8_t version[3] = {MC_PACKAGE_VERSION, MC_PACKAGE_ID, MC_PACKAGE_VERSION_NUMBER};
+            queueAnswer(version, sizeof(version));
+            return 1;
+        }
+
+        case MC_GROUP_STATUS: {
+            if (length < 2) {
+                return 0;
+            }
+            uint8_t reply[2 + 5 * MULTICAST_MAX_GROUPS];
+            uint8_t defined = 0;
+            uint8_t mask = 0;
+            size_t replyLength = 2;
+            for (uint8_t i = 0; i < MULTICAST_MAX_GROUPS; i++) {
+                if (!groups[i].defined) {
+                    continue;
+                }
+                defined++;
+                if (payload[1] & (1 << i)) {
+                    mask |= 1 << i;
+                    reply[replyLength++] = i;
+                    writeLE32(&reply[replyLength], groups[i].address);
+                    replyLength += 4;
+                }
+            }
+            reply[0] = MC_GROUP_STATUS;
+            reply[1] = (defined << 4) | mask;
+            queueAnswer(reply, replyLength);
+            return 2;
+        }
+
+        case MC_GROUP_SETUP:
+            if (length < 30) {
+                return 0;
+            }
+            handleSetup(&payload[1]);
+            return 30;
+
+        case MC_GROUP_DELETE: {
+            if (length < 2) {
+                return 0;
+            }
+            uint8_t id = payload[1] & 0x03;
+            uint8_t reply[2] = {MC_GROUP_DELETE, id};
+            if (id >= MULTICAST_MAX_GROUPS || !groups[id].defined) {
+                reply[1] |= MC_GROUP_UNDEFINED;
+            } else {
+                memset(&groups[id], 0, sizeof(MulticastGroup));
+                memset(&sessions[id], 0, sizeof(MulticastSession));
+                saveGroups();
+                Serial.print("Multicast: Group ");
+                Serial.print(id);
+                Serial.println(" deleted");
+            }
+            queueAnswer(reply, sizeof(reply));
+            return 2;
+        }
+
+        case MC_CLASS_C_SESSION:
+            if (length < 11) {
+                return 0;
+            }
+            handleSession(&payload[1], unixTime);
+            return 11;
+
+        default:
+            return 0;
+    }
+}
+
+void MulticastGroups::handleSetup(const uint8_t* payload) {
+    uint8_t id = payload[0] & 0x03;
+    uint8_t reply[2] = {MC_GROUP_SETUP, id};
+    if (id >= MULTICAST_MAX_GROUPS) {
+        reply[1] |= MC_GROUP_ID_ERROR;
+        queueAnswer(reply, sizeof(reply));
+        return;
+    }
+
+    MulticastGroup& group = groups[id];
+    uint8_t mcKey[16];
+    aesEncryptBlock(keyEncryptionKey, &payload[5], mcKey);
+    group.address = readLE32(&payload[1]);
+    deriveMulticastSessionKeys(mcKey, group.address, group.appSKey, group.netSKey);
+    memset(mcKey, 0, sizeof(mcKey));
+    group.minFCnt = readLE32(&payload[21]);
+    group.maxFCnt = readLE32(&payload[25]);
+    group.nextFCnt = group.minFCnt;
+    fCntReserved[id] = group.minFCnt;
+    group.defined = true;
+    memset(&sessions[id], 0, sizeof(MulticastSession));
+    saveGroups();
+
+    Serial.print("Multicast: Group ");
+    Serial.print(id);
+    Serial.print(" at 0x");
+    Serial.println(group.address, HEX);
+    queueAnswer(reply, sizeof(reply));
+}
+
+void MulticastGroups::handleSession(const uint8_t* payload, uint32_t unixTime) {
+    uint8_t id = payload[0] & 0x03;
+    uint32_t gpsTime = readLE32(&payload[1]);
+    uint8_t timeout = payload[5] & 0x0F;
+    uint32_t frequency = (payload[6] | (payload[7] << 8) | ((uint32_t)payload[8] << 16)) * 100;
+    uint8_t dataRate = payload[9];
+
+    uint8_t status = 0;
+    if (id >= MULTICAST_MAX_GROUPS || !groups[id].defined) {
+        status |= MC_SESSION_GROUP_UNDEFINED;
+    }
+    if (!Region::isDownlinkFrequency(frequency)) {
+        status |= MC_SESSION_FREQ_ERROR;
+    }
+    if (Region::spreadingFactor(dataRate) == 0) {
+        status |= MC_SESSION_DR_ERROR;
+    }
+    if (unixTime == 0) {
+        // No clock, no TimeToStart: the group cannot take a session yet
+        Serial.println("Multicast: No clock for a Class C session");
+        status |= MC_SESSION_GROUP_UNDEFINED;
+    }
+
+    uint8_t reply[5] = {MC_CLASS_C_SESSION, (uint8_t)(status | id)};
+    if (status != 0) {
+        Serial.print("Multicast: Session refused, status 0x");
+        Serial.println(status, HEX);
+        queueAnswer(reply, 2);
+        return;
+    }
+
+    MulticastSession& session = sessions[id];
+    session.start = gpsTime + GPS_UNIX_OFFSET - GPS_LEAP_SECONDS;
+    session.end = session.start + (1UL << timeout);
+    session.frequency = frequency;
+    session.dataRate = dataRate;
+    totalSessions++;
+
+    uint32_t toStart = session.start > unixTime ? min(session.start - unixTime, 0xFFFFFFUL) : 0;
+    reply[2] = toStart & 0xFF;
+    reply[3] = (toStart >> 8) & 0xFF;
+    reply[4] = (toStart >> 16) & 0xFF;
+    queueAnswer(reply, sizeof(reply));
+
+    Serial.print("Multicast: Group ");
+    Serial.print(id);
+    Serial.print(" Class C session in ");
+    Serial.print(toStart);
+    Serial.print(" s for ");
+    Serial.print(1UL << timeout);
+    Serial.print(" s, DR");
+    Serial.println(dataRate);
+}
+
+void MulticastGroups::queueAnswer(const uint8_t* data, size_t length) {
+    if (answerLength + length > sizeof(answer)) {
+        Serial.println("Multicast: Answer buffer full, dropping an answer");
+        return;
+    }
+    memcpy(&answer[answerLength], data, length);
+    answerLength += length;
+}
+
+bool MulticastGroups::getAnswer(uint8_t* buffer, size_t& length) {
+    if (answerLength == 0) {
+        return false;
+    }
+    memcpy(buffer, answer, answerLength);
+    length = answerLength;
+    answerLength = 0;
+    return true;
+}
+
+// ===============================================================
+// CLASS C SESSIONS
+// ===============================================================
+
+int8_t MulticastGroups::getActiveSession(uint32_t unixTime) const {
+    if (unixTime == 0) {
+        return -1;
+    }
+    for (uint8_t i = 0; i < MULTICAST_MAX_GROUPS; i++) {
+        if (groups[i].defined && sessions[i].start != 0 &&
+            unixTime >= sessions[i].start && unixTime < sessions[i].end) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void MulticastGroups::endSession(uint8_t index) {
+    sessions[index].start = 0;
+    saveGroups();
+}
+
+bool MulticastGroups::decodeFrame(uint8_t index, const uint8_t* frame, size_t length,
+                                  uint8_t* payload, size_t& payloadLength, uint8_t& port) {
+    MulticastGroup& group = groups[index];
+    if (!group.defined || length < MC_FRAME_OVERHEAD || readLE32(&frame[1]) != group.address) {
+        return false;                // Someone else's frame
+    }
+
+    // Multicast carries no MAC commands and cannot be confirmed
+    if (frame[0] != MC_MHDR_UNCONFIRMED || (frame[5] & 0x0F) != 0 || length == MC_FRAME_OVERHEAD) {
+        totalRejected++;
+        return false;
+    }
+
+    // Full counter: the 16 bits sent, at or after the next one expected
+    uint32_t fCnt = (group.nextFCnt & 0xFFFF0000UL) | frame[6] | (frame[7] << 8);
+    if (fCnt < group.nextFCnt) {
+        fCnt += 0x10000;
+    }
+    if (fCnt < group.minFCnt || fCnt > group.maxFCnt) {
+        totalReplays++;
+        return false;
+    }
+
+    size_t messageLength = length - 4;
+    if (length > MC_MAX_FRAME) {
+        totalRejected++;
+        return false;
+    }
+    uint8_t mic[4];
+    lorawanFrameMic(group.netSKey, LORAWAN_DOWNLINK, group.address, fCnt, frame, messageLength, mic);
+    if (memcmp(mic, &frame[messageLength], 4) != 0) {
+        totalRejected++;
+        return false;
+    }
+
+    port = frame[8];
+    if (port == 0) {
+        totalRejected++;
+        return false;
+    }
+    payloadLength = messageLength - 9;
+    lorawanCryptPayload(group.appSKey, LORAWAN_DOWNLINK, group.address, fCnt, &frame[9], payload, payloadLength);
+
+    group.nextFCnt = fCnt + 1;
+    if (group.nextFCnt > fCntReserved[index]) {
+        fCntReserved[index] = group.nextFCnt + MULTICAST_FCNT_SAVE_INTERVAL;
+        saveCounters();
+    }
+    totalFrames++;
+    return true;
+}
+
+// ===============================================================
+// PERSISTENCE
+// ===============================================================
+
+void MulticastGroups::saveGroups() {
+    Preferences prefs;
+    if (prefs.begin(STORAGE_NAMESPACE, false)) {
+        prefs.putBytes("mc_groups", groups, sizeof(groups));
+        prefs.end();
+    }
+    saveCounters();
+}
+
+void MulticastGroups::saveCounters() {
+    Preferences prefs;
+    if (prefs.begin(STORAGE_NAMESPACE, false)) {
+        prefs.putBytes("mc_fcnt", fCntReserved, sizeof(fCntReserved));
+        prefs.end();
+    }
+}
+
+void MulticastGroups::loadGroups() {
+    Preferences prefs;
+    if (!prefs.begin(STORAGE_NAMESPACE, true)) {
+        return;
+    }
+    if (prefs.getBytesLength("mc_groups") == sizeof(groups)) {
+        prefs.getBytes("mc_groups", groups, sizeof(groups));
+    }
+    if (prefs.getBytesLength("mc_fcnt") == sizeof(fCntReserved)) {
+        prefs.getBytes("mc_fcnt", fCntReserved, sizeof(fCntReserved));
+    }
+    prefs.end();
+
+    // Counters used before the reset may run up to the reservation
+    for (uint8_t i = 0; i < MULTICAST_MAX_GROUPS; i++) {
+        if (groups[i].defined && fCntReserved[i] > groups[i].nextFCnt) {
+            groups[i].nextFCnt = fCntReserved[i];
+        }
+        fCntReserved[i] = groups[i].nextFCnt;
+    }
+}
+
+// ===============================================================
+// DEBUG & LOGGING
+// ===============================================================
+
+void MulticastGroups::printStatistics() {
+    Serial.println("=== MULTICAST STATISTICS ===");
+    for (uint8_t i = 0; i < MULTICAST_MAX_GROUPS; i++) {
+        if (!groups[i].defined) {
+            continue;
+        }
+        Serial.print("Group ");
+        Serial.print(i);
+        Serial.print(": 0x");
+        Serial.print(groups[i].address, HEX);
+        Serial.print(", next FCnt ");
+        Serial.print(groups[i].nextFCnt);
+        Serial.print(" of ");
+        Serial.println(groups[i].maxFCnt);
+    }
+    Serial.print("Sessions / frames: ");
+    Serial.print(totalSessions);
+    Serial.print(" / ");
+    Serial.println(totalFrames);
+    Serial.print("Rejected / replayed: ");
+    Serial.print(totalRejected);
+    Serial.print(" / ");
+    Serial.println(totalReplays);
+}
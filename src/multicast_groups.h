@@ -0,0 +1,149 @@
+#ifndef MULTICAST_GROUPS_H
+#define MULTICAST_GROUPS_H
+
+#include <Arduino.h>
+#include "../include/project_config.h"
+
+// ===============================================================
+// REMOTE MULTICAST SETUP (MULTICAST_SETUP_PORT)
+// ===============================================================
+//
+// Commands and answers follow the LoRaWAN remote multicast setup
+// (TS005 v1.0.0), little-endian as there. One downlink may carry
+// several commands; their answers go back together.
+//
+//   0x00 PackageVersionReq                  -> [0x00][2][1]
+//   0x01 McGroupStatusReq [mask]            -> [0x01][groups << 4 | mask]
+//                                              then [id][McAddr u32] each
+//   0x02 McGroupSetupReq [id][McAddr u32][McKey_encrypted 16]
+//        [min FCnt u32][max FCnt u32]       -> [0x02][id error << 2 | id]
+//   0x03 McGroupDeleteReq [id]              -> [0x03][undefined << 2 | id]
+//   0x04 McClassCSessionReq [id][SessionTime u32][timeout]
+//        [frequency u24, 100 Hz][DR]        -> [0x04][status | id][TimeToStart u24]
+//
+// Keys, for a LoRaWAN 1.0.x device (GenAppKey = LORAWAN_GENAPPKEY):
+//
+//   McRootKey = aes128_encrypt(GenAppKey, 0x00 | pad16)
+//   McKEKey   = aes128_encrypt(McRootKey, 0x00 | pad16)
+//   McKey     = aes128_encrypt(McKEKey, McKey_encrypted)
+//   McAppSKey = aes128_encrypt(McKey, 0x01 | McAddr | pad16)
+//   McNetSKey = aes128_encrypt(McKey, 0x02 | McAddr | pad16)
+//
+// SessionTime is GPS time (seconds since 1980-01-06, mod 2^32); the
+// session lasts 2^timeout seconds from there. Until then nothing
+// changes; during it LoRaWANManager listens on the session's channel
+// between Class A exchanges (Class C), and frames to McAddr that carry
+// the McNetSKey MIC and a frame counter inside the group's window are
+// decrypted with McAppSKey and handled like any downlink. A session
+// needs the clock (GPS); without it the answer says McGroup undefined
+// (no TimeToStart can be given) and nothing is scheduled.
+// Groups persist across reboots, sessions do not. Frame counters are
+// reserved in NVS MULTICAST_FCNT_SAVE_INTERVAL ahead: after a reset the
+// group resumes at the reservation, so frames heard before it cannot be
+// replayed, at the cost of skipping up to that many new ones.
+
+#define MC_PACKAGE_VERSION          0x00
+#define MC_GROUP_STATUS             0x01
+#define MC_GROUP_SETUP              0x02
+#define MC_GROUP_DELETE             0x03
+#define MC_CLASS_C_SESSION          0x04
+
+#define MC_PACKAGE_ID               2
+#define MC_PACKAGE_VERSION_NUMBER   1
+#define MC_MAX_ANSWER               32
+
+// McGroupSetupAns / McGroupDeleteAns
+#define MC_GROUP_ID_ERROR           0x04
+#define MC_GROUP_UNDEFINED          0x04
+
+// McClassCSessionAns status bits (7:5 RFU)
+#define MC_SESSION_DR_ERROR         0x04
+#define MC_SESSION_FREQ_ERROR       0x08
+#define MC_SESSION_GROUP_UNDEFINED  0x10
+
+#define GPS_UNIX_OFFSET             315964800UL     // 1980-01-06 in Unix time
+#define GPS_LEAP_SECONDS            18              // GPS ahead of UTC since 2017
+
+struct MulticastGroup {
+    bool defined;
+    uint32_t address;        // McAddr
+    uint8_t appSKey[16];
+    uint8_t netSKey[16];
+    uint32_t minFCnt;
+    uint32_t maxFCnt;
+    uint32_t nextFCnt;       // Lowest counter still accepted
+};
+
+struct MulticastSession {
+    uint32_t start;          // Unix time, 0 = none
+    uint32_t end;
+    uint32_t frequency;      // Hz
+    uint8_t dataRate;
+};
+
+// ===============================================================
+// MULTICAST GROUPS CLASS
+// ===============================================================
+
+class MulticastGroups {
+private:
+    MulticastGroup groups[MULTICAST_MAX_GROUPS];
+    MulticastSession sessions[MULTICAST_MAX_GROUPS];
+    uint8_t keyEncryptionKey[16];    // McKEKey
+    uint32_t fCntReserved[MULTICAST_MAX_GROUPS];    // In NVS: nextFCnt never below it after a reset
+
+    // Answers waiting for an uplink
+    uint8_t answer[MC_MAX_ANSWER];
+    uint8_t answerLength;
+
+    // Statistics
+    uint32_t totalFrames;
+    uint32_t totalRejected;          // Wrong MIC or format
+    uint32_t totalReplays;           // Counter outside the window
+    uint32_t totalSessions;
+
+    // Private methods
+    size_t handleCommand(const uint8_t* payload, size_t length, uint32_t unixTime);
+    void handleSetup(const uint8_t* payload);
+    void handleSession(const uint8_t* payload, uint32_t unixTime);
+    void queueAnswer(const uint8_t* data, size_t length);
+    void saveGroups();
+    void saveCounters();
+    void loadGroups();
+
+public:
+    // Constructor & Destructor
+    MulticastGroups();
+    ~MulticastGroups();
+
+    // Initialization: derives McKEKey, restores the groups
+    bool begin(const uint8_t* genAppKey);
+
+    // Package commands on MULTICAST_SETUP_PORT (unixTime 0 = no clock)
+    bool handleDownlink(const uint8_t* payload, size_t length, uint32_t unixTime);
+    bool getAnswer(uint8_t* buffer, size_t& length);
+
+    // Class C: the group whose session is on (-1 = none), its channel,
+    // and the end of it (keeps the frame counter for the next session)
+    int8_t getActiveSession(uint32_t unixTime) const;
+    const MulticastSession& getSession(uint8_t index) const { return sessions[index]; }
+    void endSession(uint8_t index);
+
+    // A received frame: true with the decrypted payload and port when it
+    // is for the group, authentic and new
+    bool decodeFrame(uint8_t index, const uint8_t* frame, size_t length,
+                     uint8_t* payload, size_t& payloadLength, uint8_t& port);
+
+    // Debug & Logging
+    void printStatistics();
+};
+
+// ===============================================================
+// HELPER FUNCTIONS
+// ===============================================================
+
+// TS005 key derivation
+void deriveMulticastKeyEncryptionKey(const uint8_t* genAppKey, uint8_t* mcKEKey);
+void deriveMulticastSessionKeys(const uint8_t* mcKey, uint32_t address, uint8_t* appSKey, uint8_t* netSKey);
+
+#endif // MULTICAST_GROUPS_H
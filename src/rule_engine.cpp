@@ -0,0 +1,621 @@
+#include "rule_engine.h"
+#include <Preferences.h>
+
+static inline uint32_t signalBit(uint32_t word, uint8_t index) {
+    return index < 32 ? (word >> index) & 1 : 0;
+}
+
+// ===============================================================
+// CONSTRUCTOR & DESTRUCTOR
+// ===============================================================
+
+RuleEngine::RuleEngine() :
+    ruleCount(0),
+    codeSize(0),
+    speedCount(0),
+    windowCount(0),
+    linkedLayout(0),
+    needsLink(true),
+    lastInside(0),
+    lastSpeedBits(0),
+    lastTimeBits(0),
+    resultMask(0),
+    unknownMask(0),
+    dirtyMask(0),
+    pendingHead(0),
+    pendingCount(0),
+    totalPasses(0),
+    totalRuleEvals(0),
+    totalRuleSkips(0),
+    totalEvents(0) {
+    memset(rules, 0, sizeof(rules));
+    memset(ruleEvals, 0, sizeof(ruleEvals));
+    memset(ruleCycles, 0, sizeof(ruleCycles));
+}
+
+RuleEngine::~RuleEngine() {
+}
+
+// ===============================================================
+// INITIALIZATION
+// ===============================================================
+
+bool RuleEngine::begin() {
+    Serial.println("Rule Engine: Initializing...");
+
+    if (!loadRules()) {
+        ruleCount = 0;
+        codeSize = 0;
+    }
+
+    unknownMask = (ruleCount > 0) ? (0xFFFFFFFFUL >> (32 - ruleCount)) : 0;
+    dirtyMask = unknownMask;
+    needsLink = true;
+
+    Serial.print("Rule Engine: ");
+    Serial.print(ruleCount);
+    Serial.println(" rules loaded");
+    return true;
+}
+
+// ===============================================================
+// RULE MANAGEMENT
+// ===============================================================
+
+bool RuleEngine::addRule(uint8_t id, const uint8_t* program, uint8_t length) {
+    if (!verifyProgram(program, length)) {
+        Serial.println("Rule Engine: Rule rejected (invalid bytecode)");
+        return false;
+    }
+
+    // A replaced rule's slot and code count as free, but the old rule
+    // stays until the new one is known to fit
+    int8_t existing = findIndex(id);
+    uint8_t freedRules = existing >= 0 ? 1 : 0;
+    uint16_t freedCode = existing >= 0 ? rules[existing].codeLength : 0;
+    if (ruleCount - freedRules >= MAX_RULES || codeSize - freedCode + length > MAX_RULE_CODE) {
+        Serial.println("Rule Engine: Rule rejected (no space)");
+        return false;
+    }
+
+    // Replacing a rule keeps nothing of the old one
+    if (existing >= 0) {
+        eraseRule(existing);
+    }
+
+    Rule& rule = rules[ruleCount];
+    rule.id = id;
+    rule.codeStart = codeSize;
+    rule.codeLength = length;
+    memcpy(&code[codeSize], program, length);
+    codeSize += length;
+
+    uint32_t bit = 1UL << ruleCount;
+    resultMask &= ~bit;
+    unknownMask |= bit;
+    dirtyMask |= bit;
+    ruleEvals[ruleCount] = 0;
+    ruleCycles[ruleCount] = 0;
+    ruleCount++;
+
+    needsLink = true;
+    saveRules();
+    return true;
+}
+
+bool RuleEngine::removeRule(uint8_t id) {
+    int8_t index = findIndex(id);
+    if (index < 0) {
+        return false;
+    }
+
+    eraseRule(index);
+    saveRules();
+    return true;
+}
+
+void RuleEngine::eraseRule(uint8_t index) {
+    // Compact the shared code pool
+    uint16_t start = rules[index].codeStart;
+    uint8_t length = rules[index].codeLength;
+    memmove(&code[start], &code[start + length], codeSize - start - length);
+    codeSize -= length;
+    for (uint8_t i = 0; i < ruleCount; i++) {
+        if (rules[i].codeStart > start) {
+            rules[i].codeStart -= length;
+        }
+    }
+
+    // Shift rules, statistics and state bits down by one
+    uint8_t tail = ruleCount - index - 1;
+    memmove(&rules[index], &rules[index + 1], tail * sizeof(Rule));
+    memmove(&ruleEvals[index], &ruleEvals[index + 1], tail * sizeof(uint32_t));
+    memmove(&ruleCycles[index], &ruleCycles[index + 1], tail * sizeof(uint32_t));
+
+    uint32_t lowBits = (1UL << index) - 1;
+    resultMask = (resultMask & lowBits) | ((resultMask >> 1) & ~lowBits);
+    unknownMask = (unknownMask & lowBits) | ((unknownMask >> 1) & ~lowBits);
+    dirtyMask = (dirtyMask & lowBits) | ((dirtyMask >> 1) & ~lowBits);
+
+    ruleCount--;
+    needsLink = true;
+}
+
+void RuleEngine::clearRules() {
+    ruleCount = 0;
+    codeSize = 0;
+    resultMask = 0;
+    unknownMask = 0;
+    dirtyMask = 0;
+    pendingCount = 0;
+    needsLink = true;
+    saveRules();
+}
+
+int8_t RuleEngine::findIndex(uint8_t id) const {
+    for (uint8_t i = 0; i < ruleCount; i++) {
+        if (rules[i].id == id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool RuleEngine::isActive(uint8_t id) const {
+    int8_t index = findIndex(id);
+    return index >= 0 && ((resultMask >> index) & 1);
+}
+
+bool RuleEngine::verifyProgram(const uint8_t* program, uint8_t length) const {
+    // Everything the interpreter trusts is checked here: operand bounds,
+    // stack depth, and a single result at OP_END
+    uint8_t depth = 0;
+    uint8_t pc = 0;
+
+    while (pc < length) {
+        uint8_t op = program[pc++];
+
+        switch (op) {
+            case OP_END:
+                return depth == 1 && pc == length;
+
+            case OP_INSIDE:
+            case OP_SPEED_ABOVE:
+                if (pc + 1 > length) return false;
+                pc += 1;
+                depth++;
+                break;
+
+            case OP_INSIDE_ANY:
+                if (pc + 1 > length || program[pc] == 0 || pc + 1 + program[pc] > length) return false;
+                pc += 1 + program[pc];
+                depth++;
+                break;
+
+            case OP_TIME_IN:
+                if (pc + 2 > length ||
+                    program[pc] >= SCHEDULE_SLOTS_PER_DAY || program[pc + 1] >= SCHEDULE_SLOTS_PER_DAY) {
+                    return false;
+                }
+                pc += 2;
+                depth++;
+                break;
+
+            case OP_NOT:
+                if (depth < 1) return false;
+                break;
+
+            case OP_AND:
+            case OP_OR:
+                if (depth < 2) return false;
+                depth--;
+                break;
+
+            default:
+                return false;
+        }
+
+        if (depth > RULE_STACK_DEPTH) {
+            return false;
+        }
+    }
+
+    return false; // Missing OP_END
+}
+
+// ===============================================================
+// LINKING
+// ===============================================================
+
+void RuleEngine::link(const GeofenceManager& geofences) {
+    speedCount = 0;
+    windowCount = 0;
+    bool overflow = false;
+
+    for (uint8_t r = 0; r < ruleCount; r++) {
+        const uint8_t* src = &code[rules[r].codeStart];
+        uint8_t* dst = &linked[rules[r].codeStart];
+        uint8_t length = rules[r].codeLength;
+        fenceDeps[r] = 0;
+        speedDeps[r] = 0;
+        timeDeps[r] = 0;
+
+        uint8_t pc = 0;
+        while (pc < length) {
+            uint8_t op = src[pc];
+            dst[pc++] = op;
+
+            switch (op) {
+                case OP_INSIDE:
+                case OP_INSIDE_ANY: {
+                    uint8_t n = 1;
+                    if (op == OP_INSIDE_ANY) {
+                        n = src[pc];
+                        dst[pc] = n;
+                        pc++;
+                    }
+                    for (uint8_t i = 0; i < n; i++, pc++) {
+                        int8_t index = geofences.getIndex(src[pc]);
+                        dst[pc] = (index >= 0) ? index : RULE_NO_SIGNAL;
+                        if (index >= 0) {
+                            fenceDeps[r] |= 1UL << index;
+                        }
+                    }
+                    break;
+                }
+
+                case OP_SPEED_ABOVE: {
+                    int8_t k = internSpeed(src[pc]);
+                    dst[pc++] = (k >= 0) ? k : RULE_NO_SIGNAL;
+                    if (k >= 0) speedDeps[r] |= 1U << k; else overflow = true;
+                    break;
+                }
+
+                case OP_TIME_IN: {
+                    int8_t k = internWindow(src[pc], src[pc + 1]);
+                    dst[pc] = (k >= 0) ? k : RULE_NO_SIGNAL;
+                    dst[pc + 1] = src[pc + 1];
+                    pc += 2;
+                    if (k >= 0) timeDeps[r] |= 1U << k; else overflow = true;
+                    break;
+                }
+
+                default:
+                    break;
+            }
+        }
+    }
+
+    if (overflow) {
+        Serial.println("Rule Engine: Signal table full, some conditions read false");
+    }
+
+    // Signal indices may have moved, so every rule is re-run once
+    lastSpeedBits = 0;
+    lastTimeBits = 0;
+    dirtyMask = (ruleCount > 0) ? (0xFFFFFFFFUL >> (32 - ruleCount)) : 0;
+    linkedLayout = geofences.getLayoutVersion();
+    needsLink = false;
+}
+
+int8_t RuleEngine::internSpeed(uint8_t kmh) {
+    for (uint8_t k = 0; k < speedCount; k++) {
+        if (speedThresholds[k] == kmh) {
+            return k;
+        }
+    }
+    if (speedCount >= MAX_RULE_SIGNALS) {
+        return -1;
+    }
+    speedThresholds[speedCount] = kmh;
+    return speedCount++;
+}
+
+int8_t RuleEngine::internWindow(uint8_t start, uint8_t end) {
+    for (uint8_t k = 0; k < windowCount; k++) {
+        if (windowStart[k] == start && windowEnd[k] == end) {
+            return k;
+        }
+    }
+    if (windowCount >= MAX_RULE_SIGNALS) {
+        return -1;
+    }
+    windowStart[windowCount] = start;
+    windowEnd[windowCount] = end;
+    return windowCount++;
+}
+
+// ===============================================================
+// EVALUATION
+// ===============================================================
+
+bool RuleEngine::evaluate(const GeofenceManager& geofences, float speedMps, int32_t lat, int32_t lon,
+                          RuleEvent& event) {
+    if (needsLink || linkedLayout != geofences.getLayoutVersion()) {
+        link(geofences);
+    }
+
+    // Reduce the inputs to signal words; a rule only reads bits of these
+    uint32_t inside = geofences.getInsideMask();
+
+    bool speedKnown = speedMps >= 0;
+    uint16_t speedBits = 0;
+    if (speedKnown) {
+        float kmh = speedMps * 3.6;
+        for (uint8_t k = 0; k < speedCount; k++) {
+            if (kmh > speedThresholds[k]) {
+                speedBits |= 1U << k;
+            }
+        }
+    }
+
+    int16_t weekSlot = geofences.isClockSynced()
+        ? scheduleSlotForTime(geofences.getUnixTime(), geofences.getUtcOffset())
+        : -1;
+    bool timeKnown = weekSlot >= 0;
+    uint16_t timeBits = 0;
+    if (timeKnown && windowCount > 0) {
+        uint8_t slot = weekSlot % SCHEDULE_SLOTS_PER_DAY;
+        for (uint8_t k = 0; k < windowCount; k++) {
+            bool in = (windowStart[k] < windowEnd[k])
+                ? (slot >= windowStart[k] && slot < windowEnd[k])
+                : (slot >= windowStart[k] || slot < windowEnd[k]);  // Wraps past midnight
+            if (in) {
+                timeBits |= 1U << k;
+            }
+        }
+    }
+
+    uint32_t changedInside = inside ^ lastInside;
+    uint16_t changedSpeed = speedBits ^ lastSpeedBits;
+    uint16_t changedTime = timeBits ^ lastTimeBits;
+
+    uint32_t due = dirtyMask;
+    if (changedInside || changedSpeed || changedTime) {
+        for (uint8_t r = 0; r < ruleCount; r++) {
+            if ((fenceDeps[r] & changedInside) || (speedDeps[r] & changedSpeed) || (timeDeps[r] & changedTime)) {
+                due |= 1UL << r;
+            }
+        }
+    }
+
+    if (due) {
+        totalPasses++;
+        uint32_t timestamp = timeKnown ? geofences.getUnixTime() : millis() / 1000;
+
+        for (uint8_t r = 0; r < ruleCount; r++) {
+            uint32_t bit = 1UL << r;
+            if (!(due & bit)) {
+                totalRuleSkips++;
+                continue;
+            }
+
+            // Wait until every input the rule reads is known
+            if ((speedDeps[r] && !speedKnown) || (timeDeps[r] && !timeKnown)) {
+                continue;
+            }
+
+            uint32_t start = ESP.getCycleCount();
+            bool result = run(&linked[rules[r].codeStart], inside, speedBits, timeBits);
+            ruleCycles[r] += ESP.getCycleCount() - start;
+            ruleEvals[r]++;
+            totalRuleEvals++;
+
+            bool previous = resultMask & bit;
+            if (!(unknownMask & bit) && result != previous) {
+                queueEvent(r, result, lat, lon, timestamp);
+            }
+
+            resultMask = result ? (resultMask | bit) : (resultMask & ~bit);
+            unknownMask &= ~bit;
+            dirtyMask &= ~bit;
+        }
+    }
+
+    lastInside = inside;
+    lastSpeedBits = speedBits;
+    lastTimeBits = timeBits;
+
+    if (pendingCount == 0) {
+        return false;
+    }
+
+    event = pendingEvents[pendingHead];
+    pendingHead = (pendingHead + 1) % MAX_RULES;
+    pendingCount--;
+    return true;
+}
+
+bool RuleEngine::run(const uint8_t* pc, uint32_t inside, uint16_t speedBits, uint16_t timeBits) const {
+    // Verified programs only: operands are in bounds and the stack, one
+    // bit per entry with the top in bit 0, never under- or overflows
+    uint32_t stack = 0;
+
+    for (;;) {
+        switch (*pc++) {
+            case OP_INSIDE:
+                stack = (stack << 1) | signalBit(inside, *pc++);
+                break;
+
+            case OP_INSIDE_ANY: {
+                uint8_t n = *pc++;
+                uint32_t any = 0;
+                while (n--) {
+                    any |= signalBit(inside, *pc++);
+                }
+                stack = (stack << 1) | any;
+                break;
+            }
+
+            case OP_SPEED_ABOVE:
+                stack = (stack << 1) | signalBit(speedBits, *pc++);
+                break;
+
+            case OP_TIME_IN:
+                stack = (stack << 1) | signalBit(timeBits, *pc);
+                pc += 2;
+                break;
+
+            case OP_NOT:
+                stack ^= 1;
+                break;
+
+            case OP_AND: {
+                uint32_t top = stack & 1;
+                stack >>= 1;
+                stack &= ~1UL | top;
+                break;
+            }
+
+            case OP_OR: {
+                uint32_t top = stack & 1;
+                stack >>= 1;
+                stack |= top;
+                break;
+            }
+
+            default:
+                return stack & 1;
+        }
+    }
+}
+
+void RuleEngine::queueEvent(uint8_t index, bool active, int32_t lat, int32_t lon, uint32_t timestamp) {
+    if (pendingCount >= MAX_RULES) {
+        return;
+    }
+
+    RuleEvent& event = pendingEvents[(pendingHead + pendingCount) % MAX_RULES];
+    event.rule_id = rules[index].id;
+    event.event_type = active ? 1 : 0;
+    event.latitude = lat;
+    event.longitude = lon;
+    event.timestamp = timestamp;
+    pendingCount++;
+    totalEvents++;
+}
+
+// ===============================================================
+// DOWNLINK HANDLING
+// ===============================================================
+
+uint8_t RuleEngine::handleDownlink(const uint8_t* payload, size_t length) {
+    if (length < 1) {
+        return CONFIG_UNKNOWN;
+    }
+
+    switch (payload[0]) {
+        case CMD_SET_RULE: {
+            if (length < 3 || length < 3U + payload[2]) {
+                Serial.println("Rule Engine: Malformed rule downlink");
+                return CONFIG_REJECTED;
+            }
+
+            bool ok = addRule(payload[1], &payload[3], payload[2]);
+            Serial.print("Rule Engine: Rule ");
+            Serial.print(payload[1]);
+            Serial.println(ok ? " installed" : " rejected");
+            return ok ? CONFIG_APPLIED : CONFIG_REJECTED;
+        }
+
+        case CMD_DELETE_RULE:
+            if (length < 2) {
+                Serial.println("Rule Engine: Malformed delete downlink");
+                return CONFIG_REJECTED;
+            }
+            return removeRule(payload[1]) ? CONFIG_APPLIED : CONFIG_REJECTED;
+
+        case CMD_CLEAR_RULES:
+            clearRules();
+            return CONFIG_APPLIED;
+
+        default:
+            return CONFIG_UNKNOWN;
+    }
+}
+
+// ===============================================================
+// PERSISTENCE
+// ===============================================================
+
+void RuleEngine::saveRules() {
+    Preferences prefs;
+    if (prefs.begin(STORAGE_NAMESPACE, false)) {
+        prefs.putUChar("rl_count", ruleCount);
+        prefs.putBytes("rl_rules", rules, ruleCount * sizeof(Rule));
+        prefs.putUShort("rl_csize", codeSize);
+        prefs.putBytes("rl_code", code, codeSize);
+        prefs.end();
+    }
+}
+
+bool RuleEngine::loadRules() {
+    Preferences prefs;
+    if (!prefs.begin(STORAGE_NAMESPACE, true)) {
+        return false;
+    }
+
+    uint8_t count = prefs.getUChar("rl_count", 0);
+    uint16_t size = prefs.getUShort("rl_csize", 0);
+    if (count == 0 || count > MAX_RULES || size > MAX_RULE_CODE ||
+        prefs.getBytesLength("rl_rules") != count * sizeof(Rule)) {
+        prefs.end();
+        return false;
+    }
+
+    prefs.getBytes("rl_rules", rules, count * sizeof(Rule));
+    prefs.getBytes("rl_code", code, size);
+    prefs.end();
+
+    // Stored code is trusted only after it verifies again
+    for (uint8_t i = 0; i < count; i++) {
+        if (rules[i].codeStart + rules[i].codeLength > size ||
+            !verifyProgram(&code[rules[i].codeStart], rules[i].codeLength)) {
+            Serial.println("Rule Engine: Stored rules corrupt, discarding");
+            return false;
+        }
+    }
+
+    ruleCount = count;
+    codeSize = size;
+    return true;
+}
+
+// ===============================================================
+// DEBUG & LOGGING
+// ===============================================================
+
+void RuleEngine::printStatistics() {
+    Serial.println("=== RULE ENGINE STATISTICS ===");
+    Serial.print("Rules: ");
+    Serial.print(ruleCount);
+    Serial.print(" (");
+    Serial.print(codeSize);
+    Serial.print("/");
+    Serial.print(MAX_RULE_CODE);
+    Serial.println(" bytecode bytes)");
+    Serial.print("Signals (speed / time): ");
+    Serial.print(speedCount);
+    Serial.print(" / ");
+    Serial.println(windowCount);
+    Serial.print("Passes / rule evals / skipped: ");
+    Serial.print(totalPasses);
+    Serial.print(" / ");
+    Serial.print(totalRuleEvals);
+    Serial.print(" / ");
+    Serial.println(totalRuleSkips);
+    Serial.print("Events: ");
+    Serial.println(totalEvents);
+
+    for (uint8_t r = 0; r < ruleCount; r++) {
+        Serial.print("  Rule ");
+        Serial.print(rules[r].id);
+        Serial.print(": ");
+        Serial.print((resultMask >> r) & 1 ? "ACTIVE" : "idle");
+        Serial.print(", ");
+        Serial.print(ruleEvals[r]);
+        Serial.print(" evals, ");
+        Serial.print(ruleEvals[r] ? ruleCycles[r] / ruleEvals[r] : 0);
+        Serial.println(" cycles/eval");
+    }
+}
@@ -0,0 +1,137 @@
+#ifndef RULE_ENGINE_H
+#define RULE_ENGINE_H
+
+#include <Arduino.h>
+#include "../include/project_config.h"
+#include "lorawan_manager.h"
+#include "geofence_manager.h"
+
+// ===============================================================
+// RULE BYTECODE
+// ===============================================================
+//
+// A rule is a postfix boolean program ending in OP_END, e.g.
+// "inside Yard A and speed > 15 km/h":
+//
+//   OP_INSIDE 3, OP_SPEED_ABOVE 15, OP_AND, OP_END
+//
+// tools/rule_compiler.py turns the text form into this encoding.
+
+enum RuleOpcode : uint8_t {
+    OP_END         = 0x00,
+    OP_INSIDE      = 0x01,   // [fence id]        push inside(id)
+    OP_INSIDE_ANY  = 0x02,   // [n][n x fence id] push inside any of them
+    OP_SPEED_ABOVE = 0x03,   // [km/h]            push speed > km/h
+    OP_TIME_IN     = 0x04,   // [start][end]      push local 15-min slot in window
+    OP_NOT         = 0x10,
+    OP_AND         = 0x11,
+    OP_OR          = 0x12
+};
+
+#define RULE_STACK_DEPTH            32      // One bit per stack entry
+#define RULE_NO_SIGNAL              0xFF    // Linked operand for a missing fence / full signal table
+
+static_assert(MAX_RULES <= 32, "Rule state is kept in 32-bit masks");
+static_assert(MAX_RULE_SIGNALS <= 16, "Signals are kept in 16-bit words");
+
+// ===============================================================
+// RULE STRUCTURES
+// ===============================================================
+
+struct Rule {
+    uint8_t id;
+    uint8_t codeLength;
+    uint16_t codeStart;      // Offset in the shared code pool
+};
+
+// ===============================================================
+// RULE ENGINE CLASS
+// ===============================================================
+
+class RuleEngine {
+private:
+    Rule rules[MAX_RULES];
+    uint8_t ruleCount;
+
+    // Bytecode as received, and the linked copy the interpreter runs:
+    // fence ids become fence indices, thresholds and windows become
+    // indices into the signal words below
+    uint8_t code[MAX_RULE_CODE];
+    uint8_t linked[MAX_RULE_CODE];
+    uint16_t codeSize;
+
+    // Distinct speed thresholds / time windows across all rules
+    uint8_t speedThresholds[MAX_RULE_SIGNALS];
+    uint8_t speedCount;
+    uint8_t windowStart[MAX_RULE_SIGNALS];
+    uint8_t windowEnd[MAX_RULE_SIGNALS];
+    uint8_t windowCount;
+
+    // Inputs each rule reads, for change-driven evaluation
+    uint32_t fenceDeps[MAX_RULES];
+    uint16_t speedDeps[MAX_RULES];
+    uint16_t timeDeps[MAX_RULES];
+    uint16_t linkedLayout;   // GeofenceManager layout the link is valid for
+    bool needsLink;
+
+    // Signal words from the last evaluation
+    uint32_t lastInside;
+    uint16_t lastSpeedBits;
+    uint16_t lastTimeBits;
+    uint32_t resultMask;     // Current value of each rule
+    uint32_t unknownMask;    // Not evaluated yet; first result is silent
+    uint32_t dirtyMask;      // Evaluate on the next pass regardless of inputs
+
+    // Pending rule transitions
+    RuleEvent pendingEvents[MAX_RULES];
+    uint8_t pendingHead;
+    uint8_t pendingCount;
+
+    // Statistics
+    uint32_t totalPasses;
+    uint32_t totalRuleEvals;
+    uint32_t totalRuleSkips;
+    uint32_t totalEvents;
+    uint32_t ruleEvals[MAX_RULES];
+    uint32_t ruleCycles[MAX_RULES];
+
+    // Private methods
+    int8_t findIndex(uint8_t id) const;
+    void eraseRule(uint8_t index);
+    bool verifyProgram(const uint8_t* program, uint8_t length) const;
+    void link(const GeofenceManager& geofences);
+    int8_t internSpeed(uint8_t kmh);
+    int8_t internWindow(uint8_t start, uint8_t end);
+    bool run(const uint8_t* program, uint32_t inside, uint16_t speedBits, uint16_t timeBits) const;
+    void queueEvent(uint8_t index, bool active, int32_t lat, int32_t lon, uint32_t timestamp);
+    void saveRules();
+    bool loadRules();
+
+public:
+    // Constructor & Destructor
+    RuleEngine();
+    ~RuleEngine();
+
+    // Initialization
+    bool begin();
+
+    // Rule management
+    bool addRule(uint8_t id, const uint8_t* program, uint8_t length);
+    bool removeRule(uint8_t id);
+    void clearRules();
+    uint8_t getRuleCount() const { return ruleCount; }
+    bool isActive(uint8_t id) const;
+
+    // Evaluation (call after GeofenceManager::checkGeofences)
+    bool evaluate(const GeofenceManager& geofences, float speedMps, int32_t lat, int32_t lon,
+                  RuleEvent& event);
+
+    // Downlink handling
+    uint8_t handleDownlink(const uint8_t* payload, size_t length);   // CONFIG_*
+
+    // Debug & Logging
+    uint32_t getEvaluationCount() const { return totalRuleEvals; }     // Rules run, over all passes
+    void printStatistics();
+};
+
+#endif // RULE_ENGINE_H
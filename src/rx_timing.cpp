@@ -0,0 +1,169 @@
+#include "rx_timing.h"
+
+// ===============================================================
+// CONSTRUCTOR & DESTRUCTOR
+// ===============================================================
+
+RxTiming::RxTiming() :
+    guard(RX_GUARD_DEFAULT),
+    scatter(0),
+    peak(0),
+    drift(0),
+    samples(0),
+    totalUplinks(0),
+    totalDownlinks(0),
+    totalDiscarded(0),
+    totalMisses(0),
+    totalRxSaved(0) {
+    for (uint8_t w = 0; w < 2; w++) {
+        meanOffset[w] = 0;
+        windowDelay[w] = 0;
+        windowSamples[w] = 0;
+    }
+}
+
+RxTiming::~RxTiming() {
+}
+
+void RxTiming::begin() {
+    // Wake-up latency depends on this boot's clocks and tasks: relearn it
+    guard = RX_GUARD_DEFAULT;
+    samples = 0;
+}
+
+// ===============================================================
+// MEASUREMENT
+// ===============================================================
+
+void RxTiming::exchange(uint8_t window, uint32_t elapsed, uint32_t uplinkAirtime, uint32_t downlinkAirtime) {
+    // RX1 always opens; RX2 too unless RX1 brought the downlink
+    totalUplinks++;
+    uint8_t windows = window == 1 ? 1 : 2;
+    totalRxSaved += (uint64_t)windows * 2 * (RX_GUARD_DEFAULT - guard) * 1000;
+
+    if (window == 0) {
+        return;
+    }
+    totalDownlinks++;
+
+    if (window > 2 || uplinkAirtime == 0 || downlinkAirtime == 0 ||
+        elapsed < uplinkAirtime + downlinkAirtime) {
+        totalDiscarded++;
+        return;
+    }
+
+    // Delays are whole seconds; what is left over is the offset
+    uint32_t residual = elapsed - uplinkAirtime - downlinkAirtime;
+    uint32_t delay = (residual + 500000) / 1000000;
+    if (delay < 1 || delay > RX_MAX_DELAY) {
+        totalDiscarded++;
+        return;
+    }
+    float offset = (float)residual - delay * 1000000.0;
+
+    // A new delay (RXTimingSetupReq) starts the window's mean over
+    uint8_t w = window - 1;
+    if (windowDelay[w] != delay) {
+        windowDelay[w] = delay;
+        windowSamples[w] = 0;
+        drift = 0;
+    }
+
+    if (windowSamples[w] == 0) {
+        meanOffset[w] = offset;
+    } else {
+        float deviation = fabs(offset - meanOffset[w]);
+        uint16_t deviations = samples > 0 ? samples : 1;
+        float weight = deviations < 8 ? 1.0 / deviations : 0.125;
+        scatter += (deviation - scatter) * weight;
+        peak = max(peak * (float)RX_PEAK_DECAY, deviation);
+        meanOffset[w] += (offset - meanOffset[w]) / min(windowSamples[w] + 1, RX_MEAN_SAMPLES);
+    }
+    if (windowSamples[w] < 0xFFFF) {
+        windowSamples[w]++;
+    }
+    samples++;
+
+    // Clock error: how much later RX2 downlinks land than RX1 ones, per
+    // second of extra delay (us/s = ppm). Beyond RX_MAX_PPM it is noise
+    if (windowSamples[0] >= 2 && windowSamples[1] >= 2 && windowDelay[1] != windowDelay[0]) {
+        drift = (meanOffset[1] - meanOffset[0]) / ((int)windowDelay[1] - (int)windowDelay[0]);
+        drift = constrain(drift, -RX_MAX_PPM, RX_MAX_PPM);
+    }
+
+    updateGuard();
+}
+
+void RxTiming::downlinkMissed() {
+    // Maybe timing, maybe just radio: either way the safe padding first
+    totalMisses++;
+    samples = 0;
+    updateGuard();
+}
+
+void RxTiming::updateGuard() {
+    if (samples < RX_CALIBRATION_SAMPLES) {
+        guard = RX_GUARD_DEFAULT;
+        return;
+    }
+
+    // The longest delay either window waits (RX2 is RX1 + 1 s)
+    uint8_t delay = windowSamples[1] > 0 ? windowDelay[1] : windowDelay[0] + 1;
+    float ppm = (windowSamples[0] >= 2 && windowSamples[1] >= 2) ? fabs(drift) : RX_CRYSTAL_PPM;
+    float spread = RX_GUARD_SIGMAS * getScatter();
+    float error = max(spread, peak) + ppm * delay + RX_GUARD_MARGIN;
+
+    uint32_t padding = (uint32_t)ceil(error / 1000.0);
+    guard = constrain(padding, (uint32_t)RX_GUARD_MIN, (uint32_t)RX_GUARD_DEFAULT);
+}
+
+// ===============================================================
+// DEBUG & LOGGING
+// ===============================================================
+
+void RxTiming::printStatistics() {
+    Serial.println("=== RX TIMING STATISTICS ===");
+    Serial.print("Window padding: ");
+    Serial.print(guard);
+    Serial.print(" ms");
+    Serial.println(isCalibrated() ? " (calibrated)" : " (default)");
+    Serial.print("Timing scatter: ");
+    Serial.print(getScatter(), 0);
+    Serial.print(" us, peak ");
+    Serial.print(peak, 0);
+    Serial.print(" us, drift ");
+    Serial.print(drift, 1);
+    Serial.println(" ppm");
+    Serial.print("Delays RX1 / RX2: ");
+    Serial.print(windowDelay[0]);
+    Serial.print(" / ");
+    Serial.print(windowDelay[1]);
+    Serial.println(" s");
+    Serial.print("Downlinks measured / discarded: ");
+    Serial.print(totalDownlinks - totalDiscarded);
+    Serial.print(" / ");
+    Serial.println(totalDiscarded);
+    Serial.print("Unanswered confirmed uplinks: ");
+    Serial.println(totalMisses);
+    Serial.print("RX time saved per uplink: ");
+    Serial.print(totalUplinks > 0 ? totalRxSaved / 1000.0 / totalUplinks : 0, 1);
+    Serial.println(" ms");
+}
+
+// ===============================================================
+// HELPER FUNCTIONS
+// ===============================================================
+
+uint32_t loraTimeOnAir(uint8_t sf, uint16_t bandwidth, size_t length, bool crc) {
+    if (sf == 0 || bandwidth == 0) {
+        return 0;
+    }
+
+    float symbol = (float)(1UL << sf) * 1000.0 / bandwidth;    // us
+    int8_t lowRate = symbol >= 16000 ? 2 : 0;
+    int32_t bits = 8 * (int32_t)length - 4 * sf + 28 + (crc ? 16 : 0);
+    int32_t perBlock = 4 * (sf - lowRate);
+    int32_t blocks = bits > 0 ? (bits + perBlock - 1) / perBlock : 0;
+
+    return (uint32_t)((8 + 4.25 + 8 + blocks * 5) * symbol);
+}
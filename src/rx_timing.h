@@ -0,0 +1,99 @@
+#ifndef RX_TIMING_H
+#define RX_TIMING_H
+
+#include <Arduino.h>
+#include "../include/project_config.h"
+
+// ===============================================================
+// CLASS A RECEIVE WINDOW TIMING
+// ===============================================================
+//
+// RadioLib opens RX1 and RX2 scanGuard ms early and keeps each open for
+// the preamble plus 2 x scanGuard, so with no downlink (most uplinks)
+// the radio listens 4 x scanGuard longer than the preamble needs. The
+// padding only has to cover how far the device's idea of "delay seconds
+// after the uplink" is off: crystal drift over the delay and the scatter
+// of wake-up and interrupt latency.
+//
+// Both are measured from the downlinks that arrive. The time from
+// calling sendReceive to its return, less the uplink and downlink
+// airtimes, is the window delay (whole seconds) plus an offset. Offsets
+// in RX2 against RX1 give the drift (us per second of delay is ppm); the
+// scatter of the offsets, and the largest recent excursion, give the
+// latency spread. Their constant part is ours (frame setup, MIC check)
+// and is left out. The padding then becomes
+//
+//   RX_GUARD_SIGMAS x scatter + |drift| x delay + RX_GUARD_MARGIN
+//
+// between RX_GUARD_MIN and RX_GUARD_DEFAULT, once RX_CALIBRATION_SAMPLES
+// downlinks are in. A confirmed uplink that gets no answer may be a
+// downlink the narrow window missed: the padding goes back to the
+// default and calibration starts over. tools/rx_timing.py runs the same
+// estimator against a simulated radio.
+
+#define RX_MAX_DELAY                15      // s, RXTimingSetupReq's largest
+#define RX_MAX_PPM                  50.0    // Drift estimates beyond this are noise
+#define RX_MEAN_SAMPLES             64      // Downlinks averaged into each window's mean offset
+#define RX_PEAK_DECAY               0.995   // Per downlink, so a rare late wake-up is remembered
+#define LORAWAN_FRAME_OVERHEAD      13      // MHDR, FHDR without FOpts, FPort, MIC
+
+// ===============================================================
+// RX TIMING CLASS
+// ===============================================================
+
+class RxTiming {
+private:
+    uint8_t guard;              // ms each side, what scanGuard is set to
+
+    // Downlink arrival offsets past the whole-second delay (us)
+    float meanOffset[2];        // RX1, RX2
+    uint8_t windowDelay[2];     // s
+    uint16_t windowSamples[2];
+    float scatter;              // Smoothed |offset - mean|
+    float peak;                 // Largest recent |offset - mean|, decaying
+    float drift;                // ppm, 0 until both windows are measured
+    uint16_t samples;           // Since the last reset
+
+    // Statistics
+    uint32_t totalUplinks;
+    uint32_t totalDownlinks;
+    uint32_t totalDiscarded;    // Implausible, or the uplink airtime unknown
+    uint32_t totalMisses;
+    uint64_t totalRxSaved;      // us against RX_GUARD_DEFAULT
+
+    // Private methods
+    void updateGuard();
+
+public:
+    // Constructor & Destructor
+    RxTiming();
+    ~RxTiming();
+
+    void begin();
+    uint8_t getGuard() const { return guard; }
+
+    // One exchange: window 0 = no downlink, 1 = RX1, 2 = RX2. Airtimes
+    // of 0 (not LoRa, or not known) keep it out of the calibration
+    void exchange(uint8_t window, uint32_t elapsed, uint32_t uplinkAirtime, uint32_t downlinkAirtime);
+
+    // A confirmed uplink went unanswered
+    void downlinkMissed();
+
+    // State
+    float getDrift() const { return drift; }
+    float getScatter() const { return scatter * 1.25; }  // Mean absolute deviation as a sigma
+    bool isCalibrated() const { return samples >= RX_CALIBRATION_SAMPLES; }
+
+    // Debug & Logging
+    void printStatistics();
+};
+
+// ===============================================================
+// HELPER FUNCTIONS
+// ===============================================================
+
+// LoRa airtime (us) of a PHYPayload: CR 4/5, explicit header, 8-symbol
+// preamble, low data rate optimisation at 16 ms symbols. 0 for sf 0
+uint32_t loraTimeOnAir(uint8_t sf, uint16_t bandwidth, size_t length, bool crc);
+
+#endif // RX_TIMING_H
@@ -0,0 +1,227 @@
+#include "selective_repeat.h"
+
+// ===============================================================
+// CONSTRUCTOR & DESTRUCTOR
+// ===============================================================
+
+SelectiveRepeat::SelectiveRepeat() :
+    base(0),
+    nextSeq(0),
+    acked(0),
+    window(ARQ_MIN_WINDOW),
+    uplinks(0),
+    uplinksAtAck(0),
+    ackSpacing(ARQ_MIN_WINDOW / ARQ_WINDOW_HEADROOM),
+    probeOffset(0),
+    repairSeq(-1),
+    totalFrames(0),
+    totalResent(0),
+    totalAcks(0) {
+    memset(slots, 0, sizeof(slots));
+}
+
+SelectiveRepeat::~SelectiveRepeat() {
+}
+
+void SelectiveRepeat::begin() {
+    base = esp_random();
+    nextSeq = base;
+    acked = 0;
+}
+
+// ===============================================================
+// NEW FRAMES
+// ===============================================================
+
+size_t SelectiveRepeat::encode(const uint8_t* payload, size_t length, uint8_t* frame) const {
+    if (!canAccept() || length > BULK_MAX_PAYLOAD) {
+        return 0;
+    }
+
+    frame[0] = MSG_TYPE_BULK_ARQ;
+    frame[1] = (nextSeq >> 8) & 0xFF;
+    frame[2] = nextSeq & 0xFF;
+    frame[3] = nextSeq - base;
+    memcpy(&frame[ARQ_HEADER], payload, length);
+    return ARQ_HEADER + length;
+}
+
+void SelectiveRepeat::add(const uint8_t* payload, size_t length, uint32_t now) {
+    Slot& slot = slots[nextSeq % ARQ_MAX_WINDOW];
+    memcpy(slot.data, payload, length);
+    slot.length = length;
+    slot.lost = false;
+    slot.sentAt = uplinks;
+    slot.sentTime = now;
+
+    nextSeq++;
+    totalFrames++;
+}
+
+// ===============================================================
+// REPEATS
+// ===============================================================
+
+bool SelectiveRepeat::isAcked(uint16_t seq) const {
+    return acked & (1UL << (uint16_t)(seq - base));
+}
+
+int32_t SelectiveRepeat::pickRepair(uint32_t now) const {
+    uint16_t outstanding = nextSeq - base;
+
+    // Reported missing, oldest first
+    for (uint16_t i = 0; i < outstanding; i++) {
+        uint16_t seq = base + i;
+        if (!isAcked(seq) && slots[seq % ARQ_MAX_WINDOW].lost) {
+            return seq;
+        }
+    }
+
+    // No word for a window's worth of uplinks, or for too long
+    for (uint16_t i = 0; i < outstanding; i++) {
+        uint16_t seq = base + i;
+        const Slot& slot = slots[seq % ARQ_MAX_WINDOW];
+        if (!isAcked(seq) && (uplinks - slot.sentAt > window || now - slot.sentTime >= ARQ_RETRY_TIMEOUT)) {
+            return seq;
+        }
+    }
+
+    // Window full: keep the uplinks (and the backend's downlink slots)
+    // going, cycling through what is still open
+    if (outstanding > 0 && !canAccept()) {
+        for (uint16_t i = 0; i < outstanding; i++) {
+            uint16_t seq = base + (probeOffset + i) % outstanding;
+            if (!isAcked(seq)) {
+                return seq;
+            }
+        }
+    }
+
+    return -1;
+}
+
+size_t SelectiveRepeat::nextRepair(uint8_t* frame, uint32_t now) {
+    repairSeq = pickRepair(now);
+    if (repairSeq < 0) {
+        return 0;
+    }
+
+    const Slot& slot = slots[repairSeq % ARQ_MAX_WINDOW];
+    frame[0] = MSG_TYPE_BULK_ARQ;
+    frame[1] = (repairSeq >> 8) & 0xFF;
+    frame[2] = repairSeq & 0xFF;
+    frame[3] = repairSeq - base;
+    memcpy(&frame[ARQ_HEADER], slot.data, slot.length);
+    return ARQ_HEADER + slot.length;
+}
+
+void SelectiveRepeat::repairDone(uint32_t now) {
+    if (repairSeq < 0 || (uint16_t)(repairSeq - base) >= (uint16_t)(nextSeq - base)) {
+        return;
+    }
+
+    Slot& slot = slots[repairSeq % ARQ_MAX_WINDOW];
+    if (!slot.lost) {
+        probeOffset++;
+    }
+    slot.lost = false;
+    slot.sentAt = uplinks;
+    slot.sentTime = now;
+    repairSeq = -1;
+    totalResent++;
+}
+
+void SelectiveRepeat::repairAbandoned() {
+    if (repairSeq < 0 || (uint16_t)(repairSeq - base) >= (uint16_t)(nextSeq - base)) {
+        return;
+    }
+
+    // Released as if acknowledged
+    acked |= 1UL << (uint16_t)(repairSeq - base);
+    slots[repairSeq % ARQ_MAX_WINDOW].lost = false;
+    repairSeq = -1;
+    slide();
+}
+
+// ===============================================================
+// ACKNOWLEDGEMENTS
+// ===============================================================
+
+bool SelectiveRepeat::handleAck(const uint8_t* payload, size_t length) {
+    if (length < 2) {
+        return false;
+    }
+
+    // Ignore a stale or foreign one rather than release the wrong frames
+    uint16_t next = (payload[0] << 8) | payload[1];
+    uint16_t outstanding = nextSeq - base;
+    uint16_t released = next - base;
+    if (released > outstanding) {
+        return false;
+    }
+
+    acked = released < 32 ? acked >> released : 0;
+    base = next;
+    outstanding -= released;
+
+    // Bitmap from next + 1; the last set bit is the newest frame seen
+    int32_t newest = -1;
+    for (size_t i = 0; i < (length - 2) * 8 && i + 1 < outstanding; i++) {
+        if (payload[2 + i / 8] & (0x80 >> (i % 8))) {
+            acked |= 1UL << (i + 1);
+            newest = i + 1;
+        }
+    }
+    // Lost only if its last copy went out before the newest one seen;
+    // a copy resent since may just not be in this acknowledgement yet
+    if (newest > 0) {
+        uint32_t newestSentAt = slots[(uint16_t)(base + newest) % ARQ_MAX_WINDOW].sentAt;
+        for (int32_t i = 0; i < newest; i++) {
+            Slot& slot = slots[(uint16_t)(base + i) % ARQ_MAX_WINDOW];
+            if (!(acked & (1UL << i)) && (int32_t)(newestSentAt - slot.sentAt) > 0) {
+                slot.lost = true;
+            }
+        }
+    }
+    slide();
+
+    // Acknowledgements can only come this often
+    ackSpacing += 0.25f * ((float)(uplinks - uplinksAtAck) - ackSpacing);
+    uplinksAtAck = uplinks;
+    resize();
+
+    totalAcks++;
+    return true;
+}
+
+void SelectiveRepeat::slide() {
+    while (base != nextSeq && (acked & 1)) {
+        acked >>= 1;
+        base++;
+    }
+}
+
+void SelectiveRepeat::resize() {
+    window = constrain((int)lround(ackSpacing * ARQ_WINDOW_HEADROOM), ARQ_MIN_WINDOW, ARQ_MAX_WINDOW);
+}
+
+// ===============================================================
+// DEBUG & LOGGING
+// ===============================================================
+
+void SelectiveRepeat::printStatistics() {
+    Serial.println("=== BULK ARQ STATISTICS ===");
+    Serial.print("Frames / resent / acks: ");
+    Serial.print(totalFrames);
+    Serial.print(" / ");
+    Serial.print(totalResent);
+    Serial.print(" / ");
+    Serial.println(totalAcks);
+    Serial.print("Window: ");
+    Serial.print(getOutstanding());
+    Serial.print("/");
+    Serial.print(window);
+    Serial.print(" (");
+    Serial.print(ackSpacing, 1);
+    Serial.println(" uplinks between acks)");
+}
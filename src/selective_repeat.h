@@ -0,0 +1,104 @@
+#ifndef SELECTIVE_REPEAT_H
+#define SELECTIVE_REPEAT_H
+
+#include <Arduino.h>
+#include "../include/project_config.h"
+
+// ===============================================================
+// WINDOWED BULK TRANSFER (MSG_TYPE_BULK_ARQ)
+// ===============================================================
+//
+//   uplink    [MSG_TYPE_BULK_ARQ][seq, u16][seq - oldest open seq][payload]
+//   downlink  [CMD_BULK_ACK][next, u16][bitmap]
+//
+// The third byte tells the backend where the window starts, so it does
+// not wait for frames the device no longer has (or had before a reboot).
+// The acknowledgement says every frame before `next` arrived; bit 7 of
+// bitmap byte 0 stands for next + 1, and so on. The last set bit is the
+// newest frame the backend has seen, so an unset one before it was lost
+// and is sent again; frames after it may still be on their way.
+//
+// In Class A an acknowledgement can only ride on the downlink after some
+// uplink, so the window is sized from how many uplinks pass between
+// acknowledgements (ARQ_WINDOW_HEADROOM of them). A frame unacknowledged
+// for that many uplinks, or for ARQ_RETRY_TIMEOUT when uplinks are rare,
+// is sent again, and a full window with nothing lost keeps resending the
+// open frames in turn, which also gives the backend its downlink slots. tools/bulk_arq.py is the backend side.
+
+#define ARQ_HEADER                  4
+
+// ===============================================================
+// SELECTIVE REPEAT CLASS
+// ===============================================================
+
+class SelectiveRepeat {
+private:
+    struct Slot {
+        uint8_t data[BULK_MAX_PAYLOAD];
+        uint8_t length;
+        bool lost;              // Marked missing by an acknowledgement
+        uint32_t sentAt;        // Uplink count at the last send
+        uint32_t sentTime;      // millis() at the last send
+    };
+
+    Slot slots[ARQ_MAX_WINDOW]; // slots[seq % ARQ_MAX_WINDOW]
+    uint16_t base;              // Oldest unacknowledged
+    uint16_t nextSeq;
+    uint32_t acked;             // Bit (seq - base) set when acknowledged out of order
+    uint8_t window;
+
+    // Downlink opportunities
+    uint32_t uplinks;
+    uint32_t uplinksAtAck;
+    float ackSpacing;           // Smoothed uplinks between acknowledgements
+    uint8_t probeOffset;        // Round-robin resend while the window is full
+    int32_t repairSeq;          // Frame handed out by nextRepair, -1 = none
+
+    // Statistics
+    uint32_t totalFrames;
+    uint32_t totalResent;
+    uint32_t totalAcks;
+
+    // Private methods
+    bool isAcked(uint16_t seq) const;
+    void slide();
+    void resize();
+    int32_t pickRepair(uint32_t now) const;
+
+public:
+    // Constructor & Destructor
+    SelectiveRepeat();
+    ~SelectiveRepeat();
+
+    // Start numbering at a random point, so frames after a reboot do not
+    // look like repeats of the last session's
+    void begin();
+
+    // New frames: canAccept, encode, then add once it is on the air
+    bool canAccept() const { return (uint16_t)(nextSeq - base) < window; }
+    size_t encode(const uint8_t* payload, size_t length, uint8_t* frame) const;
+    void add(const uint8_t* payload, size_t length, uint32_t now);
+
+    // Repeats: nextRepair builds the frame due again (0 = none);
+    // repairDone after it is on the air, repairAbandoned when no data
+    // rate can carry it any more (later frames' base offset tells the
+    // backend it is given up)
+    size_t nextRepair(uint8_t* frame, uint32_t now);
+    void repairDone(uint32_t now);
+    void repairAbandoned();
+
+    // Every uplink (any port) is a downlink opportunity
+    void uplinkSent() { uplinks++; }
+
+    // CMD_BULK_ACK payload after the command byte
+    bool handleAck(const uint8_t* payload, size_t length);
+
+    // State
+    uint16_t getOutstanding() const { return nextSeq - base; }
+    uint8_t getWindow() const { return window; }
+
+    // Debug & Logging
+    void printStatistics();
+};
+
+#endif // SELECTIVE_REPEAT_H
@@ -0,0 +1,588 @@
+#include "tile_store.h"
+#include "geofence_manager.h"
+#include <LittleFS.h>
+
+// ===============================================================
+// CONSTRUCTOR & DESTRUCTOR
+// ===============================================================
+
+TileStore::TileStore() :
+    slotCount(0),
+    loaderBuffer(nullptr),
+    useClock(0),
+    generation(0),
+    inPsram(false),
+    isAvailable(false),
+    cacheMutex(nullptr),
+    loadQueue(nullptr),
+    loaderTask(nullptr),
+    currentKey(TILE_KEY_NONE),
+    insideCount(0),
+    insideKnown(false),
+    pendingHead(0),
+    pendingCount(0),
+    startTime(0),
+    totalLookups(0),
+    totalHits(0),
+    totalDemandLoads(0),
+    totalPrefetchLoads(0),
+    totalPrefetchUsed(0),
+    totalFlashReads(0),
+    totalFlashBytes(0),
+    totalEmptyTiles(0),
+    totalBadTiles(0),
+    totalEvents(0),
+    totalOverflows(0) {
+    memset(slots, 0, sizeof(slots));
+    memset(insideIds, 0, sizeof(insideIds));
+}
+
+TileStore::~TileStore() {
+    if (loaderTask) vTaskDelete(loaderTask);
+    if (loadQueue) vQueueDelete(loadQueue);
+    if (cacheMutex) vSemaphoreDelete(cacheMutex);
+    for (uint8_t i = 0; i < slotCount; i++) {
+        free(slots[i].data);
+    }
+    free(loaderBuffer);
+}
+
+// ===============================================================
+// INITIALIZATION
+// ===============================================================
+
+bool TileStore::begin() {
+    Serial.println("Tile Store: Initializing...");
+
+    if (!LittleFS.begin(false) || !LittleFS.exists(TILE_DIR)) {
+        Serial.println("Tile Store: No " TILE_DIR " on LittleFS, tiled fences disabled");
+        return false;
+    }
+
+    // Tiles are large and touched once per fix, so PSRAM is fine for them.
+    // Without it fall back to a few heap slots: prefetch still hides the
+    // flash reads, it just keeps less history.
+    inPsram = psramFound();
+    uint8_t wanted = inPsram ? TILE_CACHE_SLOTS : TILE_CACHE_SLOTS_NO_PSRAM;
+
+    loaderBuffer = (uint8_t*)(inPsram ? ps_malloc(TILE_MAX_BYTES) : malloc(TILE_MAX_BYTES));
+    while (loaderBuffer && slotCount < wanted) {
+        uint8_t* buffer = (uint8_t*)(inPsram ? ps_malloc(TILE_MAX_BYTES) : malloc(TILE_MAX_BYTES));
+        if (!buffer) {
+            break;
+        }
+        slots[slotCount].key = TILE_KEY_NONE;
+        slots[slotCount].data = buffer;
+        slotCount++;
+    }
+
+    // The current tile, one ahead and one spare at the least
+    if (slotCount < 3) {
+        Serial.println("Tile Store: Not enough memory for the tile cache");
+        return false;
+    }
+
+    cacheMutex = xSemaphoreCreateMutex();
+    loadQueue = xQueueCreate(TILE_LOAD_QUEUE_SIZE, sizeof(uint32_t));
+    if (!cacheMutex || !loadQueue ||
+        xTaskCreate(loaderEntry, "tile_loader", TILE_LOADER_STACK, this, 1, &loaderTask) != pdPASS) {
+        Serial.println("Tile Store: Failed to start the loader task");
+        return false;
+    }
+
+    startTime = millis();
+    isAvailable = true;
+    Serial.print("Tile Store: ");
+    Serial.print(slotCount);
+    Serial.print(" tile slots in ");
+    Serial.println(inPsram ? "PSRAM" : "heap");
+    return true;
+}
+
+// ===============================================================
+// TILE CACHE
+// ===============================================================
+
+int8_t TileStore::findSlot(uint32_t key) const {
+    for (uint8_t i = 0; i < slotCount; i++) {
+        if (slots[i].key == key) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int8_t TileStore::victimSlot() const {
+    // Least recently used, never the tile under the asset
+    int8_t victim = -1;
+    for (uint8_t i = 0; i < slotCount; i++) {
+        if (slots[i].key == TILE_KEY_NONE) {
+            return i;
+        }
+        if (slots[i].key != currentKey &&
+            (victim < 0 || (int32_t)(slots[i].lastUsed - slots[victim].lastUsed) < 0)) {
+            victim = i;
+        }
+    }
+    return victim;
+}
+
+int32_t TileStore::readTile(uint32_t key, uint8_t* buffer) {
+    // 0 = no file for this cell, -1 = unreadable
+    char path[32];
+    tilePathFor(key, path, sizeof(path));
+
+    if (!LittleFS.exists(path)) {
+        return 0;
+    }
+
+    File file = LittleFS.open(path, "r");
+    if (!file) {
+        return -1;
+    }
+
+    size_t size = file.size();
+    size_t length = (size > 0 && size <= TILE_MAX_BYTES) ? file.read(buffer, size) : 0;
+    file.close();
+    return (length == size && length > 0) ? (int32_t)length : -1;
+}
+
+bool TileStore::decodeTile(TileSlot& slot, int32_t length) {
+    slot.fenceCount = 0;
+    slot.vertexCount = 0;
+    slot.fences = nullptr;
+    slot.rings = nullptr;
+    slot.vertexLat = nullptr;
+    slot.vertexLon = nullptr;
+
+    if (length == 0) {
+        return true;
+    }
+    if (length < (int32_t)sizeof(TileHeader)) {
+        return false;
+    }
+
+    const TileHeader* header = (const TileHeader*)slot.data;
+    size_t expected = sizeof(TileHeader) + header->fenceCount * sizeof(TileFence) +
+                      header->ringCount * sizeof(PolygonRing) + header->vertexCount * 2 * sizeof(int32_t);
+    if (header->magic != TILE_MAGIC || expected != (size_t)length) {
+        return false;
+    }
+
+    const TileFence* fences = (const TileFence*)(slot.data + sizeof(TileHeader));
+    const PolygonRing* rings = (const PolygonRing*)(fences + header->fenceCount);
+    for (uint16_t i = 0; i < header->fenceCount; i++) {
+        const TileFence& fence = fences[i];
+        if (fence.type == GEOFENCE_POLYGON) {
+            if (fence.ringCount == 0 || fence.ringCount > 255 ||
+                fence.ringStart + fence.ringCount > header->ringCount) {
+                return false;
+            }
+        } else if (fence.type != GEOFENCE_CIRCLE) {
+            return false;
+        }
+    }
+    for (uint16_t r = 0; r < header->ringCount; r++) {
+        if (rings[r].count < 3 || rings[r].start + rings[r].count > header->vertexCount) {
+            return false;
+        }
+    }
+
+    slot.fences = fences;
+    slot.rings = rings;
+    slot.vertexLat = (const int32_t*)(rings + header->ringCount);
+    slot.vertexLon = slot.vertexLat + header->vertexCount;
+    slot.fenceCount = header->fenceCount;
+    slot.vertexCount = header->vertexCount;
+    return true;
+}
+
+void TileStore::installTile(uint8_t index, uint32_t key, int32_t length, bool prefetched) {
+    // Caller holds cacheMutex and has put the file in slots[index].data
+    TileSlot& slot = slots[index];
+    slot.key = key;
+    slot.lastUsed = ++useClock;
+    slot.prefetched = prefetched;
+
+    if (length > 0) {
+        totalFlashReads++;
+        totalFlashBytes += length;
+    }
+
+    if (length < 0 || !decodeTile(slot, length)) {
+        // Keep the cell cached as empty so a bad file is not re-read every fix
+        totalBadTiles++;
+        decodeTile(slot, 0);
+        Serial.print("Tile Store: Bad tile ");
+        Serial.print(key >> 16);
+        Serial.print("_");
+        Serial.println(key & 0xFFFF);
+    } else if (length == 0) {
+        totalEmptyTiles++;
+    }
+}
+
+const TileSlot* TileStore::acquire(uint32_t key) {
+    // Caller holds cacheMutex
+    totalLookups++;
+
+    int8_t index = findSlot(key);
+    if (index >= 0) {
+        totalHits++;
+        if (slots[index].prefetched) {
+            slots[index].prefetched = false;
+            totalPrefetchUsed++;
+        }
+        slots[index].lastUsed = ++useClock;
+        return &slots[index];
+    }
+
+    // Prefetch lost the race: read it now, the fix waits on flash
+    index = victimSlot();
+    if (index < 0) {
+        return nullptr;
+    }
+    totalDemandLoads++;
+    installTile(index, key, readTile(key, slots[index].data), false);
+    return &slots[index];
+}
+
+// ===============================================================
+// BACKGROUND LOADER
+// ===============================================================
+
+void TileStore::requestTile(uint32_t key) {
+    xSemaphoreTake(cacheMutex, portMAX_DELAY);
+    bool cached = findSlot(key) >= 0;
+    xSemaphoreGive(cacheMutex);
+
+    // A full queue drops the request; the next fix asks again
+    if (!cached) {
+        xQueueSend(loadQueue, &key, 0);
+    }
+}
+
+void TileStore::loaderEntry(void* arg) {
+    static_cast<TileStore*>(arg)->loaderLoop();
+}
+
+void TileStore::loaderLoop() {
+    uint32_t key;
+
+    for (;;) {
+        if (xQueueReceive(loadQueue, &key, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        // Duplicates are common: the same tile is asked for on every fix
+        // until it lands
+        xSemaphoreTake(cacheMutex, portMAX_DELAY);
+        bool cached = findSlot(key) >= 0;
+        uint32_t readGeneration = generation;
+        xSemaphoreGive(cacheMutex);
+        if (cached) {
+            continue;
+        }
+
+        // Read outside the lock so evaluation never waits on flash, then
+        // swap the buffer into the victim slot (unless a tile was replaced
+        // meanwhile: what we read may be the old file)
+        int32_t length = readTile(key, loaderBuffer);
+
+        xSemaphoreTake(cacheMutex, portMAX_DELAY);
+        int8_t index = (findSlot(key) >= 0 || generation != readGeneration) ? -1 : victimSlot();
+        if (index >= 0) {
+            uint8_t* buffer = slots[index].data;
+            slots[index].data = loaderBuffer;
+            loaderBuffer = buffer;
+            installTile(index, key, length, true);
+            totalPrefetchLoads++;
+        }
+        xSemaphoreGive(cacheMutex);
+    }
+}
+
+void TileStore::invalidate(uint32_t key) {
+    if (!isAvailable) {
+        return;
+    }
+
+    // The next fix in this cell reads the new file
+    xSemaphoreTake(cacheMutex, portMAX_DELAY);
+    int8_t index = findSlot(key);
+    if (index >= 0) {
+        slots[index].key = TILE_KEY_NONE;
+        decodeTile(slots[index], 0);
+    }
+    generation++;
+    xSemaphoreGive(cacheMutex);
+}
+
+void TileStore::prefetch(int32_t lat, int32_t lon, float speedMps, float courseDeg) {
+    if (!isAvailable) {
+        return;
+    }
+
+    requestTile(tileKeyFor(lat, lon));
+
+    // Neighbours across a nearby edge: the asset may turn towards them
+    // before the next fix
+    float cosLat = max((float)cos(lat / 1e6 * DEG_TO_RAD), 0.01f);
+    int32_t marginLat = (int32_t)(TILE_PREFETCH_MARGIN / METERS_PER_MICRODEGREE);
+    int32_t marginLon = (int32_t)(TILE_PREFETCH_MARGIN / (METERS_PER_MICRODEGREE * cosLat));
+    int32_t offLat = (int32_t)(((int64_t)lat - TILE_ROW_ORIGIN) % TILE_SIZE_MICRODEG);
+    int32_t offLon = (int32_t)(((int64_t)lon - TILE_COL_ORIGIN) % TILE_SIZE_MICRODEG);
+    int32_t stepLat = offLat < marginLat ? -marginLat : (TILE_SIZE_MICRODEG - offLat <= marginLat ? marginLat : 0);
+    int32_t stepLon = offLon < marginLon ? -marginLon : (TILE_SIZE_MICRODEG - offLon <= marginLon ? marginLon : 0);
+
+    if (stepLat != 0) {
+        requestTile(tileKeyFor(lat + stepLat, lon));
+    }
+    if (stepLon != 0) {
+        requestTile(tileKeyFor(lat, lon + stepLon));
+    }
+    if (stepLat != 0 && stepLon != 0) {
+        requestTile(tileKeyFor(lat + stepLat, lon + stepLon));
+    }
+
+    // Tiles along the track over the prefetch horizon, sampled at half a
+    // tile so none is stepped over
+    if (speedMps <= 0 || courseDeg < 0) {
+        return;
+    }
+
+    float distance = speedMps * TILE_PREFETCH_HORIZON;
+    float halfTile = TILE_SIZE_MICRODEG * METERS_PER_MICRODEGREE / 2;
+    uint8_t steps = (uint8_t)constrain(ceil(distance / halfTile), 1.0f, 4.0f);
+    float north = distance * cos(courseDeg * DEG_TO_RAD) / METERS_PER_MICRODEGREE;
+    float east = distance * sin(courseDeg * DEG_TO_RAD) / (METERS_PER_MICRODEGREE * cosLat);
+
+    uint32_t lastKey = tileKeyFor(lat, lon);
+    for (uint8_t s = 1; s <= steps; s++) {
+        uint32_t key = tileKeyFor(lat + (int32_t)(north * s / steps), lon + (int32_t)(east * s / steps));
+        if (key != lastKey) {
+            requestTile(key);
+            lastKey = key;
+        }
+    }
+}
+
+// ===============================================================
+// MEMBERSHIP
+// ===============================================================
+
+bool TileStore::evaluate(int32_t lat, int32_t lon, uint32_t timestamp, float& clearance) {
+    clearance = 1e9;
+    if (!isAvailable) {
+        return false;
+    }
+
+    uint32_t key = tileKeyFor(lat, lon);
+    float cosLat = cos(lat / 1e6 * DEG_TO_RAD);
+
+    // A fence missing from this tile does not overlap it, so it is at
+    // least as far away as the tile edge
+    int32_t offLat = (int32_t)(((int64_t)lat - TILE_ROW_ORIGIN) % TILE_SIZE_MICRODEG);
+    int32_t offLon = (int32_t)(((int64_t)lon - TILE_COL_ORIGIN) % TILE_SIZE_MICRODEG);
+    float edgeLat = min(offLat, TILE_SIZE_MICRODEG - offLat) * METERS_PER_MICRODEGREE;
+    float edgeLon = min(offLon, TILE_SIZE_MICRODEG - offLon) * METERS_PER_MICRODEGREE * cosLat;
+    clearance = min(edgeLat, edgeLon);
+
+    uint16_t nowInside[MAX_TILE_INSIDE];
+    uint8_t nowCount = 0;
+
+    xSemaphoreTake(cacheMutex, portMAX_DELAY);
+    currentKey = key;
+    const TileSlot* tile = acquire(key);
+
+    for (uint16_t i = 0; tile && i < tile->fenceCount; i++) {
+        const TileFence& fence = tile->fences[i];
+
+        bool wasInside = false;
+        for (uint8_t k = 0; k < insideCount; k++) {
+            wasInside |= insideIds[k] == fence.id;
+        }
+
+        // Box lower bound: skip fences that can neither contain the fix
+        // nor come closer than what we already have
+        int32_t dLat = max(max(fence.minLat - lat, lat - fence.maxLat), (int32_t)0);
+        int32_t dLon = max(max(fence.minLon - lon, lon - fence.maxLon), (int32_t)0);
+        float lower = sqrt(sq(dLat * METERS_PER_MICRODEGREE) + sq(dLon * METERS_PER_MICRODEGREE * cosLat));
+        if (lower > GEOFENCE_HYSTERESIS && lower >= clearance) {
+            continue;
+        }
+
+        float distance;
+        if (fence.type == GEOFENCE_CIRCLE) {
+            float dy = (lat - fence.centerLat) * METERS_PER_MICRODEGREE;
+            float dx = (lon - fence.centerLon) * METERS_PER_MICRODEGREE * cosLat;
+            distance = sqrt(dx * dx + dy * dy) - fence.radius;
+        } else {
+            const PolygonRing* rings = &tile->rings[fence.ringStart];
+            uint8_t count = fence.ringCount;
+            float edge = distanceToRings(rings, count, tile->vertexLat, tile->vertexLon, lat, lon);
+            distance = pointInRings(rings, count, tile->vertexLat, tile->vertexLon, lat, lon) ? -edge : edge;
+        }
+        clearance = min(clearance, (float)fabs(distance));
+
+        // Same hysteresis as GeofenceManager::evaluateFence
+        bool inside;
+        if (!insideKnown) {
+            inside = distance <= 0;
+        } else {
+            inside = wasInside ? distance <= GEOFENCE_HYSTERESIS : distance < -GEOFENCE_HYSTERESIS;
+        }
+
+        if (inside) {
+            bool listed = false;
+            for (uint8_t k = 0; k < nowCount; k++) {
+                listed |= nowInside[k] == fence.id;
+            }
+            if (listed) {
+                continue;
+            }
+            if (nowCount < MAX_TILE_INSIDE) {
+                nowInside[nowCount++] = fence.id;
+            } else {
+                totalOverflows++;
+            }
+        }
+    }
+    xSemaphoreGive(cacheMutex);
+
+    // Diff against the previous set
+    if (insideKnown) {
+        for (uint8_t k = 0; k < insideCount; k++) {
+            bool still = false;
+            for (uint8_t n = 0; n < nowCount; n++) {
+                still |= nowInside[n] == insideIds[k];
+            }
+            if (!still) {
+                queueEvent(insideIds[k], false, lat, lon, timestamp);
+            }
+        }
+        for (uint8_t n = 0; n < nowCount; n++) {
+            bool was = false;
+            for (uint8_t k = 0; k < insideCount; k++) {
+                was |= insideIds[k] == nowInside[n];
+            }
+            if (!was) {
+                queueEvent(nowInside[n], true, lat, lon, timestamp);
+            }
+        }
+    }
+
+    memcpy(insideIds, nowInside, nowCount * sizeof(uint16_t));
+    insideCount = nowCount;
+    insideKnown = true;
+    return pendingCount > 0;
+}
+
+void TileStore::queueEvent(uint16_t id, bool entered, int32_t lat, int32_t lon, uint32_t timestamp) {
+    if (pendingCount >= MAX_TILE_EVENTS) {
+        return;
+    }
+
+    TileEvent& event = pendingEvents[(pendingHead + pendingCount) % MAX_TILE_EVENTS];
+    event.fence_id = id;
+    event.event_type = entered ? 1 : 0;
+    event.latitude = lat;
+    event.longitude = lon;
+    event.timestamp = timestamp;
+
+    pendingCount++;
+    totalEvents++;
+}
+
+bool TileStore::getEvent(TileEvent& event) {
+    if (pendingCount == 0) {
+        return false;
+    }
+
+    event = pendingEvents[pendingHead];
+    pendingHead = (pendingHead + 1) % MAX_TILE_EVENTS;
+    pendingCount--;
+    return true;
+}
+
+bool TileStore::isInside(uint16_t id) const {
+    for (uint8_t k = 0; k < insideCount; k++) {
+        if (insideIds[k] == id) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ===============================================================
+// STATISTICS
+// ===============================================================
+
+float TileStore::getHitRate() const {
+    return totalLookups > 0 ? (float)totalHits / totalLookups : 0.0;
+}
+
+float TileStore::getFlashReadRate() const {
+    uint32_t elapsed = millis() - startTime;
+    return elapsed > 0 ? totalFlashReads * 60000.0 / elapsed : 0.0;
+}
+
+// ===============================================================
+// DEBUG & LOGGING
+// ===============================================================
+
+void TileStore::printStatistics() {
+    Serial.println("=== TILE STORE STATISTICS ===");
+    if (!isAvailable) {
+        Serial.println("Disabled");
+        return;
+    }
+    Serial.print("Slots: ");
+    Serial.print(slotCount);
+    Serial.println(inPsram ? " (PSRAM)" : " (heap)");
+    Serial.print("Lookups / hits: ");
+    Serial.print(totalLookups);
+    Serial.print(" / ");
+    Serial.print(totalHits);
+    Serial.print(" (");
+    Serial.print(getHitRate() * 100.0, 1);
+    Serial.println("%)");
+    Serial.print("Demand loads (fix waited): ");
+    Serial.println(totalDemandLoads);
+    Serial.print("Prefetch loads / used: ");
+    Serial.print(totalPrefetchLoads);
+    Serial.print(" / ");
+    Serial.println(totalPrefetchUsed);
+    Serial.print("Flash reads / bytes: ");
+    Serial.print(totalFlashReads);
+    Serial.print(" / ");
+    Serial.print(totalFlashBytes);
+    Serial.print(" (");
+    Serial.print(getFlashReadRate(), 2);
+    Serial.println(" reads/min)");
+    Serial.print("Empty / bad tiles: ");
+    Serial.print(totalEmptyTiles);
+    Serial.print(" / ");
+    Serial.println(totalBadTiles);
+    Serial.print("Inside / events / overflows: ");
+    Serial.print(insideCount);
+    Serial.print(" / ");
+    Serial.print(totalEvents);
+    Serial.print(" / ");
+    Serial.println(totalOverflows);
+}
+
+// ===============================================================
+// HELPER FUNCTIONS
+// ===============================================================
+
+uint32_t tileKeyFor(int32_t lat, int32_t lon) {
+    // Offsets from the south-west corner of the world are never negative
+    uint32_t row = (uint32_t)(((int64_t)lat - TILE_ROW_ORIGIN) / TILE_SIZE_MICRODEG);
+    uint32_t col = (uint32_t)(((int64_t)lon - TILE_COL_ORIGIN) / TILE_SIZE_MICRODEG);
+    return (row << 16) | (col & 0xFFFF);
+}
+
+void tilePathFor(uint32_t key, char* path, size_t size) {
+    snprintf(path, size, TILE_DIR "/%u_%u.bin", (unsigned)(key >> 16), (unsigned)(key & 0xFFFF));
+}
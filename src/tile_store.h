@@ -0,0 +1,184 @@
+#ifndef TILE_STORE_H
+#define TILE_STORE_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include "../include/project_config.h"
+#include "lorawan_manager.h"
+
+// ===============================================================
+// TILE FILE FORMAT
+// ===============================================================
+//
+// The fence set is cut along a fixed grid of TILE_SIZE_MICRODEG cells.
+// Each cell with fences has a file TILE_DIR/<row>_<col>.bin holding every
+// fence whose box, grown by the hysteresis band, overlaps the cell (a
+// fence spanning several cells is written to each of them with the same
+// id). Little-endian, used in place once read:
+//
+//   TileHeader
+//   TileFence[fenceCount]
+//   PolygonRing[ringCount]             start indexes the tile's vertices
+//   int32_t vertexLat[vertexCount]     * 1e6
+//   int32_t vertexLon[vertexCount]     * 1e6
+//
+// tools/tile_packer.py writes this layout into data/ for uploadfs.
+
+#define TILE_MAGIC                  0x32544647UL    // "GFT2"
+#define TILE_KEY_NONE               0xFFFFFFFFUL
+#define TILE_ROW_ORIGIN             (-90000000L)
+#define TILE_COL_ORIGIN             (-180000000L)
+#define TILE_LOAD_QUEUE_SIZE        8
+#define MAX_TILE_EVENTS             (2 * MAX_TILE_INSIDE)
+
+struct TileHeader {
+    uint32_t magic;
+    uint16_t fenceCount;
+    uint16_t ringCount;
+    uint16_t vertexCount;
+    uint16_t reserved;
+};
+
+struct TileFence {
+    uint16_t id;
+    uint8_t type;            // GeofenceType
+    uint8_t reserved;
+
+    // Bounding box, * 1e6
+    int32_t minLat;
+    int32_t maxLat;
+    int32_t minLon;
+    int32_t maxLon;
+
+    // Circle
+    int32_t centerLat;       // * 1e6
+    int32_t centerLon;       // * 1e6
+    uint32_t radius;         // meters
+
+    // Polygon (range in the tile's ring table)
+    uint16_t ringStart;
+    uint16_t ringCount;
+};
+
+struct PolygonRing;
+
+static_assert(sizeof(TileHeader) == 12, "Tile header is read in place");
+static_assert(sizeof(TileFence) == 36, "Tile fences are read in place");
+
+// A decoded tile. Cells without a file are cached too, with no fences,
+// so open water and empty land cost one failed open per visit.
+struct TileSlot {
+    uint32_t key;            // (row << 16) | col, TILE_KEY_NONE = free
+    uint32_t lastUsed;       // LRU clock
+    uint8_t* data;           // TILE_MAX_BYTES buffer
+    const TileFence* fences;
+    const PolygonRing* rings;
+    const int32_t* vertexLat;
+    const int32_t* vertexLon;
+    uint16_t fenceCount;
+    uint16_t vertexCount;
+    bool prefetched;         // Loaded ahead of need and not used yet
+};
+
+// ===============================================================
+// TILE STORE CLASS
+// ===============================================================
+
+class TileStore {
+private:
+    // LRU of decoded tiles, PSRAM when the module has it
+    TileSlot slots[TILE_CACHE_SLOTS];
+    uint8_t slotCount;
+    uint8_t* loaderBuffer;   // Loader reads here, then swaps it into a slot
+    uint32_t useClock;
+    uint32_t generation;     // Bumped by invalidate(), so the loader drops stale reads
+    bool inPsram;
+    bool isAvailable;
+
+    // Background loader
+    SemaphoreHandle_t cacheMutex;
+    QueueHandle_t loadQueue;
+    TaskHandle_t loaderTask;
+
+    // Membership of the last evaluated fix
+    uint32_t currentKey;
+    uint16_t insideIds[MAX_TILE_INSIDE];
+    uint8_t insideCount;
+    bool insideKnown;
+
+    // Pending transitions
+    TileEvent pendingEvents[MAX_TILE_EVENTS];
+    uint8_t pendingHead;
+    uint8_t pendingCount;
+
+    // Statistics
+    uint32_t startTime;
+    uint32_t totalLookups;
+    uint32_t totalHits;
+    uint32_t totalDemandLoads;   // Misses the fix had to wait for
+    uint32_t totalPrefetchLoads;
+    uint32_t totalPrefetchUsed;
+    uint32_t totalFlashReads;
+    uint32_t totalFlashBytes;
+    uint32_t totalEmptyTiles;
+    uint32_t totalBadTiles;
+    uint32_t totalEvents;
+    uint32_t totalOverflows;     // Fences dropped from a full inside set
+
+    // Private methods
+    int8_t findSlot(uint32_t key) const;
+    int8_t victimSlot() const;
+    int32_t readTile(uint32_t key, uint8_t* buffer);
+    bool decodeTile(TileSlot& slot, int32_t length);
+    void installTile(uint8_t index, uint32_t key, int32_t length, bool prefetched);
+    const TileSlot* acquire(uint32_t key);
+    void requestTile(uint32_t key);
+    void queueEvent(uint16_t id, bool entered, int32_t lat, int32_t lon, uint32_t timestamp);
+    static void loaderEntry(void* arg);
+    void loaderLoop();
+
+public:
+    // Constructor & Destructor
+    TileStore();
+    ~TileStore();
+
+    // Initialization (mounts LittleFS)
+    bool begin();
+    bool available() const { return isAvailable; }
+
+    // Drop the cached copy of a tile whose file changed
+    void invalidate(uint32_t key);
+
+    // Prefetch the tiles ahead of the asset; call on every fix
+    void prefetch(int32_t lat, int32_t lon, float speedMps, float courseDeg);
+
+    // Update membership for a fix. `clearance` receives the distance (m)
+    // to the nearest tiled boundary or to the tile edge, whichever is closer.
+    bool evaluate(int32_t lat, int32_t lon, uint32_t timestamp, float& clearance);
+    bool getEvent(TileEvent& event);
+    bool isInside(uint16_t id) const;
+    uint8_t getInsideCount() const { return insideCount; }
+
+    // Cache effectiveness
+    float getHitRate() const;
+    uint32_t getDemandLoads() const { return totalDemandLoads; }    // Fixes that waited on flash
+    float getFlashReadRate() const;      // Reads per minute since begin()
+
+    // Debug & Logging
+    void printStatistics();
+};
+
+// ===============================================================
+// HELPER FUNCTIONS
+// ===============================================================
+
+// Grid cell holding a point
+uint32_t tileKeyFor(int32_t lat, int32_t lon);
+
+// LittleFS path of a cell's tile
+void tilePathFor(uint32_t key, char* path, size_t size);
+
+#endif // TILE_STORE_H
@@ -0,0 +1,562 @@
+#include "tile_sync.h"
+#include "geofence_manager.h"
+#include <LittleFS.h>
+
+static uint32_t spreadBits(uint32_t v) {
+    // 12 bits to the even positions of 24
+    v &= 0xFFF;
+    v = (v | (v << 8)) & 0x00FF00FFUL;
+    v = (v | (v << 4)) & 0x0F0F0F0FUL;
+    v = (v | (v << 2)) & 0x33333333UL;
+    v = (v | (v << 1)) & 0x55555555UL;
+    return v;
+}
+
+static uint32_t compactBits(uint32_t v) {
+    v &= 0x55555555UL;
+    v = (v | (v >> 1)) & 0x33333333UL;
+    v = (v | (v >> 2)) & 0x0F0F0F0FUL;
+    v = (v | (v >> 4)) & 0x00FF00FFUL;
+    v = (v | (v >> 8)) & 0x0000FFFFUL;
+    return v;
+}
+
+static int compareEntries(const void* a, const void* b) {
+    uint32_t codeA = ((const TileIndexEntry*)a)->code;
+    uint32_t codeB = ((const TileIndexEntry*)b)->code;
+    return codeA < codeB ? -1 : (codeA > codeB ? 1 : 0);
+}
+
+static void startLeafHash(mbedtls_sha256_context& ctx, uint32_t key) {
+    uint8_t prefix[5] = {0x00, (uint8_t)(key >> 24), (uint8_t)(key >> 16), (uint8_t)(key >> 8), (uint8_t)key};
+    mbedtls_sha256_starts(&ctx, 0);
+    mbedtls_sha256_update(&ctx, prefix, sizeof(prefix));
+}
+
+static void finishHash(mbedtls_sha256_context& ctx, uint8_t* hash) {
+    uint8_t digest[32];
+    mbedtls_sha256_finish(&ctx, digest);
+    memcpy(hash, digest, TILE_HASH_BYTES);
+}
+
+// ===============================================================
+// CONSTRUCTOR & DESTRUCTOR
+// ===============================================================
+
+TileSync::TileSync(TileStore& tileStore) :
+    store(tileStore),
+    entries(nullptr),
+    count(0),
+    capacity(0),
+    rootValid(false),
+    isAvailable(false),
+    writeKey(TILE_KEY_NONE),
+    writeTotal(0),
+    writeOffset(0),
+    nodeHead(0),
+    nodeCount(0),
+    statusPending(false),
+    totalQueries(0),
+    totalChunks(0),
+    totalInstalled(0),
+    totalRejected(0),
+    totalDeleted(0) {
+    memset(rootHash, 0, sizeof(rootHash));
+    memset(&pendingStatus, 0, sizeof(pendingStatus));
+    mbedtls_sha256_init(&writeHash);
+}
+
+TileSync::~TileSync() {
+    mbedtls_sha256_free(&writeHash);
+    free(entries);
+}
+
+// ===============================================================
+// INITIALIZATION
+// ===============================================================
+
+bool TileSync::begin() {
+    Serial.println("Tile Sync: Initializing...");
+
+    if (!LittleFS.begin(false)) {
+        Serial.println("Tile Sync: LittleFS not mounted, sync disabled");
+        return false;
+    }
+
+    bool inPsram = psramFound();
+    capacity = inPsram ? TILE_INDEX_CAPACITY : TILE_INDEX_CAPACITY_NO_PSRAM;
+    size_t bytes = capacity * sizeof(TileIndexEntry);
+    entries = (TileIndexEntry*)(inPsram ? ps_malloc(bytes) : malloc(bytes));
+    if (!entries) {
+        Serial.println("Tile Sync: Not enough memory for the tile index");
+        return false;
+    }
+
+    // A missing or damaged index (packer without one, reset mid-write)
+    // is rebuilt from the tiles themselves, once
+    if (!loadIndex()) {
+        Serial.println("Tile Sync: Rebuilding the tile index...");
+        rebuildIndex();
+        saveIndex();
+    }
+
+    isAvailable = true;
+    Serial.print("Tile Sync: ");
+    Serial.print(count);
+    Serial.print(" tiles, root ");
+    Serial.println(getRoot(), HEX);
+    return true;
+}
+
+bool TileSync::loadIndex() {
+    if (!LittleFS.exists(TILE_INDEX)) {
+        return false;
+    }
+
+    File file = LittleFS.open(TILE_INDEX, "r");
+    if (!file) {
+        return false;
+    }
+
+    uint32_t header[2];
+    bool ok = file.read((uint8_t*)header, sizeof(header)) == sizeof(header) &&
+              header[0] == TILE_INDEX_MAGIC && header[1] <= capacity &&
+              file.size() == sizeof(header) + header[1] * sizeof(TileIndexEntry);
+    if (ok) {
+        size_t bytes = header[1] * sizeof(TileIndexEntry);
+        ok = file.read((uint8_t*)entries, bytes) == bytes;
+    }
+    file.close();
+
+    // Binary search depends on the order
+    for (uint32_t i = 1; ok && i < header[1]; i++) {
+        ok = entries[i - 1].code < entries[i].code;
+    }
+
+    count = ok ? header[1] : 0;
+    rootValid = false;
+    return ok;
+}
+
+bool TileSync::rebuildIndex() {
+    count = 0;
+    rootValid = false;
+
+    File dir = LittleFS.open(TILE_DIR);
+    if (!dir || !dir.isDirectory()) {
+        return true;
+    }
+
+    for (File file = dir.openNextFile(); file; file = dir.openNextFile()) {
+        // Some cores give the full path, some the base name
+        const char* name = strrchr(file.name(), '/');
+        name = name ? name + 1 : file.name();
+
+        unsigned row, col;
+        if (sscanf(name, "%u_%u.bin", &row, &col) != 2 || row >= 4096 || col >= 4096) {
+            file.close();
+            continue;
+        }
+        if (count >= capacity) {
+            Serial.println("Tile Sync: Index full, some tiles are not tracked");
+            file.close();
+            break;
+        }
+
+        uint32_t key = (row << 16) | col;
+        mbedtls_sha256_context ctx;
+        mbedtls_sha256_init(&ctx);
+        startLeafHash(ctx, key);
+        uint8_t buffer[256];
+        size_t length;
+        while ((length = file.read(buffer, sizeof(buffer))) > 0) {
+            mbedtls_sha256_update(&ctx, buffer, length);
+        }
+        file.close();
+
+        entries[count].code = tileMortonCode(key);
+        finishHash(ctx, entries[count].hash);
+        mbedtls_sha256_free(&ctx);
+        count++;
+    }
+    dir.close();
+
+    qsort(entries, count, sizeof(TileIndexEntry), compareEntries);
+    return true;
+}
+
+void TileSync::saveIndex() {
+    if (!LittleFS.exists(TILE_DIR)) {
+        if (count == 0) {
+            return;
+        }
+        LittleFS.mkdir(TILE_DIR);
+    }
+
+    File file = LittleFS.open(TILE_INDEX, "w");
+    if (!file) {
+        Serial.println("Tile Sync: Failed to write the tile index");
+        return;
+    }
+
+    uint32_t header[2] = {TILE_INDEX_MAGIC, count};
+    file.write((const uint8_t*)header, sizeof(header));
+    file.write((const uint8_t*)entries, count * sizeof(TileIndexEntry));
+    file.close();
+}
+
+// ===============================================================
+// HASH TREE
+// ===============================================================
+
+uint16_t TileSync::lowerBound(uint32_t code) const {
+    uint16_t lo = 0;
+    uint16_t hi = count;
+    while (lo < hi) {
+        uint16_t mid = (lo + hi) / 2;
+        if (entries[mid].code < code) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+void TileSync::subtreeRange(uint8_t depth, uint32_t prefix, uint16_t& lo, uint16_t& hi) const {
+    uint8_t shift = 4 * (TILE_TREE_DEPTH - depth);
+    lo = lowerBound(prefix << shift);
+    hi = lowerBound((prefix + 1) << shift);
+}
+
+void TileSync::nodeHash(uint8_t depth, uint16_t lo, uint16_t hi, uint8_t* hash) const {
+    // Entries [lo, hi) are exactly the node's subtree
+    if (lo >= hi) {
+        memset(hash, 0, TILE_HASH_BYTES);
+        return;
+    }
+    if (depth == TILE_TREE_DEPTH) {
+        memcpy(hash, entries[lo].hash, TILE_HASH_BYTES);
+        return;
+    }
+
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, 0);
+    uint8_t tag = 0x01;
+    mbedtls_sha256_update(&ctx, &tag, 1);
+
+    uint8_t shift = 4 * (TILE_TREE_DEPTH - depth - 1);
+    for (uint16_t i = lo; i < hi;) {
+        uint8_t nibble = (entries[i].code >> shift) & 0x0F;
+        uint16_t j = i + 1;
+        while (j < hi && ((entries[j].code >> shift) & 0x0F) == nibble) {
+            j++;
+        }
+        uint8_t child[TILE_HASH_BYTES];
+        nodeHash(depth + 1, i, j, child);
+        mbedtls_sha256_update(&ctx, &nibble, 1);
+        mbedtls_sha256_update(&ctx, child, TILE_HASH_BYTES);
+        i = j;
+    }
+
+    finishHash(ctx, hash);
+    mbedtls_sha256_free(&ctx);
+}
+
+uint32_t TileSync::getRoot() {
+    if (!rootValid) {
+        nodeHash(0, 0, count, rootHash);
+        rootValid = true;
+    }
+    return ((uint32_t)rootHash[0] << 24) | ((uint32_t)rootHash[1] << 16) | ((uint32_t)rootHash[2] << 8) | rootHash[3];
+}
+
+bool TileSync::setLeaf(uint32_t key, const uint8_t* hash) {
+    uint32_t code = tileMortonCode(key);
+    uint16_t pos = lowerBound(code);
+    if (pos >= count || entries[pos].code != code) {
+        if (count >= capacity) {
+            return false;
+        }
+        memmove(&entries[pos + 1], &entries[pos], (count - pos) * sizeof(TileIndexEntry));
+        entries[pos].code = code;
+        count++;
+    }
+    memcpy(entries[pos].hash, hash, TILE_HASH_BYTES);
+    rootValid = false;
+    return true;
+}
+
+// ===============================================================
+// BACKEND COMMANDS
+// ===============================================================
+
+bool TileSync::handleQuery(const uint8_t* payload, size_t length) {
+    if (!isAvailable || length == 0 || length % 4 != 0) {
+        return false;
+    }
+
+    // Queries that do not fit the reply queue are dropped; the backend
+    // asks again for what it did not get
+    for (size_t i = 0; i < length; i += 4) {
+        uint8_t depth = payload[i] >> 4;
+        uint32_t prefix = ((uint32_t)payload[i + 1] << 16) | (payload[i + 2] << 8) | payload[i + 3];
+        if (depth < TILE_TREE_DEPTH && prefix < (1UL << (4 * depth))) {
+            queueNode(depth, payload[i] & 0x0F, prefix);
+        }
+        totalQueries++;
+    }
+    return true;
+}
+
+void TileSync::queueNode(uint8_t depth, uint8_t first, uint32_t prefix) {
+    if (nodeCount >= TILE_SYNC_MAX_REPLIES) {
+        return;
+    }
+
+    TileSyncNode& node = pendingNodes[(nodeHead + nodeCount) % TILE_SYNC_MAX_REPLIES];
+    node.depth = depth;
+    node.first = first;
+    node.prefix = prefix;
+    node.child_mask = 0;
+    node.count = 0;
+
+    // As many children from `first` on as fit one uplink; the backend
+    // asks for the rest starting after the last one listed
+    uint8_t room = min((TILE_SYNC_MAX_PAYLOAD - TILE_SYNC_NODE_HEADER) / 4, 16);
+    uint16_t lo, hi;
+    subtreeRange(depth, prefix, lo, hi);
+    uint8_t shift = 4 * (TILE_TREE_DEPTH - depth - 1);
+    for (uint16_t i = lo; i < hi;) {
+        uint8_t nibble = (entries[i].code >> shift) & 0x0F;
+        uint16_t j = i + 1;
+        while (j < hi && ((entries[j].code >> shift) & 0x0F) == nibble) {
+            j++;
+        }
+        node.child_mask |= 1 << nibble;
+        if (nibble >= first && node.count < room) {
+            uint8_t hash[TILE_HASH_BYTES];
+            nodeHash(depth + 1, i, j, hash);
+            node.child_hashes[node.count++] = ((uint32_t)hash[0] << 24) | ((uint32_t)hash[1] << 16) |
+                                              ((uint32_t)hash[2] << 8) | hash[3];
+        }
+        i = j;
+    }
+
+    nodeCount++;
+}
+
+bool TileSync::handleWrite(const uint8_t* payload, size_t length) {
+    if (!isAvailable || length < TILE_WRITE_HEADER) {
+        return false;
+    }
+
+    uint32_t key = ((uint32_t)payload[0] << 24) | ((uint32_t)payload[1] << 16) | (payload[2] << 8) | payload[3];
+    uint16_t offset = (payload[4] << 8) | payload[5];
+    uint16_t total = (payload[6] << 8) | payload[7];
+    const uint8_t* data = &payload[TILE_WRITE_HEADER];
+    size_t dataLength = length - TILE_WRITE_HEADER;
+
+    if ((key >> 16) >= 4096 || (key & 0xFFFF) >= 4096 || total == 0 || total > TILE_MAX_BYTES ||
+        offset + dataLength > total) {
+        totalRejected++;
+        reportStatus(TILE_WRITE_REJECTED, key, 0);
+        return true;
+    }
+
+    if (offset == 0) {
+        // The first chunk carries the header, which fixes the size
+        TileHeader header;
+        if (dataLength < sizeof(TileHeader)) {
+            totalRejected++;
+            reportStatus(TILE_WRITE_REJECTED, key, 0);
+            return true;
+        }
+        memcpy(&header, data, sizeof(header));
+        size_t expected = sizeof(TileHeader) + header.fenceCount * sizeof(TileFence) +
+                          header.ringCount * sizeof(PolygonRing) + header.vertexCount * 2 * sizeof(int32_t);
+        if (header.magic != TILE_MAGIC || expected != total) {
+            totalRejected++;
+            reportStatus(TILE_WRITE_REJECTED, key, 0);
+            return true;
+        }
+
+        if (!LittleFS.exists(TILE_DIR)) {
+            LittleFS.mkdir(TILE_DIR);
+        }
+        LittleFS.remove(TILE_SYNC_TEMP);
+        writeKey = key;
+        writeTotal = total;
+        writeOffset = 0;
+        startLeafHash(writeHash, key);
+    } else if (key != writeKey || total != writeTotal || offset != writeOffset) {
+        // Lost or repeated chunk: say where to carry on
+        reportStatus(TILE_WRITE_PROGRESS, key, (key == writeKey && total == writeTotal) ? writeOffset : 0);
+        return true;
+    }
+
+    File file = LittleFS.open(TILE_SYNC_TEMP, "a");
+    bool written = file && file.write(data, dataLength) == dataLength;
+    if (file) {
+        file.close();
+    }
+    if (!written) {
+        Serial.println("Tile Sync: Failed to write tile data");
+        writeKey = TILE_KEY_NONE;
+        totalRejected++;
+        reportStatus(TILE_WRITE_REJECTED, key, 0);
+        return true;
+    }
+
+    mbedtls_sha256_update(&writeHash, data, dataLength);
+    writeOffset += dataLength;
+    totalChunks++;
+
+    if (writeOffset < writeTotal) {
+        reportStatus(TILE_WRITE_PROGRESS, key, writeOffset);
+        return true;
+    }
+
+    // Complete: replace the old tile in one step
+    uint8_t hash[TILE_HASH_BYTES];
+    finishHash(writeHash, hash);
+    writeKey = TILE_KEY_NONE;
+
+    char path[32];
+    tilePathFor(key, path, sizeof(path));
+    uint16_t pos = lowerBound(tileMortonCode(key));
+    bool known = pos < count && entries[pos].code == tileMortonCode(key);
+    if ((!known && count >= capacity) || !LittleFS.rename(TILE_SYNC_TEMP, path)) {
+        Serial.println("Tile Sync: Cannot install tile, index full or rename failed");
+        LittleFS.remove(TILE_SYNC_TEMP);
+        totalRejected++;
+        reportStatus(TILE_WRITE_REJECTED, key, 0);
+        return true;
+    }
+
+    setLeaf(key, hash);
+    saveIndex();
+    store.invalidate(key);
+    totalInstalled++;
+    reportStatus(TILE_WRITE_INSTALLED, key, total);
+
+    Serial.print("Tile Sync: Installed tile ");
+    Serial.print(key >> 16);
+    Serial.print("_");
+    Serial.println(key & 0xFFFF);
+    return true;
+}
+
+bool TileSync::handleDelete(const uint8_t* payload, size_t length) {
+    if (!isAvailable || length < 4) {
+        return false;
+    }
+
+    uint8_t depth = payload[0];
+    uint32_t prefix = ((uint32_t)payload[1] << 16) | (payload[2] << 8) | payload[3];
+    if (depth > TILE_TREE_DEPTH || prefix >= (1UL << (4 * depth))) {
+        return false;
+    }
+
+    // The whole subtree: extra tiles under a node the backend lacks go
+    // in one command
+    uint16_t lo, hi;
+    subtreeRange(depth, prefix, lo, hi);
+    for (uint16_t i = lo; i < hi; i++) {
+        uint32_t key = tileKeyForCode(entries[i].code);
+        char path[32];
+        tilePathFor(key, path, sizeof(path));
+        LittleFS.remove(path);
+        store.invalidate(key);
+    }
+
+    uint16_t removed = hi - lo;
+    if (removed > 0) {
+        memmove(&entries[lo], &entries[hi], (count - hi) * sizeof(TileIndexEntry));
+        count -= removed;
+        rootValid = false;
+        saveIndex();
+    }
+    totalDeleted += removed;
+    reportStatus(TILE_DELETED, ((uint32_t)depth << 24) | prefix, removed);
+
+    Serial.print("Tile Sync: Deleted ");
+    Serial.print(removed);
+    Serial.println(" tiles");
+    return true;
+}
+
+// ===============================================================
+// REPLIES
+// ===============================================================
+
+void TileSync::reportStatus(uint8_t result, uint32_t target, uint16_t value) {
+    // Only the latest matters: it says where the backend stands
+    pendingStatus.result = result;
+    pendingStatus.target = target;
+    pendingStatus.value = value;
+    pendingStatus.fence_root = getRoot();
+    statusPending = true;
+}
+
+bool TileSync::getNode(TileSyncNode& node) {
+    if (nodeCount == 0) {
+        return false;
+    }
+
+    node = pendingNodes[nodeHead];
+    nodeHead = (nodeHead + 1) % TILE_SYNC_MAX_REPLIES;
+    nodeCount--;
+    return true;
+}
+
+bool TileSync::getStatus(TileSyncStatus& status) {
+    if (!statusPending) {
+        return false;
+    }
+
+    status = pendingStatus;
+    statusPending = false;
+    return true;
+}
+
+// ===============================================================
+// DEBUG & LOGGING
+// ===============================================================
+
+void TileSync::printStatistics() {
+    Serial.println("=== TILE SYNC STATISTICS ===");
+    if (!isAvailable) {
+        Serial.println("Disabled");
+        return;
+    }
+    Serial.print("Tiles: ");
+    Serial.print(count);
+    Serial.print(" / ");
+    Serial.print(capacity);
+    Serial.print(", root ");
+    Serial.println(getRoot(), HEX);
+    Serial.print("Queries / chunks: ");
+    Serial.print(totalQueries);
+    Serial.print(" / ");
+    Serial.println(totalChunks);
+    Serial.print("Installed / rejected / deleted: ");
+    Serial.print(totalInstalled);
+    Serial.print(" / ");
+    Serial.print(totalRejected);
+    Serial.print(" / ");
+    Serial.println(totalDeleted);
+}
+
+// ===============================================================
+// HELPER FUNCTIONS
+// ===============================================================
+
+uint32_t tileMortonCode(uint32_t key) {
+    return (spreadBits(key >> 16) << 1) | spreadBits(key & 0xFFFF);
+}
+
+uint32_t tileKeyForCode(uint32_t code) {
+    return (compactBits(code >> 1) << 16) | compactBits(code);
+}
@@ -0,0 +1,135 @@
+#ifndef TILE_SYNC_H
+#define TILE_SYNC_H
+
+#include <Arduino.h>
+#include <mbedtls/sha256.h>
+#include "../include/project_config.h"
+#include "lorawan_manager.h"
+#include "tile_store.h"
+
+// ===============================================================
+// TILE TREE
+// ===============================================================
+//
+// The installed tiles are the leaves of a 16-ary hash tree keyed by the
+// Morton code of the cell (12-bit row and column interleaved, row bit
+// first), so each level splits its area 4 x 4 and nearby cells share a
+// subtree. With 6 levels of 4 bits:
+//
+//   leaf  SHA-256(0x00 | tile key, u32 | file)                [:8]
+//   node  SHA-256(0x01 | for each non-empty child: nibble | hash) [:8]
+//
+// An empty tree hashes to zeros. Status uplinks carry the leading 4
+// bytes of the root. When it differs from the backend's, the backend
+// walks down from the root with CMD_TILE_QUERY, following only children
+// whose hashes differ, then sends the differing tiles (CMD_TILE_WRITE)
+// and drops the extra subtrees (CMD_TILE_DELETE). The exchange grows
+// with the number of changed tiles times the depth, not with the set.
+//
+//   node    [MSG_TYPE_TILE_SYNC][TILE_SYNC_NODE][depth << 4 | first]
+//           [prefix, u24][child mask, u16][4-byte hash per listed child]
+//   status  [MSG_TYPE_TILE_SYNC][TILE_SYNC_STATUS][result][target, u32]
+//           [value, u16][root, u32]
+//
+// A tile is written in order into TILE_SYNC_TEMP and renamed over the
+// old one once complete, so a reset mid-transfer leaves the old tile in
+// place. The leaf hashes are kept in TILE_INDEX (rebuilt from the files
+// if missing). tools/tile_sync.py is the backend side.
+
+#define TILE_TREE_DEPTH             6
+#define TILE_HASH_BYTES             8
+#define TILE_INDEX                  TILE_DIR "/index.bin"
+#define TILE_SYNC_TEMP              TILE_DIR "/sync.tmp"
+#define TILE_INDEX_MAGIC            0x31494647UL    // "GFI1"
+#define TILE_SYNC_NODE_HEADER       8
+#define TILE_WRITE_HEADER           8               // Key, offset, total
+
+struct TileIndexEntry {
+    uint32_t code;           // Morton code of the cell
+    uint8_t hash[TILE_HASH_BYTES];
+};
+
+static_assert(sizeof(TileIndexEntry) == 12, "Index records are read in place");
+
+// ===============================================================
+// TILE SYNC CLASS
+// ===============================================================
+
+class TileSync {
+private:
+    TileStore& store;            // Cached copies of replaced tiles are dropped
+
+    // Leaves, sorted by code
+    TileIndexEntry* entries;
+    uint16_t count;
+    uint16_t capacity;
+    uint8_t rootHash[TILE_HASH_BYTES];
+    bool rootValid;
+    bool isAvailable;
+
+    // Tile being written
+    mbedtls_sha256_context writeHash;
+    uint32_t writeKey;           // TILE_KEY_NONE = none
+    uint16_t writeTotal;
+    uint16_t writeOffset;
+
+    // Replies waiting for an uplink
+    TileSyncNode pendingNodes[TILE_SYNC_MAX_REPLIES];
+    uint8_t nodeHead;
+    uint8_t nodeCount;
+    TileSyncStatus pendingStatus;
+    bool statusPending;
+
+    // Statistics
+    uint32_t totalQueries;
+    uint32_t totalChunks;
+    uint32_t totalInstalled;
+    uint32_t totalRejected;
+    uint32_t totalDeleted;
+
+    // Private methods
+    uint16_t lowerBound(uint32_t code) const;
+    void subtreeRange(uint8_t depth, uint32_t prefix, uint16_t& lo, uint16_t& hi) const;
+    void nodeHash(uint8_t depth, uint16_t lo, uint16_t hi, uint8_t* hash) const;
+    bool loadIndex();
+    bool rebuildIndex();
+    void saveIndex();
+    bool setLeaf(uint32_t key, const uint8_t* hash);
+    void queueNode(uint8_t depth, uint8_t first, uint32_t prefix);
+    void reportStatus(uint8_t result, uint32_t target, uint16_t value);
+
+public:
+    // Constructor & Destructor
+    TileSync(TileStore& tileStore);
+    ~TileSync();
+
+    // Initialization (LittleFS mounted)
+    bool begin();
+    bool available() const { return isAvailable; }
+
+    // Backend commands, payload after the command byte
+    bool handleQuery(const uint8_t* payload, size_t length);
+    bool handleWrite(const uint8_t* payload, size_t length);
+    bool handleDelete(const uint8_t* payload, size_t length);
+
+    // Replies, one per uplink
+    bool getNode(TileSyncNode& node);
+    bool getStatus(TileSyncStatus& status);
+
+    // Leading 4 bytes of the root hash, big-endian
+    uint32_t getRoot();
+    uint16_t getTileCount() const { return count; }
+
+    // Debug & Logging
+    void printStatistics();
+};
+
+// ===============================================================
+// HELPER FUNCTIONS
+// ===============================================================
+
+// Morton code of a tile key and back
+uint32_t tileMortonCode(uint32_t key);
+uint32_t tileKeyForCode(uint32_t code);
+
+#endif // TILE_SYNC_H
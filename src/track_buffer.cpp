@@ -0,0 +1,193 @@
+#include "track_buffer.h"
+#include "geofence_manager.h"
+
+// The error budget is split between the sleeve half-width and how far a
+// fix may fall back behind the farthest one, so a fix past the end of
+// the kept segment is still within TRACK_MAX_ERROR of it (0.8^2 + 0.6^2 = 1)
+#define TRACK_LATERAL_ERROR     (0.8f * TRACK_MAX_ERROR)
+#define TRACK_BACKTRACK_ERROR   (0.6f * TRACK_MAX_ERROR)
+
+// Angle folded into [0, 2 pi)
+static float wrapAngle(float angle) {
+    angle = fmod(angle, (float)TWO_PI);
+    return angle < 0 ? angle + TWO_PI : angle;
+}
+
+// ===============================================================
+// CONSTRUCTOR & DESTRUCTOR
+// ===============================================================
+
+TrackBuffer::TrackBuffer() :
+    head(0),
+    count(0),
+    anchorFixTime(0),
+    lastFixTime(0),
+    cosLat(1),
+    sleeveStart(0),
+    sleeveWidth(TWO_PI),
+    farthest(0),
+    hasAnchor(false),
+    hasLast(false),
+    totalFixes(0),
+    totalKept(0),
+    totalDropped(0) {
+    memset(&anchor, 0, sizeof(anchor));
+    memset(&last, 0, sizeof(last));
+}
+
+TrackBuffer::~TrackBuffer() {
+}
+
+// ===============================================================
+// SIMPLIFICATION
+// ===============================================================
+
+void TrackBuffer::addFix(uint32_t fixTime, uint32_t timestamp, int32_t lat, int32_t lon) {
+    TrackPoint point = { lat, lon, timestamp };
+    totalFixes++;
+
+    if (!hasAnchor) {
+        keep(point);
+        startSleeve(point, fixTime);
+        hasAnchor = true;
+        return;
+    }
+
+    // A long straight run still leaves a point now and then, and so
+    // does a long stop
+    if (hasLast && fixTime - anchorFixTime > TRACK_MAX_POINT_INTERVAL) {
+        keep(last);
+        startSleeve(last, lastFixTime);
+    }
+
+    if (!extendSleeve(point)) {
+        // The previous fix is the last one the straight segment explains
+        keep(last);
+        startSleeve(last, lastFixTime);
+        extendSleeve(point);
+    }
+
+    last = point;
+    lastFixTime = fixTime;
+    hasLast = true;
+}
+
+void TrackBuffer::flush() {
+    if (!hasLast) {
+        return;
+    }
+
+    keep(last);
+    startSleeve(last, lastFixTime);
+}
+
+void TrackBuffer::startSleeve(const TrackPoint& point, uint32_t fixTime) {
+    anchor = point;
+    anchorFixTime = fixTime;
+    cosLat = cos((point.latitude / 1e6) * DEG_TO_RAD);
+    sleeveStart = 0;
+    sleeveWidth = TWO_PI;
+    farthest = 0;
+    hasLast = false;
+}
+
+bool TrackBuffer::extendSleeve(const TrackPoint& point) {
+    int32_t dLon = point.longitude - anchor.longitude;
+    if (dLon > 180000000L) dLon -= 360000000L;
+    if (dLon < -180000000L) dLon += 360000000L;
+    float x = dLon * METERS_PER_MICRODEGREE * cosLat;
+    float y = (point.latitude - anchor.latitude) * METERS_PER_MICRODEGREE;
+    float distance = sqrt(x * x + y * y);
+
+    // Turning back along the segment leaves every direction test intact
+    if (distance < farthest - TRACK_BACKTRACK_ERROR) {
+        return false;
+    }
+    farthest = max(farthest, distance);
+
+    // Fixes this close to the anchor fit any direction, until the sleeve
+    // has one; from then on they may end the segment and must be in it
+    if (distance <= TRACK_LATERAL_ERROR && sleeveWidth >= TWO_PI) {
+        return true;
+    }
+
+    float direction = atan2(y, x);
+    float halfWidth = distance > TRACK_LATERAL_ERROR ? asin(TRACK_LATERAL_ERROR / distance) : HALF_PI;
+    if (sleeveWidth >= TWO_PI) {
+        sleeveStart = wrapAngle(direction - halfWidth);
+        sleeveWidth = 2 * halfWidth;
+        return true;
+    }
+
+    float offset = wrapAngle(direction - sleeveStart);
+    if (offset > sleeveWidth) {
+        return false;
+    }
+
+    // Narrow the sleeve to the directions that also keep this fix in
+    float low = max(0.0f, offset - halfWidth);
+    float high = min(sleeveWidth, offset + halfWidth);
+    sleeveStart = wrapAngle(sleeveStart + low);
+    sleeveWidth = high - low;
+    return true;
+}
+
+// ===============================================================
+// UPLOAD QUEUE
+// ===============================================================
+
+void TrackBuffer::keep(const TrackPoint& point) {
+    if (count >= TRACK_BUFFER_POINTS) {
+        // Not uploaded in time; the oldest goes
+        head = (head + 1) % TRACK_BUFFER_POINTS;
+        count--;
+        totalDropped++;
+    }
+
+    points[(head + count) % TRACK_BUFFER_POINTS] = point;
+    count++;
+    totalKept++;
+}
+
+uint16_t TrackBuffer::peek(TrackPoint* out, uint16_t maxPoints) const {
+    uint16_t n = min(count, maxPoints);
+    for (uint16_t i = 0; i < n; i++) {
+        out[i] = points[(head + i) % TRACK_BUFFER_POINTS];
+    }
+    return n;
+}
+
+void TrackBuffer::consume(uint16_t n) {
+    n = min(n, count);
+    head = (head + n) % TRACK_BUFFER_POINTS;
+    count -= n;
+}
+
+float TrackBuffer::getCompressionRatio() const {
+    if (totalKept == 0) {
+        return 0.0;
+    }
+
+    return (float)totalFixes / totalKept;
+}
+
+// ===============================================================
+// DEBUG & LOGGING
+// ===============================================================
+
+void TrackBuffer::printStatistics() {
+    Serial.println("=== TRACK BUFFER STATISTICS ===");
+    Serial.print("Fixes / kept: ");
+    Serial.print(totalFixes);
+    Serial.print(" / ");
+    Serial.print(totalKept);
+    Serial.print(" (");
+    Serial.print(getCompressionRatio(), 1);
+    Serial.println(":1)");
+    Serial.print("Buffered: ");
+    Serial.print(count);
+    Serial.print("/");
+    Serial.println(TRACK_BUFFER_POINTS);
+    Serial.print("Dropped (buffer full): ");
+    Serial.println(totalDropped);
+}
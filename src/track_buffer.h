@@ -0,0 +1,76 @@
+#ifndef TRACK_BUFFER_H
+#define TRACK_BUFFER_H
+
+#include <Arduino.h>
+#include "../include/project_config.h"
+#include "lorawan_manager.h"
+
+// ===============================================================
+// STREAMING SIMPLIFICATION
+// ===============================================================
+//
+// Fixes go through an angular sleeve: from the last kept point (the
+// anchor) every later fix must lie within TRACK_MAX_ERROR of one common
+// direction. Each fix narrows the allowed range of directions by
+// asin(error / distance); the first fix that falls outside it (or comes
+// back toward the anchor, or arrives after TRACK_MAX_POINT_INTERVAL)
+// makes the previous fix the new anchor. One atan2 and one asin per fix,
+// no buffered window.
+
+// ===============================================================
+// TRACK BUFFER CLASS
+// ===============================================================
+
+class TrackBuffer {
+private:
+    // Kept points, oldest first, overwritten when full
+    TrackPoint points[TRACK_BUFFER_POINTS];
+    uint16_t head;
+    uint16_t count;
+
+    // Sleeve state
+    TrackPoint anchor;
+    uint32_t anchorFixTime;     // millis()
+    TrackPoint last;            // Latest fix, not kept yet
+    uint32_t lastFixTime;
+    float cosLat;               // Local meter frame at the anchor
+    float sleeveStart;          // Allowed directions, radians
+    float sleeveWidth;          // >= TWO_PI: unconstrained
+    float farthest;             // Largest distance from the anchor so far
+    bool hasAnchor;
+    bool hasLast;
+
+    // Statistics
+    uint32_t totalFixes;
+    uint32_t totalKept;
+    uint32_t totalDropped;      // Overwritten before upload
+
+    // Private methods
+    void keep(const TrackPoint& point);
+    void startSleeve(const TrackPoint& point, uint32_t fixTime);
+    bool extendSleeve(const TrackPoint& point);
+
+public:
+    // Constructor & Destructor
+    TrackBuffer();
+    ~TrackBuffer();
+
+    // Feed every new fix
+    void addFix(uint32_t fixTime, uint32_t timestamp, int32_t lat, int32_t lon);
+
+    // Keep the latest fix now, so a batch ends at the current position
+    void flush();
+
+    // Upload: copy the oldest points, then consume them once sent
+    uint16_t peek(TrackPoint* out, uint16_t maxPoints) const;
+    void consume(uint16_t n);
+    uint16_t getCount() const { return count; }
+
+    // Effectiveness
+    float getCompressionRatio() const;   // Fixes per kept point
+
+    // Debug & Logging
+    void printStatistics();
+};
+
+#endif // TRACK_BUFFER_H
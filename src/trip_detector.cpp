@@ -0,0 +1,375 @@
+#include "trip_detector.h"
+#include "geofence_manager.h"
+#include <Preferences.h>
+
+// Equirectangular distance between two fixes (m); trips are built from
+// steps of a few hundred meters at most
+static float fixDistance(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2) {
+    int32_t dLon = lon2 - lon1;
+    if (dLon > 180000000L) dLon -= 360000000L;
+    if (dLon < -180000000L) dLon += 360000000L;
+    float dy = (lat2 - lat1) * METERS_PER_MICRODEGREE;
+    float dx = dLon * METERS_PER_MICRODEGREE * cos((lat1 / 1e6) * DEG_TO_RAD);
+    return sqrt(dx * dx + dy * dy);
+}
+
+// One waypoint step in TRIP_WAYPOINT_UNIT, saturated to 16 bits
+static int16_t waypointStep(int32_t delta) {
+    if (delta > 180000000L) delta -= 360000000L;
+    if (delta < -180000000L) delta += 360000000L;
+    int32_t units = (delta >= 0 ? delta + TRIP_WAYPOINT_UNIT / 2 : delta - TRIP_WAYPOINT_UNIT / 2)
+                  / TRIP_WAYPOINT_UNIT;
+    return (int16_t)constrain(units, -32768L, 32767L);
+}
+
+// ===============================================================
+// CONSTRUCTOR & DESTRUCTOR
+// ===============================================================
+
+TripDetector::TripDetector() :
+    state(TRIP_STATE_STOPPED),
+    restLat(0),
+    restLon(0),
+    startLat(0),
+    startLon(0),
+    startFixTime(0),
+    startTimestamp(0),
+    stopPending(false),
+    stopLat(0),
+    stopLon(0),
+    stopFixTime(0),
+    stopTimestamp(0),
+    stopDistance(0),
+    odoLat(0),
+    odoLon(0),
+    tripDistance(0),
+    maxSpeed(0),
+    odometer(0),
+    tripId(0),
+    waypointCount(0),
+    waypointSpacing(TRIP_WAYPOINT_SPACING),
+    nextWaypointAt(TRIP_WAYPOINT_SPACING),
+    lastLat(0),
+    lastLon(0),
+    lastFixTime(0),
+    lastTimestamp(0),
+    pendingHead(0),
+    pendingCount(0),
+    summaryPending(false),
+    totalTrips(0),
+    totalFalseStarts(0),
+    totalLostFixEnds(0) {
+    memset(&pendingSummary, 0, sizeof(pendingSummary));
+}
+
+TripDetector::~TripDetector() {
+}
+
+// ===============================================================
+// INITIALIZATION
+// ===============================================================
+
+bool TripDetector::begin() {
+    Serial.println("Trip Detector: Initializing...");
+
+    Preferences prefs;
+    if (prefs.begin(STORAGE_NAMESPACE, true)) {
+        odometer = prefs.getUInt("trip_odo", 0);
+        tripId = prefs.getUShort("trip_id", 0);
+        prefs.end();
+    }
+
+    // The first fix sets the rest position
+    state = TRIP_STATE_STOPPED;
+    lastFixTime = 0;
+
+    Serial.print("Trip Detector: Odometer ");
+    Serial.print(odometer / 1000.0, 1);
+    Serial.print(" km, last trip ");
+    Serial.println(tripId);
+    return true;
+}
+
+// ===============================================================
+// STOP / MOVE DETECTION
+// ===============================================================
+
+void TripDetector::update(uint32_t fixTime, uint32_t timestamp, int32_t lat, int32_t lon,
+                          float speedMps, float hdop) {
+    if (lastFixTime == 0) {
+        restLat = lat;
+        restLon = lon;
+    } else if (state == TRIP_STATE_MOVING && fixTime - lastFixTime >= TRIP_STOP_DURATION &&
+               fixDistance(lastLat, lastLon, lat, lon) <= TRIP_STOP_RADIUS) {
+        // Fixes stopped while parked and resumed in the same place
+        endTrip(lastLat, lastLon, lastTimestamp, tripDistance);
+        restLat = lat;
+        restLon = lon;
+    }
+
+    bool slow = speedMps >= 0 && speedMps < TRIP_STOP_SPEED;
+    bool fast = speedMps >= TRIP_START_SPEED;
+
+    switch (state) {
+        case TRIP_STATE_STOPPED:
+            if (fast || fixDistance(restLat, restLon, lat, lon) > TRIP_STOP_RADIUS) {
+                // Backdate the start to the last fix at rest
+                state = TRIP_STATE_STARTING;
+                startLat = lastFixTime ? lastLat : lat;
+                startLon = lastFixTime ? lastLon : lon;
+                startFixTime = lastFixTime ? lastFixTime : fixTime;
+                startTimestamp = lastFixTime ? lastTimestamp : timestamp;
+                odoLat = startLat;
+                odoLon = startLon;
+                tripDistance = 0;
+                maxSpeed = 0;
+                waypointCount = 0;
+                waypointSpacing = TRIP_WAYPOINT_SPACING;
+                nextWaypointAt = TRIP_WAYPOINT_SPACING;
+                stopPending = false;
+            }
+            break;
+
+        case TRIP_STATE_STARTING:
+            if (slow && fixDistance(startLat, startLon, lat, lon) <= TRIP_STOP_RADIUS) {
+                // Moved around the yard and settled again
+                state = TRIP_STATE_STOPPED;
+                totalFalseStarts++;
+            } else if (fixTime - startFixTime >= TRIP_START_CONFIRM) {
+                state = TRIP_STATE_MOVING;
+                beginTrip();
+            }
+            break;
+
+        case TRIP_STATE_MOVING:
+            if (!stopPending) {
+                if (slow) {
+                    stopPending = true;
+                    stopLat = lat;
+                    stopLon = lon;
+                    stopFixTime = fixTime;
+                    stopTimestamp = timestamp;
+                    stopDistance = tripDistance;
+                }
+            } else if (fast || fixDistance(stopLat, stopLon, lat, lon) > TRIP_STOP_RADIUS) {
+                stopPending = false;        // Traffic light, not a stop
+            } else if (fixTime - stopFixTime >= TRIP_STOP_DURATION) {
+                endTrip(stopLat, stopLon, stopTimestamp, stopDistance);
+                restLat = stopLat;
+                restLon = stopLon;
+            }
+            break;
+    }
+
+    if (state != TRIP_STATE_STOPPED) {
+        addOdometer(lat, lon, hdop);
+        maxSpeed = max(maxSpeed, speedMps);
+    }
+
+    lastLat = lat;
+    lastLon = lon;
+    lastFixTime = fixTime;
+    lastTimestamp = timestamp;
+}
+
+void TripDetector::checkTimeout(uint32_t now) {
+    if (state == TRIP_STATE_STOPPED || lastFixTime == 0 || now - lastFixTime < TRIP_LOST_FIX_TIMEOUT) {
+        return;
+    }
+
+    if (state == TRIP_STATE_MOVING) {
+        endTrip(lastLat, lastLon, lastTimestamp, tripDistance);
+        totalLostFixEnds++;
+    } else {
+        state = TRIP_STATE_STOPPED;
+    }
+    restLat = lastLat;
+    restLon = lastLon;
+}
+
+void TripDetector::addOdometer(int32_t lat, int32_t lon, float hdop) {
+    // Count a step only once the asset is clear of the fix noise, so an
+    // hour parked under a tree does not drive the odometer
+    float step = fixDistance(odoLat, odoLon, lat, lon);
+    if (step < max((float)TRIP_ODOMETER_MIN_STEP, hdop * (float)GPS_UERE_METERS)) {
+        return;
+    }
+
+    tripDistance += step;
+    odoLat = lat;
+    odoLon = lon;
+
+    if (!stopPending && tripDistance >= nextWaypointAt) {
+        addWaypoint(lat, lon);
+    }
+}
+
+void TripDetector::addWaypoint(int32_t lat, int32_t lon) {
+    if (TRIP_MAX_WAYPOINTS < 2) {
+        return; // Only the end point fits
+    }
+
+    waypointLat[waypointCount] = lat;
+    waypointLon[waypointCount] = lon;
+    waypointCount++;
+
+    if (waypointCount >= TRIP_MAX_WAYPOINTS - 1) {
+        // Keep the ones at even multiples of the spacing
+        uint8_t kept = 0;
+        for (uint8_t i = 1; i < waypointCount; i += 2) {
+            waypointLat[kept] = waypointLat[i];
+            waypointLon[kept] = waypointLon[i];
+            kept++;
+        }
+        waypointCount = kept;
+        waypointSpacing *= 2;
+    }
+    nextWaypointAt = (waypointCount + 1) * waypointSpacing;
+}
+
+// ===============================================================
+// TRIP MESSAGES
+// ===============================================================
+
+void TripDetector::beginTrip() {
+    tripId++;
+    totalTrips++;
+    queueEvent(TRIP_START, startLat, startLon, startTimestamp);
+
+    Serial.print("Trip Detector: Trip ");
+    Serial.print(tripId);
+    Serial.println(" started");
+}
+
+void TripDetector::endTrip(int32_t lat, int32_t lon, uint32_t timestamp, float distance) {
+    odometer += (uint32_t)distance;
+    state = TRIP_STATE_STOPPED;
+    stopPending = false;
+
+    queueEvent(TRIP_END, lat, lon, timestamp);
+    buildSummary(lat, lon, timestamp, distance);
+    saveOdometer();
+
+    Serial.print("Trip Detector: Trip ");
+    Serial.print(tripId);
+    Serial.print(" ended, ");
+    Serial.print(distance / 1000.0, 2);
+    Serial.println(" km");
+}
+
+void TripDetector::queueEvent(uint8_t type, int32_t lat, int32_t lon, uint32_t timestamp) {
+    if (pendingCount >= MAX_TRIP_EVENTS) {
+        // Drop the oldest; the summary still carries the trip
+        pendingHead = (pendingHead + 1) % MAX_TRIP_EVENTS;
+        pendingCount--;
+    }
+
+    TripEvent& event = pendingEvents[(pendingHead + pendingCount) % MAX_TRIP_EVENTS];
+    event.event_type = type;
+    event.trip_id = tripId;
+    event.latitude = lat;
+    event.longitude = lon;
+    event.timestamp = timestamp;
+    event.odometer = odometer;
+    pendingCount++;
+}
+
+void TripDetector::buildSummary(int32_t endLat, int32_t endLon, uint32_t endTimestamp, float distance) {
+    TripSummary& summary = pendingSummary;
+    uint32_t duration = endTimestamp - startTimestamp;
+
+    summary.trip_id = tripId;
+    summary.start_time = startTimestamp;
+    summary.duration = min(duration, (uint32_t)0xFFFF);
+    summary.distance = (uint32_t)distance;
+    summary.max_speed = (uint8_t)constrain(maxSpeed * 3.6, 0.0, 255.0);
+    summary.avg_speed = duration > 0 ? (uint8_t)constrain(distance / duration * 3.6, 0.0, 255.0) : 0;
+    summary.start_latitude = startLat;
+    summary.start_longitude = startLon;
+
+    // Steps from the previous reconstructed point, so rounding does not
+    // accumulate along the trip
+    summary.waypoint_count = 0;
+    if (TRIP_MAX_WAYPOINTS > 0) {
+        waypointLat[waypointCount] = endLat;
+        waypointLon[waypointCount] = endLon;
+        int32_t lat = startLat;
+        int32_t lon = startLon;
+        for (uint8_t i = 0; i <= waypointCount; i++) {
+            int16_t dLat = waypointStep(waypointLat[i] - lat);
+            int16_t dLon = waypointStep(waypointLon[i] - lon);
+            summary.waypoints[i][0] = dLat;
+            summary.waypoints[i][1] = dLon;
+            lat += (int32_t)dLat * TRIP_WAYPOINT_UNIT;
+            lon += (int32_t)dLon * TRIP_WAYPOINT_UNIT;
+        }
+        summary.waypoint_count = waypointCount + 1;
+    }
+
+    summaryPending = true;
+}
+
+bool TripDetector::getEvent(TripEvent& event) {
+    if (pendingCount == 0) {
+        return false;
+    }
+
+    event = pendingEvents[pendingHead];
+    pendingHead = (pendingHead + 1) % MAX_TRIP_EVENTS;
+    pendingCount--;
+    return true;
+}
+
+bool TripDetector::getSummary(TripSummary& summary) {
+    if (!summaryPending) {
+        return false;
+    }
+
+    summary = pendingSummary;
+    summaryPending = false;
+    return true;
+}
+
+uint32_t TripDetector::getOdometer() const {
+    return odometer + (state == TRIP_STATE_STOPPED ? 0 : (uint32_t)tripDistance);
+}
+
+// ===============================================================
+// PERSISTENCE
+// ===============================================================
+
+void TripDetector::saveOdometer() {
+    // Once per trip, so flash wear follows the number of trips
+    Preferences prefs;
+    if (prefs.begin(STORAGE_NAMESPACE, false)) {
+        prefs.putUInt("trip_odo", odometer);
+        prefs.putUShort("trip_id", tripId);
+        prefs.end();
+    }
+}
+
+// ===============================================================
+// DEBUG & LOGGING
+// ===============================================================
+
+void TripDetector::printStatistics() {
+    Serial.println("=== TRIP DETECTOR STATISTICS ===");
+    Serial.print("State: ");
+    Serial.println(state == TRIP_STATE_MOVING ? "MOVING" : state == TRIP_STATE_STARTING ? "STARTING" : "STOPPED");
+    Serial.print("Odometer: ");
+    Serial.print(getOdometer() / 1000.0, 1);
+    Serial.println(" km");
+    Serial.print("Trips / false starts / lost-fix ends: ");
+    Serial.print(totalTrips);
+    Serial.print(" / ");
+    Serial.print(totalFalseStarts);
+    Serial.print(" / ");
+    Serial.println(totalLostFixEnds);
+    if (state != TRIP_STATE_STOPPED) {
+        Serial.print("Current trip: ");
+        Serial.print(tripDistance / 1000.0, 2);
+        Serial.print(" km, ");
+        Serial.print(waypointCount);
+        Serial.println(" waypoints");
+    }
+}
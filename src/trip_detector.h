@@ -0,0 +1,125 @@
+#ifndef TRIP_DETECTOR_H
+#define TRIP_DETECTOR_H
+
+#include <Arduino.h>
+#include "../include/project_config.h"
+#include "lorawan_manager.h"
+
+#define MAX_TRIP_EVENTS             4
+
+// ===============================================================
+// TRIP STATES
+// ===============================================================
+//
+//   STOPPED --(speed or displacement)--> STARTING --(confirmed)--> MOVING
+//      ^                                    |                        |
+//      +-----------(back at rest)-----------+                        |
+//      +-----------(at rest for TRIP_STOP_DURATION, or fix lost)-----+
+//
+// A trip starts where and when the asset left rest, and ends where and
+// when it came to rest, so both confirmations are backdated.
+
+enum TripState : uint8_t {
+    TRIP_STATE_STOPPED = 0,
+    TRIP_STATE_STARTING,
+    TRIP_STATE_MOVING
+};
+
+// ===============================================================
+// TRIP DETECTOR CLASS
+// ===============================================================
+
+class TripDetector {
+private:
+    TripState state;
+
+    // Rest position, and where / when the current trip left it
+    int32_t restLat;
+    int32_t restLon;
+    int32_t startLat;
+    int32_t startLon;
+    uint32_t startFixTime;      // millis()
+    uint32_t startTimestamp;    // Reported time (s)
+
+    // Stop candidate inside a trip
+    bool stopPending;
+    int32_t stopLat;
+    int32_t stopLon;
+    uint32_t stopFixTime;
+    uint32_t stopTimestamp;
+    float stopDistance;         // Trip distance when the asset came to rest
+
+    // Odometer (m). Steps shorter than the fix error are not counted.
+    int32_t odoLat;
+    int32_t odoLon;
+    float tripDistance;
+    float maxSpeed;             // m/s
+    uint32_t odometer;          // Completed trips, persisted at each trip end
+    uint16_t tripId;
+
+    // Downsampled waypoints: one every waypointSpacing meters, thinned to
+    // every other one (and the spacing doubled) when the buffer fills.
+    // The last slot is kept for the end point.
+    int32_t waypointLat[TRIP_MAX_WAYPOINTS + 1];
+    int32_t waypointLon[TRIP_MAX_WAYPOINTS + 1];
+    uint8_t waypointCount;
+    float waypointSpacing;
+    float nextWaypointAt;
+
+    // Last fix
+    int32_t lastLat;
+    int32_t lastLon;
+    uint32_t lastFixTime;
+    uint32_t lastTimestamp;
+
+    // Pending messages
+    TripEvent pendingEvents[MAX_TRIP_EVENTS];
+    uint8_t pendingHead;
+    uint8_t pendingCount;
+    TripSummary pendingSummary;
+    bool summaryPending;
+
+    // Statistics
+    uint32_t totalTrips;
+    uint32_t totalFalseStarts;
+    uint32_t totalLostFixEnds;
+
+    // Private methods
+    void beginTrip();
+    void endTrip(int32_t lat, int32_t lon, uint32_t timestamp, float distance);
+    void addOdometer(int32_t lat, int32_t lon, float hdop);
+    void addWaypoint(int32_t lat, int32_t lon);
+    void queueEvent(uint8_t type, int32_t lat, int32_t lon, uint32_t timestamp);
+    void buildSummary(int32_t endLat, int32_t endLon, uint32_t endTimestamp, float distance);
+    void saveOdometer();
+
+public:
+    // Constructor & Destructor
+    TripDetector();
+    ~TripDetector();
+
+    // Initialization (restores the odometer and trip counter)
+    bool begin();
+
+    // Feed every new fix. `speedMps` is the filtered GNSS speed (negative =
+    // unknown), `timestamp` the time reported in messages (s).
+    void update(uint32_t fixTime, uint32_t timestamp, int32_t lat, int32_t lon, float speedMps, float hdop);
+
+    // Close an open trip when fixes stopped arriving (garage, tunnel)
+    void checkTimeout(uint32_t now);
+
+    // Messages for the uplink
+    bool getEvent(TripEvent& event);
+    bool getSummary(TripSummary& summary);
+
+    // State
+    bool isMoving() const { return state == TRIP_STATE_MOVING; }
+    TripState getState() const { return state; }
+    uint32_t getOdometer() const;       // meters, including the current trip
+    uint16_t getTripId() const { return tripId; }
+
+    // Debug & Logging
+    void printStatistics();
+};
+
+#endif // TRIP_DETECTOR_H
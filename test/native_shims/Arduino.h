@@ -0,0 +1,122 @@
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+// ===============================================================
+// HOST SHIM: ARDUINO CORE
+// ===============================================================
+//
+// Just enough of the Arduino/ESP32 core for the geofence engine to build
+// with `pio test -e native`. Time is whatever the test sets nativeMillis
+// to; Serial output is dropped so Unity's report stays readable.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <string>
+#include <type_traits>
+
+#define IRAM_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+
+#define PI          3.1415926535897932384626433832795
+#define HALF_PI     1.5707963267948966192313216916398
+#define TWO_PI      6.283185307179586476925286766559
+#define DEG_TO_RAD  0.017453292519943295769236907684886
+#define RAD_TO_DEG  57.295779513082320876798154814105
+#define HEX 16
+#define DEC 10
+
+typedef uint8_t byte;
+
+template<class T, class U>
+typename std::common_type<T, U>::type min(T a, U b) { return a < b ? a : b; }
+template<class T, class U>
+typename std::common_type<T, U>::type max(T a, U b) { return a > b ? a : b; }
+template<class T, class L, class H>
+T constrain(T x, L low, H high) { return x < low ? low : (x > high ? high : x); }
+template<class T>
+T sq(T x) { return x * x; }
+
+// ===============================================================
+// TIME
+// ===============================================================
+
+inline uint32_t nativeMillis = 0;
+
+inline unsigned long millis() { return nativeMillis; }
+inline unsigned long micros() { return nativeMillis * 1000UL; }
+inline void delay(unsigned long ms) { nativeMillis += ms; }
+inline void yield() {}
+
+// ===============================================================
+// STRING & SERIAL
+// ===============================================================
+
+class String {
+public:
+    String() {}
+    String(const char* text) : value(text ? text : "") {}
+    String(char c) : value(1, c) {}
+    String(long number) : value(std::to_string(number)) {}
+    String(unsigned long number) : value(std::to_string(number)) {}
+    String(int number) : value(std::to_string(number)) {}
+    String(unsigned int number) : value(std::to_string(number)) {}
+
+    String& operator+=(const String& other) { value += other.value; return *this; }
+    String& operator+=(const char* other) { value += other; return *this; }
+    String& operator+=(char other) { value += other; return *this; }
+    friend String operator+(String a, const String& b) { return a += b; }
+    bool operator==(const char* other) const { return value == other; }
+    void reserve(size_t size) { value.reserve(size); }
+    size_t length() const { return value.size(); }
+    const char* c_str() const { return value.c_str(); }
+
+private:
+    std::string value;
+};
+
+class Print {
+public:
+    template<class T> size_t print(const T&, int = DEC) { return 0; }
+    template<class T> size_t println(const T&, int = DEC) { return 0; }
+    size_t println() { return 0; }
+    size_t printf(const char*, ...) { return 0; }
+    size_t write(const uint8_t*, size_t length) { return length; }
+};
+
+class HardwareSerial : public Print {
+public:
+    void begin(unsigned long) {}
+    int available() { return 0; }
+    int read() { return -1; }
+};
+
+inline HardwareSerial Serial;
+
+// ===============================================================
+// ESP32
+// ===============================================================
+
+inline bool psramFound() { return false; }
+inline void* ps_malloc(size_t size) { return malloc(size); }
+
+class EspClass {
+public:
+    // Cycle counter at a nominal 240 MHz, from the host's clock
+    uint32_t getCycleCount() {
+        auto now = std::chrono::steady_clock::now().time_since_epoch();
+        return (uint32_t)(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count() * 240 / 1000);
+    }
+    uint32_t getCpuFreqMHz() { return 240; }
+    uint32_t getFreeHeap() { return 0; }
+    void restart() {}
+};
+
+inline EspClass ESP;
+
+#endif // NATIVE_ARDUINO_H
@@ -0,0 +1,6 @@
+#ifndef NATIVE_FS_H
+#define NATIVE_FS_H
+
+#include "LittleFS.h"
+
+#endif // NATIVE_FS_H
@@ -0,0 +1,179 @@
+#ifndef NATIVE_LITTLEFS_H
+#define NATIVE_LITTLEFS_H
+
+#include <Arduino.h>
+#include <map>
+#include <set>
+#include <vector>
+
+// ===============================================================
+// HOST SHIM: LITTLEFS
+// ===============================================================
+//
+// An in-memory filesystem that only mounts once a test sets `mountable`:
+// until then tiled fences and their sync stay disabled, as on a device
+// flashed without a filesystem image. Tests call LittleFS.wipe() to start
+// from a blank partition. Directories are flat, as TILE_DIR is.
+
+class LittleFSFS;
+
+class File {
+public:
+    File() {}
+
+    explicit operator bool() const { return data != nullptr || directory; }
+    size_t size() const { return data ? data->size() : 0; }
+    size_t read(uint8_t* buffer, size_t length) {
+        length = data ? min(length, data->size() - pos) : 0;
+        if (length) {
+            memcpy(buffer, data->data() + pos, length);
+        }
+        pos += length;
+        return length;
+    }
+    size_t write(const uint8_t* buffer, size_t length) {
+        if (!data || !writable) {
+            return 0;
+        }
+        data->resize(max(data->size(), pos + length));
+        memcpy(data->data() + pos, buffer, length);
+        pos += length;
+        return length;
+    }
+    bool seek(size_t position) {
+        if (!data || position > data->size()) {
+            return false;
+        }
+        pos = position;
+        return true;
+    }
+    size_t position() const { return pos; }
+    int available() { return (int)(size() - pos); }
+    bool isDirectory() const { return directory; }
+    const char* name() const { return base.c_str(); }
+    File openNextFile();
+    void flush() {}
+    void close() {
+        data = nullptr;
+        directory = false;
+    }
+
+private:
+    friend class LittleFSFS;
+
+    std::vector<uint8_t>* data = nullptr;
+    std::string path;
+    std::string base;
+    size_t pos = 0;
+    bool writable = false;
+    bool directory = false;
+    std::vector<std::string> listing;    // Directory: paths still to open
+};
+
+class LittleFSFS {
+public:
+    bool mountable = false;
+
+    bool begin(bool = false) { return mountable; }
+
+    bool exists(const char* path) {
+        return mountable && (files.count(path) > 0 || dirs.count(path) > 0);
+    }
+
+    File open(const char* path, const char* mode = "r") {
+        File file;
+        if (!mountable) {
+            return file;
+        }
+
+        if (dirs.count(path)) {
+            file.directory = true;
+            file.path = path;
+            std::string prefix = file.path + "/";
+            for (auto& entry : files) {
+                if (entry.first.compare(0, prefix.size(), prefix) == 0) {
+                    file.listing.push_back(entry.first);
+                }
+            }
+            return file;
+        }
+
+        bool exists = files.count(path) > 0;
+        if (mode[0] == 'r' && !exists) {
+            return file;
+        }
+        if (mode[0] != 'r' && !dirs.count(parentOf(path))) {
+            return file;
+        }
+
+        file.data = &files[path];
+        file.path = path;
+        file.base = file.path.substr(file.path.rfind('/') + 1);
+        file.writable = mode[0] != 'r';
+        if (mode[0] == 'w') {
+            file.data->clear();
+        }
+        if (mode[0] == 'a') {
+            file.pos = file.data->size();
+        }
+        return file;
+    }
+
+    bool remove(const char* path) { return mountable && files.erase(path) > 0; }
+
+    bool rename(const char* from, const char* to) {
+        if (!mountable || !files.count(from)) {
+            return false;
+        }
+        files[to] = files[from];
+        files.erase(from);
+        return true;
+    }
+
+    bool mkdir(const char* path) {
+        if (!mountable) {
+            return false;
+        }
+        dirs.insert(path);
+        return true;
+    }
+
+    size_t totalBytes() { return mountable ? 1536 * 1024 : 0; }
+    size_t usedBytes() {
+        size_t used = 0;
+        for (auto& entry : files) {
+            used += entry.second.size();
+        }
+        return used;
+    }
+
+    void wipe() {
+        files.clear();
+        dirs.clear();
+        mountable = false;
+    }
+
+private:
+    std::map<std::string, std::vector<uint8_t>> files;
+    std::set<std::string> dirs;
+
+    static std::string parentOf(const std::string& path) {
+        return path.substr(0, path.rfind('/'));
+    }
+};
+
+inline LittleFSFS LittleFS;
+
+inline File File::openNextFile() {
+    while (directory && !listing.empty()) {
+        std::string next = listing.front();
+        listing.erase(listing.begin());
+        File file = LittleFS.open(next.c_str(), "r");
+        if (file) {
+            return file;
+        }
+    }
+    return File();
+}
+
+#endif // NATIVE_LITTLEFS_H
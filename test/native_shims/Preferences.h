@@ -0,0 +1,79 @@
+#ifndef NATIVE_PREFERENCES_H
+#define NATIVE_PREFERENCES_H
+
+#include <Arduino.h>
+#include <map>
+#include <vector>
+
+// ===============================================================
+// HOST SHIM: NVS PREFERENCES
+// ===============================================================
+//
+// One in-memory store shared by every Preferences object, as NVS is.
+// Tests call Preferences::wipe() to start from a blank flash.
+
+class Preferences {
+public:
+    bool begin(const char* name, bool readOnly = false) {
+        space = name;
+        return true;
+    }
+    void end() {}
+
+    bool clear() { store().erase(space); return true; }
+    bool remove(const char* key) { return store()[space].erase(key) > 0; }
+    bool isKey(const char* key) { return store()[space].count(key) > 0; }
+
+    size_t putBytes(const char* key, const void* data, size_t length) {
+        if (!length) {
+            return 0;   // As the Arduino core: nothing written, an old value stays
+        }
+        const uint8_t* bytes = (const uint8_t*)data;
+        store()[space][key].assign(bytes, bytes + length);
+        return length;
+    }
+    size_t getBytesLength(const char* key) {
+        return isKey(key) ? store()[space][key].size() : 0;
+    }
+    size_t getBytes(const char* key, void* data, size_t length) {
+        if (!isKey(key) || store()[space][key].size() > length) {
+            return 0;
+        }
+        const std::vector<uint8_t>& value = store()[space][key];
+        memcpy(data, value.data(), value.size());
+        return value.size();
+    }
+
+    size_t putUChar(const char* key, uint8_t value) { return put(key, value); }
+    uint8_t getUChar(const char* key, uint8_t fallback = 0) { return get(key, fallback); }
+    size_t putUShort(const char* key, uint16_t value) { return put(key, value); }
+    uint16_t getUShort(const char* key, uint16_t fallback = 0) { return get(key, fallback); }
+    size_t putShort(const char* key, int16_t value) { return put(key, value); }
+    int16_t getShort(const char* key, int16_t fallback = 0) { return get(key, fallback); }
+    size_t putUInt(const char* key, uint32_t value) { return put(key, value); }
+    uint32_t getUInt(const char* key, uint32_t fallback = 0) { return get(key, fallback); }
+    size_t putInt(const char* key, int32_t value) { return put(key, value); }
+    int32_t getInt(const char* key, int32_t fallback = 0) { return get(key, fallback); }
+    size_t putULong64(const char* key, uint64_t value) { return put(key, value); }
+    uint64_t getULong64(const char* key, uint64_t fallback = 0) { return get(key, fallback); }
+    size_t putBool(const char* key, bool value) { return put(key, (uint8_t)value); }
+    bool getBool(const char* key, bool fallback = false) { return get(key, (uint8_t)fallback) != 0; }
+
+    static void wipe() { store().clear(); }
+
+private:
+    std::string space;
+
+    static std::map<std::string, std::map<std::string, std::vector<uint8_t>>>& store() {
+        static std::map<std::string, std::map<std::string, std::vector<uint8_t>>> flash;
+        return flash;
+    }
+
+    template<class T> size_t put(const char* key, T value) { return putBytes(key, &value, sizeof(value)); }
+    template<class T> T get(const char* key, T fallback) {
+        T value;
+        return getBytesLength(key) == sizeof(value) && getBytes(key, &value, sizeof(value)) ? value : fallback;
+    }
+};
+
+#endif // NATIVE_PREFERENCES_H
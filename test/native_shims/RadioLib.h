@@ -0,0 +1,20 @@
+#ifndef NATIVE_RADIOLIB_H
+#define NATIVE_RADIOLIB_H
+
+#include <Arduino.h>
+
+// ===============================================================
+// HOST SHIM: RADIOLIB
+// ===============================================================
+//
+// The types lorawan_manager.h declares members and parameters with; the
+// native build links none of the radio code.
+
+typedef unsigned long RadioLibTime_t;
+
+class SX1262;
+class LoRaWANNode;
+struct LoRaWANBand_t;
+struct LoRaWANEvent_t;
+
+#endif // NATIVE_RADIOLIB_H
@@ -0,0 +1,114 @@
+#ifndef NATIVE_FREERTOS_H
+#define NATIVE_FREERTOS_H
+
+#include <stdint.h>
+#include <string.h>
+#include <deque>
+#include <vector>
+
+// ===============================================================
+// HOST SHIM: FREERTOS
+// ===============================================================
+//
+// Queues and mutexes for a single thread. Tasks do not run by
+// themselves: nativeRunTasks() runs each one started so far until it
+// waits on an empty queue, as a loader does between two fixes on the
+// device. A task's loop must keep nothing across that wait but what is
+// in its object, since it is entered afresh every time.
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void* QueueHandle_t;
+typedef void* SemaphoreHandle_t;
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+#define pdTRUE          1
+#define pdFALSE         0
+#define pdPASS          pdTRUE
+#define pdFAIL          pdFALSE
+#define portMAX_DELAY   0xFFFFFFFFUL
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+struct NativeQueue {
+    UBaseType_t length;
+    UBaseType_t itemSize;
+    std::deque<std::vector<uint8_t>> items;
+};
+
+struct NativeTask {
+    TaskFunction_t function;
+    void* arg;
+};
+
+// Thrown out of a task that would block forever; nativeRunTasks() catches it
+struct NativeTaskBlocked {};
+
+inline std::vector<NativeTask*> nativeTasks;
+
+inline QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    return new NativeQueue{length, itemSize, {}};
+}
+
+inline BaseType_t xQueueSend(QueueHandle_t handle, const void* item, TickType_t) {
+    NativeQueue* queue = static_cast<NativeQueue*>(handle);
+    if (queue->items.size() >= queue->length) {
+        return pdFAIL;
+    }
+    const uint8_t* bytes = static_cast<const uint8_t*>(item);
+    queue->items.emplace_back(bytes, bytes + queue->itemSize);
+    return pdPASS;
+}
+
+inline BaseType_t xQueueReceive(QueueHandle_t handle, void* item, TickType_t wait) {
+    NativeQueue* queue = static_cast<NativeQueue*>(handle);
+    if (queue->items.empty()) {
+        if (wait == portMAX_DELAY) {
+            throw NativeTaskBlocked();
+        }
+        return pdFALSE;
+    }
+    memcpy(item, queue->items.front().data(), queue->itemSize);
+    queue->items.pop_front();
+    return pdTRUE;
+}
+
+inline void vQueueDelete(QueueHandle_t handle) { delete static_cast<NativeQueue*>(handle); }
+
+// Never contended with one thread; any non-null handle will do
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return new uint8_t(0); }
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t, TickType_t) { return pdTRUE; }
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t) { return pdTRUE; }
+inline void vSemaphoreDelete(SemaphoreHandle_t handle) { delete static_cast<uint8_t*>(handle); }
+
+inline BaseType_t xTaskCreate(TaskFunction_t function, const char*, uint32_t, void* arg, UBaseType_t,
+                              TaskHandle_t* handle) {
+    NativeTask* task = new NativeTask{function, arg};
+    nativeTasks.push_back(task);
+    if (handle) {
+        *handle = task;
+    }
+    return pdPASS;
+}
+
+inline void vTaskDelete(TaskHandle_t handle) {
+    for (size_t i = 0; i < nativeTasks.size(); i++) {
+        if (nativeTasks[i] == handle) {
+            nativeTasks.erase(nativeTasks.begin() + i);
+            delete static_cast<NativeTask*>(handle);
+            return;
+        }
+    }
+}
+
+inline void nativeRunTasks() {
+    for (size_t i = 0; i < nativeTasks.size(); i++) {
+        try {
+            nativeTasks[i]->function(nativeTasks[i]->arg);
+        } catch (const NativeTaskBlocked&) {
+        }
+    }
+}
+
+#endif // NATIVE_FREERTOS_H
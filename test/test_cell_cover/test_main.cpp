@@ -0,0 +1,159 @@
+#include <unity.h>
+#include <Preferences.h>
+#include "geofence_manager.h"
+
+// ===============================================================
+// CELL COVER (pio test -e native)
+// ===============================================================
+//
+// Interior and exterior cells answer membership without geometry, so
+// they must never disagree with it: at random points around a circle,
+// a concave polygon and a polygon with a hole, the membership a check
+// reports is compared with the sign of the exact distance. Points in
+// the hysteresis band are skipped, as there the previous state decides.
+
+#define COVER_QUERIES               5000
+#define BAND_MARGIN                 (GEOFENCE_HYSTERESIS + 1.0)    // m, plus micro-degree truncation
+
+#define CIRCLE_ID                   1
+#define L_SHAPE_ID                  2
+#define HOLE_ID                     3
+
+// L-shaped yard, ~200 m on its long sides
+static const int32_t lShapeLat[] = {-33452000, -33452000, -33451500, -33451500, -33450200, -33450200};
+static const int32_t lShapeLon[] = {-70668000, -70665800, -70665800, -70667000, -70667000, -70668000};
+
+// Square with a square courtyard
+static const int32_t holeLat[] = {-33460000, -33460000, -33458000, -33458000,
+                                  -33459500, -33458500, -33458500, -33459500};
+static const int32_t holeLon[] = {-70660000, -70657600, -70657600, -70660000,
+                                  -70659400, -70659400, -70658200, -70658200};
+static const uint16_t holeRings[] = {4, 4};
+
+struct CoverArea {
+    uint8_t id;
+    int32_t lat;             // Center, * 1e6
+    int32_t lon;
+    int32_t span;            // Half extent sampled, micro-degrees
+};
+
+static const CoverArea areas[] = {
+    {CIRCLE_ID, -33448900, -70669300, 1400},
+    {L_SHAPE_ID, -33451100, -70666900, 1000},
+    {HOLE_ID, -33459000, -70658800, 1100},
+};
+
+static GeofenceManager* geofences;
+static uint32_t seed;
+
+// Deterministic across hosts
+static uint32_t nextRandom() {
+    seed = seed * 1664525UL + 1013904223UL;
+    return seed >> 8;
+}
+
+static int32_t randomOffset(int32_t span) {
+    return (int32_t)(nextRandom() % (uint32_t)(2 * span + 1)) - span;
+}
+
+void setUp() {
+    Preferences::wipe();
+    nativeMillis = 0;
+    seed = 12345;
+    geofences = new GeofenceManager();
+    geofences->begin();
+    geofences->clearGeofences();
+    TEST_ASSERT_TRUE(geofences->addCircle(CIRCLE_ID, -33.4489, -70.6693, 150));
+    TEST_ASSERT_TRUE(geofences->addPolygon(L_SHAPE_ID, lShapeLat, lShapeLon, 6));
+    TEST_ASSERT_TRUE(geofences->addMultiPolygon(HOLE_ID, holeLat, holeLon, holeRings, 2));
+}
+
+void tearDown() {
+    delete geofences;
+}
+
+// One due check at a point, its transitions drained. The fixes are too
+// far apart in time to sweep the segment between them, so only fences
+// near the point itself are evaluated.
+static void checkAt(int32_t lat, int32_t lon) {
+    nativeMillis += GEOFENCE_MAX_SEGMENT_TIME + GEOFENCE_CHECK_INTERVAL;
+    GeofenceEvent event;
+    while (geofences->checkGeofences(lat / 1e6, lon / 1e6, event)) {
+    }
+}
+
+// Points around one fence; returns how many were clear of the band
+static uint32_t compareAround(const CoverArea& area, uint32_t& mismatches) {
+    uint32_t compared = 0;
+    for (uint32_t q = 0; q < COVER_QUERIES; q++) {
+        int32_t lat = area.lat + randomOffset(area.span);
+        int32_t lon = area.lon + randomOffset(area.span);
+        checkAt(lat, lon);
+
+        float distance;
+        TEST_ASSERT_TRUE(geofences->getDistanceToBoundary(area.id, lat / 1e6, lon / 1e6, distance));
+        if (fabs(distance) < BAND_MARGIN) {
+            continue;
+        }
+        compared++;
+        if (geofences->isInside(area.id) != (distance < 0)) {
+            mismatches++;
+        }
+    }
+    return compared;
+}
+
+// ===============================================================
+// TESTS
+// ===============================================================
+
+void test_cells_agree_with_exact_geometry() {
+    uint32_t mismatches = 0;
+    for (const CoverArea& area : areas) {
+        uint32_t compared = compareAround(area, mismatches);
+        TEST_ASSERT_TRUE(compared > COVER_QUERIES * 3 / 4);
+    }
+    TEST_ASSERT_EQUAL(0, mismatches);
+}
+
+void test_most_evaluations_skip_geometry() {
+    // The fences share the cell table, so boundary cells stay coarse: the
+    // two-ring polygon, with the longest boundary, falls through most
+    uint32_t mismatches = 0;
+    for (const CoverArea& area : areas) {
+        compareAround(area, mismatches);
+    }
+
+    uint32_t hits = geofences->getCellHits();
+    uint32_t exact = geofences->getCellFallthroughs();
+    char message[64];
+    snprintf(message, sizeof(message), "%u answered by cells, %u by geometry", (unsigned)hits, (unsigned)exact);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_TRUE(hits > exact);
+}
+
+void test_cover_follows_fence_changes() {
+    // Inside the circle, then the circle shrinks away from the point
+    int32_t lat = -33448900 + 1000;     // ~111 m north of the center
+    checkAt(lat, -70669300);
+    TEST_ASSERT_TRUE(geofences->isInside(CIRCLE_ID));
+
+    TEST_ASSERT_TRUE(geofences->removeGeofence(CIRCLE_ID));
+    TEST_ASSERT_TRUE(geofences->addCircle(CIRCLE_ID, -33.4489, -70.6693, 50));
+    checkAt(lat, -70669300);
+    TEST_ASSERT_FALSE(geofences->isInside(CIRCLE_ID));
+
+    // And the hole filled in: the courtyard becomes inside
+    TEST_ASSERT_TRUE(geofences->removeGeofence(HOLE_ID));
+    TEST_ASSERT_TRUE(geofences->addPolygon(HOLE_ID, holeLat, holeLon, 4));
+    checkAt(-33459000, -70658800);
+    TEST_ASSERT_TRUE(geofences->isInside(HOLE_ID));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_cells_agree_with_exact_geometry);
+    RUN_TEST(test_most_evaluations_skip_geometry);
+    RUN_TEST(test_cover_follows_fence_changes);
+    return UNITY_END();
+}
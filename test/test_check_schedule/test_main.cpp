@@ -0,0 +1,163 @@
+#include <unity.h>
+#include <Preferences.h>
+#include "geofence_manager.h"
+#include "../traces/drive_trace.h"
+
+// ===============================================================
+// TIME-TO-BOUNDARY CHECK SCHEDULE (pio test -e native)
+// ===============================================================
+//
+// Offers every fix of the recorded drive (tools/geofence_trace.py) at
+// 1 Hz and lets the predicted deadline decide which ones are checked.
+// Nothing may be missed against the transitions of the 10 Hz path, and
+// most fixes should be skipped.
+
+#define MAX_REPLAY_EVENTS           32
+#define TIME_TOLERANCE              1500    // ms
+#define MAX_CHECKED_SHARE           0.25    // Of the fixes offered
+#define MAX_CHECK_DELAY             (2 * GPS_UPDATE_RATE)   // From a crossing to the next check
+
+struct Replay {
+    GeofenceEvent events[MAX_REPLAY_EVENTS];
+    uint8_t eventCount;
+    uint32_t offered;
+    uint32_t evaluated;
+    uint32_t lateChecks;    // Evaluated after the predicted deadline
+    uint32_t checkTimes[1024];
+};
+
+static GeofenceManager* geofences;
+
+void setUp() {
+    Preferences::wipe();
+    nativeMillis = 0;
+    geofences = new GeofenceManager();
+    geofences->begin();
+    geofences->clearGeofences();
+    for (const TraceCircle& circle : traceCircles) {
+        geofences->addCircle(circle.id, circle.lat, circle.lon, circle.radius);
+    }
+    geofences->addPolygon(traceSquareId, traceSquareLat, traceSquareLon, 4);
+}
+
+void tearDown() {
+    delete geofences;
+}
+
+static void replay(Replay& result) {
+    memset(&result, 0, sizeof(result));
+    uint32_t deadline = 0;
+
+    for (size_t i = 0; i < traceFixCount; i++) {
+        const TraceFix& fix = traceFixes[i];
+        nativeMillis = fix.time;
+        geofences->updateMotion(fix.time, GPS_UPDATE_RATE, fix.speed, fix.course, 1.0);
+        result.offered++;
+
+        uint32_t checks = geofences->getCheckCount();
+        GeofenceEvent event;
+        while (geofences->checkGeofences(fix.lat / 1e6, fix.lon / 1e6, event)) {
+            if (result.eventCount < MAX_REPLAY_EVENTS) {
+                result.events[result.eventCount++] = event;
+            }
+        }
+
+        if (geofences->getCheckCount() != checks) {
+            if (deadline != 0 && fix.time > deadline) {
+                result.lateChecks++;
+            }
+            deadline = fix.time + geofences->getNextCheckDelay();
+            if (result.evaluated < sizeof(result.checkTimes) / sizeof(result.checkTimes[0])) {
+                result.checkTimes[result.evaluated] = fix.time;
+            }
+            result.evaluated++;
+        }
+    }
+}
+
+// ===============================================================
+// TESTS
+// ===============================================================
+
+void test_no_transition_missed() {
+    Replay result;
+    replay(result);
+
+    TEST_ASSERT_EQUAL_MESSAGE(traceTransitionCount, result.eventCount, "transitions reported");
+    for (uint8_t i = 0; i < result.eventCount; i++) {
+        TEST_ASSERT_EQUAL_UINT8(traceTransitions[i].id, result.events[i].geofence_id);
+        TEST_ASSERT_EQUAL_UINT8(traceTransitions[i].entered ? 1 : 0, result.events[i].event_type);
+        TEST_ASSERT_UINT32_WITHIN(TIME_TOLERANCE, traceTransitions[i].time, result.events[i].timestamp * 1000);
+    }
+}
+
+void test_check_follows_every_crossing() {
+    // Sweeping could cover for a lax schedule; this does not: near a
+    // boundary the deadline has to fall on the very next fixes
+    Replay result;
+    replay(result);
+
+    for (size_t t = 0; t < traceTransitionCount; t++) {
+        uint32_t next = 0;
+        for (uint32_t c = 0; c < result.evaluated && next == 0; c++) {
+            if (result.checkTimes[c] >= traceTransitions[t].time) {
+                next = result.checkTimes[c];
+            }
+        }
+        TEST_ASSERT_TRUE(next != 0);
+        TEST_ASSERT_LESS_OR_EQUAL(MAX_CHECK_DELAY, next - traceTransitions[t].time);
+    }
+}
+
+void test_checks_saved() {
+    Replay result;
+    replay(result);
+
+    char message[64];
+    snprintf(message, sizeof(message), "%u of %u fixes checked", (unsigned)result.evaluated, (unsigned)result.offered);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_TRUE_MESSAGE(result.evaluated < result.offered * MAX_CHECKED_SHARE, message);
+}
+
+void test_checks_keep_the_deadline() {
+    // The last fix before each deadline is the one checked, never a later one
+    Replay result;
+    replay(result);
+    TEST_ASSERT_EQUAL(0, result.lateChecks);
+}
+
+void test_safe_interval_bounds_worst_case_motion() {
+    // In the interval returned, even flat-out acceleration from the
+    // current speed cannot cover the clearance (unless the floor applies)
+    static const float clearances[] = {1, 5, 20, 50, 100, 300, 1000, 3000};
+    static const float speeds[] = {-1, 0, 3, 10, 25, GEOFENCE_MAX_SPEED, 60};
+
+    for (float clearance : clearances) {
+        for (float speed : speeds) {
+            uint32_t interval = predictSafeInterval(clearance, speed);
+            TEST_ASSERT_TRUE(interval >= GEOFENCE_MIN_CHECK_INTERVAL);
+            TEST_ASSERT_TRUE(interval <= GEOFENCE_MAX_CHECK_INTERVAL);
+            if (interval == GEOFENCE_MIN_CHECK_INTERVAL) {
+                continue;
+            }
+
+            float v = speed < 0 ? GEOFENCE_MAX_SPEED : min(speed, (float)GEOFENCE_MAX_SPEED);
+            float covered = 0;
+            for (uint32_t t = 0; t < interval; t += 10) {
+                covered += v * 0.01;
+                v = min(v + GEOFENCE_MAX_ACCEL * 0.01f, (float)GEOFENCE_MAX_SPEED);
+            }
+            TEST_ASSERT_TRUE(covered <= clearance + 0.5);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_no_transition_missed);
+    RUN_TEST(test_check_follows_every_crossing);
+    RUN_TEST(test_checks_saved);
+    RUN_TEST(test_checks_keep_the_deadline);
+    RUN_TEST(test_safe_interval_bounds_worst_case_motion);
+    return UNITY_END();
+}
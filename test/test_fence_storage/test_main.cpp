@@ -0,0 +1,169 @@
+#include <unity.h>
+#include <Preferences.h>
+#include "geofence_manager.h"
+
+// ===============================================================
+// STORED FENCES (pio test -e native)
+// ===============================================================
+//
+// loadGeofences() against what NVS can hold after an interrupted write
+// or a firmware with another layout: every array must match the counts
+// stored with it, and every fence's ranges lie within them, or the
+// default fence is used instead.
+
+#define POLYGON_ID                  5
+#define CIRCLE_ID                   7
+
+static const int32_t squareLat[] = {-33452000, -33452000, -33451000, -33451000};
+static const int32_t squareLon[] = {-70668000, -70667000, -70667000, -70668000};
+
+static GeofenceManager* geofences;
+
+void setUp() {
+    Preferences::wipe();
+    nativeMillis = 0;
+    geofences = new GeofenceManager();
+    geofences->begin();
+    geofences->clearGeofences();
+    geofences->addCircle(CIRCLE_ID, -33.4489, -70.6693, 100);
+    geofences->addPolygon(POLYGON_ID, squareLat, squareLon, 4);
+}
+
+void tearDown() {
+    delete geofences;
+}
+
+// What the next boot sees
+static void reboot() {
+    delete geofences;
+    geofences = new GeofenceManager();
+    TEST_ASSERT_TRUE(geofences->begin());
+}
+
+static void truncateBlob(const char* key) {
+    Preferences prefs;
+    prefs.begin(STORAGE_NAMESPACE, false);
+    uint8_t bytes[256];
+    size_t length = prefs.getBytes(key, bytes, sizeof(bytes));
+    TEST_ASSERT_TRUE(length > 1);
+    prefs.putBytes(key, bytes, length - 1);
+    prefs.end();
+}
+
+// The stored fences, edited in place
+static void editFences(void (*edit)(Geofence* fences)) {
+    Preferences prefs;
+    prefs.begin(STORAGE_NAMESPACE, false);
+    Geofence stored[2];
+    TEST_ASSERT_EQUAL(sizeof(stored), prefs.getBytes(KEY_GEOFENCES, stored, sizeof(stored)));
+    edit(stored);
+    prefs.putBytes(KEY_GEOFENCES, stored, sizeof(stored));
+    prefs.end();
+}
+
+static Geofence& storedPolygon(Geofence* fences) {
+    return fences[0].type == GEOFENCE_POLYGON ? fences[0] : fences[1];
+}
+
+static void assertDefaultFence() {
+    TEST_ASSERT_EQUAL(1, geofences->getGeofenceCount());
+    TEST_ASSERT_EQUAL(0, geofences->getIndex(0));
+}
+
+// ===============================================================
+// TESTS
+// ===============================================================
+
+void test_stored_set_reloads() {
+    reboot();
+    TEST_ASSERT_EQUAL(2, geofences->getGeofenceCount());
+    TEST_ASSERT_TRUE(geofences->getIndex(CIRCLE_ID) >= 0);
+    TEST_ASSERT_TRUE(geofences->getIndex(POLYGON_ID) >= 0);
+}
+
+void test_short_vertex_arrays_fall_back() {
+    static const char* const keys[] = {"gf_vlat", "gf_vlon"};
+    for (const char* key : keys) {
+        tearDown();
+        setUp();
+        truncateBlob(key);
+        reboot();
+        assertDefaultFence();
+    }
+}
+
+void test_short_schedule_falls_back() {
+    truncateBlob("gf_sched");
+    reboot();
+    assertDefaultFence();
+}
+
+void test_arrays_left_by_removed_polygons_are_ignored() {
+    // No vertices left: nothing is written over the old arrays
+    TEST_ASSERT_TRUE(geofences->removeGeofence(POLYGON_ID));
+    reboot();
+    TEST_ASSERT_EQUAL(1, geofences->getGeofenceCount());
+    TEST_ASSERT_EQUAL(0, geofences->getIndex(CIRCLE_ID));
+}
+
+void test_short_speed_limits_and_profiles_fall_back() {
+    static const char* const keys[] = {"gf_speed", "gf_profile"};
+    for (const char* key : keys) {
+        tearDown();
+        setUp();
+        truncateBlob(key);
+        reboot();
+        assertDefaultFence();
+    }
+}
+
+void test_polygon_ranges_outside_the_arrays_fall_back() {
+    // The blobs all match their counts; only the ranges inside are wrong
+    static void (*const edits[])(Geofence*) = {
+        [](Geofence* fences) { storedPolygon(fences).vertexStart = 1; },
+        [](Geofence* fences) { storedPolygon(fences).vertexCount = 5; },
+        [](Geofence* fences) { storedPolygon(fences).ringStart = 1; },
+        [](Geofence* fences) { storedPolygon(fences).ringCount = 0; },
+        [](Geofence* fences) { storedPolygon(fences).vertexCount = 2; },   // Ring now past the fence's
+        [](Geofence* fences) { fences[0].type = (GeofenceType)7; },
+    };
+    for (auto edit : edits) {
+        tearDown();
+        setUp();
+        editFences(edit);
+        reboot();
+        assertDefaultFence();
+    }
+}
+
+void test_utc_offset_range_and_reload() {
+    uint8_t command[3] = {CMD_SET_UTC_OFFSET, 0x03, 0x49};     // +841
+    TEST_ASSERT_EQUAL(CONFIG_REJECTED, geofences->handleDownlink(command, sizeof(command)));
+    command[1] = 0xFD;                                          // -721
+    command[2] = 0x2F;
+    TEST_ASSERT_EQUAL(CONFIG_REJECTED, geofences->handleDownlink(command, sizeof(command)));
+    TEST_ASSERT_EQUAL(GEOFENCE_UTC_OFFSET_MIN, geofences->getUtcOffset());
+
+    command[2] = 0x30;                                          // -720
+    TEST_ASSERT_EQUAL(CONFIG_APPLIED, geofences->handleDownlink(command, sizeof(command)));
+    reboot();
+    TEST_ASSERT_EQUAL(-720, geofences->getUtcOffset());
+
+    // Kept when the fences are not
+    truncateBlob("gf_vlat");
+    reboot();
+    assertDefaultFence();
+    TEST_ASSERT_EQUAL(-720, geofences->getUtcOffset());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_stored_set_reloads);
+    RUN_TEST(test_short_vertex_arrays_fall_back);
+    RUN_TEST(test_short_schedule_falls_back);
+    RUN_TEST(test_arrays_left_by_removed_polygons_are_ignored);
+    RUN_TEST(test_short_speed_limits_and_profiles_fall_back);
+    RUN_TEST(test_polygon_ranges_outside_the_arrays_fall_back);
+    RUN_TEST(test_utc_offset_range_and_reload);
+    return UNITY_END();
+}
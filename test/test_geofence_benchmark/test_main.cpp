@@ -0,0 +1,199 @@
+#include <unity.h>
+#include <Preferences.h>
+#include <chrono>
+#include "geofence_manager.h"
+
+// ===============================================================
+// QUERY AND EVALUATION COST (pio test -e native)
+// ===============================================================
+//
+// The largest fence set the engine holds (MAX_GEOFENCES, 32 in the
+// native build): circles and polygons scattered over ~10 x 10 km,
+// queried at random points. Nearest-fence answers must match a brute
+// force pass over every fence; the timings are printed for comparison
+// between builds, not asserted, as host speed varies.
+
+#define BENCH_CENTER_LAT            -33448900   // * 1e6
+#define BENCH_CENTER_LON            -70669300
+#define BENCH_SPAN                  90000       // micro-degrees, ~10 km
+#define BENCH_POLYGON_SIDES         12
+#define BENCH_QUERIES               2000
+#define BENCH_FIXES                 2000
+#define BENCH_STEP                  600         // micro-degrees between fixes, ~65 m
+#define DISTANCE_TOLERANCE          0.01        // m
+
+static GeofenceManager* geofences;
+static uint32_t seed;
+
+// Deterministic across hosts
+static uint32_t nextRandom() {
+    seed = seed * 1664525UL + 1013904223UL;
+    return seed >> 8;
+}
+
+static int32_t randomOffset(int32_t span) {
+    return (int32_t)(nextRandom() % (uint32_t)(2 * span + 1)) - span;
+}
+
+static double elapsedUs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void addLargeSet() {
+    for (uint8_t i = 0; i < MAX_GEOFENCES; i++) {
+        int32_t lat = BENCH_CENTER_LAT + randomOffset(BENCH_SPAN / 2);
+        int32_t lon = BENCH_CENTER_LON + randomOffset(BENCH_SPAN / 2);
+        uint32_t radius = 50 + nextRandom() % 450;
+
+        if (i % 2 == 0) {
+            TEST_ASSERT_TRUE(geofences->addCircle(i + 1, lat / 1e6, lon / 1e6, radius));
+            continue;
+        }
+
+        // Irregular polygon around the center, radius within +-30%
+        int32_t lats[BENCH_POLYGON_SIDES];
+        int32_t lons[BENCH_POLYGON_SIDES];
+        for (uint8_t v = 0; v < BENCH_POLYGON_SIDES; v++) {
+            float angle = 2 * PI * v / BENCH_POLYGON_SIDES;
+            float r = radius * (0.7 + (nextRandom() % 600) / 1000.0) / METERS_PER_MICRODEGREE;
+            lats[v] = lat + (int32_t)(r * cos(angle));
+            lons[v] = lon + (int32_t)(r * sin(angle) / cos(lat / 1e6 * DEG_TO_RAD));
+        }
+        TEST_ASSERT_TRUE(geofences->addPolygon(i + 1, lats, lons, BENCH_POLYGON_SIDES));
+    }
+    TEST_ASSERT_EQUAL(MAX_GEOFENCES, geofences->getGeofenceCount());
+}
+
+void setUp() {
+    Preferences::wipe();
+    nativeMillis = 0;
+    seed = 12345;
+    geofences = new GeofenceManager();
+    geofences->begin();
+    geofences->clearGeofences();
+    addLargeSet();
+}
+
+void tearDown() {
+    delete geofences;
+}
+
+// Every fence's distance, the k smallest by magnitude
+static uint8_t bruteForceNearest(double lat, double lon, FenceDistance* results, uint8_t k) {
+    uint8_t found = 0;
+    for (uint8_t i = 0; i < MAX_GEOFENCES; i++) {
+        float d;
+        if (!geofences->getDistanceToBoundary(i + 1, lat, lon, d)) {
+            continue;
+        }
+
+        if (found == k && fabs(d) >= fabs(results[k - 1].distance)) {
+            continue;
+        }
+        uint8_t pos = (found < k) ? found++ : k - 1;
+        while (pos > 0 && fabs(results[pos - 1].distance) > fabs(d)) {
+            results[pos] = results[pos - 1];
+            pos--;
+        }
+        results[pos].id = i + 1;
+        results[pos].distance = d;
+    }
+    return found;
+}
+
+static void randomPoint(double& lat, double& lon) {
+    lat = (BENCH_CENTER_LAT + randomOffset(BENCH_SPAN * 3 / 4)) / 1e6;
+    lon = (BENCH_CENTER_LON + randomOffset(BENCH_SPAN * 3 / 4)) / 1e6;
+}
+
+// ===============================================================
+// TESTS
+// ===============================================================
+
+void test_nearest_matches_brute_force() {
+    static const uint8_t ks[] = {1, 3, 8};
+    for (uint8_t k : ks) {
+        for (uint32_t q = 0; q < BENCH_QUERIES; q++) {
+            double lat, lon;
+            randomPoint(lat, lon);
+
+            FenceDistance fast[8];
+            FenceDistance slow[8];
+            uint8_t found = geofences->findNearest(lat, lon, fast, k);
+            TEST_ASSERT_EQUAL(bruteForceNearest(lat, lon, slow, k), found);
+            for (uint8_t i = 0; i < found; i++) {
+                // Ids can swap on exact ties; the distances cannot
+                TEST_ASSERT_FLOAT_WITHIN(DISTANCE_TOLERANCE, slow[i].distance, fast[i].distance);
+            }
+        }
+    }
+}
+
+void test_nearest_query_cost() {
+    static const uint8_t ks[] = {1, 3};
+    for (uint8_t k : ks) {
+        double lats[BENCH_QUERIES];
+        double lons[BENCH_QUERIES];
+        for (uint32_t q = 0; q < BENCH_QUERIES; q++) {
+            randomPoint(lats[q], lons[q]);
+        }
+
+        FenceDistance results[3];
+        double sink = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t q = 0; q < BENCH_QUERIES; q++) {
+            geofences->findNearest(lats[q], lons[q], results, k);
+            sink += results[0].distance;
+        }
+        double pruned = elapsedUs(start) / BENCH_QUERIES;
+
+        start = std::chrono::steady_clock::now();
+        for (uint32_t q = 0; q < BENCH_QUERIES; q++) {
+            bruteForceNearest(lats[q], lons[q], results, k);
+            sink -= results[0].distance;
+        }
+        double brute = elapsedUs(start) / BENCH_QUERIES;
+
+        char message[96];
+        snprintf(message, sizeof(message), "%d fences, k=%u: %.2f us per query, brute force %.2f us",
+                 MAX_GEOFENCES, k, pruned, brute);
+        TEST_MESSAGE(message);
+        TEST_ASSERT_FLOAT_WITHIN(0.1, 0, sink);
+    }
+}
+
+void test_evaluation_cost() {
+    // A random walk across the set, one check per fix: no motion input,
+    // so the fixed GEOFENCE_CHECK_INTERVAL decides and every call is due
+    double lat = BENCH_CENTER_LAT / 1e6;
+    double lon = BENCH_CENTER_LON / 1e6;
+    uint32_t events = 0;
+    double total = 0;
+
+    for (uint32_t i = 0; i < BENCH_FIXES; i++) {
+        nativeMillis += GEOFENCE_CHECK_INTERVAL;
+        lat += randomOffset(BENCH_STEP) / 1e6;
+        lon += randomOffset(BENCH_STEP) / 1e6;
+
+        GeofenceEvent event;
+        auto start = std::chrono::steady_clock::now();
+        while (geofences->checkGeofences(lat, lon, event)) {
+            events++;
+        }
+        total += elapsedUs(start);
+    }
+    TEST_ASSERT_EQUAL(BENCH_FIXES, geofences->getCheckCount());
+
+    char message[96];
+    snprintf(message, sizeof(message), "%d fences: %.2f us per check, %u events over %u fixes",
+             MAX_GEOFENCES, total / BENCH_FIXES, (unsigned)events, (unsigned)BENCH_FIXES);
+    TEST_MESSAGE(message);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_nearest_matches_brute_force);
+    RUN_TEST(test_nearest_query_cost);
+    RUN_TEST(test_evaluation_cost);
+    return UNITY_END();
+}
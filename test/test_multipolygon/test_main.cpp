@@ -0,0 +1,252 @@
+#include <unity.h>
+#include <Preferences.h>
+#include <chrono>
+#include "geofence_manager.h"
+
+// ===============================================================
+// MULTIPOLYGON FENCES (pio test -e native)
+// ===============================================================
+//
+// Also benchmarks a parcel shaped like survey data: a jagged ~900 x 600 m
+// outline of 260 vertices with two exclusion areas of 70 and 60, and a
+// separate 110-vertex parcel, 500 vertices in all. The single pass over
+// every ring (pointInRings, distanceToRings) must agree with one ring
+// at a time; the timings are printed, not asserted.
+
+#define PARCEL_LAT                  -33451500   // * 1e6
+#define PARCEL_LON                  -70667500
+#define PARCEL_JITTER               20          // micro-degrees, ~2 m
+#define PARCEL_QUERIES              20000
+
+struct ParcelRing {
+    int32_t dLat;           // Center, micro-degrees from the parcel's
+    int32_t dLon;
+    int32_t halfLat;        // Half extent, micro-degrees
+    int32_t halfLon;
+    uint16_t count;
+};
+
+static const ParcelRing parcelRings[] = {
+    {0, 0, 2700, 4900, 260},            // Outline
+    {-900, -2200, 800, 900, 70},        // Exclusion areas
+    {1000, 1800, 600, 1000, 60},
+    {500, 8500, 1500, 1800, 110},       // Second parcel, disjoint
+};
+static const uint8_t parcelRingCount = sizeof(parcelRings) / sizeof(parcelRings[0]);
+
+static GeofenceManager* geofences;
+static uint32_t seed;
+
+// Deterministic across hosts
+static uint32_t nextRandom() {
+    seed = seed * 1664525UL + 1013904223UL;
+    return seed >> 8;
+}
+
+static int32_t randomOffset(int32_t span) {
+    return (int32_t)(nextRandom() % (uint32_t)(2 * span + 1)) - span;
+}
+
+static double elapsedUs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Vertices spread evenly around each rectangle, each nudged by a few meters
+static uint16_t buildParcel(int32_t* lats, int32_t* lons, uint16_t* sizes, PolygonRing* rings) {
+    uint16_t total = 0;
+    for (uint8_t r = 0; r < parcelRingCount; r++) {
+        const ParcelRing& shape = parcelRings[r];
+        float perimeter = 4.0 * (shape.halfLat + shape.halfLon);
+        for (uint16_t v = 0; v < shape.count; v++) {
+            float along = perimeter * v / shape.count;
+            float y, x;
+            if (along < 2 * shape.halfLon) {
+                y = -shape.halfLat;
+                x = -shape.halfLon + along;
+            } else if ((along -= 2 * shape.halfLon) < 2 * shape.halfLat) {
+                y = -shape.halfLat + along;
+                x = shape.halfLon;
+            } else if ((along -= 2 * shape.halfLat) < 2 * shape.halfLon) {
+                y = shape.halfLat;
+                x = shape.halfLon - along;
+            } else {
+                y = shape.halfLat - (along - 2 * shape.halfLon);
+                x = -shape.halfLon;
+            }
+            lats[total + v] = PARCEL_LAT + shape.dLat + (int32_t)y + randomOffset(PARCEL_JITTER);
+            lons[total + v] = PARCEL_LON + shape.dLon + (int32_t)x + randomOffset(PARCEL_JITTER);
+        }
+
+        sizes[r] = shape.count;
+        rings[r].start = total;
+        rings[r].count = shape.count;
+        updateRingBox(rings[r], lats, lons);
+        total += shape.count;
+    }
+    return total;
+}
+
+static bool insideRingByRing(const PolygonRing* rings, const int32_t* lats, const int32_t* lons,
+                             int32_t lat, int32_t lon) {
+    bool inside = false;
+    for (uint8_t r = 0; r < parcelRingCount; r++) {
+        inside ^= pointInRing(&lats[rings[r].start], &lons[rings[r].start], rings[r].count, lat, lon);
+    }
+    return inside;
+}
+
+static float distanceRingByRing(const PolygonRing* rings, const int32_t* lats, const int32_t* lons,
+                                int32_t lat, int32_t lon) {
+    float best = 1e12;
+    for (uint8_t r = 0; r < parcelRingCount; r++) {
+        best = min(best, distanceToRing(&lats[rings[r].start], &lons[rings[r].start], rings[r].count, lat, lon));
+    }
+    return best;
+}
+
+// Over the parcel's box and a margin around it
+static void randomPoint(int32_t& lat, int32_t& lon) {
+    lat = PARCEL_LAT + 500 + randomOffset(3600);
+    lon = PARCEL_LON + 2000 + randomOffset(9000);
+}
+
+void setUp() {
+    Preferences::wipe();
+    nativeMillis = 0;
+    seed = 12345;
+    geofences = new GeofenceManager();
+    geofences->begin();
+    geofences->clearGeofences();
+}
+
+void tearDown() {
+    delete geofences;
+}
+
+// ===============================================================
+// TESTS
+// ===============================================================
+
+void test_ring_sizes_cannot_wrap_the_pool() {
+    // 65535 + 3 is 2 in 16 bits; the sizes alone must be rejected, with
+    // no vertex read
+    static const int32_t lats[3] = {-33452000, -33452000, -33451000};
+    static const int32_t lons[3] = {-70668000, -70667000, -70667000};
+    static const uint16_t wrapping[] = {65535, 3};
+    TEST_ASSERT_FALSE(geofences->addMultiPolygon(1, lats, lons, wrapping, 2));
+
+    static const uint16_t empty[] = {3, 0};
+    TEST_ASSERT_FALSE(geofences->addMultiPolygon(1, lats, lons, empty, 2));
+    TEST_ASSERT_EQUAL(0, geofences->getGeofenceCount());
+    TEST_ASSERT_TRUE(geofences->addMultiPolygon(1, lats, lons, wrapping + 1, 1));
+}
+
+void test_ring_larger_than_what_is_left() {
+    static int32_t lats[MAX_GEOFENCE_VERTICES];
+    static int32_t lons[MAX_GEOFENCE_VERTICES];
+    for (uint16_t i = 0; i < MAX_GEOFENCE_VERTICES; i++) {
+        float angle = 2 * PI * i / MAX_GEOFENCE_VERTICES;
+        lats[i] = -33451500 + (int32_t)(1000 * cos(angle));
+        lons[i] = -70667500 + (int32_t)(1000 * sin(angle));
+    }
+
+    uint16_t first = MAX_GEOFENCE_VERTICES - 10;
+    TEST_ASSERT_TRUE(geofences->addPolygon(1, lats, lons, first));
+    TEST_ASSERT_FALSE(geofences->addPolygon(2, lats, lons, 11));
+    TEST_ASSERT_TRUE(geofences->addPolygon(2, lats, lons, 10));
+    TEST_ASSERT_FALSE(geofences->addPolygon(3, lats, lons, 3));
+}
+
+void test_parcel_single_pass_matches_ring_by_ring() {
+    static int32_t lats[MAX_GEOFENCE_VERTICES];
+    static int32_t lons[MAX_GEOFENCE_VERTICES];
+    uint16_t sizes[parcelRingCount];
+    PolygonRing rings[parcelRingCount];
+    TEST_ASSERT_EQUAL(500, buildParcel(lats, lons, sizes, rings));
+    TEST_ASSERT_TRUE(geofences->addMultiPolygon(1, lats, lons, sizes, parcelRingCount));
+
+    uint32_t inside = 0;
+    uint32_t mismatches = 0;
+    for (uint32_t q = 0; q < PARCEL_QUERIES; q++) {
+        int32_t lat, lon;
+        randomPoint(lat, lon);
+
+        bool expected = insideRingByRing(rings, lats, lons, lat, lon);
+        if (pointInRings(rings, parcelRingCount, lats, lons, lat, lon) != expected) {
+            mismatches++;
+        }
+        inside += expected;
+
+        float edge = distanceRingByRing(rings, lats, lons, lat, lon);
+        TEST_ASSERT_EQUAL_FLOAT(edge, distanceToRings(rings, parcelRingCount, lats, lons, lat, lon));
+
+        // And through the fence itself, sign included; degrees back to
+        // micro-degrees can truncate by one
+        float distance;
+        TEST_ASSERT_TRUE(geofences->getDistanceToBoundary(1, lat / 1e6, lon / 1e6, distance));
+        TEST_ASSERT_FLOAT_WITHIN(2 * METERS_PER_MICRODEGREE, expected ? -edge : edge, distance);
+    }
+
+    TEST_ASSERT_EQUAL(0, mismatches);
+    // Both answers well represented
+    TEST_ASSERT_TRUE(inside > PARCEL_QUERIES / 5 && inside < PARCEL_QUERIES * 4 / 5);
+}
+
+void test_parcel_query_cost() {
+    static int32_t lats[MAX_GEOFENCE_VERTICES];
+    static int32_t lons[MAX_GEOFENCE_VERTICES];
+    uint16_t sizes[parcelRingCount];
+    PolygonRing rings[parcelRingCount];
+    uint16_t total = buildParcel(lats, lons, sizes, rings);
+
+    static int32_t queryLat[PARCEL_QUERIES];
+    static int32_t queryLon[PARCEL_QUERIES];
+    for (uint32_t q = 0; q < PARCEL_QUERIES; q++) {
+        randomPoint(queryLat[q], queryLon[q]);
+    }
+
+    uint32_t single = 0, byRing = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t q = 0; q < PARCEL_QUERIES; q++) {
+        single += pointInRings(rings, parcelRingCount, lats, lons, queryLat[q], queryLon[q]);
+    }
+    double containsSingle = elapsedUs(start) / PARCEL_QUERIES;
+
+    start = std::chrono::steady_clock::now();
+    for (uint32_t q = 0; q < PARCEL_QUERIES; q++) {
+        byRing += insideRingByRing(rings, lats, lons, queryLat[q], queryLon[q]);
+    }
+    double containsByRing = elapsedUs(start) / PARCEL_QUERIES;
+    TEST_ASSERT_EQUAL(byRing, single);
+
+    double sink = 0;
+    start = std::chrono::steady_clock::now();
+    for (uint32_t q = 0; q < PARCEL_QUERIES; q++) {
+        sink += distanceToRings(rings, parcelRingCount, lats, lons, queryLat[q], queryLon[q]);
+    }
+    double distanceSingle = elapsedUs(start) / PARCEL_QUERIES;
+
+    start = std::chrono::steady_clock::now();
+    for (uint32_t q = 0; q < PARCEL_QUERIES; q++) {
+        sink -= distanceRingByRing(rings, lats, lons, queryLat[q], queryLon[q]);
+    }
+    double distanceByRing = elapsedUs(start) / PARCEL_QUERIES;
+    TEST_ASSERT_FLOAT_WITHIN(0.1, 0, sink);
+
+    char message[96];
+    snprintf(message, sizeof(message), "%u vertices, %u rings: inside %.2f us per point, ring by ring %.2f us",
+             (unsigned)total, (unsigned)parcelRingCount, containsSingle, containsByRing);
+    TEST_MESSAGE(message);
+    snprintf(message, sizeof(message), "distance %.2f us per point, ring by ring %.2f us",
+             distanceSingle, distanceByRing);
+    TEST_MESSAGE(message);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_ring_sizes_cannot_wrap_the_pool);
+    RUN_TEST(test_ring_larger_than_what_is_left);
+    RUN_TEST(test_parcel_single_pass_matches_ring_by_ring);
+    RUN_TEST(test_parcel_query_cost);
+    return UNITY_END();
+}
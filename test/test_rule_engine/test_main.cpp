@@ -0,0 +1,309 @@
+#include <unity.h>
+#include <Preferences.h>
+#include <chrono>
+#include "rule_engine.h"
+
+// ===============================================================
+// RULE ENGINE (pio test -e native)
+// ===============================================================
+//
+// The verifier is all that stands between a downlink and the
+// interpreter, so every malformed program must be refused. Accepted
+// rules are run against fence membership, speed and local time, only
+// when an input they read changes; the cost per rule is printed, not
+// asserted.
+
+#define YARD_ID                     3
+#define DEPOT_A_ID                  1
+#define DEPOT_B_ID                  2
+#define MIDNIGHT_UTC                1759968000UL    // 2025-10-09 00:00:00
+#define BENCH_PASSES                20000
+
+// "inside Yard A and speed > 15 km/h"
+static const uint8_t yardSpeeding[] = {OP_INSIDE, YARD_ID, OP_SPEED_ABOVE, 15, OP_AND, OP_END};
+
+// "outside all depots between 22:00 and 06:00"
+static const uint8_t nightOutside[] = {OP_INSIDE_ANY, 2, DEPOT_A_ID, DEPOT_B_ID, OP_NOT,
+                                       OP_TIME_IN, 88, 24, OP_AND, OP_END};
+
+static GeofenceManager* geofences;
+static RuleEngine* rules;
+
+void setUp() {
+    Preferences::wipe();
+    nativeMillis = 1;
+    geofences = new GeofenceManager();
+    geofences->begin();
+    geofences->clearGeofences();
+    geofences->setUtcOffset(0);
+    TEST_ASSERT_TRUE(geofences->addCircle(YARD_ID, -33.4489, -70.6650, 50));
+    TEST_ASSERT_TRUE(geofences->addCircle(DEPOT_A_ID, -33.46, -70.60, 200));
+    TEST_ASSERT_TRUE(geofences->addCircle(DEPOT_B_ID, -33.47, -70.61, 200));
+
+    rules = new RuleEngine();
+    rules->begin();
+    rules->clearRules();
+}
+
+void tearDown() {
+    delete rules;
+    delete geofences;
+}
+
+// A due check at a point, fence transitions drained
+static void moveTo(double lat, double lon) {
+    nativeMillis += GEOFENCE_CHECK_INTERVAL;
+    GeofenceEvent event;
+    while (geofences->checkGeofences(lat, lon, event)) {
+    }
+}
+
+// Rule transitions of one pass; returns how many, the last in `event`
+static uint8_t evaluate(float kmh, RuleEvent& event) {
+    uint8_t events = 0;
+    RuleEvent next;
+    while (rules->evaluate(*geofences, kmh / 3.6, 0, 0, next)) {
+        event = next;
+        events++;
+    }
+    return events;
+}
+
+// ===============================================================
+// TESTS
+// ===============================================================
+
+void test_verifier_rejects_malformed_programs() {
+    static const uint8_t missingEnd[] = {OP_INSIDE, 1};
+    static const uint8_t trailing[] = {OP_INSIDE, 1, OP_END, OP_END};
+    static const uint8_t truncatedOperand[] = {OP_SPEED_ABOVE};
+    static const uint8_t emptyAny[] = {OP_INSIDE_ANY, 0, OP_END};
+    static const uint8_t anyPastEnd[] = {OP_INSIDE_ANY, 5, 1, 2, OP_END};
+    static const uint8_t slotPastDay[] = {OP_TIME_IN, SCHEDULE_SLOTS_PER_DAY, 0, OP_END};
+    static const uint8_t underflowNot[] = {OP_NOT, OP_END};
+    static const uint8_t underflowAnd[] = {OP_INSIDE, 1, OP_AND, OP_END};
+    static const uint8_t twoResults[] = {OP_INSIDE, 1, OP_INSIDE, 2, OP_END};
+    static const uint8_t noResult[] = {OP_END};
+    static const uint8_t unknownOp[] = {OP_INSIDE, 1, 0x7F, OP_END};
+
+    struct Case { const uint8_t* program; uint8_t length; };
+    static const Case cases[] = {
+        {missingEnd, sizeof(missingEnd)}, {trailing, sizeof(trailing)},
+        {truncatedOperand, sizeof(truncatedOperand)}, {emptyAny, sizeof(emptyAny)},
+        {anyPastEnd, sizeof(anyPastEnd)}, {slotPastDay, sizeof(slotPastDay)},
+        {underflowNot, sizeof(underflowNot)}, {underflowAnd, sizeof(underflowAnd)},
+        {twoResults, sizeof(twoResults)}, {noResult, sizeof(noResult)},
+        {unknownOp, sizeof(unknownOp)},
+    };
+    for (const Case& c : cases) {
+        TEST_ASSERT_FALSE(rules->addRule(1, c.program, c.length));
+    }
+
+    // One push past the stack
+    uint8_t deep[2 * (RULE_STACK_DEPTH + 1) + RULE_STACK_DEPTH + 1];
+    uint8_t length = 0;
+    for (uint8_t i = 0; i <= RULE_STACK_DEPTH; i++) {
+        deep[length++] = OP_INSIDE;
+        deep[length++] = 1;
+    }
+    for (uint8_t i = 0; i < RULE_STACK_DEPTH; i++) {
+        deep[length++] = OP_OR;
+    }
+    deep[length++] = OP_END;
+    TEST_ASSERT_FALSE(rules->addRule(1, deep, length));
+
+    // One push fewer fits
+    memmove(deep, deep + 2, length - 3);
+    length -= 3;
+    deep[length - 1] = OP_END;
+    TEST_ASSERT_TRUE(rules->addRule(1, deep, length));
+    TEST_ASSERT_EQUAL(1, rules->getRuleCount());
+}
+
+void test_downlink_commands() {
+    uint8_t set[3 + sizeof(yardSpeeding)] = {CMD_SET_RULE, 7, sizeof(yardSpeeding)};
+    memcpy(set + 3, yardSpeeding, sizeof(yardSpeeding));
+    TEST_ASSERT_EQUAL(CONFIG_REJECTED, rules->handleDownlink(set, sizeof(set) - 1));   // Short
+    TEST_ASSERT_EQUAL(CONFIG_APPLIED, rules->handleDownlink(set, sizeof(set)));
+
+    set[3] = 0x7F;
+    TEST_ASSERT_EQUAL(CONFIG_REJECTED, rules->handleDownlink(set, sizeof(set)));
+    TEST_ASSERT_EQUAL(1, rules->getRuleCount());
+
+    uint8_t remove[] = {CMD_DELETE_RULE, 8};
+    TEST_ASSERT_EQUAL(CONFIG_REJECTED, rules->handleDownlink(remove, sizeof(remove)));
+    remove[1] = 7;
+    TEST_ASSERT_EQUAL(CONFIG_APPLIED, rules->handleDownlink(remove, sizeof(remove)));
+    TEST_ASSERT_EQUAL(0, rules->getRuleCount());
+
+    const uint8_t other[] = {CMD_SET_PROFILE};
+    TEST_ASSERT_EQUAL(CONFIG_UNKNOWN, rules->handleDownlink(other, sizeof(other)));
+}
+
+void test_replaced_rule_kept_until_the_new_one_fits() {
+    // OP_INSIDE_ANY with n fences is n + 3 bytes
+    static uint8_t program[MAX_RULE_CODE];
+    auto anyOf = [](uint8_t n) -> uint8_t {
+        program[0] = OP_INSIDE_ANY;
+        program[1] = n;
+        memset(program + 2, YARD_ID, n);
+        program[n + 2] = OP_END;
+        return n + 3;
+    };
+
+    TEST_ASSERT_TRUE(rules->addRule(1, program, anyOf(200)));
+    TEST_ASSERT_TRUE(rules->addRule(2, program, anyOf(40)));
+    TEST_ASSERT_FALSE(rules->addRule(1, program, anyOf(MAX_RULE_CODE - 43 - 2)));  // One byte over
+    TEST_ASSERT_EQUAL(2, rules->getRuleCount());
+    TEST_ASSERT_TRUE(rules->addRule(1, program, anyOf(MAX_RULE_CODE - 43 - 3)));
+
+    rules->clearRules();
+    for (uint8_t id = 1; id <= MAX_RULES; id++) {
+        TEST_ASSERT_TRUE(rules->addRule(id, program, anyOf(1)));
+    }
+    TEST_ASSERT_FALSE(rules->addRule(MAX_RULES + 1, program, anyOf(1)));
+    TEST_ASSERT_TRUE(rules->addRule(MAX_RULES, program, anyOf(2)));
+    TEST_ASSERT_EQUAL(MAX_RULES, rules->getRuleCount());
+}
+
+void test_rules_survive_a_reboot() {
+    TEST_ASSERT_TRUE(rules->addRule(4, yardSpeeding, sizeof(yardSpeeding)));
+    delete rules;
+    rules = new RuleEngine();
+    rules->begin();
+    TEST_ASSERT_EQUAL(1, rules->getRuleCount());
+
+    // Running again, first result silent
+    moveTo(-33.4489, -70.6650);
+    RuleEvent event;
+    TEST_ASSERT_EQUAL(0, evaluate(30, event));
+    TEST_ASSERT_TRUE(rules->isActive(4));
+}
+
+void test_inside_and_speeding() {
+    TEST_ASSERT_TRUE(rules->addRule(4, yardSpeeding, sizeof(yardSpeeding)));
+    RuleEvent event;
+
+    // Outside, fast: false, and the first result is silent
+    moveTo(-33.4489, -70.6700);
+    TEST_ASSERT_EQUAL(0, evaluate(30, event));
+    TEST_ASSERT_FALSE(rules->isActive(4));
+
+    moveTo(-33.4489, -70.6650);
+    TEST_ASSERT_EQUAL(1, evaluate(30, event));
+    TEST_ASSERT_EQUAL(4, event.rule_id);
+    TEST_ASSERT_EQUAL(1, event.event_type);
+
+    TEST_ASSERT_EQUAL(1, evaluate(10, event));
+    TEST_ASSERT_EQUAL(0, event.event_type);
+    TEST_ASSERT_EQUAL(0, evaluate(15, event));      // Strictly above
+    TEST_ASSERT_EQUAL(1, evaluate(16, event));
+    TEST_ASSERT_EQUAL(1, event.event_type);
+
+    // No speed yet reads as unknown, not slow
+    TEST_ASSERT_EQUAL(0, rules->evaluate(*geofences, -1, 0, 0, event));
+    TEST_ASSERT_TRUE(rules->isActive(4));
+}
+
+void test_outside_depots_at_night() {
+    TEST_ASSERT_TRUE(rules->addRule(9, nightOutside, sizeof(nightOutside)));
+    RuleEvent event;
+
+    // No clock, no result
+    moveTo(-33.4489, -70.6700);
+    TEST_ASSERT_EQUAL(0, evaluate(0, event));
+    TEST_ASSERT_FALSE(rules->isActive(9));
+
+    // 21:59 local, then 22:00; the window wraps past midnight to 06:00
+    geofences->syncClock(MIDNIGHT_UTC + 22 * 3600 - 60);
+    TEST_ASSERT_EQUAL(0, evaluate(0, event));
+    nativeMillis += 60000;
+    TEST_ASSERT_EQUAL(1, evaluate(0, event));
+    TEST_ASSERT_EQUAL(1, event.event_type);
+
+    // Into a depot
+    moveTo(-33.46, -70.60);
+    TEST_ASSERT_EQUAL(1, evaluate(0, event));
+    TEST_ASSERT_EQUAL(0, event.event_type);
+
+    // Out again after midnight, and the window closes at 06:00
+    moveTo(-33.4489, -70.6700);
+    geofences->syncClock(MIDNIGHT_UTC + 24 * 3600 + 5 * 3600);
+    TEST_ASSERT_EQUAL(1, evaluate(0, event));
+    TEST_ASSERT_EQUAL(1, event.event_type);
+    geofences->syncClock(MIDNIGHT_UTC + 24 * 3600 + 6 * 3600);
+    TEST_ASSERT_EQUAL(1, evaluate(0, event));
+    TEST_ASSERT_EQUAL(0, event.event_type);
+}
+
+void test_only_rules_with_changed_inputs_run() {
+    static const uint8_t yard[] = {OP_INSIDE, YARD_ID, OP_END};
+    static const uint8_t fast[] = {OP_SPEED_ABOVE, 50, OP_END};
+    TEST_ASSERT_TRUE(rules->addRule(1, yard, sizeof(yard)));
+    TEST_ASSERT_TRUE(rules->addRule(2, fast, sizeof(fast)));
+    TEST_ASSERT_TRUE(rules->addRule(3, yardSpeeding, sizeof(yardSpeeding)));
+    RuleEvent event;
+
+    moveTo(-33.4489, -70.6700);
+    evaluate(10, event);
+    uint32_t runs = rules->getEvaluationCount();
+    TEST_ASSERT_EQUAL(3, runs);
+
+    // Same inputs, and a speed change that crosses no threshold
+    evaluate(10, event);
+    evaluate(12, event);
+    TEST_ASSERT_EQUAL(runs, rules->getEvaluationCount());
+
+    // Past 15 km/h: only the rule reading it
+    evaluate(20, event);
+    TEST_ASSERT_EQUAL(runs + 1, rules->getEvaluationCount());
+
+    // Into the yard: the two reading it
+    moveTo(-33.4489, -70.6650);
+    evaluate(20, event);
+    TEST_ASSERT_EQUAL(runs + 3, rules->getEvaluationCount());
+
+    // A fence change relinks and re-runs everything once
+    TEST_ASSERT_TRUE(geofences->removeGeofence(DEPOT_B_ID));
+    evaluate(20, event);
+    TEST_ASSERT_EQUAL(runs + 6, rules->getEvaluationCount());
+}
+
+void test_evaluation_cost_per_rule() {
+    // Every rule reads the speed, which crosses its threshold each pass
+    uint8_t program[] = {OP_INSIDE_ANY, 2, DEPOT_A_ID, DEPOT_B_ID, OP_NOT, OP_SPEED_ABOVE, 15, OP_AND,
+                         OP_INSIDE, YARD_ID, OP_OR, OP_END};
+    for (uint8_t id = 1; id <= MAX_RULES; id++) {
+        TEST_ASSERT_TRUE(rules->addRule(id, program, sizeof(program)));
+    }
+
+    moveTo(-33.4489, -70.6700);
+    RuleEvent event;
+    evaluate(10, event);
+    uint32_t runs = rules->getEvaluationCount();
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t pass = 0; pass < BENCH_PASSES; pass++) {
+        evaluate((pass & 1) ? 10 : 20, event);
+    }
+    double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    runs = rules->getEvaluationCount() - runs;
+    TEST_ASSERT_EQUAL(BENCH_PASSES * MAX_RULES, runs);
+
+    char message[64];
+    snprintf(message, sizeof(message), "%d rules: %.1f ns per rule run", MAX_RULES, elapsed / runs);
+    TEST_MESSAGE(message);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_verifier_rejects_malformed_programs);
+    RUN_TEST(test_downlink_commands);
+    RUN_TEST(test_replaced_rule_kept_until_the_new_one_fits);
+    RUN_TEST(test_rules_survive_a_reboot);
+    RUN_TEST(test_inside_and_speeding);
+    RUN_TEST(test_outside_depots_at_night);
+    RUN_TEST(test_only_rules_with_changed_inputs_run);
+    RUN_TEST(test_evaluation_cost_per_rule);
+    return UNITY_END();
+}
@@ -0,0 +1,187 @@
+#include <unity.h>
+#include <Preferences.h>
+#include "geofence_manager.h"
+#include "../traces/drive_trace.h"
+
+// ===============================================================
+// SWEPT-SEGMENT CROSSINGS (pio test -e native)
+// ===============================================================
+//
+// Replays the recorded drive (tools/geofence_trace.py) at 1 Hz and
+// thinned out to one fix every few seconds, and checks the ENTER/EXIT
+// events against the transitions of the 10 Hz path: same fences, same
+// order, interpolated positions on the boundary. Interpolated times
+// assume constant speed between fixes, so where the drive brakes or
+// accelerates they are off by up to half the fix spacing.
+
+#define MAX_REPLAY_EVENTS           32
+#define TIME_TOLERANCE              1500    // ms, plus half the fix spacing
+#define POSITION_TOLERANCE          3.0     // m off the boundary, hysteresis included
+
+struct Replay {
+    GeofenceEvent events[MAX_REPLAY_EVENTS];
+    uint8_t eventCount;
+    uint32_t stride;        // s between fixes
+    uint32_t lastFix;       // ms, the last fix replayed
+    uint32_t evaluated;     // Fixes the schedule checked
+    uint32_t longestGap;    // ms between evaluated fixes
+};
+
+static GeofenceManager* geofences;
+
+void setUp() {
+    Preferences::wipe();
+    nativeMillis = 0;
+    geofences = new GeofenceManager();
+    geofences->begin();
+    geofences->clearGeofences();
+    for (const TraceCircle& circle : traceCircles) {
+        geofences->addCircle(circle.id, circle.lat, circle.lon, circle.radius);
+    }
+    geofences->addPolygon(traceSquareId, traceSquareLat, traceSquareLon, 4);
+}
+
+void tearDown() {
+    delete geofences;
+}
+
+// Every `stride`-th fix, spaced as the GNSS would deliver them
+static void replay(size_t stride, Replay& result) {
+    memset(&result, 0, sizeof(result));
+    result.stride = stride;
+    uint32_t lastEvaluated = 0;
+
+    for (size_t i = 0; i < traceFixCount; i += stride) {
+        const TraceFix& fix = traceFixes[i];
+        nativeMillis = fix.time;
+        result.lastFix = fix.time;
+        geofences->updateMotion(fix.time, stride * 1000, fix.speed, fix.course, 1.0);
+
+        uint32_t checks = geofences->getCheckCount();
+        GeofenceEvent event;
+        while (geofences->checkGeofences(fix.lat / 1e6, fix.lon / 1e6, event)) {
+            if (result.eventCount < MAX_REPLAY_EVENTS) {
+                result.events[result.eventCount++] = event;
+            }
+        }
+
+        if (geofences->getCheckCount() != checks) {
+            if (lastEvaluated != 0) {
+                result.longestGap = max(result.longestGap, fix.time - lastEvaluated);
+            }
+            lastEvaluated = fix.time;
+            result.evaluated++;
+        }
+    }
+}
+
+static float distanceFromCircle(const TraceCircle& circle, int32_t lat, int32_t lon) {
+    float dy = (lat - circle.lat * 1e6) * METERS_PER_MICRODEGREE;
+    float dx = (lon - circle.lon * 1e6) * METERS_PER_MICRODEGREE * cos(circle.lat * DEG_TO_RAD);
+    return fabs(sqrt(dx * dx + dy * dy) - circle.radius);
+}
+
+static float distanceFromBoundary(uint8_t id, int32_t lat, int32_t lon) {
+    for (const TraceCircle& circle : traceCircles) {
+        if (circle.id == id) {
+            return distanceFromCircle(circle, lat, lon);
+        }
+    }
+    return distanceToRing(traceSquareLat, traceSquareLon, 4, lat, lon);
+}
+
+static void checkAgainstTruth(const Replay& result) {
+    // Transitions up to the last fix replayed
+    uint8_t expected = 0;
+    while (expected < traceTransitionCount && traceTransitions[expected].time <= result.lastFix) {
+        expected++;
+    }
+    TEST_ASSERT_EQUAL_MESSAGE(expected, result.eventCount, "transitions reported");
+
+    for (uint8_t i = 0; i < result.eventCount; i++) {
+        const GeofenceEvent& event = result.events[i];
+        const TraceTransition& truth = traceTransitions[i];
+        TEST_ASSERT_EQUAL_UINT8(truth.id, event.geofence_id);
+        TEST_ASSERT_EQUAL_UINT8(truth.entered ? 1 : 0, event.event_type);
+
+        // No synchronized clock: timestamps are millis() / 1000
+        TEST_ASSERT_UINT32_WITHIN(TIME_TOLERANCE + result.stride * 500, truth.time, event.timestamp * 1000);
+        TEST_ASSERT_FLOAT_WITHIN(POSITION_TOLERANCE, 0, distanceFromBoundary(event.geofence_id, event.latitude, event.longitude));
+    }
+}
+
+// ===============================================================
+// TESTS
+// ===============================================================
+
+void test_dense_replay_matches_truth() {
+    Replay result;
+    replay(1, result);
+    checkAgainstTruth(result);
+}
+
+void test_sparse_replay_matches_truth() {
+    static const size_t strides[] = {5, 10, 20, 30};
+    for (size_t stride : strides) {
+        // A fresh engine for each spacing
+        tearDown();
+        setUp();
+        Replay result;
+        replay(stride, result);
+        checkAgainstTruth(result);
+    }
+}
+
+void test_small_fence_passed_between_fixes() {
+    // At 10 s spacing no fix lands inside the 30 m circle
+    const TraceCircle& small = traceCircles[1];
+    TEST_ASSERT_EQUAL(30, small.radius);
+    for (size_t i = 0; i < traceFixCount; i += 10) {
+        float dy = (traceFixes[i].lat - small.lat * 1e6) * METERS_PER_MICRODEGREE;
+        float dx = (traceFixes[i].lon - small.lon * 1e6) * METERS_PER_MICRODEGREE * cos(small.lat * DEG_TO_RAD);
+        TEST_ASSERT_TRUE(sqrt(dx * dx + dy * dy) > small.radius);
+    }
+
+    Replay result;
+    replay(10, result);
+
+    uint8_t reported = 0;
+    for (uint8_t i = 0; i < result.eventCount; i++) {
+        if (result.events[i].geofence_id == small.id) {
+            reported++;
+        }
+    }
+    TEST_ASSERT_EQUAL(2, reported);
+}
+
+void test_sparse_fixes_are_all_evaluated() {
+    // 30 s apart, every fix is already later than the predicted safe
+    // interval allows: none is skipped, so each segment gets swept
+    Replay result;
+    replay(30, result);
+    TEST_ASSERT_EQUAL((traceFixCount + 29) / 30, result.evaluated);
+    TEST_ASSERT_EQUAL(30000, result.longestGap);
+}
+
+void test_long_gap_is_not_swept() {
+    // Longer than GEOFENCE_MAX_SEGMENT_TIME the path may not be straight:
+    // only the endpoints count, and the fences passed in between are not
+    // reported
+    size_t stride = GEOFENCE_MAX_SEGMENT_TIME / 1000 + 100;
+    Replay result;
+    replay(stride, result);
+
+    for (uint8_t i = 0; i < result.eventCount; i++) {
+        TEST_ASSERT_TRUE(result.events[i].geofence_id != traceCircles[1].id);
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_dense_replay_matches_truth);
+    RUN_TEST(test_sparse_replay_matches_truth);
+    RUN_TEST(test_small_fence_passed_between_fixes);
+    RUN_TEST(test_sparse_fixes_are_all_evaluated);
+    RUN_TEST(test_long_gap_is_not_swept);
+    return UNITY_END();
+}
@@ -0,0 +1,332 @@
+#include <unity.h>
+#include <LittleFS.h>
+#include <vector>
+#include "tile_store.h"
+#include "geofence_manager.h"
+
+// ===============================================================
+// TILE STORE (pio test -e native)
+// ===============================================================
+//
+// Tiles written to the in-memory LittleFS, read through the cache with
+// the heap slot count (no PSRAM on the host). The loader task runs when
+// the test says so (nativeRunTasks), standing in for the time between
+// two fixes; a fix that finds its tile missing has waited on flash.
+
+#define HOME_LAT                    -33450000   // * 1e6, middle of a tile
+#define HOME_LON                    -70650000
+#define TILE_STEP                   TILE_SIZE_MICRODEG
+#define DRIVE_SPEED                 30.0        // m/s
+#define DRIVE_FIXES                 2400        // 1 Hz, ~72 km east
+
+// Fences of one tile, in file order
+struct TileContents {
+    std::vector<TileFence> fences;
+    std::vector<PolygonRing> rings;
+    std::vector<int32_t> lats;
+    std::vector<int32_t> lons;
+};
+
+static TileStore* store;
+
+static void addCircle(TileContents& tile, uint16_t id, int32_t lat, int32_t lon, uint32_t radius) {
+    TileFence fence = {};
+    fence.id = id;
+    fence.type = GEOFENCE_CIRCLE;
+    int32_t half = (int32_t)(radius / METERS_PER_MICRODEGREE) * 2;  // Generous at this latitude
+    fence.minLat = lat - half;
+    fence.maxLat = lat + half;
+    fence.minLon = lon - half;
+    fence.maxLon = lon + half;
+    fence.centerLat = lat;
+    fence.centerLon = lon;
+    fence.radius = radius;
+    tile.fences.push_back(fence);
+}
+
+static void addSquare(TileContents& tile, uint16_t id, int32_t lat, int32_t lon, int32_t half) {
+    PolygonRing ring = {};
+    ring.start = tile.lats.size();
+    ring.count = 4;
+    static const int8_t corners[4][2] = {{-1, -1}, {-1, 1}, {1, 1}, {1, -1}};
+    for (auto& corner : corners) {
+        tile.lats.push_back(lat + corner[0] * half);
+        tile.lons.push_back(lon + corner[1] * half);
+    }
+
+    TileFence fence = {};
+    fence.id = id;
+    fence.type = GEOFENCE_POLYGON;
+    fence.minLat = ring.minLat = lat - half;
+    fence.maxLat = ring.maxLat = lat + half;
+    fence.minLon = ring.minLon = lon - half;
+    fence.maxLon = ring.maxLon = lon + half;
+    fence.ringStart = tile.rings.size();
+    fence.ringCount = 1;
+    tile.rings.push_back(ring);
+    tile.fences.push_back(fence);
+}
+
+static void writeFile(uint32_t key, const uint8_t* bytes, size_t length) {
+    char path[32];
+    tilePathFor(key, path, sizeof(path));
+    File file = LittleFS.open(path, "w");
+    TEST_ASSERT_TRUE((bool)file);
+    TEST_ASSERT_EQUAL(length, file.write(bytes, length));
+    file.close();
+}
+
+static void writeTile(uint32_t key, const TileContents& tile) {
+    TileHeader header = {TILE_MAGIC, (uint16_t)tile.fences.size(), (uint16_t)tile.rings.size(),
+                         (uint16_t)tile.lats.size(), 0};
+    std::vector<uint8_t> bytes;
+    auto append = [&bytes](const void* data, size_t length) {
+        bytes.insert(bytes.end(), (const uint8_t*)data, (const uint8_t*)data + length);
+    };
+    append(&header, sizeof(header));
+    append(tile.fences.data(), tile.fences.size() * sizeof(TileFence));
+    append(tile.rings.data(), tile.rings.size() * sizeof(PolygonRing));
+    append(tile.lats.data(), tile.lats.size() * sizeof(int32_t));
+    append(tile.lons.data(), tile.lons.size() * sizeof(int32_t));
+    writeFile(key, bytes.data(), bytes.size());
+}
+
+// One circle in the middle of each tile, so every tile has a file
+static void writeCircleTile(uint32_t key, uint16_t id) {
+    TileContents tile;
+    int32_t lat = TILE_ROW_ORIGIN + (int32_t)(key >> 16) * TILE_STEP + TILE_STEP / 2;
+    int32_t lon = TILE_COL_ORIGIN + (int32_t)(key & 0xFFFF) * TILE_STEP + TILE_STEP / 2;
+    addCircle(tile, id, lat, lon, 200);
+    writeTile(key, tile);
+}
+
+static float evaluateAt(int32_t lat, int32_t lon) {
+    float clearance;
+    store->evaluate(lat, lon, nativeMillis / 1000, clearance);
+    return clearance;
+}
+
+void setUp() {
+    LittleFS.wipe();
+    LittleFS.mountable = true;
+    LittleFS.mkdir(TILE_DIR);
+    nativeMillis = 1000;
+    store = new TileStore();
+}
+
+void tearDown() {
+    delete store;
+}
+
+// ===============================================================
+// TESTS
+// ===============================================================
+
+void test_store_off_without_a_tile_directory() {
+    LittleFS.wipe();
+    TEST_ASSERT_FALSE(store->begin());
+
+    LittleFS.mountable = true;
+    TEST_ASSERT_FALSE(store->begin());
+    float clearance;
+    TEST_ASSERT_FALSE(store->evaluate(HOME_LAT, HOME_LON, 0, clearance));
+}
+
+void test_membership_and_transitions() {
+    TileContents tile;
+    addCircle(tile, 100, HOME_LAT, HOME_LON, 100);
+    addSquare(tile, 200, HOME_LAT, HOME_LON + 5000, 1000);
+    writeTile(tileKeyFor(HOME_LAT, HOME_LON), tile);
+    TEST_ASSERT_TRUE(store->begin());
+
+    // The first fix sets the state silently
+    float clearance = evaluateAt(HOME_LAT, HOME_LON);
+    TEST_ASSERT_TRUE(store->isInside(100));
+    TEST_ASSERT_FLOAT_WITHIN(1.0, 100, clearance);
+    TileEvent event;
+    TEST_ASSERT_FALSE(store->getEvent(event));
+
+    // Into the square: one exit, one entry
+    clearance = evaluateAt(HOME_LAT, HOME_LON + 5000);
+    float cosLat = cos(HOME_LAT / 1e6 * DEG_TO_RAD);
+    TEST_ASSERT_FLOAT_WITHIN(1.0, 1000 * METERS_PER_MICRODEGREE * cosLat, clearance);   // East and west sides
+    TEST_ASSERT_TRUE(store->getEvent(event));
+    TEST_ASSERT_EQUAL(100, event.fence_id);
+    TEST_ASSERT_EQUAL(0, event.event_type);
+    TEST_ASSERT_TRUE(store->getEvent(event));
+    TEST_ASSERT_EQUAL(200, event.fence_id);
+    TEST_ASSERT_EQUAL(1, event.event_type);
+    TEST_ASSERT_FALSE(store->getEvent(event));
+
+    // Away from both: the tile edge bounds the clearance
+    clearance = evaluateAt(HOME_LAT + 40000, HOME_LON);
+    TEST_ASSERT_FALSE(store->isInside(200));
+    TEST_ASSERT_FLOAT_WITHIN(1.0, 10000 * METERS_PER_MICRODEGREE, clearance);
+}
+
+void test_fence_across_a_tile_edge_keeps_one_id() {
+    // The same fence in both tiles it overlaps
+    int32_t edgeLon = HOME_LON + TILE_STEP / 2;
+    TileContents tile;
+    addSquare(tile, 300, HOME_LAT, edgeLon, 2000);
+    writeTile(tileKeyFor(HOME_LAT, HOME_LON), tile);
+    writeTile(tileKeyFor(HOME_LAT, HOME_LON + TILE_STEP), tile);
+    TEST_ASSERT_TRUE(store->begin());
+
+    evaluateAt(HOME_LAT, edgeLon - 1000);
+    evaluateAt(HOME_LAT, edgeLon + 1000);
+    TEST_ASSERT_TRUE(store->isInside(300));
+    TileEvent event;
+    TEST_ASSERT_FALSE(store->getEvent(event));
+}
+
+void test_lru_keeps_recent_tiles() {
+    uint32_t keys[4];
+    for (uint8_t i = 0; i < 4; i++) {
+        keys[i] = tileKeyFor(HOME_LAT, HOME_LON + i * TILE_STEP);
+        writeCircleTile(keys[i], 10 + i);
+    }
+    TEST_ASSERT_TRUE(store->begin());
+    TEST_ASSERT_EQUAL(3, TILE_CACHE_SLOTS_NO_PSRAM);
+
+    // A B C fill the slots, A is then a hit, D replaces B (least recent),
+    // and B is read again
+    static const uint8_t visits[] = {0, 1, 2, 0, 3, 1};
+    static const bool hits[] = {false, false, false, true, false, false};
+    uint32_t expectedLoads = 0;
+    for (uint8_t v = 0; v < sizeof(visits); v++) {
+        evaluateAt(HOME_LAT, HOME_LON + visits[v] * TILE_STEP);
+        expectedLoads += !hits[v];
+        TEST_ASSERT_EQUAL(expectedLoads, store->getDemandLoads());
+    }
+
+    // Cells without a file are cached as empty, not reopened each fix
+    evaluateAt(HOME_LAT - TILE_STEP, HOME_LON);
+    evaluateAt(HOME_LAT - TILE_STEP, HOME_LON);
+    TEST_ASSERT_EQUAL(expectedLoads + 1, store->getDemandLoads());
+}
+
+void test_prefetch_never_evicts_the_current_tile() {
+    uint32_t keys[4];
+    for (uint8_t i = 0; i < 4; i++) {
+        keys[i] = tileKeyFor(HOME_LAT, HOME_LON + i * TILE_STEP);
+        writeCircleTile(keys[i], 10 + i);
+    }
+    TEST_ASSERT_TRUE(store->begin());
+    evaluateAt(HOME_LAT, HOME_LON);
+
+    // Three tiles ahead for two free slots; the current one is the least
+    // recently used but stays
+    for (uint8_t i = 1; i < 4; i++) {
+        store->prefetch(HOME_LAT, HOME_LON + i * TILE_STEP, 0, -1);
+        nativeRunTasks();
+    }
+    evaluateAt(HOME_LAT, HOME_LON);
+    TEST_ASSERT_EQUAL(1, store->getDemandLoads());
+
+    // The newest prefetch is there too
+    evaluateAt(HOME_LAT, HOME_LON + 3 * TILE_STEP);
+    TEST_ASSERT_EQUAL(1, store->getDemandLoads());
+}
+
+void test_prefetch_along_the_track_hides_flash_reads() {
+    for (uint8_t row = 0; row < 3; row++) {
+        for (uint8_t col = 0; col < 10; col++) {
+            uint32_t key = tileKeyFor(HOME_LAT + (row - 1) * TILE_STEP, HOME_LON + col * TILE_STEP);
+            writeCircleTile(key, 10 * row + col);
+        }
+    }
+    TEST_ASSERT_TRUE(store->begin());
+
+    // Due east along the middle row, the loader running between fixes
+    double lon = HOME_LON;
+    float lonPerSecond = DRIVE_SPEED / (METERS_PER_MICRODEGREE * cos(HOME_LAT / 1e6 * DEG_TO_RAD));
+    for (uint32_t fix = 0; fix < DRIVE_FIXES; fix++) {
+        nativeMillis += 1000;
+        store->prefetch(HOME_LAT, (int32_t)lon, DRIVE_SPEED, 90);
+        nativeRunTasks();
+        evaluateAt(HOME_LAT, (int32_t)lon);
+        lon += lonPerSecond;
+    }
+
+    TEST_ASSERT_EQUAL(0, store->getDemandLoads());
+    TEST_ASSERT_EQUAL_FLOAT(1.0, store->getHitRate());
+
+    char message[64];
+    snprintf(message, sizeof(message), "%.2f tile reads per minute at %.0f km/h",
+             store->getFlashReadRate(), DRIVE_SPEED * 3.6);
+    TEST_MESSAGE(message);
+}
+
+void test_changed_tile_read_again_after_invalidate() {
+    uint32_t key = tileKeyFor(HOME_LAT, HOME_LON);
+    TileContents tile;
+    addCircle(tile, 100, HOME_LAT, HOME_LON, 100);
+    writeTile(key, tile);
+    TEST_ASSERT_TRUE(store->begin());
+    evaluateAt(HOME_LAT, HOME_LON);
+    TEST_ASSERT_TRUE(store->isInside(100));
+
+    writeTile(key, TileContents());
+    evaluateAt(HOME_LAT, HOME_LON);
+    TEST_ASSERT_TRUE(store->isInside(100));     // Still the cached copy
+
+    store->invalidate(key);
+    evaluateAt(HOME_LAT, HOME_LON);
+    TEST_ASSERT_FALSE(store->isInside(100));
+    TileEvent event;
+    TEST_ASSERT_TRUE(store->getEvent(event));
+    TEST_ASSERT_EQUAL(0, event.event_type);
+}
+
+void test_bad_tiles_read_as_empty() {
+    uint32_t key = tileKeyFor(HOME_LAT, HOME_LON);
+    TileContents tile;
+    addSquare(tile, 200, HOME_LAT, HOME_LON, 1000);
+
+    // Ring past the vertices, wrong magic, short file
+    tile.rings[0].count = 5;
+    writeTile(key, tile);
+    TEST_ASSERT_TRUE(store->begin());
+    evaluateAt(HOME_LAT, HOME_LON);
+    TEST_ASSERT_EQUAL(0, store->getInsideCount());
+
+    tile.rings[0].count = 4;
+    writeTile(key, tile);
+    char path[32];
+    tilePathFor(key, path, sizeof(path));
+    File file = LittleFS.open(path, "r");
+    uint8_t bytes[512];
+    size_t length = file.read(bytes, sizeof(bytes));
+    file.close();
+    bytes[0] ^= 0xFF;
+    writeFile(key, bytes, length);
+    store->invalidate(key);
+    evaluateAt(HOME_LAT, HOME_LON);
+    TEST_ASSERT_EQUAL(0, store->getInsideCount());
+
+    bytes[0] ^= 0xFF;
+    writeFile(key, bytes, length - 1);
+    store->invalidate(key);
+    evaluateAt(HOME_LAT, HOME_LON);
+    TEST_ASSERT_EQUAL(0, store->getInsideCount());
+
+    // And the intact file
+    writeFile(key, bytes, length);
+    store->invalidate(key);
+    evaluateAt(HOME_LAT, HOME_LON);
+    TEST_ASSERT_TRUE(store->isInside(200));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_store_off_without_a_tile_directory);
+    RUN_TEST(test_membership_and_transitions);
+    RUN_TEST(test_fence_across_a_tile_edge_keeps_one_id);
+    RUN_TEST(test_lru_keeps_recent_tiles);
+    RUN_TEST(test_prefetch_never_evicts_the_current_tile);
+    RUN_TEST(test_prefetch_along_the_track_hides_flash_reads);
+    RUN_TEST(test_changed_tile_read_again_after_invalidate);
+    RUN_TEST(test_bad_tiles_read_as_empty);
+    return UNITY_END();
+}
@@ -0,0 +1,420 @@
+#include <unity.h>
+#include <LittleFS.h>
+#include <vector>
+#include "tile_sync.h"
+#include "tile_store.h"
+#include "geofence_manager.h"
+
+// ===============================================================
+// TILE SYNC (pio test -e native)
+// ===============================================================
+//
+// The tile hash tree over the in-memory LittleFS, driven with the
+// payloads the backend sends. The root of a fixed tile set is checked
+// against tools/tile_sync.py, a changed tile is found by walking only
+// the branches whose hashes moved, and tiles are written in downlink
+// sized chunks through the temp file, across a reset and lost chunks.
+
+#define CHUNK_BYTES                 (51 - TILE_WRITE_HEADER)    // One downlink's worth of tile data
+#define PATTERN_BYTES               100
+
+// TileTree(...).root32() in tools/tile_sync.py for patternTile() at PATTERN_KEYS
+#define PATTERN_ROOT                0x9081681EUL
+
+static const uint32_t PATTERN_KEYS[] = {
+    (1000UL << 16) | 2000, (1000UL << 16) | 2001, (1001UL << 16) | 2000, (3000UL << 16) | 10};
+
+static TileStore* store;
+static TileSync* sync;
+
+// Not a valid tile, but the tree only hashes the bytes
+static std::vector<uint8_t> patternTile(uint32_t key) {
+    std::vector<uint8_t> bytes;
+    for (uint32_t i = 0; i < PATTERN_BYTES; i++) {
+        bytes.push_back((uint8_t)(i * 7 + key));
+    }
+    return bytes;
+}
+
+// A tile of `circles` fences around the middle of its cell
+static std::vector<uint8_t> circleTile(uint32_t key, uint16_t firstId, uint8_t circles) {
+    TileHeader header = {TILE_MAGIC, circles, 0, 0, 0};
+    std::vector<uint8_t> bytes((const uint8_t*)&header, (const uint8_t*)&header + sizeof(header));
+    int32_t lat = TILE_ROW_ORIGIN + (int32_t)(key >> 16) * TILE_SIZE_MICRODEG + TILE_SIZE_MICRODEG / 2;
+    int32_t lon = TILE_COL_ORIGIN + (int32_t)(key & 0xFFFF) * TILE_SIZE_MICRODEG + TILE_SIZE_MICRODEG / 2;
+    for (uint8_t i = 0; i < circles; i++) {
+        TileFence fence = {};
+        fence.id = firstId + i;
+        fence.type = GEOFENCE_CIRCLE;
+        fence.centerLat = lat;
+        fence.centerLon = lon + i * 1000;
+        fence.radius = 200;
+        fence.minLat = lat - 4000;
+        fence.maxLat = lat + 4000;
+        fence.minLon = fence.centerLon - 4000;
+        fence.maxLon = fence.centerLon + 4000;
+        bytes.insert(bytes.end(), (const uint8_t*)&fence, (const uint8_t*)&fence + sizeof(fence));
+    }
+    return bytes;
+}
+
+static void writeFile(uint32_t key, const std::vector<uint8_t>& bytes) {
+    char path[32];
+    tilePathFor(key, path, sizeof(path));
+    File file = LittleFS.open(path, "w");
+    TEST_ASSERT_TRUE((bool)file);
+    file.write(bytes.data(), bytes.size());
+    file.close();
+}
+
+static std::vector<uint8_t> readFile(uint32_t key) {
+    char path[32];
+    tilePathFor(key, path, sizeof(path));
+    File file = LittleFS.open(path, "r");
+    std::vector<uint8_t> bytes(file ? file.size() : 0);
+    if (file) {
+        file.read(bytes.data(), bytes.size());
+        file.close();
+    }
+    return bytes;
+}
+
+static void writePatternTiles() {
+    for (uint32_t key : PATTERN_KEYS) {
+        writeFile(key, patternTile(key));
+    }
+}
+
+// As after a reset: a new instance over the same filesystem
+static void restart() {
+    delete sync;
+    sync = new TileSync(*store);
+    TEST_ASSERT_TRUE(sync->begin());
+}
+
+static TileSyncNode query(uint8_t depth, uint32_t prefix, uint8_t first = 0) {
+    uint8_t payload[4] = {(uint8_t)(depth << 4 | first), (uint8_t)(prefix >> 16), (uint8_t)(prefix >> 8),
+                          (uint8_t)prefix};
+    TEST_ASSERT_TRUE(sync->handleQuery(payload, sizeof(payload)));
+    TileSyncNode node;
+    TEST_ASSERT_TRUE(sync->getNode(node));
+    TEST_ASSERT_FALSE(sync->getNode(node));
+    return node;
+}
+
+// One CMD_TILE_WRITE chunk; returns the status it raised
+static TileSyncStatus writeChunk(uint32_t key, const std::vector<uint8_t>& bytes, uint16_t offset,
+                                 uint16_t total) {
+    std::vector<uint8_t> payload = {(uint8_t)(key >> 24), (uint8_t)(key >> 16), (uint8_t)(key >> 8), (uint8_t)key,
+                                    (uint8_t)(offset >> 8), (uint8_t)offset, (uint8_t)(total >> 8), (uint8_t)total};
+    size_t length = min((size_t)CHUNK_BYTES, bytes.size() - offset);
+    payload.insert(payload.end(), bytes.begin() + offset, bytes.begin() + offset + length);
+    TEST_ASSERT_TRUE(sync->handleWrite(payload.data(), payload.size()));
+    TileSyncStatus status;
+    TEST_ASSERT_TRUE(sync->getStatus(status));
+    return status;
+}
+
+// Every chunk in order, as the backend sends them when none is lost
+static TileSyncStatus writeTile(uint32_t key, const std::vector<uint8_t>& bytes) {
+    TileSyncStatus status = {};
+    for (size_t offset = 0; offset < bytes.size(); offset += CHUNK_BYTES) {
+        status = writeChunk(key, bytes, offset, bytes.size());
+    }
+    return status;
+}
+
+static TileSyncStatus deleteSubtree(uint8_t depth, uint32_t prefix) {
+    uint8_t payload[4] = {depth, (uint8_t)(prefix >> 16), (uint8_t)(prefix >> 8), (uint8_t)prefix};
+    TEST_ASSERT_TRUE(sync->handleDelete(payload, sizeof(payload)));
+    TileSyncStatus status;
+    TEST_ASSERT_TRUE(sync->getStatus(status));
+    return status;
+}
+
+static uint8_t bitCount(uint16_t mask) {
+    uint8_t n = 0;
+    for (; mask; mask &= mask - 1) {
+        n++;
+    }
+    return n;
+}
+
+void setUp() {
+    LittleFS.wipe();
+    LittleFS.mountable = true;
+    LittleFS.mkdir(TILE_DIR);
+    nativeMillis = 1000;
+    store = new TileStore();
+    sync = new TileSync(*store);
+}
+
+void tearDown() {
+    delete sync;
+    delete store;
+}
+
+// ===============================================================
+// TESTS
+// ===============================================================
+
+void test_sync_off_without_a_filesystem() {
+    LittleFS.wipe();
+    TEST_ASSERT_FALSE(sync->begin());
+    uint8_t payload[4] = {0, 0, 0, 0};
+    TEST_ASSERT_FALSE(sync->handleQuery(payload, sizeof(payload)));
+    TEST_ASSERT_FALSE(sync->handleDelete(payload, sizeof(payload)));
+}
+
+void test_morton_code_round_trip() {
+    // Row bit first: row 1 is code 2, column 1 is code 1
+    TEST_ASSERT_EQUAL_HEX32(2, tileMortonCode(1UL << 16));
+    TEST_ASSERT_EQUAL_HEX32(1, tileMortonCode(1));
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFFF, tileMortonCode((4095UL << 16) | 4095));
+    for (uint32_t row = 0; row < 4096; row += 37) {
+        for (uint32_t col = 0; col < 4096; col += 41) {
+            uint32_t key = (row << 16) | col;
+            TEST_ASSERT_EQUAL_HEX32(key, tileKeyForCode(tileMortonCode(key)));
+        }
+    }
+}
+
+void test_index_rebuilt_matches_the_backend() {
+    TEST_ASSERT_TRUE(sync->begin());
+    TEST_ASSERT_EQUAL(0, sync->getTileCount());
+    TEST_ASSERT_EQUAL_HEX32(0, sync->getRoot());
+
+    writePatternTiles();
+    LittleFS.remove(TILE_INDEX);
+    restart();
+    TEST_ASSERT_EQUAL(4, sync->getTileCount());
+    TEST_ASSERT_EQUAL_HEX32(PATTERN_ROOT, sync->getRoot());
+    TEST_ASSERT_TRUE(LittleFS.exists(TILE_INDEX));
+
+    // Loaded from the index, not the tiles: a tile changed behind its
+    // back does not move the root
+    writeFile(PATTERN_KEYS[0], patternTile(PATTERN_KEYS[1]));
+    restart();
+    TEST_ASSERT_EQUAL_HEX32(PATTERN_ROOT, sync->getRoot());
+
+    // A damaged index is rebuilt
+    File file = LittleFS.open(TILE_INDEX, "a");
+    uint8_t junk = 0xAA;
+    file.write(&junk, 1);
+    file.close();
+    restart();
+    TEST_ASSERT_EQUAL(4, sync->getTileCount());
+    TEST_ASSERT_NOT_EQUAL(PATTERN_ROOT, sync->getRoot());
+}
+
+void test_query_walk_finds_only_the_changed_tile() {
+    writePatternTiles();
+    TEST_ASSERT_TRUE(sync->begin());
+
+    // The path from the root to the tile about to change
+    uint32_t changed = PATTERN_KEYS[1];
+    uint32_t code = tileMortonCode(changed);
+    TileSyncNode before[TILE_TREE_DEPTH];
+    for (uint8_t depth = 0; depth < TILE_TREE_DEPTH; depth++) {
+        before[depth] = query(depth, code >> (4 * (TILE_TREE_DEPTH - depth)));
+    }
+    TEST_ASSERT_EQUAL(2, bitCount(before[0].child_mask));       // Two corners of the grid
+    TEST_ASSERT_EQUAL(3, bitCount(before[TILE_TREE_DEPTH - 1].child_mask));
+
+    uint32_t root = sync->getRoot();
+    TileSyncStatus status = writeTile(changed, circleTile(changed, 1, 2));
+    TEST_ASSERT_EQUAL(TILE_WRITE_INSTALLED, status.result);
+    TEST_ASSERT_NOT_EQUAL(root, sync->getRoot());
+    TEST_ASSERT_EQUAL_HEX32(sync->getRoot(), status.fence_root);
+
+    // At every level exactly one child moved, the one on the path
+    for (uint8_t depth = 0; depth < TILE_TREE_DEPTH; depth++) {
+        TileSyncNode after = query(depth, code >> (4 * (TILE_TREE_DEPTH - depth)));
+        TEST_ASSERT_EQUAL_HEX16(before[depth].child_mask, after.child_mask);
+        TEST_ASSERT_EQUAL(before[depth].count, after.count);
+
+        uint8_t nibble = (code >> (4 * (TILE_TREE_DEPTH - depth - 1))) & 0x0F;
+        uint8_t listed = 0;
+        for (uint8_t n = 0; n < 16; n++) {
+            if (!(after.child_mask & (1 << n))) {
+                continue;
+            }
+            bool moved = after.child_hashes[listed] != before[depth].child_hashes[listed];
+            TEST_ASSERT_EQUAL(n == nibble, moved);
+            listed++;
+        }
+    }
+}
+
+void test_wide_nodes_are_listed_in_pages() {
+    // 12 tiles under one parent; a node uplink has room for 10 hashes
+    uint32_t parent = tileMortonCode(PATTERN_KEYS[0]) >> 4;
+    for (uint32_t n = 0; n < 12; n++) {
+        uint32_t key = tileKeyForCode((parent << 4) | n);
+        writeFile(key, patternTile(key));
+    }
+    TEST_ASSERT_TRUE(sync->begin());
+    TEST_ASSERT_EQUAL(12, sync->getTileCount());
+
+    TileSyncNode node = query(TILE_TREE_DEPTH - 1, parent);
+    TEST_ASSERT_EQUAL_HEX16(0x0FFF, node.child_mask);
+    TEST_ASSERT_EQUAL((TILE_SYNC_MAX_PAYLOAD - TILE_SYNC_NODE_HEADER) / 4, node.count);
+    uint32_t tenth = node.child_hashes[9];
+
+    // The backend asks on from the last one listed
+    node = query(TILE_TREE_DEPTH - 1, parent, 10);
+    TEST_ASSERT_EQUAL(10, node.first);
+    TEST_ASSERT_EQUAL(2, node.count);
+    TEST_ASSERT_NOT_EQUAL(tenth, node.child_hashes[0]);     // Not a repeat of the last one listed
+
+    // More queries than the reply queue holds: the rest are dropped
+    std::vector<uint8_t> payload;
+    for (uint8_t i = 0; i < TILE_SYNC_MAX_REPLIES + 3; i++) {
+        payload.insert(payload.end(), {0, 0, 0, 0});
+    }
+    TEST_ASSERT_TRUE(sync->handleQuery(payload.data(), payload.size()));
+    uint8_t replies = 0;
+    while (sync->getNode(node)) {
+        replies++;
+    }
+    TEST_ASSERT_EQUAL(TILE_SYNC_MAX_REPLIES, replies);
+}
+
+void test_chunked_write_survives_a_reset_and_lost_chunks() {
+    writePatternTiles();
+    TEST_ASSERT_TRUE(sync->begin());
+    uint32_t key = PATTERN_KEYS[2];
+    std::vector<uint8_t> tile = circleTile(key, 1, 4);
+    uint16_t total = tile.size();
+    TEST_ASSERT_TRUE(total > 3 * CHUNK_BYTES);
+
+    TileSyncStatus status = writeChunk(key, tile, 0, total);
+    TEST_ASSERT_EQUAL(TILE_WRITE_PROGRESS, status.result);
+    TEST_ASSERT_EQUAL(CHUNK_BYTES, status.value);
+
+    // The second chunk is lost: the third is refused with where to carry on
+    status = writeChunk(key, tile, 2 * CHUNK_BYTES, total);
+    TEST_ASSERT_EQUAL(TILE_WRITE_PROGRESS, status.result);
+    TEST_ASSERT_EQUAL(CHUNK_BYTES, status.value);
+    status = writeChunk(key, tile, CHUNK_BYTES, total);
+    TEST_ASSERT_EQUAL(2 * CHUNK_BYTES, status.value);
+
+    // A reset mid-transfer keeps the old tile and starts the tile over
+    restart();
+    TEST_ASSERT_EQUAL_HEX32(PATTERN_ROOT, sync->getRoot());
+    TEST_ASSERT_TRUE(readFile(key) == patternTile(key));
+    status = writeChunk(key, tile, 2 * CHUNK_BYTES, total);
+    TEST_ASSERT_EQUAL(TILE_WRITE_PROGRESS, status.result);
+    TEST_ASSERT_EQUAL(0, status.value);
+
+    status = writeTile(key, tile);
+    TEST_ASSERT_EQUAL(TILE_WRITE_INSTALLED, status.result);
+    TEST_ASSERT_EQUAL_HEX32(key, status.target);
+    TEST_ASSERT_EQUAL(total, status.value);
+    TEST_ASSERT_TRUE(readFile(key) == tile);
+    TEST_ASSERT_FALSE(LittleFS.exists(TILE_SYNC_TEMP));
+    TEST_ASSERT_EQUAL(4, sync->getTileCount());
+
+    // The hash kept while streaming is the one of the file on flash
+    uint32_t root = sync->getRoot();
+    LittleFS.remove(TILE_INDEX);
+    restart();
+    TEST_ASSERT_EQUAL_HEX32(root, sync->getRoot());
+}
+
+void test_bad_writes_are_rejected() {
+    writePatternTiles();
+    TEST_ASSERT_TRUE(sync->begin());
+    uint32_t key = PATTERN_KEYS[0];
+    std::vector<uint8_t> tile = circleTile(key, 1, 1);
+
+    // Size the header does not add up to
+    TEST_ASSERT_EQUAL(TILE_WRITE_REJECTED, writeChunk(key, tile, 0, tile.size() + 4).result);
+
+    // Not a tile
+    std::vector<uint8_t> junk = tile;
+    junk[0] ^= 0xFF;
+    TEST_ASSERT_EQUAL(TILE_WRITE_REJECTED, writeChunk(key, junk, 0, junk.size()).result);
+
+    // Outside the grid, and larger than any tile may be
+    TEST_ASSERT_EQUAL(TILE_WRITE_REJECTED, writeChunk((4096UL << 16) | 1, tile, 0, tile.size()).result);
+    TEST_ASSERT_EQUAL(TILE_WRITE_REJECTED, writeChunk(key, tile, 0, TILE_MAX_BYTES + 1).result);
+
+    TEST_ASSERT_EQUAL_HEX32(PATTERN_ROOT, sync->getRoot());
+    TEST_ASSERT_TRUE(readFile(key) == patternTile(key));
+}
+
+void test_delete_drops_a_whole_subtree() {
+    writePatternTiles();
+    TEST_ASSERT_TRUE(sync->begin());
+
+    // The three neighbouring tiles share a node at depth 5
+    uint32_t parent = tileMortonCode(PATTERN_KEYS[0]) >> 4;
+    TileSyncStatus status = deleteSubtree(TILE_TREE_DEPTH - 1, parent);
+    TEST_ASSERT_EQUAL(TILE_DELETED, status.result);
+    TEST_ASSERT_EQUAL_HEX32(((uint32_t)(TILE_TREE_DEPTH - 1) << 24) | parent, status.target);
+    TEST_ASSERT_EQUAL(3, status.value);
+    TEST_ASSERT_EQUAL(1, sync->getTileCount());
+    TEST_ASSERT_TRUE(readFile(PATTERN_KEYS[0]).empty());
+    TEST_ASSERT_FALSE(readFile(PATTERN_KEYS[3]).empty());
+
+    // Nothing left there: a no-op that still reports
+    status = deleteSubtree(TILE_TREE_DEPTH - 1, parent);
+    TEST_ASSERT_EQUAL(0, status.value);
+
+    // The root node: everything, down to the empty tree
+    status = deleteSubtree(0, 0);
+    TEST_ASSERT_EQUAL(1, status.value);
+    TEST_ASSERT_EQUAL_HEX32(0, status.fence_root);
+
+    // Deeper than a tile, or a prefix too long for its depth
+    uint8_t payload[4] = {TILE_TREE_DEPTH + 1, 0, 0, 0};
+    TEST_ASSERT_FALSE(sync->handleDelete(payload, sizeof(payload)));
+    uint8_t tooLong[4] = {1, 0, 0, 0x10};
+    TEST_ASSERT_FALSE(sync->handleDelete(tooLong, sizeof(tooLong)));
+
+    restart();
+    TEST_ASSERT_EQUAL(0, sync->getTileCount());
+}
+
+void test_installed_tile_replaces_the_cached_copy() {
+    int32_t lat = -33450000, lon = -70650000;
+    uint32_t key = tileKeyFor(lat, lon);
+    writeFile(key, circleTile(key, 10, 1));
+    TEST_ASSERT_TRUE(store->begin());
+    TEST_ASSERT_TRUE(sync->begin());
+
+    // The middle of the cell, inside the first circle
+    int32_t centerLat = TILE_ROW_ORIGIN + (int32_t)(key >> 16) * TILE_SIZE_MICRODEG + TILE_SIZE_MICRODEG / 2;
+    int32_t centerLon = TILE_COL_ORIGIN + (int32_t)(key & 0xFFFF) * TILE_SIZE_MICRODEG + TILE_SIZE_MICRODEG / 2;
+    float clearance;
+    store->evaluate(centerLat, centerLon, 1, clearance);
+    TEST_ASSERT_TRUE(store->isInside(10));
+
+    // The next fix reads the new file: out of one, into the other
+    TEST_ASSERT_EQUAL(TILE_WRITE_INSTALLED, writeTile(key, circleTile(key, 20, 1)).result);
+    TEST_ASSERT_TRUE(store->evaluate(centerLat, centerLon, 2, clearance));
+    TEST_ASSERT_FALSE(store->isInside(10));
+    TEST_ASSERT_TRUE(store->isInside(20));
+    TileEvent event;
+    TEST_ASSERT_TRUE(store->getEvent(event));
+    TEST_ASSERT_EQUAL(10, event.fence_id);
+    TEST_ASSERT_EQUAL(0, event.event_type);
+    TEST_ASSERT_TRUE(store->getEvent(event));
+    TEST_ASSERT_EQUAL(20, event.fence_id);
+    TEST_ASSERT_EQUAL(1, event.event_type);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_sync_off_without_a_filesystem);
+    RUN_TEST(test_morton_code_round_trip);
+    RUN_TEST(test_index_rebuilt_matches_the_backend);
+    RUN_TEST(test_query_walk_finds_only_the_changed_tile);
+    RUN_TEST(test_wide_nodes_are_listed_in_pages);
+    RUN_TEST(test_chunked_write_survives_a_reset_and_lost_chunks);
+    RUN_TEST(test_bad_writes_are_rejected);
+    RUN_TEST(test_delete_drops_a_whole_subtree);
+    RUN_TEST(test_installed_tile_replaces_the_cached_copy);
+    return UNITY_END();
+}
@@ -0,0 +1,227 @@
+#include <unity.h>
+#include <chrono>
+#include <vector>
+#include "track_buffer.h"
+#include "geofence_manager.h"
+#include "../traces/drive_trace.h"
+
+// ===============================================================
+// TRACK SIMPLIFICATION (pio test -e native)
+// ===============================================================
+//
+// The recorded drive (tools/geofence_trace.py) and a noisy synthetic
+// walk are fed through the buffer, and every fix is measured against
+// the kept polyline between the two kept points around it: none may be
+// further than TRACK_MAX_ERROR. Compression ratio, largest error and
+// cost per fix are printed; the timing is not asserted.
+
+#define ERROR_SLACK                 0.5         // m, micro-degree rounding of the kept points
+#define WALK_FIXES                  7200        // 1 Hz, two hours
+#define WALK_NOISE                  20          // micro-degrees, ~2 m
+#define TIMESTAMP_BASE              1700000000UL
+
+struct Fix {
+    uint32_t time;          // ms
+    int32_t lat;            // * 1e6
+    int32_t lon;
+};
+
+static TrackBuffer* track;
+static uint32_t seed;
+
+// Deterministic across hosts
+static uint32_t nextRandom() {
+    seed = seed * 1664525UL + 1013904223UL;
+    return seed >> 8;
+}
+
+static int32_t randomOffset(int32_t span) {
+    return (int32_t)(nextRandom() % (uint32_t)(2 * span + 1)) - span;
+}
+
+static double elapsedNs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Distance (m) from p to the segment a-b, in a local meter frame at a
+static float segmentDistance(int32_t lat, int32_t lon, const TrackPoint& a, const TrackPoint& b) {
+    float cosLat = cos(a.latitude / 1e6 * DEG_TO_RAD);
+    float px = (lon - a.longitude) * METERS_PER_MICRODEGREE * cosLat;
+    float py = (lat - a.latitude) * METERS_PER_MICRODEGREE;
+    float bx = (b.longitude - a.longitude) * METERS_PER_MICRODEGREE * cosLat;
+    float by = (b.latitude - a.latitude) * METERS_PER_MICRODEGREE;
+    float length = bx * bx + by * by;
+    float t = length > 0 ? constrain((px * bx + py * by) / length, 0.0f, 1.0f) : 0;
+    return sqrt(sq(px - t * bx) + sq(py - t * by));
+}
+
+static void drain(std::vector<TrackPoint>& kept) {
+    TrackPoint points[TRACK_BATCH_POINTS];
+    uint16_t n;
+    while ((n = track->peek(points, TRACK_BATCH_POINTS)) > 0) {
+        kept.insert(kept.end(), points, points + n);
+        track->consume(n);
+    }
+}
+
+// Feeds every fix, draining as an uploader would; returns the kept points
+static std::vector<TrackPoint> simplify(const std::vector<Fix>& fixes, double& nsPerFix) {
+    std::vector<TrackPoint> kept;
+    double spent = 0;
+    for (const Fix& fix : fixes) {
+        auto start = std::chrono::steady_clock::now();
+        track->addFix(fix.time, TIMESTAMP_BASE + fix.time / 1000, fix.lat, fix.lon);
+        spent += elapsedNs(start);
+        if (track->getCount() >= TRACK_BUFFER_POINTS / 2) {
+            drain(kept);
+        }
+    }
+    track->flush();
+    drain(kept);
+    nsPerFix = spent / fixes.size();
+    return kept;
+}
+
+// Largest distance from a fix to the kept segment spanning its time
+static float maxError(const std::vector<Fix>& fixes, const std::vector<TrackPoint>& kept) {
+    float worst = 0;
+    size_t k = 0;
+    for (const Fix& fix : fixes) {
+        uint32_t timestamp = TIMESTAMP_BASE + fix.time / 1000;
+        while (k + 2 < kept.size() && kept[k + 1].timestamp <= timestamp) {
+            k++;
+        }
+        worst = max(worst, segmentDistance(fix.lat, fix.lon, kept[k], kept[k + 1]));
+    }
+    return worst;
+}
+
+static std::vector<Fix> driveFixes() {
+    std::vector<Fix> fixes;
+    for (size_t i = 0; i < traceFixCount; i++) {
+        fixes.push_back({traceFixes[i].time, traceFixes[i].lat, traceFixes[i].lon});
+    }
+    return fixes;
+}
+
+// Walking pace with a wandering heading and GNSS noise
+static std::vector<Fix> walkFixes() {
+    std::vector<Fix> fixes;
+    double lat = -33448900, lon = -70669300, heading = 0.3;
+    for (uint32_t s = 0; s < WALK_FIXES; s++) {
+        heading += randomOffset(100) / 1000.0;
+        lat += 1.4 * cos(heading) / METERS_PER_MICRODEGREE;
+        lon += 1.4 * sin(heading) / (METERS_PER_MICRODEGREE * 0.834);
+        fixes.push_back({1000 + s * 1000, (int32_t)lat + randomOffset(WALK_NOISE),
+                         (int32_t)lon + randomOffset(WALK_NOISE)});
+    }
+    return fixes;
+}
+
+static void report(const char* name, size_t fixes, size_t kept, float error, double nsPerFix) {
+    char message[112];
+    snprintf(message, sizeof(message), "%s: %u fixes, %u kept (%.1f:1), max error %.2f m, %.0f ns per fix",
+             name, (unsigned)fixes, (unsigned)kept, (double)fixes / kept, error, nsPerFix);
+    TEST_MESSAGE(message);
+}
+
+void setUp() {
+    seed = 12345;
+    track = new TrackBuffer();
+}
+
+void tearDown() {
+    delete track;
+}
+
+// ===============================================================
+// TESTS
+// ===============================================================
+
+void test_drive_within_the_error_bound() {
+    std::vector<Fix> fixes = driveFixes();
+    double nsPerFix;
+    std::vector<TrackPoint> kept = simplify(fixes, nsPerFix);
+
+    TEST_ASSERT_TRUE(kept.size() >= 2);
+    TEST_ASSERT_EQUAL(fixes.front().lat, kept.front().latitude);
+    TEST_ASSERT_EQUAL(fixes.back().lat, kept.back().latitude);
+    TEST_ASSERT_EQUAL(fixes.back().lon, kept.back().longitude);
+
+    float error = maxError(fixes, kept);
+    TEST_ASSERT_TRUE(error <= TRACK_MAX_ERROR + ERROR_SLACK);
+    TEST_ASSERT_TRUE(kept.size() < fixes.size() / 4);
+    report("drive", fixes.size(), kept.size(), error, nsPerFix);
+}
+
+void test_noisy_walk_within_the_error_bound() {
+    std::vector<Fix> fixes = walkFixes();
+    double nsPerFix;
+    std::vector<TrackPoint> kept = simplify(fixes, nsPerFix);
+
+    float error = maxError(fixes, kept);
+    TEST_ASSERT_TRUE(error <= TRACK_MAX_ERROR + ERROR_SLACK);
+    TEST_ASSERT_EQUAL_FLOAT((float)fixes.size() / kept.size(), track->getCompressionRatio());
+    report("walk", fixes.size(), kept.size(), error, nsPerFix);
+}
+
+void test_straight_line_keeps_a_point_per_interval() {
+    std::vector<Fix> fixes;
+    for (uint32_t s = 0; s < 3 * TRACK_MAX_POINT_INTERVAL / 1000; s++) {
+        fixes.push_back({1000 + s * 1000, -33448900, -70669300 + (int32_t)s * 100});
+    }
+    double nsPerFix;
+    std::vector<TrackPoint> kept = simplify(fixes, nsPerFix);
+
+    // Start, one per interval, and the flushed end
+    TEST_ASSERT_TRUE(kept.size() >= 4 && kept.size() <= 5);
+    for (size_t i = 1; i < kept.size(); i++) {
+        TEST_ASSERT_TRUE((kept[i].timestamp - kept[i - 1].timestamp) * 1000 <= TRACK_MAX_POINT_INTERVAL);
+    }
+}
+
+void test_turning_back_keeps_the_turn() {
+    // East 500 m, then straight back
+    std::vector<Fix> fixes;
+    for (int32_t s = 0; s <= 100; s++) {
+        int32_t along = s <= 50 ? s : 100 - s;
+        fixes.push_back({1000 + (uint32_t)s * 1000, -33448900, -70669300 + along * 100 * 12 / 10});
+    }
+    double nsPerFix;
+    std::vector<TrackPoint> kept = simplify(fixes, nsPerFix);
+
+    TEST_ASSERT_EQUAL(3, kept.size());
+    TEST_ASSERT_EQUAL(fixes[50].lon, kept[1].longitude);
+    TEST_ASSERT_TRUE(maxError(fixes, kept) <= TRACK_MAX_ERROR + ERROR_SLACK);
+}
+
+void test_full_buffer_drops_the_oldest() {
+    // A zigzag that keeps every fix, never drained
+    for (uint32_t s = 0; s < TRACK_BUFFER_POINTS + 20; s++) {
+        track->addFix(1000 + s * 1000, TIMESTAMP_BASE + s, -33448900 + (s & 1) * 1000, -70669300 + s * 1000);
+    }
+    TEST_ASSERT_EQUAL(TRACK_BUFFER_POINTS, track->getCount());
+
+    TrackPoint oldest;
+    TEST_ASSERT_EQUAL(1, track->peek(&oldest, 1));
+    TEST_ASSERT_TRUE(oldest.timestamp > TIMESTAMP_BASE);
+
+    // Peeking again returns the same point until it is consumed
+    TrackPoint again;
+    track->peek(&again, 1);
+    TEST_ASSERT_EQUAL(oldest.timestamp, again.timestamp);
+    track->consume(1);
+    track->peek(&again, 1);
+    TEST_ASSERT_EQUAL(oldest.timestamp + 1, again.timestamp);
+    TEST_ASSERT_EQUAL(TRACK_BUFFER_POINTS - 1, track->getCount());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_drive_within_the_error_bound);
+    RUN_TEST(test_noisy_walk_within_the_error_bound);
+    RUN_TEST(test_straight_line_keeps_a_point_per_interval);
+    RUN_TEST(test_turning_back_keeps_the_turn);
+    RUN_TEST(test_full_buffer_drops_the_oldest);
+    return UNITY_END();
+}
@@ -0,0 +1,237 @@
+#include <unity.h>
+#include <Preferences.h>
+#include "trip_detector.h"
+#include "geofence_manager.h"
+#include "../traces/drive_trace.h"
+
+// ===============================================================
+// TRIP DETECTOR (pio test -e native)
+// ===============================================================
+//
+// The recorded drive (tools/geofence_trace.py) with a parked spell
+// before and after it, and GNSS-like jitter while parked: one trip,
+// backdated to where the asset left rest and ended where it came to
+// rest, its distance within a few percent of the path. Also false
+// starts in the yard, parked drift, lost fixes and the persisted
+// odometer.
+
+#define PARKED_TIME                 (TRIP_STOP_DURATION + 120000)  // ms either side of the drive
+#define PARKED_JITTER               40          // micro-degrees, ~4 m
+#define TIMESTAMP_BASE              1700000000UL
+#define DISTANCE_TOLERANCE          0.05        // Share of the path length
+
+static TripDetector* trips;
+static uint32_t seed;
+static uint32_t clock_;     // ms of the last fix fed
+
+// Deterministic across hosts
+static uint32_t nextRandom() {
+    seed = seed * 1664525UL + 1013904223UL;
+    return seed >> 8;
+}
+
+static int32_t randomOffset(int32_t span) {
+    return (int32_t)(nextRandom() % (uint32_t)(2 * span + 1)) - span;
+}
+
+static void feed(uint32_t time, int32_t lat, int32_t lon, float speed) {
+    clock_ = time;
+    trips->update(time, TIMESTAMP_BASE + time / 1000, lat, lon, speed, 1.0);
+}
+
+// 1 Hz fixes at rest, scattered around a point
+static void park(int32_t lat, int32_t lon, uint32_t duration) {
+    uint32_t end = clock_ + duration;
+    while (clock_ + 1000 <= end) {
+        feed(clock_ + 1000, lat + randomOffset(PARKED_JITTER), lon + randomOffset(PARKED_JITTER),
+             (nextRandom() % 50) / 100.0);
+    }
+}
+
+// The trace, shifted to start one second after the current clock
+static void drive() {
+    uint32_t offset = clock_ + 1000 - traceFixes[0].time;
+    for (size_t i = 0; i < traceFixCount; i++) {
+        feed(traceFixes[i].time + offset, traceFixes[i].lat, traceFixes[i].lon, traceFixes[i].speed);
+    }
+}
+
+static float pathLength() {
+    float total = 0;
+    for (size_t i = 1; i < traceFixCount; i++) {
+        float dy = (traceFixes[i].lat - traceFixes[i - 1].lat) * METERS_PER_MICRODEGREE;
+        float dx = (traceFixes[i].lon - traceFixes[i - 1].lon) * METERS_PER_MICRODEGREE *
+                   cos(traceFixes[i - 1].lat / 1e6 * DEG_TO_RAD);
+        total += sqrt(dx * dx + dy * dy);
+    }
+    return total;
+}
+
+void setUp() {
+    Preferences::wipe();
+    nativeMillis = 0;
+    seed = 12345;
+    clock_ = 0;
+    trips = new TripDetector();
+    trips->begin();
+}
+
+void tearDown() {
+    delete trips;
+}
+
+// ===============================================================
+// TESTS
+// ===============================================================
+
+void test_drive_is_one_trip() {
+    const TraceFix& first = traceFixes[0];
+    const TraceFix& last = traceFixes[traceFixCount - 1];
+    park(first.lat, first.lon, PARKED_TIME);
+    uint32_t leftRest = clock_ + 1000;     // The trace opens with a fix at rest
+    drive();
+    uint32_t cameToRest = clock_ + 1000;
+    park(last.lat, last.lon, PARKED_TIME);
+
+    TripEvent event;
+    TEST_ASSERT_TRUE(trips->getEvent(event));
+    TEST_ASSERT_EQUAL(TRIP_START, event.event_type);
+    TEST_ASSERT_EQUAL(1, event.trip_id);
+    TEST_ASSERT_EQUAL(TIMESTAMP_BASE + leftRest / 1000, event.timestamp);
+    TEST_ASSERT_EQUAL(0, event.odometer);
+
+    TEST_ASSERT_TRUE(trips->getEvent(event));
+    TEST_ASSERT_EQUAL(TRIP_END, event.event_type);
+    TEST_ASSERT_EQUAL(TIMESTAMP_BASE + cameToRest / 1000, event.timestamp);
+    TEST_ASSERT_FALSE(trips->getEvent(event));
+    TEST_ASSERT_FALSE(trips->isMoving());
+
+    TripSummary summary;
+    TEST_ASSERT_TRUE(trips->getSummary(summary));
+    TEST_ASSERT_EQUAL(1, summary.trip_id);
+    float length = pathLength();
+    TEST_ASSERT_FLOAT_WITHIN(length * DISTANCE_TOLERANCE, length, summary.distance);
+    TEST_ASSERT_EQUAL(summary.distance, trips->getOdometer());
+    TEST_ASSERT_EQUAL((cameToRest - leftRest) / 1000, summary.duration);
+
+    float fastest = 0;
+    for (size_t i = 0; i < traceFixCount; i++) {
+        fastest = max(fastest, traceFixes[i].speed);
+    }
+    TEST_ASSERT_EQUAL((uint8_t)(fastest * 3.6), summary.max_speed);
+
+    // The waypoints lead from the start to where the drive ended
+    TEST_ASSERT_TRUE(summary.waypoint_count >= 2 && summary.waypoint_count <= TRIP_MAX_WAYPOINTS);
+    int32_t lat = summary.start_latitude;
+    int32_t lon = summary.start_longitude;
+    for (uint8_t i = 0; i < summary.waypoint_count; i++) {
+        lat += summary.waypoints[i][0] * TRIP_WAYPOINT_UNIT;
+        lon += summary.waypoints[i][1] * TRIP_WAYPOINT_UNIT;
+    }
+    TEST_ASSERT_INT32_WITHIN(TRIP_WAYPOINT_UNIT / 2 + PARKED_JITTER, last.lat, lat);
+    TEST_ASSERT_INT32_WITHIN(TRIP_WAYPOINT_UNIT / 2 + PARKED_JITTER, last.lon, lon);
+
+    char message[96];
+    snprintf(message, sizeof(message), "path %.0f m, trip %u m in %u s, %u waypoints",
+             length, (unsigned)summary.distance, (unsigned)summary.duration, summary.waypoint_count);
+    TEST_MESSAGE(message);
+}
+
+void test_parked_drift_is_not_a_trip() {
+    park(-33448900, -70669300, 3600000);
+    TripEvent event;
+    TEST_ASSERT_FALSE(trips->getEvent(event));
+    TEST_ASSERT_EQUAL(TRIP_STATE_STOPPED, trips->getState());
+    TEST_ASSERT_EQUAL(0, trips->getOdometer());
+}
+
+void test_moving_around_the_yard_is_a_false_start() {
+    park(-33448900, -70669300, 60000);
+
+    // A few seconds at walking-plus speed, settling 20 m away
+    for (uint8_t i = 1; i <= 5; i++) {
+        feed(clock_ + 1000, -33448900 + i * 36, -70669300, 4.0);
+    }
+    TEST_ASSERT_EQUAL(TRIP_STATE_STARTING, trips->getState());
+    park(-33448900 + 180, -70669300, 60000);
+
+    TripEvent event;
+    TEST_ASSERT_FALSE(trips->getEvent(event));
+    TEST_ASSERT_EQUAL(TRIP_STATE_STOPPED, trips->getState());
+    TEST_ASSERT_EQUAL(0, trips->getTripId());
+}
+
+void test_traffic_light_halts_do_not_split_the_trip() {
+    park(traceFixes[0].lat, traceFixes[0].lon, 60000);
+    drive();
+
+    // A halt shorter than TRIP_STOP_DURATION, then the drive once more
+    const TraceFix& last = traceFixes[traceFixCount - 1];
+    park(last.lat, last.lon, TRIP_STOP_DURATION - 30000);
+    TEST_ASSERT_TRUE(trips->isMoving());
+    drive();
+    park(last.lat, last.lon, PARKED_TIME);
+
+    TripEvent event;
+    uint8_t starts = 0, ends = 0;
+    while (trips->getEvent(event)) {
+        starts += event.event_type == TRIP_START;
+        ends += event.event_type == TRIP_END;
+    }
+    TEST_ASSERT_EQUAL(1, starts);
+    TEST_ASSERT_EQUAL(1, ends);
+}
+
+void test_lost_fix_closes_the_trip() {
+    park(traceFixes[0].lat, traceFixes[0].lon, 60000);
+    drive();
+    TEST_ASSERT_TRUE(trips->isMoving());
+    uint32_t lastFix = clock_;
+
+    // Into a garage: nothing for a while
+    trips->checkTimeout(lastFix + TRIP_LOST_FIX_TIMEOUT - 1);
+    TEST_ASSERT_TRUE(trips->isMoving());
+    trips->checkTimeout(lastFix + TRIP_LOST_FIX_TIMEOUT);
+    TEST_ASSERT_FALSE(trips->isMoving());
+
+    TripEvent event;
+    TEST_ASSERT_TRUE(trips->getEvent(event));
+    TEST_ASSERT_TRUE(trips->getEvent(event));
+    TEST_ASSERT_EQUAL(TRIP_END, event.event_type);
+    TEST_ASSERT_EQUAL(TIMESTAMP_BASE + lastFix / 1000, event.timestamp);
+    TEST_ASSERT_EQUAL(traceFixes[traceFixCount - 1].lat, event.latitude);
+}
+
+void test_odometer_and_trip_counter_survive_a_reboot() {
+    park(traceFixes[0].lat, traceFixes[0].lon, 60000);
+    drive();
+    park(traceFixes[traceFixCount - 1].lat, traceFixes[traceFixCount - 1].lon, PARKED_TIME);
+    uint32_t odometer = trips->getOdometer();
+    TEST_ASSERT_TRUE(odometer > 0);
+
+    delete trips;
+    trips = new TripDetector();
+    trips->begin();
+    TEST_ASSERT_EQUAL(odometer, trips->getOdometer());
+    TEST_ASSERT_EQUAL(1, trips->getTripId());
+
+    // The next trip counts on from there
+    clock_ = 0;
+    park(traceFixes[0].lat, traceFixes[0].lon, 60000);
+    drive();
+    TripEvent event;
+    TEST_ASSERT_TRUE(trips->getEvent(event));
+    TEST_ASSERT_EQUAL(2, event.trip_id);
+    TEST_ASSERT_EQUAL(odometer, event.odometer);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_drive_is_one_trip);
+    RUN_TEST(test_parked_drift_is_not_a_trip);
+    RUN_TEST(test_moving_around_the_yard_is_a_false_start);
+    RUN_TEST(test_traffic_light_halts_do_not_split_the_trip);
+    RUN_TEST(test_lost_fix_closes_the_trip);
+    RUN_TEST(test_odometer_and_trip_counter_survive_a_reboot);
+    return UNITY_END();
+}
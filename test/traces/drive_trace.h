@@ -0,0 +1,969 @@
+#ifndef DRIVE_TRACE_H
+#define DRIVE_TRACE_H
+
+// Generated by tools/geofence_trace.py record; do not edit.
+//
+// 912 fixes at 1 Hz over 911 s of driving, and the transitions of the
+// 10 Hz path through the fences below (exact geometry, no hysteresis).
+
+#include <stdint.h>
+
+struct TraceFix {
+    uint32_t time;      // ms
+    int32_t lat;        // * 1e6
+    int32_t lon;
+    float speed;        // m/s
+    float course;       // degrees
+};
+
+struct TraceTransition {
+    uint32_t time;      // ms
+    uint8_t id;
+    bool entered;
+};
+
+struct TraceCircle {
+    uint8_t id;
+    double lat;
+    double lon;
+    uint32_t radius;    // m
+};
+
+static const TraceCircle traceCircles[] = {
+    {3, -33.4489, -70.6693, 100},
+    {2, -33.4489, -70.6650, 30},
+};
+
+static const uint8_t traceSquareId = 1;
+static const int32_t traceSquareLat[] = {-33452000, -33452000, -33451000, -33451000};
+static const int32_t traceSquareLon[] = {-70668000, -70667000, -70667000, -70668000};
+
+static const TraceTransition traceTransitions[] = {
+    {355250, 3, true},
+    {373150, 3, false},
+    {383950, 2, true},
+    {386350, 2, false},
+    {610650, 1, true},
+    {630650, 1, false},
+    {913450, 3, true},
+};
+
+static const TraceFix traceFixes[] = {
+    {10000, -33448900, -70700000, 0.00f, 0.0f},
+    {11000, -33448900, -70699982, 3.00f, 90.0f},
+    {12000, -33448900, -70699932, 6.00f, 90.0f},
+    {13000, -33448900, -70699852, 8.00f, 90.0f},
+    {14000, -33448900, -70699766, 8.00f, 90.0f},
+    {15000, -33448900, -70699680, 8.00f, 90.0f},
+    {16000, -33448900, -70699594, 8.00f, 90.0f},
+    {17000, -33448900, -70699508, 8.00f, 90.0f},
+    {18000, -33448900, -70699422, 8.00f, 90.0f},
+    {19000, -33448900, -70699335, 8.00f, 90.0f},
+    {20000, -33448900, -70699249, 8.00f, 90.0f},
+    {21000, -33448900, -70699163, 8.00f, 90.0f},
+    {22000, -33448900, -70699077, 8.00f, 90.0f},
+    {23000, -33448900, -70698991, 8.00f, 90.0f},
+    {24000, -33448900, -70698905, 8.00f, 90.0f},
+    {25000, -33448900, -70698819, 8.00f, 90.0f},
+    {26000, -33448900, -70698732, 8.00f, 90.0f},
+    {27000, -33448900, -70698646, 8.00f, 90.0f},
+    {28000, -33448900, -70698560, 8.00f, 90.0f},
+    {29000, -33448900, -70698474, 8.00f, 90.0f},
+    {30000, -33448900, -70698388, 8.00f, 90.0f},
+    {31000, -33448900, -70698302, 8.00f, 90.0f},
+    {32000, -33448900, -70698216, 8.00f, 90.0f},
+    {33000, -33448900, -70698130, 8.00f, 90.0f},
+    {34000, -33448900, -70698043, 8.00f, 90.0f},
+    {35000, -33448900, -70697957, 8.00f, 90.0f},
+    {36000, -33448900, -70697871, 8.00f, 90.0f},
+    {37000, -33448900, -70697785, 8.00f, 90.0f},
+    {38000, -33448900, -70697699, 8.00f, 90.0f},
+    {39000, -33448900, -70697613, 8.00f, 90.0f},
+    {40000, -33448900, -70697527, 8.00f, 90.0f},
+    {41000, -33448900, -70697441, 8.00f, 90.0f},
+    {42000, -33448900, -70697354, 8.00f, 90.0f},
+    {43000, -33448900, -70697268, 8.00f, 90.0f},
+    {44000, -33448900, -70697182, 8.00f, 90.0f},
+    {45000, -33448900, -70697096, 8.00f, 90.0f},
+    {46000, -33448900, -70697010, 8.00f, 90.0f},
+    {47000, -33448900, -70696924, 8.00f, 90.0f},
+    {48000, -33448900, -70696838, 8.00f, 90.0f},
+    {49000, -33448900, -70696751, 8.00f, 90.0f},
+    {50000, -33448900, -70696665, 8.00f, 90.0f},
+    {51000, -33448900, -70696579, 8.00f, 90.0f},
+    {52000, -33448900, -70696493, 8.00f, 90.0f},
+    {53000, -33448900, -70696407, 8.00f, 90.0f},
+    {54000, -33448900, -70696321, 8.00f, 90.0f},
+    {55000, -33448900, -70696235, 8.00f, 90.0f},
+    {56000, -33448900, -70696149, 8.00f, 90.0f},
+    {57000, -33448900, -70696062, 8.00f, 90.0f},
+    {58000, -33448900, -70695976, 8.00f, 90.0f},
+    {59000, -33448900, -70695890, 8.00f, 90.0f},
+    {60000, -33448900, -70695804, 8.00f, 90.0f},
+    {61000, -33448900, -70695718, 8.00f, 90.0f},
+    {62000, -33448900, -70695632, 8.00f, 90.0f},
+    {63000, -33448900, -70695546, 8.00f, 90.0f},
+    {64000, -33448900, -70695460, 8.00f, 90.0f},
+    {65000, -33448900, -70695373, 8.00f, 90.0f},
+    {66000, -33448900, -70695287, 8.00f, 90.0f},
+    {67000, -33448900, -70695201, 8.00f, 90.0f},
+    {68000, -33448900, -70695115, 8.00f, 90.0f},
+    {69000, -33448900, -70695029, 8.00f, 90.0f},
+    {70000, -33448900, -70694943, 8.00f, 90.0f},
+    {71000, -33448900, -70694857, 8.00f, 90.0f},
+    {72000, -33448900, -70694770, 8.00f, 90.0f},
+    {73000, -33448900, -70694684, 8.00f, 90.0f},
+    {74000, -33448900, -70694598, 8.00f, 90.0f},
+    {75000, -33448900, -70694512, 8.00f, 90.0f},
+    {76000, -33448900, -70694426, 8.00f, 90.0f},
+    {77000, -33448900, -70694340, 8.00f, 90.0f},
+    {78000, -33448900, -70694254, 8.00f, 90.0f},
+    {79000, -33448900, -70694168, 8.00f, 90.0f},
+    {80000, -33448900, -70694081, 8.00f, 90.0f},
+    {81000, -33448900, -70693995, 8.00f, 90.0f},
+    {82000, -33448900, -70693909, 8.00f, 90.0f},
+    {83000, -33448900, -70693823, 8.00f, 90.0f},
+    {84000, -33448900, -70693737, 8.00f, 90.0f},
+    {85000, -33448900, -70693651, 8.00f, 90.0f},
+    {86000, -33448900, -70693565, 8.00f, 90.0f},
+    {87000, -33448900, -70693479, 8.00f, 90.0f},
+    {88000, -33448900, -70693392, 8.00f, 90.0f},
+    {89000, -33448900, -70693306, 8.00f, 90.0f},
+    {90000, -33448900, -70693220, 8.00f, 90.0f},
+    {91000, -33448900, -70693134, 8.00f, 90.0f},
+    {92000, -33448900, -70693048, 8.00f, 90.0f},
+    {93000, -33448900, -70692962, 8.00f, 90.0f},
+    {94000, -33448900, -70692876, 8.00f, 90.0f},
+    {95000, -33448900, -70692789, 8.00f, 90.0f},
+    {96000, -33448900, -70692703, 8.00f, 90.0f},
+    {97000, -33448900, -70692617, 8.00f, 90.0f},
+    {98000, -33448900, -70692531, 8.00f, 90.0f},
+    {99000, -33448900, -70692445, 8.00f, 90.0f},
+    {100000, -33448900, -70692359, 8.00f, 90.0f},
+    {101000, -33448900, -70692273, 8.00f, 90.0f},
+    {102000, -33448900, -70692187, 8.00f, 90.0f},
+    {103000, -33448900, -70692100, 8.00f, 90.0f},
+    {104000, -33448900, -70692014, 8.00f, 90.0f},
+    {105000, -33448900, -70691928, 8.00f, 90.0f},
+    {106000, -33448900, -70691842, 8.00f, 90.0f},
+    {107000, -33448900, -70691756, 8.00f, 90.0f},
+    {108000, -33448900, -70691670, 8.00f, 90.0f},
+    {109000, -33448900, -70691584, 8.00f, 90.0f},
+    {110000, -33448900, -70691498, 8.00f, 90.0f},
+    {111000, -33448900, -70691411, 8.00f, 90.0f},
+    {112000, -33448900, -70691325, 8.00f, 90.0f},
+    {113000, -33448900, -70691239, 8.00f, 90.0f},
+    {114000, -33448900, -70691153, 8.00f, 90.0f},
+    {115000, -33448900, -70691067, 8.00f, 90.0f},
+    {116000, -33448900, -70690981, 8.00f, 90.0f},
+    {117000, -33448900, -70690895, 8.00f, 90.0f},
+    {118000, -33448900, -70690808, 8.00f, 90.0f},
+    {119000, -33448900, -70690722, 8.00f, 90.0f},
+    {120000, -33448900, -70690636, 8.00f, 90.0f},
+    {121000, -33448900, -70690550, 8.00f, 90.0f},
+    {122000, -33448900, -70690464, 8.00f, 90.0f},
+    {123000, -33448900, -70690378, 8.00f, 90.0f},
+    {124000, -33448900, -70690292, 8.00f, 90.0f},
+    {125000, -33448900, -70690206, 8.00f, 90.0f},
+    {126000, -33448900, -70690119, 8.00f, 90.0f},
+    {127000, -33448900, -70690033, 8.00f, 90.0f},
+    {128000, -33448900, -70689947, 8.00f, 90.0f},
+    {129000, -33448900, -70689861, 8.00f, 90.0f},
+    {130000, -33448900, -70689775, 8.00f, 90.0f},
+    {131000, -33448900, -70689689, 8.00f, 90.0f},
+    {132000, -33448900, -70689603, 8.00f, 90.0f},
+    {133000, -33448900, -70689517, 8.00f, 90.0f},
+    {134000, -33448900, -70689430, 8.00f, 90.0f},
+    {135000, -33448900, -70689344, 8.00f, 90.0f},
+    {136000, -33448900, -70689258, 8.00f, 90.0f},
+    {137000, -33448900, -70689172, 8.00f, 90.0f},
+    {138000, -33448900, -70689086, 8.00f, 90.0f},
+    {139000, -33448900, -70689000, 8.00f, 90.0f},
+    {140000, -33448900, -70688914, 8.00f, 90.0f},
+    {141000, -33448900, -70688827, 8.00f, 90.0f},
+    {142000, -33448900, -70688741, 8.00f, 90.0f},
+    {143000, -33448900, -70688655, 8.00f, 90.0f},
+    {144000, -33448900, -70688569, 8.00f, 90.0f},
+    {145000, -33448900, -70688483, 8.00f, 90.0f},
+    {146000, -33448900, -70688397, 8.00f, 90.0f},
+    {147000, -33448900, -70688311, 8.00f, 90.0f},
+    {148000, -33448900, -70688225, 8.00f, 90.0f},
+    {149000, -33448900, -70688138, 8.00f, 90.0f},
+    {150000, -33448900, -70688052, 8.00f, 90.0f},
+    {151000, -33448900, -70687966, 8.00f, 90.0f},
+    {152000, -33448900, -70687880, 8.00f, 90.0f},
+    {153000, -33448900, -70687794, 8.00f, 90.0f},
+    {154000, -33448900, -70687708, 8.00f, 90.0f},
+    {155000, -33448900, -70687622, 8.00f, 90.0f},
+    {156000, -33448900, -70687536, 8.00f, 90.0f},
+    {157000, -33448900, -70687449, 8.00f, 90.0f},
+    {158000, -33448900, -70687363, 8.00f, 90.0f},
+    {159000, -33448900, -70687277, 8.00f, 90.0f},
+    {160000, -33448900, -70687191, 8.00f, 90.0f},
+    {161000, -33448900, -70687105, 8.00f, 90.0f},
+    {162000, -33448900, -70687019, 8.00f, 90.0f},
+    {163000, -33448900, -70686933, 8.00f, 90.0f},
+    {164000, -33448900, -70686847, 8.00f, 90.0f},
+    {165000, -33448900, -70686760, 8.00f, 90.0f},
+    {166000, -33448900, -70686674, 8.00f, 90.0f},
+    {167000, -33448900, -70686588, 8.00f, 90.0f},
+    {168000, -33448900, -70686502, 8.00f, 90.0f},
+    {169000, -33448900, -70686416, 8.00f, 90.0f},
+    {170000, -33448900, -70686330, 8.00f, 90.0f},
+    {171000, -33448900, -70686244, 8.00f, 90.0f},
+    {172000, -33448900, -70686157, 8.00f, 90.0f},
+    {173000, -33448900, -70686071, 8.00f, 90.0f},
+    {174000, -33448900, -70685985, 8.00f, 90.0f},
+    {175000, -33448900, -70685899, 8.00f, 90.0f},
+    {176000, -33448900, -70685813, 8.00f, 90.0f},
+    {177000, -33448900, -70685727, 8.00f, 90.0f},
+    {178000, -33448900, -70685641, 8.00f, 90.0f},
+    {179000, -33448900, -70685555, 8.00f, 90.0f},
+    {180000, -33448900, -70685468, 8.00f, 90.0f},
+    {181000, -33448900, -70685382, 8.00f, 90.0f},
+    {182000, -33448900, -70685296, 8.00f, 90.0f},
+    {183000, -33448900, -70685210, 8.00f, 90.0f},
+    {184000, -33448900, -70685124, 8.00f, 90.0f},
+    {185000, -33448900, -70685038, 8.00f, 90.0f},
+    {186000, -33448900, -70684952, 8.00f, 90.0f},
+    {187000, -33448900, -70684866, 8.00f, 90.0f},
+    {188000, -33448900, -70684779, 8.00f, 90.0f},
+    {189000, -33448900, -70684693, 8.00f, 90.0f},
+    {190000, -33448900, -70684607, 8.00f, 90.0f},
+    {191000, -33448900, -70684521, 8.00f, 90.0f},
+    {192000, -33448900, -70684435, 8.00f, 90.0f},
+    {193000, -33448900, -70684349, 8.00f, 90.0f},
+    {194000, -33448900, -70684263, 8.00f, 90.0f},
+    {195000, -33448900, -70684176, 8.00f, 90.0f},
+    {196000, -33448900, -70684090, 8.00f, 90.0f},
+    {197000, -33448900, -70684004, 8.00f, 90.0f},
+    {198000, -33448900, -70683918, 8.00f, 90.0f},
+    {199000, -33448900, -70683832, 8.00f, 90.0f},
+    {200000, -33448900, -70683746, 8.00f, 90.0f},
+    {201000, -33448900, -70683660, 8.00f, 90.0f},
+    {202000, -33448900, -70683574, 8.00f, 90.0f},
+    {203000, -33448900, -70683487, 8.00f, 90.0f},
+    {204000, -33448900, -70683401, 8.00f, 90.0f},
+    {205000, -33448900, -70683315, 8.00f, 90.0f},
+    {206000, -33448900, -70683229, 8.00f, 90.0f},
+    {207000, -33448900, -70683143, 8.00f, 90.0f},
+    {208000, -33448900, -70683057, 8.00f, 90.0f},
+    {209000, -33448900, -70682971, 8.00f, 90.0f},
+    {210000, -33448900, -70682885, 8.00f, 90.0f},
+    {211000, -33448900, -70682798, 8.00f, 90.0f},
+    {212000, -33448900, -70682712, 8.00f, 90.0f},
+    {213000, -33448900, -70682626, 8.00f, 90.0f},
+    {214000, -33448900, -70682540, 8.00f, 90.0f},
+    {215000, -33448900, -70682454, 8.00f, 90.0f},
+    {216000, -33448900, -70682368, 8.00f, 90.0f},
+    {217000, -33448900, -70682282, 8.00f, 90.0f},
+    {218000, -33448900, -70682195, 8.00f, 90.0f},
+    {219000, -33448900, -70682109, 8.00f, 90.0f},
+    {220000, -33448900, -70682023, 8.00f, 90.0f},
+    {221000, -33448900, -70681937, 8.00f, 90.0f},
+    {222000, -33448900, -70681851, 8.00f, 90.0f},
+    {223000, -33448900, -70681765, 8.00f, 90.0f},
+    {224000, -33448900, -70681679, 8.00f, 90.0f},
+    {225000, -33448900, -70681593, 8.00f, 90.0f},
+    {226000, -33448900, -70681506, 8.00f, 90.0f},
+    {227000, -33448900, -70681420, 8.00f, 90.0f},
+    {228000, -33448900, -70681334, 8.00f, 90.0f},
+    {229000, -33448900, -70681248, 8.00f, 90.0f},
+    {230000, -33448900, -70681162, 8.00f, 90.0f},
+    {231000, -33448900, -70681076, 8.00f, 90.0f},
+    {232000, -33448900, -70680990, 8.00f, 90.0f},
+    {233000, -33448900, -70680904, 8.00f, 90.0f},
+    {234000, -33448900, -70680817, 8.00f, 90.0f},
+    {235000, -33448900, -70680731, 8.00f, 90.0f},
+    {236000, -33448900, -70680645, 8.00f, 90.0f},
+    {237000, -33448900, -70680559, 8.00f, 90.0f},
+    {238000, -33448900, -70680473, 8.00f, 90.0f},
+    {239000, -33448900, -70680387, 8.00f, 90.0f},
+    {240000, -33448900, -70680301, 8.00f, 90.0f},
+    {241000, -33448900, -70680214, 8.00f, 90.0f},
+    {242000, -33448900, -70680128, 8.00f, 90.0f},
+    {243000, -33448900, -70680042, 8.00f, 90.0f},
+    {244000, -33448900, -70679956, 8.00f, 90.0f},
+    {245000, -33448900, -70679870, 8.00f, 90.0f},
+    {246000, -33448900, -70679784, 8.00f, 90.0f},
+    {247000, -33448900, -70679698, 8.00f, 90.0f},
+    {248000, -33448900, -70679612, 8.00f, 90.0f},
+    {249000, -33448900, -70679525, 8.00f, 90.0f},
+    {250000, -33448900, -70679439, 8.00f, 90.0f},
+    {251000, -33448900, -70679353, 8.00f, 90.0f},
+    {252000, -33448900, -70679267, 8.00f, 90.0f},
+    {253000, -33448900, -70679181, 8.00f, 90.0f},
+    {254000, -33448900, -70679095, 8.00f, 90.0f},
+    {255000, -33448900, -70679009, 8.00f, 90.0f},
+    {256000, -33448900, -70678923, 8.00f, 90.0f},
+    {257000, -33448900, -70678836, 8.00f, 90.0f},
+    {258000, -33448900, -70678750, 8.00f, 90.0f},
+    {259000, -33448900, -70678664, 8.00f, 90.0f},
+    {260000, -33448900, -70678578, 8.00f, 90.0f},
+    {261000, -33448900, -70678492, 8.00f, 90.0f},
+    {262000, -33448900, -70678406, 8.00f, 90.0f},
+    {263000, -33448900, -70678320, 8.00f, 90.0f},
+    {264000, -33448900, -70678233, 8.00f, 90.0f},
+    {265000, -33448900, -70678147, 8.00f, 90.0f},
+    {266000, -33448900, -70678061, 8.00f, 90.0f},
+    {267000, -33448900, -70677975, 8.00f, 90.0f},
+    {268000, -33448900, -70677889, 8.00f, 90.0f},
+    {269000, -33448900, -70677803, 8.00f, 90.0f},
+    {270000, -33448900, -70677717, 8.00f, 90.0f},
+    {271000, -33448900, -70677631, 8.00f, 90.0f},
+    {272000, -33448900, -70677544, 8.00f, 90.0f},
+    {273000, -33448900, -70677458, 8.00f, 90.0f},
+    {274000, -33448900, -70677372, 8.00f, 90.0f},
+    {275000, -33448900, -70677286, 8.00f, 90.0f},
+    {276000, -33448900, -70677200, 8.00f, 90.0f},
+    {277000, -33448900, -70677114, 8.00f, 90.0f},
+    {278000, -33448900, -70677028, 8.00f, 90.0f},
+    {279000, -33448900, -70676942, 8.00f, 90.0f},
+    {280000, -33448900, -70676855, 8.00f, 90.0f},
+    {281000, -33448900, -70676769, 8.00f, 90.0f},
+    {282000, -33448900, -70676683, 8.00f, 90.0f},
+    {283000, -33448900, -70676597, 8.00f, 90.0f},
+    {284000, -33448900, -70676511, 8.00f, 90.0f},
+    {285000, -33448900, -70676425, 8.00f, 90.0f},
+    {286000, -33448900, -70676339, 8.00f, 90.0f},
+    {287000, -33448900, -70676252, 8.00f, 90.0f},
+    {288000, -33448900, -70676166, 8.00f, 90.0f},
+    {289000, -33448900, -70676080, 8.00f, 90.0f},
+    {290000, -33448900, -70675994, 8.00f, 90.0f},
+    {291000, -33448900, -70675908, 8.00f, 90.0f},
+    {292000, -33448900, -70675822, 8.00f, 90.0f},
+    {293000, -33448900, -70675736, 8.00f, 90.0f},
+    {294000, -33448900, -70675650, 8.00f, 90.0f},
+    {295000, -33448900, -70675563, 8.00f, 90.0f},
+    {296000, -33448900, -70675477, 8.00f, 90.0f},
+    {297000, -33448900, -70675391, 8.00f, 90.0f},
+    {298000, -33448900, -70675305, 8.00f, 90.0f},
+    {299000, -33448900, -70675219, 8.00f, 90.0f},
+    {300000, -33448900, -70675133, 8.00f, 90.0f},
+    {301000, -33448900, -70675047, 8.00f, 90.0f},
+    {302000, -33448900, -70674961, 8.00f, 90.0f},
+    {303000, -33448900, -70674874, 8.00f, 90.0f},
+    {304000, -33448900, -70674788, 8.00f, 90.0f},
+    {305000, -33448900, -70674702, 8.00f, 90.0f},
+    {306000, -33448900, -70674616, 8.00f, 90.0f},
+    {307000, -33448900, -70674530, 8.00f, 90.0f},
+    {308000, -33448900, -70674444, 8.00f, 90.0f},
+    {309000, -33448900, -70674358, 8.00f, 90.0f},
+    {310000, -33448900, -70674271, 8.00f, 90.0f},
+    {311000, -33448900, -70674185, 8.00f, 90.0f},
+    {312000, -33448900, -70674099, 8.00f, 90.0f},
+    {313000, -33448900, -70674013, 8.00f, 90.0f},
+    {314000, -33448900, -70673927, 8.00f, 90.0f},
+    {315000, -33448900, -70673841, 8.00f, 90.0f},
+    {316000, -33448900, -70673755, 8.00f, 90.0f},
+    {317000, -33448900, -70673669, 8.00f, 90.0f},
+    {318000, -33448900, -70673582, 8.00f, 90.0f},
+    {319000, -33448900, -70673496, 8.00f, 90.0f},
+    {320000, -33448900, -70673410, 8.00f, 90.0f},
+    {321000, -33448900, -70673324, 8.00f, 90.0f},
+    {322000, -33448900, -70673238, 8.00f, 90.0f},
+    {323000, -33448900, -70673152, 8.00f, 90.0f},
+    {324000, -33448900, -70673066, 8.00f, 90.0f},
+    {325000, -33448900, -70672980, 8.00f, 90.0f},
+    {326000, -33448900, -70672893, 8.00f, 90.0f},
+    {327000, -33448900, -70672807, 8.00f, 90.0f},
+    {328000, -33448900, -70672721, 8.00f, 90.0f},
+    {329000, -33448900, -70672635, 8.00f, 90.0f},
+    {330000, -33448900, -70672549, 8.00f, 90.0f},
+    {331000, -33448900, -70672463, 8.00f, 90.0f},
+    {332000, -33448900, -70672377, 8.00f, 90.0f},
+    {333000, -33448900, -70672290, 8.00f, 90.0f},
+    {334000, -33448900, -70672204, 8.00f, 90.0f},
+    {335000, -33448900, -70672118, 8.00f, 90.0f},
+    {336000, -33448900, -70672032, 8.00f, 90.0f},
+    {337000, -33448900, -70671946, 8.00f, 90.0f},
+    {338000, -33448900, -70671860, 8.00f, 90.0f},
+    {339000, -33448900, -70671774, 8.00f, 90.0f},
+    {340000, -33448900, -70671688, 8.00f, 90.0f},
+    {341000, -33448900, -70671601, 8.00f, 90.0f},
+    {342000, -33448900, -70671515, 8.00f, 90.0f},
+    {343000, -33448900, -70671429, 8.00f, 90.0f},
+    {344000, -33448900, -70671343, 8.00f, 90.0f},
+    {345000, -33448900, -70671257, 8.00f, 90.0f},
+    {346000, -33448900, -70671171, 8.00f, 90.0f},
+    {347000, -33448900, -70671085, 8.00f, 90.0f},
+    {348000, -33448900, -70670999, 8.00f, 90.0f},
+    {349000, -33448900, -70670912, 8.00f, 90.0f},
+    {350000, -33448900, -70670826, 8.00f, 90.0f},
+    {351000, -33448900, -70670740, 8.00f, 90.0f},
+    {352000, -33448900, -70670654, 8.00f, 90.0f},
+    {353000, -33448900, -70670568, 8.00f, 90.0f},
+    {354000, -33448900, -70670482, 8.00f, 90.0f},
+    {355000, -33448900, -70670396, 8.00f, 90.0f},
+    {356000, -33448900, -70670309, 8.00f, 90.0f},
+    {357000, -33448900, -70670223, 8.00f, 90.0f},
+    {358000, -33448900, -70670137, 8.00f, 90.0f},
+    {359000, -33448900, -70670051, 8.00f, 90.0f},
+    {360000, -33448900, -70669965, 8.00f, 90.0f},
+    {361000, -33448900, -70669879, 8.00f, 90.0f},
+    {362000, -33448900, -70669793, 8.00f, 90.0f},
+    {363000, -33448900, -70669707, 8.00f, 90.0f},
+    {364000, -33448900, -70669620, 8.00f, 90.0f},
+    {365000, -33448900, -70669534, 8.00f, 90.0f},
+    {366000, -33448900, -70669448, 8.00f, 90.0f},
+    {367000, -33448900, -70669362, 8.00f, 90.0f},
+    {368000, -33448900, -70669261, 10.70f, 90.0f},
+    {369000, -33448900, -70669128, 13.70f, 90.0f},
+    {370000, -33448900, -70668963, 16.70f, 90.0f},
+    {371000, -33448900, -70668766, 19.70f, 90.0f},
+    {372000, -33448900, -70668536, 22.70f, 90.0f},
+    {373000, -33448900, -70668275, 25.00f, 90.0f},
+    {374000, -33448900, -70668006, 25.00f, 90.0f},
+    {375000, -33448900, -70667737, 25.00f, 90.0f},
+    {376000, -33448900, -70667467, 25.00f, 90.0f},
+    {377000, -33448900, -70667198, 25.00f, 90.0f},
+    {378000, -33448900, -70666929, 25.00f, 90.0f},
+    {379000, -33448900, -70666660, 25.00f, 90.0f},
+    {380000, -33448900, -70666391, 25.00f, 90.0f},
+    {381000, -33448900, -70666122, 25.00f, 90.0f},
+    {382000, -33448900, -70665852, 25.00f, 90.0f},
+    {383000, -33448900, -70665583, 25.00f, 90.0f},
+    {384000, -33448900, -70665314, 25.00f, 90.0f},
+    {385000, -33448900, -70665045, 25.00f, 90.0f},
+    {386000, -33448900, -70664776, 25.00f, 90.0f},
+    {387000, -33448900, -70664507, 25.00f, 90.0f},
+    {388000, -33448900, -70664238, 25.00f, 90.0f},
+    {389000, -33448900, -70663968, 25.00f, 90.0f},
+    {390000, -33448900, -70663699, 25.00f, 90.0f},
+    {391000, -33448900, -70663430, 25.00f, 90.0f},
+    {392000, -33448900, -70663161, 25.00f, 90.0f},
+    {393000, -33448900, -70662892, 25.00f, 90.0f},
+    {394000, -33448900, -70662623, 25.00f, 90.0f},
+    {395000, -33448900, -70662353, 25.00f, 90.0f},
+    {396000, -33448900, -70662084, 25.00f, 90.0f},
+    {397000, -33448900, -70661815, 25.00f, 90.0f},
+    {398000, -33448900, -70661546, 25.00f, 90.0f},
+    {399000, -33448900, -70661277, 25.00f, 90.0f},
+    {400000, -33448900, -70661008, 25.00f, 90.0f},
+    {401000, -33448900, -70660738, 25.00f, 90.0f},
+    {402000, -33448900, -70660469, 25.00f, 90.0f},
+    {403000, -33448900, -70660200, 25.00f, 90.0f},
+    {404000, -33448934, -70660135, 23.80f, 247.3f},
+    {405000, -33449010, -70660355, 20.80f, 247.3f},
+    {406000, -33449077, -70660545, 17.80f, 247.3f},
+    {407000, -33449132, -70660706, 14.80f, 247.3f},
+    {408000, -33449178, -70660836, 11.80f, 247.3f},
+    {409000, -33449213, -70660937, 8.80f, 247.3f},
+    {410000, -33449238, -70661008, 5.80f, 247.3f},
+    {411000, -33449252, -70661050, 3.00f, 247.3f},
+    {412000, -33449263, -70661080, 3.00f, 247.3f},
+    {413000, -33449273, -70661109, 3.00f, 247.3f},
+    {414000, -33449283, -70661139, 3.00f, 247.3f},
+    {415000, -33449294, -70661169, 3.00f, 247.3f},
+    {416000, -33449304, -70661199, 3.00f, 247.3f},
+    {417000, -33449315, -70661229, 3.00f, 247.3f},
+    {418000, -33449325, -70661258, 3.00f, 247.3f},
+    {419000, -33449335, -70661288, 3.00f, 247.3f},
+    {420000, -33449346, -70661318, 3.00f, 247.3f},
+    {421000, -33449356, -70661348, 3.00f, 247.3f},
+    {422000, -33449367, -70661378, 3.00f, 247.3f},
+    {423000, -33449377, -70661407, 3.00f, 247.3f},
+    {424000, -33449387, -70661437, 3.00f, 247.3f},
+    {425000, -33449398, -70661467, 3.00f, 247.3f},
+    {426000, -33449408, -70661497, 3.00f, 247.3f},
+    {427000, -33449418, -70661527, 3.00f, 247.3f},
+    {428000, -33449429, -70661556, 3.00f, 247.3f},
+    {429000, -33449439, -70661586, 3.00f, 247.3f},
+    {430000, -33449450, -70661616, 3.00f, 247.3f},
+    {431000, -33449460, -70661646, 3.00f, 247.3f},
+    {432000, -33449470, -70661676, 3.00f, 247.3f},
+    {433000, -33449481, -70661705, 3.00f, 247.3f},
+    {434000, -33449491, -70661735, 3.00f, 247.3f},
+    {435000, -33449502, -70661765, 3.00f, 247.3f},
+    {436000, -33449512, -70661795, 3.00f, 247.3f},
+    {437000, -33449522, -70661825, 3.00f, 247.3f},
+    {438000, -33449533, -70661854, 3.00f, 247.3f},
+    {439000, -33449543, -70661884, 3.00f, 247.3f},
+    {440000, -33449553, -70661914, 3.00f, 247.3f},
+    {441000, -33449564, -70661944, 3.00f, 247.3f},
+    {442000, -33449574, -70661974, 3.00f, 247.3f},
+    {443000, -33449585, -70662003, 3.00f, 247.3f},
+    {444000, -33449595, -70662033, 3.00f, 247.3f},
+    {445000, -33449605, -70662063, 3.00f, 247.3f},
+    {446000, -33449616, -70662093, 3.00f, 247.3f},
+    {447000, -33449626, -70662123, 3.00f, 247.3f},
+    {448000, -33449637, -70662152, 3.00f, 247.3f},
+    {449000, -33449647, -70662182, 3.00f, 247.3f},
+    {450000, -33449657, -70662212, 3.00f, 247.3f},
+    {451000, -33449668, -70662242, 3.00f, 247.3f},
+    {452000, -33449678, -70662272, 3.00f, 247.3f},
+    {453000, -33449689, -70662301, 3.00f, 247.3f},
+    {454000, -33449699, -70662331, 3.00f, 247.3f},
+    {455000, -33449709, -70662361, 3.00f, 247.3f},
+    {456000, -33449720, -70662391, 3.00f, 247.3f},
+    {457000, -33449730, -70662421, 3.00f, 247.3f},
+    {458000, -33449740, -70662451, 3.00f, 247.3f},
+    {459000, -33449751, -70662480, 3.00f, 247.3f},
+    {460000, -33449761, -70662510, 3.00f, 247.3f},
+    {461000, -33449772, -70662540, 3.00f, 247.3f},
+    {462000, -33449782, -70662570, 3.00f, 247.3f},
+    {463000, -33449792, -70662600, 3.00f, 247.3f},
+    {464000, -33449803, -70662629, 3.00f, 247.3f},
+    {465000, -33449813, -70662659, 3.00f, 247.3f},
+    {466000, -33449824, -70662689, 3.00f, 247.3f},
+    {467000, -33449834, -70662719, 3.00f, 247.3f},
+    {468000, -33449844, -70662749, 3.00f, 247.3f},
+    {469000, -33449855, -70662778, 3.00f, 247.3f},
+    {470000, -33449865, -70662808, 3.00f, 247.3f},
+    {471000, -33449875, -70662838, 3.00f, 247.3f},
+    {472000, -33449886, -70662868, 3.00f, 247.3f},
+    {473000, -33449896, -70662898, 3.00f, 247.3f},
+    {474000, -33449907, -70662927, 3.00f, 247.3f},
+    {475000, -33449917, -70662957, 3.00f, 247.3f},
+    {476000, -33449927, -70662987, 3.00f, 247.3f},
+    {477000, -33449938, -70663017, 3.00f, 247.3f},
+    {478000, -33449948, -70663047, 3.00f, 247.3f},
+    {479000, -33449959, -70663076, 3.00f, 247.3f},
+    {480000, -33449969, -70663106, 3.00f, 247.3f},
+    {481000, -33449979, -70663136, 3.00f, 247.3f},
+    {482000, -33449990, -70663166, 3.00f, 247.3f},
+    {483000, -33450000, -70663196, 3.00f, 247.3f},
+    {484000, -33450010, -70663225, 3.00f, 247.3f},
+    {485000, -33450021, -70663255, 3.00f, 247.3f},
+    {486000, -33450031, -70663285, 3.00f, 247.3f},
+    {487000, -33450042, -70663315, 3.00f, 247.3f},
+    {488000, -33450052, -70663345, 3.00f, 247.3f},
+    {489000, -33450062, -70663374, 3.00f, 247.3f},
+    {490000, -33450073, -70663404, 3.00f, 247.3f},
+    {491000, -33450083, -70663434, 3.00f, 247.3f},
+    {492000, -33450094, -70663464, 3.00f, 247.3f},
+    {493000, -33450104, -70663494, 3.00f, 247.3f},
+    {494000, -33450114, -70663523, 3.00f, 247.3f},
+    {495000, -33450125, -70663553, 3.00f, 247.3f},
+    {496000, -33450135, -70663583, 3.00f, 247.3f},
+    {497000, -33450145, -70663613, 3.00f, 247.3f},
+    {498000, -33450156, -70663643, 3.00f, 247.3f},
+    {499000, -33450166, -70663672, 3.00f, 247.3f},
+    {500000, -33450177, -70663702, 3.00f, 247.3f},
+    {501000, -33450187, -70663732, 3.00f, 247.3f},
+    {502000, -33450197, -70663762, 3.00f, 247.3f},
+    {503000, -33450208, -70663792, 3.00f, 247.3f},
+    {504000, -33450218, -70663822, 3.00f, 247.3f},
+    {505000, -33450229, -70663851, 3.00f, 247.3f},
+    {506000, -33450239, -70663881, 3.00f, 247.3f},
+    {507000, -33450249, -70663911, 3.00f, 247.3f},
+    {508000, -33450260, -70663941, 3.00f, 247.3f},
+    {509000, -33450270, -70663971, 3.00f, 247.3f},
+    {510000, -33450281, -70664000, 3.00f, 247.3f},
+    {511000, -33450291, -70664030, 3.00f, 247.3f},
+    {512000, -33450301, -70664060, 3.00f, 247.3f},
+    {513000, -33450312, -70664090, 3.00f, 247.3f},
+    {514000, -33450322, -70664120, 3.00f, 247.3f},
+    {515000, -33450332, -70664149, 3.00f, 247.3f},
+    {516000, -33450343, -70664179, 3.00f, 247.3f},
+    {517000, -33450353, -70664209, 3.00f, 247.3f},
+    {518000, -33450364, -70664239, 3.00f, 247.3f},
+    {519000, -33450374, -70664269, 3.00f, 247.3f},
+    {520000, -33450384, -70664298, 3.00f, 247.3f},
+    {521000, -33450395, -70664328, 3.00f, 247.3f},
+    {522000, -33450405, -70664358, 3.00f, 247.3f},
+    {523000, -33450416, -70664388, 3.00f, 247.3f},
+    {524000, -33450426, -70664418, 3.00f, 247.3f},
+    {525000, -33450436, -70664447, 3.00f, 247.3f},
+    {526000, -33450447, -70664477, 3.00f, 247.3f},
+    {527000, -33450457, -70664507, 3.00f, 247.3f},
+    {528000, -33450467, -70664537, 3.00f, 247.3f},
+    {529000, -33450478, -70664567, 3.00f, 247.3f},
+    {530000, -33450488, -70664596, 3.00f, 247.3f},
+    {531000, -33450499, -70664626, 3.00f, 247.3f},
+    {532000, -33450509, -70664656, 3.00f, 247.3f},
+    {533000, -33450519, -70664686, 3.00f, 247.3f},
+    {534000, -33450530, -70664716, 3.00f, 247.3f},
+    {535000, -33450540, -70664745, 3.00f, 247.3f},
+    {536000, -33450551, -70664775, 3.00f, 247.3f},
+    {537000, -33450561, -70664805, 3.00f, 247.3f},
+    {538000, -33450571, -70664835, 3.00f, 247.3f},
+    {539000, -33450582, -70664865, 3.00f, 247.3f},
+    {540000, -33450592, -70664894, 3.00f, 247.3f},
+    {541000, -33450602, -70664924, 3.00f, 247.3f},
+    {542000, -33450613, -70664954, 3.00f, 247.3f},
+    {543000, -33450623, -70664984, 3.00f, 247.3f},
+    {544000, -33450634, -70665014, 3.00f, 247.3f},
+    {545000, -33450644, -70665044, 3.00f, 247.3f},
+    {546000, -33450654, -70665073, 3.00f, 247.3f},
+    {547000, -33450665, -70665103, 3.00f, 247.3f},
+    {548000, -33450675, -70665133, 3.00f, 247.3f},
+    {549000, -33450686, -70665163, 3.00f, 247.3f},
+    {550000, -33450696, -70665193, 3.00f, 247.3f},
+    {551000, -33450706, -70665222, 3.00f, 247.3f},
+    {552000, -33450717, -70665252, 3.00f, 247.3f},
+    {553000, -33450727, -70665282, 3.00f, 247.3f},
+    {554000, -33450737, -70665312, 3.00f, 247.3f},
+    {555000, -33450748, -70665342, 3.00f, 247.3f},
+    {556000, -33450758, -70665371, 3.00f, 247.3f},
+    {557000, -33450769, -70665401, 3.00f, 247.3f},
+    {558000, -33450779, -70665431, 3.00f, 247.3f},
+    {559000, -33450789, -70665461, 3.00f, 247.3f},
+    {560000, -33450800, -70665491, 3.00f, 247.3f},
+    {561000, -33450810, -70665520, 3.00f, 247.3f},
+    {562000, -33450821, -70665550, 3.00f, 247.3f},
+    {563000, -33450831, -70665580, 3.00f, 247.3f},
+    {564000, -33450841, -70665610, 3.00f, 247.3f},
+    {565000, -33450852, -70665640, 3.00f, 247.3f},
+    {566000, -33450862, -70665669, 3.00f, 247.3f},
+    {567000, -33450872, -70665699, 3.00f, 247.3f},
+    {568000, -33450883, -70665729, 3.00f, 247.3f},
+    {569000, -33450893, -70665759, 3.00f, 247.3f},
+    {570000, -33450904, -70665789, 3.00f, 247.3f},
+    {571000, -33450914, -70665818, 3.00f, 247.3f},
+    {572000, -33450924, -70665848, 3.00f, 247.3f},
+    {573000, -33450935, -70665878, 3.00f, 247.3f},
+    {574000, -33450945, -70665908, 3.00f, 247.3f},
+    {575000, -33450956, -70665938, 3.00f, 247.3f},
+    {576000, -33450966, -70665967, 3.00f, 247.3f},
+    {577000, -33450976, -70665997, 3.00f, 247.3f},
+    {578000, -33450987, -70666027, 3.00f, 247.3f},
+    {579000, -33450997, -70666057, 3.00f, 247.3f},
+    {580000, -33451008, -70666087, 3.00f, 247.3f},
+    {581000, -33451018, -70666116, 3.00f, 247.3f},
+    {582000, -33451028, -70666146, 3.00f, 247.3f},
+    {583000, -33451039, -70666176, 3.00f, 247.3f},
+    {584000, -33451049, -70666206, 3.00f, 247.3f},
+    {585000, -33451059, -70666236, 3.00f, 247.3f},
+    {586000, -33451070, -70666265, 3.00f, 247.3f},
+    {587000, -33451080, -70666295, 3.00f, 247.3f},
+    {588000, -33451091, -70666325, 3.00f, 247.3f},
+    {589000, -33451101, -70666355, 3.00f, 247.3f},
+    {590000, -33451111, -70666385, 3.00f, 247.3f},
+    {591000, -33451122, -70666415, 3.00f, 247.3f},
+    {592000, -33451132, -70666444, 3.00f, 247.3f},
+    {593000, -33451143, -70666474, 3.00f, 247.3f},
+    {594000, -33451153, -70666504, 3.00f, 247.3f},
+    {595000, -33451163, -70666534, 3.00f, 247.3f},
+    {596000, -33451174, -70666564, 3.00f, 247.3f},
+    {597000, -33451184, -70666593, 3.00f, 247.3f},
+    {598000, -33451194, -70666623, 3.00f, 247.3f},
+    {599000, -33451205, -70666653, 3.00f, 247.3f},
+    {600000, -33451215, -70666683, 3.00f, 247.3f},
+    {601000, -33451226, -70666713, 3.00f, 247.3f},
+    {602000, -33451236, -70666742, 3.00f, 247.3f},
+    {603000, -33451246, -70666772, 3.00f, 247.3f},
+    {604000, -33451257, -70666802, 3.00f, 247.3f},
+    {605000, -33451267, -70666832, 3.00f, 247.3f},
+    {606000, -33451278, -70666862, 3.00f, 247.3f},
+    {607000, -33451288, -70666891, 3.00f, 247.3f},
+    {608000, -33451298, -70666921, 3.00f, 247.3f},
+    {609000, -33451309, -70666951, 3.00f, 247.3f},
+    {610000, -33451319, -70666981, 3.00f, 247.3f},
+    {611000, -33451329, -70667011, 3.00f, 247.3f},
+    {612000, -33451340, -70667040, 3.00f, 247.3f},
+    {613000, -33451350, -70667070, 3.00f, 247.3f},
+    {614000, -33451361, -70667100, 3.00f, 247.3f},
+    {615000, -33451371, -70667130, 3.00f, 247.3f},
+    {616000, -33451381, -70667160, 3.00f, 247.3f},
+    {617000, -33451392, -70667189, 3.00f, 247.3f},
+    {618000, -33451402, -70667219, 3.00f, 247.3f},
+    {619000, -33451413, -70667249, 3.00f, 247.3f},
+    {620000, -33451423, -70667279, 3.00f, 247.3f},
+    {621000, -33451433, -70667309, 3.00f, 247.3f},
+    {622000, -33451444, -70667338, 3.00f, 247.3f},
+    {623000, -33451454, -70667368, 3.00f, 247.3f},
+    {624000, -33451464, -70667398, 3.00f, 247.3f},
+    {625000, -33451475, -70667428, 3.00f, 247.3f},
+    {626000, -33451483, -70667459, 3.60f, 269.9f},
+    {627000, -33451483, -70667516, 6.60f, 269.9f},
+    {628000, -33451483, -70667605, 9.60f, 269.9f},
+    {629000, -33451484, -70667726, 12.60f, 269.9f},
+    {630000, -33451484, -70667879, 15.60f, 269.9f},
+    {631000, -33451484, -70668065, 18.60f, 269.9f},
+    {632000, -33451484, -70668283, 21.60f, 269.9f},
+    {633000, -33451485, -70668533, 24.60f, 269.9f},
+    {634000, -33451485, -70668816, 27.60f, 269.9f},
+    {635000, -33451485, -70669130, 30.00f, 269.9f},
+    {636000, -33451486, -70669453, 30.00f, 269.9f},
+    {637000, -33451486, -70669776, 30.00f, 269.9f},
+    {638000, -33451487, -70670099, 30.00f, 269.9f},
+    {639000, -33451487, -70670422, 30.00f, 269.9f},
+    {640000, -33451488, -70670745, 30.00f, 269.9f},
+    {641000, -33451488, -70671068, 30.00f, 269.9f},
+    {642000, -33451488, -70671391, 30.00f, 269.9f},
+    {643000, -33451489, -70671714, 30.00f, 269.9f},
+    {644000, -33451489, -70672037, 30.00f, 269.9f},
+    {645000, -33451490, -70672360, 30.00f, 269.9f},
+    {646000, -33451490, -70672683, 30.00f, 269.9f},
+    {647000, -33451491, -70673006, 30.00f, 269.9f},
+    {648000, -33451491, -70673329, 30.00f, 269.9f},
+    {649000, -33451491, -70673652, 30.00f, 269.9f},
+    {650000, -33451492, -70673975, 30.00f, 269.9f},
+    {651000, -33451492, -70674298, 30.00f, 269.9f},
+    {652000, -33451493, -70674621, 30.00f, 269.9f},
+    {653000, -33451493, -70674944, 30.00f, 269.9f},
+    {654000, -33451494, -70675267, 30.00f, 269.9f},
+    {655000, -33451494, -70675590, 30.00f, 269.9f},
+    {656000, -33451495, -70675913, 30.00f, 269.9f},
+    {657000, -33451495, -70676236, 30.00f, 269.9f},
+    {658000, -33451495, -70676559, 30.00f, 269.9f},
+    {659000, -33451496, -70676882, 30.00f, 269.9f},
+    {660000, -33451496, -70677205, 30.00f, 269.9f},
+    {661000, -33451497, -70677528, 30.00f, 269.9f},
+    {662000, -33451497, -70677851, 30.00f, 269.9f},
+    {663000, -33451498, -70678174, 30.00f, 269.9f},
+    {664000, -33451498, -70678497, 30.00f, 269.9f},
+    {665000, -33451498, -70678820, 30.00f, 269.9f},
+    {666000, -33451499, -70679143, 30.00f, 269.9f},
+    {667000, -33451499, -70679466, 30.00f, 269.9f},
+    {668000, -33451500, -70679789, 30.00f, 269.9f},
+    {669000, -33451639, -70679951, 31.50f, 180.1f},
+    {670000, -33451937, -70679951, 34.50f, 180.1f},
+    {671000, -33452261, -70679952, 37.50f, 180.1f},
+    {672000, -33452612, -70679953, 40.00f, 180.1f},
+    {673000, -33452972, -70679954, 40.00f, 180.1f},
+    {674000, -33453331, -70679955, 40.00f, 180.1f},
+    {675000, -33453690, -70679956, 40.00f, 180.1f},
+    {676000, -33454050, -70679957, 40.00f, 180.1f},
+    {677000, -33454409, -70679958, 40.00f, 180.1f},
+    {678000, -33454768, -70679959, 40.00f, 180.1f},
+    {679000, -33455128, -70679960, 40.00f, 180.1f},
+    {680000, -33455487, -70679961, 40.00f, 180.1f},
+    {681000, -33455846, -70679962, 40.00f, 180.1f},
+    {682000, -33456206, -70679963, 40.00f, 180.1f},
+    {683000, -33456565, -70679964, 40.00f, 180.1f},
+    {684000, -33456924, -70679965, 40.00f, 180.1f},
+    {685000, -33457284, -70679966, 40.00f, 180.1f},
+    {686000, -33457643, -70679967, 40.00f, 180.1f},
+    {687000, -33458002, -70679968, 40.00f, 180.1f},
+    {688000, -33458362, -70679969, 40.00f, 180.1f},
+    {689000, -33458721, -70679970, 40.00f, 180.1f},
+    {690000, -33459080, -70679971, 40.00f, 180.1f},
+    {691000, -33459439, -70679972, 40.00f, 180.1f},
+    {692000, -33459799, -70679973, 40.00f, 180.1f},
+    {693000, -33460158, -70679973, 40.00f, 180.1f},
+    {694000, -33460517, -70679974, 40.00f, 180.1f},
+    {695000, -33460877, -70679975, 40.00f, 180.1f},
+    {696000, -33461236, -70679976, 40.00f, 180.1f},
+    {697000, -33461595, -70679977, 40.00f, 180.1f},
+    {698000, -33461955, -70679978, 40.00f, 180.1f},
+    {699000, -33462314, -70679979, 40.00f, 180.1f},
+    {700000, -33462673, -70679980, 40.00f, 180.1f},
+    {701000, -33463033, -70679981, 40.00f, 180.1f},
+    {702000, -33463392, -70679982, 40.00f, 180.1f},
+    {703000, -33463751, -70679983, 40.00f, 180.1f},
+    {704000, -33464111, -70679984, 40.00f, 180.1f},
+    {705000, -33464470, -70679985, 40.00f, 180.1f},
+    {706000, -33464829, -70679986, 40.00f, 180.1f},
+    {707000, -33465189, -70679987, 40.00f, 180.1f},
+    {708000, -33465548, -70679988, 40.00f, 180.1f},
+    {709000, -33465907, -70679989, 40.00f, 180.1f},
+    {710000, -33466267, -70679990, 40.00f, 180.1f},
+    {711000, -33466626, -70679991, 40.00f, 180.1f},
+    {712000, -33466985, -70679992, 40.00f, 180.1f},
+    {713000, -33467345, -70679993, 40.00f, 180.1f},
+    {714000, -33467704, -70679994, 40.00f, 180.1f},
+    {715000, -33468063, -70679995, 40.00f, 180.1f},
+    {716000, -33468423, -70679996, 40.00f, 180.1f},
+    {717000, -33468782, -70679997, 40.00f, 180.1f},
+    {718000, -33469141, -70679998, 40.00f, 180.1f},
+    {719000, -33469501, -70679999, 40.00f, 180.1f},
+    {720000, -33469860, -70680000, 40.00f, 180.1f},
+    {721000, -33469743, -70679886, 37.90f, 23.0f},
+    {722000, -33469443, -70679734, 34.90f, 23.0f},
+    {723000, -33469168, -70679594, 31.90f, 23.0f},
+    {724000, -33468918, -70679467, 28.90f, 23.0f},
+    {725000, -33468693, -70679352, 25.90f, 23.0f},
+    {726000, -33468492, -70679250, 22.90f, 23.0f},
+    {727000, -33468316, -70679161, 19.90f, 23.0f},
+    {728000, -33468165, -70679084, 16.90f, 23.0f},
+    {729000, -33468039, -70679020, 13.90f, 23.0f},
+    {730000, -33467936, -70678968, 12.00f, 23.0f},
+    {731000, -33467836, -70678917, 12.00f, 23.0f},
+    {732000, -33467737, -70678867, 12.00f, 23.0f},
+    {733000, -33467638, -70678817, 12.00f, 23.0f},
+    {734000, -33467539, -70678766, 12.00f, 23.0f},
+    {735000, -33467439, -70678716, 12.00f, 23.0f},
+    {736000, -33467340, -70678665, 12.00f, 23.0f},
+    {737000, -33467241, -70678615, 12.00f, 23.0f},
+    {738000, -33467142, -70678565, 12.00f, 23.0f},
+    {739000, -33467042, -70678514, 12.00f, 23.0f},
+    {740000, -33466943, -70678464, 12.00f, 23.0f},
+    {741000, -33466844, -70678413, 12.00f, 23.0f},
+    {742000, -33466745, -70678363, 12.00f, 23.0f},
+    {743000, -33466645, -70678313, 12.00f, 23.0f},
+    {744000, -33466546, -70678262, 12.00f, 23.0f},
+    {745000, -33466447, -70678212, 12.00f, 23.0f},
+    {746000, -33466348, -70678161, 12.00f, 23.0f},
+    {747000, -33466248, -70678111, 12.00f, 23.0f},
+    {748000, -33466149, -70678060, 12.00f, 23.0f},
+    {749000, -33466050, -70678010, 12.00f, 23.0f},
+    {750000, -33465951, -70677960, 12.00f, 23.0f},
+    {751000, -33465851, -70677909, 12.00f, 23.0f},
+    {752000, -33465752, -70677859, 12.00f, 23.0f},
+    {753000, -33465653, -70677808, 12.00f, 23.0f},
+    {754000, -33465554, -70677758, 12.00f, 23.0f},
+    {755000, -33465454, -70677708, 12.00f, 23.0f},
+    {756000, -33465355, -70677657, 12.00f, 23.0f},
+    {757000, -33465256, -70677607, 12.00f, 23.0f},
+    {758000, -33465156, -70677556, 12.00f, 23.0f},
+    {759000, -33465057, -70677506, 12.00f, 23.0f},
+    {760000, -33464958, -70677456, 12.00f, 23.0f},
+    {761000, -33464859, -70677405, 12.00f, 23.0f},
+    {762000, -33464759, -70677355, 12.00f, 23.0f},
+    {763000, -33464660, -70677304, 12.00f, 23.0f},
+    {764000, -33464561, -70677254, 12.00f, 23.0f},
+    {765000, -33464462, -70677204, 12.00f, 23.0f},
+    {766000, -33464362, -70677153, 12.00f, 23.0f},
+    {767000, -33464263, -70677103, 12.00f, 23.0f},
+    {768000, -33464164, -70677052, 12.00f, 23.0f},
+    {769000, -33464065, -70677002, 12.00f, 23.0f},
+    {770000, -33463965, -70676951, 12.00f, 23.0f},
+    {771000, -33463866, -70676901, 12.00f, 23.0f},
+    {772000, -33463767, -70676851, 12.00f, 23.0f},
+    {773000, -33463668, -70676800, 12.00f, 23.0f},
+    {774000, -33463568, -70676750, 12.00f, 23.0f},
+    {775000, -33463469, -70676699, 12.00f, 23.0f},
+    {776000, -33463370, -70676649, 12.00f, 23.0f},
+    {777000, -33463271, -70676599, 12.00f, 23.0f},
+    {778000, -33463171, -70676548, 12.00f, 23.0f},
+    {779000, -33463072, -70676498, 12.00f, 23.0f},
+    {780000, -33462973, -70676447, 12.00f, 23.0f},
+    {781000, -33462874, -70676397, 12.00f, 23.0f},
+    {782000, -33462774, -70676347, 12.00f, 23.0f},
+    {783000, -33462675, -70676296, 12.00f, 23.0f},
+    {784000, -33462576, -70676246, 12.00f, 23.0f},
+    {785000, -33462477, -70676195, 12.00f, 23.0f},
+    {786000, -33462377, -70676145, 12.00f, 23.0f},
+    {787000, -33462278, -70676094, 12.00f, 23.0f},
+    {788000, -33462179, -70676044, 12.00f, 23.0f},
+    {789000, -33462080, -70675994, 12.00f, 23.0f},
+    {790000, -33461980, -70675943, 12.00f, 23.0f},
+    {791000, -33461881, -70675893, 12.00f, 23.0f},
+    {792000, -33461782, -70675842, 12.00f, 23.0f},
+    {793000, -33461683, -70675792, 12.00f, 23.0f},
+    {794000, -33461583, -70675742, 12.00f, 23.0f},
+    {795000, -33461484, -70675691, 12.00f, 23.0f},
+    {796000, -33461385, -70675641, 12.00f, 23.0f},
+    {797000, -33461285, -70675590, 12.00f, 23.0f},
+    {798000, -33461186, -70675540, 12.00f, 23.0f},
+    {799000, -33461087, -70675490, 12.00f, 23.0f},
+    {800000, -33460988, -70675439, 12.00f, 23.0f},
+    {801000, -33460888, -70675389, 12.00f, 23.0f},
+    {802000, -33460789, -70675338, 12.00f, 23.0f},
+    {803000, -33460690, -70675288, 12.00f, 23.0f},
+    {804000, -33460591, -70675237, 12.00f, 23.0f},
+    {805000, -33460491, -70675187, 12.00f, 23.0f},
+    {806000, -33460392, -70675137, 12.00f, 23.0f},
+    {807000, -33460293, -70675086, 12.00f, 23.0f},
+    {808000, -33460194, -70675036, 12.00f, 23.0f},
+    {809000, -33460094, -70674985, 12.00f, 23.0f},
+    {810000, -33459995, -70674935, 12.00f, 23.0f},
+    {811000, -33459896, -70674885, 12.00f, 23.0f},
+    {812000, -33459797, -70674834, 12.00f, 23.0f},
+    {813000, -33459697, -70674784, 12.00f, 23.0f},
+    {814000, -33459598, -70674733, 12.00f, 23.0f},
+    {815000, -33459499, -70674683, 12.00f, 23.0f},
+    {816000, -33459400, -70674633, 12.00f, 23.0f},
+    {817000, -33459300, -70674582, 12.00f, 23.0f},
+    {818000, -33459201, -70674532, 12.00f, 23.0f},
+    {819000, -33459102, -70674481, 12.00f, 23.0f},
+    {820000, -33459003, -70674431, 12.00f, 23.0f},
+    {821000, -33458903, -70674381, 12.00f, 23.0f},
+    {822000, -33458804, -70674330, 12.00f, 23.0f},
+    {823000, -33458705, -70674280, 12.00f, 23.0f},
+    {824000, -33458606, -70674229, 12.00f, 23.0f},
+    {825000, -33458506, -70674179, 12.00f, 23.0f},
+    {826000, -33458407, -70674128, 12.00f, 23.0f},
+    {827000, -33458308, -70674078, 12.00f, 23.0f},
+    {828000, -33458209, -70674028, 12.00f, 23.0f},
+    {829000, -33458109, -70673977, 12.00f, 23.0f},
+    {830000, -33458010, -70673927, 12.00f, 23.0f},
+    {831000, -33457911, -70673876, 12.00f, 23.0f},
+    {832000, -33457812, -70673826, 12.00f, 23.0f},
+    {833000, -33457712, -70673776, 12.00f, 23.0f},
+    {834000, -33457613, -70673725, 12.00f, 23.0f},
+    {835000, -33457514, -70673675, 12.00f, 23.0f},
+    {836000, -33457415, -70673624, 12.00f, 23.0f},
+    {837000, -33457315, -70673574, 12.00f, 23.0f},
+    {838000, -33457216, -70673524, 12.00f, 23.0f},
+    {839000, -33457117, -70673473, 12.00f, 23.0f},
+    {840000, -33457018, -70673423, 12.00f, 23.0f},
+    {841000, -33456918, -70673372, 12.00f, 23.0f},
+    {842000, -33456819, -70673322, 12.00f, 23.0f},
+    {843000, -33456720, -70673272, 12.00f, 23.0f},
+    {844000, -33456620, -70673221, 12.00f, 23.0f},
+    {845000, -33456521, -70673171, 12.00f, 23.0f},
+    {846000, -33456422, -70673120, 12.00f, 23.0f},
+    {847000, -33456323, -70673070, 12.00f, 23.0f},
+    {848000, -33456223, -70673019, 12.00f, 23.0f},
+    {849000, -33456124, -70672969, 12.00f, 23.0f},
+    {850000, -33456025, -70672919, 12.00f, 23.0f},
+    {851000, -33455926, -70672868, 12.00f, 23.0f},
+    {852000, -33455826, -70672818, 12.00f, 23.0f},
+    {853000, -33455727, -70672767, 12.00f, 23.0f},
+    {854000, -33455628, -70672717, 12.00f, 23.0f},
+    {855000, -33455529, -70672667, 12.00f, 23.0f},
+    {856000, -33455429, -70672616, 12.00f, 23.0f},
+    {857000, -33455330, -70672566, 12.00f, 23.0f},
+    {858000, -33455231, -70672515, 12.00f, 23.0f},
+    {859000, -33455132, -70672465, 12.00f, 23.0f},
+    {860000, -33455032, -70672415, 12.00f, 23.0f},
+    {861000, -33454933, -70672364, 12.00f, 23.0f},
+    {862000, -33454834, -70672314, 12.00f, 23.0f},
+    {863000, -33454735, -70672263, 12.00f, 23.0f},
+    {864000, -33454635, -70672213, 12.00f, 23.0f},
+    {865000, -33454536, -70672162, 12.00f, 23.0f},
+    {866000, -33454437, -70672112, 12.00f, 23.0f},
+    {867000, -33454338, -70672062, 12.00f, 23.0f},
+    {868000, -33454238, -70672011, 12.00f, 23.0f},
+    {869000, -33454139, -70671961, 12.00f, 23.0f},
+    {870000, -33454040, -70671910, 12.00f, 23.0f},
+    {871000, -33453941, -70671860, 12.00f, 23.0f},
+    {872000, -33453841, -70671810, 12.00f, 23.0f},
+    {873000, -33453742, -70671759, 12.00f, 23.0f},
+    {874000, -33453643, -70671709, 12.00f, 23.0f},
+    {875000, -33453544, -70671658, 12.00f, 23.0f},
+    {876000, -33453444, -70671608, 12.00f, 23.0f},
+    {877000, -33453345, -70671558, 12.00f, 23.0f},
+    {878000, -33453246, -70671507, 12.00f, 23.0f},
+    {879000, -33453147, -70671457, 12.00f, 23.0f},
+    {880000, -33453047, -70671406, 12.00f, 23.0f},
+    {881000, -33452948, -70671356, 12.00f, 23.0f},
+    {882000, -33452849, -70671306, 12.00f, 23.0f},
+    {883000, -33452750, -70671255, 12.00f, 23.0f},
+    {884000, -33452650, -70671205, 12.00f, 23.0f},
+    {885000, -33452551, -70671154, 12.00f, 23.0f},
+    {886000, -33452452, -70671104, 12.00f, 23.0f},
+    {887000, -33452353, -70671053, 12.00f, 23.0f},
+    {888000, -33452253, -70671003, 12.00f, 23.0f},
+    {889000, -33452154, -70670953, 12.00f, 23.0f},
+    {890000, -33452055, -70670902, 12.00f, 23.0f},
+    {891000, -33451956, -70670852, 12.00f, 23.0f},
+    {892000, -33451856, -70670801, 12.00f, 23.0f},
+    {893000, -33451757, -70670751, 12.00f, 23.0f},
+    {894000, -33451658, -70670701, 12.00f, 23.0f},
+    {895000, -33451558, -70670650, 12.00f, 23.0f},
+    {896000, -33451459, -70670600, 12.00f, 23.0f},
+    {897000, -33451360, -70670549, 12.00f, 23.0f},
+    {898000, -33451261, -70670499, 12.00f, 23.0f},
+    {899000, -33451161, -70670449, 12.00f, 23.0f},
+    {900000, -33451062, -70670398, 12.00f, 23.0f},
+    {901000, -33450963, -70670348, 12.00f, 23.0f},
+    {902000, -33450864, -70670297, 12.00f, 23.0f},
+    {903000, -33450764, -70670247, 12.00f, 23.0f},
+    {904000, -33450665, -70670197, 12.00f, 23.0f},
+    {905000, -33450566, -70670146, 12.00f, 23.0f},
+    {906000, -33450467, -70670096, 12.00f, 23.0f},
+    {907000, -33450367, -70670045, 12.00f, 23.0f},
+    {908000, -33450268, -70669995, 12.00f, 23.0f},
+    {909000, -33450169, -70669944, 12.00f, 23.0f},
+    {910000, -33450070, -70669894, 12.00f, 23.0f},
+    {911000, -33449970, -70669844, 12.00f, 23.0f},
+    {912000, -33449871, -70669793, 12.00f, 23.0f},
+    {913000, -33449772, -70669743, 12.00f, 23.0f},
+    {914000, -33449673, -70669692, 12.00f, 23.0f},
+    {915000, -33449573, -70669642, 12.00f, 23.0f},
+    {916000, -33449474, -70669592, 12.00f, 23.0f},
+    {917000, -33449375, -70669541, 12.00f, 23.0f},
+    {918000, -33449276, -70669491, 12.00f, 23.0f},
+    {919000, -33449176, -70669440, 12.00f, 23.0f},
+    {920000, -33449077, -70669390, 12.00f, 23.0f},
+    {921000, -33448978, -70669340, 12.00f, 23.0f},
+};
+
+static const size_t traceFixCount = sizeof(traceFixes) / sizeof(traceFixes[0]);
+static const size_t traceTransitionCount = sizeof(traceTransitions) / sizeof(traceTransitions[0]);
+
+#endif // DRIVE_TRACE_H
@@ -0,0 +1,256 @@
+#!/usr/bin/env python3
+"""Backend side of the windowed bulk transfer (MSG_TYPE_BULK_ARQ,
+src/selective_repeat.h), and a simulation of it.
+
+Feed every MSG_TYPE_BULK_ARQ uplink to ArqReceiver.receive(); it returns
+the payloads that are now in order. When ack_due() is true, queue ack()
+as a downlink on LORAWAN_CONFIG_PORT; in Class A it goes out after the
+device's next uplink.
+
+    bulk_arq.py simulate [--loss 0.1] [--frames 500] [--ack-every 4]
+
+runs the device logic (a model of src/selective_repeat.cpp) against the
+receiver over a lossy Class A link, one uplink slot per step, and prints
+airtime and latency per frame next to confirmed uplinks.
+"""
+
+import argparse
+import random
+import sys
+
+MSG_TYPE_BULK_ARQ = 0x0D
+CMD_BULK_ACK = 0x18
+HEADER = 4
+MAX_WINDOW = 32         # ARQ_MAX_WINDOW limit; also the bitmap reach
+
+
+class ArqReceiver:
+    def __init__(self, ack_every=4):
+        self.ack_every = ack_every
+        self.next = None            # Every frame before this was delivered
+        self.pending = {}           # seq -> payload, out of order
+        self.fresh = 0              # New frames since the last ack
+        self.prompt = False         # Gap or repeat: ack at the next chance
+        self.duplicates = 0
+        self.resyncs = 0
+
+    def receive(self, frame):
+        frame = bytes(frame)
+        if len(frame) < HEADER or frame[0] != MSG_TYPE_BULK_ARQ:
+            raise ValueError("not a bulk ARQ frame")
+        seq = (frame[1] << 8) | frame[2]
+        start = (seq - frame[3]) & 0xFFFF     # Oldest frame the device still has
+        if self.next is None:
+            self.next = start
+        elif (self.next - start) & 0xFFFF > MAX_WINDOW:
+            # Not this session's window: the device restarted
+            self.resyncs += 1
+            self.pending.clear()
+            self.next = start
+
+        ahead = (seq - self.next) & 0xFFFF
+        if ahead >= 0x8000 or seq in self.pending:
+            # Our acknowledgement went missing
+            self.duplicates += 1
+            self.prompt = True
+            return []
+
+        self.pending[seq] = frame[HEADER:]
+        self.fresh += 1
+        if ahead > 0:
+            self.prompt = True
+
+        delivered = []
+        while self.next in self.pending:
+            delivered.append(self.pending.pop(self.next))
+            self.next = (self.next + 1) & 0xFFFF
+        return delivered
+
+    def ack_due(self):
+        return self.next is not None and (self.prompt or self.fresh >= self.ack_every)
+
+    def ack(self):
+        """CMD_BULK_ACK downlink for what has arrived so far."""
+        bitmap = bytearray()
+        for seq in self.pending:
+            offset = ((seq - self.next) & 0xFFFF) - 1
+            if offset < MAX_WINDOW:
+                while len(bitmap) <= offset // 8:
+                    bitmap.append(0)
+                bitmap[offset // 8] |= 0x80 >> (offset % 8)
+        self.fresh = 0
+        self.prompt = False
+        return bytes([CMD_BULK_ACK, self.next >> 8, self.next & 0xFF]) + bytes(bitmap)
+
+
+# ===============================================================
+# SIMULATION
+# ===============================================================
+
+class SenderModel:
+    """src/selective_repeat.cpp, with time counted in uplink slots."""
+
+    def __init__(self, min_window=4, max_window=16, headroom=3.0, retry_slots=10):
+        self.min_window, self.max_window, self.headroom = min_window, max_window, headroom
+        self.retry_slots = retry_slots
+        self.base = self.next_seq = random.randrange(0x10000)
+        self.acked = set()
+        self.lost = set()
+        self.sent_at = {}           # seq -> (uplink count, slot)
+        self.window = min_window
+        self.uplinks = 0
+        self.uplinks_at_ack = 0
+        self.ack_spacing = min_window / headroom
+        self.probe = 0
+
+    def outstanding(self):
+        return (self.next_seq - self.base) & 0xFFFF
+
+    def can_accept(self):
+        return self.outstanding() < self.window
+
+    def open_seqs(self):
+        seqs = [(self.base + i) & 0xFFFF for i in range(self.outstanding())]
+        return [s for s in seqs if s not in self.acked]
+
+    def pick_repair(self, now):
+        open_seqs = self.open_seqs()
+        for seq in open_seqs:
+            if seq in self.lost:
+                return seq
+        for seq in open_seqs:
+            uplink, slot = self.sent_at[seq]
+            if self.uplinks - uplink > self.window or now - slot >= self.retry_slots:
+                return seq
+        if open_seqs and not self.can_accept():
+            outstanding = self.outstanding()
+            for i in range(outstanding):
+                seq = (self.base + (self.probe + i) % outstanding) & 0xFFFF
+                if seq not in self.acked:
+                    return seq
+        return None
+
+    def sent(self, seq, now, repair):
+        if repair and seq not in self.lost:
+            self.probe += 1
+        self.lost.discard(seq)
+        self.sent_at[seq] = (self.uplinks, now)
+        if not repair:
+            self.next_seq = (self.next_seq + 1) & 0xFFFF
+
+    def handle_ack(self, payload):
+        nxt = (payload[0] << 8) | payload[1]
+        released = (nxt - self.base) & 0xFFFF
+        if released > self.outstanding():
+            return
+        for i in range(released):
+            seq = (self.base + i) & 0xFFFF
+            self.acked.discard(seq)
+            self.lost.discard(seq)
+        self.base = nxt
+        newest = -1
+        bits = payload[2:]
+        for i in range(len(bits) * 8):
+            if i + 1 >= self.outstanding():
+                break
+            if bits[i // 8] & (0x80 >> (i % 8)):
+                self.acked.add((nxt + i + 1) & 0xFFFF)
+                newest = i + 1
+        if newest > 0:
+            newest_sent = self.sent_at[(nxt + newest) & 0xFFFF][0]
+            for i in range(newest):
+                seq = (nxt + i) & 0xFFFF
+                if seq not in self.acked and self.sent_at[seq][0] < newest_sent:
+                    self.lost.add(seq)
+        while self.base != self.next_seq and self.base in self.acked:
+            self.acked.discard(self.base)
+            self.base = (self.base + 1) & 0xFFFF
+        self.ack_spacing += 0.25 * ((self.uplinks - self.uplinks_at_ack) - self.ack_spacing)
+        self.uplinks_at_ack = self.uplinks
+        self.window = min(self.max_window, max(self.min_window, int(round(self.ack_spacing * self.headroom))))
+
+
+def simulate_arq(frames, loss, downlink_loss, ack_every, rng):
+    sender = SenderModel()
+    receiver = ArqReceiver(ack_every)
+    queued = None
+    delivered = uplinks = downlinks = slot = 0
+    sent = {}
+    latency = 0
+    while delivered < frames:
+        slot += 1
+        if slot > frames * 100:
+            raise RuntimeError("transfer stalled")
+        seq = sender.pick_repair(slot)
+        repair = seq is not None
+        if not repair:
+            if not sender.can_accept() or len(sent) >= frames:
+                continue
+            seq = sender.next_seq
+            sent[seq] = slot
+        frame = bytes([MSG_TYPE_BULK_ARQ, seq >> 8, seq & 0xFF, (seq - sender.base) & 0xFF])
+        uplinks += 1
+        sender.uplinks += 1
+        sender.sent(seq, slot, repair)
+        if rng.random() < loss:
+            continue
+
+        for payload in receiver.receive(frame):
+            delivered += 1
+        latency = slot
+        if queued is not None:
+            downlinks += 1
+            if rng.random() >= downlink_loss:
+                sender.handle_ack(queued[1:])
+            queued = None
+        if receiver.ack_due():
+            queued = receiver.ack()
+    return uplinks, downlinks, slot, sender.window
+
+
+def simulate_confirmed(frames, loss, downlink_loss, rng):
+    uplinks = downlinks = 0
+    for _ in range(frames):
+        while True:
+            uplinks += 1
+            if rng.random() < loss:
+                continue
+            downlinks += 1
+            if rng.random() >= downlink_loss:
+                break
+    return uplinks, downlinks
+
+
+def simulate(args):
+    print("%6s | %-36s | %-22s | %s" % ("loss", "selective repeat: up / down / slots", "confirmed: up / down",
+                                        "unconfirmed: delivered"))
+    losses = [args.loss] if args.loss is not None else [0.0, 0.05, 0.1, 0.2, 0.3, 0.4]
+    for loss in losses:
+        down = args.downlink_loss if args.downlink_loss is not None else loss
+        rng = random.Random(args.seed)
+        up, dn, slots, window = simulate_arq(args.frames, loss, down, args.ack_every, rng)
+        cup, cdn = simulate_confirmed(args.frames, loss, down, rng)
+        print("%5.0f%% | %5.2f / %5.2f / %5.2f  (window %2d)     | %5.2f / %5.2f          | %5.1f%%" % (
+            loss * 100, up / args.frames, dn / args.frames, slots / args.frames, window,
+            cup / args.frames, cdn / args.frames, (1 - loss) * 100))
+    print("per frame delivered; slots = uplink opportunities until the last frame is in order")
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="command", required=True)
+    sim = sub.add_parser("simulate", help="throughput against loss rate")
+    sim.add_argument("--loss", type=float, help="uplink loss (default: a sweep)")
+    sim.add_argument("--downlink-loss", type=float, help="downlink loss (default: same as uplink)")
+    sim.add_argument("--frames", type=int, default=500)
+    sim.add_argument("--ack-every", type=int, default=4, help="frames between routine acknowledgements")
+    sim.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args(argv[1:])
+
+    if args.command == "simulate":
+        simulate(args)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,173 @@
+#!/usr/bin/env python3
+"""ECDSA over P-256 with SHA-256 for the backend tools, standard library
+only.
+
+    ecdsa_p256.py selftest                    RFC 6979 vector
+    ecdsa_p256.py keygen KEYFILE              new signing key (hex, keep it
+                                              secret); prints the public
+                                              key for FUOTA_SIGNING_KEY
+
+Signatures are deterministic (RFC 6979) and raw: r | s, 32 bytes each,
+big-endian. Public keys are uncompressed points: 0x04 | X | Y. This is
+what src/firmware_update.cpp checks a patch header against with mbedtls.
+
+Not constant-time: sign on a build machine, not on a shared host.
+"""
+
+import argparse
+import hashlib
+import hmac
+import secrets
+import sys
+
+# ===============================================================
+# CURVE
+# ===============================================================
+
+P = 0xFFFFFFFF00000001000000000000000000000000FFFFFFFFFFFFFFFFFFFFFFFF
+A = P - 3
+B = 0x5AC635D8AA3A93E7B3EBBD55769886BC651D06B0CC53B0F63BCE3C3E27D2604B
+N = 0xFFFFFFFF00000000FFFFFFFFFFFFFFFFBCE6FAADA7179E84F3B9CAC2FC632551
+G = (0x6B17D1F2E12C4247F8BCE6E563A440F277037D812DEB33A0F4A13945D898C296,
+     0x4FE342E2FE1A7F9B8EE7EB4A7C0F9E162BCE33576B315ECECBB6406837BF51F5)
+
+
+def _add(p, q):
+    if p is None:
+        return q
+    if q is None:
+        return p
+    if p[0] == q[0] and (p[1] + q[1]) % P == 0:
+        return None
+    if p == q:
+        slope = (3 * p[0] * p[0] + A) * pow(2 * p[1], -1, P) % P
+    else:
+        slope = (q[1] - p[1]) * pow(q[0] - p[0], -1, P) % P
+    x = (slope * slope - p[0] - q[0]) % P
+    return x, (slope * (p[0] - x) - p[1]) % P
+
+
+def _multiply(k, point):
+    result = None
+    while k:
+        if k & 1:
+            result = _add(result, point)
+        point = _add(point, point)
+        k >>= 1
+    return result
+
+
+def on_curve(point):
+    x, y = point
+    return (y * y - (x * x * x + A * x + B)) % P == 0
+
+
+# ===============================================================
+# KEYS AND SIGNATURES
+# ===============================================================
+
+
+def public_key(private):
+    """Uncompressed point of a private key (int)."""
+    x, y = _multiply(private, G)
+    return b"\x04" + x.to_bytes(32, "big") + y.to_bytes(32, "big")
+
+
+def new_private_key():
+    return secrets.randbelow(N - 1) + 1
+
+
+def _nonce(private, digest):
+    """RFC 6979 k for SHA-256."""
+    x = private.to_bytes(32, "big")
+    h = (int.from_bytes(digest, "big") % N).to_bytes(32, "big")
+    v = b"\x01" * 32
+    k = b"\x00" * 32
+    k = hmac.new(k, v + b"\x00" + x + h, hashlib.sha256).digest()
+    v = hmac.new(k, v, hashlib.sha256).digest()
+    k = hmac.new(k, v + b"\x01" + x + h, hashlib.sha256).digest()
+    v = hmac.new(k, v, hashlib.sha256).digest()
+    while True:
+        v = hmac.new(k, v, hashlib.sha256).digest()
+        candidate = int.from_bytes(v, "big")
+        if 1 <= candidate < N:
+            return candidate
+        k = hmac.new(k, v + b"\x00", hashlib.sha256).digest()
+        v = hmac.new(k, v, hashlib.sha256).digest()
+
+
+def sign(private, digest):
+    """r | s over a SHA-256 digest."""
+    e = int.from_bytes(digest, "big")
+    k = _nonce(private, digest)
+    while True:
+        r = _multiply(k, G)[0] % N
+        s = pow(k, -1, N) * (e + r * private) % N
+        if r and s:
+            return r.to_bytes(32, "big") + s.to_bytes(32, "big")
+        k = (k + 1) % N or 1
+
+
+def verify(public, digest, signature):
+    if len(public) != 65 or public[0] != 4 or len(signature) != 64:
+        return False
+    point = (int.from_bytes(public[1:33], "big"), int.from_bytes(public[33:], "big"))
+    r, s = int.from_bytes(signature[:32], "big"), int.from_bytes(signature[32:], "big")
+    if not on_curve(point) or not (0 < r < N and 0 < s < N):
+        return False
+    w = pow(s, -1, N)
+    e = int.from_bytes(digest, "big")
+    result = _add(_multiply(e * w % N, G), _multiply(r * w % N, point))
+    return result is not None and result[0] % N == r
+
+
+def load_private_key(path):
+    with open(path) as handle:
+        private = int(handle.read().strip(), 16)
+    if not 0 < private < N:
+        raise ValueError("not a P-256 private key")
+    return private
+
+
+# ===============================================================
+# SELF TEST
+# ===============================================================
+
+# RFC 6979 A.2.5, SHA-256, message "sample"
+RFC6979_KEY = 0xC9AFA9D845BA75166B5C215767B1D6934E50C3DB36E89B127B8A622B120F6721
+RFC6979_PUBLIC = ("0460FED4BA255A9D31C961EB74C6356D68C049B8923B61FA6CE669622E60F29FB6"
+                  "7903FE1008B8BC99A41AE9E95628BC64F2F1B20C2D7E9F5177A3C294D4462299")
+RFC6979_SIGNATURE = ("EFD48B2AACB6A8FD1140DD9CD45E81D69D2C877B56AAF991C34D0EA84EAF3716"
+                     "F7CB1C942D657C41D436C7A1B6E29F65F3E900DBB9AFF4064DC4AB2F843ACDA8")
+
+
+def selftest():
+    digest = hashlib.sha256(b"sample").digest()
+    public = public_key(RFC6979_KEY)
+    signature = sign(RFC6979_KEY, digest)
+    tampered = bytes([digest[0] ^ 1]) + digest[1:]
+    return (public.hex().upper() == RFC6979_PUBLIC and signature.hex().upper() == RFC6979_SIGNATURE
+            and verify(public, digest, signature) and not verify(public, tampered, signature))
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="command", required=True)
+    sub.add_parser("selftest", help="check against the RFC 6979 vector")
+    keygen = sub.add_parser("keygen", help="new signing key")
+    keygen.add_argument("keyfile", help="where the private key goes (hex)")
+    args = parser.parse_args(argv[1:])
+
+    if args.command == "selftest":
+        ok = selftest()
+        print("ECDSA P-256 vector: %s" % ("ok" if ok else "FAILED"))
+        return 0 if ok else 1
+    private = new_private_key()
+    with open(args.keyfile, "x") as handle:
+        handle.write("%064X\n" % private)
+    print('#define FUOTA_SIGNING_KEY   "%s"' % public_key(private).hex().upper())
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
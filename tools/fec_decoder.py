@@ -0,0 +1,217 @@
+#!/usr/bin/env python3
+"""Rebuild erasure-coded bulk uplinks (MSG_TYPE_BULK, src/erasure_coder.h).
+
+The device sends bulk payloads (track batches) in groups of k source
+frames followed by r parity frames; any k of them rebuild the group.
+Feed every MSG_TYPE_BULK uplink, in FCnt order, to BulkDecoder.add(); it
+returns the source payloads that became available: received ones right
+away, lost ones once enough parity has arrived.
+
+The decoder also measures the frame loss on completed groups. Send
+loss_command() to the device (LORAWAN_CONFIG_PORT) now and then so it
+sizes the parity to the link.
+
+Examples:
+    fec_decoder.py 0C000109AABB 0C00800201900D2E7E2D      source 0 lost
+    fec_decoder.py < frames.txt         one hex frame per line
+"""
+
+import argparse
+import sys
+from collections import deque
+
+MSG_TYPE_BULK = 0x0C
+CMD_SET_FEC_LOSS = 0x17
+PARITY_FLAG = 0x80
+SOURCE_HEADER = 3
+PARITY_HEADER = 5
+
+# GF(2^8) over x^8 + x^4 + x^3 + x^2 + 1, generator 2 (as on the device)
+GF_EXP = [0] * 510
+GF_LOG = [0] * 256
+_x = 1
+for _i in range(255):
+    GF_EXP[_i] = GF_EXP[_i + 255] = _x
+    GF_LOG[_x] = _i
+    _x <<= 1
+    if _x & 0x100:
+        _x ^= 0x11D
+
+
+def gf_mul(a, b):
+    if a == 0 or b == 0:
+        return 0
+    return GF_EXP[GF_LOG[a] + GF_LOG[b]]
+
+
+def gf_inv(a):
+    return GF_EXP[255 - GF_LOG[a]]
+
+
+def cauchy(j, i):
+    """Coefficient of source i in parity j."""
+    return gf_inv((PARITY_FLAG + j) ^ i)
+
+
+def solve(matrix, rhs):
+    """Solve matrix * x = rhs over GF(2^8); rhs rows are byte lists."""
+    n = len(matrix)
+    matrix = [row[:] for row in matrix]
+    rhs = [row[:] for row in rhs]
+    for col in range(n):
+        pivot = next(r for r in range(col, n) if matrix[r][col])
+        matrix[col], matrix[pivot] = matrix[pivot], matrix[col]
+        rhs[col], rhs[pivot] = rhs[pivot], rhs[col]
+        inv = gf_inv(matrix[col][col])
+        matrix[col] = [gf_mul(inv, v) for v in matrix[col]]
+        rhs[col] = [gf_mul(inv, v) for v in rhs[col]]
+        for r in range(n):
+            factor = matrix[r][col]
+            if r != col and factor:
+                matrix[r] = [a ^ gf_mul(factor, b) for a, b in zip(matrix[r], matrix[col])]
+                rhs[r] = [a ^ gf_mul(factor, b) for a, b in zip(rhs[r], rhs[col])]
+    return rhs
+
+
+class Group:
+    def __init__(self, group_id):
+        self.id = group_id
+        self.sources = {}       # index -> payload (received or rebuilt)
+        self.parity = {}        # j -> symbol
+        self.k = None
+        self.r = None
+        self.received = 0
+        self.highest = -1       # Highest source index seen
+
+    def complete(self):
+        return self.k is not None and len(self.sources) >= self.k
+
+    def rebuild(self):
+        """Rebuild lost sources once enough parity is in; returns them."""
+        if self.k is None or self.complete():
+            return []
+        missing = [i for i in range(self.k) if i not in self.sources]
+        if len(self.parity) < len(missing):
+            return []
+
+        rows = sorted(self.parity)[:len(missing)]
+        length = len(self.parity[rows[0]])
+        rhs = []
+        for j in rows:
+            residual = list(self.parity[j])
+            for i, payload in self.sources.items():
+                coef = cauchy(j, i)
+                symbol = [len(payload)] + list(payload)
+                for b, value in enumerate(symbol):
+                    residual[b] ^= gf_mul(coef, value)
+            rhs.append(residual)
+        matrix = [[cauchy(j, i) for i in missing] for j in rows]
+
+        rebuilt = []
+        for i, symbol in zip(missing, solve(matrix, rhs)):
+            if symbol[0] >= length:
+                raise ValueError("group %d: inconsistent parity" % self.id)
+            self.sources[i] = bytes(symbol[1:1 + symbol[0]])
+            rebuilt.append((self.id, i, self.sources[i], True))
+        return sorted(rebuilt, key=lambda item: item[1])
+
+    def sent(self, last_r):
+        """Frames the device sent for this group, as far as we can tell."""
+        if self.k is not None:
+            return self.k + self.r
+        return self.highest + 1 + last_r
+
+
+class BulkDecoder:
+    """Groups arrive one after the other: a frame of a new group ends the
+    previous one (a reboot or group counter wrap just starts a new one)."""
+
+    def __init__(self, window=32):
+        self.current = None
+        self.history = deque(maxlen=window)     # (sent, received) per group
+        self.last_r = 1
+        self.groups = 0
+        self.rebuilt = 0
+        self.unrecoverable = 0
+
+    def add(self, frame):
+        frame = bytes(frame)
+        if len(frame) < SOURCE_HEADER or frame[0] != MSG_TYPE_BULK:
+            raise ValueError("not a bulk frame")
+        group_id, index = frame[1], frame[2]
+        if self.current is None or self.current.id != group_id:
+            self.finish()
+            self.current = Group(group_id)
+        group = self.current
+        group.received += 1
+
+        out = []
+        if index & PARITY_FLAG:
+            if len(frame) < PARITY_HEADER + 1:
+                raise ValueError("short parity frame")
+            group.k, group.r = frame[3], frame[4]
+            group.parity[index & ~PARITY_FLAG] = frame[PARITY_HEADER:]
+        elif index not in group.sources:
+            group.sources[index] = frame[SOURCE_HEADER:]
+            group.highest = max(group.highest, index)
+            out.append((group_id, index, group.sources[index], False))
+
+        rebuilt = group.rebuild()
+        self.rebuilt += len(rebuilt)
+        return out + rebuilt
+
+    def finish(self):
+        """Close the current group (call at the end of a capture)."""
+        group = self.current
+        if group is None:
+            return
+        self.current = None
+        self.groups += 1
+        if group.r is not None:
+            self.last_r = group.r
+        if not group.complete():
+            self.unrecoverable += 1
+        self.history.append((group.sent(self.last_r), group.received))
+
+    def loss_rate(self):
+        sent = sum(s for s, _ in self.history)
+        received = sum(r for _, r in self.history)
+        if sent == 0:
+            return None
+        return max(0.0, 1.0 - received / sent)
+
+    def loss_command(self):
+        """CMD_SET_FEC_LOSS downlink with the measured loss, or None."""
+        loss = self.loss_rate()
+        if loss is None:
+            return None
+        return bytes([CMD_SET_FEC_LOSS, min(255, int(round(loss * 256)))])
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("frames", nargs="*", metavar="HEX")
+    args = parser.parse_args(argv[1:])
+
+    frames = args.frames or [line.strip() for line in sys.stdin if line.strip()]
+    decoder = BulkDecoder()
+    status = 0
+    for text in frames:
+        try:
+            for group, index, payload, rebuilt in decoder.add(bytes.fromhex(text)):
+                print("%d.%d %s%s" % (group, index, payload.hex().upper(), " (rebuilt)" if rebuilt else ""))
+        except ValueError as err:
+            print("error: %s: %s" % (text, err), file=sys.stderr)
+            status = 1
+    decoder.finish()
+
+    print("groups %d, rebuilt %d, unrecoverable %d" % (decoder.groups, decoder.rebuilt, decoder.unrecoverable),
+          file=sys.stderr)
+    command = decoder.loss_command()
+    if command is not None:
+        print("loss %.1f%%, downlink %s" % (decoder.loss_rate() * 100, command.hex().upper()), file=sys.stderr)
+    return status
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
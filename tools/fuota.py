@@ -0,0 +1,706 @@
+#!/usr/bin/env python3
+"""Backend side of firmware updates over LoRaWAN (src/firmware_update.h),
+and a stand-in network server to run an update against.
+
+    fuota.py diff OLD.bin NEW.bin PATCH --key KEYFILE
+                                              signed delta patch between two builds
+    fuota.py fragments PATCH [--dr 5]         FragSessionSetupReq + fragments, hex
+    fuota.py simulate [--old A --new B]       full update over a lossy link
+
+A patch is the new image as [add][extra][seek] controls against the old
+one (bsdiff-style: code that only moved or had its addresses relinked
+becomes runs of small differences, which deflate well), raw-deflated
+behind a header with both image hashes, signed with the release key
+(ECDSA P-256, ecdsa_p256.py keygen; the device holds the public half as
+FUOTA_SIGNING_KEY and refuses a patch whose header it does not verify). It is sent as a fragmented data
+block (TS004): M fragments, then XOR parity fragments; the device rebuilds
+lost fragments from any equal number of parity ones.
+
+simulate builds two synthetic firmware images (or takes real ones from
+.pio/build/*/firmware.bin), and runs the update through FuotaServer and a
+model of the device over Class A with the given loss: setup, fragments,
+status polls, more parity where needed, patch applied and checked, until
+a status uplink from the rebooted device reports the new firmware id.
+It reports downlinks, uplinks and gateway airtime for the delta and for
+the whole (deflated) image.
+"""
+
+import argparse
+import hashlib
+import math
+import random
+import struct
+import sys
+import zlib
+
+import ecdsa_p256
+
+LORAWAN_PORT = 1
+MSG_TYPE_STATUS_UPDATE = 0x03
+FUOTA_FRAG_PORT = 201
+PATCH_MAGIC = 0x32504647        # "GFP2"
+PATCH_HEADER = struct.Struct("<II32sI32s64s")
+SIGNED_FIELDS = PATCH_HEADER.size - 64
+
+PACKAGE_VERSION = 0x00
+FRAG_SESSION_STATUS = 0x01
+FRAG_SESSION_SETUP = 0x02
+FRAG_SESSION_DELETE = 0x03
+DATA_FRAGMENT = 0x08
+FRAG_HEADER = 3                 # DataFragment command and IndexAndN
+
+MAX_MISSING = 512               # FUOTA_MAX_MISSING (PSRAM)
+MAX_MISSING_NO_PSRAM = 96       # FUOTA_MAX_MISSING_NO_PSRAM
+MAX_N = 0x3FFF                  # Fragment numbers are 14 bits
+
+# AS923, dwell time off: (spreading factor, largest FRMPayload)
+AS923_DR = {0: (12, 51), 1: (11, 51), 2: (10, 51), 3: (9, 115), 4: (8, 242), 5: (7, 242)}
+LORAWAN_OVERHEAD = 13           # MHDR, FHDR, FPort, MIC
+
+
+def time_on_air(payload, sf, bandwidth=125000, preamble=8):
+    """Seconds on air for a downlink with `payload` FRMPayload bytes."""
+    length = payload + LORAWAN_OVERHEAD
+    symbol = (1 << sf) / bandwidth
+    low_rate = 1 if sf >= 11 else 0
+    symbols = 8 + max(math.ceil((8 * length - 4 * sf + 28) / (4 * (sf - 2 * low_rate))) * 5, 0)
+    return (preamble + 4.25 + symbols) * symbol
+
+
+# ===============================================================
+# PATCHES
+# ===============================================================
+
+KEY = 8                         # Bytes hashed to find a match
+MIN_MATCH = 12
+GIVE_UP = 64                    # Mismatch lead that ends an approximate match
+
+
+def _varint(value):
+    out = bytearray()
+    while value >= 0x80:
+        out.append((value & 0x7F) | 0x80)
+        value >>= 7
+    out.append(value)
+    return out
+
+
+def _zigzag(value):
+    return (value << 1) ^ (value >> 31) if value >= 0 else ((-value) << 1) - 1
+
+
+def _extend(old, o, new, p):
+    """Length of the approximate match of new[p:] on old[o:]: extended
+    while matching bytes outnumber the rest (each mismatch costs a
+    difference byte, each match saves a literal one)."""
+    limit = min(len(new) - p, len(old) - o)
+    i = best = score = top = 0
+    while i < limit:
+        if new[p + i:p + i + 32] == old[o + i:o + i + 32] and i + 32 <= limit:
+            i += 32
+            score += 32
+        else:
+            score += 1 if new[p + i] == old[o + i] else -1
+            i += 1
+        if score > top:
+            top, best = score, i
+        elif score < top - GIVE_UP:
+            break
+    return best
+
+
+def make_patch(old, new, key, level=9):
+    index = {}
+    for i in range(len(old) - KEY, -1, -1):
+        index[old[i:i + KEY]] = i       # Earliest occurrence wins
+
+    regions = []                        # (new start, old start, length)
+    pos = 0
+    offset = None
+    while pos + KEY <= len(new):
+        # The current alignment first: code that only moved keeps it
+        cands = []
+        if offset is not None and 0 <= pos + offset <= len(old) - MIN_MATCH:
+            cands.append(pos + offset)
+        hit = index.get(new[pos:pos + KEY])
+        if hit is not None:
+            cands.append(hit)
+        best = None
+        for o in cands:
+            if new[pos:pos + MIN_MATCH] == old[o:o + MIN_MATCH]:
+                length = _extend(old, o, new, pos)
+                if best is None or length > best[1]:
+                    best = (o, length)
+        if best is None or best[1] < MIN_MATCH:
+            pos += 1
+            continue
+        regions.append((pos, best[0], best[1]))
+        offset = best[0] - pos
+        pos += best[1]
+
+    return _finish(old, new, _controls(old, new, regions), key, level)
+
+
+def _controls(old, new, regions):
+    """Regions to the device's [add n][extra m][seek] controls."""
+    body = bytearray()
+    first = regions[0] if regions else (len(new), 0, 0)
+    body += _varint(0) + _varint(first[0]) + _varint(_zigzag(first[1]))
+    body += new[:first[0]]
+    for i, (start, o, length) in enumerate(regions):
+        end = start + length
+        nxt = regions[i + 1] if i + 1 < len(regions) else (len(new), o + length, 0)
+        body += _varint(length) + _varint(nxt[0] - end) + _varint(_zigzag(nxt[1] - (o + length)))
+        body += bytes((new[start + k] - old[o + k]) & 0xFF for k in range(length))
+        body += new[end:nxt[0]]
+    return body
+
+
+def _finish(old, new, body, key, level):
+    deflate = zlib.compressobj(level, zlib.DEFLATED, -15, 9)
+    fields = PATCH_HEADER.pack(PATCH_MAGIC, len(old), hashlib.sha256(old).digest() if old else bytes(32),
+                               len(new), hashlib.sha256(new).digest(), bytes(64))[:SIGNED_FIELDS]
+    signature = ecdsa_p256.sign(key, hashlib.sha256(fields).digest())
+    return fields + signature + deflate.compress(bytes(body)) + deflate.flush()
+
+
+def whole_image(new, key, level=9):
+    """A patch against nothing: the deflated image."""
+    return _finish(b"", new, _varint(0) + _varint(len(new)) + _varint(0) + new, key, level)
+
+
+def apply_patch(old, patch, public):
+    """The device's patching, for checks; raises ValueError."""
+    magic, base_size, base_hash, size, image_hash, signature = PATCH_HEADER.unpack_from(patch)
+    if magic != PATCH_MAGIC:
+        raise ValueError("not a patch")
+    if not ecdsa_p256.verify(public, hashlib.sha256(patch[:SIGNED_FIELDS]).digest(), signature):
+        raise ValueError("bad signature")
+    if base_size and hashlib.sha256(old[:base_size]).digest() != base_hash:
+        raise ValueError("patch is for another image")
+    body = zlib.decompressobj(-15).decompress(patch[PATCH_HEADER.size:])
+    pos = 0
+
+    def varint():
+        nonlocal pos
+        value = shift = 0
+        while True:
+            byte = body[pos]
+            pos += 1
+            value |= (byte & 0x7F) << shift
+            shift += 7
+            if not byte & 0x80:
+                return value
+
+    out = bytearray()
+    base = 0
+    while len(out) < size:
+        add, extra, seek = varint(), varint(), varint()
+        seek = (seek >> 1) ^ -(seek & 1)
+        if base < 0 or base + add > base_size or len(out) + add + extra > size:
+            raise ValueError("patch does not apply")
+        out += bytes((old[base + i] + body[pos + i]) & 0xFF for i in range(add))
+        pos += add
+        out += body[pos:pos + extra]
+        pos += extra
+        base += add + seek
+    if hashlib.sha256(out).digest() != image_hash:
+        raise ValueError("image hash mismatch")
+    return bytes(out)
+
+
+# ===============================================================
+# FRAGMENTATION (TS004, matrix 0)
+# ===============================================================
+
+def _prbs23(x):
+    return (x >> 1) + (((x & 1) ^ ((x >> 5) & 1)) << 22)
+
+
+def parity_line(n, m):
+    """Fragments (0-based) in parity fragment m + n."""
+    modulus = m + 1 if m & (m - 1) == 0 else m
+    x = 1 + 1001 * n
+    line = set()
+    for _ in range(m // 2):
+        while True:
+            x = _prbs23(x)
+            r = x % modulus
+            if r < m:
+                break
+        line.add(r)
+    return sorted(line)
+
+
+class FragmentedBlock:
+    def __init__(self, block, size):
+        self.size = size
+        self.padding = -len(block) % size
+        data = block + bytes(self.padding)
+        self.fragments = [data[i:i + size] for i in range(0, len(data), size)]
+        self.count = len(self.fragments)
+
+    def fragment(self, n):
+        """Fragment n, 1-based; past the count, parity."""
+        if n <= self.count:
+            return self.fragments[n - 1]
+        value = 0
+        for i in parity_line(n - self.count, self.count):
+            value ^= int.from_bytes(self.fragments[i], "little")
+        return value.to_bytes(self.size, "little")
+
+    def setup_request(self, descriptor=0, groups=0):
+        return struct.pack("<BBHBBBI", FRAG_SESSION_SETUP, groups & 0x0F, self.count, self.size, 0,
+                           self.padding, descriptor)
+
+    def data_fragment(self, n):
+        return struct.pack("<BH", DATA_FRAGMENT, n & 0x3FFF) + self.fragment(n)
+
+
+def status_request(everyone=True):
+    return bytes([FRAG_SESSION_STATUS, 1 if everyone else 0])
+
+
+def firmware_id(image_hash):
+    """Firmware id in status uplinks: leading bytes of the ELF SHA-256 on
+    the device; here the image hash stands in for it."""
+    return int.from_bytes(image_hash[:4], "big")
+
+
+def status_firmware_id(port, payload):
+    """Firmware id from a status uplink (src/lorawan_manager.cpp), or None."""
+    if port != LORAWAN_PORT or len(payload) < 16 or payload[0] != MSG_TYPE_STATUS_UPDATE:
+        return None
+    return struct.unpack_from(">I", payload, 12)[0]
+
+
+def parse_answers(payload):
+    """Answers on FUOTA_FRAG_PORT, as (command, fields) tuples."""
+    answers = []
+    pos = 0
+    while pos < len(payload):
+        cmd = payload[pos]
+        if cmd == PACKAGE_VERSION:
+            answers.append((cmd, {"package": payload[pos + 1], "version": payload[pos + 2]}))
+            pos += 3
+        elif cmd == FRAG_SESSION_STATUS:
+            received = payload[pos + 1] | (payload[pos + 2] << 8)
+            answers.append((cmd, {"index": received >> 14, "received": received & 0x3FFF,
+                                  "missing": payload[pos + 3], "status": payload[pos + 4]}))
+            pos += 5
+        elif cmd in (FRAG_SESSION_SETUP, FRAG_SESSION_DELETE):
+            answers.append((cmd, {"status": payload[pos + 1]}))
+            pos += 2
+        else:
+            raise ValueError("unknown answer 0x%02X" % cmd)
+    return answers
+
+
+# ===============================================================
+# NETWORK SERVER STAND-IN
+# ===============================================================
+
+class FuotaServer:
+    """Drives one device through an update, one Class A downlink per
+    uplink: session setup, the fragments with planned parity, then status
+    polls and more parity until the device has the block. A device that
+    lost more than its decoder holds says so (NotEnoughMatrixMemory) and
+    gets the plain fragments again; it keeps the ones it has. The session
+    ends with the device's reboot, so the update is done once a status
+    uplink reports the new firmware id."""
+
+    SILENT_POLLS = 30               # Unanswered polls: the device rebooted, or is gone
+    STATUS_WAIT = 1500              # Uplinks to wait for the status report (four at 60 s)
+
+    def __init__(self, patch, size, loss=0.1, descriptor=0):
+        self.block = FragmentedBlock(patch, size)
+        self.descriptor = descriptor
+        self.state = "setup"
+        self.parity = self.block.count + 1
+        self.queue = list(range(1, self.block.count + 1))
+        self.add_parity(self.parity_for(self.block.count, loss))
+        self.downlinks = []         # Payloads sent, for the airtime
+        self.refused = None
+        self.resends = 0
+        self.silent = 0
+        self.image_id = firmware_id(PATCH_HEADER.unpack_from(patch)[4])
+
+    @staticmethod
+    def parity_for(count, loss):
+        return math.ceil(count * loss * 1.2) + 2
+
+    def add_parity(self, count):
+        end = min(self.parity + count, MAX_N + 1)
+        self.queue += range(self.parity, end)
+        self.parity = end
+
+    def downlink(self):
+        if self.state == "setup":
+            payload = bytes([PACKAGE_VERSION]) + self.block.setup_request(self.descriptor)
+        elif self.state == "send" and self.queue:
+            payload = self.block.data_fragment(self.queue.pop(0))
+        elif self.state == "applying":
+            self.silent += 1
+            if self.silent > self.STATUS_WAIT:
+                self.state = "failed"
+            return None
+        elif self.state in ("send", "poll"):
+            self.silent += 1
+            if self.silent > self.SILENT_POLLS:
+                self.state = "applying"
+                return None
+            self.state = "poll"
+            payload = status_request()
+        else:
+            return None
+        self.downlinks.append(payload)
+        return payload
+
+    def on_uplink(self, port, payload):
+        if status_firmware_id(port, payload) == self.image_id and self.state != "setup":
+            self.state = "done"
+            return
+        if port != FUOTA_FRAG_PORT:
+            return
+        self.silent = 0
+        for cmd, fields in parse_answers(payload):
+            if cmd == FRAG_SESSION_SETUP and self.state == "setup":
+                if fields["status"] & 0x0F:
+                    self.refused = fields["status"]
+                    self.state = "refused"
+                else:
+                    self.state = "send"
+            elif cmd == FRAG_SESSION_STATUS and self.state in ("send", "poll"):
+                if fields["missing"] == 0 and fields["received"] >= self.block.count:
+                    self.state = "applying"
+                    self.silent = 0
+                elif self.state == "poll":
+                    if fields["status"] & 0x01:
+                        self.resends += 1
+                        self.queue = list(range(1, self.block.count + 1))
+                    else:
+                        # What is still missing, plus a margin for this round's losses
+                        self.add_parity(fields["missing"] + self.parity_for(fields["missing"], 0.2))
+                    self.state = "send" if self.queue else "failed"
+
+    @property
+    def finished(self):
+        return self.state in ("done", "refused", "failed")
+
+
+# ===============================================================
+# DEVICE MODEL
+# ===============================================================
+
+class DecoderModel:
+    """src/frag_decoder.cpp, with the block in memory."""
+
+    def __init__(self, count, size, capacity=MAX_MISSING):
+        self.count, self.size = count, size
+        self.capacity = min(capacity, count)
+        self.data = [None] * count
+        self.have = set()
+        self.received = 0
+        self.parity = 0
+        self.missing = None         # Columns, once parity arrives
+        self.columns = {}
+        self.rows = {}              # Leading column -> (terms, value)
+        self.complete = False
+
+    def add(self, n, fragment):
+        if self.complete or n == 0:
+            return self.complete
+        value = int.from_bytes(fragment, "little")
+        if n <= self.count:
+            if n - 1 in self.have:
+                return False
+            self.have.add(n - 1)
+            self.received += 1
+            if self.missing is None:
+                self.data[n - 1] = value
+                self.complete = self.received == self.count
+                return self.complete
+            terms = 1 << self.columns[n - 1]
+        else:
+            self.parity += 1
+            if self.missing is None:
+                if self.count - self.received > self.capacity:
+                    return False
+                self.missing = [i for i in range(self.count) if i not in self.have]
+                self.columns = {index: j for j, index in enumerate(self.missing)}
+            terms = 0
+            for i in parity_line(n - self.count, self.count):
+                if i in self.columns:
+                    terms |= 1 << self.columns[i]
+                else:
+                    value ^= self.data[i]
+        while terms:
+            lead = (terms & -terms).bit_length() - 1
+            if lead not in self.rows:
+                self.rows[lead] = (terms, value)
+                break
+            terms ^= self.rows[lead][0]
+            value ^= self.rows[lead][1]
+        if len(self.rows) == len(self.missing):
+            for j in range(len(self.missing) - 1, -1, -1):
+                terms, value = self.rows[j]
+                for k in range(j + 1, len(self.missing)):
+                    if terms >> k & 1:
+                        value ^= self.rows[k][1]
+                self.rows[j] = (1 << j, value)
+                self.data[self.missing[j]] = value
+            self.complete = True
+        return self.complete
+
+    def still_missing(self):
+        if self.complete:
+            return 0
+        return self.count - self.received if self.missing is None else len(self.missing) - len(self.rows)
+
+    def over_capacity(self):
+        return self.missing is None and self.parity > 0 and self.count - self.received > self.capacity
+
+    def block(self):
+        return b"".join(v.to_bytes(self.size, "little") for v in self.data)
+
+
+class DeviceModel:
+    """The package handling of src/firmware_update.cpp. After the patch
+    it reboots: the session is gone, and the first uplink is a status
+    report with the new firmware id, then one every STATUS_EVERY."""
+
+    STATUS_EVERY = 360              # STATUS_REPORT_INTERVAL at one uplink a minute
+
+    def __init__(self, image, public, firmware_id=0, capacity=MAX_MISSING):
+        self.image = image
+        self.public = public            # FUOTA_SIGNING_KEY
+        self.firmware_id = firmware_id
+        self.capacity = capacity
+        self.decoder = None
+        self.answers = bytearray()
+        self.updated = None
+        self.error = None
+        self.since_boot = 0
+
+    def downlink(self, port, payload):
+        if port != FUOTA_FRAG_PORT:
+            return
+        pos = 0
+        while pos < len(payload):
+            cmd = payload[pos]
+            if cmd == PACKAGE_VERSION:
+                self.answers += bytes([PACKAGE_VERSION, 3, 1])
+                pos += 1
+            elif cmd == FRAG_SESSION_SETUP:
+                _, session, count, size, control, padding, descriptor = struct.unpack_from("<BBHBBBI", payload, pos)
+                status = 0 if descriptor in (0, self.firmware_id) else 0x08
+                if not status:
+                    self.decoder = DecoderModel(count, size, self.capacity)
+                self.answers += bytes([FRAG_SESSION_SETUP, status])
+                pos += 11
+            elif cmd == FRAG_SESSION_STATUS:
+                if self.decoder and (payload[pos + 1] & 1 or self.decoder.still_missing()):
+                    self.status()
+                pos += 2
+            elif cmd == DATA_FRAGMENT:
+                n = (payload[pos + 1] | (payload[pos + 2] << 8)) & 0x3FFF
+                if self.decoder and not self.decoder.complete and self.decoder.add(n, payload[pos + 3:]):
+                    self.status()
+                    self.apply()
+                break
+            else:
+                break
+
+    def status(self):
+        received = self.decoder.count if self.decoder.complete else self.decoder.received
+        self.answers += struct.pack("<BHBB", FRAG_SESSION_STATUS, min(received, 0x3FFF),
+                                    min(self.decoder.still_missing(), 255), int(self.decoder.over_capacity()))
+
+    def apply(self):
+        block, self.decoder = self.decoder.block(), None
+        try:
+            self.updated = apply_patch(self.image, block, self.public)
+        except (ValueError, IndexError, zlib.error) as err:
+            self.error = str(err)
+            return
+        self.firmware_id = firmware_id(hashlib.sha256(self.updated).digest())
+        self.since_boot = 0
+
+    def uplink(self):
+        if self.answers:
+            payload, self.answers = bytes(self.answers), bytearray()
+            return FUOTA_FRAG_PORT, payload
+        if self.updated is not None:
+            self.since_boot += 1
+            if self.since_boot % self.STATUS_EVERY == 1:
+                return LORAWAN_PORT, bytes([MSG_TYPE_STATUS_UPDATE]) + bytes(11) + struct.pack(">I", self.firmware_id)
+        return LORAWAN_PORT, b""
+
+
+def run_update(device, patch, size, loss, rng, limit=1000000):
+    """One update over Class A: returns (server, uplinks)."""
+    server = FuotaServer(patch, size, loss)
+    uplinks = 0
+    while not server.finished:
+        uplinks += 1
+        if uplinks > limit:
+            raise RuntimeError("update stalled")
+        port, payload = device.uplink()
+        if rng.random() < loss:
+            continue
+        server.on_uplink(port, payload)
+        payload = server.downlink()
+        if payload is not None and rng.random() >= loss:
+            device.downlink(FUOTA_FRAG_PORT, payload)
+    return server, uplinks
+
+
+# ===============================================================
+# SYNTHETIC FIRMWARE
+# ===============================================================
+
+def synthetic_firmware(rng, functions=3000):
+    """Functions of instruction-like bytes calling each other through
+    absolute addresses, and string constants: ~1 MB, deflates like code."""
+    vocab = [rng.randbytes(rng.choice((2, 3))) for _ in range(400)]
+    weights = [1.0 / (i + 1) for i in range(len(vocab))]
+    program = []
+    for _ in range(functions):
+        length = int(rng.lognormvariate(5.3, 0.8)) + 8
+        code = bytearray(b"".join(rng.choices(vocab, weights, k=length // 2)))
+        refs = [(rng.randrange(0, max(len(code) - 4, 1)) & ~3, rng.randrange(functions)) for _ in range(len(code) // 48)]
+        program.append((code, refs))
+    words = [bytes(rng.choices(b"abcdefghijklmnopqrstuvwxyz", k=rng.randint(3, 9))) for _ in range(300)]
+    strings = b"\0".join(b" ".join(rng.choices(words, k=rng.randint(2, 8))) for _ in range(3000))
+    return program, strings
+
+
+def link(program, strings):
+    """Lay the functions out and resolve their references."""
+    addresses = []
+    at = 0x42000020
+    for code, _ in program:
+        addresses.append(at)
+        at += len(code)
+    image = bytearray(b"\xE9\x05\x02\x2F" + bytes(28))
+    for code, refs in program:
+        code = bytearray(code)
+        for offset, target in refs:
+            code[offset:offset + 4] = struct.pack("<I", addresses[target % len(addresses)])
+        image += code
+    return bytes(image + strings)
+
+
+def change_program(rng, program, strings, edits):
+    """A small release: a few functions edited, grown or added, which
+    moves everything after them and so every call to them."""
+    program = [(bytearray(code), list(refs)) for code, refs in program]
+    for _ in range(edits):
+        code, refs = program[rng.randrange(len(program))]
+        action = rng.random()
+        if action < 0.4:
+            for _ in range(rng.randint(4, 40)):
+                code[rng.randrange(len(code))] = rng.randrange(256)
+        elif action < 0.8:
+            at = rng.randrange(len(code))
+            code[at:at] = rng.randbytes(rng.randint(8, 200))
+        else:
+            new = bytearray(rng.randbytes(rng.randint(200, 2000)))
+            program.insert(rng.randrange(len(program)), (new, [(0, rng.randrange(len(program)))]))
+    strings = strings.replace(b"\0", b"\0v2 ", 1)
+    return program, strings
+
+
+def simulate(args):
+    rng = random.Random(args.seed)
+    if args.old and args.new:
+        old, new = open(args.old, "rb").read(), open(args.new, "rb").read()
+        releases = [("given", old, new)]
+    else:
+        program, strings = synthetic_firmware(rng)
+        old = link(program, strings)
+        releases = []
+        for edits in (1, 5, 20):
+            changed = change_program(rng, program, strings, edits)
+            releases.append(("%d edits" % edits, old, link(*changed)))
+
+    # A release key for the run; a patch signed with another is refused
+    key = rng.randrange(1, ecdsa_p256.N)
+    public = ecdsa_p256.public_key(key)
+    forged = make_patch(releases[0][1], releases[0][2], rng.randrange(1, ecdsa_p256.N))
+    try:
+        apply_patch(releases[0][1], forged, public)
+        raise RuntimeError("patch signed with another key applied")
+    except ValueError:
+        pass
+
+    sf, largest = AS923_DR[args.dr]
+    size = largest - FRAG_HEADER
+    print("image %d bytes; DR%d (SF%d), %d-byte fragments, %.0f%% loss each way"
+          % (len(old), args.dr, sf, size, args.loss * 100))
+    print("%-10s %-6s | %8s %6s %7s %7s %9s %8s | %s"
+          % ("release", "send", "bytes", "frags", "downlk", "uplinks", "airtime s", "hours", "result"))
+    for name, base, image in releases:
+        for kind, patch in (("delta", make_patch(base, image, key)), ("whole", whole_image(image, key))):
+            if apply_patch(base, patch, public) != image:
+                raise RuntimeError("patch does not rebuild the image")
+            device = DeviceModel(base, public, capacity=MAX_MISSING_NO_PSRAM if args.no_psram else MAX_MISSING)
+            server, uplinks = run_update(device, patch, size, args.loss, rng)
+            airtime = sum(time_on_air(len(p), sf) for p in server.downlinks)
+            result = "ok" if device.updated == image else device.error or server.state
+            if server.resends:
+                result += " (%d resends)" % server.resends
+            print("%-10s %-6s | %8d %6d %7d %7d %9.1f %8.1f | %s"
+                  % (name, kind, len(patch), server.block.count, len(server.downlinks), uplinks, airtime,
+                     uplinks * args.interval / 3600.0, result))
+    print("hours at one uplink every %d s (Class A); airtime is the gateway's, per device" % args.interval)
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="command", required=True)
+    diff = sub.add_parser("diff", help="delta patch between two images")
+    diff.add_argument("old")
+    diff.add_argument("new")
+    diff.add_argument("patch")
+    diff.add_argument("--key", required=True, help="release signing key (ecdsa_p256.py keygen)")
+    frag = sub.add_parser("fragments", help="session setup and fragments for a patch, as hex downlinks")
+    frag.add_argument("patch")
+    frag.add_argument("--dr", type=int, default=5, choices=sorted(AS923_DR))
+    frag.add_argument("--parity", type=float, default=0.1, help="parity fragments, as a fraction of the count")
+    frag.add_argument("--descriptor", type=lambda v: int(v, 16), default=0,
+                      help="firmware id of the base (hex), so other devices refuse")
+    sim = sub.add_parser("simulate", help="updates over a lossy Class A link")
+    sim.add_argument("--old")
+    sim.add_argument("--new")
+    sim.add_argument("--loss", type=float, default=0.1, help="uplink and downlink loss")
+    sim.add_argument("--dr", type=int, default=5, choices=sorted(AS923_DR), help="downlink data rate")
+    sim.add_argument("--interval", type=int, default=60, help="seconds between uplinks")
+    sim.add_argument("--seed", type=int, default=1)
+    sim.add_argument("--no-psram", action="store_true", help="device decoder without PSRAM (fewer lost fragments)")
+    args = parser.parse_args(argv[1:])
+
+    if args.command == "diff":
+        old, new = open(args.old, "rb").read(), open(args.new, "rb").read()
+        key = ecdsa_p256.load_private_key(args.key)
+        patch = make_patch(old, new, key)
+        if apply_patch(old, patch, ecdsa_p256.public_key(key)) != new:
+            print("error: patch does not rebuild the image", file=sys.stderr)
+            return 1
+        with open(args.patch, "wb") as handle:
+            handle.write(patch)
+        print("%d -> %d bytes: patch %d bytes (whole image deflated: %d)"
+              % (len(old), len(new), len(patch), len(whole_image(new, key))))
+    elif args.command == "fragments":
+        patch = open(args.patch, "rb").read()
+        block = FragmentedBlock(patch, AS923_DR[args.dr][1] - FRAG_HEADER)
+        print(block.setup_request(args.descriptor).hex().upper())
+        for n in range(1, block.count + math.ceil(block.count * args.parity) + 1):
+            print(block.data_fragment(n).hex().upper())
+    elif args.command == "simulate":
+        simulate(args)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,218 @@
+#!/usr/bin/env python3
+"""Drive trace for the geofence replay tests (test/test_*).
+
+    geofence_trace.py record [OUTPUT]         write the trace header
+                                              (default test/traces/drive_trace.h)
+    geofence_trace.py truth                   print the transitions only
+
+The drive is simulated at 10 Hz: a vehicle follows a list of waypoints,
+accelerating at 3 m/s^2 towards each leg's target speed, 3 to 40 m/s,
+past a 100 m circle, a 30 m circle and a ~110 x 93 m square. It is
+recorded as a GNSS receiver would report it: one fix per second, micro-
+degree positions, speed and course.
+
+The transitions come from the 10 Hz path with exact geometry (no
+hysteresis), so they do not depend on src/geofence_manager.cpp: tests
+replay the fixes, at 1 Hz or deliberately sparse, and compare what the
+engine reports against them.
+"""
+
+import argparse
+import math
+import os
+import sys
+
+METERS_PER_MICRODEGREE = 0.11131949
+STEP = 0.1              # s, simulation step
+FIX_INTERVAL = 1.0      # s, recorded fixes
+ACCEL = 3.0             # m/s^2
+START_MS = 10000        # millis() of the first fix; 0 means "no fix" on the device
+
+# (id, lat, lon, radius m)
+CIRCLES = [
+    (3, -33.4489, -70.6693, 100),
+    (2, -33.4489, -70.6650, 30),
+]
+# (id, [(lat, lon), ...]) in micro-degrees
+SQUARE = (1, [(-33452000, -70668000), (-33452000, -70667000), (-33451000, -70667000), (-33451000, -70668000)])
+
+# (lat, lon, target speed m/s); the drive starts at the first point
+ROUTE = [
+    (-33.4489, -70.7000, 20),
+    (-33.4489, -70.6693, 8),
+    (-33.4489, -70.6600, 25),
+    (-33.4515, -70.6675, 3),
+    (-33.4515, -70.6800, 30),
+    (-33.4700, -70.6800, 40),
+    (-33.4489, -70.6693, 12),
+]
+
+
+# ===============================================================
+# GEOMETRY
+# ===============================================================
+
+
+def inside_circle(lat, lon, circle):
+    _, clat, clon, radius = circle
+    dy = (lat - clat) * 1e6 * METERS_PER_MICRODEGREE
+    dx = (lon - clon) * 1e6 * METERS_PER_MICRODEGREE * math.cos(math.radians(clat))
+    return math.hypot(dx, dy) <= radius
+
+
+def inside_polygon(lat, lon, vertices):
+    y, x = lat * 1e6, lon * 1e6
+    inside = False
+    j = len(vertices) - 1
+    for i in range(len(vertices)):
+        yi, xi = vertices[i]
+        yj, xj = vertices[j]
+        if (yi > y) != (yj > y) and x < (xj - xi) * (y - yi) / (yj - yi) + xi:
+            inside = not inside
+        j = i
+    return inside
+
+
+def membership(lat, lon):
+    state = {circle[0]: inside_circle(lat, lon, circle) for circle in CIRCLES}
+    state[SQUARE[0]] = inside_polygon(lat, lon, SQUARE[1])
+    return state
+
+
+# ===============================================================
+# DRIVE
+# ===============================================================
+
+
+def drive():
+    """Returns (fixes, transitions): fixes are (ms, lat e6, lon e6, speed
+    m/s, course deg), transitions (ms, id, entered)."""
+    lat, lon = ROUTE[0][0], ROUTE[0][1]
+    speed = 0.0
+    course = 0.0
+    leg = 1
+    t = 0.0
+    next_fix = 0.0
+    fixes = []
+    transitions = []
+    state = membership(lat, lon)
+
+    while leg < len(ROUTE):
+        target_lat, target_lon, target_speed = ROUTE[leg]
+        m = 1e6 * METERS_PER_MICRODEGREE
+        dy = (target_lat - lat) * m
+        dx = (target_lon - lon) * m * math.cos(math.radians(lat))
+        remaining = math.hypot(dx, dy)
+        if remaining < 5:
+            leg += 1
+            continue
+
+        if t >= next_fix - 1e-9:
+            fixes.append((START_MS + int(round(t * 1000)), int(round(lat * 1e6)), int(round(lon * 1e6)),
+                          round(speed, 2), round(course, 1)))
+            next_fix += FIX_INTERVAL
+
+        change = target_speed - speed
+        speed += max(-ACCEL * STEP, min(ACCEL * STEP, change))
+        course = math.degrees(math.atan2(dx, dy)) % 360
+        step = speed * STEP
+        lat += dy / remaining * step / m
+        lon += dx / remaining * step / (m * math.cos(math.radians(lat)))
+        t += STEP
+
+        now = membership(lat, lon)
+        for fid in sorted(now):
+            if now[fid] != state[fid]:
+                # Between the two steps; STEP is well inside any tolerance
+                transitions.append((START_MS + int(round((t - STEP / 2) * 1000)), fid, now[fid]))
+        state = now
+
+    return fixes, transitions
+
+
+# ===============================================================
+# OUTPUT
+# ===============================================================
+
+
+def header(fixes, transitions):
+    lines = [
+        "#ifndef DRIVE_TRACE_H",
+        "#define DRIVE_TRACE_H",
+        "",
+        "// Generated by tools/geofence_trace.py record; do not edit.",
+        "//",
+        "// %d fixes at 1 Hz over %.0f s of driving, and the transitions of the" % (
+            len(fixes), (fixes[-1][0] - fixes[0][0]) / 1000.0),
+        "// 10 Hz path through the fences below (exact geometry, no hysteresis).",
+        "",
+        "#include <stdint.h>",
+        "",
+        "struct TraceFix {",
+        "    uint32_t time;      // ms",
+        "    int32_t lat;        // * 1e6",
+        "    int32_t lon;",
+        "    float speed;        // m/s",
+        "    float course;       // degrees",
+        "};",
+        "",
+        "struct TraceTransition {",
+        "    uint32_t time;      // ms",
+        "    uint8_t id;",
+        "    bool entered;",
+        "};",
+        "",
+        "struct TraceCircle {",
+        "    uint8_t id;",
+        "    double lat;",
+        "    double lon;",
+        "    uint32_t radius;    // m",
+        "};",
+        "",
+        "static const TraceCircle traceCircles[] = {",
+    ]
+    for fid, lat, lon, radius in CIRCLES:
+        lines.append("    {%d, %.4f, %.4f, %d}," % (fid, lat, lon, radius))
+    lines += ["};", "", "static const uint8_t traceSquareId = %d;" % SQUARE[0]]
+    lines.append("static const int32_t traceSquareLat[] = {%s};" % ", ".join(str(v[0]) for v in SQUARE[1]))
+    lines.append("static const int32_t traceSquareLon[] = {%s};" % ", ".join(str(v[1]) for v in SQUARE[1]))
+    lines += ["", "static const TraceTransition traceTransitions[] = {"]
+    for time, fid, entered in transitions:
+        lines.append("    {%d, %d, %s}," % (time, fid, "true" if entered else "false"))
+    lines += ["};", "", "static const TraceFix traceFixes[] = {"]
+    for time, lat, lon, speed, course in fixes:
+        lines.append("    {%d, %d, %d, %.2ff, %.1ff}," % (time, lat, lon, speed, course))
+    lines += [
+        "};",
+        "",
+        "static const size_t traceFixCount = sizeof(traceFixes) / sizeof(traceFixes[0]);",
+        "static const size_t traceTransitionCount = sizeof(traceTransitions) / sizeof(traceTransitions[0]);",
+        "",
+        "#endif // DRIVE_TRACE_H",
+        "",
+    ]
+    return "\n".join(lines)
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="command", required=True)
+    record = sub.add_parser("record", help="write the trace header")
+    record.add_argument("output", nargs="?",
+                        default=os.path.join(os.path.dirname(__file__), "..", "test", "traces", "drive_trace.h"))
+    sub.add_parser("truth", help="print the transitions")
+    args = parser.parse_args(argv[1:])
+
+    fixes, transitions = drive()
+    if args.command == "record":
+        with open(args.output, "w") as handle:
+            handle.write(header(fixes, transitions))
+        print("%d fixes, %d transitions -> %s" % (len(fixes), len(transitions), args.output))
+    else:
+        for time, fid, entered in transitions:
+            print("%8.1f s  fence %d %s" % (time / 1000.0, fid, "ENTER" if entered else "EXIT"))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,265 @@
+#!/usr/bin/env python3
+"""LoRaWAN crypto for the backend tools, standard library only.
+
+    lorawan_crypto.py selftest                FIPS-197 / RFC 4493 vectors, TS005 keys
+    lorawan_crypto.py keys GENAPPKEY          McKEKey of a device (hex)
+
+AES-128 (encrypt and decrypt of one block), AES-CMAC, the LoRaWAN
+downlink frame (FRMPayload encryption and MIC, as a network server sends
+it) and the remote multicast setup key derivation (TS005) that
+src/multicast_groups.cpp mirrors:
+
+    McRootKey = aes128_encrypt(GenAppKey, 0x00 | pad16)
+    McKEKey   = aes128_encrypt(McRootKey, 0x00 | pad16)
+    McKey     = aes128_encrypt(McKEKey, McKey_encrypted)
+    McAppSKey = aes128_encrypt(McKey, 0x01 | McAddr | pad16)
+    McNetSKey = aes128_encrypt(McKey, 0x02 | McAddr | pad16)
+
+Slow (pure Python), which is fine for key setup and simulations.
+"""
+
+import argparse
+import struct
+import sys
+
+# ===============================================================
+# AES-128
+# ===============================================================
+
+
+def _xtime(a):
+    a <<= 1
+    return (a ^ 0x11B) if a & 0x100 else a
+
+
+def _multiply(a, b):
+    result = 0
+    while b:
+        if b & 1:
+            result ^= a
+        a = _xtime(a)
+        b >>= 1
+    return result
+
+
+def _make_sbox():
+    inverse = [0] * 256
+    for a in range(1, 256):
+        for b in range(1, 256):
+            if _multiply(a, b) == 1:
+                inverse[a] = b
+                break
+    sbox = []
+    for a in range(256):
+        x = inverse[a]
+        s = x
+        for shift in range(1, 5):
+            s ^= ((x << shift) | (x >> (8 - shift))) & 0xFF
+        sbox.append(s ^ 0x63)
+    return sbox
+
+
+SBOX = _make_sbox()
+INV_SBOX = [0] * 256
+for _i, _s in enumerate(SBOX):
+    INV_SBOX[_s] = _i
+MUL = {k: [_multiply(a, k) for a in range(256)] for k in (2, 3, 9, 11, 13, 14)}
+
+
+def expand_key(key):
+    """11 round keys of 16 bytes for a 16-byte key."""
+    if len(key) != 16:
+        raise ValueError("AES-128 needs a 16-byte key")
+    words = [list(key[i:i + 4]) for i in range(0, 16, 4)]
+    rcon = 1
+    for i in range(4, 44):
+        word = list(words[i - 1])
+        if i % 4 == 0:
+            word = [SBOX[b] for b in word[1:] + word[:1]]
+            word[0] ^= rcon
+            rcon = _xtime(rcon) & 0xFF
+        words.append([a ^ b for a, b in zip(words[i - 4], word)])
+    return [sum(words[r * 4:r * 4 + 4], []) for r in range(11)]
+
+
+def _add(state, round_key):
+    return [a ^ b for a, b in zip(state, round_key)]
+
+
+def _shift_rows(state, step):
+    # Column-major state: byte r + 4c is row r, column c
+    return [state[r + 4 * ((c + step * r) % 4)] for c in range(4) for r in range(4)]
+
+
+def _mix_columns(state, matrix):
+    out = []
+    for c in range(4):
+        column = state[4 * c:4 * c + 4]
+        for r in range(4):
+            value = 0
+            for k in range(4):
+                factor = matrix[(k - r) % 4]
+                value ^= column[k] if factor == 1 else MUL[factor][column[k]]
+            out.append(value)
+    return out
+
+
+def aes_encrypt(key, block, round_keys=None):
+    round_keys = round_keys or expand_key(key)
+    state = _add(list(block), round_keys[0])
+    for r in range(1, 11):
+        state = _shift_rows([SBOX[b] for b in state], 1)
+        if r < 10:
+            state = _mix_columns(state, (2, 3, 1, 1))
+        state = _add(state, round_keys[r])
+    return bytes(state)
+
+
+def aes_decrypt(key, block, round_keys=None):
+    round_keys = round_keys or expand_key(key)
+    state = _add(list(block), round_keys[10])
+    for r in range(9, -1, -1):
+        state = [INV_SBOX[b] for b in _shift_rows(state, -1)]
+        state = _add(state, round_keys[r])
+        if r > 0:
+            state = _mix_columns(state, (14, 11, 13, 9))
+    return bytes(state)
+
+
+# ===============================================================
+# AES-CMAC (RFC 4493)
+# ===============================================================
+
+
+def _shift_left(block):
+    value = (int.from_bytes(block, "big") << 1) & ((1 << 128) - 1)
+    if block[0] & 0x80:
+        value ^= 0x87
+    return value.to_bytes(16, "big")
+
+
+def _xor(a, b):
+    return bytes(x ^ y for x, y in zip(a, b))
+
+
+def aes_cmac(key, message):
+    round_keys = expand_key(key)
+    k1 = _shift_left(aes_encrypt(key, bytes(16), round_keys))
+    k2 = _shift_left(k1)
+    blocks = [message[i:i + 16] for i in range(0, len(message), 16)] or [b""]
+    if len(blocks[-1]) == 16:
+        blocks[-1] = _xor(blocks[-1], k1)
+    else:
+        padded = blocks[-1] + b"\x80" + bytes(15 - len(blocks[-1]))
+        blocks[-1] = _xor(padded, k2)
+    state = bytes(16)
+    for block in blocks:
+        state = aes_encrypt(key, _xor(state, block), round_keys)
+    return state
+
+
+# ===============================================================
+# LORAWAN DOWNLINK FRAMES
+# ===============================================================
+
+MHDR_UNCONFIRMED_DOWN = 0x60
+
+
+def _downlink_block(tag, address, fcnt, last):
+    return struct.pack("<B4xBIIxB", tag, 0x01, address, fcnt, last)
+
+
+def encrypt_payload(app_s_key, address, fcnt, payload):
+    """FRMPayload encryption (the same XOR both ways)."""
+    round_keys = expand_key(app_s_key)
+    out = bytearray()
+    for i in range(0, len(payload), 16):
+        stream = aes_encrypt(app_s_key, _downlink_block(0x01, address, fcnt, i // 16 + 1), round_keys)
+        out += _xor(payload[i:i + 16], stream)
+    return bytes(out)
+
+
+def downlink_frame(nwk_s_key, app_s_key, address, fcnt, port, payload):
+    """Unconfirmed data down, no FOpts: what a gateway puts on air."""
+    message = struct.pack("<BIBHB", MHDR_UNCONFIRMED_DOWN, address, 0, fcnt & 0xFFFF, port)
+    message += encrypt_payload(app_s_key, address, fcnt, payload)
+    mic = aes_cmac(nwk_s_key, _downlink_block(0x49, address, fcnt, len(message)) + message)[:4]
+    return message + mic
+
+
+# ===============================================================
+# REMOTE MULTICAST SETUP KEYS (TS005)
+# ===============================================================
+
+
+def multicast_ke_key(gen_app_key):
+    root = aes_encrypt(gen_app_key, bytes(16))
+    return aes_encrypt(root, bytes(16))
+
+
+def encrypt_multicast_key(gen_app_key, mc_key):
+    """McKey_encrypted for McGroupSetupReq. The device recovers McKey with
+    AES encrypt (TS005), so the server side is AES decrypt."""
+    return aes_decrypt(multicast_ke_key(gen_app_key), mc_key)
+
+
+def multicast_session_keys(mc_key, address):
+    """(McAppSKey, McNetSKey) of a group."""
+    app = aes_encrypt(mc_key, struct.pack("<BI11x", 0x01, address))
+    nwk = aes_encrypt(mc_key, struct.pack("<BI11x", 0x02, address))
+    return app, nwk
+
+
+# ===============================================================
+# SELF TEST
+# ===============================================================
+
+FIPS197 = ("000102030405060708090a0b0c0d0e0f", "00112233445566778899aabbccddeeff",
+           "69c4e0d86a7b0430d8cdb78070b4c55a")
+RFC4493_KEY = "2b7e151628aed2a6abf7158809cf4f3c"
+RFC4493_MESSAGE = ("6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e51"
+                   "30c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b417be66c3710")
+RFC4493 = ((0, "bb1d6929e95937287fa37d129b756746"), (16, "070a16b46b4d4144f79bdd9dd04a287c"),
+           (40, "dfa66747de9ae63030ca32611497c827"), (64, "51f0bebf7e3b9d92fc49741779363cfe"))
+# TS005 key chain, computed with OpenSSL from the formulas above: GenAppKey,
+# McAddr, McKey_encrypted -> McKEKey, McKey, McAppSKey, McNetSKey
+TS005 = ("2b7e151628aed2a6abf7158809cf4f3c", 0x01ABCDEF, "f4a1b6c0e03d5a8c92b7106e3d5c8a17",
+         "8cb8665e0c0e0b645b2ed9e48a19277c", "73b0af69abf9d303e5d32f638bcea55e",
+         "cb40ea40d292f4ef79e4beb0a6c298a9", "048f51a96106b71940247f65a4af2380")
+
+
+def selftest():
+    key, plain, cipher = (bytes.fromhex(v) for v in FIPS197)
+    ok = aes_encrypt(key, plain) == cipher and aes_decrypt(key, cipher) == plain
+    key = bytes.fromhex(RFC4493_KEY)
+    message = bytes.fromhex(RFC4493_MESSAGE)
+    for length, mac in RFC4493:
+        ok = ok and aes_cmac(key, message[:length]).hex() == mac
+
+    gen_app_key, address, encrypted, ke_key, mc_key, app, nwk = TS005
+    gen_app_key, encrypted, mc_key = (bytes.fromhex(v) for v in (gen_app_key, encrypted, mc_key))
+    ok = ok and multicast_ke_key(gen_app_key).hex() == ke_key
+    ok = ok and encrypt_multicast_key(gen_app_key, mc_key) == encrypted
+    ok = ok and aes_encrypt(bytes.fromhex(ke_key), encrypted) == mc_key
+    ok = ok and tuple(k.hex() for k in multicast_session_keys(mc_key, address)) == (app, nwk)
+    return ok
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="command", required=True)
+    sub.add_parser("selftest", help="check AES, CMAC and the TS005 keys against known vectors")
+    keys = sub.add_parser("keys", help="McKEKey of a device")
+    keys.add_argument("genappkey", help="GenAppKey (AppKey for LoRaWAN 1.0.x), hex")
+    args = parser.parse_args(argv[1:])
+
+    if args.command == "selftest":
+        ok = selftest()
+        print("AES-128, AES-CMAC and TS005 key vectors: %s" % ("ok" if ok else "FAILED"))
+        return 0 if ok else 1
+    print(multicast_ke_key(bytes.fromhex(args.genappkey)).hex().upper())
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
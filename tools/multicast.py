@@ -0,0 +1,304 @@
+#!/usr/bin/env python3
+"""Backend side of multicast groups (src/multicast_groups.h), and a
+simulation of a fleet-wide push against unicast.
+
+    multicast.py setup GENAPPKEY --id 0 --addr 01ABCDEF --mckey KEY
+                                              McGroupSetupReq for one device, hex
+    multicast.py session --id 0 --start UNIX [--timeout 9] [--freq 916.6] [--dr 0]
+                                              McClassCSessionReq (same for every device)
+    multicast.py frame --addr 01ABCDEF --mckey KEY --fcnt N --port 2 PAYLOAD
+                                              the frame the gateways send, hex
+    multicast.py simulate [--devices 500] [--size 480] [--gateways 3]
+
+A group is set up once per device (the McKey goes out encrypted under
+the device's own McKEKey) and stays across reboots; each push then needs
+one small McClassCSessionReq per device, one Class A downlink, before the
+session starts. During the session every gateway sends the payload once
+(or --repeats times) at a data rate the whole group hears, and devices
+that missed a frame get it by unicast afterwards.
+
+simulate draws a link budget per device (SNR at the gateway, ADR picks
+its data rate with --adr-margin to spare, each frame fades on top) and
+pushes --size bytes to all of them: once by unicast, one frame per
+uplink, resent until acknowledged; once by multicast with the session
+requests, the Class C session and the unicast repair. It reports the
+delivery ratio by --deadline, the time until every device has it, and
+the total gateway airtime. A gateway sends one downlink at a time, so a
+Class A window that finds its gateway busy goes unused.
+"""
+
+import argparse
+import heapq
+import math
+import random
+import struct
+import sys
+
+from fuota import AS923_DR, time_on_air
+from lorawan_crypto import downlink_frame, encrypt_multicast_key, multicast_session_keys
+
+MULTICAST_SETUP_PORT = 200
+PACKAGE_VERSION = 0x00
+MC_GROUP_STATUS = 0x01
+MC_GROUP_SETUP = 0x02
+MC_GROUP_DELETE = 0x03
+MC_CLASS_C_SESSION = 0x04
+
+GPS_UNIX_OFFSET = 315964800     # 1980-01-06 in Unix time
+GPS_LEAP_SECONDS = 18
+SETUP_BYTES = 30                # McGroupSetupReq
+SESSION_BYTES = 11              # McClassCSessionReq
+RX1_DELAY = 1.0                 # Seconds from uplink to the downlink window
+
+# Demodulation floor (SNR, dB) by spreading factor
+REQUIRED_SNR = {7: -7.5, 8: -10.0, 9: -12.5, 10: -15.0, 11: -17.5, 12: -20.0}
+
+
+# ===============================================================
+# COMMANDS
+# ===============================================================
+
+
+def group_setup(gen_app_key, group, address, mc_key, min_fcnt=0, max_fcnt=0xFFFFFFFF):
+    return (struct.pack("<BBI", MC_GROUP_SETUP, group, address) + encrypt_multicast_key(gen_app_key, mc_key)
+            + struct.pack("<II", min_fcnt, max_fcnt))
+
+
+def class_c_session(group, start, timeout, frequency, dr):
+    """start in Unix time; the session lasts 2**timeout seconds."""
+    gps = (start - GPS_UNIX_OFFSET + GPS_LEAP_SECONDS) & 0xFFFFFFFF
+    hz100 = round(frequency / 100)
+    return struct.pack("<BBIB", MC_CLASS_C_SESSION, group, gps, timeout) + hz100.to_bytes(3, "little") + bytes([dr])
+
+
+def parse_answers(payload):
+    """Answers from MULTICAST_SETUP_PORT, as (command, fields) tuples."""
+    answers = []
+    pos = 0
+    while pos < len(payload):
+        command = payload[pos]
+        if command == PACKAGE_VERSION and pos + 3 <= len(payload):
+            answers.append(("version", {"package": payload[pos + 1], "version": payload[pos + 2]}))
+            pos += 3
+        elif command == MC_GROUP_STATUS and pos + 2 <= len(payload):
+            count = payload[pos + 1] >> 4
+            groups = {}
+            for i in range(count):
+                group, address = struct.unpack_from("<BI", payload, pos + 2 + 5 * i)
+                groups[group] = address
+            answers.append(("status", {"mask": payload[pos + 1] & 0x0F, "groups": groups}))
+            pos += 2 + 5 * count
+        elif command in (MC_GROUP_SETUP, MC_GROUP_DELETE) and pos + 2 <= len(payload):
+            answers.append(("setup" if command == MC_GROUP_SETUP else "delete",
+                            {"group": payload[pos + 1] & 0x03, "error": bool(payload[pos + 1] & 0x04)}))
+            pos += 2
+        elif command == MC_CLASS_C_SESSION and pos + 2 <= len(payload):
+            status = payload[pos + 1]
+            fields = {"group": status & 0x03, "dr_error": bool(status & 0x04), "freq_error": bool(status & 0x08),
+                      "undefined": bool(status & 0x10)}
+            pos += 2
+            if (status & 0x1C) == 0 and pos + 3 <= len(payload):
+                fields["time_to_start"] = int.from_bytes(payload[pos:pos + 3], "little")
+                pos += 3
+            answers.append(("session", fields))
+        else:
+            raise ValueError("bad answer at byte %d" % pos)
+    return answers
+
+
+# ===============================================================
+# SIMULATION
+# ===============================================================
+
+
+def success(snr, sf, rng, fading, loss):
+    """One frame gets through: faded SNR above the floor, and no collision."""
+    return rng.gauss(snr, fading) >= REQUIRED_SNR[sf] and rng.random() >= loss
+
+
+class Device:
+    def __init__(self, index, snr, gateway, adr_margin, interval, rng):
+        self.index = index
+        self.snr = snr
+        self.gateway = gateway
+        self.dr = max([dr for dr, (sf, _) in AS923_DR.items() if snr - REQUIRED_SNR[sf] >= adr_margin] or [0])
+        self.phase = rng.uniform(0, interval)
+
+
+def split(size, largest):
+    return [min(largest, size - offset) for offset in range(0, size, largest)]
+
+
+def class_a(devices, queues, start, deadline, args, rng, busy):
+    """Sends each device its queue of downlink sizes over Class A, one
+    downlink per received uplink, resent until an uplink acknowledges it.
+    Returns the completion time by device (absent: not by the deadline)
+    and the airtime used; busy is the time each gateway is free again."""
+    done = {}
+    airtime = 0.0
+    pending = {}                # Device -> got the downlink last sent
+    slots = []
+    for device in devices:
+        if queues[device.index]:
+            first = start + (device.phase - start) % args.interval
+            heapq.heappush(slots, (first, device.index))
+        else:
+            done[device.index] = start
+    by_index = {device.index: device for device in devices}
+    while slots:
+        t, index = heapq.heappop(slots)
+        if t > deadline:
+            break
+        device = by_index[index]
+        sf = AS923_DR[device.dr][0]
+        if success(device.snr, sf, rng, args.fading, args.loss):
+            queue = queues[index]
+            if pending.pop(index, False):
+                queue.pop(0)
+            if not queue:
+                done[index] = t
+                continue
+            window = t + RX1_DELAY
+            if busy[device.gateway] <= window:
+                length = time_on_air(queue[0], sf)
+                busy[device.gateway] = window + length
+                airtime += length
+                pending[index] = success(device.snr, sf, rng, args.fading, args.loss)
+        heapq.heappush(slots, (t + args.interval * rng.uniform(0.95, 1.05), index))
+    return done, airtime
+
+
+def fleet(args, rng):
+    devices = []
+    for i in range(args.devices):
+        # Devices that cannot hold DR0 never joined; they are not in the fleet
+        snr = rng.gauss(args.snr, args.snr_spread)
+        while snr < REQUIRED_SNR[12]:
+            snr = rng.gauss(args.snr, args.snr_spread)
+        devices.append(Device(i, snr, i % args.gateways, args.adr_margin, args.interval, rng))
+    return devices
+
+
+def push_unicast(devices, args, rng):
+    queues = {d.index: split(args.size, AS923_DR[d.dr][1]) for d in devices}
+    busy = [0.0] * args.gateways
+    return class_a(devices, queues, 0.0, args.deadline, args, rng, busy)
+
+
+def push_multicast(devices, args, rng):
+    # Session requests (and the group setup, first push only) by unicast
+    request = SESSION_BYTES + (SETUP_BYTES if args.with_setup else 0)
+    queues = {d.index: [request] for d in devices}
+    busy = [0.0] * args.gateways
+    joined, airtime = class_a(devices, queues, 0.0, args.lead, args, rng, busy)
+
+    # The session: every gateway sends the whole payload at the group's rate
+    sf, largest = AS923_DR[args.mc_dr]
+    frames = split(args.size, largest)
+    session = sum(time_on_air(size, sf) for size in frames) * args.repeats
+    airtime += session * args.gateways
+    end = args.lead + session
+    missing = {}
+    for device in devices:
+        if device.index in joined:
+            heard = [any(success(device.snr, sf, rng, args.fading, args.loss) for _ in range(args.repeats))
+                     for _ in frames]
+            lost = [size for size, ok in zip(frames, heard) if not ok]
+        else:
+            lost = list(frames)
+        # Repair at the device's own rate, in its own frame sizes
+        lost_bytes = sum(lost)
+        missing[device.index] = split(lost_bytes, AS923_DR[device.dr][1]) if lost_bytes else []
+    repaired = sum(1 for queue in missing.values() if queue)
+    busy = [end] * args.gateways
+    done, repair = class_a(devices, missing, end, args.deadline, args, rng, busy)
+    return done, (airtime - session * args.gateways, session * args.gateways, repair), \
+        sum(1 for d in devices if d.index in joined), repaired
+
+
+def report(name, done, airtime, args):
+    delivered = len(done)
+    times = sorted(done.values())
+    last = "%8.1f" % (times[-1] / 3600.0) if delivered == args.devices else "     n/a"
+    p95 = times[math.ceil(0.95 * args.devices) - 1] / 3600.0 if delivered >= 0.95 * args.devices else None
+    print("%-24s | %6.1f%% | %8s | %s | %9.1f"
+          % (name, 100.0 * delivered / args.devices, "%8.1f" % p95 if p95 is not None else "     n/a",
+             last, airtime))
+
+
+def simulate(args):
+    rng = random.Random(args.seed)
+    devices = fleet(args, rng)
+    mix = {}
+    for device in devices:
+        mix[device.dr] = mix.get(device.dr, 0) + 1
+    print("%d devices, %d gateways, %d-byte push, uplink every %d s; ADR data rates %s"
+          % (args.devices, args.gateways, args.size, args.interval,
+             ", ".join("DR%d: %d" % (dr, n) for dr, n in sorted(mix.items()))))
+    print("%-24s | %7s | %8s | %8s | %9s" % ("", "by " + "%gh" % (args.deadline / 3600.0), "95% h", "all h",
+                                            "gateway s"))
+    done, airtime = push_unicast(devices, args, random.Random(args.seed + 1))
+    report("unicast", done, airtime, args)
+    done, airtime, joined, repaired = push_multicast(devices, args, random.Random(args.seed + 1))
+    report("multicast DR%d x%d%s" % (args.mc_dr, args.repeats, " +setup" if args.with_setup else ""),
+           done, sum(airtime), args)
+    print("multicast: %d/%d in the session after %d s of requests, %d repaired by unicast;"
+          % (joined, args.devices, args.lead, repaired))
+    print("gateway s: %.1f requests, %.1f session, %.1f repair" % airtime)
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="command", required=True)
+    setup = sub.add_parser("setup", help="McGroupSetupReq for one device")
+    setup.add_argument("genappkey", help="the device's GenAppKey (AppKey for LoRaWAN 1.0.x), hex")
+    setup.add_argument("--id", type=int, default=0, choices=range(4))
+    setup.add_argument("--addr", type=lambda v: int(v, 16), required=True, help="McAddr, hex")
+    setup.add_argument("--mckey", required=True, help="the group's McKey, hex")
+    setup.add_argument("--min-fcnt", type=int, default=0)
+    setup.add_argument("--max-fcnt", type=int, default=0xFFFFFFFF)
+    session = sub.add_parser("session", help="McClassCSessionReq")
+    session.add_argument("--id", type=int, default=0, choices=range(4))
+    session.add_argument("--start", type=int, required=True, help="Unix time")
+    session.add_argument("--timeout", type=int, default=9, choices=range(16), help="session lasts 2^timeout s")
+    session.add_argument("--freq", type=float, default=916.6, help="MHz")
+    session.add_argument("--dr", type=int, default=0, choices=range(7))
+    frame = sub.add_parser("frame", help="a multicast frame, encrypted and signed")
+    frame.add_argument("--addr", type=lambda v: int(v, 16), required=True)
+    frame.add_argument("--mckey", required=True)
+    frame.add_argument("--fcnt", type=int, required=True)
+    frame.add_argument("--port", type=int, default=2)
+    frame.add_argument("payload", help="hex")
+    sim = sub.add_parser("simulate", help="fleet push, multicast against unicast")
+    sim.add_argument("--devices", type=int, default=500)
+    sim.add_argument("--gateways", type=int, default=3)
+    sim.add_argument("--size", type=int, default=480, help="bytes pushed to every device")
+    sim.add_argument("--interval", type=int, default=300, help="seconds between uplinks")
+    sim.add_argument("--snr", type=float, default=-5.0, help="mean device SNR at its gateway, dB")
+    sim.add_argument("--snr-spread", type=float, default=7.0)
+    sim.add_argument("--fading", type=float, default=3.0, help="per-frame SNR spread, dB")
+    sim.add_argument("--loss", type=float, default=0.05, help="collisions and interference, each frame")
+    sim.add_argument("--adr-margin", type=float, default=5.0, help="dB ADR keeps above the floor")
+    sim.add_argument("--mc-dr", type=int, default=0, choices=sorted(AS923_DR), help="multicast data rate")
+    sim.add_argument("--repeats", type=int, default=2, help="times the session sends each frame")
+    sim.add_argument("--lead", type=int, default=3600, help="seconds of session requests before it starts")
+    sim.add_argument("--with-setup", action="store_true", help="first push: group setup goes out too")
+    sim.add_argument("--deadline", type=int, default=6 * 3600, help="seconds")
+    sim.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args(argv[1:])
+
+    if args.command == "setup":
+        print(group_setup(bytes.fromhex(args.genappkey), args.id, args.addr, bytes.fromhex(args.mckey),
+                          args.min_fcnt, args.max_fcnt).hex().upper())
+    elif args.command == "session":
+        print(class_c_session(args.id, args.start, args.timeout, args.freq * 1e6, args.dr).hex().upper())
+    elif args.command == "frame":
+        app, nwk = multicast_session_keys(bytes.fromhex(args.mckey), args.addr)
+        print(downlink_frame(nwk, app, args.addr, args.fcnt, args.port, bytes.fromhex(args.payload)).hex().upper())
+    elif args.command == "simulate":
+        simulate(args)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,222 @@
+#!/usr/bin/env python3
+"""Compile geofence rules to the bytecode run by src/rule_engine.cpp.
+
+Grammar (case-insensitive, `not` binds tighter than `and`, then `or`):
+
+    expr    := term ('or' term)*
+    term    := factor ('and' factor)*
+    factor  := 'not' factor | '(' expr ')' | atom
+    atom    := 'inside' '(' id ')'
+             | 'inside_any' '(' id (',' id)* ')'
+             | 'outside_all' '(' id (',' id)* ')'
+             | 'speed' ('>' | '<=') km/h
+             | 'time' '(' HH:MM ',' HH:MM ')'
+
+Times are local, rounded down to the 15-minute slots the device uses; a
+window whose end is not after its start wraps past midnight.
+
+Examples:
+    rule_compiler.py 1 "inside(3) and speed > 15"
+    rule_compiler.py 2 "outside_all(1, 2) and time(22:00, 06:00)"
+
+Prints the bytecode and the CMD_SET_RULE downlink for LORAWAN_CONFIG_PORT
+as hex and base64.
+"""
+
+import base64
+import re
+import sys
+
+OP_END = 0x00
+OP_INSIDE = 0x01
+OP_INSIDE_ANY = 0x02
+OP_SPEED_ABOVE = 0x03
+OP_TIME_IN = 0x04
+OP_NOT = 0x10
+OP_AND = 0x11
+OP_OR = 0x12
+
+CMD_SET_RULE = 0x12
+SLOT_MINUTES = 15
+STACK_DEPTH = 32
+
+TOKEN = re.compile(r"\s*(\d{1,2}:\d{2}|\d+|<=|>|[(),]|[A-Za-z_]+)")
+
+
+class RuleError(Exception):
+    pass
+
+
+def tokenize(text):
+    tokens, pos = [], 0
+    text = text.strip()
+    while pos < len(text):
+        match = TOKEN.match(text, pos)
+        if not match:
+            raise RuleError("unexpected input at %r" % text[pos:])
+        tokens.append(match.group(1).lower())
+        pos = match.end()
+    return tokens
+
+
+class Parser:
+    def __init__(self, tokens):
+        self.tokens = tokens
+        self.pos = 0
+        self.code = []
+
+    def peek(self):
+        return self.tokens[self.pos] if self.pos < len(self.tokens) else None
+
+    def take(self, expected=None):
+        token = self.peek()
+        if token is None or (expected is not None and token != expected):
+            raise RuleError("expected %r, got %r" % (expected or "token", token))
+        self.pos += 1
+        return token
+
+    def number(self, limit):
+        token = self.take()
+        if not token.isdigit() or int(token) > limit:
+            raise RuleError("expected a number 0..%d, got %r" % (limit, token))
+        return int(token)
+
+    def slot(self):
+        token = self.take()
+        if ":" not in token:
+            raise RuleError("expected HH:MM, got %r" % token)
+        hours, minutes = (int(part) for part in token.split(":"))
+        if hours > 23 or minutes > 59:
+            raise RuleError("bad time %r" % token)
+        return (hours * 60 + minutes) // SLOT_MINUTES
+
+    def id_list(self):
+        self.take("(")
+        ids = [self.number(255)]
+        while self.peek() == ",":
+            self.take(",")
+            ids.append(self.number(255))
+        self.take(")")
+        return ids
+
+    def expr(self):
+        self.term()
+        while self.peek() == "or":
+            self.take()
+            self.term()
+            self.code.append(OP_OR)
+
+    def term(self):
+        self.factor()
+        while self.peek() == "and":
+            self.take()
+            self.factor()
+            self.code.append(OP_AND)
+
+    def factor(self):
+        token = self.peek()
+        if token == "not":
+            self.take()
+            self.factor()
+            self.code.append(OP_NOT)
+        elif token == "(":
+            self.take()
+            self.expr()
+            self.take(")")
+        else:
+            self.atom()
+
+    def atom(self):
+        token = self.take()
+        if token == "inside":
+            ids = self.id_list()
+            if len(ids) == 1:
+                self.code += [OP_INSIDE, ids[0]]
+            else:
+                self.code += [OP_INSIDE_ANY, len(ids)] + ids
+        elif token in ("inside_any", "outside_all"):
+            ids = self.id_list()
+            self.code += [OP_INSIDE_ANY, len(ids)] + ids
+            if token == "outside_all":
+                self.code.append(OP_NOT)
+        elif token == "speed":
+            op = self.take()
+            if op not in (">", "<="):
+                raise RuleError("speed supports '>' and '<=' only")
+            self.code += [OP_SPEED_ABOVE, self.number(255)]
+            if op == "<=":
+                self.code.append(OP_NOT)
+        elif token == "time":
+            self.take("(")
+            start = self.slot()
+            self.take(",")
+            end = self.slot()
+            self.take(")")
+            self.code += [OP_TIME_IN, start, end]
+        else:
+            raise RuleError("unknown condition %r" % token)
+
+
+def max_depth(code):
+    depth = peak = pc = 0
+    while pc < len(code):
+        op = code[pc]
+        pc += 1
+        if op in (OP_INSIDE, OP_SPEED_ABOVE):
+            pc += 1
+            depth += 1
+        elif op == OP_INSIDE_ANY:
+            pc += 1 + code[pc]
+            depth += 1
+        elif op == OP_TIME_IN:
+            pc += 2
+            depth += 1
+        elif op in (OP_AND, OP_OR):
+            depth -= 1
+        peak = max(peak, depth)
+    return peak
+
+
+def compile_rule(text):
+    parser = Parser(tokenize(text))
+    parser.expr()
+    if parser.peek() is not None:
+        raise RuleError("trailing input at %r" % parser.peek())
+    code = parser.code + [OP_END]
+    if len(code) > 255:
+        raise RuleError("rule too long (%d bytes)" % len(code))
+    if max_depth(code) > STACK_DEPTH:
+        raise RuleError("rule nests deeper than %d" % STACK_DEPTH)
+    return bytes(code)
+
+
+def downlink(rule_id, code):
+    return bytes([CMD_SET_RULE, rule_id, len(code)]) + code
+
+
+def main(argv):
+    if len(argv) != 3:
+        print(__doc__)
+        return 1
+
+    try:
+        rule_id = int(argv[1])
+        if not 0 <= rule_id <= 255:
+            raise ValueError
+        code = compile_rule(argv[2])
+    except ValueError:
+        print("error: rule id must be 0..255", file=sys.stderr)
+        return 1
+    except RuleError as err:
+        print("error: %s" % err, file=sys.stderr)
+        return 1
+
+    payload = downlink(rule_id, code)
+    print("bytecode (%d bytes): %s" % (len(code), code.hex()))
+    print("downlink port 10 hex:    %s" % payload.hex())
+    print("downlink port 10 base64: %s" % base64.b64encode(payload).decode())
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
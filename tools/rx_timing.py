@@ -0,0 +1,292 @@
+#!/usr/bin/env python3
+"""Class A receive window calibration (src/rx_timing.h) against a
+simulated radio.
+
+    rx_timing.py simulate [--uplinks 20000] [--dr 5] [--rx1-delay 1]
+    rx_timing.py airtime SF BANDWIDTH LENGTH [--crc]
+
+simulate runs a model of src/rx_timing.cpp over a stream of Class A
+exchanges and prints, next to RadioLib's fixed 10 ms padding, the time
+the radio spends in RX per uplink and how many downlinks the windows
+miss. The simulated device has:
+
+  - a crystal off by --ppm (plus a slow temperature wander), so a window
+    opens ppm x delay late
+  - wake-up latency: a fixed part (--bias), a scatter (--wake-jitter),
+    timer tick quantisation (--tick) and now and then a task that holds
+    the CPU (--preempt, up to --preempt-ms)
+  - a stopwatch around sendReceive that sees the same kind of latency,
+    drawn independently, plus constant frame setup and MIC time
+
+A downlink is caught when the window is open before its preamble has
+fewer than --min-symbols symbols left. Downlinks the network sends
+(--downlink-rate of uplinks, every confirmed uplink) are also lost on
+air at --loss, which the device cannot tell from a window miss.
+"""
+
+import argparse
+import math
+import random
+import sys
+
+GUARD_DEFAULT = 10      # ms, RX_GUARD_DEFAULT (RadioLib's scanGuard)
+GUARD_MIN = 3           # RX_GUARD_MIN
+GUARD_MARGIN = 1000     # us, RX_GUARD_MARGIN
+GUARD_SIGMAS = 4.0      # RX_GUARD_SIGMAS
+CALIBRATION_SAMPLES = 8  # RX_CALIBRATION_SAMPLES
+CRYSTAL_PPM = 20.0      # RX_CRYSTAL_PPM
+MAX_DELAY = 15          # RX_MAX_DELAY
+MAX_PPM = 50.0          # RX_MAX_PPM
+MEAN_SAMPLES = 64       # RX_MEAN_SAMPLES
+PEAK_DECAY = 0.995      # RX_PEAK_DECAY
+FRAME_OVERHEAD = 13     # LORAWAN_FRAME_OVERHEAD
+PREAMBLE = 8
+
+# AS923 data rates (SF, kHz); RX2 is DR2
+RATES = [(12, 125), (11, 125), (10, 125), (9, 125), (8, 125), (7, 125), (7, 250)]
+RX2_DR = 2
+
+
+def airtime(sf, bandwidth, length, crc):
+    """loraTimeOnAir(): us, CR 4/5, explicit header, 8-symbol preamble."""
+    symbol = (1 << sf) * 1000.0 / bandwidth
+    low_rate = 2 if symbol >= 16000 else 0
+    bits = 8 * length - 4 * sf + 28 + (16 if crc else 0)
+    per_block = 4 * (sf - low_rate)
+    blocks = (bits + per_block - 1) // per_block if bits > 0 else 0
+    return int((PREAMBLE + 4.25 + 8 + blocks * 5) * symbol)
+
+
+# ===============================================================
+# DEVICE (src/rx_timing.cpp)
+# ===============================================================
+
+
+class RxTiming:
+    def __init__(self, adaptive=True):
+        self.adaptive = adaptive
+        self.guard = GUARD_DEFAULT
+        self.mean = [0.0, 0.0]
+        self.delay = [0, 0]
+        self.window_samples = [0, 0]
+        self.scatter = 0.0
+        self.peak = 0.0
+        self.drift = 0.0
+        self.samples = 0
+        self.misses = 0
+
+    def scatter_sigma(self):
+        return self.scatter * 1.25
+
+    def exchange(self, window, elapsed, uplink_airtime, downlink_airtime):
+        if window == 0 or not uplink_airtime or not downlink_airtime:
+            return
+        residual = elapsed - uplink_airtime - downlink_airtime
+        delay = int((residual + 500000) // 1000000)
+        if delay < 1 or delay > MAX_DELAY:
+            return
+        offset = residual - delay * 1000000.0
+
+        w = window - 1
+        if self.delay[w] != delay:
+            self.delay[w] = delay
+            self.window_samples[w] = 0
+            self.drift = 0.0
+        if self.window_samples[w] == 0:
+            self.mean[w] = offset
+        else:
+            deviation = abs(offset - self.mean[w])
+            deviations = self.samples if self.samples > 0 else 1
+            weight = 1.0 / deviations if deviations < 8 else 0.125
+            self.scatter += (deviation - self.scatter) * weight
+            self.peak = max(self.peak * PEAK_DECAY, deviation)
+            self.mean[w] += (offset - self.mean[w]) / min(self.window_samples[w] + 1, MEAN_SAMPLES)
+        self.window_samples[w] += 1
+        self.samples += 1
+
+        if min(self.window_samples) >= 2 and self.delay[1] != self.delay[0]:
+            drift = (self.mean[1] - self.mean[0]) / (self.delay[1] - self.delay[0])
+            self.drift = max(-MAX_PPM, min(MAX_PPM, drift))
+        self.update_guard()
+
+    def downlink_missed(self):
+        self.misses += 1
+        self.samples = 0
+        self.update_guard()
+
+    def update_guard(self):
+        if not self.adaptive or self.samples < CALIBRATION_SAMPLES:
+            self.guard = GUARD_DEFAULT
+            return
+        delay = self.delay[1] if self.window_samples[1] > 0 else self.delay[0] + 1
+        ppm = abs(self.drift) if min(self.window_samples) >= 2 else CRYSTAL_PPM
+        error = max(GUARD_SIGMAS * self.scatter_sigma(), self.peak) + ppm * delay + GUARD_MARGIN
+        self.guard = max(GUARD_MIN, min(GUARD_DEFAULT, math.ceil(error / 1000.0)))
+
+
+# ===============================================================
+# SIMULATED RADIO
+# ===============================================================
+
+
+class Radio:
+    """Timing of one device: crystal, wake-up latency, stopwatch."""
+
+    def __init__(self, args, rng):
+        self.args = args
+        self.rng = rng
+        self.ppm = args.ppm
+        self.setup = 8000 + rng.uniform(-500, 500)     # Frame build and SPI before TX (us)
+        self.finish = 3000 + rng.uniform(-500, 500)    # MIC check and decrypt after RX
+
+    def wander(self):
+        # Temperature moves the crystal a little between uplinks
+        self.ppm += self.rng.gauss(0, 0.05)
+        self.ppm += (self.args.ppm - self.ppm) * 0.01
+
+    def latency(self):
+        a = self.args
+        value = self.rng.uniform(0, a.tick * 1000) + abs(self.rng.gauss(0, a.wake_jitter * 1000))
+        if self.rng.random() < a.preempt:
+            value += self.rng.uniform(0, a.preempt_ms * 1000)
+        return value
+
+    def window_error(self, delay):
+        """How late (us) a window opens against the gateway's timing."""
+        return self.args.bias * 1000 + self.ppm * delay + self.latency()
+
+    def stopwatch(self, uplink_airtime, delay, downlink_airtime):
+        """micros() from calling sendReceive to its return."""
+        return int(self.setup + self.rng.gauss(0, 100) + uplink_airtime + delay * (1e6 + self.ppm)
+                   + self.latency() + downlink_airtime + self.finish + self.rng.gauss(0, 100))
+
+
+def window_catches(error, guard_us, sf, bandwidth, min_symbols):
+    symbol = (1 << sf) * 1000.0 / bandwidth
+    open_at = error - guard_us                            # Against the preamble's start
+    close_at = open_at + airtime(sf, bandwidth, 0, False) + 2 * guard_us
+    return open_at <= (PREAMBLE - min_symbols) * symbol and close_at >= min_symbols * symbol
+
+
+def window_on_time(error, guard_us, sf, bandwidth, downlink_airtime):
+    """us the radio listens: to the timeout, or to the end of the frame."""
+    if downlink_airtime is None:
+        return airtime(sf, bandwidth, 0, False) + 2 * guard_us
+    return guard_us - error + downlink_airtime
+
+
+def run(args, adaptive, seed):
+    rng = random.Random(seed)
+    radio = Radio(args, rng)
+    device = RxTiming(adaptive)
+    up_sf, up_bw = RATES[args.dr]
+    down_dr = max(0, args.dr - args.rx1_offset)
+    rx1 = RATES[down_dr]
+    rx2 = RATES[RX2_DR]
+    stats = {"rx": 0.0, "sent": 0, "timing_misses": 0, "received": 0, "guard": 0}
+
+    for n in range(args.uplinks):
+        radio.wander()
+        guard_us = device.guard * 1000
+        stats["guard"] += device.guard
+        length = rng.randint(8, 40)
+        uplink_airtime = airtime(up_sf, up_bw, length + FRAME_OVERHEAD, True)
+        confirmed = args.confirmed_every and n % args.confirmed_every == 0
+        # The uplink itself can carry MAC answers (FOpts): not measured
+        measured_up = uplink_airtime if rng.random() > args.fopts else 0
+
+        sends = confirmed or rng.random() < args.downlink_rate
+        window = 0
+        downlink_airtime = None
+        if sends:
+            stats["sent"] += 1
+            window = 1 if rng.random() >= args.rx2_share else 2
+            sf, bw = rx1 if window == 1 else rx2
+            delay = args.rx1_delay + window - 1
+            downlink_airtime = airtime(sf, bw, rng.randint(0, 20) + FRAME_OVERHEAD, False)
+            error = radio.window_error(delay)
+            if rng.random() < args.loss:
+                window, downlink_airtime = 0, None
+            elif not window_catches(error, guard_us, sf, bw, args.min_symbols):
+                stats["timing_misses"] += 1
+                window, downlink_airtime = 0, None
+
+        # RX1, then RX2 unless RX1 brought the downlink
+        if window == 1:
+            stats["rx"] += window_on_time(error, guard_us, rx1[0], rx1[1], downlink_airtime)
+        else:
+            stats["rx"] += window_on_time(0, guard_us, rx1[0], rx1[1], None)
+            stats["rx"] += window_on_time(error if window == 2 else 0, guard_us, rx2[0], rx2[1],
+                                          downlink_airtime)
+
+        if window > 0:
+            stats["received"] += 1
+            elapsed = radio.stopwatch(uplink_airtime, args.rx1_delay + window - 1, downlink_airtime)
+            device.exchange(window, elapsed, measured_up, downlink_airtime)
+        elif confirmed:
+            device.downlink_missed()
+
+    stats["device"] = device
+    return stats
+
+
+def simulate(args):
+    print("DR%d uplinks, RX1 delay %d s, RX2 DR%d, %d uplinks, downlinks after %.0f%% + every %s confirmed"
+          % (args.dr, args.rx1_delay, RX2_DR, args.uplinks, args.downlink_rate * 100,
+             args.confirmed_every or "no"))
+    print("%-12s %10s %10s %12s %12s %10s" % ("padding", "RX ms/up", "saved", "timing miss", "all missed",
+                                             "mean pad"))
+    baseline = None
+    for name, adaptive in (("fixed 10 ms", False), ("calibrated", True)):
+        stats = run(args, adaptive, args.seed)
+        rx = stats["rx"] / args.uplinks / 1000
+        if baseline is None:
+            baseline = rx
+        sent = max(stats["sent"], 1)
+        print("%-12s %10.1f %9.1f%% %11.3f%% %11.2f%% %8.1f ms"
+              % (name, rx, (baseline - rx) / baseline * 100, stats["timing_misses"] / sent * 100,
+                 (sent - stats["received"]) / sent * 100, stats["guard"] / args.uplinks))
+        if adaptive:
+            device = stats["device"]
+            print("  %.1f ms less RX per uplink; measured scatter %.0f us, peak %.0f us, drift %.1f ppm"
+                  " (simulated %.1f), %d unanswered confirmed uplinks"
+                  % (baseline - rx, device.scatter_sigma(), device.peak, device.drift, args.ppm, device.misses))
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="command", required=True)
+    sim = sub.add_parser("simulate", help="RX time and misses, fixed against calibrated padding")
+    sim.add_argument("--uplinks", type=int, default=20000)
+    sim.add_argument("--dr", type=int, default=5, choices=range(len(RATES)), help="uplink data rate (AS923)")
+    sim.add_argument("--rx1-delay", type=int, default=1, help="s (5 on TTN)")
+    sim.add_argument("--rx1-offset", type=int, default=0, help="RX1DROffset")
+    sim.add_argument("--rx2-share", type=float, default=0.2, help="downlinks the network sends in RX2")
+    sim.add_argument("--downlink-rate", type=float, default=0.05, help="uplinks answered, besides confirmed ones")
+    sim.add_argument("--confirmed-every", type=int, default=20, help="0 = none confirmed")
+    sim.add_argument("--loss", type=float, default=0.02, help="downlinks lost on air")
+    sim.add_argument("--fopts", type=float, default=0.1, help="uplinks carrying MAC answers")
+    sim.add_argument("--ppm", type=float, default=10.0, help="crystal error")
+    sim.add_argument("--bias", type=float, default=0.5, help="fixed wake-up latency (ms)")
+    sim.add_argument("--wake-jitter", type=float, default=0.2, help="wake-up scatter (ms, sigma)")
+    sim.add_argument("--tick", type=float, default=1.0, help="timer resolution (ms)")
+    sim.add_argument("--preempt", type=float, default=0.02, help="exchanges where a task holds the CPU")
+    sim.add_argument("--preempt-ms", type=float, default=3.0, help="longest hold (ms)")
+    sim.add_argument("--min-symbols", type=int, default=5, help="preamble symbols the radio needs")
+    sim.add_argument("--seed", type=int, default=1)
+    air = sub.add_parser("airtime", help="LoRa airtime of a PHYPayload (us)")
+    air.add_argument("sf", type=int)
+    air.add_argument("bandwidth", type=int, help="kHz")
+    air.add_argument("length", type=int, help="PHYPayload bytes")
+    air.add_argument("--crc", action="store_true", help="uplink (payload CRC on)")
+    args = parser.parse_args(argv[1:])
+
+    if args.command == "simulate":
+        simulate(args)
+    else:
+        print(airtime(args.sf, args.bandwidth, args.length, args.crc))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
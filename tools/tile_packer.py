@@ -0,0 +1,244 @@
+#!/usr/bin/env python3
+"""Pack a GeoJSON fence set into the LittleFS tiles read by src/tile_store.cpp.
+
+Each Feature needs an integer `id` property (0..65535):
+
+    Polygon       exterior ring plus holes, lon/lat as usual in GeoJSON
+    MultiPolygon  several parcels, each with its own holes
+    Point         circle, with a `radius` property in meters
+
+Rings are simplified (Douglas-Peucker in a local meter frame) to within
+--simplify meters, 1 m by default, which stays inside the device's 2 m
+hysteresis band. Holes that collapse below three vertices are dropped.
+
+The world is cut into TILE_SIZE_MICRODEG cells; every cell touched by a
+fence's bounding box (grown by a few meters so the device hysteresis never
+sees a fence drop out at a cell edge) gets a copy of it.
+
+Examples:
+    tile_packer.py fences.geojson data
+    tile_packer.py --simplify 0.5 parcels.geojson data
+    pio run -t uploadfs
+
+Writes data/tiles/<row>_<col>.bin plus the leaf hash index the device
+syncs against (tools/tile_sync.py), and prints the sizes and the tree
+root that status uplinks should report once the set is installed.
+"""
+
+import argparse
+import json
+import math
+import os
+import struct
+import sys
+
+from tile_sync import write_index
+
+TILE_MAGIC = 0x32544647          # "GFT2"
+TILE_SIZE_MICRODEG = 100000      # Keep in step with include/project_config.h
+TILE_MAX_BYTES = 32768
+TILE_ROW_ORIGIN = -90000000
+TILE_COL_ORIGIN = -180000000
+METERS_PER_MICRODEGREE = 0.11131949
+BOX_MARGIN_METERS = 10.0
+
+GEOFENCE_CIRCLE = 0
+GEOFENCE_POLYGON = 1
+
+HEADER = struct.Struct("<IHHHH")
+FENCE = struct.Struct("<HBBiiiiiiIHH")
+RING = struct.Struct("<HHiiii")
+MAX_FENCE_RINGS = 255
+
+
+class PackError(Exception):
+    pass
+
+
+def micro(value):
+    return int(round(value * 1e6))
+
+
+def simplify_ring(ring, tolerance):
+    """Douglas-Peucker on a closed ring of (lat, lon) micro-degrees."""
+    if tolerance <= 0 or len(ring) <= 4:
+        return ring
+
+    mid = math.cos(math.radians(sum(p[0] for p in ring) / len(ring) / 1e6))
+    points = [(p[1] * METERS_PER_MICRODEGREE * mid, p[0] * METERS_PER_MICRODEGREE) for p in ring]
+
+    def segment_distance(p, a, b):
+        ex, ey = b[0] - a[0], b[1] - a[1]
+        length2 = ex * ex + ey * ey
+        t = 0.0 if length2 == 0 else max(0.0, min(1.0, ((p[0] - a[0]) * ex + (p[1] - a[1]) * ey) / length2))
+        return math.hypot(a[0] + t * ex - p[0], a[1] + t * ey - p[1])
+
+    # Split the ring at its first vertex and the vertex farthest from it
+    far = max(range(len(points)), key=lambda i: math.hypot(points[i][0] - points[0][0],
+                                                            points[i][1] - points[0][1]))
+    keep = {0, far}
+    stack = [(0, far), (far, len(points))]
+    while stack:
+        first, last = stack.pop()
+        end = points[last % len(points)]
+        best, index = 0.0, None
+        for i in range(first + 1, last):
+            distance = segment_distance(points[i], points[first], end)
+            if distance > best:
+                best, index = distance, i
+        if index is not None and best > tolerance:
+            keep.add(index)
+            stack += [(first, index), (index, last)]
+
+    return [ring[i] for i in sorted(keep)]
+
+
+def load_rings(fence_id, polygons, tolerance):
+    rings = []
+    for polygon in polygons:
+        for position, coordinates in enumerate(polygon):
+            if len(coordinates) > 1 and coordinates[0] == coordinates[-1]:
+                coordinates = coordinates[:-1]
+            ring = simplify_ring([(micro(p[1]), micro(p[0])) for p in coordinates], tolerance)
+            if len(ring) >= 3:
+                rings.append(ring)
+            elif position == 0:
+                raise PackError("polygon %d has an outer ring with fewer than 3 vertices" % fence_id)
+    if len(rings) > MAX_FENCE_RINGS:
+        raise PackError("polygon %d has more than %d rings" % (fence_id, MAX_FENCE_RINGS))
+    return rings
+
+
+def load_fences(path, tolerance):
+    with open(path) as handle:
+        collection = json.load(handle)
+
+    fences = []
+    for feature in collection.get("features", []):
+        props = feature.get("properties") or {}
+        geometry = feature.get("geometry") or {}
+        if "id" not in props:
+            raise PackError("feature without an id property")
+        fence_id = int(props["id"])
+        if not 0 <= fence_id <= 0xFFFF:
+            raise PackError("fence id %d out of range" % fence_id)
+
+        if geometry.get("type") == "Point":
+            lon, lat = geometry["coordinates"][:2]
+            radius = float(props.get("radius", 0))
+            if radius <= 0:
+                raise PackError("circle %d needs a positive radius" % fence_id)
+            lat, lon = micro(lat), micro(lon)
+            dlat = int(radius / METERS_PER_MICRODEGREE) + 1
+            dlon = int(radius / (METERS_PER_MICRODEGREE * math.cos(math.radians(lat / 1e6)))) + 1
+            fences.append({
+                "id": fence_id, "type": GEOFENCE_CIRCLE,
+                "box": (lat - dlat, lat + dlat, lon - dlon, lon + dlon),
+                "center": (lat, lon), "radius": int(math.ceil(radius)),
+            })
+        elif geometry.get("type") in ("Polygon", "MultiPolygon"):
+            polygons = geometry["coordinates"]
+            if geometry["type"] == "Polygon":
+                polygons = [polygons]
+            rings = load_rings(fence_id, polygons, tolerance)
+            lats = [p[0] for ring in rings for p in ring]
+            lons = [p[1] for ring in rings for p in ring]
+            fences.append({
+                "id": fence_id, "type": GEOFENCE_POLYGON,
+                "box": (min(lats), max(lats), min(lons), max(lons)),
+                "rings": rings,
+            })
+        else:
+            raise PackError("fence %d: unsupported geometry %r" % (fence_id, geometry.get("type")))
+
+    return fences
+
+
+def tile_range(box):
+    min_lat, max_lat, min_lon, max_lon = box
+    mid = math.cos(math.radians((min_lat + max_lat) / 2e6))
+    pad_lat = int(BOX_MARGIN_METERS / METERS_PER_MICRODEGREE)
+    pad_lon = int(BOX_MARGIN_METERS / (METERS_PER_MICRODEGREE * max(mid, 0.01)))
+    rows = range((min_lat - pad_lat - TILE_ROW_ORIGIN) // TILE_SIZE_MICRODEG,
+                 (max_lat + pad_lat - TILE_ROW_ORIGIN) // TILE_SIZE_MICRODEG + 1)
+    cols = range((min_lon - pad_lon - TILE_COL_ORIGIN) // TILE_SIZE_MICRODEG,
+                 (max_lon + pad_lon - TILE_COL_ORIGIN) // TILE_SIZE_MICRODEG + 1)
+    return [(row, col) for row in rows for col in cols]
+
+
+def encode_tile(fences):
+    records, rings, vertex_lat, vertex_lon = [], [], [], []
+    for fence in fences:
+        min_lat, max_lat, min_lon, max_lon = fence["box"]
+        if fence["type"] == GEOFENCE_CIRCLE:
+            lat, lon = fence["center"]
+            records.append(FENCE.pack(fence["id"], GEOFENCE_CIRCLE, 0, min_lat, max_lat, min_lon, max_lon,
+                                      lat, lon, fence["radius"], 0, 0))
+            continue
+
+        records.append(FENCE.pack(fence["id"], GEOFENCE_POLYGON, 0, min_lat, max_lat, min_lon, max_lon,
+                                  0, 0, 0, len(rings), len(fence["rings"])))
+        for ring in fence["rings"]:
+            lats = [p[0] for p in ring]
+            lons = [p[1] for p in ring]
+            rings.append(RING.pack(len(vertex_lat), len(ring), min(lats), max(lats), min(lons), max(lons)))
+            vertex_lat += lats
+            vertex_lon += lons
+
+    if len(vertex_lat) > 0xFFFF or len(rings) > 0xFFFF:
+        raise PackError("too many vertices in one tile")
+    data = HEADER.pack(TILE_MAGIC, len(records), len(rings), len(vertex_lat), 0)
+    data += b"".join(records) + b"".join(rings)
+    data += struct.pack("<%di" % len(vertex_lat), *vertex_lat)
+    data += struct.pack("<%di" % len(vertex_lon), *vertex_lon)
+    return data
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--simplify", type=float, default=1.0, metavar="METERS",
+                        help="ring simplification tolerance, 0 to keep every vertex")
+    parser.add_argument("geojson")
+    parser.add_argument("data_dir")
+    args = parser.parse_args(argv[1:])
+
+    try:
+        fences = load_fences(args.geojson, args.simplify)
+    except (OSError, ValueError, KeyError, IndexError, PackError) as err:
+        print("error: %s" % err, file=sys.stderr)
+        return 1
+
+    tiles = {}
+    for fence in fences:
+        for cell in tile_range(fence["box"]):
+            tiles.setdefault(cell, []).append(fence)
+
+    out_dir = os.path.join(args.data_dir, "tiles")
+    os.makedirs(out_dir, exist_ok=True)
+
+    total = largest = 0
+    for (row, col), members in sorted(tiles.items()):
+        try:
+            data = encode_tile(members)
+        except PackError as err:
+            print("error: tile %d_%d: %s" % (row, col, err), file=sys.stderr)
+            return 1
+        if len(data) > TILE_MAX_BYTES:
+            print("error: tile %d_%d is %d bytes (max %d); simplify the fences or shrink the grid"
+                  % (row, col, len(data), TILE_MAX_BYTES), file=sys.stderr)
+            return 1
+        with open(os.path.join(out_dir, "%d_%d.bin" % (row, col)), "wb") as handle:
+            handle.write(data)
+        total += len(data)
+        largest = max(largest, len(data))
+
+    print("%d fences -> %d tiles, %d bytes (largest tile %d bytes)"
+          % (len(fences), len(tiles), total, largest))
+    # Hash what is in the directory, which is what the device will have
+    tree = write_index(out_dir)
+    print("fence root %08X over %d tiles" % (tree.root32(), len(tree.leaves)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,470 @@
+#!/usr/bin/env python3
+"""Backend side of the fence tile sync (MSG_TYPE_TILE_SYNC, src/tile_sync.h).
+
+The device reports the leading 4 bytes of its tile tree root in status
+uplinks. When that differs from TileTree.root32() over the tiles it
+should have, start a SyncSession with them, feed it every uplink from the
+device (on_uplink) and queue what downlink() returns on
+LORAWAN_CONFIG_PORT. The session walks down the branches whose hashes
+differ, rewrites the tiles that changed, deletes whole subtrees the
+device should not have, and walks again from the root to confirm.
+
+    tile_sync.py root data/tiles          root hash and tile count
+    tile_sync.py index data/tiles         write tiles/index.bin for uploadfs
+    tile_sync.py simulate [--tiles 2000] [--changes 1,10,100] [--loss 0.1]
+
+simulate runs the session against a model of src/tile_sync.cpp over a
+lossy Class A link and prints the uplinks, downlinks and bytes each sync
+took, next to re-sending every tile.
+"""
+
+import argparse
+import hashlib
+import os
+import random
+import re
+import struct
+import sys
+from bisect import bisect_left
+from collections import deque
+
+MSG_TYPE_STATUS_UPDATE = 0x03
+MSG_TYPE_TILE_SYNC = 0x0E
+TILE_SYNC_NODE = 0x01
+TILE_SYNC_STATUS = 0x02
+CMD_TILE_QUERY = 0x19
+CMD_TILE_WRITE = 0x1A
+CMD_TILE_DELETE = 0x1B
+
+TILE_WRITE_PROGRESS = 0
+TILE_WRITE_INSTALLED = 1
+TILE_WRITE_REJECTED = 2
+TILE_DELETED = 3
+
+DEPTH = 6                   # TILE_TREE_DEPTH
+HASH_BYTES = 8
+INDEX_MAGIC = 0x31494647    # "GFI1"
+TILE_MAGIC = 0x32544647     # "GFT2"
+MAX_REPLIES = 8             # TILE_SYNC_MAX_REPLIES
+MAX_UPLINK = 51             # TILE_SYNC_MAX_PAYLOAD
+NODE_HEADER = 8
+WRITE_HEADER = 9            # Command byte, key, offset, total
+TILE_NAME = re.compile(r"^(\d+)_(\d+)\.bin$")
+
+
+# ===============================================================
+# HASH TREE
+# ===============================================================
+
+def _spread(v):
+    out = 0
+    for bit in range(12):
+        out |= ((v >> bit) & 1) << (2 * bit)
+    return out
+
+
+def morton(key):
+    """Morton code of a tile key, (row << 16) | col."""
+    return (_spread(key >> 16) << 1) | _spread(key & 0xFFFF)
+
+
+def key_for_code(code):
+    row = col = 0
+    for bit in range(12):
+        col |= ((code >> (2 * bit)) & 1) << bit
+        row |= ((code >> (2 * bit + 1)) & 1) << bit
+    return (row << 16) | col
+
+
+def leaf_hash(key, data):
+    return hashlib.sha256(b"\x00" + struct.pack(">I", key) + data).digest()[:HASH_BYTES]
+
+
+class TileTree:
+    def __init__(self, tiles):
+        """tiles: {key: file bytes}"""
+        self.leaves = sorted((morton(key), leaf_hash(key, data)) for key, data in tiles.items())
+        self.codes = [code for code, _ in self.leaves]
+        self.cache = {}
+
+    def _range(self, depth, prefix):
+        shift = 4 * (DEPTH - depth)
+        return bisect_left(self.codes, prefix << shift), bisect_left(self.codes, (prefix + 1) << shift)
+
+    def children(self, depth, prefix):
+        """{nibble: (child prefix, hash)} of a node's non-empty children."""
+        lo, hi = self._range(depth, prefix)
+        shift = 4 * (DEPTH - depth - 1)
+        nibbles = []
+        while lo < hi:
+            nibble = (self.codes[lo] >> shift) & 0xF
+            nibbles.append(nibble)
+            lo = bisect_left(self.codes, (((prefix << 4) | nibble) + 1) << shift, lo, hi)
+        return {n: ((prefix << 4) | n, self.hash(depth + 1, (prefix << 4) | n)) for n in nibbles}
+
+    def hash(self, depth, prefix):
+        if (depth, prefix) in self.cache:
+            return self.cache[(depth, prefix)]
+        lo, hi = self._range(depth, prefix)
+        if lo == hi:
+            value = bytes(HASH_BYTES)
+        elif depth == DEPTH:
+            value = self.leaves[lo][1]
+        else:
+            parts = b"".join(bytes([n]) + h for n, (_, h) in sorted(self.children(depth, prefix).items()))
+            value = hashlib.sha256(b"\x01" + parts).digest()[:HASH_BYTES]
+        self.cache[(depth, prefix)] = value
+        return value
+
+    def root(self):
+        return self.hash(0, 0)
+
+    def root32(self):
+        return struct.unpack(">I", self.root()[:4])[0]
+
+    def keys_under(self, depth, prefix):
+        lo, hi = self._range(depth, prefix)
+        return [key_for_code(code) for code in self.codes[lo:hi]]
+
+
+def load_tiles(tiles_dir):
+    tiles = {}
+    for name in os.listdir(tiles_dir):
+        match = TILE_NAME.match(name)
+        if match:
+            with open(os.path.join(tiles_dir, name), "rb") as handle:
+                tiles[(int(match.group(1)) << 16) | int(match.group(2))] = handle.read()
+    return tiles
+
+
+def write_index(tiles_dir, tiles=None):
+    """tiles/index.bin as src/tile_sync.cpp keeps it, so the device does
+    not have to hash every tile on its first boot."""
+    tree = TileTree(load_tiles(tiles_dir) if tiles is None else tiles)
+    with open(os.path.join(tiles_dir, "index.bin"), "wb") as handle:
+        handle.write(struct.pack("<II", INDEX_MAGIC, len(tree.leaves)))
+        for code, digest in tree.leaves:
+            handle.write(struct.pack("<I", code) + digest)
+    return tree
+
+
+# ===============================================================
+# SYNC SESSION
+# ===============================================================
+
+class SyncSession:
+    def __init__(self, tiles, downlink_size=51):
+        self.tiles = tiles
+        self.tree = TileTree(tiles)
+        self.chunk = downlink_size - WRITE_HEADER
+        self.queries_per_downlink = (downlink_size - 1) // 4
+        self.uplinks = 0
+        self.done = False
+        self.rounds = 0
+        self.rejected = set()
+        self.queries = deque()      # (depth, first, prefix) to ask
+        self.asked = {}             # (depth, first, prefix) -> uplink count
+        self.deletes = deque()      # (depth, prefix)
+        self.writes = deque()       # keys
+        self.current = None         # [key, data, next offset, acknowledged offset]
+        self.found = 0              # Differences found this round
+        self._start_round()
+
+    def _start_round(self):
+        self.rounds += 1
+        self.found = 0
+        self.queries.append((0, 0, 0))
+
+    def _idle(self):
+        return not (self.queries or self.asked or self.deletes or self.writes or self.current)
+
+    def on_uplink(self, frame):
+        frame = bytes(frame)
+        self.uplinks += 1
+        if self.done or not frame:
+            return
+        if frame[0] == MSG_TYPE_STATUS_UPDATE and len(frame) >= 12:
+            self._check_root(struct.unpack(">I", frame[6:10])[0])
+        elif frame[0] == MSG_TYPE_TILE_SYNC and len(frame) >= 2:
+            if frame[1] == TILE_SYNC_NODE and len(frame) >= NODE_HEADER:
+                self._on_node(frame)
+            elif frame[1] == TILE_SYNC_STATUS and len(frame) >= 13:
+                self._on_status(frame)
+
+    def _check_root(self, root):
+        if root == self.tree.root32():
+            self.done = True
+
+    def _on_node(self, frame):
+        depth, first = frame[2] >> 4, frame[2] & 0xF
+        prefix = (frame[3] << 16) | (frame[4] << 8) | frame[5]
+        mask = (frame[6] << 8) | frame[7]
+        hashes = [frame[i:i + 4] for i in range(NODE_HEADER, len(frame) - 3, 4)]
+        if self.asked.pop((depth, first, prefix), None) is None:
+            return      # Answered already (a repeat)
+
+        listed = [n for n in range(first, 16) if mask & (1 << n)][:len(hashes)]
+        device = dict(zip(listed, hashes))
+        covered_to = 16
+        if len(listed) < bin(mask >> first).count("1"):
+            covered_to = listed[-1] + 1 if listed else first
+            self.queries.append((depth, covered_to, prefix))
+
+        ours = self.tree.children(depth, prefix)
+        for n in range(first, covered_to):
+            child = (prefix << 4) | n
+            if n in device and n not in ours:
+                self.deletes.append((depth + 1, child))
+            elif n in ours and n not in device:
+                self.writes.extend(self.tree.keys_under(depth + 1, child))
+            elif n in ours and ours[n][1][:4] != device[n]:
+                if depth + 1 == DEPTH:
+                    self.writes.append(key_for_code(child))
+                else:
+                    self.queries.append((depth + 1, 0, child))
+                    continue
+            else:
+                continue
+            self.found += 1
+
+    def _on_status(self, frame):
+        result = frame[2]
+        target = struct.unpack(">I", frame[3:7])[0]
+        value = (frame[7] << 8) | frame[8]
+        root = struct.unpack(">I", frame[9:13])[0]
+        if root == self.tree.root32():
+            self.done = True
+            return
+
+        current = self.current
+        if result == TILE_WRITE_REJECTED:
+            self.rejected.add(target)
+            if current and current[0] == target:
+                self.current = None
+        elif result == TILE_WRITE_PROGRESS and current and current[0] == target:
+            if value > current[3]:
+                current[3] = value
+            elif value < current[2]:
+                # No progress since the last report: a chunk went missing
+                current[2] = value
+
+    def downlink(self):
+        """Next command for the device, or None."""
+        if self.done:
+            return None
+
+        # Queries that went unanswered for a queue's worth of uplinks
+        for query, at in list(self.asked.items()):
+            if self.uplinks - at > MAX_REPLIES + 4:
+                del self.asked[query]
+                self.queries.appendleft(query)
+
+        room = min(MAX_REPLIES - len(self.asked), self.queries_per_downlink)
+        if self.queries and room > 0:
+            batch = [self.queries.popleft() for _ in range(min(room, len(self.queries)))]
+            for query in batch:
+                self.asked[query] = self.uplinks
+            return bytes([CMD_TILE_QUERY]) + b"".join(
+                bytes([(depth << 4) | first]) + struct.pack(">I", prefix)[1:] for depth, first, prefix in batch)
+
+        if self.deletes:
+            depth, prefix = self.deletes.popleft()
+            return bytes([CMD_TILE_DELETE, depth]) + struct.pack(">I", prefix)[1:]
+
+        while self.current is None and self.writes:
+            key = self.writes.popleft()
+            if key not in self.rejected:
+                self.current = [key, self.tiles[key], 0, 0]
+        if self.current is not None:
+            key, data, offset, _ = self.current
+            part = data[offset:offset + self.chunk]
+            self.current[2] = offset + len(part)
+            if self.current[2] >= len(data):
+                # Sent in full; the next walk catches anything that went wrong
+                self.current = None
+            return struct.pack(">BIHH", CMD_TILE_WRITE, key, offset, len(data)) + part
+
+        # Everything sent: walk again, a walk finding nothing confirms it
+        if self._idle() and not self.asked:
+            if self.rounds > 0 and self.found == 0 and not self.queries:
+                self.done = True
+                return None
+            self._start_round()
+            return self.downlink()
+        return None
+
+
+# ===============================================================
+# SIMULATION
+# ===============================================================
+
+class DeviceModel:
+    """src/tile_sync.cpp"""
+
+    def __init__(self, tiles):
+        self.tiles = dict(tiles)
+        self.nodes = deque()
+        self.status = None
+        self.write = None           # [key, total, data so far]
+        self._tree = None
+
+    def tree(self):
+        if self._tree is None:
+            self._tree = TileTree(self.tiles)
+        return self._tree
+
+    def command(self, payload):
+        cmd, body = payload[0], payload[1:]
+        if cmd == CMD_TILE_QUERY:
+            tree = self.tree()
+            for i in range(0, len(body) - 3, 4):
+                depth, first = body[i] >> 4, body[i] & 0xF
+                prefix = (body[i + 1] << 16) | (body[i + 2] << 8) | body[i + 3]
+                if depth >= DEPTH or len(self.nodes) >= MAX_REPLIES:
+                    continue
+                children = tree.children(depth, prefix)
+                mask = sum(1 << n for n in children)
+                room = (MAX_UPLINK - NODE_HEADER) // 4
+                listed = [children[n][1][:4] for n in sorted(children) if n >= first][:room]
+                self.nodes.append(bytes([MSG_TYPE_TILE_SYNC, TILE_SYNC_NODE, body[i]]) + body[i + 1:i + 4] +
+                                  struct.pack(">H", mask) + b"".join(listed))
+        elif cmd == CMD_TILE_WRITE:
+            key, offset, total = struct.unpack(">IHH", body[:8])
+            data = body[8:]
+            if offset == 0:
+                self.write = [key, total, bytearray()]
+            elif not self.write or self.write[0] != key or self.write[1] != total or len(self.write[2]) != offset:
+                same = self.write and self.write[0] == key and self.write[1] == total
+                self._report(TILE_WRITE_PROGRESS, key, len(self.write[2]) if same else 0)
+                return
+            self.write[2] += data
+            if len(self.write[2]) < total:
+                self._report(TILE_WRITE_PROGRESS, key, len(self.write[2]))
+                return
+            self.tiles[key] = bytes(self.write[2])
+            self._tree = None
+            self.write = None
+            self._report(TILE_WRITE_INSTALLED, key, total)
+        elif cmd == CMD_TILE_DELETE:
+            depth = body[0]
+            prefix = (body[1] << 16) | (body[2] << 8) | body[3]
+            keys = self.tree().keys_under(depth, prefix)
+            for key in keys:
+                del self.tiles[key]
+            self._tree = None
+            self._report(TILE_DELETED, (depth << 24) | prefix, len(keys))
+
+    def _report(self, result, target, value):
+        self.status = struct.pack(">BBBIHI", MSG_TYPE_TILE_SYNC, TILE_SYNC_STATUS, result, target, value,
+                                  self.tree().root32())
+
+    def uplink(self):
+        """Status first, then tree nodes, else an ordinary position uplink."""
+        if self.status:
+            frame, self.status = self.status, None
+            return frame
+        if self.nodes:
+            return self.nodes.popleft()
+        return b"\x01" + bytes(12)
+
+
+def random_tiles(rng, count):
+    """Tiles clustered like a real fence set, 200 B to 3 kB each."""
+    tiles = {}
+    while len(tiles) < count:
+        row = int(rng.gauss(566, 40)) % 1800
+        col = int(rng.gauss(1093, 40)) % 3600
+        tiles[(row << 16) | col] = random_tile(rng)
+    return tiles
+
+
+def random_tile(rng):
+    """A header the device accepts and random vertices."""
+    vertices = rng.randint(25, 370)
+    return struct.pack("<IHHHH", TILE_MAGIC, 0, 0, vertices, 0) + bytes(rng.getrandbits(8) for _ in range(8 * vertices))
+
+
+def change_tiles(rng, tiles, changes):
+    """Edit, add and delete tiles, about a third each."""
+    result = dict(tiles)
+    keys = sorted(result)
+    for i in range(changes):
+        kind = i % 3
+        if kind == 0:
+            result[rng.choice(keys)] = random_tile(rng)
+        elif kind == 1:
+            result.update(random_tiles(rng, 1))
+        else:
+            key = rng.choice(keys)
+            result.pop(key, None)
+    return result
+
+
+def run_sync(device, tiles, loss, rng, downlink_size=51):
+    """Uplinks and downlinks until the session is done."""
+    session = SyncSession(tiles, downlink_size)
+    uplinks = downlinks = down_bytes = nodes = 0
+    queued = None
+    while not session.done:
+        uplinks += 1
+        if uplinks > 200000:
+            raise RuntimeError("sync stalled")
+        frame = device.uplink()
+        nodes += frame[:2] == bytes([MSG_TYPE_TILE_SYNC, TILE_SYNC_NODE])
+        if rng.random() < loss:
+            continue
+        session.on_uplink(frame)
+        # Class A: the downlink queued after the previous uplink goes out now
+        if queued is not None:
+            downlinks += 1
+            down_bytes += len(queued)
+            if rng.random() >= loss:
+                device.command(queued)
+        queued = session.downlink()
+    return uplinks, nodes, downlinks, down_bytes, session.rounds
+
+
+def simulate(args):
+    rng = random.Random(args.seed)
+    base = random_tiles(rng, args.tiles)
+    full_bytes = sum(len(d) for d in base.values())
+    chunk = args.downlink_size - WRITE_HEADER
+    full_downlinks = sum((len(d) + chunk - 1) // chunk for d in base.values())
+    print("%d tiles, %d bytes; sending them all takes %d downlinks" % (len(base), full_bytes, full_downlinks))
+    print("%8s | %8s %11s %9s %11s %7s | %s" % ("changes", "uplinks", "tree nodes", "downlinks", "bytes down",
+                                                  "rounds", "in step"))
+    for changes in [int(c) for c in args.changes.split(",")]:
+        target = change_tiles(rng, base, changes)
+        device = DeviceModel(base)
+        up, nodes, down, down_bytes, rounds = run_sync(device, target, args.loss, rng, args.downlink_size)
+        same = device.tree().root() == TileTree(target).root()
+        print("%8d | %8d %11d %9d %11d %7d | %s" % (changes, up, nodes, down, down_bytes, rounds,
+                                                    "yes" if same else "NO"))
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="command", required=True)
+    for name in ("root", "index"):
+        cmd = sub.add_parser(name)
+        cmd.add_argument("tiles_dir")
+    sim = sub.add_parser("simulate", help="sync cost against change size")
+    sim.add_argument("--tiles", type=int, default=2000)
+    sim.add_argument("--changes", default="1,3,10,30,100")
+    sim.add_argument("--loss", type=float, default=0.1, help="uplink and downlink loss")
+    sim.add_argument("--downlink-size", type=int, default=51)
+    sim.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args(argv[1:])
+
+    if args.command == "simulate":
+        simulate(args)
+        return 0
+
+    tiles = load_tiles(args.tiles_dir)
+    tree = write_index(args.tiles_dir, tiles) if args.command == "index" else TileTree(tiles)
+    print("%d tiles, root %s (status uplinks carry %08X)" % (len(tiles), tree.root().hex().upper(), tree.root32()))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
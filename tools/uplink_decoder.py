@@ -0,0 +1,224 @@
+#!/usr/bin/env python3
+"""Decode application uplinks (LORAWAN_PORT) from src/lorawan_manager.cpp.
+
+Handles the position formats and the device reports:
+
+    0x01  GPS data       13 bytes, 1e-6 degree, big-endian
+    0x03  status         battery, uptime, satellites, flags, fence tile root,
+                         firmware id (tools/fuota.py)
+    0x0B  compact GPS    quantized to the fix accuracy (see below)
+    0x0C  bulk frame     header only; tools/fec_decoder.py rebuilds groups
+    0x0D  bulk ARQ frame header only; tools/bulk_arq.py reorders and acks
+    0x0E  tile sync      tree node or write result; tools/tile_sync.py
+
+Compact GPS: byte 1 holds the precision exponent e in its low nibble
+(cells of 2^e micro-degrees) and 0x80 when altitude is present. A bit
+stream follows, most significant bit first: the latitude cell index
+(latitude + 90 deg), the longitude cell index (longitude + 180 deg),
+each just wide enough for its range, then a signed 16-bit altitude.
+Positions decode to the cell centre, so the rounding error is at most
+half a cell per axis.
+
+Examples:
+    uplink_decoder.py 0B8435EE6B342208011300
+    uplink_decoder.py --json 01FE019C3CFBC9AC0C0226090A
+    uplink_decoder.py 03FF0030070583032A10032041C7A2E9 0E01000000000003E3120F17401EA65C
+
+Usable as a module: decode(payload) returns a dict.
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+MSG_TYPE_GPS_DATA = 0x01
+MSG_TYPE_STATUS_UPDATE = 0x03
+MSG_TYPE_GPS_COMPACT = 0x0B
+MSG_TYPE_BULK = 0x0C
+MSG_TYPE_BULK_ARQ = 0x0D
+MSG_TYPE_TILE_SYNC = 0x0E
+
+TILE_SYNC_NODE = 0x01
+TILE_SYNC_STATUS = 0x02
+TILE_SYNC_RESULTS = ["progress", "installed", "rejected", "deleted"]
+STATUS_FLAGS = [(0x01, "tiles"), (0x02, "silenced"), (0x04, "trial")]
+
+METERS_PER_MICRODEGREE = 0.11131949
+
+
+class DecodeError(Exception):
+    pass
+
+
+class BitReader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def read(self, bits):
+        value = 0
+        for _ in range(bits):
+            byte = self.pos >> 3
+            if byte >= len(self.data):
+                raise DecodeError("payload too short")
+            value = (value << 1) | ((self.data[byte] >> (7 - (self.pos & 7))) & 1)
+            self.pos += 1
+        return value
+
+
+def decode_gps_data(payload):
+    if len(payload) < 13:
+        raise DecodeError("GPS data needs 13 bytes")
+    lat, lon, alt, sats, hdop = struct.unpack(">iihBB", payload[1:13])
+    return {
+        "type": "gps",
+        "latitude": lat / 1e6,
+        "longitude": lon / 1e6,
+        "altitude": alt,
+        "satellites": sats,
+        "hdop": hdop / 10.0,
+    }
+
+
+def decode_gps_compact(payload):
+    if len(payload) < 2:
+        raise DecodeError("compact GPS needs a header")
+    exponent = payload[1] & 0x0F
+    has_altitude = bool(payload[1] & 0x80)
+    lat_bits = (180000000 >> exponent).bit_length()
+    lon_bits = (360000000 >> exponent).bit_length()
+
+    reader = BitReader(payload[2:])
+    step = 1 << exponent
+    half = step >> 1
+    lat = (reader.read(lat_bits) << exponent) + half - 90000000
+    lon = (reader.read(lon_bits) << exponent) + half - 180000000
+    result = {
+        "type": "gps_compact",
+        "latitude": lat / 1e6,
+        "longitude": lon / 1e6,
+        "precision_m": step * METERS_PER_MICRODEGREE,
+    }
+    if has_altitude:
+        altitude = reader.read(16)
+        result["altitude"] = altitude - 0x10000 if altitude & 0x8000 else altitude
+    return result
+
+
+def decode_bulk(payload):
+    if len(payload) < 3:
+        raise DecodeError("bulk frame needs a header")
+    result = {"type": "bulk", "group": payload[1]}
+    if payload[2] & 0x80:
+        if len(payload) < 5:
+            raise DecodeError("bulk parity needs a header")
+        result.update(parity=payload[2] & 0x7F, k=payload[3], r=payload[4])
+    else:
+        result.update(index=payload[2], payload=payload[3:].hex().upper())
+    return result
+
+
+def decode_bulk_arq(payload):
+    if len(payload) < 4:
+        raise DecodeError("bulk ARQ frame needs a header")
+    seq = (payload[1] << 8) | payload[2]
+    return {
+        "type": "bulk_arq",
+        "seq": seq,
+        "window_start": (seq - payload[3]) & 0xFFFF,
+        "payload": payload[4:].hex().upper(),
+    }
+
+
+def decode_status(payload):
+    if len(payload) < 12:
+        raise DecodeError("status needs 12 bytes")
+    battery, uptime, sats, flags, root, tiles = struct.unpack(">BHBBIH", payload[1:12])
+    # Firmware before the firmware id sent 12 bytes
+    firmware = "%08X" % struct.unpack(">I", payload[12:16])[0] if len(payload) >= 16 else None
+    return {
+        "type": "status",
+        "battery": None if battery == 0xFF else battery,
+        "uptime_h": uptime,
+        "satellites": sats,
+        "flags": ",".join(name for bit, name in STATUS_FLAGS if flags & bit),
+        "fence_root": "%08X" % root,
+        "tiles": tiles,
+        "firmware_id": firmware,
+    }
+
+
+def decode_tile_sync(payload):
+    if len(payload) < 2:
+        raise DecodeError("tile sync needs a subtype")
+    if payload[1] == TILE_SYNC_NODE:
+        if len(payload) < 8:
+            raise DecodeError("tile sync node needs 8 bytes")
+        mask = (payload[6] << 8) | payload[7]
+        hashes = payload[8:]
+        children = [n for n in range(payload[2] & 0x0F, 16) if mask & (1 << n)][:len(hashes) // 4]
+        return {
+            "type": "tile_node",
+            "depth": payload[2] >> 4,
+            "prefix": "%06X" % int.from_bytes(payload[3:6], "big"),
+            "mask": "%04X" % mask,
+            "children": {"%X" % n: hashes[4 * i:4 * i + 4].hex().upper() for i, n in enumerate(children)},
+        }
+    if payload[1] == TILE_SYNC_STATUS:
+        if len(payload) < 13:
+            raise DecodeError("tile sync status needs 13 bytes")
+        result, target, value, root = struct.unpack(">BIHI", payload[2:13])
+        return {
+            "type": "tile_status",
+            "result": TILE_SYNC_RESULTS[result] if result < len(TILE_SYNC_RESULTS) else result,
+            "target": "%08X" % target,
+            "value": value,
+            "fence_root": "%08X" % root,
+        }
+    raise DecodeError("unknown tile sync subtype 0x%02X" % payload[1])
+
+
+DECODERS = {
+    MSG_TYPE_GPS_DATA: decode_gps_data,
+    MSG_TYPE_STATUS_UPDATE: decode_status,
+    MSG_TYPE_GPS_COMPACT: decode_gps_compact,
+    MSG_TYPE_BULK: decode_bulk,
+    MSG_TYPE_BULK_ARQ: decode_bulk_arq,
+    MSG_TYPE_TILE_SYNC: decode_tile_sync,
+}
+
+
+def decode(payload):
+    payload = bytes(payload)
+    if not payload:
+        raise DecodeError("empty payload")
+    decoder = DECODERS.get(payload[0])
+    if decoder is None:
+        raise DecodeError("unknown message type 0x%02X" % payload[0])
+    return decoder(payload)
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--json", action="store_true", help="one JSON object per payload")
+    parser.add_argument("payloads", nargs="+", metavar="HEX")
+    args = parser.parse_args(argv[1:])
+
+    status = 0
+    for text in args.payloads:
+        try:
+            result = decode(bytes.fromhex(text))
+        except (ValueError, DecodeError) as err:
+            print("error: %s: %s" % (text, err), file=sys.stderr)
+            status = 1
+            continue
+        if args.json:
+            print(json.dumps(result))
+        else:
+            print(" ".join("%s=%s" % item for item in result.items()))
+    return status
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))